@@ -13,6 +13,11 @@
 #include "ctrl_mods/btk_pubkey.h"
 #include "ctrl_mods/btk_vanity.h"
 #include "ctrl_mods/btk_node.h"
+#include "ctrl_mods/btk_blocks.h"
+#include "ctrl_mods/btk_utxo.h"
+#include "ctrl_mods/btk_index.h"
+#include "ctrl_mods/btk_sign.h"
+#include "ctrl_mods/btk_hd.h"
 #include "ctrl_mods/btk_version.h"
 #include "mods/error.h"
 
@@ -58,6 +63,14 @@ int main(int argc, char *argv[])
 	{
 		r = btk_pubkey_main(argc, argv);
 	}
+	else if (strcmp(argv[1], "sign") == 0)
+	{
+		r = btk_sign_main(argc, argv);
+	}
+	else if (strcmp(argv[1], "hd") == 0)
+	{
+		r = btk_hd_main(argc, argv);
+	}
 	else if (strcmp(argv[1], "vanity") == 0)
 	{
 		r = btk_vanity_main(argc, argv);
@@ -66,6 +79,18 @@ int main(int argc, char *argv[])
 	{
 		r = btk_node_main(argc, argv);
 	}
+	else if (strcmp(argv[1], "blocks") == 0)
+	{
+		r = btk_blocks_main(argc, argv);
+	}
+	else if (strcmp(argv[1], "utxo") == 0)
+	{
+		r = btk_utxo_main(argc, argv);
+	}
+	else if (strcmp(argv[1], "index") == 0)
+	{
+		r = btk_index_main(argc, argv);
+	}
 	else if (strcmp(argv[1], "version") == 0)
 	{
 		r = btk_version_main(argc, argv);
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <glob.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include "mods/network.h"
+#include "mods/blkscan.h"
+#include "mods/threadpool.h"
+#include "mods/error.h"
+
+#define PATH_MAXLEN  4096
+
+static struct option long_options[] = {
+	{"transactions", no_argument, NULL, 'x'},
+	{"asm",          no_argument, NULL, 'a'},
+	{"summary",      no_argument, NULL, 's'},
+	{NULL, 0, NULL, 0}
+};
+
+static int btk_blocks_scan(BlkScan, char *);
+
+int btk_blocks_main(int argc, char *argv[])
+{
+	int o, r, i;
+	int threads = 0;
+	int flags = 0;
+	int summary = 0;
+	BlkScan scan;
+	char *json;
+
+	// Options are parsed after the command name so the files that
+	// follow are the only remaining arguments.
+	while ((o = getopt_long(argc - 1, argv + 1, "j:xasT", long_options, NULL)) != -1)
+	{
+		switch (o)
+		{
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'x':
+				flags |= BLKSCAN_TRANSACTIONS;
+				break;
+			case 'a':
+				flags |= BLKSCAN_TRANSACTIONS | BLKSCAN_SCRIPTS;
+				break;
+			case 's':
+				summary = 1;
+				break;
+			case 'T':
+				network_set_test();
+				break;
+
+			case '?':
+				error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+				if (isprint(optopt))
+				{
+					error_log("Invalid command option '-%c'.", optopt);
+				}
+				else
+				{
+					error_log("Invalid command option character '\\x%x'.", optopt);
+				}
+				return -1;
+		}
+	}
+
+	if (optind >= argc - 1)
+	{
+		error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+		error_log("Missing block file argument.");
+		return -1;
+	}
+
+	if (threads == 0)
+	{
+		threads = threadpool_get_threads();
+	}
+
+	scan = malloc(blkscan_sizeof());
+	json = malloc(1000);
+	if (scan == NULL || json == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = blkscan_new(scan, threads, summary ? NULL : stdout, flags);
+	if (r < 0)
+	{
+		error_log("Could not start block scanner.");
+		return -1;
+	}
+
+	for (i = optind; i < argc - 1; ++i)
+	{
+		r = btk_blocks_scan(scan, argv[i + 1]);
+		if (r < 0)
+		{
+			blkscan_clear(scan);
+			return -1;
+		}
+	}
+
+	if (summary)
+	{
+		blkscan_to_json(json, scan);
+		printf("%s\n", json);
+	}
+
+	blkscan_clear(scan);
+	free(scan);
+	free(json);
+
+	return 1;
+}
+
+/*
+ * Scan a single block file, or every blk*.dat file in a directory in
+ * numeric order.
+ */
+static int btk_blocks_scan(BlkScan scan, char *path)
+{
+	int r;
+	size_t i;
+	char pattern[PATH_MAXLEN];
+	struct stat st;
+	glob_t files;
+
+	if (stat(path, &st) < 0)
+	{
+		error_log("Unable to find block file or directory %s.", path);
+		return -1;
+	}
+
+	if (!S_ISDIR(st.st_mode))
+	{
+		return blkscan_file(scan, path);
+	}
+
+	if (strlen(path) + 16 >= PATH_MAXLEN)
+	{
+		error_log("Block file directory path is too long.");
+		return -1;
+	}
+	snprintf(pattern, PATH_MAXLEN, "%s/blk[0-9]*.dat", path);
+
+	r = glob(pattern, 0, NULL, &files);
+	if (r == GLOB_NOMATCH)
+	{
+		error_log("No block files found in %s.", path);
+		return -1;
+	}
+	if (r != 0)
+	{
+		error_log("Could not list block files in %s.", path);
+		return -1;
+	}
+
+	for (i = 0; i < files.gl_pathc; ++i)
+	{
+		r = blkscan_file(scan, files.gl_pathv[i]);
+		if (r < 0)
+		{
+			globfree(&files);
+			return -1;
+		}
+	}
+
+	globfree(&files);
+
+	return 1;
+}
@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <getopt.h>
+#include "mods/hd.h"
+#include "mods/hdderive.h"
+#include "mods/pubkey.h"
+#include "mods/schnorr.h"
+#include "mods/threadpool.h"
+#include "mods/network.h"
+#include "mods/hex.h"
+#include "mods/error.h"
+
+#define OUTPUT_ADDRESS          HDDERIVE_ADDRESS
+#define OUTPUT_BECH32_ADDRESS   HDDERIVE_BECH32
+#define OUTPUT_TAPROOT_ADDRESS  HDDERIVE_TAPROOT
+#define OUTPUT_HEX              HDDERIVE_HEX
+#define OUTPUT_EXTENDED         (HDDERIVE_HEX + 1)
+#define FALSE                   0
+#define OUTPUT_BUFFER           150
+#define RANGE_BATCH             4096
+
+#define OUTPUT_SET(x)           if (output_format == FALSE) { output_format = x; } else { error_log("Cannot use multiple output format flags."); return -1; }
+
+static struct option long_options[] = {
+	{"path",    required_argument, NULL, 'p'},
+	{"range",   required_argument, NULL, 'r'},
+	{"threads", required_argument, NULL, 'j'},
+	{"neuter",  no_argument,       NULL, 'x'},
+	{"xpub",    required_argument, NULL, 'k'},
+	{NULL, 0, NULL, 0}
+};
+
+/*
+ * Everything btk hd derive sets up once and uses for every key.
+ */
+struct BtkHdDerive
+{
+	uint32_t path[HD_PATH_MAX];
+	size_t path_len;
+	int has_range;
+	uint32_t first;
+	size_t count;
+	int output_format;
+	int neuter;
+	Hd hd;
+	HdDerive derive;
+	PubKey key;
+	Schnorr sc;
+	struct HdNode *children;
+	char (*lines)[HDDERIVE_LINE_LEN];
+};
+
+static int btk_hd_seed(int);
+static int btk_hd_derive(char *, char *, char *, int, int, int);
+static int btk_hd_derive_key(struct BtkHdDerive *, char *);
+static int btk_hd_derive_range(struct BtkHdDerive *, const struct HdNode *);
+static int btk_hd_read_line(char **);
+static int btk_hd_parse_range(uint32_t *, size_t *, char *);
+static int btk_hd_print(struct HdNode *, int, int, PubKey, Schnorr);
+
+int btk_hd_main(int argc, char *argv[])
+{
+	int o;
+	int output_format = FALSE;
+	int neuter = 0;
+	int threads = 0;
+	char *path = NULL;
+	char *range = NULL;
+	char *xpub = NULL;
+
+	if (argc < 3)
+	{
+		error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+		error_log("Missing hd subcommand.");
+		return -1;
+	}
+
+	// Options follow the subcommand, so parse from there.
+	while ((o = getopt_long(argc - 2, argv + 2, "p:r:j:xk:EABXHT", long_options, NULL)) != -1)
+	{
+		switch (o)
+		{
+			case 'p':
+				path = optarg;
+				break;
+			case 'r':
+				range = optarg;
+				break;
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'x':
+				neuter = 1;
+				break;
+			case 'k':
+				xpub = optarg;
+				break;
+
+			case 'E':
+				OUTPUT_SET(OUTPUT_EXTENDED);
+				break;
+			case 'A':
+				OUTPUT_SET(OUTPUT_ADDRESS);
+				break;
+			case 'B':
+				OUTPUT_SET(OUTPUT_BECH32_ADDRESS);
+				break;
+			case 'X':
+				OUTPUT_SET(OUTPUT_TAPROOT_ADDRESS);
+				break;
+			case 'H':
+				OUTPUT_SET(OUTPUT_HEX);
+				break;
+			case 'T':
+				network_set_test();
+				break;
+
+			case '?':
+				error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+				if (isprint(optopt))
+				{
+					error_log("Invalid command option '-%c'.", optopt);
+				}
+				else
+				{
+					error_log("Invalid command option character '\\x%x'.", optopt);
+				}
+				return -1;
+		}
+	}
+
+	if (output_format == FALSE)
+	{
+		output_format = OUTPUT_EXTENDED;
+	}
+
+	if (threads == 0)
+	{
+		threads = threadpool_get_threads();
+	}
+
+	if (strcmp(argv[2], "seed") == 0)
+	{
+		return btk_hd_seed(neuter);
+	}
+	if (strcmp(argv[2], "derive") == 0)
+	{
+		if (xpub != NULL && strncmp(xpub, "xpub", 4) != 0 && strncmp(xpub, "tpub", 4) != 0)
+		{
+			error_log("Only give a public extended key as an argument, where other users can't see it.");
+			return -1;
+		}
+		return btk_hd_derive(xpub, path, range, output_format, neuter, threads);
+	}
+
+	error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+	error_log("'%s' is not a valid hd subcommand.", argv[2]);
+	return -1;
+}
+
+/*
+ * The master key of a seed given in hex on standard input.
+ */
+static int btk_hd_seed(int neuter)
+{
+	int r;
+	size_t len;
+	char *line;
+	char output[HD_STRING_LEN];
+	unsigned char seed[HD_SEED_LEN_MAX];
+	struct HdNode node;
+	Hd hd;
+
+	if (btk_hd_read_line(&line) < 0)
+	{
+		return -1;
+	}
+
+	len = strlen(line);
+	if (len % 2 != 0 || len < HD_SEED_LEN_MIN * 2 || len > HD_SEED_LEN_MAX * 2 || hex_str_to_raw(seed, line) < 0)
+	{
+		error_log("Seed must be %i to %i bytes in hex.", HD_SEED_LEN_MIN, HD_SEED_LEN_MAX);
+		free(line);
+		return -1;
+	}
+	memset(line, 0, len);
+	free(line);
+
+	hd = malloc(hd_sizeof());
+	if (hd == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	if (hd_new(hd) < 0)
+	{
+		error_log("Could not create HD context.");
+		return -1;
+	}
+
+	r = hd_from_seed(hd, &node, seed, len / 2);
+	memset(seed, 0, sizeof(seed));
+	hd_clear(hd);
+	free(hd);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	if (neuter)
+	{
+		hd_neuter(&node);
+	}
+	r = hd_to_string(output, &node);
+	memset(&node, 0, sizeof(node));
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	printf("%s\n", output);
+
+	return 1;
+}
+
+/*
+ * The node at path below each extended key given, or with a range, that
+ * node's children in the range, a batch at a time on a pool of threads
+ * and printed in order. The key is the --xpub argument or else each
+ * line of standard input, so one run can cover many keys.
+ */
+static int btk_hd_derive(char *xpub, char *path_str, char *range_str, int output_format, int neuter, int threads)
+{
+	int r;
+	size_t line_cap, keys;
+	ssize_t len;
+	char *line;
+	struct BtkHdDerive s;
+
+	memset(&s, 0, sizeof(s));
+	s.output_format = output_format;
+	s.neuter = neuter;
+
+	if (path_str != NULL && hd_parse_path(s.path, &s.path_len, path_str) < 0)
+	{
+		return -1;
+	}
+	if (range_str != NULL)
+	{
+		if (btk_hd_parse_range(&s.first, &s.count, range_str) < 0)
+		{
+			return -1;
+		}
+		s.has_range = 1;
+	}
+
+	s.hd = malloc(hd_sizeof());
+	s.key = malloc(pubkey_sizeof());
+	if (s.hd == NULL || s.key == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	if (hd_new(s.hd) < 0)
+	{
+		error_log("Could not create HD context.");
+		return -1;
+	}
+
+	if (output_format == OUTPUT_TAPROOT_ADDRESS)
+	{
+		s.sc = malloc(schnorr_sizeof());
+		if (s.sc == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		if (schnorr_new(s.sc) < 0)
+		{
+			error_log("Could not set up taproot key tweaking.");
+			return -1;
+		}
+	}
+
+	if (s.has_range)
+	{
+		s.children = malloc(RANGE_BATCH * sizeof(*s.children));
+		s.lines = malloc(RANGE_BATCH * sizeof(*s.lines));
+		s.derive = malloc(hdderive_sizeof());
+		if (s.children == NULL || s.lines == NULL || s.derive == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		if (hdderive_new(s.derive, threads) < 0)
+		{
+			return -1;
+		}
+	}
+
+	if (xpub != NULL)
+	{
+		r = btk_hd_derive_key(&s, xpub);
+	}
+	else
+	{
+		r = 1;
+		keys = 0;
+		line = NULL;
+		line_cap = 0;
+		while (r > 0 && (len = getline(&line, &line_cap, stdin)) >= 0)
+		{
+			while (len > 0 && isspace((unsigned char)line[len - 1]))
+			{
+				line[--len] = '\0';
+			}
+			if (len == 0)
+			{
+				continue;
+			}
+			keys++;
+			r = btk_hd_derive_key(&s, line);
+			memset(line, 0, len);
+		}
+		free(line);
+		if (r > 0 && keys == 0)
+		{
+			error_log("Missing extended key.");
+			r = -1;
+		}
+	}
+
+	if (s.has_range)
+	{
+		hdderive_clear(s.derive);
+		free(s.derive);
+		memset(s.children, 0, RANGE_BATCH * sizeof(*s.children));
+		free(s.children);
+		free(s.lines);
+	}
+	if (s.sc != NULL)
+	{
+		schnorr_clear(s.sc);
+		free(s.sc);
+	}
+	hd_clear(s.hd);
+	free(s.hd);
+	free(s.key);
+
+	return r;
+}
+
+static int btk_hd_derive_key(struct BtkHdDerive *s, char *str)
+{
+	int r;
+	struct HdNode root, node;
+
+	r = hd_from_string(&root, str);
+	if (r < 0)
+	{
+		error_log("Input is not an extended key.");
+		return -1;
+	}
+
+	r = hd_derive(s->hd, &node, &root, s->path, s->path_len);
+	memset(&root, 0, sizeof(root));
+	if (r > 0)
+	{
+		r = s->has_range ? btk_hd_derive_range(s, &node) : btk_hd_print(&node, s->output_format, s->neuter, s->key, s->sc);
+	}
+	memset(&node, 0, sizeof(node));
+
+	return r;
+}
+
+/*
+ * Addresses and public keys of non-hardened children only need the
+ * children's points, which hdderive_public() makes in batches and
+ * hashes without whole nodes. Anything else derives the nodes.
+ */
+static int btk_hd_derive_range(struct BtkHdDerive *s, const struct HdNode *node)
+{
+	int r;
+	size_t i, j, n;
+	int fast;
+
+	fast = (s->output_format != OUTPUT_EXTENDED && (uint64_t)s->first + s->count <= HD_HARDENED);
+
+	r = 1;
+	for (i = 0; r > 0 && i < s->count; i += n)
+	{
+		n = (s->count - i < RANGE_BATCH) ? s->count - i : RANGE_BATCH;
+		if (fast)
+		{
+			r = hdderive_public(s->derive, s->lines, node, s->first + (uint32_t)i, n, s->output_format);
+			for (j = 0; r > 0 && j < n; ++j)
+			{
+				fputs(s->lines[j], stdout);
+			}
+		}
+		else
+		{
+			r = hdderive_children(s->derive, s->children, node, s->first + (uint32_t)i, n);
+			for (j = 0; r > 0 && j < n; ++j)
+			{
+				r = btk_hd_print(&s->children[j], s->output_format, s->neuter, s->key, s->sc);
+			}
+		}
+	}
+
+	return r;
+}
+
+/*
+ * One line of standard input, without its line ending.
+ */
+static int btk_hd_read_line(char **line)
+{
+	size_t cap = 0;
+	ssize_t len;
+
+	*line = NULL;
+	len = getline(line, &cap, stdin);
+	if (len < 0)
+	{
+		free(*line);
+		error_log("Missing input.");
+		return -1;
+	}
+	while (len > 0 && isspace((unsigned char)(*line)[len - 1]))
+	{
+		(*line)[--len] = '\0';
+	}
+
+	return 1;
+}
+
+/*
+ * FIRST-LAST, inclusive, or a single index.
+ */
+static int btk_hd_parse_range(uint32_t *first, size_t *count, char *str)
+{
+	unsigned long long a, b;
+	char *end;
+
+	if (!isdigit((unsigned char)*str))
+	{
+		error_log("Invalid child index range '%s'.", str);
+		return -1;
+	}
+	a = strtoull(str, &end, 10);
+	b = a;
+	if (*end == '-')
+	{
+		if (!isdigit((unsigned char)end[1]))
+		{
+			error_log("Invalid child index range '%s'.", str);
+			return -1;
+		}
+		b = strtoull(end + 1, &end, 10);
+	}
+	if (*end != '\0' || b < a || b > UINT32_MAX)
+	{
+		error_log("Invalid child index range '%s'.", str);
+		return -1;
+	}
+
+	*first = (uint32_t)a;
+	*count = (size_t)(b - a + 1);
+
+	return 1;
+}
+
+static int btk_hd_print(struct HdNode *node, int output_format, int neuter, PubKey key, Schnorr sc)
+{
+	int r;
+	char output[OUTPUT_BUFFER];
+
+	if (output_format == OUTPUT_EXTENDED)
+	{
+		if (neuter)
+		{
+			hd_neuter(node);
+		}
+		if (hd_to_string(output, node) < 0)
+		{
+			return -1;
+		}
+		printf("%s\n", output);
+		return 1;
+	}
+
+	if (pubkey_from_raw(key, node->pubkey, HD_PUBKEY_LEN) < 0)
+	{
+		error_log("Could not read derived public key.");
+		return -1;
+	}
+
+	switch (output_format)
+	{
+		case OUTPUT_ADDRESS:
+			r = pubkey_to_address(output, key);
+			break;
+		case OUTPUT_BECH32_ADDRESS:
+			r = pubkey_to_bech32address(output, key);
+			break;
+		case OUTPUT_TAPROOT_ADDRESS:
+			r = pubkey_to_taproot_address(output, key, sc);
+			break;
+		default:
+			r = pubkey_to_hex(output, key);
+			break;
+	}
+	if (r < 0)
+	{
+		error_log("Could not format derived public key.");
+		return -1;
+	}
+	printf("%s\n", output);
+
+	return 1;
+}
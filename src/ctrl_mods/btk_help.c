@@ -31,6 +31,26 @@ int btk_help_main(int argc, char *argv[])
 	{
 		btk_help_node();
 	}
+	else if (strcmp(argv[2], "blocks") == 0)
+	{
+		btk_help_blocks();
+	}
+	else if (strcmp(argv[2], "utxo") == 0)
+	{
+		btk_help_utxo();
+	}
+	else if (strcmp(argv[2], "index") == 0)
+	{
+		btk_help_index();
+	}
+	else if (strcmp(argv[2], "sign") == 0)
+	{
+		btk_help_sign();
+	}
+	else if (strcmp(argv[2], "hd") == 0)
+	{
+		btk_help_hd();
+	}
 	else if (strcmp(argv[2], "vanity") == 0)
 	{
 		btk_help_vanity();
@@ -56,9 +76,14 @@ void btk_help_commands(void)
 	printf("Here is a list of btk commands.\n");
 	printf("\n");
 	printf("   privkey      create, modify, and format private keys.\n");
-	printf("   pubkey       calculate and format public keys from private keys.\n");
+	printf("   pubkey       calculate and format public keys from private or public keys.\n");
+	printf("   sign         sign message hashes with a private key.\n");
+	printf("   hd           derive BIP32 hierarchical deterministic keys.\n");
 	printf("   vanity       generate a vanity address.\n");
 	printf("   node         interface with a bitcoin node.\n");
+	printf("   blocks       scan blocks and transactions in blk*.dat files.\n");
+	printf("   utxo         build and query an unspent output set from block files.\n");
+	printf("   index        build and query an address index from block files.\n");
 	printf("   version      print btk version info.\n");
 	printf("\n");
 	printf("See 'btk help <command>' to read more about a specific command.\n");
@@ -129,6 +154,17 @@ void btk_help_privkey(void)
 	printf("      Treat input as arbitrary (b)inary data. The data is processed through\n");
 	printf("      a SHA256 hash algorithm to generate a 32 byte private key.\n");
 	printf("\n");
+	printf("   -p\n");
+	printf("      Treat input as (p)ublic keys in hexadecimal, one per line, each 66\n");
+	printf("      characters long if compressed, 130 if not, or 64 for a BIP340 x-only\n");
+	printf("      key, which is the point with an even y. A key is printed for every\n");
+	printf("      line of input.\n");
+	printf("\n");
+	printf("   -q\n");
+	printf("      Treat input as raw public keys: a single 32 byte x-only or 65 byte\n");
+	printf("      uncompressed key, or any number of 33 byte compressed keys back to\n");
+	printf("      back, each decompressed as it is read. A key is printed for each.\n");
+	printf("\n");
 	printf("OUTPUT OPTIONS\n");
 	printf("\n");
 	printf("   -W\n");
@@ -183,7 +219,7 @@ void btk_help_pubkey(void)
 {
 	printf("COMMAND\n");
 	printf("\n");
-	printf("   pubkey - calculate and format public keys from private keys.\n");
+	printf("   pubkey - calculate and format public keys from private or public keys.\n");
 	printf("\n");
 	printf("SYNOPSIS\n");
 	printf("\n");
@@ -194,6 +230,8 @@ void btk_help_pubkey(void)
 	printf("   The pubkey command generates the corresponding public key from a given\n");
 	printf("   private key. Input data should be a private key, or data from which a\n");
 	printf("   private key can be derived, in the format specified by the input option.\n");
+	printf("   Given a public key instead, it is only reformatted, which takes no\n");
+	printf("   multiplication on the curve.\n");
 	printf("\n");
 	printf("   The pubkey command will read data from standard input and interpret the\n");
 	printf("   format according to the input option specified. If no input option is\n");
@@ -241,6 +279,17 @@ void btk_help_pubkey(void)
 	printf("      Treat input as arbitrary (b)inary data. The data is processed through\n");
 	printf("      a SHA256 hash algorithm to generate a 32 byte private key.\n");
 	printf("\n");
+	printf("   -p\n");
+	printf("      Treat input as (p)ublic keys in hexadecimal, one per line, each 66\n");
+	printf("      characters long if compressed, 130 if not, or 64 for a BIP340 x-only\n");
+	printf("      key, which is the point with an even y. A key is printed for every\n");
+	printf("      line of input.\n");
+	printf("\n");
+	printf("   -q\n");
+	printf("      Treat input as raw public keys: a single 32 byte x-only or 65 byte\n");
+	printf("      uncompressed key, or any number of 33 byte compressed keys back to\n");
+	printf("      back, each decompressed as it is read. A key is printed for each.\n");
+	printf("\n");
 	printf("OUTPUT OPTIONS\n");
 	printf("\n");
 	printf("   -A\n");
@@ -249,6 +298,11 @@ void btk_help_pubkey(void)
 	printf("   -B\n");
 	printf("      Print public key as a (B)ech32 address.\n");
 	printf("\n");
+	printf("   -X\n");
+	printf("      Print public key as a taproot address: the (X)-only key tweaked as\n");
+	printf("      in BIP86 and encoded in bech32m. The key's compression doesn't change\n");
+	printf("      the address.\n");
+	printf("\n");
 	printf("   -H\n");
 	printf("      Print public key as a (H)exadecimal string. Note that a compressed\n");
 	printf("      public key in hexadecimal format is 66 characters long. An uncompressed\n");
@@ -270,25 +324,160 @@ void btk_help_pubkey(void)
 	printf("      Include the (P)rivate key in the output. This option is most useful for\n");
 	printf("      wrapper programs that want to generate and parse a private and public\n");
 	printf("      key pair in a single command. The private key will be printed first,\n");
-	printf("      followed by a single space, followed by the public key.\n");
+	printf("      followed by a single space, followed by the public key. Not available\n");
+	printf("      for public key input.\n");
 	printf("\n");
 	printf("   -N\n");
 	printf("      Do NOT print a (N)ewline character. This may be a desirable option if\n");
 	printf("      the output is being parsed by a wrapper program.\n");
 	printf("\n");
 	printf("   -T\n");
-	printf("      If the -A or -B option is specified (or assumed by default), this option\n");
-	printf("      sets the (T)ESTNET prefix so the public key is usable on the TESTNET\n");
-	printf("      network. If the -P option is also specified, the private key will be\n");
-	printf("      formatted for TESTNET network.\n");
+	printf("      If the -A, -B or -X option is specified (or assumed by default), this\n");
+	printf("      option sets the (T)ESTNET prefix so the public key is usable on the\n");
+	printf("      TESTNET network. If the -P option is also specified, the private key\n");
+	printf("      will be formatted for TESTNET network.\n");
 	printf("\n");
 	printf("   -M\n");
-	printf("      If the -A or -B option is specified (or assumed by default), this option\n");
-	printf("      sets the (M)AINNET prefix so the public key can be used on the MAINNET\n");
-	printf("      network. Note that if no network flag is specified or included in the\n");
-	printf("      input data, the MAINNET prefix is used by default. This option is only\n");
-	printf("      useful for converting TESTNET keys to MAINNET. If the -P option is also\n");
-	printf("      specified, the private key will be formatted for TESTNET network.\n");
+	printf("      If the -A, -B or -X option is specified (or assumed by default), this\n");
+	printf("      option sets the (M)AINNET prefix so the public key can be used on the\n");
+	printf("      MAINNET network. Note that if no network flag is specified or included\n");
+	printf("      in the input data, the MAINNET prefix is used by default. This option is\n");
+	printf("      only useful for converting TESTNET keys to MAINNET. If the -P option is\n");
+	printf("      also specified, the private key will be formatted for TESTNET network.\n");
+	printf("\n");
+	printf("See https://github.com/bartobri/bitcoin-toolkit for examples.\n");
+	printf("See 'btk help' to read about other commands.\n");
+	printf("\n");
+}
+
+void btk_help_sign(void)
+{
+	printf("COMMAND\n");
+	printf("\n");
+	printf("   sign - sign message hashes with a private key.\n");
+	printf("\n");
+	printf("SYNOPSIS\n");
+	printf("\n");
+	printf("   btk sign -k <file> [-C | -S] [-j <threads>]\n");
+	printf("   btk sign -b <count>\n");
+	printf("\n");
+	printf("DESCRIPTION\n");
+	printf("\n");
+	printf("   The sign command reads 32 byte hashes in hex from standard input, one per\n");
+	printf("   line, and prints an ECDSA signature for each in the same order, one per\n");
+	printf("   line. Nonces are derived from the key and hash as in RFC6979, so signing\n");
+	printf("   the same hash twice gives the same signature, and S is always in the\n");
+	printf("   lower half of the curve order. Hashes are signed on a pool of threads.\n");
+	printf("\n");
+	printf("   Signatures are printed in DER encoding, in hex, as they appear in a\n");
+	printf("   script before the hash type byte.\n");
+	printf("\n");
+	printf("   With -S the signatures are BIP340 Schnorr signatures instead, as taproot\n");
+	printf("   spends use, for the key's x-only public key. A line may then hold a\n");
+	printf("   second 32 bytes in hex after a space, the auxiliary randomness mixed\n");
+	printf("   into the nonce. Without it the randomness is all zeros, and the nonce is\n");
+	printf("   still derived from the key and hash.\n");
+	printf("\n");
+	printf("   Nonces and keys are multiplied by the curve's generator in constant\n");
+	printf("   time, with no branches or table reads that depend on their bits, and\n");
+	printf("   the arithmetic on them modulo the curve's order is constant time too.\n");
+	printf("\n");
+	printf("OPTIONS\n");
+	printf("\n");
+	printf("   -k <file>\n");
+	printf("      File holding the private key to sign with, in WIF or hex. Required\n");
+	printf("      unless benchmarking.\n");
+	printf("\n");
+	printf("   -C\n");
+	printf("      Print the 64 byte compact form, R followed by S, instead of DER.\n");
+	printf("\n");
+	printf("   -S\n");
+	printf("      Make 64 byte BIP340 (S)chnorr signatures instead of ECDSA.\n");
+	printf("\n");
+	printf("   -j <threads>\n");
+	printf("      Number of signing threads. Defaults to the number of CPUs.\n");
+	printf("\n");
+	printf("   -b <count>\n");
+	printf("      Benchmark instead of signing. Makes the public keys of <count> random\n");
+	printf("      private keys the constant time way, then again with the variable time\n");
+	printf("      comb and batched affine conversion used for public scalars, and\n");
+	printf("      prints the time and rate of each as JSON.\n");
+	printf("\n");
+	printf("See https://github.com/bartobri/bitcoin-toolkit for examples.\n");
+	printf("See 'btk help' to read about other commands.\n");
+	printf("\n");
+}
+
+void btk_help_hd(void)
+{
+	printf("COMMAND\n");
+	printf("\n");
+	printf("   hd - derive BIP32 hierarchical deterministic keys.\n");
+	printf("\n");
+	printf("SYNOPSIS\n");
+	printf("\n");
+	printf("   btk hd seed [-x] [-T]\n");
+	printf("   btk hd derive [-k <xpub>] [-p <path>] [-r <first>-<last>] [-x] [-j <threads>] [OUTPUT_OPTIONS]\n");
+	printf("\n");
+	printf("DESCRIPTION\n");
+	printf("\n");
+	printf("   The seed subcommand reads a seed of 16 to 64 bytes in hex from standard\n");
+	printf("   input and prints its master extended private key.\n");
+	printf("\n");
+	printf("   The derive subcommand reads an extended key (xprv, xpub, tprv or tpub)\n");
+	printf("   from standard input and prints the key at the given path below it. A\n");
+	printf("   private key derives private children and a public key public ones, which\n");
+	printf("   can't be hardened. The network is taken from the key. Standard input may\n");
+	printf("   hold many keys, one per line, and each is derived in turn.\n");
+	printf("\n");
+	printf("   With a range, the children of the key at the path are printed instead,\n");
+	printf("   one per line in index order. They are derived on a pool of threads, each\n");
+	printf("   of which works out what the children share only once, so every child\n");
+	printf("   costs one HMAC-SHA512 and one multiplication of the generator. Addresses\n");
+	printf("   and public keys of non-hardened children skip building whole keys: each\n");
+	printf("   thread takes them 256 at a time and converts their points with a single\n");
+	printf("   field inversion.\n");
+	printf("\n");
+	printf("OPTIONS\n");
+	printf("\n");
+	printf("   -k, --xpub <xpub>\n");
+	printf("      Derive from this extended public key in place of standard input.\n");
+	printf("      Private keys are refused here, since arguments are visible to other\n");
+	printf("      users.\n");
+	printf("\n");
+	printf("   -p, --path <path>\n");
+	printf("      Derivation path, such as m/84'/0'/0'/0. A ' or h marks a hardened\n");
+	printf("      index. Defaults to the input key itself.\n");
+	printf("\n");
+	printf("   -r, --range <first>-<last>\n");
+	printf("      Print children <first> to <last> of the key at the path. A single\n");
+	printf("      index prints just that child.\n");
+	printf("\n");
+	printf("   -x, --neuter\n");
+	printf("      Print extended public keys in place of private ones.\n");
+	printf("\n");
+	printf("   -j, --threads <threads>\n");
+	printf("      Number of derivation threads. Defaults to the number of CPUs.\n");
+	printf("\n");
+	printf("   -T\n");
+	printf("      Print the master key of a seed for (T)estnet.\n");
+	printf("\n");
+	printf("OUTPUT OPTIONS\n");
+	printf("\n");
+	printf("   -E\n");
+	printf("      Print the (E)xtended key. (default)\n");
+	printf("\n");
+	printf("   -A\n");
+	printf("      Print a traditional bitcoin (A)ddress.\n");
+	printf("\n");
+	printf("   -B\n");
+	printf("      Print a (B)ech32 address.\n");
+	printf("\n");
+	printf("   -X\n");
+	printf("      Print a taproot address, of the BIP86 tweaked (X)-only key.\n");
+	printf("\n");
+	printf("   -H\n");
+	printf("      Print the compressed public key in (H)exadecimal.\n");
 	printf("\n");
 	printf("See https://github.com/bartobri/bitcoin-toolkit for examples.\n");
 	printf("See 'btk help' to read about other commands.\n");
@@ -316,8 +505,8 @@ void btk_help_vanity(void)
 	printf("\n");
 	printf("   If no options are specified, the vanity command will search for a\n");
 	printf("   traditional compressed bitcoin address. Options exist for uncompressed,\n");
-	printf("   bech32, and testnet addresses. If the -i option is specified, the vanity\n");
-	printf("   command will perform a case insensitive match\n");
+	printf("   bech32, taproot, and testnet addresses. If the -i option is specified, the\n");
+	printf("   vanity command will perform a case insensitive match\n");
 	printf("\n");
 	printf("   See OPTIONS for more info.\n");
 	printf("\n");
@@ -329,6 +518,10 @@ void btk_help_vanity(void)
 	printf("   -B\n");
 	printf("      Match a (B)ech32 address.\n");
 	printf("\n");
+	printf("   -X\n");
+	printf("      Match a taproot address, made from the tweaked (X)-only public key and\n");
+	printf("      encoded in bech32m.\n");
+	printf("\n");
 	printf("   -C\n");
 	printf("      Match a (C)ompressed address. (default)\n");
 	printf("\n");
@@ -357,6 +550,10 @@ void btk_help_node(void)
 	printf("SYNOPSIS\n");
 	printf("\n");
 	printf("   btk node [-h <hostname>] [OPTIONS]\n");
+	printf("   btk node --download [-h <hostname>]... [-o <dir>] [OPTIONS]\n");
+	printf("   btk node --crawl [-h <hostname>]... [-n <count>] [OPTIONS]\n");
+	printf("   btk node --serve [-r <file>]... [-R <rate>] [-c <count>] [OPTIONS]\n");
+	printf("   btk node --replay <file>\n");
 	printf("\n");
 	printf("DESCRIPTION\n");
 	printf("\n");
@@ -371,12 +568,50 @@ void btk_help_node(void)
 	printf("   nodes. If the -p option is specified, the port number that is specified as\n");
 	printf("   its argument will override both of these defaults.\n");
 	printf("\n");
+	printf("   If --download (-D) is specified, the node command reads block hashes from\n");
+	printf("   standard input, one per line, and downloads those blocks over the peer to\n");
+	printf("   peer protocol. The -h option may be repeated to download from several\n");
+	printf("   hosts at once. Each host keeps a sliding window of requests in flight, and\n");
+	printf("   a host that stops delivering is dropped with its requests reassigned to\n");
+	printf("   the others. Blocks are written as they arrive to blk*.dat files using the\n");
+	printf("   same framing as bitcoin core. A JSON summary is printed when finished.\n");
+	printf("\n");
+	printf("   If --crawl (-C) is specified, the node command maps the reachable network\n");
+	printf("   starting from the given seed hosts. Every address a seed name resolves to\n");
+	printf("   is visited, and each peer that completes a handshake is asked for the\n");
+	printf("   addresses it knows about with 'getaddr'. Newly learned addresses are\n");
+	printf("   visited breadth first, many at a time, until the connection budget is\n");
+	printf("   spent. The result is a JSON table of the visited peers with their\n");
+	printf("   services, user agent, height, and connect and handshake latencies.\n");
+	printf("\n");
+	printf("   If --serve (-S) is specified, the node command acts as a bitcoin node on\n");
+	printf("   the loopback interface so the other modes can be tested and benchmarked\n");
+	printf("   without a network. It answers version, verack and ping, replays recorded\n");
+	printf("   traffic from the files given with -r to every peer after the handshake,\n");
+	printf("   and answers getdata for any block found in those files. A replay file\n");
+	printf("   holds framed messages back to back as they appear on the wire, or is a\n");
+	printf("   blk*.dat file whose blocks are served on request only. A capture file\n");
+	printf("   (see --capture) may also be given, in which case the messages the\n");
+	printf("   captured remote peer sent are replayed.\n");
+	printf("\n");
+	printf("   In any mode, --capture (-L) appends every message sent and received to\n");
+	printf("   a capture file, along with a timestamp, the direction, and the peer.\n");
+	printf("   If --replay (-P) is specified, the node command reads a capture file\n");
+	printf("   and runs each message through the message and command parsers as fast\n");
+	printf("   as it can, then prints parser throughput in JSON format. No network\n");
+	printf("   connection is made. A capture cut off partway through a record, or\n");
+	printf("   with a record that doesn't hold one whole message, is rejected here and\n");
+	printf("   by --serve rather than replayed in part.\n");
+	printf("\n");
 	printf("   See OPTIONS for more info.\n");
 	printf("\n");
 	printf("OPTIONS\n");
 	printf("\n");
 	printf("   -h <hostname>\n");
 	printf("      Specify the remote host to connect to. This is a required option.\n");
+	printf("      The host may be a name or an IPv4 or IPv6 address. A name's IPv4 and\n");
+	printf("      IPv6 addresses are tried in parallel, and each attempt is abandoned\n");
+	printf("      after 5 seconds.\n");
 	printf("\n");
 	printf("   -p <port number>\n");
 	printf("      Specify the port number to connect to.\n");
@@ -384,6 +619,206 @@ void btk_help_node(void)
 	printf("   -T\n");
 	printf("      This option is required if the remote host is a TESTNET node.\n");
 	printf("\n");
+	printf("   -D, --download\n");
+	printf("      (D)ownload the blocks whose hashes are read from standard input.\n");
+	printf("\n");
+	printf("   -o <directory>\n");
+	printf("      Write downloaded blk*.dat files to this directory. Numbering continues\n");
+	printf("      after any block files already present. Defaults to the current\n");
+	printf("      directory.\n");
+	printf("\n");
+	printf("   -w <count>\n");
+	printf("      Number of block requests each host may have in flight. (default 16)\n");
+	printf("\n");
+	printf("   -s <seconds>\n");
+	printf("      Drop a host that has delivered nothing for this many seconds while\n");
+	printf("      requests are outstanding. (default 10)\n");
+	printf("\n");
+	printf("   -C, --crawl\n");
+	printf("      (C)rawl the network starting from the hosts given with -h.\n");
+	printf("\n");
+	printf("   -n <count>\n");
+	printf("      Maximum number of peers the crawl will try to connect to.\n");
+	printf("      (default 1000)\n");
+	printf("\n");
+	printf("   -j <count>\n");
+	printf("      Number of crawl connections to keep open at once. (default 128)\n");
+	printf("\n");
+	printf("   -t <seconds>\n");
+	printf("      Time allowed for each crawled peer to connect, handshake and answer\n");
+	printf("      getaddr. (default 10)\n");
+	printf("\n");
+	printf("   -S, --serve\n");
+	printf("      (S)erve as a local node on 127.0.0.1 at the port given by -p or -T.\n");
+	printf("\n");
+	printf("   -r <file>\n");
+	printf("      Replay traffic from this file. May be repeated.\n");
+	printf("\n");
+	printf("   -R <rate>\n");
+	printf("      Replay at most this many messages per second to each peer. By default\n");
+	printf("      messages go out as fast as the peer reads them.\n");
+	printf("\n");
+	printf("   -c <count>\n");
+	printf("      Exit and print a JSON summary after serving this many connections.\n");
+	printf("      By default the local node runs until interrupted.\n");
+	printf("\n");
+	printf("   -L, --capture <file>\n");
+	printf("      (L)og all traffic to this capture file. New records are appended.\n");
+	printf("\n");
+	printf("   -P, --replay <file>\n");
+	printf("      (P)arse the messages in this capture file and report throughput.\n");
+	printf("\n");
+	printf("See https://github.com/bartobri/bitcoin-toolkit for examples.\n");
+	printf("See 'btk help' to read about other commands.\n");
+	printf("\n");
+}
+
+void btk_help_blocks(void)
+{
+	printf("COMMAND\n");
+	printf("\n");
+	printf("   blocks - scan blocks and transactions in blk*.dat files.\n");
+	printf("\n");
+	printf("SYNOPSIS\n");
+	printf("\n");
+	printf("   btk blocks [OPTIONS] <FILE|DIRECTORY>...\n");
+	printf("\n");
+	printf("DESCRIPTION\n");
+	printf("\n");
+	printf("   The blocks command maps bitcoin core block files into memory, walks their\n");
+	printf("   magic and size framing, and decodes every block and transaction it finds\n");
+	printf("   on a pool of worker threads. For a directory, every blk*.dat file in it is\n");
+	printf("   scanned in order.\n");
+	printf("\n");
+	printf("   A JSON object describing each block is printed on its own line, in the\n");
+	printf("   order the blocks appear in the files. Blocks that fail to decode are\n");
+	printf("   reported with an error member and scanning continues.\n");
+	printf("\n");
+	printf("OPTIONS\n");
+	printf("\n");
+	printf("   -j <threads>\n");
+	printf("      Number of worker threads. Defaults to the number of processors.\n");
+	printf("\n");
+	printf("   -x, --transactions\n");
+	printf("      Follow each block line with a line for every transaction in it,\n");
+	printf("      including its txid.\n");
+	printf("\n");
+	printf("   -a, --asm\n");
+	printf("      As -x, with the assembly of every input and output script added to\n");
+	printf("      each transaction line, pushed data in hex. A script that ends in the\n");
+	printf("      middle of a push is shown as null.\n");
+	printf("\n");
+	printf("   -s, --summary\n");
+	printf("      Print only the totals at the end: blocks, transactions, bytes,\n");
+	printf("      failures, elapsed time and throughput.\n");
+	printf("\n");
+	printf("   -T\n");
+	printf("      Expect the testnet magic bytes instead of mainnet.\n");
+	printf("\n");
+	printf("See https://github.com/bartobri/bitcoin-toolkit for examples.\n");
+	printf("See 'btk help' to read about other commands.\n");
+	printf("\n");
+}
+
+void btk_help_utxo(void)
+{
+	printf("COMMAND\n");
+	printf("\n");
+	printf("   utxo - build and query an unspent output set from block files.\n");
+	printf("\n");
+	printf("SYNOPSIS\n");
+	printf("\n");
+	printf("   btk utxo build [-o <file>] [-f <blocks>] [-V] [-j <threads>] [-T] <FILE|DIRECTORY>...\n");
+	printf("   btk utxo query [-i <file>] [TXID:VOUT]...\n");
+	printf("   btk utxo stats [-i <file>]\n");
+	printf("\n");
+	printf("DESCRIPTION\n");
+	printf("\n");
+	printf("   The build subcommand indexes the blocks in bitcoin core blk*.dat files,\n");
+	printf("   finds the chain with the most work, and replays it in height order to\n");
+	printf("   build the set of unspent outputs. The set is saved to a snapshot file\n");
+	printf("   every so many blocks and at the end. If the snapshot already exists,\n");
+	printf("   the build picks up from its last block.\n");
+	printf("\n");
+	printf("   With -V, the build also verifies the scripts and signatures of every\n");
+	printf("   input it replays, on a pool of threads, under the consensus rules in\n");
+	printf("   force at each block's height. Inputs that fail are printed as lines of\n");
+	printf("   JSON, followed by a summary with the signature rate per core. Taproot\n");
+	printf("   signatures are checked in batches, and a batch that fails is checked\n");
+	printf("   again one signature at a time to find the bad ones.\n");
+	printf("\n");
+	printf("   The query subcommand maps a snapshot and looks up outpoints given as\n");
+	printf("   arguments, or read one per line from standard input, printing a line of\n");
+	printf("   JSON for each. The stats subcommand prints a summary of a snapshot.\n");
+	printf("\n");
+	printf("   Snapshots are written in host byte order and are meant to be read on\n");
+	printf("   the machine that built them.\n");
+	printf("\n");
+	printf("OPTIONS\n");
+	printf("\n");
+	printf("   -o <file>, -i <file>\n");
+	printf("      Snapshot file to write or read. Defaults to utxo.dat.\n");
+	printf("\n");
+	printf("   -f <blocks>\n");
+	printf("      Save the snapshot every <blocks> blocks. Defaults to 10000. Zero only\n");
+	printf("      saves at the end.\n");
+	printf("\n");
+	printf("   -V\n");
+	printf("      Verify every input while building.\n");
+	printf("\n");
+	printf("   -j <threads>\n");
+	printf("      Number of verification threads. Defaults to the number of CPUs.\n");
+	printf("\n");
+	printf("   -T\n");
+	printf("      Expect the testnet magic bytes instead of mainnet.\n");
+	printf("\n");
+	printf("See https://github.com/bartobri/bitcoin-toolkit for examples.\n");
+	printf("See 'btk help' to read about other commands.\n");
+	printf("\n");
+}
+
+void btk_help_index(void)
+{
+	printf("COMMAND\n");
+	printf("\n");
+	printf("   index - build and query an address index from block files.\n");
+	printf("\n");
+	printf("SYNOPSIS\n");
+	printf("\n");
+	printf("   btk index build [-o <file>] [-m <megabytes>] [-T] <FILE|DIRECTORY>...\n");
+	printf("   btk index query [-i <file>] [-u] [-T] [ADDRESS]...\n");
+	printf("\n");
+	printf("DESCRIPTION\n");
+	printf("\n");
+	printf("   The build subcommand finds the chain with the most work in bitcoin core\n");
+	printf("   blk*.dat files and records every output that pays to a P2PKH, P2SH,\n");
+	printf("   P2WPKH, P2WSH or P2TR script, along with the height it was spent at.\n");
+	printf("   The records are sorted by address with an external merge sort, so the\n");
+	printf("   build runs in bounded memory, and written to an index file.\n");
+	printf("\n");
+	printf("   The query subcommand maps the index and binary searches it for each\n");
+	printf("   address given as an argument, or read one per line from standard input.\n");
+	printf("   There is no load step, so lookups start right away. Each address prints\n");
+	printf("   a line of JSON with its balance and outputs.\n");
+	printf("\n");
+	printf("   Index files are written in host byte order and are meant to be read on\n");
+	printf("   the machine that built them.\n");
+	printf("\n");
+	printf("OPTIONS\n");
+	printf("\n");
+	printf("   -o <file>, -i <file>\n");
+	printf("      Index file to write or read. Defaults to index.dat.\n");
+	printf("\n");
+	printf("   -m <megabytes>\n");
+	printf("      Memory to use for sorting. Defaults to 256. Sorted runs that don't\n");
+	printf("      fit are spilled to temporary files next to the index.\n");
+	printf("\n");
+	printf("   -u\n");
+	printf("      Only list unspent outputs.\n");
+	printf("\n");
+	printf("   -T\n");
+	printf("      Expect the testnet magic bytes and addresses instead of mainnet.\n");
+	printf("\n");
 	printf("See https://github.com/bartobri/bitcoin-toolkit for examples.\n");
 	printf("See 'btk help' to read about other commands.\n");
 	printf("\n");
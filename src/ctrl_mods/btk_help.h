@@ -13,8 +13,13 @@ int btk_help_main(int argc, char *argv[]);
 void btk_help_commands(void);
 void btk_help_privkey(void);
 void btk_help_pubkey(void);
+void btk_help_sign(void);
+void btk_help_hd(void);
 void btk_help_vanity(void);
 void btk_help_node(void);
+void btk_help_blocks(void);
+void btk_help_utxo(void);
+void btk_help_index(void);
 void btk_help_version(void);
 
 #endif
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <glob.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include "mods/network.h"
+#include "mods/chain.h"
+#include "mods/addrindex.h"
+#include "mods/extsort.h"
+#include "mods/script.h"
+#include "mods/base58check.h"
+#include "mods/bech32.h"
+#include "mods/hex.h"
+#include "mods/error.h"
+
+#define PATH_MAXLEN              4096
+#define INDEX_DEFAULT            "index.dat"
+#define ADDRESS_MAXLEN           100
+#define P2PKH_VERSION_MAINNET    0x00
+#define P2PKH_VERSION_TESTNET    0x6f
+#define P2SH_VERSION_MAINNET     0x05
+#define P2SH_VERSION_TESTNET     0xc4
+#define HASH160_LEN              20
+
+static int btk_index_build(char **, int, char *, size_t);
+static int btk_index_query(char **, int, char *, int);
+static int btk_index_add_path(Chain, char *);
+static int btk_index_decode(unsigned char *, size_t *, char *);
+static int btk_index_print(AddrIndex, char *, int);
+
+int btk_index_main(int argc, char *argv[])
+{
+	int o;
+	int unspent = 0;
+	char *index = INDEX_DEFAULT;
+	size_t memory = EXTSORT_MEMORY_DEFAULT;
+
+	if (argc < 3)
+	{
+		error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+		error_log("Missing index subcommand.");
+		return -1;
+	}
+
+	// Options follow the subcommand, so parse from there.
+	while ((o = getopt_long(argc - 2, argv + 2, "o:i:m:uT", NULL, NULL)) != -1)
+	{
+		switch (o)
+		{
+			case 'o':
+			case 'i':
+				index = optarg;
+				break;
+			case 'm':
+				if (atol(optarg) <= 0)
+				{
+					error_log("Sort memory must be at least one megabyte.");
+					return -1;
+				}
+				memory = (size_t)atol(optarg) * 0x100000;
+				break;
+			case 'u':
+				unspent = 1;
+				break;
+			case 'T':
+				network_set_test();
+				break;
+
+			case '?':
+				error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+				if (isprint(optopt))
+				{
+					error_log("Invalid command option '-%c'.", optopt);
+				}
+				else
+				{
+					error_log("Invalid command option character '\\x%x'.", optopt);
+				}
+				return -1;
+		}
+	}
+
+	if (strcmp(argv[2], "build") == 0)
+	{
+		return btk_index_build(argv + 2 + optind, argc - 2 - optind, index, memory);
+	}
+	if (strcmp(argv[2], "query") == 0)
+	{
+		return btk_index_query(argv + 2 + optind, argc - 2 - optind, index, unspent);
+	}
+
+	error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+	error_log("'%s' is not a valid index subcommand.", argv[2]);
+	return -1;
+}
+
+/*
+ * Build the address index over the best chain found in the block files.
+ */
+static int btk_index_build(char **paths, int path_count, char *path, size_t memory)
+{
+	int i, r;
+	Chain chain;
+	AddrIndex index;
+	char *json;
+
+	if (path_count == 0)
+	{
+		error_log("See 'btk help index' to read about available argument options.");
+		error_log("Missing block file argument.");
+		return -1;
+	}
+
+	chain = malloc(chain_sizeof());
+	index = malloc(addrindex_sizeof());
+	json = malloc(1000);
+	if (chain == NULL || index == NULL || json == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = chain_new(chain);
+	if (r < 0)
+	{
+		error_log("Could not create block index.");
+		return -1;
+	}
+	for (i = 0; i < path_count; ++i)
+	{
+		r = btk_index_add_path(chain, paths[i]);
+		if (r < 0)
+		{
+			error_log("Could not index block files.");
+			return -1;
+		}
+	}
+	r = chain_build(chain);
+	if (r < 0)
+	{
+		error_log("Could not find the best chain in the block files.");
+		return -1;
+	}
+
+	r = addrindex_build(index, chain, path, memory);
+	if (r < 0)
+	{
+		error_log("Could not build address index.");
+		return -1;
+	}
+
+	addrindex_to_json(json, index);
+	printf("%s\n", json);
+
+	addrindex_clear(index);
+	chain_clear(chain);
+	free(index);
+	free(chain);
+	free(json);
+
+	return 1;
+}
+
+/*
+ * Look up addresses from the arguments or one per line on standard input.
+ */
+static int btk_index_query(char **addresses, int address_count, char *path, int unspent)
+{
+	int i, r;
+	char *line = NULL;
+	size_t len = 0;
+	ssize_t line_len;
+	AddrIndex index;
+
+	index = malloc(addrindex_sizeof());
+	if (index == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = addrindex_open(index, path);
+	if (r < 0)
+	{
+		error_log("Could not open address index.");
+		return -1;
+	}
+
+	if (address_count > 0)
+	{
+		for (i = 0; i < address_count; ++i)
+		{
+			r = btk_index_print(index, addresses[i], unspent);
+			if (r < 0)
+			{
+				return -1;
+			}
+		}
+	}
+	else
+	{
+		while ((line_len = getline(&line, &len, stdin)) != -1)
+		{
+			while (line_len > 0 && isspace((unsigned char)line[line_len - 1]))
+			{
+				line[--line_len] = '\0';
+			}
+			if (line_len == 0)
+			{
+				continue;
+			}
+			r = btk_index_print(index, line, unspent);
+			if (r < 0)
+			{
+				free(line);
+				return -1;
+			}
+		}
+		free(line);
+	}
+
+	addrindex_clear(index);
+	free(index);
+
+	return 1;
+}
+
+/*
+ * Index a single block file, or every blk*.dat file in a directory.
+ */
+static int btk_index_add_path(Chain chain, char *path)
+{
+	int r;
+	size_t i;
+	char pattern[PATH_MAXLEN];
+	struct stat st;
+	glob_t files;
+
+	if (stat(path, &st) < 0)
+	{
+		error_log("Unable to find block file or directory %s.", path);
+		return -1;
+	}
+
+	if (!S_ISDIR(st.st_mode))
+	{
+		return chain_add_file(chain, path);
+	}
+
+	if (strlen(path) + 16 >= PATH_MAXLEN)
+	{
+		error_log("Block file directory path is too long.");
+		return -1;
+	}
+	snprintf(pattern, PATH_MAXLEN, "%s/blk[0-9]*.dat", path);
+
+	r = glob(pattern, 0, NULL, &files);
+	if (r == GLOB_NOMATCH)
+	{
+		error_log("No block files found in %s.", path);
+		return -1;
+	}
+	if (r != 0)
+	{
+		error_log("Could not list block files in %s.", path);
+		return -1;
+	}
+
+	for (i = 0; i < files.gl_pathc; ++i)
+	{
+		r = chain_add_file(chain, files.gl_pathv[i]);
+		if (r < 0)
+		{
+			globfree(&files);
+			return -1;
+		}
+	}
+
+	globfree(&files);
+
+	return 1;
+}
+
+/*
+ * Turn an address into the script type and program it pays to. Returns
+ * the script type.
+ */
+static int btk_index_decode(unsigned char *program, size_t *program_len, char *address)
+{
+	int r, version;
+	unsigned char raw[ADDRESS_MAXLEN];
+
+	if (strlen(address) >= ADDRESS_MAXLEN)
+	{
+		error_log("Address is too long.");
+		return -1;
+	}
+
+	// Bech32 addresses start with their network prefix and a separator.
+	if (strncasecmp(address, "bc1", 3) == 0 || strncasecmp(address, "tb1", 3) == 0)
+	{
+		r = bech32_decode(program, &version, address);
+		if (r < 0)
+		{
+			return -1;
+		}
+		*program_len = (size_t)r;
+		if (version == 0 && r == HASH160_LEN)
+		{
+			return SCRIPT_TYPE_P2WPKH;
+		}
+		if (version == 0 && r == 32)
+		{
+			return SCRIPT_TYPE_P2WSH;
+		}
+		if (version == 1 && r == 32)
+		{
+			return SCRIPT_TYPE_P2TR;
+		}
+		error_log("Unsupported witness program version %i.", version);
+		return -1;
+	}
+
+	r = base58check_decode(raw, address);
+	if (r < 0)
+	{
+		return -1;
+	}
+	if (r != HASH160_LEN + 1)
+	{
+		error_log("Address has the wrong length.");
+		return -1;
+	}
+
+	memcpy(program, raw + 1, HASH160_LEN);
+	*program_len = HASH160_LEN;
+
+	if (raw[0] == (network_is_test() ? P2PKH_VERSION_TESTNET : P2PKH_VERSION_MAINNET))
+	{
+		return SCRIPT_TYPE_P2PKH;
+	}
+	if (raw[0] == (network_is_test() ? P2SH_VERSION_TESTNET : P2SH_VERSION_MAINNET))
+	{
+		return SCRIPT_TYPE_P2SH;
+	}
+
+	error_log("Address version byte 0x%02x is not for this network.", raw[0]);
+	return -1;
+}
+
+static int btk_index_print(AddrIndex index, char *address, int unspent)
+{
+	int type;
+	size_t j, count, program_len, outputs, unspent_count;
+	uint64_t balance, received;
+	unsigned char program[SCRIPT_PROGRAM_MAX];
+	char txid[ADDRINDEX_TXID_LEN * 2 + 1];
+	const struct AddrIndexEntry *entries;
+
+	type = btk_index_decode(program, &program_len, address);
+	if (type < 0)
+	{
+		error_log("Invalid address %s.", address);
+		return -1;
+	}
+
+	count = addrindex_find(&entries, index, type, program, program_len);
+
+	for (outputs = 0, unspent_count = 0, balance = 0, received = 0, j = 0; j < count; ++j)
+	{
+		received += entries[j].amount;
+		if (entries[j].spent == 0)
+		{
+			balance += entries[j].amount;
+			unspent_count++;
+		}
+		outputs++;
+	}
+
+	printf("{\"address\": \"%s\", \"type\": \"%s\", \"outputs\": %zu, \"unspent\": %zu, \"received\": %"PRIu64", \"balance\": %"PRIu64", \"entries\": [", address, script_get_type_name(type), outputs, unspent_count, received, balance);
+
+	for (outputs = 0, j = 0; j < count; ++j)
+	{
+		if (unspent && entries[j].spent != 0)
+		{
+			continue;
+		}
+		hex_hash_to_str(txid, entries[j].txid, ADDRINDEX_TXID_LEN);
+		printf("%s{\"txid\": \"%s\", \"vout\": %"PRIu32", \"height\": %"PRIu32", \"amount\": %"PRIu64, (outputs++ > 0) ? ", " : "", txid, entries[j].vout, entries[j].height, entries[j].amount);
+		if (entries[j].spent != 0)
+		{
+			printf(", \"spent_height\": %"PRIu32"}", entries[j].spent - 1);
+		}
+		else
+		{
+			printf("}");
+		}
+	}
+
+	printf("]}\n");
+
+	return 1;
+}
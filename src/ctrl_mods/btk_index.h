@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef BTK_INDEX_H
+#define BTK_INDEX_H 1
+
+int btk_index_main(int argc, char *argv[]);
+
+#endif
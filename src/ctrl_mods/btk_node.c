@@ -8,48 +8,95 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <getopt.h>
 #include "mods/network.h"
 #include "mods/node.h"
 #include "mods/message.h"
+#include "mods/blkfile.h"
+#include "mods/download.h"
+#include "mods/crawler.h"
+#include "mods/server.h"
+#include "mods/capture.h"
+#include "mods/block.h"
+#include "mods/txview.h"
+#include "mods/hex.h"
 #include "mods/error.h"
 #include "mods/commands/version.h"
 #include "mods/commands/verack.h"
+#include "mods/commands/inv.h"
+#include "mods/commands/ping.h"
+#include "mods/commands/addr.h"
 
 #define HOST_PORT_MAIN       8333
 #define HOST_PORT_TEST       18333
 #define TIMEOUT              10
+#define MAX_HOSTS            DOWNLOAD_PEERS_MAX
+#define MAX_REPLAY_FILES     64
+#define MAX_COMMANDS         32
+#define HASH_LEN             32
 #define MESSAGE_TYPE_VERSION 1
+#define MESSAGE_TYPE_BLOCKS  2
+#define MESSAGE_TYPE_CRAWL   3
+#define MESSAGE_TYPE_SERVE   4
+#define MESSAGE_TYPE_REPLAY  5
+
+#define TYPE_SET(x)          if (message_type == MESSAGE_TYPE_VERSION) { message_type = x; } else { error_log("Only specify one node mode."); return -1; }
+
+static struct option long_options[] = {
+	{"download", no_argument, NULL, 'D'},
+	{"crawl",    no_argument, NULL, 'C'},
+	{"serve",    no_argument, NULL, 'S'},
+	{"capture",  required_argument, NULL, 'L'},
+	{"replay",   required_argument, NULL, 'P'},
+	{NULL, 0, NULL, 0}
+};
+
+static int btk_node_version(char *, int);
+static int btk_node_download(char **, int, int, char *, int, int);
+static int btk_node_crawl(char **, int, int, size_t, int, int);
+static int btk_node_serve(char **, int, int, int, int);
+static int btk_node_replay(char *);
+static int btk_node_replay_parse(Message);
+static int btk_node_read_hashes(unsigned char **);
+
+static Capture capture = NULL;
 
 int btk_node_main(int argc, char *argv[])
 {
-	int o, i, r;
-	char* host = NULL;
+	int o, r;
+	char *hosts[MAX_HOSTS];
+	int host_count = 0;
 	int port = HOST_PORT_MAIN;
 	int message_type = MESSAGE_TYPE_VERSION;
-
-	Node node;
-	unsigned char *node_data, *node_data_walk;
-	size_t node_data_len;
-
-	Message message;
-	unsigned char *message_raw;
-	size_t message_raw_len;
-	unsigned char *payload = NULL;
-	size_t payload_len;
-
-	Version version = NULL;
-	unsigned char *version_string;
-	size_t version_string_len;
-	char *json = NULL;
-
-
-	while ((o = getopt(argc, argv, "h:p:T")) != -1)
+	char *output_dir = ".";
+	int window = DOWNLOAD_WINDOW_DEFAULT;
+	int stall = DOWNLOAD_STALL_DEFAULT;
+	long budget = CRAWLER_BUDGET_DEFAULT;
+	int concurrency = CRAWLER_CONCURRENCY_DEFAULT;
+	int timeout = CRAWLER_TIMEOUT_DEFAULT;
+	char *replay_files[MAX_REPLAY_FILES];
+	int replay_count = 0;
+	int rate = 0;
+	int max_connections = 0;
+	char *capture_file = NULL;
+	char *replay_file = NULL;
+
+	while ((o = getopt_long(argc, argv, "h:p:TDo:w:s:Cn:j:t:Sr:R:c:L:P:", long_options, NULL)) != -1)
 	{
 		switch (o)
 		{
 			case 'h':
-				host = optarg;
+				if (host_count >= MAX_HOSTS)
+				{
+					error_log("Can not specify more than %i hosts.", MAX_HOSTS);
+					return -1;
+				}
+				hosts[host_count++] = optarg;
 				break;
 			case 'p':
 				port = atoi(optarg);
@@ -58,6 +105,63 @@ int btk_node_main(int argc, char *argv[])
 				port = HOST_PORT_TEST;
 				network_set_test();
 				break;
+
+			// Block download
+			case 'D':
+				TYPE_SET(MESSAGE_TYPE_BLOCKS);
+				break;
+			case 'o':
+				output_dir = optarg;
+				break;
+			case 'w':
+				window = atoi(optarg);
+				break;
+			case 's':
+				stall = atoi(optarg);
+				break;
+
+			// Network crawl
+			case 'C':
+				TYPE_SET(MESSAGE_TYPE_CRAWL);
+				break;
+			case 'n':
+				budget = atol(optarg);
+				break;
+			case 'j':
+				concurrency = atoi(optarg);
+				break;
+			case 't':
+				timeout = atoi(optarg);
+				break;
+
+			// Loopback mock peer
+			case 'S':
+				TYPE_SET(MESSAGE_TYPE_SERVE);
+				break;
+			case 'r':
+				if (replay_count >= MAX_REPLAY_FILES)
+				{
+					error_log("Can not specify more than %i replay files.", MAX_REPLAY_FILES);
+					return -1;
+				}
+				replay_files[replay_count++] = optarg;
+				break;
+			case 'R':
+				rate = atoi(optarg);
+				break;
+			case 'c':
+				max_connections = atoi(optarg);
+				break;
+
+			// Traffic capture and replay
+			case 'L':
+				capture_file = optarg;
+				break;
+			case 'P':
+				TYPE_SET(MESSAGE_TYPE_REPLAY);
+				replay_file = optarg;
+				break;
+
 			case '?':
 				error_log("See 'btk help %s' to read about available argument options.", argv[1]);
 				if (isprint(optopt))
@@ -72,198 +176,649 @@ int btk_node_main(int argc, char *argv[])
 		}
 	}
 
-	if (host == NULL)
+	if (host_count == 0 && message_type != MESSAGE_TYPE_SERVE && message_type != MESSAGE_TYPE_REPLAY)
 	{
 		error_log("See 'btk help %s' to read about available argument options.", argv[1]);
 		error_log("Missing host argument.");
 		return -1;
 	}
 
+	if (capture_file != NULL)
+	{
+		capture = malloc(capture_sizeof());
+		if (capture == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+
+		r = capture_open(capture, capture_file);
+		if (r < 0)
+		{
+			error_log("Could not open capture file.");
+			return -1;
+		}
+	}
+
+	r = 1;
+
 	switch (message_type)
 	{
 		case MESSAGE_TYPE_VERSION:
-			node = malloc(node_sizeof());
-			if (node == NULL)
+			r = btk_node_version(hosts[0], port);
+			break;
+		case MESSAGE_TYPE_BLOCKS:
+			r = btk_node_download(hosts, host_count, port, output_dir, window, stall);
+			break;
+		case MESSAGE_TYPE_CRAWL:
+			if (budget < 1)
 			{
-				error_log("Memory allocation error.");
-				return -1;
+				error_log("Crawl budget must be at least one peer.");
+				r = -1;
+				break;
 			}
+			r = btk_node_crawl(hosts, host_count, port, (size_t)budget, concurrency, timeout);
+			break;
+		case MESSAGE_TYPE_SERVE:
+			r = btk_node_serve(replay_files, replay_count, port, rate, max_connections);
+			break;
+		case MESSAGE_TYPE_REPLAY:
+			r = btk_node_replay(replay_file);
+			break;
+	}
 
-			r = node_connect(node, host, port);
-			if (r < 0)
-			{
-				error_log("Could not connect to host.");
-				return -1;
-			}
+	if (capture != NULL)
+	{
+		capture_close(capture);
+		free(capture);
+		capture = NULL;
+	}
 
-			version_string = malloc(version_sizeof());
-			if (version_string == NULL)
-			{
-				error_log("Memory allocation error.");
-				return -1;
-			}
+	return r;
+}
 
-			r = version_new_serialize(version_string);
-			if (r < 0)
-			{
-				error_log("Could not serialize version data.");
-				return -1;
-			}
-			version_string_len = r;
+static int btk_node_version(char *host, int port)
+{
+	int r;
+	Node node;
+	Version version;
+	char *json;
 
-			message = malloc(message_sizeof());
-			if (message == NULL)
-			{
-				error_log("Memory allocation error.");
-				return -1;
-			}
+	node = malloc(node_sizeof());
+	if (node == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
 
-			r = message_new(message, VERSION_COMMAND, version_string, version_string_len);
-			if (r < 0)
-			{
-				error_log("Could not create a new message.");
-				return -1;
-			}
-			free(version_string);
+	r = node_connect(node, host, port);
+	if (r < 0)
+	{
+		error_log("Could not connect to host.");
+		return -1;
+	}
 
-			message_raw = malloc(message_sizeof());
-			if (message_raw == NULL)
-			{
-				error_log("Memory allocation error.");
-				return -1;
-			}
+	node_set_capture(node, capture);
 
-			r = message_serialize(message_raw, &message_raw_len, message);
-			if (r < 0)
-			{
-				error_log("Could not serialize message data.");
-				return -1;
-			}
+	version = malloc(version_sizeof());
+	if (version == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = node_handshake(node, version, TIMEOUT);
+	if (r < 0)
+	{
+		error_log("Did not receive response from host before timeout.");
+		return -1;
+	}
+	node_disconnect(node);
+
+	json = malloc(1000);
+	if (json == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	version_to_json(json, version);
+
+	printf("%s\n", json);
+
+	free(version);
+	free(json);
+	free(node);
+
+	return 1;
+}
+
+static int btk_node_download(char **hosts, int host_count, int port, char *output_dir, int window, int stall)
+{
+	int i, r, connected;
+	size_t hash_count;
+	unsigned char *hashes;
+	Node nodes[MAX_HOSTS];
+	BlkFile blkfile;
+	Download download;
+	char *json;
+
+	r = btk_node_read_hashes(&hashes);
+	if (r < 0)
+	{
+		error_log("Could not read block hashes from input.");
+		return -1;
+	}
+	hash_count = (size_t)r;
 
-			r = node_write(node, message_raw, message_raw_len);
+	blkfile = malloc(blkfile_sizeof());
+	download = malloc(download_sizeof());
+	if (blkfile == NULL || download == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = blkfile_open(blkfile, output_dir);
+	if (r < 0)
+	{
+		error_log("Could not open block file for writing.");
+		return -1;
+	}
+
+	r = download_new(download, hashes, hash_count, blkfile, window, stall);
+	if (r < 0)
+	{
+		error_log("Could not set up block download.");
+		return -1;
+	}
+
+	for (connected = 0, i = 0; i < host_count; ++i)
+	{
+		nodes[i] = malloc(node_sizeof());
+		if (nodes[i] == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+
+		// One unreachable host shouldn't sink the whole download
+		// as long as somebody else is serving blocks.
+		r = node_connect(nodes[i], hosts[i], port);
+		if (r >= 0)
+		{
+			node_set_capture(nodes[i], capture);
+			r = node_handshake(nodes[i], NULL, TIMEOUT);
 			if (r < 0)
 			{
-				error_log("Could not send message to host.");
-				return -1;
+				node_disconnect(nodes[i]);
 			}
-			free(message);
-			free(message_raw);
+		}
+		if (r < 0)
+		{
+			fprintf(stderr, "Skipping host %s: %s\n", hosts[i], error_get());
+			error_clear();
+			free(nodes[i]);
+			nodes[i] = NULL;
+			continue;
+		}
 
-			for (i = 0; i < TIMEOUT; ++i)
-			{
-				node_data = NULL;
-				node_data_len = 0;
-				r = node_read(node, &node_data);
-				if (r < 0)
-				{
-					error_log("Could not read message from host.");
-					return -1;
-				}
+		r = download_add_peer(download, nodes[i]);
+		if (r < 0)
+		{
+			error_log("Could not add peer to download.");
+			return -1;
+		}
+		connected++;
+	}
 
-				if (r > 0)
-				{
-					node_data_len = r;
-					break;
-				}
+	if (connected == 0)
+	{
+		error_log("Could not connect to any host.");
+		return -1;
+	}
 
-				sleep(1);
-			}
-			node_disconnect(node);
+	r = download_run(download);
+	if (r < 0)
+	{
+		error_log("Block download failed.");
+		return -1;
+	}
 
-			node_data_walk = node_data;
-			message = NULL;
+	json = malloc(1000 + (300 * host_count));
+	if (json == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
 
-			while (node_data_len > 0)
-			{
-				message = malloc(message_sizeof());
-				if (message == NULL)
-				{
-					error_log("Memory allocation error.");
-					return -1;
-				}
+	download_to_json(json, download);
 
-				r = message_deserialize(message, node_data_walk, node_data_len);
-				if (r < 0)
-				{
-					error_log("Could not deserialize message from host.");
-					return -1;
-				}
-				node_data_len -= r;
-				node_data_walk += r;
+	printf("%s\n", json);
 
-				r = message_is_valid(message);
-				if (r < 0)
-				{
-					error_log("Could not validate message from host.");
-					return -1;
-				}
-				if (r == 0)
-				{
-					error_log("The message received from host contains an invalid checksum.");
-					return -1;
-				}
+	blkfile_close(blkfile);
+	download_clear(download);
 
-				r = message_cmp_command(message, VERSION_COMMAND);
-				if (r == 0)
-				{
-					break;
-				}
-				else
-				{
-					free(message);
-					message = NULL;
-				}
-			}
-			
-			if (message == NULL)
-			{
-				printf("Did not receive response from host before timeout.\n");
-				return 1;
-			}
-			
-			payload = malloc(message_get_payload_len(message));
-			if (payload == NULL)
-			{
-				error_log("Memory allocation error.");
-				return -1;
-			}
+	// Peers dropped during the download are already disconnected, and
+	// disconnecting them again does nothing.
+	for (i = 0; i < host_count; ++i)
+	{
+		if (nodes[i] != NULL)
+		{
+			node_disconnect(nodes[i]);
+			free(nodes[i]);
+		}
+	}
+	free(json);
+	free(download);
+	free(blkfile);
+	free(hashes);
+
+	return 1;
+}
+
+static int btk_node_crawl(char **hosts, int host_count, int port, size_t budget, int concurrency, int timeout)
+{
+	int i, r;
+	size_t j, count;
+	Crawler crawler;
+	char *json;
+
+	crawler = malloc(crawler_sizeof());
+	if (crawler == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = crawler_new(crawler, budget, concurrency, timeout);
+	if (r < 0)
+	{
+		error_log("Could not set up network crawl.");
+		return -1;
+	}
+
+	for (i = 0; i < host_count; ++i)
+	{
+		if (crawler_add_seed(crawler, hosts[i], port) < 0)
+		{
+			fprintf(stderr, "Skipping seed %s: %s\n", hosts[i], error_get());
+			error_clear();
+		}
+	}
+
+	crawler_set_capture(crawler, capture);
+
+	r = crawler_run(crawler);
+	if (r < 0)
+	{
+		error_log("Network crawl failed.");
+		return -1;
+	}
+
+	json = malloc(5000);
+	if (json == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	// Peers are printed one at a time so output size doesn't depend on
+	// how big the crawl got.
+	crawler_to_json(json, crawler);
+	printf("{\n%s  \"peers\": [\n", json);
+
+	count = crawler_get_peer_count(crawler);
+	for (j = 0; j < count; ++j)
+	{
+		crawler_peer_to_json(json, crawler, j);
+		printf("%s%s\n", json, (j + 1 < count) ? "," : "");
+	}
+
+	printf("  ]\n}\n");
+
+	crawler_clear(crawler);
+
+	free(json);
+	free(crawler);
+
+	return 1;
+}
+
+static int btk_node_serve(char **replay_files, int replay_count, int port, int rate, int max_connections)
+{
+	int i, r;
+	Server server;
+	char json[1000];
+
+	server = malloc(server_sizeof());
+	if (server == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = server_new(server, port, rate);
+	if (r < 0)
+	{
+		error_log("Could not start local peer.");
+		return -1;
+	}
+
+	for (i = 0; i < replay_count; ++i)
+	{
+		r = server_load(server, replay_files[i]);
+		if (r < 0)
+		{
+			error_log("Could not load replay file.");
+			return -1;
+		}
+	}
+
+	server_set_capture(server, capture);
+
+	r = server_run(server, max_connections);
+	if (r < 0)
+	{
+		error_log("Local peer failed.");
+		return -1;
+	}
+
+	server_to_json(json, server);
+
+	printf("%s\n", json);
+
+	server_clear(server);
+
+	free(server);
+
+	return 1;
+}
+
+/*
+ * Push every message in a capture through the message and command
+ * parsers as fast as possible and report the throughput. Nothing here
+ * touches the network, so the numbers are the parsers' alone.
+ */
+static int btk_node_replay(char *path)
+{
+	int r;
+	size_t i, command_count;
+	uint64_t messages, bytes, failures, counts[MAX_COMMANDS];
+	char commands[MAX_COMMANDS][MESSAGE_COMMAND_MAXLEN + 1];
+	char command[MESSAGE_COMMAND_MAXLEN + 1];
+	double elapsed;
+	struct timespec start, finish;
+	struct CaptureRecord record;
+	Capture replay;
+	Message message;
+
+	replay = malloc(capture_sizeof());
+	message = malloc(message_sizeof());
+	if (replay == NULL || message == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = capture_load(replay, path);
+	if (r < 0)
+	{
+		error_log("Could not load capture file.");
+		return -1;
+	}
+
+	messages = bytes = failures = 0;
+	command_count = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while ((r = capture_next(&record, replay)) > 0)
+	{
+		messages++;
+		bytes += record.frame_len;
+
+		r = message_deserialize(message, record.frame, record.frame_len);
+		if (r < 0)
+		{
+			error_clear();
+			failures++;
+			continue;
+		}
+
+		if (btk_node_replay_parse(message) < 0)
+		{
+			error_clear();
+			failures++;
+		}
+
+		message_get_command(command, message);
+		for (i = 0; i < command_count && strcmp(commands[i], command) != 0; ++i)
+			;
+		if (i == command_count && command_count < MAX_COMMANDS)
+		{
+			strcpy(commands[command_count], command);
+			counts[command_count++] = 0;
+		}
+		if (i < command_count)
+		{
+			counts[i]++;
+		}
+
+		message_clear(message);
+	}
+	if (r < 0)
+	{
+		error_log("Capture file is corrupt.");
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+
+	elapsed = (double)(finish.tv_sec - start.tv_sec) + ((double)(finish.tv_nsec - start.tv_nsec) / 1000000000.0);
 
-			payload_len = message_get_payload(payload, message);
-			
-			version = malloc(version_sizeof());
-			if (version == NULL)
+	printf("{\n");
+	printf("  \"messages\": %"PRIu64",\n", messages);
+	printf("  \"bytes\": %"PRIu64",\n", bytes);
+	printf("  \"failures\": %"PRIu64",\n", failures);
+	printf("  \"milliseconds\": %.3f,\n", elapsed * 1000.0);
+	printf("  \"messages_per_second\": %.2f,\n", elapsed > 0 ? (double)messages / elapsed : 0.0);
+	printf("  \"mb_per_second\": %.2f,\n", elapsed > 0 ? ((double)bytes / 1048576.0) / elapsed : 0.0);
+	printf("  \"commands\": {\n");
+	for (i = 0; i < command_count; ++i)
+	{
+		// Command names come off the wire, so don't trust them in JSON
+		for (r = 0; commands[i][r] != '\0'; ++r)
+		{
+			if (!isprint(commands[i][r]) || commands[i][r] == '"' || commands[i][r] == '\\')
 			{
-				error_log("Memory allocation error.");
-				return -1;
+				commands[i][r] = '?';
 			}
+		}
+		printf("    \"%s\": %"PRIu64"%s\n", commands[i], counts[i], (i + 1 < command_count) ? "," : "");
+	}
+	printf("  }\n");
+	printf("}\n");
+
+	capture_close(replay);
+	free(replay);
+	free(message);
+
+	return 1;
+}
+
+/*
+ * Run a message's payload through the parser for its command, if there is
+ * one. Parsed objects are kept between calls so the replay loop measures
+ * parsing rather than allocation.
+ */
+static int btk_node_replay_parse(Message message)
+{
+	static Version version = NULL;
+	static Inv inv = NULL;
+	static Addr addr = NULL;
+	static Ping ping = NULL;
+	static TxView tx = NULL;
+	int r;
+	uint64_t i, tx_count;
+	unsigned char *payload;
+	size_t payload_len;
+	unsigned char hash[BLOCK_HASH_LEN];
+
+	if (version == NULL)
+	{
+		version = malloc(version_sizeof());
+		inv = malloc(inv_sizeof());
+		addr = malloc(addr_sizeof());
+		ping = malloc(ping_sizeof());
+		tx = malloc(txview_sizeof());
+		if (version == NULL || inv == NULL || addr == NULL || ping == NULL || tx == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		txview_new(tx);
+	}
+
+	if (message_is_valid(message) <= 0)
+	{
+		error_log("Message failed validation.");
+		return -1;
+	}
+
+	payload = message_get_payload_ptr(message);
+	payload_len = message_get_payload_len(message);
+
+	if (message_cmp_command(message, VERSION_COMMAND) == 0)
+	{
+		return version_deserialize(version, payload, payload_len);
+	}
+	if (message_cmp_command(message, INV_COMMAND) == 0 || message_cmp_command(message, GETDATA_COMMAND) == 0 || message_cmp_command(message, NOTFOUND_COMMAND) == 0)
+	{
+		return inv_deserialize(inv, payload, payload_len);
+	}
+	if (message_cmp_command(message, ADDR_COMMAND) == 0)
+	{
+		return addr_deserialize(addr, payload, payload_len, 0);
+	}
+	if (message_cmp_command(message, ADDRV2_COMMAND) == 0)
+	{
+		return addr_deserialize(addr, payload, payload_len, 1);
+	}
+	if (message_cmp_command(message, PING_COMMAND) == 0 || message_cmp_command(message, PONG_COMMAND) == 0)
+	{
+		return ping_deserialize(ping, payload, payload_len);
+	}
+	if (message_cmp_command(message, BLOCK_COMMAND) == 0)
+	{
+		if (block_get_hash(hash, payload, payload_len) < 0)
+		{
+			return -1;
+		}
 
-			r = version_deserialize(version, payload, payload_len);
+		r = block_get_tx_start(&tx_count, payload, payload_len);
+		if (r < 0)
+		{
+			return -1;
+		}
+		payload += r;
+		payload_len -= r;
+
+		for (i = 0; i < tx_count; ++i)
+		{
+			r = txview_parse(tx, payload, payload_len);
 			if (r < 0)
 			{
-				error_log("Could not deserialize host response.");
 				return -1;
 			}
+			payload += r;
+			payload_len -= r;
+		}
+		return 1;
+	}
+	if (message_cmp_command(message, TXVIEW_COMMAND) == 0)
+	{
+		return txview_parse(tx, payload, payload_len);
+	}
+
+	return 1;
+}
+
+/*
+ * Read block hashes from standard input, one per line, in the usual
+ * big endian display format. They're stored in internal byte order.
+ */
+static int btk_node_read_hashes(unsigned char **output)
+{
+	int r, i;
+	size_t count, cap, len;
+	ssize_t line_len;
+	char *line = NULL;
+	unsigned char raw[HASH_LEN];
+	unsigned char *hashes, *tmp;
+
+	count = 0;
+	cap = 1024;
+	len = 0;
+
+	hashes = malloc(cap * HASH_LEN);
+	if (hashes == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
 
-			json = malloc(1000);
-			if (json == NULL)
+	while ((line_len = getline(&line, &len, stdin)) != -1)
+	{
+		while (line_len > 0 && isspace(line[line_len - 1]))
+		{
+			line[--line_len] = '\0';
+		}
+		if (line_len == 0)
+		{
+			continue;
+		}
+		if (line_len != HASH_LEN * 2)
+		{
+			error_log("Block hash must be %i hex characters: %s", HASH_LEN * 2, line);
+			return -1;
+		}
+
+		r = hex_str_to_raw(raw, line);
+		if (r < 0)
+		{
+			error_log("Could not parse block hash: %s", line);
+			return -1;
+		}
+
+		if (count == cap)
+		{
+			cap *= 2;
+			tmp = realloc(hashes, cap * HASH_LEN);
+			if (tmp == NULL)
 			{
 				error_log("Memory allocation error.");
 				return -1;
 			}
+			hashes = tmp;
+		}
 
-			version_to_json(json, version);
-
-			printf("%s\n", json);
+		for (i = 0; i < HASH_LEN; ++i)
+		{
+			hashes[(count * HASH_LEN) + i] = raw[HASH_LEN - 1 - i];
+		}
+		count++;
+	}
 
-			free(version);
-			free(message);
-			free(payload);
-			free(json);
-			free(node);
-			free(node_data);
+	free(line);
 
-			break;
+	if (count == 0)
+	{
+		error_log("No block hashes provided.");
+		return -1;
 	}
 
-	return 1;
-}
\ No newline at end of file
+	*output = hashes;
+
+	return (int)count;
+}
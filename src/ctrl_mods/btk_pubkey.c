@@ -13,6 +13,7 @@
 #include "mods/privkey.h"
 #include "mods/network.h"
 #include "mods/pubkey.h"
+#include "mods/schnorr.h"
 #include "mods/input.h"
 #include "mods/error.h"
 
@@ -23,10 +24,13 @@
 #define INPUT_DEC               5
 #define INPUT_BLOB              6
 #define INPUT_GUESS             7
+#define INPUT_PUBKEY_HEX        8
+#define INPUT_PUBKEY_RAW        9
 #define OUTPUT_ADDRESS          1
 #define OUTPUT_BECH32_ADDRESS   2
 #define OUTPUT_HEX              3
 #define OUTPUT_RAW              4
+#define OUTPUT_TAPROOT_ADDRESS  5
 #define OUTPUT_COMPRESS         1
 #define OUTPUT_UNCOMPRESS       2
 #define OUTPUT_MAINNET          1
@@ -34,16 +38,29 @@
 #define TRUE                    1
 #define FALSE                   0
 #define OUTPUT_BUFFER           150
+#define PUBKEY_RAW_XONLY        PUBKEY_COMPRESSED_LENGTH
+#define PUBKEY_RAW_COMPRESSED   (PUBKEY_COMPRESSED_LENGTH + 1)
+#define PUBKEY_RAW_UNCOMPRESSED (PUBKEY_UNCOMPRESSED_LENGTH + 1)
+#define READ_BUFFER             4096
 
 #define INPUT_SET(x)            if (input_format == FALSE) { input_format = x; } else { error_log("Cannot use multiple input format flags."); return -1; }
 #define OUTPUT_SET(x)           if (output_format == FALSE) { output_format = x; } else { error_log("Cannot use multiple output format flags."); return -1; }
 #define COMPRESSION_SET(x)      if (output_compression == FALSE) { output_compression = x; } else { error_log("Only specify one compression flag."); return -1; }
 
+static int btk_pubkey_from_pubkeys(int, int, int, int);
+static int btk_pubkey_print_key(PubKey, int, int, int, Schnorr);
+static int btk_pubkey_print(PubKey, int, Schnorr);
+static int btk_pubkey_read_all(unsigned char **, size_t *);
+static void btk_pubkey_set_network(int);
+static int btk_pubkey_schnorr_new(Schnorr *, int);
+static void btk_pubkey_schnorr_clear(Schnorr);
+
 int btk_pubkey_main(int argc, char *argv[])
 {
 	int o, r;
 	PubKey key = NULL;
 	PrivKey priv = NULL;
+	Schnorr sc = NULL;
 	size_t i;
 	unsigned char *input_uc;
 	char *input_sc;
@@ -58,7 +75,7 @@ int btk_pubkey_main(int argc, char *argv[])
 	int output_newline     = TRUE;
 	int output_network     = FALSE;
 	
-	while ((o = getopt(argc, argv, "whrsdbABHRCUPNTM")) != -1)
+	while ((o = getopt(argc, argv, "whrsdbpqABXHRCUPNTM")) != -1)
 	{
 		switch (o)
 		{
@@ -81,6 +98,12 @@ int btk_pubkey_main(int argc, char *argv[])
 			case 'b':
 				INPUT_SET(INPUT_BLOB);
 				break;
+			case 'p':
+				INPUT_SET(INPUT_PUBKEY_HEX);
+				break;
+			case 'q':
+				INPUT_SET(INPUT_PUBKEY_RAW);
+				break;
 
 			// Output format
 			case 'A':
@@ -89,6 +112,9 @@ int btk_pubkey_main(int argc, char *argv[])
 			case 'B':
 				OUTPUT_SET(OUTPUT_BECH32_ADDRESS);
 				break;
+			case 'X':
+				OUTPUT_SET(OUTPUT_TAPROOT_ADDRESS);
+				break;
 			case 'H':
 				OUTPUT_SET(OUTPUT_HEX);
 				break;
@@ -146,6 +172,19 @@ int btk_pubkey_main(int argc, char *argv[])
 		output_format = OUTPUT_ADDRESS;
 	}
 
+	// Public keys go straight to their output, with no private key and
+	// no multiplication.
+	if (input_format == INPUT_PUBKEY_HEX || input_format == INPUT_PUBKEY_RAW)
+	{
+		if (output_privkey)
+		{
+			error_log("Cannot print a private key for public key input.");
+			return -1;
+		}
+		btk_pubkey_set_network(output_network);
+		return btk_pubkey_from_pubkeys(input_format, output_format, output_compression, output_newline);
+	}
+
 	priv = malloc(privkey_sizeof());
 	if (priv == NULL)
 	{
@@ -314,17 +353,8 @@ int btk_pubkey_main(int argc, char *argv[])
 		return -1;
 	}
 
-	switch (output_network)
-	{
-		case FALSE:
-			break;
-		case OUTPUT_MAINNET:
-			network_set_main();
-			break;
-		case OUTPUT_TESTNET:
-			network_set_test();
-			break;
-	}
+	// After reading the key, since WIF input sets the network too.
+	btk_pubkey_set_network(output_network);
 
 	memset(output, 0, OUTPUT_BUFFER);
 	memset(uc_output, 0, OUTPUT_BUFFER);
@@ -367,6 +397,191 @@ int btk_pubkey_main(int argc, char *argv[])
 		}
 	}
 
+	if (btk_pubkey_schnorr_new(&sc, output_format) < 0)
+	{
+		return -1;
+	}
+	r = btk_pubkey_print(key, output_format, sc);
+	btk_pubkey_schnorr_clear(sc);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	switch (output_newline)
+	{
+		case TRUE:
+			printf("\n");
+			break;
+	}
+
+	free(priv);
+	free(key);
+
+	return 1;
+}
+
+/*
+ * Public key input, in hex one key per line or raw. Raw input is one
+ * x-only or uncompressed key, or any number of compressed keys back to
+ * back, read as a batch. Each key prints on its own line.
+ */
+static int btk_pubkey_from_pubkeys(int input_format, int output_format, int output_compression, int output_newline)
+{
+	int r;
+	size_t i, count, input_len, line_cap, line_num;
+	ssize_t len;
+	char *line;
+	unsigned char *input;
+	PubKey *keys;
+	Schnorr sc;
+
+	keys = NULL;
+	input = NULL;
+	count = 0;
+	line = NULL;
+	line_cap = 0;
+
+	if (btk_pubkey_schnorr_new(&sc, output_format) < 0)
+	{
+		return -1;
+	}
+
+	if (input_format == INPUT_PUBKEY_RAW)
+	{
+		if (btk_pubkey_read_all(&input, &input_len) < 0)
+		{
+			btk_pubkey_schnorr_clear(sc);
+			return -1;
+		}
+		if (input_len == PUBKEY_RAW_XONLY || input_len == PUBKEY_RAW_UNCOMPRESSED || (input_len > 0 && input_len % PUBKEY_RAW_COMPRESSED == 0))
+		{
+			count = (input_len % PUBKEY_RAW_COMPRESSED == 0) ? input_len / PUBKEY_RAW_COMPRESSED : 1;
+		}
+		else
+		{
+			error_log("Raw input must be a %i or %i byte public key or any number of %i byte public keys.", PUBKEY_RAW_XONLY, PUBKEY_RAW_UNCOMPRESSED, PUBKEY_RAW_COMPRESSED);
+			free(input);
+			btk_pubkey_schnorr_clear(sc);
+			return -1;
+		}
+
+		keys = malloc(count * sizeof(*keys));
+		if (keys == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		for (i = 0; i < count; ++i)
+		{
+			keys[i] = malloc(pubkey_sizeof());
+			if (keys[i] == NULL)
+			{
+				error_log("Memory allocation error.");
+				return -1;
+			}
+		}
+
+		if (input_len % PUBKEY_RAW_COMPRESSED != 0)
+		{
+			r = pubkey_from_raw(keys[0], input, input_len);
+		}
+		else
+		{
+			r = pubkey_from_raw_batch(keys, input, count);
+		}
+		free(input);
+
+		for (i = 0; r > 0 && i < count; ++i)
+		{
+			r = btk_pubkey_print_key(keys[i], output_format, output_compression, output_newline, sc);
+		}
+
+		for (i = 0; i < count; ++i)
+		{
+			free(keys[i]);
+		}
+		free(keys);
+	}
+	else
+	{
+		keys = malloc(sizeof(*keys));
+		if (keys == NULL || (keys[0] = malloc(pubkey_sizeof())) == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+
+		r = 1;
+		line_num = 0;
+		while (r > 0 && (len = getline(&line, &line_cap, stdin)) >= 0)
+		{
+			line_num++;
+			while (len > 0 && isspace((unsigned char)line[len - 1]))
+			{
+				line[--len] = '\0';
+			}
+			if (len == 0)
+			{
+				continue;
+			}
+			r = pubkey_from_hex(keys[0], line);
+			if (r < 0)
+			{
+				error_log("Line %zu is not a public key in hex.", line_num);
+				break;
+			}
+			r = btk_pubkey_print_key(keys[0], output_format, output_compression, output_newline, sc);
+		}
+
+		free(line);
+		free(keys[0]);
+		free(keys);
+	}
+
+	btk_pubkey_schnorr_clear(sc);
+
+	return r;
+}
+
+static int btk_pubkey_print_key(PubKey key, int output_format, int output_compression, int output_newline, Schnorr sc)
+{
+	int r;
+
+	r = 1;
+	switch (output_compression)
+	{
+		case OUTPUT_COMPRESS:
+			r = pubkey_compress(key);
+			break;
+		case OUTPUT_UNCOMPRESS:
+			r = pubkey_uncompress(key);
+			break;
+	}
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	if (btk_pubkey_print(key, output_format, sc) < 0)
+	{
+		return -1;
+	}
+	if (output_newline)
+	{
+		printf("\n");
+	}
+
+	return 1;
+}
+
+static int btk_pubkey_print(PubKey key, int output_format, Schnorr sc)
+{
+	int r;
+	size_t i;
+	char output[OUTPUT_BUFFER];
+	unsigned char uc_output[OUTPUT_BUFFER];
+
 	memset(output, 0, OUTPUT_BUFFER);
 	memset(uc_output, 0, OUTPUT_BUFFER);
 
@@ -390,6 +605,15 @@ int btk_pubkey_main(int argc, char *argv[])
 			}
 			printf("%s", output);
 			break;
+		case OUTPUT_TAPROOT_ADDRESS:
+			r = pubkey_to_taproot_address(output, key, sc);
+			if (r < 0)
+			{
+				error_log("Could not calculate taproot public key address.");
+				return -1;
+			}
+			printf("%s", output);
+			break;
 		case OUTPUT_HEX:
 			r = pubkey_to_hex(output, key);
 			if (r < 0)
@@ -413,15 +637,102 @@ int btk_pubkey_main(int argc, char *argv[])
 			break;
 	}
 
-	switch (output_newline)
+	return 1;
+}
+
+/*
+ * All of standard input, however long. input_get() only takes what has
+ * arrived so far.
+ */
+static int btk_pubkey_read_all(unsigned char **dest, size_t *len)
+{
+	size_t cap, n;
+	unsigned char *buffer, *grown;
+
+	if (isatty(STDIN_FILENO))
 	{
-		case TRUE:
-			printf("\n");
+		error_log("Input data from a piped or redirected source is required.");
+		return -1;
+	}
+
+	cap = READ_BUFFER;
+	buffer = malloc(cap);
+	if (buffer == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	*len = 0;
+	while ((n = fread(buffer + *len, 1, cap - *len, stdin)) > 0)
+	{
+		*len += n;
+		if (*len == cap)
+		{
+			cap *= 2;
+			grown = realloc(buffer, cap);
+			if (grown == NULL)
+			{
+				error_log("Memory allocation error.");
+				free(buffer);
+				return -1;
+			}
+			buffer = grown;
+		}
+	}
+
+	*dest = buffer;
+
+	return 1;
+}
+
+static void btk_pubkey_set_network(int output_network)
+{
+	switch (output_network)
+	{
+		case FALSE:
+			break;
+		case OUTPUT_MAINNET:
+			network_set_main();
+			break;
+		case OUTPUT_TESTNET:
+			network_set_test();
 			break;
 	}
+}
 
-	free(priv);
-	free(key);
+/*
+ * The taproot tweak needs a Schnorr context, made once for however many
+ * keys get printed. *sc is left NULL for other outputs.
+ */
+static int btk_pubkey_schnorr_new(Schnorr *sc, int output_format)
+{
+	*sc = NULL;
+	if (output_format != OUTPUT_TAPROOT_ADDRESS)
+	{
+		return 1;
+	}
+
+	*sc = malloc(schnorr_sizeof());
+	if (*sc == NULL)
+	{
+		error_log("Memory allocation error");
+		return -1;
+	}
+	if (schnorr_new(*sc) < 0)
+	{
+		error_log("Could not set up taproot key tweaking.");
+		return -1;
+	}
 
 	return 1;
 }
+
+static void btk_pubkey_schnorr_clear(Schnorr sc)
+{
+	if (sc != NULL)
+	{
+		schnorr_clear(sc);
+		free(sc);
+	}
+}
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include "mods/privkey.h"
+#include "mods/signer.h"
+#include "mods/threadpool.h"
+#include "mods/curve.h"
+#include "mods/ctmul.h"
+#include "mods/random.h"
+#include "mods/hex.h"
+#include "mods/error.h"
+
+#define KEY_MAXLEN   200
+#define HASH_LEN     32
+#define BENCH_BATCH  256
+
+static int btk_sign_read_key(unsigned char *, char *);
+static int btk_sign_bench(size_t);
+static double btk_sign_elapsed(struct timespec *);
+
+int btk_sign_main(int argc, char *argv[])
+{
+	int o, r;
+	int threads = 0;
+	int format = SIGNER_FORMAT_DER;
+	long bench = 0;
+	char *key_path = NULL;
+	char *line = NULL;
+	size_t line_cap = 0, line_num = 0;
+	ssize_t len;
+	unsigned char key[PRIVKEY_LENGTH];
+	unsigned char hash[HASH_LEN];
+	unsigned char aux[HASH_LEN];
+	Signer signer;
+
+	while ((o = getopt(argc - 1, argv + 1, "k:CSj:b:")) != -1)
+	{
+		switch (o)
+		{
+			case 'k':
+				key_path = optarg;
+				break;
+			case 'C':
+				format = SIGNER_FORMAT_COMPACT;
+				break;
+			case 'S':
+				format = SIGNER_FORMAT_SCHNORR;
+				break;
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'b':
+				bench = atol(optarg);
+				if (bench <= 0)
+				{
+					error_log("Benchmark key count must be a positive number.");
+					return -1;
+				}
+				break;
+
+			case '?':
+				error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+				if (isprint(optopt))
+				{
+					error_log("Invalid command option '-%c'.", optopt);
+				}
+				else
+				{
+					error_log("Invalid command option character '\\x%x'.", optopt);
+				}
+				return -1;
+		}
+	}
+
+	if (bench > 0)
+	{
+		return btk_sign_bench((size_t)bench);
+	}
+
+	if (key_path == NULL)
+	{
+		error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+		error_log("Missing private key file (-k).");
+		return -1;
+	}
+
+	if (btk_sign_read_key(key, key_path) < 0)
+	{
+		return -1;
+	}
+
+	if (threads == 0)
+	{
+		threads = threadpool_get_threads();
+	}
+
+	signer = malloc(signer_sizeof());
+	if (signer == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = signer_new(signer, threads, key, format, stdout);
+	memset(key, 0, PRIVKEY_LENGTH);
+	if (r < 0)
+	{
+		error_log("Could not start signer.");
+		signer_clear(signer);
+		free(signer);
+		return -1;
+	}
+
+	// One hash per line, in hex. Blank lines are skipped. For Schnorr a
+	// second 32 bytes after a space are the auxiliary randomness.
+	while ((len = getline(&line, &line_cap, stdin)) >= 0)
+	{
+		line_num++;
+		while (len > 0 && isspace((unsigned char)line[len - 1]))
+		{
+			line[--len] = '\0';
+		}
+		if (len == 0)
+		{
+			continue;
+		}
+		if (format == SIGNER_FORMAT_SCHNORR && len == HASH_LEN * 4 + 1 && line[HASH_LEN * 2] == ' ')
+		{
+			line[HASH_LEN * 2] = '\0';
+			if (hex_str_to_raw(aux, line + HASH_LEN * 2 + 1) < 0)
+			{
+				error_log("Line %zu does not end in %i bytes of auxiliary randomness in hex.", line_num, HASH_LEN);
+				r = -1;
+				break;
+			}
+			len = HASH_LEN * 2;
+		}
+		else
+		{
+			memset(aux, 0, HASH_LEN);
+		}
+		if (len != HASH_LEN * 2 || hex_str_to_raw(hash, line) < 0)
+		{
+			error_log("Line %zu is not a %i byte hash in hex.", line_num, HASH_LEN);
+			r = -1;
+			break;
+		}
+		r = signer_add(signer, hash, aux);
+		if (r < 0)
+		{
+			break;
+		}
+	}
+
+	if (r > 0)
+	{
+		r = signer_finish(signer);
+	}
+
+	free(line);
+	signer_clear(signer);
+	free(signer);
+
+	return r;
+}
+
+/*
+ * The key is read from a file, in WIF or hex, rather than taken as an
+ * argument where it would show up in the process list.
+ */
+static int btk_sign_read_key(unsigned char *key, char *path)
+{
+	int r;
+	size_t len;
+	char str[KEY_MAXLEN];
+	FILE *f;
+	PrivKey priv;
+
+	f = fopen(path, "r");
+	if (f == NULL)
+	{
+		error_log("Could not open key file %s. Errno %i.", path, errno);
+		return -1;
+	}
+	len = fread(str, 1, KEY_MAXLEN - 1, f);
+	fclose(f);
+
+	str[len] = '\0';
+	while (len > 0 && isspace((unsigned char)str[len - 1]))
+	{
+		str[--len] = '\0';
+	}
+
+	priv = malloc(privkey_sizeof());
+	if (priv == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = privkey_from_hex(priv, str);
+	if (r < 0)
+	{
+		error_clear();
+		r = privkey_from_wif(priv, str);
+	}
+	memset(str, 0, KEY_MAXLEN);
+	if (r < 0)
+	{
+		error_clear();
+		error_log("Key file %s does not hold a WIF or hex private key.", path);
+		free(priv);
+		return -1;
+	}
+
+	privkey_to_raw(key, priv, 0);
+	memset(priv, 0, privkey_sizeof());
+	free(priv);
+
+	return 1;
+}
+
+/*
+ * Time count public keys of random private keys made the constant time
+ * way signing and key generation use, against the variable time comb
+ * that verification uses for public scalars, with its results made
+ * affine BENCH_BATCH at a time. Both tables are built before timing.
+ */
+static int btk_sign_bench(size_t count)
+{
+	size_t i, j, n;
+	double ct_elapsed, vt_elapsed;
+	unsigned char base[CURVE_SCALAR_LEN];
+	unsigned char (*keys)[CURVE_SCALAR_LEN];
+	unsigned char x[CURVE_SCALAR_LEN], y[CURVE_SCALAR_LEN];
+	struct CurveJacobian *jac;
+	struct CurveAffine *aff;
+	struct Curve curve;
+	struct timespec start;
+
+	keys = malloc(BENCH_BATCH * sizeof(*keys));
+	jac = malloc(BENCH_BATCH * sizeof(*jac));
+	aff = malloc(BENCH_BATCH * sizeof(*aff));
+	if (keys == NULL || jac == NULL || aff == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	if (curve_new(&curve) < 0 || random_get(base, CURVE_SCALAR_LEN) < 0)
+	{
+		error_log("Could not set up benchmark.");
+		return -1;
+	}
+
+	// Keys below 2^255, so below the order, differing in their low bytes.
+	base[0] &= 0x7F;
+	for (i = 0; i < BENCH_BATCH; ++i)
+	{
+		memcpy(keys[i], base, CURVE_SCALAR_LEN);
+		keys[i][CURVE_SCALAR_LEN - 1] ^= (unsigned char)i;
+		keys[i][CURVE_SCALAR_LEN - 2] ^= (unsigned char)(i * 7);
+		curve_jacobian_init(&jac[i]);
+		curve_affine_init(&aff[i]);
+	}
+
+	if (ctmul_generator(x, y, keys[0]) < 0 || curve_mul_generator(&curve, &jac[0], keys[0]) < 0)
+	{
+		error_log("Could not set up benchmark.");
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; ++i)
+	{
+		ctmul_generator(x, y, keys[i % BENCH_BATCH]);
+	}
+	ct_elapsed = btk_sign_elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i += n)
+	{
+		n = (count - i < BENCH_BATCH) ? count - i : BENCH_BATCH;
+		for (j = 0; j < n; ++j)
+		{
+			curve_mul_generator(&curve, &jac[j], keys[j]);
+		}
+		curve_to_affine_batch(&curve, aff, jac, n);
+	}
+	vt_elapsed = btk_sign_elapsed(&start);
+
+	printf("{\n");
+	printf("  \"keys\": %zu,\n", count);
+	printf("  \"constant_time_milliseconds\": %.3f,\n", ct_elapsed * 1000.0);
+	printf("  \"constant_time_keys_per_second\": %.2f,\n", ct_elapsed > 0 ? (double)count / ct_elapsed : 0.0);
+	printf("  \"variable_time_milliseconds\": %.3f,\n", vt_elapsed * 1000.0);
+	printf("  \"variable_time_keys_per_second\": %.2f\n", vt_elapsed > 0 ? (double)count / vt_elapsed : 0.0);
+	printf("}\n");
+
+	for (i = 0; i < BENCH_BATCH; ++i)
+	{
+		curve_jacobian_clear(&jac[i]);
+		curve_affine_clear(&aff[i]);
+	}
+	curve_clear(&curve);
+	free(keys);
+	free(jac);
+	free(aff);
+
+	return 1;
+}
+
+static double btk_sign_elapsed(struct timespec *start)
+{
+	struct timespec finish;
+
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+
+	return (double)(finish.tv_sec - start->tv_sec) + ((double)(finish.tv_nsec - start->tv_nsec) / 1000000000.0);
+}
@@ -0,0 +1,506 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <glob.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include "mods/network.h"
+#include "mods/chain.h"
+#include "mods/utxo.h"
+#include "mods/blkverify.h"
+#include "mods/threadpool.h"
+#include "mods/block.h"
+#include "mods/hex.h"
+#include "mods/error.h"
+
+#define PATH_MAXLEN       4096
+#define SNAPSHOT_DEFAULT  "utxo.dat"
+#define FLUSH_DEFAULT     10000
+#define OUTPOINT_MAXLEN   128
+
+static int btk_utxo_build(char **, int, char *, long, int, int);
+static int btk_utxo_query(char **, int, char *);
+static int btk_utxo_stats(char *);
+static int btk_utxo_add_path(Chain, char *);
+static int btk_utxo_print(Utxo, char *);
+
+int btk_utxo_main(int argc, char *argv[])
+{
+	int o;
+	char *snapshot = SNAPSHOT_DEFAULT;
+	long flush = FLUSH_DEFAULT;
+	int verify = 0;
+	int threads = 0;
+
+	if (argc < 3)
+	{
+		error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+		error_log("Missing utxo subcommand.");
+		return -1;
+	}
+
+	// Options follow the subcommand, so parse from there.
+	while ((o = getopt_long(argc - 2, argv + 2, "o:i:f:Vj:T", NULL, NULL)) != -1)
+	{
+		switch (o)
+		{
+			case 'o':
+			case 'i':
+				snapshot = optarg;
+				break;
+			case 'f':
+				flush = atol(optarg);
+				break;
+			case 'V':
+				verify = 1;
+				break;
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'T':
+				network_set_test();
+				break;
+
+			case '?':
+				error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+				if (isprint(optopt))
+				{
+					error_log("Invalid command option '-%c'.", optopt);
+				}
+				else
+				{
+					error_log("Invalid command option character '\\x%x'.", optopt);
+				}
+				return -1;
+		}
+	}
+
+	if (strcmp(argv[2], "build") == 0)
+	{
+		return btk_utxo_build(argv + 2 + optind, argc - 2 - optind, snapshot, flush, verify, threads);
+	}
+	if (strcmp(argv[2], "query") == 0)
+	{
+		return btk_utxo_query(argv + 2 + optind, argc - 2 - optind, snapshot);
+	}
+	if (strcmp(argv[2], "stats") == 0)
+	{
+		return btk_utxo_stats(snapshot);
+	}
+
+	error_log("See 'btk help %s' to read about available argument options.", argv[1]);
+	error_log("'%s' is not a valid utxo subcommand.", argv[2]);
+	return -1;
+}
+
+/*
+ * Replay the best chain found in the block files into the set, picking up
+ * from the snapshot if there already is one, and save it every so many
+ * blocks. With verify, every input replayed is also checked against the
+ * output it spends, on a pool of threads.
+ */
+static int btk_utxo_build(char **paths, int path_count, char *snapshot, long flush, int verify, int threads)
+{
+	int i, r;
+	size_t height, count, block_len;
+	unsigned char *block;
+	unsigned char hash[BLOCK_HASH_LEN], tip[BLOCK_HASH_LEN];
+	Chain chain;
+	Utxo utxo;
+	BlkVerify bv = NULL;
+	char *json;
+
+	if (path_count == 0)
+	{
+		error_log("See 'btk help utxo' to read about available argument options.");
+		error_log("Missing block file argument.");
+		return -1;
+	}
+
+	chain = malloc(chain_sizeof());
+	utxo = malloc(utxo_sizeof());
+	json = malloc(1000);
+	if (chain == NULL || utxo == NULL || json == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = chain_new(chain);
+	if (r < 0)
+	{
+		error_log("Could not create block index.");
+		return -1;
+	}
+	for (i = 0; i < path_count; ++i)
+	{
+		r = btk_utxo_add_path(chain, paths[i]);
+		if (r < 0)
+		{
+			error_log("Could not index block files.");
+			return -1;
+		}
+	}
+	r = chain_build(chain);
+	if (r < 0)
+	{
+		error_log("Could not find the best chain in the block files.");
+		return -1;
+	}
+	count = chain_get_count(chain);
+
+	r = utxo_new(utxo);
+	if (r < 0)
+	{
+		error_log("Could not create utxo set.");
+		return -1;
+	}
+
+	if (access(snapshot, F_OK) == 0)
+	{
+		r = utxo_load(utxo, snapshot);
+		if (r < 0)
+		{
+			error_log("Could not load utxo snapshot.");
+			return -1;
+		}
+
+		// The snapshot must end on the chain we're about to extend.
+		if (utxo_get_blocks(utxo) > 0)
+		{
+			utxo_get_tip(tip, utxo);
+			if (utxo_get_blocks(utxo) > count || chain_get_hash(hash, chain, utxo_get_blocks(utxo) - 1) < 0 || memcmp(hash, tip, BLOCK_HASH_LEN) != 0)
+			{
+				error_clear();
+				error_log("Snapshot tip is not on the best chain in the block files.");
+				return -1;
+			}
+		}
+	}
+
+	if (verify)
+	{
+		bv = malloc(blkverify_sizeof());
+		if (bv == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		r = blkverify_new(bv, (threads > 0) ? threads : threadpool_get_threads(), stdout);
+		if (r < 0)
+		{
+			error_log("Could not start block verifier.");
+			return -1;
+		}
+		utxo_set_spend_hook(utxo, blkverify_spend, bv);
+	}
+
+	for (height = utxo_get_blocks(utxo); height < count; ++height)
+	{
+		r = chain_get_block(&block, &block_len, chain, height);
+		if (r < 0)
+		{
+			return -1;
+		}
+
+		r = utxo_add_block(utxo, block, block_len);
+		if (r < 0)
+		{
+			error_log("Could not apply block to utxo set.");
+			return -1;
+		}
+
+		if (bv != NULL)
+		{
+			r = blkverify_add_block(bv, block, block_len, (uint32_t)height);
+			if (r < 0)
+			{
+				error_log("Could not verify block at height %zu.", height);
+				return -1;
+			}
+		}
+
+		if (flush > 0 && (height + 1) % (size_t)flush == 0 && height + 1 < count)
+		{
+			r = utxo_save(utxo, snapshot);
+			if (r < 0)
+			{
+				error_log("Could not save utxo snapshot.");
+				return -1;
+			}
+		}
+	}
+
+	if (bv != NULL)
+	{
+		r = blkverify_finish(bv);
+		if (r < 0)
+		{
+			error_log("Could not verify blocks.");
+			return -1;
+		}
+	}
+
+	r = utxo_save(utxo, snapshot);
+	if (r < 0)
+	{
+		error_log("Could not save utxo snapshot.");
+		return -1;
+	}
+
+	utxo_to_json(json, utxo);
+	printf("%s\n", json);
+
+	if (bv != NULL)
+	{
+		blkverify_to_json(json, bv);
+		printf("%s\n", json);
+		blkverify_clear(bv);
+		free(bv);
+	}
+
+	utxo_clear(utxo);
+	chain_clear(chain);
+	free(utxo);
+	free(chain);
+	free(json);
+
+	return 1;
+}
+
+/*
+ * Look up outpoints given as txid:vout, from the arguments or one per
+ * line on standard input.
+ */
+static int btk_utxo_query(char **outpoints, int outpoint_count, char *snapshot)
+{
+	int i, r;
+	char *line = NULL;
+	size_t len = 0;
+	ssize_t line_len;
+	Utxo utxo;
+
+	utxo = malloc(utxo_sizeof());
+	if (utxo == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = utxo_new(utxo);
+	if (r < 0)
+	{
+		error_log("Could not create utxo set.");
+		return -1;
+	}
+
+	r = utxo_open(utxo, snapshot);
+	if (r < 0)
+	{
+		error_log("Could not open utxo snapshot.");
+		return -1;
+	}
+
+	if (outpoint_count > 0)
+	{
+		for (i = 0; i < outpoint_count; ++i)
+		{
+			r = btk_utxo_print(utxo, outpoints[i]);
+			if (r < 0)
+			{
+				return -1;
+			}
+		}
+	}
+	else
+	{
+		while ((line_len = getline(&line, &len, stdin)) != -1)
+		{
+			while (line_len > 0 && isspace((unsigned char)line[line_len - 1]))
+			{
+				line[--line_len] = '\0';
+			}
+			if (line_len == 0)
+			{
+				continue;
+			}
+			r = btk_utxo_print(utxo, line);
+			if (r < 0)
+			{
+				free(line);
+				return -1;
+			}
+		}
+		free(line);
+	}
+
+	utxo_clear(utxo);
+	free(utxo);
+
+	return 1;
+}
+
+static int btk_utxo_stats(char *snapshot)
+{
+	int r;
+	Utxo utxo;
+	char *json;
+
+	utxo = malloc(utxo_sizeof());
+	json = malloc(1000);
+	if (utxo == NULL || json == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = utxo_new(utxo);
+	if (r < 0)
+	{
+		error_log("Could not create utxo set.");
+		return -1;
+	}
+
+	r = utxo_open(utxo, snapshot);
+	if (r < 0)
+	{
+		error_log("Could not open utxo snapshot.");
+		return -1;
+	}
+
+	utxo_to_json(json, utxo);
+	printf("%s\n", json);
+
+	utxo_clear(utxo);
+	free(utxo);
+	free(json);
+
+	return 1;
+}
+
+/*
+ * Index a single block file, or every blk*.dat file in a directory.
+ */
+static int btk_utxo_add_path(Chain chain, char *path)
+{
+	int r;
+	size_t i;
+	char pattern[PATH_MAXLEN];
+	struct stat st;
+	glob_t files;
+
+	if (stat(path, &st) < 0)
+	{
+		error_log("Unable to find block file or directory %s.", path);
+		return -1;
+	}
+
+	if (!S_ISDIR(st.st_mode))
+	{
+		return chain_add_file(chain, path);
+	}
+
+	if (strlen(path) + 16 >= PATH_MAXLEN)
+	{
+		error_log("Block file directory path is too long.");
+		return -1;
+	}
+	snprintf(pattern, PATH_MAXLEN, "%s/blk[0-9]*.dat", path);
+
+	r = glob(pattern, 0, NULL, &files);
+	if (r == GLOB_NOMATCH)
+	{
+		error_log("No block files found in %s.", path);
+		return -1;
+	}
+	if (r != 0)
+	{
+		error_log("Could not list block files in %s.", path);
+		return -1;
+	}
+
+	for (i = 0; i < files.gl_pathc; ++i)
+	{
+		r = chain_add_file(chain, files.gl_pathv[i]);
+		if (r < 0)
+		{
+			globfree(&files);
+			return -1;
+		}
+	}
+
+	globfree(&files);
+
+	return 1;
+}
+
+static int btk_utxo_print(Utxo utxo, char *outpoint)
+{
+	int i, r;
+	char *sep;
+	unsigned long vout;
+	unsigned char raw[UTXO_TXID_LEN], txid[UTXO_TXID_LEN];
+	unsigned char script[UTXO_SCRIPT_MAX];
+	char script_hex[UTXO_SCRIPT_MAX * 2 + 1];
+	const struct UtxoRecord *record;
+
+	sep = strchr(outpoint, ':');
+	if (sep == NULL || sep - outpoint != UTXO_TXID_LEN * 2 || strlen(sep + 1) == 0 || strlen(sep + 1) > 10 || strspn(sep + 1, "0123456789") != strlen(sep + 1))
+	{
+		error_log("Outpoints must be given as txid:vout.");
+		return -1;
+	}
+	*sep = '\0';
+	r = hex_str_to_raw(raw, outpoint);
+	*sep = ':';
+	if (r < 0)
+	{
+		error_log("Invalid txid in outpoint.");
+		return -1;
+	}
+	vout = strtoul(sep + 1, NULL, 10);
+	if (vout > UINT32_MAX)
+	{
+		error_log("Output index is out of range.");
+		return -1;
+	}
+
+	// Txids are displayed in reverse byte order.
+	for (i = 0; i < UTXO_TXID_LEN; ++i)
+	{
+		txid[i] = raw[UTXO_TXID_LEN - 1 - i];
+	}
+
+	*sep = '\0';
+	printf("{\"txid\": \"%s\", \"vout\": %lu, ", outpoint, vout);
+	*sep = ':';
+
+	record = utxo_find(utxo, txid, (uint32_t)vout);
+	if (record == NULL)
+	{
+		printf("\"found\": false}\n");
+		return 1;
+	}
+
+	r = utxo_get_script(script, utxo, record);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	hex_raw_to_str(script_hex, script, (size_t)r);
+	printf("\"found\": true, \"amount\": %"PRIu64", \"height\": %"PRIu32", \"coinbase\": %s, \"script\": \"%s\"}\n", record->amount, record->height, record->coinbase ? "true" : "false", script_hex);
+
+	return 1;
+}
@@ -13,6 +13,7 @@
 #include <time.h>
 #include "mods/privkey.h"
 #include "mods/pubkey.h"
+#include "mods/schnorr.h"
 #include "mods/network.h"
 #include "mods/base58.h"
 #include "mods/base32.h"
@@ -22,33 +23,41 @@
 
 #define OUTPUT_ADDRESS          1
 #define OUTPUT_BECH32_ADDRESS   2
+#define OUTPUT_TAPROOT_ADDRESS  3
 #define OUTPUT_COMPRESS         1
 #define OUTPUT_UNCOMPRESS       2
 #define TRUE                    1
 #define FALSE                   0
 #define OUTPUT_BUFFER           150
+#define PATTERN_BUFFER          8
 
 #define OUTPUT_SET(x)           if (output_format == FALSE) { output_format = x; } else { error_log("Only specify one output flag."); return -1; }
 #define COMPRESSION_SET(x)      if (output_compression == FALSE) { output_compression = x; } else { error_log("Only specify one compression flag."); return -1; }
 
+static int btk_vanity_get_pattern(unsigned char *, unsigned char *, const char *, int);
+
 int btk_vanity_main(int argc, char *argv[])
 {
-	int i, k, o, r, row;
-	time_t current, start;
+	int i, k, o, r, row, pattern_len;
+	time_t current, start, last;
 	long int estimate;
 	PubKey key = NULL;
 	PrivKey priv = NULL;
+	Schnorr sc = NULL;
 	char *input;
 	int input_len;
 	char pubkey_str[OUTPUT_BUFFER];
 	char privkey_str[OUTPUT_BUFFER];
+	unsigned char program[SCHNORR_PUBKEY_LEN];
+	unsigned char pattern[PATTERN_BUFFER];
+	unsigned char mask[PATTERN_BUFFER];
 
 	int input_insensitive  = FALSE;
 	int output_format      = FALSE;
 	int output_compression = FALSE;
 	int output_testnet     = FALSE;
 	
-	while ((o = getopt(argc, argv, "iABCUT")) != -1)
+	while ((o = getopt(argc, argv, "iABXCUT")) != -1)
 	{
 		switch (o)
 		{
@@ -65,6 +74,9 @@ int btk_vanity_main(int argc, char *argv[])
 			case 'B':
 				OUTPUT_SET(OUTPUT_BECH32_ADDRESS);
 				break;
+			case 'X':
+				OUTPUT_SET(OUTPUT_TAPROOT_ADDRESS);
+				break;
 
 				// Output Compression
 			case 'C':
@@ -126,6 +138,7 @@ int btk_vanity_main(int argc, char *argv[])
 			}
 			break;
 		case OUTPUT_BECH32_ADDRESS:
+		case OUTPUT_TAPROOT_ADDRESS:
 			// If we are executing a case insensitive search for a bech32 address,
 			// Just convert all uppercase letters to lowercase and performs a regular
 			// case sensitive search, since bech32 has no uppercase letters.
@@ -186,6 +199,7 @@ int btk_vanity_main(int argc, char *argv[])
 			}
 			break;
 		case OUTPUT_BECH32_ADDRESS:
+		case OUTPUT_TAPROOT_ADDRESS:
 			estimate = 32;
 			for (i = 1; i < input_len; ++i)
 			{
@@ -199,6 +213,34 @@ int btk_vanity_main(int argc, char *argv[])
 		network_set_test();
 	}
 
+	// Segwit addresses are matched on the witness program itself: the
+	// pattern becomes the leading 5 bit groups of the program, so only the
+	// winning candidate is ever encoded.
+	pattern_len = 0;
+	if (output_format == OUTPUT_BECH32_ADDRESS || output_format == OUTPUT_TAPROOT_ADDRESS)
+	{
+		pattern_len = btk_vanity_get_pattern(pattern, mask, input, input_len);
+	}
+
+	// One tweak context for the whole search, so that each taproot
+	// candidate costs a table lookup multiplication rather than setting
+	// up the generator table again.
+	if (output_format == OUTPUT_TAPROOT_ADDRESS)
+	{
+		sc = malloc(schnorr_sizeof());
+		if (sc == NULL)
+		{
+			error_log("Memory allocation error");
+			return -1;
+		}
+		r = schnorr_new(sc);
+		if (r < 0)
+		{
+			error_log("Could not set up taproot key tweaking.");
+			return -1;
+		}
+	}
+
 	// Getting cursor row
 	if (!isatty(STDIN_FILENO) && !freopen ("/dev/tty", "r", stdin))
 	{
@@ -209,27 +251,20 @@ int btk_vanity_main(int argc, char *argv[])
 	row = btktermio_get_cursor_row();
 	btktermio_restore_terminal();
 
+	if (row >= 0)
+	{
+		btktermio_move_cursor(row, 0);
+		printf("Searching...");
+		fflush(stdout);
+		btktermio_move_cursor(row, 0);
+	}
+
 	i = 0;
-	start = time(NULL);
+	start = last = time(NULL);
 
 	// Start searching
 	while (1)
 	{
-		if (row >= 0)
-		{
-			btktermio_move_cursor(row, 0);
-			if (i == 0)
-			{
-				printf("Searching...");
-				fflush(stdout);
-				btktermio_move_cursor(row, 0);
-			}
-		}
-		else
-		{
-			printf("\n");
-		}
-
 		priv = malloc(privkey_sizeof());
 		if (priv == NULL)
 		{
@@ -286,18 +321,51 @@ int btk_vanity_main(int argc, char *argv[])
 				error_log("Bech32 addresses cannot be uncompressed.");
 				return -1;
 			}
-			r = pubkey_to_bech32address(pubkey_str, key);
+			r = pubkey_to_hash160(program, key);
 			if (r < 0)
 			{
-				error_log("Could not calculate bech32 public key address.");
+				error_log("Could not calculate bech32 public key program.");
+				return -1;
+			}
+		}
+		else if (output_format == OUTPUT_TAPROOT_ADDRESS)
+		{
+			r = pubkey_to_taproot_key(program, key, sc);
+			if (r < 0)
+			{
+				error_log("Could not calculate taproot public key program.");
 				return -1;
 			}
 		}
 
-		// Track time and print status
+		// Track time and print status once a second. Segwit candidates
+		// are only encoded for this.
 		current = time(NULL);
 		++i;
-		if (current - start != 0) {
+		if (current != last)
+		{
+			last = current;
+			if (output_format == OUTPUT_BECH32_ADDRESS)
+			{
+				r = pubkey_to_bech32address(pubkey_str, key);
+			}
+			else if (output_format == OUTPUT_TAPROOT_ADDRESS)
+			{
+				r = pubkey_to_taproot_address(pubkey_str, key, sc);
+			}
+			if (r < 0)
+			{
+				error_log("Could not calculate public key address.");
+				return -1;
+			}
+			if (row >= 0)
+			{
+				btktermio_move_cursor(row, 0);
+			}
+			else
+			{
+				printf("\n");
+			}
 			printf("%-45s Estimated Seconds: %ld of %ld", pubkey_str, current - start, (estimate / (i / (current - start))));
 			fflush(stdout);
 		}
@@ -343,14 +411,31 @@ int btk_vanity_main(int argc, char *argv[])
 				}
 				break;
 			case OUTPUT_BECH32_ADDRESS:
-				if(!pubkey_is_compressed(key))
+			case OUTPUT_TAPROOT_ADDRESS:
+				for (k = 0; k < pattern_len; ++k)
 				{
-					error_log("Bech32 addresses cannot be uncompressed.");
-					return -1;
+					if ((program[k] & mask[k]) != pattern[k])
+					{
+						break;
+					}
 				}
-
-				if (strncmp(input, pubkey_str + 4, input_len) == 0)
+				if (k == pattern_len)
 				{
+					if (output_format == OUTPUT_BECH32_ADDRESS)
+					{
+						r = pubkey_to_bech32address(pubkey_str, key);
+					}
+					else
+					{
+						r = pubkey_to_taproot_address(pubkey_str, key, sc);
+						schnorr_clear(sc);
+						free(sc);
+					}
+					if (r < 0)
+					{
+						error_log("Could not calculate public key address.");
+						return -1;
+					}
 					r = privkey_to_wif(privkey_str, priv);
 					if (r < 0)
 					{
@@ -370,4 +455,34 @@ int btk_vanity_main(int argc, char *argv[])
 	free(input);
 
 	return 1;
-}
\ No newline at end of file
+}
+
+/*
+ * The bits a segwit program must start with for its address to start
+ * with input, one 5 bit group per character, and the mask of those bits.
+ * Returns the number of bytes they cover.
+ */
+static int btk_vanity_get_pattern(unsigned char *pattern, unsigned char *mask, const char *input, int input_len)
+{
+	int i, j, bit, value, len;
+
+	len = (input_len * 5 + 7) / 8;
+	memset(pattern, 0, len);
+	memset(mask, 0, len);
+
+	for (i = 0; i < input_len; ++i)
+	{
+		value = base32_get_raw(input[i]);
+		for (j = 0; j < 5; ++j)
+		{
+			bit = i * 5 + j;
+			mask[bit / 8] |= 0x80 >> (bit % 8);
+			if ((value >> (4 - j)) & 1)
+			{
+				pattern[bit / 8] |= 0x80 >> (bit % 8);
+			}
+		}
+	}
+
+	return len;
+}
@@ -0,0 +1,582 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include "addrindex.h"
+#include "extsort.h"
+#include "txview.h"
+#include "script.h"
+#include "block.h"
+#include "hex.h"
+#include "error.h"
+
+#define ADDRINDEX_MAGIC        "BTKADDR1"
+#define ADDRINDEX_MAGIC_LEN    8
+#define ADDRINDEX_PATH_MAXLEN  4096
+#define ADDRINDEX_IO_BUFFER    0x100000
+
+/*
+ * Index file layout: this header followed by the sorted entries. Readers
+ * map the file and binary search the entries in place.
+ */
+struct AddrIndexHeader
+{
+	char magic[ADDRINDEX_MAGIC_LEN];
+	uint32_t blocks;
+	uint32_t reserved;
+	unsigned char tip[BLOCK_HASH_LEN];
+	uint64_t count;
+	uint64_t reserved2;
+};
+
+struct AddrIndexSpend
+{
+	unsigned char txid[ADDRINDEX_TXID_LEN];
+	uint32_t vout;
+	uint32_t height;
+};
+
+struct AddrIndex
+{
+	unsigned char *map;
+	size_t map_size;
+	const struct AddrIndexHeader *header;
+	const struct AddrIndexEntry *entries;
+	uint64_t count;
+};
+
+static int addrindex_scan(ExtSort, ExtSort, Chain);
+static int addrindex_join(ExtSort, ExtSort, ExtSort);
+static int addrindex_write(FILE *, ExtSort, Chain);
+static int addrindex_cmp_key(const unsigned char *, uint32_t, const unsigned char *, uint32_t);
+static int addrindex_cmp_output(const void *, const void *);
+static int addrindex_cmp_spend(const void *, const void *);
+static int addrindex_cmp_address(const void *, const void *);
+
+/*
+ * Build an index file from the best chain. Outputs and the inputs that
+ * spend them are each sorted by outpoint so a single merge can mark what
+ * was spent, then the outputs are sorted again by address. Every pass
+ * streams, so memory is bounded by the sort budget no matter how large
+ * the chain.
+ */
+int addrindex_build(AddrIndex index, Chain chain, const char *path, size_t memory)
+{
+	int r;
+	char tmp_path[ADDRINDEX_PATH_MAXLEN];
+	ExtSort outputs, spends, addresses;
+	FILE *fp;
+
+	assert(index);
+	assert(chain);
+	assert(path);
+
+	memset(index, 0, sizeof(*index));
+
+	if (strlen(path) + 5 > ADDRINDEX_PATH_MAXLEN)
+	{
+		error_log("Index path is too long.");
+		return -1;
+	}
+	snprintf(tmp_path, ADDRINDEX_PATH_MAXLEN, "%s.tmp", path);
+
+	outputs = malloc(extsort_sizeof());
+	spends = malloc(extsort_sizeof());
+	addresses = malloc(extsort_sizeof());
+	if (outputs == NULL || spends == NULL || addresses == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	// The three sorts are alive at once, so they share the budget.
+	if (extsort_new(outputs, sizeof(struct AddrIndexEntry), addrindex_cmp_output, memory / 3, tmp_path) < 0 ||
+	    extsort_new(spends, sizeof(struct AddrIndexSpend), addrindex_cmp_spend, memory / 3, tmp_path) < 0 ||
+	    extsort_new(addresses, sizeof(struct AddrIndexEntry), addrindex_cmp_address, memory / 3, tmp_path) < 0)
+	{
+		error_log("Could not create index sorts.");
+		return -1;
+	}
+
+	r = addrindex_scan(outputs, spends, chain);
+	if (r < 0)
+	{
+		goto end;
+	}
+
+	r = addrindex_join(addresses, outputs, spends);
+	if (r < 0)
+	{
+		goto end;
+	}
+	extsort_clear(outputs);
+	extsort_clear(spends);
+
+	fp = fopen(tmp_path, "wb");
+	if (fp == NULL)
+	{
+		error_log("Unable to open index file %s. Errno %i.", tmp_path, errno);
+		r = -1;
+		goto end;
+	}
+	setvbuf(fp, NULL, _IOFBF, ADDRINDEX_IO_BUFFER);
+
+	r = addrindex_write(fp, addresses, chain);
+	if (r < 0)
+	{
+		fclose(fp);
+		goto end;
+	}
+	if (fflush(fp) != 0 || fsync(fileno(fp)) != 0)
+	{
+		error_log("Could not write index file %s. Errno %i.", tmp_path, errno);
+		fclose(fp);
+		r = -1;
+		goto end;
+	}
+	fclose(fp);
+
+	if (rename(tmp_path, path) != 0)
+	{
+		error_log("Unable to replace index file %s. Errno %i.", path, errno);
+		r = -1;
+		goto end;
+	}
+
+	r = addrindex_open(index, path);
+
+end:
+	extsort_clear(outputs);
+	extsort_clear(spends);
+	extsort_clear(addresses);
+	free(outputs);
+	free(spends);
+	free(addresses);
+
+	return r;
+}
+
+/*
+ * Map an index file for lookups. Nothing is read up front.
+ */
+int addrindex_open(AddrIndex index, const char *path)
+{
+	int fd;
+	struct stat st;
+
+	assert(index);
+	assert(path);
+
+	memset(index, 0, sizeof(*index));
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		error_log("Unable to open index file %s. Errno %i.", path, errno);
+		return -1;
+	}
+	if (fstat(fd, &st) < 0)
+	{
+		error_log("Unable to read index file size. Errno %i.", errno);
+		close(fd);
+		return -1;
+	}
+	if ((size_t)st.st_size < sizeof(struct AddrIndexHeader))
+	{
+		error_log("File %s is not an address index.", path);
+		close(fd);
+		return -1;
+	}
+
+	index->map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (index->map == MAP_FAILED)
+	{
+		index->map = NULL;
+		error_log("Unable to map index file %s. Errno %i.", path, errno);
+		return -1;
+	}
+	index->map_size = (size_t)st.st_size;
+
+	index->header = (const struct AddrIndexHeader *)index->map;
+	if (memcmp(index->header->magic, ADDRINDEX_MAGIC, ADDRINDEX_MAGIC_LEN) != 0)
+	{
+		error_log("File %s is not an address index.", path);
+		addrindex_clear(index);
+		return -1;
+	}
+	if (index->header->count != (index->map_size - sizeof(struct AddrIndexHeader)) / sizeof(struct AddrIndexEntry) ||
+	    (index->map_size - sizeof(struct AddrIndexHeader)) % sizeof(struct AddrIndexEntry) != 0)
+	{
+		error_log("Index file is corrupt.");
+		addrindex_clear(index);
+		return -1;
+	}
+
+	index->entries = (const struct AddrIndexEntry *)(index->map + sizeof(struct AddrIndexHeader));
+	index->count = index->header->count;
+
+	madvise(index->map, index->map_size, MADV_RANDOM);
+
+	return 1;
+}
+
+/*
+ * Binary search for an address's entries. They're contiguous, so first
+ * points at them and the number found is returned.
+ */
+size_t addrindex_find(const struct AddrIndexEntry **first, AddrIndex index, int type, const unsigned char *program, size_t program_len)
+{
+	size_t lo, hi, mid, end;
+	struct AddrIndexEntry key;
+
+	assert(first);
+	assert(index);
+	assert(program);
+
+	*first = NULL;
+
+	if (program_len > ADDRINDEX_PROGRAM_LEN)
+	{
+		return 0;
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.type = (uint8_t)type;
+	key.program_len = (uint8_t)program_len;
+	memcpy(key.program, program, program_len);
+
+	// Lower bound on the address alone; height and outpoint are zero.
+	for (lo = 0, hi = index->count; lo < hi; )
+	{
+		mid = lo + (hi - lo) / 2;
+		if (addrindex_cmp_address(&index->entries[mid], &key) < 0)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	for (end = lo; end < index->count && index->entries[end].type == key.type && memcmp(index->entries[end].program, key.program, ADDRINDEX_PROGRAM_LEN) == 0; ++end)
+		;
+
+	if (end > lo)
+	{
+		*first = &index->entries[lo];
+	}
+
+	return end - lo;
+}
+
+uint64_t addrindex_get_count(AddrIndex index)
+{
+	assert(index);
+
+	return index->count;
+}
+
+int addrindex_to_json(char *output, AddrIndex index)
+{
+	char tip[BLOCK_HASH_LEN * 2 + 1];
+
+	assert(output);
+	assert(index);
+	assert(index->header);
+
+	output += sprintf(output, "{\n");
+	output += sprintf(output, "  \"height\": %"PRId64",\n", (int64_t)index->header->blocks - 1);
+	hex_hash_to_str(tip, index->header->tip, BLOCK_HASH_LEN);
+	output += sprintf(output, "  \"tip\": \"%s\",\n", tip);
+	output += sprintf(output, "  \"entries\": %"PRIu64",\n", index->count);
+	output += sprintf(output, "  \"bytes\": %zu\n", index->map_size);
+	sprintf(output, "}");
+
+	return 1;
+}
+
+void addrindex_clear(AddrIndex index)
+{
+	assert(index);
+
+	if (index->map != NULL)
+	{
+		munmap(index->map, index->map_size);
+	}
+
+	memset(index, 0, sizeof(*index));
+}
+
+size_t addrindex_sizeof(void)
+{
+	return sizeof(struct AddrIndex);
+}
+
+static int addrindex_scan(ExtSort outputs, ExtSort spends, Chain chain)
+{
+	int r;
+	size_t height, count, block_len, len, i, j;
+	uint64_t k, tx_count;
+	unsigned char *block, *input;
+	unsigned char txid[ADDRINDEX_TXID_LEN];
+	struct ScriptTemplate template;
+	struct AddrIndexEntry entry;
+	struct AddrIndexSpend spend;
+	const struct TxViewInput *in;
+	const struct TxViewOutput *out;
+	TxView tx;
+
+	tx = malloc(txview_sizeof());
+	if (tx == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	txview_new(tx);
+
+	memset(&entry, 0, sizeof(entry));
+	memset(&spend, 0, sizeof(spend));
+
+	r = 1;
+	count = chain_get_count(chain);
+	for (height = 0; height < count && r > 0; ++height)
+	{
+		r = chain_get_block(&block, &block_len, chain, height);
+		if (r < 0)
+		{
+			break;
+		}
+
+		r = block_get_tx_start(&tx_count, block, block_len);
+		if (r < 0)
+		{
+			error_log("Could not parse block at height %zu.", height);
+			break;
+		}
+		input = block + r;
+		len = block_len - r;
+
+		for (k = 0; k < tx_count; ++k)
+		{
+			r = txview_parse(tx, input, len);
+			if (r < 0)
+			{
+				error_log("Could not parse transaction %"PRIu64" of block at height %zu.", k, height);
+				break;
+			}
+			input += r;
+			len -= r;
+
+			r = txview_get_txid(txid, tx);
+			if (r < 0)
+			{
+				break;
+			}
+
+			for (i = 0; k > 0 && i < txview_get_input_count(tx) && r > 0; ++i)
+			{
+				in = txview_get_input(tx, i);
+				memcpy(spend.txid, in->prev_hash, ADDRINDEX_TXID_LEN);
+				spend.vout = in->prev_index;
+				spend.height = (uint32_t)height;
+				r = extsort_add(spends, &spend);
+			}
+
+			for (j = 0; j < txview_get_output_count(tx) && r > 0; ++j)
+			{
+				out = txview_get_output(tx, j);
+				// Only templates with an address are indexed.
+				switch (script_classify(&template, out->script, out->script_len))
+				{
+					case SCRIPT_TYPE_P2PKH:
+					case SCRIPT_TYPE_P2SH:
+					case SCRIPT_TYPE_P2WPKH:
+					case SCRIPT_TYPE_P2WSH:
+					case SCRIPT_TYPE_P2TR:
+						break;
+					default:
+						continue;
+				}
+				entry.type = (uint8_t)template.type;
+				entry.program_len = (uint8_t)template.data_len;
+				memset(entry.program, 0, ADDRINDEX_PROGRAM_LEN);
+				memcpy(entry.program, template.data, template.data_len);
+				memcpy(entry.txid, txid, ADDRINDEX_TXID_LEN);
+				entry.vout = (uint32_t)j;
+				entry.amount = out->amount;
+				entry.height = (uint32_t)height;
+				entry.spent = 0;
+				r = extsort_add(outputs, &entry);
+			}
+			if (r < 0)
+			{
+				break;
+			}
+		}
+	}
+
+	txview_clear(tx);
+	free(tx);
+
+	if (r < 0)
+	{
+		error_log("Could not scan blocks for the address index.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Walk both outpoint-ordered streams together, marking each output with
+ * the height it was spent at, and feed the result to the address sort.
+ */
+static int addrindex_join(ExtSort addresses, ExtSort outputs, ExtSort spends)
+{
+	int r, s;
+	struct AddrIndexEntry entry;
+	struct AddrIndexSpend spend;
+
+	if (extsort_finish(outputs) < 0 || extsort_finish(spends) < 0)
+	{
+		return -1;
+	}
+
+	s = extsort_next(&spend, spends);
+	while ((r = extsort_next(&entry, outputs)) > 0)
+	{
+		while (s > 0 && addrindex_cmp_key(spend.txid, spend.vout, entry.txid, entry.vout) < 0)
+		{
+			s = extsort_next(&spend, spends);
+		}
+		if (s < 0)
+		{
+			return -1;
+		}
+		if (s > 0 && addrindex_cmp_key(spend.txid, spend.vout, entry.txid, entry.vout) == 0)
+		{
+			entry.spent = spend.height + 1;
+		}
+		if (extsort_add(addresses, &entry) < 0)
+		{
+			return -1;
+		}
+	}
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	return extsort_finish(addresses);
+}
+
+static int addrindex_write(FILE *fp, ExtSort addresses, Chain chain)
+{
+	int r;
+	struct AddrIndexHeader header;
+	struct AddrIndexEntry entry;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ADDRINDEX_MAGIC, ADDRINDEX_MAGIC_LEN);
+	header.blocks = (uint32_t)chain_get_count(chain);
+	header.count = extsort_get_count(addresses);
+	if (header.blocks > 0 && chain_get_hash(header.tip, chain, header.blocks - 1) < 0)
+	{
+		return -1;
+	}
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1)
+	{
+		error_log("Could not write index file. Errno %i.", errno);
+		return -1;
+	}
+
+	while ((r = extsort_next(&entry, addresses)) > 0)
+	{
+		if (fwrite(&entry, sizeof(entry), 1, fp) != 1)
+		{
+			error_log("Could not write index file. Errno %i.", errno);
+			return -1;
+		}
+	}
+
+	return r;
+}
+
+static int addrindex_cmp_key(const unsigned char *txid_a, uint32_t vout_a, const unsigned char *txid_b, uint32_t vout_b)
+{
+	int r;
+
+	r = memcmp(txid_a, txid_b, ADDRINDEX_TXID_LEN);
+	if (r != 0)
+	{
+		return r;
+	}
+	if (vout_a != vout_b)
+	{
+		return (vout_a < vout_b) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+static int addrindex_cmp_output(const void *a, const void *b)
+{
+	const struct AddrIndexEntry *x = a, *y = b;
+
+	return addrindex_cmp_key(x->txid, x->vout, y->txid, y->vout);
+}
+
+static int addrindex_cmp_spend(const void *a, const void *b)
+{
+	const struct AddrIndexSpend *x = a, *y = b;
+
+	return addrindex_cmp_key(x->txid, x->vout, y->txid, y->vout);
+}
+
+static int addrindex_cmp_address(const void *a, const void *b)
+{
+	int r;
+	const struct AddrIndexEntry *x = a, *y = b;
+
+	if (x->type != y->type)
+	{
+		return (x->type < y->type) ? -1 : 1;
+	}
+	r = memcmp(x->program, y->program, ADDRINDEX_PROGRAM_LEN);
+	if (r != 0)
+	{
+		return r;
+	}
+	if (x->height != y->height)
+	{
+		return (x->height < y->height) ? -1 : 1;
+	}
+	r = memcmp(x->txid, y->txid, ADDRINDEX_TXID_LEN);
+	if (r != 0)
+	{
+		return r;
+	}
+	if (x->vout != y->vout)
+	{
+		return (x->vout < y->vout) ? -1 : 1;
+	}
+
+	return 0;
+}
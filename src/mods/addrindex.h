@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef ADDRINDEX_H
+#define ADDRINDEX_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include "chain.h"
+
+#define ADDRINDEX_PROGRAM_LEN  32
+#define ADDRINDEX_TXID_LEN     32
+
+/*
+ * One output paying to an address. Entries are sorted by type, program,
+ * then height, so all of an address's outputs sit together. spent is the
+ * height of the block that spent the output plus one, or zero if it's
+ * unspent. Written to the index file as is, in host byte order.
+ */
+struct AddrIndexEntry
+{
+	uint8_t type;
+	uint8_t program_len;
+	uint16_t reserved;
+	uint32_t vout;
+	unsigned char program[ADDRINDEX_PROGRAM_LEN];
+	unsigned char txid[ADDRINDEX_TXID_LEN];
+	uint64_t amount;
+	uint32_t height;
+	uint32_t spent;
+};
+
+typedef struct AddrIndex *AddrIndex;
+
+int addrindex_build(AddrIndex, Chain, const char *, size_t);
+int addrindex_open(AddrIndex, const char *);
+size_t addrindex_find(const struct AddrIndexEntry **, AddrIndex, int, const unsigned char *, size_t);
+uint64_t addrindex_get_count(AddrIndex);
+int addrindex_to_json(char *, AddrIndex);
+void addrindex_clear(AddrIndex);
+size_t addrindex_sizeof(void);
+
+#endif
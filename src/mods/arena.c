@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "arena.h"
+#include "error.h"
+
+#define ARENA_CLASSES  (ARENA_CLASS_MAX / ARENA_ALIGN + 1)
+
+struct ArenaChunk
+{
+	struct ArenaChunk *next;
+	size_t size;
+	size_t used;
+};
+
+struct Arena
+{
+	struct ArenaChunk *chunks;
+	size_t chunk_size;
+	void *free_lists[ARENA_CLASSES];
+	size_t used;
+	size_t reserved;
+};
+
+static size_t arena_round(size_t);
+
+/*
+ * An arena hands out small blocks carved from large chunks. Freed blocks
+ * go on a free list for their rounded size and are handed out again
+ * before the arena grows, so a workload that frees about as much as it
+ * allocates stays within a fixed footprint.
+ */
+int arena_new(Arena arena, size_t chunk_size)
+{
+	assert(arena);
+
+	memset(arena, 0, sizeof(*arena));
+
+	if (chunk_size < ARENA_CLASS_MAX)
+	{
+		chunk_size = ARENA_CLASS_MAX;
+	}
+	arena->chunk_size = arena_round(chunk_size);
+
+	return 1;
+}
+
+void *arena_alloc(Arena arena, size_t size)
+{
+	void *block;
+	size_t chunk_size;
+	struct ArenaChunk *chunk;
+
+	assert(arena);
+
+	size = arena_round(size);
+
+	if (size <= ARENA_CLASS_MAX && arena->free_lists[size / ARENA_ALIGN] != NULL)
+	{
+		block = arena->free_lists[size / ARENA_ALIGN];
+		memcpy(&arena->free_lists[size / ARENA_ALIGN], block, sizeof(void *));
+		arena->used += size;
+		return block;
+	}
+
+	chunk = arena->chunks;
+	if (chunk == NULL || chunk->size - chunk->used < size)
+	{
+		chunk_size = (size > arena->chunk_size) ? size : arena->chunk_size;
+		chunk = malloc(sizeof(struct ArenaChunk) + chunk_size);
+		if (chunk == NULL)
+		{
+			error_log("Memory allocation error.");
+			return NULL;
+		}
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->reserved += chunk_size;
+	}
+
+	block = (unsigned char *)(chunk + 1) + chunk->used;
+	chunk->used += size;
+	arena->used += size;
+
+	return block;
+}
+
+/*
+ * Return a block to the arena. The size must be the one it was allocated
+ * with. Blocks larger than the biggest size class are not reused.
+ */
+void arena_free(Arena arena, void *block, size_t size)
+{
+	assert(arena);
+
+	if (block == NULL)
+	{
+		return;
+	}
+
+	size = arena_round(size);
+	arena->used -= size;
+
+	if (size <= ARENA_CLASS_MAX)
+	{
+		memcpy(block, &arena->free_lists[size / ARENA_ALIGN], sizeof(void *));
+		arena->free_lists[size / ARENA_ALIGN] = block;
+	}
+}
+
+/*
+ * Forget every allocation but keep the newest chunk for reuse.
+ */
+void arena_reset(Arena arena)
+{
+	struct ArenaChunk *chunk, *next;
+
+	assert(arena);
+
+	if (arena->chunks != NULL)
+	{
+		for (chunk = arena->chunks->next; chunk != NULL; chunk = next)
+		{
+			next = chunk->next;
+			free(chunk);
+		}
+		arena->chunks->next = NULL;
+		arena->chunks->used = 0;
+		arena->reserved = arena->chunks->size;
+	}
+
+	memset(arena->free_lists, 0, sizeof(arena->free_lists));
+	arena->used = 0;
+}
+
+size_t arena_get_used(Arena arena)
+{
+	assert(arena);
+
+	return arena->used;
+}
+
+size_t arena_get_reserved(Arena arena)
+{
+	assert(arena);
+
+	return arena->reserved;
+}
+
+void arena_clear(Arena arena)
+{
+	struct ArenaChunk *chunk, *next;
+
+	assert(arena);
+
+	for (chunk = arena->chunks; chunk != NULL; chunk = next)
+	{
+		next = chunk->next;
+		free(chunk);
+	}
+
+	memset(arena, 0, sizeof(*arena));
+}
+
+size_t arena_sizeof(void)
+{
+	return sizeof(struct Arena);
+}
+
+/*
+ * Every block is at least big enough to hold a free list pointer.
+ */
+static size_t arena_round(size_t size)
+{
+	if (size < sizeof(void *))
+	{
+		size = sizeof(void *);
+	}
+
+	return (size + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1);
+}
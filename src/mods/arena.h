@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H 1
+
+#include <stddef.h>
+
+#define ARENA_CHUNK_DEFAULT  0x100000
+#define ARENA_ALIGN          8
+#define ARENA_CLASS_MAX      10008
+
+typedef struct Arena *Arena;
+
+int arena_new(Arena, size_t);
+void *arena_alloc(Arena, size_t);
+void arena_free(Arena, void *, size_t);
+void arena_reset(Arena);
+size_t arena_get_used(Arena);
+size_t arena_get_reserved(Arena);
+void arena_clear(Arena);
+size_t arena_sizeof(void);
+
+#endif
@@ -62,7 +62,13 @@ int base32_encode_raw(unsigned char *output, unsigned char *data, size_t data_le
 			}
 		}
 	}
-	r = ++k / 5;
+	// Pad a partial last group with zero bits.
+	r = k / 5;
+	if (k % 5 != 0)
+	{
+		*output <<= 5 - (k % 5);
+		++r;
+	}
 
 	return r;
 }
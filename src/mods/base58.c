@@ -61,7 +61,7 @@ int base58_encode(char *output, unsigned char *input, size_t input_len)
 
 int base58_decode(unsigned char *output, char *input)
 {
-	int i, j;
+	int i, j, zeros;
 	size_t r, input_len;
 	mpz_t x, b;
 	
@@ -69,6 +69,12 @@ int base58_decode(unsigned char *output, char *input)
 	assert(output);
 
 	input_len = strlen(input);
+
+	// Each leading zero byte is encoded as a leading '1'.
+	for (zeros = 0; zeros < (int)input_len && input[zeros] == code_string[0]; ++zeros)
+	{
+		output[zeros] = 0x00;
+	}
 	
 	mpz_init(x);
 	mpz_init(b);
@@ -91,12 +97,16 @@ int base58_decode(unsigned char *output, char *input)
 		mpz_add_ui(x, x, j);
 	}
 
-	mpz_export(output, &r, 1, 1, 1, 0, x);
+	r = 0;
+	if (mpz_sgn(x) != 0)
+	{
+		mpz_export(output + zeros, &r, 1, 1, 1, 0, x);
+	}
 	
 	mpz_clear(x);
 	mpz_clear(b);
 	
-	return (int)r;
+	return zeros + (int)r;
 }
 
 int base58_ischar(char c)
@@ -7,6 +7,7 @@
 
 #include <stddef.h>
 #include <string.h>
+#include <ctype.h>
 #include <stdint.h>
 #include <assert.h>
 #include "bech32.h"
@@ -17,12 +18,19 @@
 #define BECH32_PREFIX_MAINNET         "bc"
 #define BECH32_PREFIX_TESTNET         "tb"
 #define BECH32_SEPARATOR              '1'
-#define BECH32_VERSION_BYTE           0
 #define BECH32_CHECKSUM_LENGTH        6
+#define BECH32_CONST                  1
+#define BECH32M_CONST                 0x2bc830a3
+#define BECH32_ADDRESS_MAXLEN         90
 
 static uint32_t bech32_polymod_step(uint8_t value, uint32_t chk);
 
-int bech32_get_address(char *output, unsigned char *data, size_t data_len)
+/*
+ * Encode a witness program as a segwit address for the current network,
+ * with the bech32 checksum for version 0 (BIP173) and bech32m for the
+ * versions after it (BIP350).
+ */
+int bech32_get_address(char *output, int version, unsigned char *data, size_t data_len)
 {
 	int i, l, c, r;
 	char *hrp;
@@ -30,9 +38,9 @@ int bech32_get_address(char *output, unsigned char *data, size_t data_len)
 
 	assert(output);
 	assert(data);
-	assert(data_len);
-	// For now I'm only supporting P2WPKH so the data length can only be 20
-	assert(data_len == 20);
+	assert(version >= 0 && version <= 16);
+	assert(data_len >= 2 && data_len <= BECH32_PROGRAM_MAX);
+	assert(version != 0 || data_len == 20 || data_len == 32);
 
 	chk = 1;
 
@@ -63,14 +71,14 @@ int bech32_get_address(char *output, unsigned char *data, size_t data_len)
 	*(output++) = BECH32_SEPARATOR;
 
 	// version byte
-	c = base32_get_char(BECH32_VERSION_BYTE);
+	c = base32_get_char(version);
 	if (c < 0)
 	{
 		error_log("Could not encode version byte to base32.");
 		return -1;
 	}
 	*(output++) = (char)c;
-	chk = bech32_polymod_step(BECH32_VERSION_BYTE, chk);
+	chk = bech32_polymod_step((uint8_t)version, chk);
 
 	// data
 	r = base32_encode(output, data, data_len);
@@ -98,7 +106,7 @@ int bech32_get_address(char *output, unsigned char *data, size_t data_len)
 		chk = bech32_polymod_step(0, chk);
 	}
 
-	chk ^= 1;
+	chk ^= (version == 0) ? BECH32_CONST : BECH32M_CONST;
 
 	// get/append checksum
 	for (i = 0; i < BECH32_CHECKSUM_LENGTH; ++i)
@@ -118,6 +126,130 @@ int bech32_get_address(char *output, unsigned char *data, size_t data_len)
 	
 }
 
+/*
+ * Decode a segwit address for the current network into its witness
+ * version and program (BIP173, and BIP350 for version 1 and up). Returns
+ * the program length.
+ */
+int bech32_decode(unsigned char *program, int *version, const char *address)
+{
+	int r;
+	size_t i, len, sep, hrp_len, data_len, program_len;
+	uint32_t chk, acc, bits;
+	int lower, upper;
+	char c;
+	const char *hrp;
+	uint8_t data[BECH32_ADDRESS_MAXLEN];
+
+	assert(program);
+	assert(version);
+	assert(address);
+
+	hrp = network_is_test() ? BECH32_PREFIX_TESTNET : BECH32_PREFIX_MAINNET;
+	hrp_len = strlen(hrp);
+
+	len = strlen(address);
+	if (len > BECH32_ADDRESS_MAXLEN)
+	{
+		error_log("Bech32 address is too long.");
+		return -1;
+	}
+
+	// Either case is allowed, but not both.
+	for (lower = upper = 0, i = 0; i < len; ++i)
+	{
+		lower |= islower((unsigned char)address[i]) != 0;
+		upper |= isupper((unsigned char)address[i]) != 0;
+	}
+	if (lower && upper)
+	{
+		error_log("Bech32 address has mixed case.");
+		return -1;
+	}
+
+	for (sep = len; sep > 0 && address[sep - 1] != BECH32_SEPARATOR; --sep)
+		;
+	if (sep == 0 || sep - 1 != hrp_len || len - sep < BECH32_CHECKSUM_LENGTH + 1)
+	{
+		error_log("Bech32 address has the wrong format.");
+		return -1;
+	}
+	for (i = 0; i < hrp_len; ++i)
+	{
+		if (tolower((unsigned char)address[i]) != hrp[i])
+		{
+			error_log("Bech32 address is for a different network.");
+			return -1;
+		}
+	}
+
+	chk = 1;
+	for (i = 0; i < hrp_len; ++i)
+	{
+		chk = bech32_polymod_step(hrp[i] >> 5, chk);
+	}
+	chk = bech32_polymod_step(0, chk);
+	for (i = 0; i < hrp_len; ++i)
+	{
+		chk = bech32_polymod_step(hrp[i] & 31, chk);
+	}
+
+	for (data_len = 0, i = sep; i < len; ++i)
+	{
+		c = (char)tolower((unsigned char)address[i]);
+		r = base32_get_raw(c);
+		if (r < 0)
+		{
+			error_log("Bech32 address has an invalid character.");
+			return -1;
+		}
+		data[data_len++] = (uint8_t)r;
+		chk = bech32_polymod_step((uint8_t)r, chk);
+	}
+
+	*version = data[0];
+	if (*version > 16)
+	{
+		error_log("Bech32 address has an invalid witness version.");
+		return -1;
+	}
+	if (chk != ((*version == 0) ? BECH32_CONST : BECH32M_CONST))
+	{
+		error_log("Bech32 address has an invalid checksum.");
+		return -1;
+	}
+
+	// Regroup the 5 bit values between the version and checksum into
+	// bytes. Leftover bits must be zero padding.
+	for (acc = 0, bits = 0, program_len = 0, i = 1; i < data_len - BECH32_CHECKSUM_LENGTH; ++i)
+	{
+		acc = (acc << 5) | data[i];
+		bits += 5;
+		if (bits >= 8)
+		{
+			bits -= 8;
+			if (program_len == BECH32_PROGRAM_MAX)
+			{
+				error_log("Bech32 address program is too long.");
+				return -1;
+			}
+			program[program_len++] = (acc >> bits) & 0xff;
+		}
+	}
+	if (bits >= 5 || ((acc << (8 - bits)) & 0xff) != 0)
+	{
+		error_log("Bech32 address has invalid padding.");
+		return -1;
+	}
+
+	if (program_len < 2 || (*version == 0 && program_len != 20 && program_len != 32))
+	{
+		error_log("Bech32 address program has an invalid length (%zu).", program_len);
+		return -1;
+	}
+
+	return (int)program_len;
+}
 
 static uint32_t bech32_polymod_step(uint8_t value, uint32_t chk)
 {
@@ -10,6 +10,9 @@
 
 #include <stddef.h>
 
-int bech32_get_address(char *, unsigned char *, size_t);
+#define BECH32_PROGRAM_MAX  40
+
+int bech32_get_address(char *, int, unsigned char *, size_t);
+int bech32_decode(unsigned char *, int *, const char *);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include "blkfile.h"
+#include "network.h"
+#include "serialize.h"
+#include "error.h"
+
+#define BLKFILE_PATH_MAXLEN  4096
+#define BLKFILE_NAME_MAXLEN  sizeof("/blk-2147483648.dat")
+#define BLKFILE_FRAME_LEN    8
+
+struct BlkFile
+{
+	char dir[BLKFILE_PATH_MAXLEN];
+	int number;
+	FILE *fp;
+	size_t size;
+};
+
+static int blkfile_next(BlkFile);
+
+/*
+ * Open a writer that appends blocks to blk*.dat files in the given
+ * directory, using the same magic/size framing as bitcoin core. Numbering
+ * starts after the highest file already present so existing data is never
+ * overwritten.
+ */
+int blkfile_open(BlkFile blk, const char *dir)
+{
+	char path[BLKFILE_PATH_MAXLEN + BLKFILE_NAME_MAXLEN];
+
+	assert(blk);
+	assert(dir);
+
+	if (strlen(dir) >= BLKFILE_PATH_MAXLEN)
+	{
+		error_log("Block file directory path is too long.");
+		return -1;
+	}
+
+	strcpy(blk->dir, dir);
+	blk->fp = NULL;
+	blk->size = 0;
+
+	for (blk->number = 0; ; ++blk->number)
+	{
+		snprintf(path, sizeof(path), "%s/blk%05d.dat", blk->dir, blk->number);
+		if (access(path, F_OK) != 0)
+		{
+			break;
+		}
+	}
+	blk->number--;
+
+	return blkfile_next(blk);
+}
+
+int blkfile_write(BlkFile blk, unsigned char *block, size_t block_len)
+{
+	unsigned char frame[BLKFILE_FRAME_LEN];
+
+	assert(blk);
+	assert(blk->fp);
+	assert(block);
+	assert(block_len);
+
+	if (blk->size > 0 && blk->size + BLKFILE_FRAME_LEN + block_len > BLKFILE_MAX_SIZE)
+	{
+		if (blkfile_next(blk) < 0)
+		{
+			error_log("Could not open next block file.");
+			return -1;
+		}
+	}
+
+	serialize_uint32(frame, network_get_magic(), SERIALIZE_ENDIAN_LIT);
+	serialize_uint32(frame + 4, (uint32_t)block_len, SERIALIZE_ENDIAN_LIT);
+
+	if (fwrite(frame, 1, BLKFILE_FRAME_LEN, blk->fp) != BLKFILE_FRAME_LEN || fwrite(block, 1, block_len, blk->fp) != block_len)
+	{
+		error_log("Could not write to block file blk%05d.dat. Errno %i.", blk->number, errno);
+		return -1;
+	}
+
+	blk->size += BLKFILE_FRAME_LEN + block_len;
+
+	return 1;
+}
+
+void blkfile_close(BlkFile blk)
+{
+	assert(blk);
+
+	if (blk->fp != NULL)
+	{
+		fclose(blk->fp);
+		blk->fp = NULL;
+	}
+}
+
+/*
+ * Map a whole block file read only. An empty file maps to NULL with a
+ * size of zero.
+ */
+int blkfile_map(unsigned char **map, size_t *size, const char *path)
+{
+	int fd;
+	struct stat st;
+
+	assert(map);
+	assert(size);
+	assert(path);
+
+	*map = NULL;
+	*size = 0;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		error_log("Unable to open block file %s. Errno %i.", path, errno);
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0)
+	{
+		error_log("Unable to read block file size. Errno %i.", errno);
+		close(fd);
+		return -1;
+	}
+
+	if (st.st_size == 0)
+	{
+		close(fd);
+		return 1;
+	}
+
+	*map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (*map == MAP_FAILED)
+	{
+		*map = NULL;
+		error_log("Unable to map block file %s. Errno %i.", path, errno);
+		return -1;
+	}
+	*size = (size_t)st.st_size;
+
+	return 1;
+}
+
+void blkfile_unmap(unsigned char *map, size_t size)
+{
+	if (map != NULL)
+	{
+		munmap(map, size);
+	}
+}
+
+/*
+ * Find the next block in a mapped block file, searching from *offset.
+ * Runs of bytes that don't start with the network magic are skipped up
+ * to the next magic and counted in *skipped. The zero padding bitcoin
+ * core leaves at the end of a file ends the search. On success *offset
+ * is the start of the block and *len its size. Returns 0 when there are
+ * no more blocks and -1 if the last frame is cut short.
+ */
+int blkfile_find_block(size_t *offset, size_t *len, size_t *skipped, const unsigned char *map, size_t size)
+{
+	size_t i;
+	uint32_t magic;
+	unsigned char m[4];
+	const unsigned char *next;
+
+	assert(offset);
+	assert(len);
+	assert(skipped);
+
+	magic = network_get_magic();
+	m[0] = magic & 0xff;
+	m[1] = (magic >> 8) & 0xff;
+	m[2] = (magic >> 16) & 0xff;
+	m[3] = (magic >> 24) & 0xff;
+
+	i = *offset;
+	while (i <= size && size - i >= BLKFILE_FRAME_LEN)
+	{
+		if (memcmp(map + i, m, sizeof(m)) != 0)
+		{
+			if (map[i] == 0 && map[i + 1] == 0 && map[i + 2] == 0 && map[i + 3] == 0)
+			{
+				return 0;
+			}
+			for (next = map + i + 1; next + sizeof(m) <= map + size; ++next)
+			{
+				next = memchr(next, m[0], (size_t)(map + size - next));
+				if (next == NULL || memcmp(next, m, sizeof(m)) == 0)
+				{
+					break;
+				}
+			}
+			if (next == NULL || next + sizeof(m) > map + size)
+			{
+				*skipped += size - i;
+				return 0;
+			}
+			*skipped += (size_t)(next - map) - i;
+			i = (size_t)(next - map);
+			continue;
+		}
+
+		*len = (size_t)map[i + 4] | ((size_t)map[i + 5] << 8) | ((size_t)map[i + 6] << 16) | ((size_t)map[i + 7] << 24);
+		if (*len > size - i - BLKFILE_FRAME_LEN)
+		{
+			*skipped += size - i;
+			error_log("Block file ends in the middle of a block.");
+			return -1;
+		}
+
+		*offset = i + BLKFILE_FRAME_LEN;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+size_t blkfile_sizeof(void)
+{
+	return sizeof(struct BlkFile);
+}
+
+static int blkfile_next(BlkFile blk)
+{
+	char path[BLKFILE_PATH_MAXLEN + BLKFILE_NAME_MAXLEN];
+
+	blkfile_close(blk);
+
+	blk->number++;
+	blk->size = 0;
+
+	snprintf(path, sizeof(path), "%s/blk%05d.dat", blk->dir, blk->number);
+
+	blk->fp = fopen(path, "wb");
+	if (blk->fp == NULL)
+	{
+		error_log("Unable to open block file %s. Errno %i.", path, errno);
+		return -1;
+	}
+
+	return 1;
+}
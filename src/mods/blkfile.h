@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef BLKFILE_H
+#define BLKFILE_H 1
+
+#include <stddef.h>
+
+#define BLKFILE_MAX_SIZE  0x8000000
+
+typedef struct BlkFile *BlkFile;
+
+int blkfile_open(BlkFile, const char *);
+int blkfile_write(BlkFile, unsigned char *, size_t);
+void blkfile_close(BlkFile);
+int blkfile_map(unsigned char **, size_t *, const char *);
+void blkfile_unmap(unsigned char *, size_t);
+int blkfile_find_block(size_t *, size_t *, size_t *, const unsigned char *, size_t);
+size_t blkfile_sizeof(void);
+
+#endif
@@ -0,0 +1,589 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <assert.h>
+#include "blkscan.h"
+#include "threadpool.h"
+#include "txview.h"
+#include "block.h"
+#include "blkfile.h"
+#include "script.h"
+#include "arena.h"
+#include "hex.h"
+#include "error.h"
+
+#define BLKSCAN_NAME_MAXLEN  256
+#define BLKSCAN_OUTPUT_LEN   1024
+
+struct BlkScanJob
+{
+	BlkScan scan;
+	unsigned char *block;
+	size_t block_len;
+	size_t offset;
+	char *out;
+	size_t out_len;
+	size_t out_cap;
+	uint64_t tx_count;
+	int failed;
+	int done;
+};
+
+struct BlkScan
+{
+	ThreadPool pool;
+	int threads;
+	FILE *output;
+	int flags;
+	TxView views[THREADPOOL_THREADS_MAX];
+	Arena arenas[THREADPOOL_THREADS_MAX];
+	struct BlkScanJob *jobs;
+	size_t job_len;
+	size_t job_head;
+	size_t job_count;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+	char name[BLKSCAN_NAME_MAXLEN];
+	uint64_t files;
+	uint64_t blocks;
+	uint64_t tx_total;
+	uint64_t bytes;
+	uint64_t skipped;
+	uint64_t failures;
+	double seconds;
+};
+
+static int blkscan_submit(BlkScan, unsigned char *, size_t, size_t);
+static int blkscan_emit(BlkScan);
+static void blkscan_worker(void *, int);
+static int blkscan_block(struct BlkScanJob *, TxView, Arena);
+static int blkscan_scripts(struct BlkScanJob *, TxView, Arena);
+static int blkscan_script(struct BlkScanJob *, Arena, const unsigned char *, size_t, size_t);
+static int blkscan_printf(struct BlkScanJob *, const char *, ...);
+static uint32_t blkscan_uint32(const unsigned char *);
+
+/*
+ * A scanner hands each block it finds to a pool of workers and writes
+ * their summaries, as JSON lines, in file order. If output is NULL only
+ * the totals are kept. With BLKSCAN_TRANSACTIONS in flags, a line for
+ * every transaction follows the line for its block, and BLKSCAN_SCRIPTS
+ * adds the assembly of its scripts to that line.
+ */
+int blkscan_new(BlkScan scan, int threads, FILE *output, int flags)
+{
+	int i, r;
+
+	assert(scan);
+
+	memset(scan, 0, sizeof(*scan));
+
+	if (threads < 1 || threads > THREADPOOL_THREADS_MAX)
+	{
+		error_log("Thread count must be between 1 and %i.", THREADPOOL_THREADS_MAX);
+		return -1;
+	}
+
+	scan->threads = threads;
+	scan->output = output;
+	scan->flags = flags;
+	scan->job_len = (size_t)threads * BLKSCAN_JOBS_PER_THREAD;
+
+	scan->jobs = calloc(scan->job_len, sizeof(struct BlkScanJob));
+	scan->pool = malloc(threadpool_sizeof());
+	if (scan->jobs == NULL || scan->pool == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	for (i = 0; i < threads; ++i)
+	{
+		scan->views[i] = malloc(txview_sizeof());
+		if (scan->views[i] == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		txview_new(scan->views[i]);
+
+		if (flags & BLKSCAN_SCRIPTS)
+		{
+			scan->arenas[i] = malloc(arena_sizeof());
+			if (scan->arenas[i] == NULL)
+			{
+				error_log("Memory allocation error.");
+				return -1;
+			}
+			arena_new(scan->arenas[i], ARENA_CHUNK_DEFAULT);
+		}
+	}
+
+	pthread_mutex_init(&scan->lock, NULL);
+	pthread_cond_init(&scan->done, NULL);
+
+	// The ring of jobs is never larger than the pool's queue, so
+	// submitting a block never waits on the pool.
+	r = threadpool_new(scan->pool, threads, scan->job_len);
+	if (r < 0)
+	{
+		error_log("Could not start block scanner threads.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Map a blk*.dat file and hand every block framed in it to the workers.
+ * Every block is decoded before this returns, so the mapping can be
+ * dropped.
+ */
+int blkscan_file(BlkScan scan, const char *path)
+{
+	int r, found;
+	size_t size, offset, block_len;
+	unsigned char *map;
+	const char *name;
+	struct timespec start, finish;
+
+	assert(scan);
+	assert(path);
+
+	name = strrchr(path, '/');
+	name = (name == NULL) ? path : name + 1;
+	snprintf(scan->name, BLKSCAN_NAME_MAXLEN, "%s", name);
+
+	r = blkfile_map(&map, &size, path);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	scan->files++;
+
+	if (size == 0)
+	{
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	// Read ahead aggressively and drop pages behind us.
+	madvise(map, size, MADV_SEQUENTIAL);
+	madvise(map, size, MADV_WILLNEED);
+
+	r = 1;
+	offset = 0;
+	while ((found = blkfile_find_block(&offset, &block_len, &scan->skipped, map, size)) > 0)
+	{
+		r = blkscan_submit(scan, map + offset, block_len, offset);
+		if (r < 0)
+		{
+			break;
+		}
+
+		offset += block_len;
+	}
+	if (found < 0)
+	{
+		// A file cut short is counted as a failure, not fatal.
+		error_clear();
+		scan->failures++;
+	}
+
+	while (scan->job_count > 0)
+	{
+		if (blkscan_emit(scan) < 0)
+		{
+			r = -1;
+		}
+	}
+
+	blkfile_unmap(map, size);
+
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+	scan->seconds += (double)(finish.tv_sec - start.tv_sec) + ((double)(finish.tv_nsec - start.tv_nsec) / 1000000000.0);
+
+	if (r < 0)
+	{
+		error_log("Could not scan block file %s.", name);
+		return -1;
+	}
+
+	return 1;
+}
+
+int blkscan_to_json(char *output, BlkScan scan)
+{
+	assert(output);
+	assert(scan);
+
+	output += sprintf(output, "{\n");
+	output += sprintf(output, "  \"files\": %"PRIu64",\n", scan->files);
+	output += sprintf(output, "  \"blocks\": %"PRIu64",\n", scan->blocks);
+	output += sprintf(output, "  \"transactions\": %"PRIu64",\n", scan->tx_total);
+	output += sprintf(output, "  \"bytes\": %"PRIu64",\n", scan->bytes);
+	output += sprintf(output, "  \"skipped_bytes\": %"PRIu64",\n", scan->skipped);
+	output += sprintf(output, "  \"failures\": %"PRIu64",\n", scan->failures);
+	output += sprintf(output, "  \"milliseconds\": %.3f,\n", scan->seconds * 1000.0);
+	output += sprintf(output, "  \"mb_per_second\": %.2f\n", scan->seconds > 0 ? ((double)scan->bytes / 1048576.0) / scan->seconds : 0.0);
+	sprintf(output, "}");
+
+	return 1;
+}
+
+void blkscan_clear(BlkScan scan)
+{
+	int i;
+	size_t j;
+
+	assert(scan);
+
+	if (scan->pool != NULL)
+	{
+		threadpool_clear(scan->pool);
+		free(scan->pool);
+		pthread_mutex_destroy(&scan->lock);
+		pthread_cond_destroy(&scan->done);
+	}
+	for (i = 0; i < scan->threads; ++i)
+	{
+		if (scan->views[i] != NULL)
+		{
+			txview_clear(scan->views[i]);
+			free(scan->views[i]);
+		}
+		if (scan->arenas[i] != NULL)
+		{
+			arena_clear(scan->arenas[i]);
+			free(scan->arenas[i]);
+		}
+	}
+	for (j = 0; scan->jobs != NULL && j < scan->job_len; ++j)
+	{
+		free(scan->jobs[j].out);
+	}
+	free(scan->jobs);
+
+	memset(scan, 0, sizeof(*scan));
+}
+
+size_t blkscan_sizeof(void)
+{
+	return sizeof(struct BlkScan);
+}
+
+/*
+ * Jobs live in a ring so their output can be written in the order the
+ * blocks appear. When the ring is full the oldest job is waited on and
+ * written out before its slot is reused.
+ */
+static int blkscan_submit(BlkScan scan, unsigned char *block, size_t block_len, size_t offset)
+{
+	struct BlkScanJob *job;
+
+	if (scan->job_count == scan->job_len)
+	{
+		if (blkscan_emit(scan) < 0)
+		{
+			return -1;
+		}
+	}
+
+	job = &scan->jobs[(scan->job_head + scan->job_count) % scan->job_len];
+	job->scan = scan;
+	job->block = block;
+	job->block_len = block_len;
+	job->offset = offset;
+	job->out_len = 0;
+	job->tx_count = 0;
+	job->failed = 0;
+	job->done = 0;
+
+	scan->job_count++;
+
+	return threadpool_add(scan->pool, blkscan_worker, job);
+}
+
+static int blkscan_emit(BlkScan scan)
+{
+	struct BlkScanJob *job;
+
+	job = &scan->jobs[scan->job_head];
+
+	pthread_mutex_lock(&scan->lock);
+	while (!job->done)
+	{
+		pthread_cond_wait(&scan->done, &scan->lock);
+	}
+	pthread_mutex_unlock(&scan->lock);
+
+	scan->job_head = (scan->job_head + 1) % scan->job_len;
+	scan->job_count--;
+
+	scan->blocks++;
+	scan->bytes += job->block_len;
+	scan->tx_total += job->tx_count;
+	scan->failures += job->failed;
+
+	if (scan->output != NULL && job->out_len > 0)
+	{
+		if (fwrite(job->out, 1, job->out_len, scan->output) != job->out_len)
+		{
+			error_log("Could not write block scan output. Errno %i.", errno);
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+static void blkscan_worker(void *arg, int thread)
+{
+	struct BlkScanJob *job = arg;
+	BlkScan scan = job->scan;
+	char *error;
+
+	if (blkscan_block(job, scan->views[thread], scan->arenas[thread]) < 0)
+	{
+		job->failed = 1;
+		job->out_len = 0;
+		if (scan->output != NULL)
+		{
+			error = error_get();
+			blkscan_printf(job, "{\"type\": \"block\", \"file\": \"%s\", \"offset\": %zu, \"error\": \"%s\"}\n", scan->name, job->offset, (error != NULL) ? error : "");
+		}
+		error_clear();
+	}
+
+	pthread_mutex_lock(&scan->lock);
+	job->done = 1;
+	pthread_cond_broadcast(&scan->done);
+	pthread_mutex_unlock(&scan->lock);
+}
+
+/*
+ * Decode one block. Runs on a worker thread, so it only touches the job
+ * and this thread's view and arena.
+ */
+static int blkscan_block(struct BlkScanJob *job, TxView tx, Arena arena)
+{
+	int r, n;
+	uint64_t i, tx_count, value, total;
+	size_t j, len;
+	unsigned char *input;
+	unsigned char hash[BLOCK_HASH_LEN];
+	char block_hex[BLOCK_HASH_LEN * 2 + 1];
+	char prev_hex[BLOCK_HASH_LEN * 2 + 1];
+	char merkle_hex[BLOCK_HASH_LEN * 2 + 1];
+	char txid_hex[BLOCK_HASH_LEN * 2 + 1];
+	char line[BLKSCAN_OUTPUT_LEN];
+	BlkScan scan = job->scan;
+
+	r = block_get_hash(hash, job->block, job->block_len);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	r = block_get_tx_start(&tx_count, job->block, job->block_len);
+	if (r < 0)
+	{
+		return -1;
+	}
+	input = job->block + r;
+	len = job->block_len - r;
+
+	hex_hash_to_str(block_hex, hash, BLOCK_HASH_LEN);
+	hex_hash_to_str(prev_hex, job->block + 4, BLOCK_HASH_LEN);
+	hex_hash_to_str(merkle_hex, job->block + 36, BLOCK_HASH_LEN);
+
+	total = 0;
+	for (i = 0; i < tx_count; ++i)
+	{
+		r = txview_parse(tx, input, len);
+		if (r < 0)
+		{
+			error_log("Could not parse transaction %"PRIu64" of block.", i);
+			return -1;
+		}
+
+		for (value = 0, j = 0; j < txview_get_output_count(tx); ++j)
+		{
+			value += txview_get_output(tx, j)->amount;
+		}
+		total += value;
+
+		if (scan->output != NULL && (scan->flags & BLKSCAN_TRANSACTIONS))
+		{
+			if (txview_get_txid(hash, tx) < 0)
+			{
+				return -1;
+			}
+			hex_hash_to_str(txid_hex, hash, BLOCK_HASH_LEN);
+			r = blkscan_printf(job, "{\"type\": \"tx\", \"block\": \"%s\", \"index\": %"PRIu64", \"txid\": \"%s\", \"size\": %zu, \"segwit\": %s, \"inputs\": %zu, \"outputs\": %zu, \"value\": %"PRIu64"",
+			                   block_hex, i, txid_hex, txview_get_len(tx), txview_is_segwit(tx) ? "true" : "false",
+			                   txview_get_input_count(tx), txview_get_output_count(tx), value);
+			if (r > 0 && (scan->flags & BLKSCAN_SCRIPTS))
+			{
+				r = blkscan_scripts(job, tx, arena);
+			}
+			if (r > 0)
+			{
+				r = blkscan_printf(job, "}\n");
+			}
+			if (r < 0)
+			{
+				return -1;
+			}
+		}
+
+		input += txview_get_len(tx);
+		len -= txview_get_len(tx);
+	}
+
+	job->tx_count = tx_count;
+
+	if (scan->output == NULL)
+	{
+		return 1;
+	}
+
+	// The block line goes before its transactions but its totals aren't
+	// known until they're parsed, so it's formatted last and rotated to
+	// the front.
+	n = snprintf(line, sizeof(line), "{\"type\": \"block\", \"file\": \"%s\", \"offset\": %zu, \"hash\": \"%s\", \"version\": %"PRIu32", \"prev_hash\": \"%s\", \"merkle_root\": \"%s\", \"time\": %"PRIu32", \"bits\": %"PRIu32", \"nonce\": %"PRIu32", \"size\": %zu, \"tx_count\": %"PRIu64", \"value\": %"PRIu64"}\n",
+	             scan->name, job->offset, block_hex, blkscan_uint32(job->block), prev_hex, merkle_hex,
+	             blkscan_uint32(job->block + 68), blkscan_uint32(job->block + 72), blkscan_uint32(job->block + 76),
+	             job->block_len, tx_count, total);
+	if (n < 0 || (size_t)n >= sizeof(line))
+	{
+		error_log("Could not format block scan output.");
+		return -1;
+	}
+	r = blkscan_printf(job, "%s", line);
+	if (r < 0)
+	{
+		return -1;
+	}
+	memmove(job->out + n, job->out, job->out_len - n);
+	memcpy(job->out, line, n);
+
+	return 1;
+}
+
+/*
+ * The assembly of every input and output script of a transaction, as two
+ * JSON arrays.
+ */
+static int blkscan_scripts(struct BlkScanJob *job, TxView tx, Arena arena)
+{
+	int r;
+	size_t i;
+	const struct TxViewInput *input;
+	const struct TxViewOutput *output;
+
+	r = blkscan_printf(job, ", \"input_scripts\": [");
+	for (i = 0; r > 0 && i < txview_get_input_count(tx); ++i)
+	{
+		input = txview_get_input(tx, i);
+		r = blkscan_script(job, arena, input->script, input->script_len, i);
+	}
+	if (r > 0)
+	{
+		r = blkscan_printf(job, "], \"output_scripts\": [");
+	}
+	for (i = 0; r > 0 && i < txview_get_output_count(tx); ++i)
+	{
+		output = txview_get_output(tx, i);
+		r = blkscan_script(job, arena, output->script, output->script_len, i);
+	}
+	if (r > 0)
+	{
+		r = blkscan_printf(job, "]");
+	}
+
+	return r;
+}
+
+/*
+ * One script's assembly as a JSON string, from this thread's arena,
+ * which is emptied again after. A script that ends inside a push can't
+ * be disassembled, which is no fault of the block, and is written as
+ * null.
+ */
+static int blkscan_script(struct BlkScanJob *job, Arena arena, const unsigned char *script, size_t script_len, size_t index)
+{
+	int r;
+	char *text;
+
+	text = script_from_raw(arena, script, script_len);
+	if (text == NULL)
+	{
+		error_clear();
+		r = blkscan_printf(job, "%snull", (index > 0) ? ", " : "");
+	}
+	else
+	{
+		r = blkscan_printf(job, "%s\"%s\"", (index > 0) ? ", " : "", text);
+	}
+	arena_reset(arena);
+
+	return r;
+}
+
+static int blkscan_printf(struct BlkScanJob *job, const char *format, ...)
+{
+	int n;
+	size_t cap;
+	char *tmp;
+	va_list args;
+
+	for (;;)
+	{
+		va_start(args, format);
+		n = vsnprintf(job->out + job->out_len, job->out_cap - job->out_len, format, args);
+		va_end(args);
+		if (n < 0)
+		{
+			error_log("Could not format block scan output.");
+			return -1;
+		}
+		if ((size_t)n < job->out_cap - job->out_len)
+		{
+			job->out_len += n;
+			return 1;
+		}
+
+		for (cap = (job->out_cap > 0) ? job->out_cap : BLKSCAN_OUTPUT_LEN * 4; cap <= job->out_len + n; cap *= 2)
+			;
+		tmp = realloc(job->out, cap);
+		if (tmp == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		job->out = tmp;
+		job->out_cap = cap;
+	}
+}
+
+static uint32_t blkscan_uint32(const unsigned char *input)
+{
+	return (uint32_t)input[0] | ((uint32_t)input[1] << 8) | ((uint32_t)input[2] << 16) | ((uint32_t)input[3] << 24);
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef BLKSCAN_H
+#define BLKSCAN_H 1
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define BLKSCAN_JOBS_PER_THREAD  16
+#define BLKSCAN_TRANSACTIONS     1
+#define BLKSCAN_SCRIPTS          2
+
+typedef struct BlkScan *BlkScan;
+
+int blkscan_new(BlkScan, int, FILE *, int);
+int blkscan_file(BlkScan, const char *);
+int blkscan_to_json(char *, BlkScan);
+void blkscan_clear(BlkScan);
+size_t blkscan_sizeof(void);
+
+#endif
@@ -0,0 +1,732 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+#include "blkverify.h"
+#include "threadpool.h"
+#include "txview.h"
+#include "txverify.h"
+#include "interp.h"
+#include "network.h"
+#include "block.h"
+#include "hex.h"
+#include "error.h"
+
+#define BLKVERIFY_OUTPUT_LEN  1024
+#define BLKVERIFY_INITIAL     256
+
+/*
+ * Consensus flags by height, the one block on each network that broke
+ * the P2SH rules before they were enforced, and the one on main that
+ * broke taproot's.
+ */
+#define BLKVERIFY_MAIN_P2SH_EXCEPTION  "00000000000002dc756eebf4f49723ed8d30cc28a5f108eb94b1ba88ac4f9c22"
+#define BLKVERIFY_MAIN_DERSIG          363725
+#define BLKVERIFY_MAIN_CLTV            388381
+#define BLKVERIFY_MAIN_CSV             419328
+#define BLKVERIFY_MAIN_SEGWIT          481824
+#define BLKVERIFY_MAIN_TAPROOT_EXCEPTION  "0000000000000000000f14c35b2d841e986ab5441de8c585d5ffe55ea1e395ad"
+#define BLKVERIFY_TEST_P2SH_EXCEPTION  "00000000dd30457c001f4095d208cc1296b0eed002427aa599874af7a432b105"
+#define BLKVERIFY_TEST_DERSIG          330776
+#define BLKVERIFY_TEST_CLTV            581885
+#define BLKVERIFY_TEST_CSV             770112
+#define BLKVERIFY_TEST_SEGWIT          834624
+
+/*
+ * What an input spends, with the script kept in the batch's script
+ * buffer, which may move while the batch fills.
+ */
+struct BlkVerifySpent
+{
+	uint64_t amount;
+	size_t script;
+	size_t script_len;
+};
+
+struct BlkVerifyBatch;
+
+/*
+ * A run of consecutive transactions in one block, sized by inputs so a
+ * large block is spread over every thread.
+ */
+struct BlkVerifyJob
+{
+	BlkVerify bv;
+	struct BlkVerifyBatch *batch;
+	unsigned char *tx;
+	size_t len;
+	size_t tx_count;
+	size_t input_count;
+	size_t spent;
+	uint32_t height;
+	int flags;
+	uint64_t failures;
+	double seconds;
+	char *out;
+	size_t out_len;
+	size_t out_cap;
+};
+
+struct BlkVerifyBatch
+{
+	struct BlkVerifySpent *spent;
+	size_t spent_count;
+	size_t spent_cap;
+	struct SighashPrevout *prevouts;
+	size_t prevout_cap;
+	unsigned char *scripts;
+	size_t scripts_len;
+	size_t scripts_cap;
+	struct BlkVerifyJob *jobs;
+	size_t job_count;
+	size_t job_cap;
+	size_t pending;
+	int submitted;
+};
+
+/*
+ * Spent outputs are collected into one batch while the workers verify
+ * the other, so replaying the chain and checking its scripts overlap.
+ */
+struct BlkVerify
+{
+	ThreadPool pool;
+	int threads;
+	FILE *output;
+	TxView view;
+	TxView views[THREADPOOL_THREADS_MAX];
+	TxVerify verifiers[THREADPOOL_THREADS_MAX];
+	struct BlkVerifyBatch batches[2];
+	int current;
+	size_t block_spent;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+	struct timespec start;
+	uint64_t blocks;
+	uint64_t inputs;
+	uint64_t failures;
+	double seconds;
+	double cpu_seconds;
+};
+
+static int blkverify_dispatch(BlkVerify);
+static int blkverify_wait(BlkVerify, struct BlkVerifyBatch *);
+static void blkverify_worker(void *, int);
+static void blkverify_run(struct BlkVerifyJob *, TxView, TxVerify);
+static int blkverify_get_flags(const unsigned char *, uint32_t);
+static int blkverify_printf(struct BlkVerifyJob *, const char *, ...);
+static int blkverify_reserve(void **, size_t *, size_t, size_t);
+
+/*
+ * Verify every input of the blocks handed over with threads workers.
+ * Inputs that fail are written to output as JSON lines, in chain order.
+ */
+int blkverify_new(BlkVerify bv, int threads, FILE *output)
+{
+	int i, r;
+
+	assert(bv);
+	assert(output);
+
+	memset(bv, 0, sizeof(*bv));
+
+	if (threads < 1 || threads > THREADPOOL_THREADS_MAX)
+	{
+		error_log("Thread count must be between 1 and %i.", THREADPOOL_THREADS_MAX);
+		return -1;
+	}
+
+	bv->threads = threads;
+	bv->output = output;
+
+	bv->pool = malloc(threadpool_sizeof());
+	bv->view = malloc(txview_sizeof());
+	if (bv->pool == NULL || bv->view == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	txview_new(bv->view);
+
+	for (i = 0; i < threads; ++i)
+	{
+		bv->views[i] = malloc(txview_sizeof());
+		bv->verifiers[i] = malloc(txverify_sizeof());
+		if (bv->views[i] == NULL || bv->verifiers[i] == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		txview_new(bv->views[i]);
+		if (txverify_new(bv->verifiers[i]) < 0)
+		{
+			return -1;
+		}
+	}
+
+	pthread_mutex_init(&bv->lock, NULL);
+	pthread_cond_init(&bv->done, NULL);
+
+	r = threadpool_new(bv->pool, threads, (size_t)threads * 16);
+	if (r < 0)
+	{
+		error_log("Could not start verification threads.");
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &bv->start);
+
+	return 1;
+}
+
+/*
+ * A utxo spend hook. Records what each input of the block being applied
+ * spends, in the order they appear.
+ */
+int blkverify_spend(void *ctx, Utxo utxo, const struct UtxoRecord *record)
+{
+	int r;
+	BlkVerify bv = ctx;
+	struct BlkVerifyBatch *batch;
+	struct BlkVerifySpent *spent;
+
+	batch = &bv->batches[bv->current];
+
+	if (blkverify_reserve((void **)&batch->spent, &batch->spent_cap, batch->spent_count + 1, sizeof(*batch->spent)) < 0)
+	{
+		return -1;
+	}
+	if (blkverify_reserve((void **)&batch->scripts, &batch->scripts_cap, batch->scripts_len + UTXO_SCRIPT_MAX, 1) < 0)
+	{
+		return -1;
+	}
+
+	r = utxo_get_script(batch->scripts + batch->scripts_len, utxo, record);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	spent = &batch->spent[batch->spent_count++];
+	spent->amount = record->amount;
+	spent->script = batch->scripts_len;
+	spent->script_len = (size_t)r;
+	batch->scripts_len += (size_t)r;
+
+	return 1;
+}
+
+/*
+ * Queue the inputs of a block that has just been applied to the utxo
+ * set, whose spends the hook has collected. The block must stay mapped
+ * until blkverify_finish().
+ */
+int blkverify_add_block(BlkVerify bv, unsigned char *block, size_t block_len, uint32_t height)
+{
+	int r, flags;
+	uint64_t i, tx_count;
+	size_t len, spent, inputs;
+	unsigned char *input;
+	unsigned char hash[BLOCK_HASH_LEN];
+	struct BlkVerifyBatch *batch;
+	struct BlkVerifyJob *job;
+
+	assert(bv);
+	assert(block);
+
+	batch = &bv->batches[bv->current];
+
+	r = block_get_hash(hash, block, block_len);
+	if (r < 0)
+	{
+		return -1;
+	}
+	flags = blkverify_get_flags(hash, height);
+
+	r = block_get_tx_start(&tx_count, block, block_len);
+	if (r < 0)
+	{
+		return -1;
+	}
+	input = block + r;
+	len = block_len - r;
+
+	job = NULL;
+	spent = bv->block_spent;
+	for (i = 0; i < tx_count; ++i)
+	{
+		r = txview_parse(bv->view, input, len);
+		if (r < 0)
+		{
+			error_log("Could not parse transaction %"PRIu64" of block at height %"PRIu32".", i, height);
+			return -1;
+		}
+
+		// The coinbase has nothing to verify, so jobs start after it.
+		inputs = (i == 0) ? 0 : txview_get_input_count(bv->view);
+		if (inputs > 0 && (job == NULL || job->input_count >= BLKVERIFY_JOB_INPUTS))
+		{
+			if (blkverify_reserve((void **)&batch->jobs, &batch->job_cap, batch->job_count + 1, sizeof(*batch->jobs)) < 0)
+			{
+				return -1;
+			}
+			job = &batch->jobs[batch->job_count++];
+			job->bv = bv;
+			job->batch = batch;
+			job->tx = input;
+			job->len = len;
+			job->tx_count = 0;
+			job->input_count = 0;
+			job->spent = spent;
+			job->height = height;
+			job->flags = flags;
+			job->failures = 0;
+			job->seconds = 0;
+			job->out_len = 0;
+		}
+		if (job != NULL)
+		{
+			job->tx_count++;
+			job->input_count += inputs;
+		}
+		spent += inputs;
+
+		input += r;
+		len -= r;
+	}
+
+	if (spent != batch->spent_count)
+	{
+		error_log("Block at height %"PRIu32" spent %zu outputs but has %zu inputs.", height, batch->spent_count - bv->block_spent, spent - bv->block_spent);
+		return -1;
+	}
+	bv->block_spent = spent;
+	bv->blocks++;
+
+	if (batch->spent_count >= BLKVERIFY_BATCH_INPUTS)
+	{
+		return blkverify_dispatch(bv);
+	}
+
+	return 1;
+}
+
+/*
+ * Verify whatever is still queued and wait for it.
+ */
+int blkverify_finish(BlkVerify bv)
+{
+	struct timespec now;
+
+	assert(bv);
+
+	if (blkverify_dispatch(bv) < 0)
+	{
+		return -1;
+	}
+	if (blkverify_wait(bv, &bv->batches[!bv->current]) < 0)
+	{
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	bv->seconds = (double)(now.tv_sec - bv->start.tv_sec) + ((double)(now.tv_nsec - bv->start.tv_nsec) / 1000000000.0);
+
+	return 1;
+}
+
+/*
+ * Signatures per second per core is measured against the time workers
+ * spent on the CPU, so it doesn't depend on how fast the chain was
+ * replayed.
+ */
+int blkverify_to_json(char *output, BlkVerify bv)
+{
+	int i;
+	uint64_t sigs;
+
+	assert(output);
+	assert(bv);
+
+	for (sigs = 0, i = 0; i < bv->threads; ++i)
+	{
+		sigs += txverify_get_sig_count(bv->verifiers[i]);
+	}
+
+	output += sprintf(output, "{\n");
+	output += sprintf(output, "  \"blocks\": %"PRIu64",\n", bv->blocks);
+	output += sprintf(output, "  \"inputs\": %"PRIu64",\n", bv->inputs);
+	output += sprintf(output, "  \"signatures\": %"PRIu64",\n", sigs);
+	output += sprintf(output, "  \"failures\": %"PRIu64",\n", bv->failures);
+	output += sprintf(output, "  \"threads\": %i,\n", bv->threads);
+	output += sprintf(output, "  \"milliseconds\": %.3f,\n", bv->seconds * 1000.0);
+	output += sprintf(output, "  \"signatures_per_second\": %.1f,\n", bv->seconds > 0 ? (double)sigs / bv->seconds : 0.0);
+	output += sprintf(output, "  \"signatures_per_second_per_core\": %.1f\n", bv->cpu_seconds > 0 ? (double)sigs / bv->cpu_seconds : 0.0);
+	sprintf(output, "}");
+
+	return 1;
+}
+
+void blkverify_clear(BlkVerify bv)
+{
+	int i;
+	size_t j, k;
+
+	assert(bv);
+
+	if (bv->pool != NULL)
+	{
+		threadpool_clear(bv->pool);
+		free(bv->pool);
+		pthread_mutex_destroy(&bv->lock);
+		pthread_cond_destroy(&bv->done);
+	}
+	if (bv->view != NULL)
+	{
+		txview_clear(bv->view);
+		free(bv->view);
+	}
+	for (i = 0; i < bv->threads; ++i)
+	{
+		if (bv->views[i] != NULL)
+		{
+			txview_clear(bv->views[i]);
+			free(bv->views[i]);
+		}
+		if (bv->verifiers[i] != NULL)
+		{
+			txverify_clear(bv->verifiers[i]);
+			free(bv->verifiers[i]);
+		}
+	}
+	for (j = 0; j < 2; ++j)
+	{
+		for (k = 0; k < bv->batches[j].job_cap; ++k)
+		{
+			free(bv->batches[j].jobs[k].out);
+		}
+		free(bv->batches[j].jobs);
+		free(bv->batches[j].spent);
+		free(bv->batches[j].prevouts);
+		free(bv->batches[j].scripts);
+	}
+
+	memset(bv, 0, sizeof(*bv));
+}
+
+size_t blkverify_sizeof(void)
+{
+	return sizeof(struct BlkVerify);
+}
+
+/*
+ * Hand the filling batch to the workers, then wait out the batch before
+ * it and start filling that one.
+ */
+static int blkverify_dispatch(BlkVerify bv)
+{
+	size_t i;
+	struct BlkVerifyBatch *batch;
+
+	batch = &bv->batches[bv->current];
+	if (batch->job_count == 0)
+	{
+		batch->spent_count = 0;
+		batch->scripts_len = 0;
+		bv->block_spent = 0;
+		return 1;
+	}
+
+	// The scripts won't move again until the batch is emptied, so the
+	// spent outputs can be pointed at for taproot signature hashes.
+	if (blkverify_reserve((void **)&batch->prevouts, &batch->prevout_cap, batch->spent_count, sizeof(*batch->prevouts)) < 0)
+	{
+		return -1;
+	}
+	for (i = 0; i < batch->spent_count; ++i)
+	{
+		batch->prevouts[i].amount = batch->spent[i].amount;
+		batch->prevouts[i].script = batch->scripts + batch->spent[i].script;
+		batch->prevouts[i].script_len = batch->spent[i].script_len;
+	}
+
+	batch->pending = batch->job_count;
+	batch->submitted = 1;
+	for (i = 0; i < batch->job_count; ++i)
+	{
+		if (threadpool_add(bv->pool, blkverify_worker, &batch->jobs[i]) < 0)
+		{
+			return -1;
+		}
+	}
+
+	bv->current = !bv->current;
+	bv->block_spent = 0;
+
+	return blkverify_wait(bv, &bv->batches[bv->current]);
+}
+
+/*
+ * Wait for a submitted batch, write out its failures and empty it.
+ */
+static int blkverify_wait(BlkVerify bv, struct BlkVerifyBatch *batch)
+{
+	size_t i;
+	struct BlkVerifyJob *job;
+
+	if (!batch->submitted)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&bv->lock);
+	while (batch->pending > 0)
+	{
+		pthread_cond_wait(&bv->done, &bv->lock);
+	}
+	pthread_mutex_unlock(&bv->lock);
+
+	for (i = 0; i < batch->job_count; ++i)
+	{
+		job = &batch->jobs[i];
+		bv->inputs += job->input_count;
+		bv->failures += job->failures;
+		bv->cpu_seconds += job->seconds;
+		if (job->out_len > 0 && fwrite(job->out, 1, job->out_len, bv->output) != job->out_len)
+		{
+			error_log("Could not write verification output. Errno %i.", errno);
+			return -1;
+		}
+	}
+
+	batch->spent_count = 0;
+	batch->scripts_len = 0;
+	batch->job_count = 0;
+	batch->submitted = 0;
+
+	return 1;
+}
+
+/*
+ * Runs on a worker thread, so it only touches the job, its batch, which
+ * isn't written while submitted, and this thread's view and verifier.
+ * Schnorr signatures are checked together at the end of the job, and
+ * only if that fails is the job run again signature by signature to
+ * report which inputs are bad.
+ */
+static void blkverify_worker(void *arg, int thread)
+{
+	struct timespec start, finish;
+	struct BlkVerifyJob *job = arg;
+	struct BlkVerifyBatch *batch = job->batch;
+	BlkVerify bv = job->bv;
+	TxView tx = bv->views[thread];
+	TxVerify v = bv->verifiers[thread];
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+
+	txverify_set_batch(v, 1);
+	blkverify_run(job, tx, v);
+	if (!txverify_batch_verify(v))
+	{
+		job->failures = 0;
+		job->out_len = 0;
+		txverify_set_batch(v, 0);
+		blkverify_run(job, tx, v);
+	}
+	txverify_set_batch(v, 0);
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &finish);
+	job->seconds = (double)(finish.tv_sec - start.tv_sec) + ((double)(finish.tv_nsec - start.tv_nsec) / 1000000000.0);
+
+	pthread_mutex_lock(&bv->lock);
+	if (--batch->pending == 0)
+	{
+		pthread_cond_broadcast(&bv->done);
+	}
+	pthread_mutex_unlock(&bv->lock);
+}
+
+static void blkverify_run(struct BlkVerifyJob *job, TxView tx, TxVerify v)
+{
+	int r;
+	size_t i, j, len, spent, count;
+	unsigned char *input;
+	unsigned char txid[TXVIEW_HASH_LEN];
+	char txid_hex[TXVIEW_HASH_LEN * 2 + 1];
+	char *error;
+	struct BlkVerifyBatch *batch = job->batch;
+	struct BlkVerifySpent *s;
+
+	input = job->tx;
+	len = job->len;
+	spent = job->spent;
+	for (i = 0; i < job->tx_count; ++i)
+	{
+		// Already parsed once when the job was made.
+		r = txview_parse(tx, input, len);
+		assert(r > 0);
+		txverify_set_tx(v, tx);
+
+		count = txview_get_input_count(tx);
+		txverify_set_prevouts(v, batch->prevouts + spent, count);
+
+		for (j = 0; j < count; ++j)
+		{
+			s = &batch->spent[spent++];
+			if (txverify_input(v, j, batch->scripts + s->script, s->script_len, s->amount, job->flags) < 0)
+			{
+				job->failures++;
+				error = error_get();
+				txview_get_txid(txid, tx);
+				hex_hash_to_str(txid_hex, txid, TXVIEW_HASH_LEN);
+				blkverify_printf(job, "{\"type\": \"failure\", \"height\": %"PRIu32", \"txid\": \"%s\", \"input\": %zu, \"error\": \"%s\"}\n", job->height, txid_hex, j, (error != NULL) ? error : "");
+				error_clear();
+			}
+		}
+
+		input += r;
+		len -= (size_t)r;
+	}
+}
+
+/*
+ * P2SH, segwit and taproot apply to every block but the exceptions,
+ * since no other earlier block breaks them. The rest start at their
+ * activation heights.
+ */
+static int blkverify_get_flags(const unsigned char *hash, uint32_t height)
+{
+	int flags;
+	char hex[BLOCK_HASH_LEN * 2 + 1];
+	const char *exception, *taproot_exception;
+	uint32_t dersig, cltv, csv, segwit;
+
+	if (network_is_test())
+	{
+		exception = BLKVERIFY_TEST_P2SH_EXCEPTION;
+		taproot_exception = NULL;
+		dersig = BLKVERIFY_TEST_DERSIG;
+		cltv = BLKVERIFY_TEST_CLTV;
+		csv = BLKVERIFY_TEST_CSV;
+		segwit = BLKVERIFY_TEST_SEGWIT;
+	}
+	else
+	{
+		exception = BLKVERIFY_MAIN_P2SH_EXCEPTION;
+		taproot_exception = BLKVERIFY_MAIN_TAPROOT_EXCEPTION;
+		dersig = BLKVERIFY_MAIN_DERSIG;
+		cltv = BLKVERIFY_MAIN_CLTV;
+		csv = BLKVERIFY_MAIN_CSV;
+		segwit = BLKVERIFY_MAIN_SEGWIT;
+	}
+
+	flags = INTERP_VERIFY_P2SH | INTERP_VERIFY_WITNESS | INTERP_VERIFY_TAPROOT;
+
+	hex_hash_to_str(hex, hash, BLOCK_HASH_LEN);
+	if (strcmp(hex, exception) == 0)
+	{
+		flags = INTERP_VERIFY_NONE;
+	}
+	else if (taproot_exception != NULL && strcmp(hex, taproot_exception) == 0)
+	{
+		flags = INTERP_VERIFY_P2SH | INTERP_VERIFY_WITNESS;
+	}
+
+	if (height >= dersig)
+	{
+		flags |= INTERP_VERIFY_DERSIG;
+	}
+	if (height >= cltv)
+	{
+		flags |= INTERP_VERIFY_CLTV;
+	}
+	if (height >= csv)
+	{
+		flags |= INTERP_VERIFY_CSV;
+	}
+	if (height >= segwit)
+	{
+		flags |= INTERP_VERIFY_NULLDUMMY;
+	}
+
+	return flags;
+}
+
+static int blkverify_printf(struct BlkVerifyJob *job, const char *format, ...)
+{
+	int n;
+	size_t cap;
+	char *tmp;
+	va_list args;
+
+	for (;;)
+	{
+		va_start(args, format);
+		n = vsnprintf(job->out + job->out_len, job->out_cap - job->out_len, format, args);
+		va_end(args);
+		if (n < 0)
+		{
+			error_log("Could not format verification output.");
+			return -1;
+		}
+		if ((size_t)n < job->out_cap - job->out_len)
+		{
+			job->out_len += n;
+			return 1;
+		}
+
+		for (cap = (job->out_cap > 0) ? job->out_cap : BLKVERIFY_OUTPUT_LEN; cap <= job->out_len + n; cap *= 2)
+			;
+		tmp = realloc(job->out, cap);
+		if (tmp == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		job->out = tmp;
+		job->out_cap = cap;
+	}
+}
+
+static int blkverify_reserve(void **array, size_t *cap, size_t want, size_t size)
+{
+	size_t new_cap;
+	void *tmp;
+
+	if (want <= *cap)
+	{
+		return 1;
+	}
+
+	for (new_cap = (*cap > 0) ? *cap : BLKVERIFY_INITIAL; new_cap < want; new_cap *= 2)
+		;
+
+	tmp = realloc(*array, new_cap * size);
+	if (tmp == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	// New jobs start without an output buffer.
+	memset((unsigned char *)tmp + *cap * size, 0, (new_cap - *cap) * size);
+
+	*array = tmp;
+	*cap = new_cap;
+
+	return 1;
+}
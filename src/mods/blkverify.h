@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef BLKVERIFY_H
+#define BLKVERIFY_H 1
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "utxo.h"
+
+#define BLKVERIFY_BATCH_INPUTS  0x4000
+#define BLKVERIFY_JOB_INPUTS    64
+
+typedef struct BlkVerify *BlkVerify;
+
+int blkverify_new(BlkVerify, int, FILE *);
+int blkverify_spend(void *, Utxo, const struct UtxoRecord *);
+int blkverify_add_block(BlkVerify, unsigned char *, size_t, uint32_t);
+int blkverify_finish(BlkVerify);
+int blkverify_to_json(char *, BlkVerify);
+void blkverify_clear(BlkVerify);
+size_t blkverify_sizeof(void);
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "block.h"
+#include "txview.h"
+#include "crypto.h"
+#include "compactuint.h"
+#include "error.h"
+
+int block_get_hash(unsigned char *output, unsigned char *input, size_t input_len)
+{
+	int r;
+
+	assert(output);
+	assert(input);
+
+	if (input_len < BLOCK_HEADER_LEN)
+	{
+		error_log("Block data (%zu bytes) is shorter than a block header.", input_len);
+		return -1;
+	}
+
+	// The block hash only covers the 80 byte header.
+	r = crypto_get_sha256d(output, input, BLOCK_HEADER_LEN);
+	if (r < 0)
+	{
+		error_log("Could not hash block header.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Find where the transactions begin in a serialized block. The number of
+ * transactions goes in count and the offset of the first one is returned.
+ */
+int block_get_tx_start(uint64_t *count, unsigned char *input, size_t input_len)
+{
+	int r;
+
+	assert(count);
+	assert(input);
+
+	if (input_len <= BLOCK_HEADER_LEN)
+	{
+		error_log("Block data (%zu bytes) has no transactions.", input_len);
+		return -1;
+	}
+
+	r = compactuint_get_value(count, input + BLOCK_HEADER_LEN, input_len - BLOCK_HEADER_LEN);
+	if (r < 0)
+	{
+		error_log("Could not parse block transaction count.");
+		return -1;
+	}
+
+	return BLOCK_HEADER_LEN + r;
+}
+
+/*
+ * Check the merkle root in a serialized block's header against the txids
+ * of the transactions that follow it. Returns 1 if they match, and 0 if
+ * they don't, if the transactions don't fill the block exactly, or if the
+ * tree has a duplicated pair of hashes (CVE-2012-2459), which lets
+ * different transaction lists share a root. Returns -1 if the
+ * transactions can't be parsed.
+ */
+int block_check_merkle_root(TxView tx, unsigned char *input, size_t input_len)
+{
+	int r, mutated;
+	uint64_t i, count;
+	size_t j, level, offset;
+	unsigned char *hashes;
+	unsigned char pair[BLOCK_HASH_LEN * 2];
+
+	assert(tx);
+	assert(input);
+
+	r = block_get_tx_start(&count, input, input_len);
+	if (r < 0)
+	{
+		return -1;
+	}
+	offset = (size_t)r;
+
+	if (count == 0 || count > input_len - offset)
+	{
+		error_log("Block claims %"PRIu64" transactions in %zu bytes.", count, input_len - offset);
+		return -1;
+	}
+
+	hashes = malloc(count * BLOCK_HASH_LEN);
+	if (hashes == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		r = txview_parse(tx, input + offset, input_len - offset);
+		if (r < 0)
+		{
+			error_log("Could not parse transaction %"PRIu64" of block.", i);
+			free(hashes);
+			return -1;
+		}
+		txview_get_txid(hashes + (i * BLOCK_HASH_LEN), tx);
+		offset += (size_t)r;
+	}
+
+	if (offset != input_len)
+	{
+		free(hashes);
+		return 0;
+	}
+
+	// Hash each level in place. An odd hash out is paired with itself.
+	mutated = 0;
+	for (level = (size_t)count; level > 1; level = (level + 1) / 2)
+	{
+		for (j = 0; j < level; j += 2)
+		{
+			memcpy(pair, hashes + (j * BLOCK_HASH_LEN), BLOCK_HASH_LEN);
+			if (j + 1 < level)
+			{
+				memcpy(pair + BLOCK_HASH_LEN, hashes + ((j + 1) * BLOCK_HASH_LEN), BLOCK_HASH_LEN);
+				if (memcmp(pair, pair + BLOCK_HASH_LEN, BLOCK_HASH_LEN) == 0)
+				{
+					mutated = 1;
+				}
+			}
+			else
+			{
+				memcpy(pair + BLOCK_HASH_LEN, pair, BLOCK_HASH_LEN);
+			}
+
+			r = crypto_get_sha256d(hashes + ((j / 2) * BLOCK_HASH_LEN), pair, sizeof(pair));
+			if (r < 0)
+			{
+				error_log("Could not hash merkle tree.");
+				free(hashes);
+				return -1;
+			}
+		}
+	}
+
+	r = (!mutated && memcmp(hashes, input + BLOCK_MERKLE_OFFSET, BLOCK_HASH_LEN) == 0);
+
+	free(hashes);
+
+	return r;
+}
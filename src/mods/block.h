@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef BLOCK_H
+#define BLOCK_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include "txview.h"
+
+#define BLOCK_COMMAND        "block"
+#define BLOCK_HEADER_LEN     80
+#define BLOCK_HASH_LEN       32
+#define BLOCK_MERKLE_OFFSET  36
+
+int block_get_hash(unsigned char *, unsigned char *, size_t);
+int block_get_tx_start(uint64_t *, unsigned char *, size_t);
+int block_check_merkle_root(TxView, unsigned char *, size_t);
+
+#endif
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include "capture.h"
+#include "message.h"
+#include "serialize.h"
+#include "error.h"
+
+#define CAPTURE_MAGIC       "BTKCAP01"
+#define CAPTURE_MAGIC_LEN   8
+#define CAPTURE_FIXED_LEN   14
+
+/*
+ * A capture file starts with CAPTURE_MAGIC and is followed by one record
+ * per framed message, all integers little endian:
+ *
+ *   uint64  microseconds since the epoch
+ *   uint8   direction, CAPTURE_IN or CAPTURE_OUT
+ *   uint8   peer name length
+ *   char[]  peer name
+ *   uint32  frame length
+ *   uchar[] frame, header and payload exactly as on the wire
+ */
+struct Capture
+{
+	FILE *fp;
+	unsigned char *data;
+	size_t data_len;
+	size_t pos;
+};
+
+/*
+ * Open a capture file for appending, writing the file header if the file
+ * is new. Records are never rewritten.
+ */
+int capture_open(Capture c, const char *path)
+{
+	long len;
+
+	assert(c);
+	assert(path);
+
+	memset(c, 0, sizeof(*c));
+
+	c->fp = fopen(path, "ab");
+	if (c->fp == NULL)
+	{
+		error_log("Could not open capture file %s.", path);
+		return -1;
+	}
+
+	fseek(c->fp, 0, SEEK_END);
+	len = ftell(c->fp);
+	if (len == 0)
+	{
+		if (fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, c->fp) != CAPTURE_MAGIC_LEN)
+		{
+			error_log("Could not write capture file header.");
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+int capture_write(Capture c, int direction, const char *peer, unsigned char *frame, size_t frame_len)
+{
+	size_t peer_len;
+	struct timespec ts;
+	unsigned char head[CAPTURE_FIXED_LEN - 4];
+	unsigned char length[4];
+
+	assert(c);
+	assert(c->fp);
+	assert(peer);
+	assert(frame);
+
+	peer_len = strlen(peer);
+	if (peer_len > CAPTURE_PEER_MAXLEN)
+	{
+		peer_len = CAPTURE_PEER_MAXLEN;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	serialize_uint64(head, ((uint64_t)ts.tv_sec * 1000000) + ((uint64_t)ts.tv_nsec / 1000), SERIALIZE_ENDIAN_LIT);
+	head[8] = (unsigned char)direction;
+	head[9] = (unsigned char)peer_len;
+	serialize_uint32(length, (uint32_t)frame_len, SERIALIZE_ENDIAN_LIT);
+
+	if (fwrite(head, 1, sizeof(head), c->fp) != sizeof(head) ||
+	    fwrite(peer, 1, peer_len, c->fp) != peer_len ||
+	    fwrite(length, 1, sizeof(length), c->fp) != sizeof(length) ||
+	    fwrite(frame, 1, frame_len, c->fp) != frame_len)
+	{
+		error_log("Could not write to capture file.");
+		return -1;
+	}
+
+	return 1;
+}
+
+void capture_close(Capture c)
+{
+	assert(c);
+
+	if (c->fp != NULL)
+	{
+		fclose(c->fp);
+		c->fp = NULL;
+	}
+	free(c->data);
+	c->data = NULL;
+}
+
+int capture_is_capture(unsigned char *input, size_t input_len)
+{
+	assert(input);
+
+	return (input_len >= CAPTURE_MAGIC_LEN && memcmp(input, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) == 0);
+}
+
+/*
+ * Read a whole capture file into memory for capture_next(). Records
+ * point into this buffer, so nothing is copied while iterating.
+ */
+int capture_load(Capture c, const char *path)
+{
+	long len;
+	FILE *fp;
+
+	assert(c);
+	assert(path);
+
+	memset(c, 0, sizeof(*c));
+
+	fp = fopen(path, "rb");
+	if (fp == NULL)
+	{
+		error_log("Could not open capture file %s.", path);
+		return -1;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	c->data = malloc(len > 0 ? (size_t)len : 1);
+	if (c->data == NULL)
+	{
+		error_log("Memory allocation error.");
+		fclose(fp);
+		return -1;
+	}
+
+	if (fread(c->data, 1, (size_t)len, fp) != (size_t)len)
+	{
+		error_log("Could not read capture file %s.", path);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+
+	c->data_len = (size_t)len;
+
+	if (!capture_is_capture(c->data, c->data_len))
+	{
+		error_log("File %s is not a capture file.", path);
+		return -1;
+	}
+
+	c->pos = CAPTURE_MAGIC_LEN;
+
+	return 1;
+}
+
+/*
+ * Step to the next record. Returns 1 with a record, 0 at the end of the
+ * capture and -1 if the capture is corrupt. A record cut off at the end of
+ * the file, as a killed capture leaves behind, is corrupt too, so nothing
+ * replays only part of a capture without saying so.
+ */
+int capture_next(struct CaptureRecord *output, Capture c)
+{
+	size_t peer_len, message_len;
+	uint32_t frame_len;
+	unsigned char *p;
+
+	assert(output);
+	assert(c);
+	assert(c->data);
+
+	if (c->pos == c->data_len)
+	{
+		return 0;
+	}
+	if (c->data_len - c->pos < CAPTURE_FIXED_LEN)
+	{
+		error_log("Capture record at offset %zu is truncated.", c->pos);
+		return -1;
+	}
+
+	p = c->data + c->pos;
+
+	deserialize_uint64(&output->time, p, SERIALIZE_ENDIAN_LIT);
+	output->direction = p[8];
+	peer_len = p[9];
+
+	if (output->direction != CAPTURE_IN && output->direction != CAPTURE_OUT)
+	{
+		error_log("Capture record at offset %zu has an unknown direction.", c->pos);
+		return -1;
+	}
+
+	if (c->data_len - c->pos < CAPTURE_FIXED_LEN + peer_len)
+	{
+		error_log("Capture record at offset %zu is truncated.", c->pos);
+		return -1;
+	}
+
+	memcpy(output->peer, p + 10, peer_len);
+	output->peer[peer_len] = '\0';
+
+	deserialize_uint32(&frame_len, p + 10 + peer_len, SERIALIZE_ENDIAN_LIT);
+	if (c->data_len - c->pos - CAPTURE_FIXED_LEN - peer_len < frame_len)
+	{
+		error_log("Capture record at offset %zu is truncated.", c->pos);
+		return -1;
+	}
+
+	output->frame = p + CAPTURE_FIXED_LEN + peer_len;
+
+	// The frame's own header must account for exactly its length
+	if (message_frame_len(&message_len, output->frame, frame_len) <= 0 || message_len != frame_len)
+	{
+		error_log("Capture record at offset %zu does not hold one whole message.", c->pos);
+		return -1;
+	}
+	output->frame_len = frame_len;
+
+	c->pos += CAPTURE_FIXED_LEN + peer_len + frame_len;
+
+	return 1;
+}
+
+/*
+ * Size in bytes of a loaded capture.
+ */
+size_t capture_get_len(Capture c)
+{
+	assert(c);
+
+	return c->data_len;
+}
+
+size_t capture_sizeof(void)
+{
+	return sizeof(struct Capture);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CAPTURE_IN          0
+#define CAPTURE_OUT         1
+#define CAPTURE_PEER_MAXLEN 255
+
+struct CaptureRecord
+{
+	uint64_t time;
+	int direction;
+	char peer[CAPTURE_PEER_MAXLEN + 1];
+	unsigned char *frame;
+	size_t frame_len;
+};
+
+typedef struct Capture *Capture;
+
+int capture_open(Capture, const char *);
+int capture_write(Capture, int, const char *, unsigned char *, size_t);
+void capture_close(Capture);
+int capture_is_capture(unsigned char *, size_t);
+int capture_load(Capture, const char *);
+int capture_next(struct CaptureRecord *, Capture);
+size_t capture_get_len(Capture);
+size_t capture_sizeof(void);
+
+#endif
@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <assert.h>
+#include "chain.h"
+#include "blkfile.h"
+#include "block.h"
+#include "error.h"
+
+#define CHAIN_INITIAL      1024
+#define CHAIN_EMPTY_SLOT   UINT32_MAX
+#define CHAIN_NO_PARENT    UINT32_MAX
+#define CHAIN_PREFETCH     8
+
+struct ChainFile
+{
+	unsigned char *map;
+	size_t size;
+};
+
+struct ChainBlock
+{
+	unsigned char hash[BLOCK_HASH_LEN];
+	uint32_t parent;
+	uint32_t file;
+	size_t offset;
+	size_t len;
+	int64_t height;
+	double work;
+};
+
+struct Chain
+{
+	struct ChainFile *files;
+	size_t file_count;
+	size_t file_cap;
+	struct ChainBlock *blocks;
+	size_t block_count;
+	size_t block_cap;
+	uint32_t *table;
+	size_t table_cap;
+	uint32_t *best;
+	size_t best_count;
+};
+
+static uint32_t chain_find(Chain, const unsigned char *);
+static int chain_table_grow(Chain);
+static double chain_work(const unsigned char *);
+
+int chain_new(Chain chain)
+{
+	size_t i;
+
+	assert(chain);
+
+	memset(chain, 0, sizeof(*chain));
+
+	chain->table_cap = CHAIN_INITIAL;
+	chain->table = malloc(sizeof(*chain->table) * chain->table_cap);
+	if (chain->table == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	for (i = 0; i < chain->table_cap; ++i)
+	{
+		chain->table[i] = CHAIN_EMPTY_SLOT;
+	}
+
+	return 1;
+}
+
+/*
+ * Index the blocks in a blk*.dat file. Only their headers are read; the
+ * file stays mapped so the blocks can be handed out later in chain order
+ * without copying. Blocks already seen in another file are ignored.
+ */
+int chain_add_file(Chain chain, const char *path)
+{
+	int r;
+	void *tmp;
+	size_t offset, len, skipped;
+	uint32_t i, h;
+	unsigned char hash[BLOCK_HASH_LEN];
+	struct ChainFile *file;
+	struct ChainBlock *block;
+
+	assert(chain);
+	assert(path);
+
+	if (chain->file_count == chain->file_cap)
+	{
+		chain->file_cap = (chain->file_cap > 0) ? chain->file_cap * 2 : CHAIN_INITIAL;
+		tmp = realloc(chain->files, sizeof(*chain->files) * chain->file_cap);
+		if (tmp == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		chain->files = tmp;
+	}
+
+	file = &chain->files[chain->file_count];
+	r = blkfile_map(&file->map, &file->size, path);
+	if (r < 0)
+	{
+		return -1;
+	}
+	chain->file_count++;
+
+	// Only the headers are touched now, so don't read the rest.
+	if (file->size > 0)
+	{
+		madvise(file->map, file->size, MADV_RANDOM);
+	}
+
+	offset = skipped = 0;
+	while ((r = blkfile_find_block(&offset, &len, &skipped, file->map, file->size)) > 0)
+	{
+		if (len < BLOCK_HEADER_LEN)
+		{
+			offset += len;
+			continue;
+		}
+
+		if (block_get_hash(hash, file->map + offset, len) < 0)
+		{
+			return -1;
+		}
+
+		if (chain_find(chain, hash) != CHAIN_EMPTY_SLOT)
+		{
+			offset += len;
+			continue;
+		}
+
+		if (chain->block_count == chain->block_cap)
+		{
+			chain->block_cap = (chain->block_cap > 0) ? chain->block_cap * 2 : CHAIN_INITIAL;
+			tmp = realloc(chain->blocks, sizeof(*chain->blocks) * chain->block_cap);
+			if (tmp == NULL)
+			{
+				error_log("Memory allocation error.");
+				return -1;
+			}
+			chain->blocks = tmp;
+		}
+		if ((chain->block_count + 1) * 2 > chain->table_cap && chain_table_grow(chain) < 0)
+		{
+			return -1;
+		}
+
+		block = &chain->blocks[chain->block_count];
+		memcpy(block->hash, hash, BLOCK_HASH_LEN);
+		block->file = (uint32_t)(chain->file_count - 1);
+		block->offset = offset;
+		block->len = len;
+		block->parent = CHAIN_NO_PARENT;
+		block->height = -1;
+		block->work = 0;
+
+		memcpy(&h, hash, sizeof(h));
+		for (i = h & (chain->table_cap - 1); chain->table[i] != CHAIN_EMPTY_SLOT; i = (i + 1) & (chain->table_cap - 1))
+			;
+		chain->table[i] = (uint32_t)chain->block_count++;
+
+		offset += len;
+	}
+	if (r < 0)
+	{
+		// The last block of a file still being written can be cut short.
+		error_clear();
+	}
+
+	return 1;
+}
+
+/*
+ * Link every block to its parent and pick the tip with the most work.
+ * The best chain is walked back from the tip, so the blocks on stale
+ * branches are left out. Fails if the best chain doesn't reach back to a
+ * genesis block.
+ */
+int chain_build(Chain chain)
+{
+	size_t i, j, n, tip;
+	uint32_t *stack;
+	struct ChainBlock *block;
+	static const unsigned char zero[BLOCK_HASH_LEN];
+
+	assert(chain);
+
+	free(chain->best);
+	chain->best = NULL;
+	chain->best_count = 0;
+
+	if (chain->block_count == 0)
+	{
+		return 1;
+	}
+
+	for (i = 0; i < chain->block_count; ++i)
+	{
+		block = &chain->blocks[i];
+		block->parent = chain_find(chain, chain->files[block->file].map + block->offset + 4);
+		block->height = -1;
+	}
+
+	stack = malloc(sizeof(*stack) * chain->block_count);
+	if (stack == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	// Heights and work are filled in from each block's nearest known
+	// ancestor down, without recursion.
+	for (i = 0; i < chain->block_count; ++i)
+	{
+		for (n = 0, j = i; j != CHAIN_NO_PARENT && chain->blocks[j].height < 0; j = chain->blocks[j].parent)
+		{
+			stack[n++] = (uint32_t)j;
+		}
+		while (n > 0)
+		{
+			block = &chain->blocks[stack[--n]];
+			if (block->parent == CHAIN_NO_PARENT)
+			{
+				block->height = 0;
+				block->work = chain_work(chain->files[block->file].map + block->offset);
+				// A block whose parent is missing can't start a chain
+				// unless it's a genesis block.
+				if (memcmp(chain->files[block->file].map + block->offset + 4, zero, BLOCK_HASH_LEN) != 0)
+				{
+					block->work = -1;
+				}
+			}
+			else
+			{
+				block->height = chain->blocks[block->parent].height + 1;
+				block->work = chain->blocks[block->parent].work;
+				if (block->work >= 0)
+				{
+					block->work += chain_work(chain->files[block->file].map + block->offset);
+				}
+			}
+		}
+	}
+
+	free(stack);
+
+	for (tip = 0, i = 1; i < chain->block_count; ++i)
+	{
+		if (chain->blocks[i].work > chain->blocks[tip].work)
+		{
+			tip = i;
+		}
+	}
+	if (chain->blocks[tip].work < 0)
+	{
+		error_log("Block files don't contain a genesis block.");
+		return -1;
+	}
+
+	chain->best_count = (size_t)chain->blocks[tip].height + 1;
+	chain->best = malloc(sizeof(*chain->best) * chain->best_count);
+	if (chain->best == NULL)
+	{
+		error_log("Memory allocation error.");
+		chain->best_count = 0;
+		return -1;
+	}
+	for (j = tip, i = chain->best_count; i > 0; --i, j = chain->blocks[j].parent)
+	{
+		chain->best[i - 1] = (uint32_t)j;
+	}
+
+	return 1;
+}
+
+/*
+ * Number of blocks in the best chain, genesis included.
+ */
+size_t chain_get_count(Chain chain)
+{
+	assert(chain);
+
+	return chain->best_count;
+}
+
+/*
+ * Number of distinct blocks found in the files, stale ones included.
+ */
+size_t chain_get_block_count(Chain chain)
+{
+	assert(chain);
+
+	return chain->block_count;
+}
+
+/*
+ * Point at the serialized block at a height in the best chain. Callers
+ * usually walk the chain in order, so the blocks a little way ahead are
+ * prefetched.
+ */
+int chain_get_block(unsigned char **output, size_t *len, Chain chain, size_t height)
+{
+	size_t i;
+	long page;
+	uintptr_t start;
+	struct ChainBlock *block;
+
+	assert(output);
+	assert(len);
+	assert(chain);
+
+	if (height >= chain->best_count)
+	{
+		error_log("Block height %zu is beyond the best chain.", height);
+		return -1;
+	}
+
+	block = &chain->blocks[chain->best[height]];
+	*output = chain->files[block->file].map + block->offset;
+	*len = block->len;
+
+	page = sysconf(_SC_PAGESIZE);
+	for (i = (height == 0) ? 1 : height + CHAIN_PREFETCH; i < chain->best_count && i <= height + CHAIN_PREFETCH; ++i)
+	{
+		block = &chain->blocks[chain->best[i]];
+		start = (uintptr_t)(chain->files[block->file].map + block->offset) & ~((uintptr_t)page - 1);
+		madvise((void *)start, block->len + ((uintptr_t)(chain->files[block->file].map + block->offset) - start), MADV_WILLNEED);
+	}
+
+	return 1;
+}
+
+/*
+ * Hash of the block at a height in the best chain, in internal byte order.
+ */
+int chain_get_hash(unsigned char *output, Chain chain, size_t height)
+{
+	assert(output);
+	assert(chain);
+
+	if (height >= chain->best_count)
+	{
+		error_log("Block height %zu is beyond the best chain.", height);
+		return -1;
+	}
+
+	memcpy(output, chain->blocks[chain->best[height]].hash, BLOCK_HASH_LEN);
+
+	return 1;
+}
+
+void chain_clear(Chain chain)
+{
+	size_t i;
+
+	assert(chain);
+
+	for (i = 0; i < chain->file_count; ++i)
+	{
+		blkfile_unmap(chain->files[i].map, chain->files[i].size);
+	}
+	free(chain->files);
+	free(chain->blocks);
+	free(chain->table);
+	free(chain->best);
+
+	memset(chain, 0, sizeof(*chain));
+}
+
+size_t chain_sizeof(void)
+{
+	return sizeof(struct Chain);
+}
+
+/*
+ * Block hashes are already uniformly distributed, so their first bytes
+ * make a fine table index.
+ */
+static uint32_t chain_find(Chain chain, const unsigned char *hash)
+{
+	uint32_t i, h;
+
+	memcpy(&h, hash, sizeof(h));
+	for (i = h & (chain->table_cap - 1); chain->table[i] != CHAIN_EMPTY_SLOT; i = (i + 1) & (chain->table_cap - 1))
+	{
+		if (memcmp(chain->blocks[chain->table[i]].hash, hash, BLOCK_HASH_LEN) == 0)
+		{
+			return chain->table[i];
+		}
+	}
+
+	return CHAIN_EMPTY_SLOT;
+}
+
+static int chain_table_grow(Chain chain)
+{
+	size_t i;
+	uint32_t j, h, *table;
+
+	table = malloc(sizeof(*table) * chain->table_cap * 2);
+	if (table == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	free(chain->table);
+	chain->table = table;
+	chain->table_cap *= 2;
+
+	for (i = 0; i < chain->table_cap; ++i)
+	{
+		chain->table[i] = CHAIN_EMPTY_SLOT;
+	}
+	for (i = 0; i < chain->block_count; ++i)
+	{
+		memcpy(&h, chain->blocks[i].hash, sizeof(h));
+		for (j = h & (chain->table_cap - 1); chain->table[j] != CHAIN_EMPTY_SLOT; j = (j + 1) & (chain->table_cap - 1))
+			;
+		chain->table[j] = (uint32_t)i;
+	}
+
+	return 1;
+}
+
+/*
+ * Expected number of hashes to find a block at the header's target,
+ * 2^256 / (target + 1). Only used to compare chains, so a double is
+ * plenty.
+ */
+static double chain_work(const unsigned char *header)
+{
+	int i, exponent;
+	uint32_t mantissa;
+	double work;
+
+	exponent = header[75];
+	mantissa = (uint32_t)header[72] | ((uint32_t)header[73] << 8) | ((uint32_t)(header[74] & 0x7f) << 16);
+	if (mantissa == 0)
+	{
+		return 0;
+	}
+
+	// target = mantissa * 256^(exponent - 3)
+	for (work = 1.0, i = 0; i < 32 - (exponent - 3); ++i)
+	{
+		work *= 256.0;
+	}
+
+	return work / mantissa;
+}
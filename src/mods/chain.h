@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef CHAIN_H
+#define CHAIN_H 1
+
+#include <stddef.h>
+
+typedef struct Chain *Chain;
+
+int chain_new(Chain);
+int chain_add_file(Chain, const char *);
+int chain_build(Chain);
+size_t chain_get_count(Chain);
+size_t chain_get_block_count(Chain);
+int chain_get_block(unsigned char **, size_t *, Chain, size_t);
+int chain_get_hash(unsigned char *, Chain, size_t);
+void chain_clear(Chain);
+size_t chain_sizeof(void);
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include "addr.h"
+#include "mods/serialize.h"
+#include "mods/compactuint.h"
+#include "mods/error.h"
+
+#define ADDR_V1_ENTRY_LEN   30
+#define ADDR_V2_ADDR_LIMIT  512
+#define ADDR_IP_LEN         16
+
+struct Addr
+{
+	size_t count;
+	struct AddrEntry entries[ADDR_MAX_COUNT];
+};
+
+static const unsigned char ipv4_prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+/*
+ * Parse the payload of an addr message, or an addrv2 message (BIP155) if
+ * v2 is set. Entries for networks with addresses longer than we store are
+ * skipped rather than treated as an error.
+ */
+int addr_deserialize(Addr a, unsigned char *input, size_t input_len, int v2)
+{
+	int r;
+	size_t i;
+	uint64_t count, value;
+	struct AddrEntry *e;
+
+	assert(a);
+	assert(input);
+
+	a->count = 0;
+
+	if (input_len == 0)
+	{
+		error_log("Address message is empty.");
+		return -1;
+	}
+
+	r = compactuint_get_value(&count, input, input_len);
+	if (r < 0)
+	{
+		error_log("Could not parse address count.");
+		return -1;
+	}
+	input += r;
+	input_len -= r;
+
+	if (count > ADDR_MAX_COUNT)
+	{
+		error_log("Address count (%llu) exceeds the limit of %i.", (unsigned long long)count, ADDR_MAX_COUNT);
+		return -1;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		e = &a->entries[a->count];
+
+		if (!v2)
+		{
+			if (input_len < ADDR_V1_ENTRY_LEN)
+			{
+				error_log("Address data is incomplete.");
+				return -1;
+			}
+			input = deserialize_uint32(&e->time, input, SERIALIZE_ENDIAN_LIT);
+			input = deserialize_uint64(&e->services, input, SERIALIZE_ENDIAN_LIT);
+			if (memcmp(input, ipv4_prefix, sizeof(ipv4_prefix)) == 0)
+			{
+				e->network = ADDR_NET_IPV4;
+				e->addr_len = 4;
+				memcpy(e->addr, input + sizeof(ipv4_prefix), 4);
+			}
+			else
+			{
+				e->network = ADDR_NET_IPV6;
+				e->addr_len = ADDR_IP_LEN;
+				memcpy(e->addr, input, ADDR_IP_LEN);
+			}
+			input += ADDR_IP_LEN;
+			input = deserialize_uint16(&e->port, input, SERIALIZE_ENDIAN_BIG);
+			input_len -= ADDR_V1_ENTRY_LEN;
+			a->count++;
+			continue;
+		}
+
+		// time
+		if (input_len < 4)
+		{
+			error_log("Address data is incomplete.");
+			return -1;
+		}
+		input = deserialize_uint32(&e->time, input, SERIALIZE_ENDIAN_LIT);
+		input_len -= 4;
+
+		// services
+		if (input_len == 0 || (r = compactuint_get_value(&e->services, input, input_len)) < 0)
+		{
+			error_log("Address data is incomplete.");
+			return -1;
+		}
+		input += r;
+		input_len -= r;
+
+		// network id and address
+		if (input_len == 0)
+		{
+			error_log("Address data is incomplete.");
+			return -1;
+		}
+		e->network = *input++;
+		input_len--;
+
+		if (input_len == 0 || (r = compactuint_get_value(&value, input, input_len)) < 0)
+		{
+			error_log("Address data is incomplete.");
+			return -1;
+		}
+		input += r;
+		input_len -= r;
+
+		if (value > ADDR_V2_ADDR_LIMIT || input_len < value + 2)
+		{
+			error_log("Address data is incomplete.");
+			return -1;
+		}
+
+		if (value <= ADDR_ADDR_MAXLEN)
+		{
+			e->addr_len = (uint8_t)value;
+			memcpy(e->addr, input, value);
+		}
+		input += value;
+		input_len -= value;
+
+		// port
+		input = deserialize_uint16(&e->port, input, SERIALIZE_ENDIAN_BIG);
+		input_len -= 2;
+
+		if (value <= ADDR_ADDR_MAXLEN)
+		{
+			a->count++;
+		}
+	}
+
+	return 1;
+}
+
+size_t addr_get_count(Addr a)
+{
+	assert(a);
+
+	return a->count;
+}
+
+int addr_get(struct AddrEntry *output, Addr a, size_t i)
+{
+	assert(output);
+	assert(a);
+
+	if (i >= a->count)
+	{
+		error_log("Address index %zu is out of range.", i);
+		return -1;
+	}
+
+	memcpy(output, &a->entries[i], sizeof(struct AddrEntry));
+
+	return 1;
+}
+
+/*
+ * Write the 16 byte IPv6 (or IPv4-mapped) form of an entry's address to
+ * output. Returns 0 for networks that aren't reachable over plain IP.
+ */
+int addr_entry_get_ip(unsigned char *output, struct AddrEntry *e)
+{
+	assert(output);
+	assert(e);
+
+	if (e->network == ADDR_NET_IPV4 && e->addr_len == 4)
+	{
+		memcpy(output, ipv4_prefix, sizeof(ipv4_prefix));
+		memcpy(output + sizeof(ipv4_prefix), e->addr, 4);
+		return 1;
+	}
+	if (e->network == ADDR_NET_IPV6 && e->addr_len == ADDR_IP_LEN)
+	{
+		memcpy(output, e->addr, ADDR_IP_LEN);
+		return 1;
+	}
+
+	return 0;
+}
+
+size_t addr_sizeof(void)
+{
+	return sizeof(struct Addr);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef ADDR_H
+#define ADDR_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ADDR_COMMAND        "addr"
+#define ADDRV2_COMMAND      "addrv2"
+#define GETADDR_COMMAND     "getaddr"
+#define SENDADDRV2_COMMAND  "sendaddrv2"
+
+#define ADDR_MAX_COUNT      1000
+#define ADDR_ADDR_MAXLEN    32
+
+// BIP155 network identifiers
+#define ADDR_NET_IPV4       1
+#define ADDR_NET_IPV6       2
+#define ADDR_NET_TORV2      3
+#define ADDR_NET_TORV3      4
+#define ADDR_NET_I2P        5
+#define ADDR_NET_CJDNS      6
+
+struct AddrEntry
+{
+	uint32_t      time;
+	uint64_t      services;
+	uint8_t       network;
+	uint8_t       addr_len;
+	unsigned char addr[ADDR_ADDR_MAXLEN];
+	uint16_t      port;
+};
+
+typedef struct Addr *Addr;
+
+int addr_deserialize(Addr, unsigned char *, size_t, int);
+size_t addr_get_count(Addr);
+int addr_get(struct AddrEntry *, Addr, size_t);
+int addr_entry_get_ip(unsigned char *, struct AddrEntry *);
+size_t addr_sizeof(void);
+
+#endif
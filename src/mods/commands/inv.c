@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include "inv.h"
+#include "mods/serialize.h"
+#include "mods/compactuint.h"
+#include "mods/error.h"
+
+#define INV_ENTRY_LEN (4 + INV_HASH_LEN)
+
+struct InvEntry
+{
+	uint32_t type;
+	unsigned char hash[INV_HASH_LEN];
+};
+
+// The same inventory vector layout is shared by the inv, getdata and
+// notfound commands.
+struct Inv
+{
+	uint64_t count;
+	struct InvEntry entries[INV_MAX_COUNT];
+};
+
+int inv_new(Inv inv)
+{
+	assert(inv);
+
+	inv->count = 0;
+
+	return 1;
+}
+
+int inv_add(Inv inv, uint32_t type, unsigned char *hash)
+{
+	assert(inv);
+	assert(hash);
+
+	if (inv->count >= INV_MAX_COUNT)
+	{
+		error_log("Inventory can not contain more than %i entries.", INV_MAX_COUNT);
+		return -1;
+	}
+
+	inv->entries[inv->count].type = type;
+	memcpy(inv->entries[inv->count].hash, hash, INV_HASH_LEN);
+	inv->count++;
+
+	return 1;
+}
+
+int inv_serialize(unsigned char *output, Inv inv)
+{
+	size_t i;
+	unsigned char *head;
+
+	assert(output);
+	assert(inv);
+
+	head = output;
+
+	if (inv->count == 0)
+	{
+		*output++ = 0x00;
+	}
+	else
+	{
+		output = serialize_compuint(output, inv->count, SERIALIZE_ENDIAN_LIT);
+	}
+
+	for (i = 0; i < inv->count; ++i)
+	{
+		output = serialize_uint32(output, inv->entries[i].type, SERIALIZE_ENDIAN_LIT);
+		output = serialize_uchar(output, inv->entries[i].hash, INV_HASH_LEN);
+	}
+
+	return (int)(output - head);
+}
+
+int inv_deserialize(Inv inv, unsigned char *input, size_t input_len)
+{
+	int r;
+	size_t i;
+	uint64_t count;
+
+	assert(inv);
+	assert(input);
+	assert(input_len);
+
+	r = compactuint_get_value(&count, input, input_len);
+	if (r < 0)
+	{
+		error_log("Could not parse inventory count.");
+		return -1;
+	}
+	input += r;
+	input_len -= r;
+
+	if (count > INV_MAX_COUNT)
+	{
+		error_log("Inventory count (%llu) exceeds the limit of %i.", (unsigned long long)count, INV_MAX_COUNT);
+		return -1;
+	}
+	if (input_len < count * INV_ENTRY_LEN)
+	{
+		error_log("Inventory data is incomplete.");
+		return -1;
+	}
+
+	inv->count = count;
+	for (i = 0; i < count; ++i)
+	{
+		input = deserialize_uint32(&(inv->entries[i].type), input, SERIALIZE_ENDIAN_LIT);
+		input = deserialize_uchar(inv->entries[i].hash, input, INV_HASH_LEN);
+	}
+
+	return 1;
+}
+
+size_t inv_get_count(Inv inv)
+{
+	assert(inv);
+
+	return (size_t)inv->count;
+}
+
+int inv_get(uint32_t *type, unsigned char *hash, Inv inv, size_t i)
+{
+	assert(type);
+	assert(hash);
+	assert(inv);
+
+	if (i >= inv->count)
+	{
+		error_log("Inventory index %zu is out of range.", i);
+		return -1;
+	}
+
+	*type = inv->entries[i].type;
+	memcpy(hash, inv->entries[i].hash, INV_HASH_LEN);
+
+	return 1;
+}
+
+size_t inv_serialized_len(Inv inv)
+{
+	assert(inv);
+
+	return 9 + (inv->count * INV_ENTRY_LEN);
+}
+
+size_t inv_sizeof(void)
+{
+	return sizeof(struct Inv);
+}
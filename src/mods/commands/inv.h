@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef INV_H
+#define INV_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define INV_COMMAND      "inv"
+#define GETDATA_COMMAND  "getdata"
+#define NOTFOUND_COMMAND "notfound"
+
+#define INV_TYPE_ERROR          0
+#define INV_TYPE_TX             1
+#define INV_TYPE_BLOCK          2
+#define INV_TYPE_FILTERED_BLOCK 3
+#define INV_TYPE_CMPCT_BLOCK    4
+#define INV_TYPE_WITNESS_FLAG   (1 << 30)
+#define INV_TYPE_WITNESS_BLOCK  (INV_TYPE_BLOCK | INV_TYPE_WITNESS_FLAG)
+
+#define INV_HASH_LEN   32
+#define INV_MAX_COUNT  50000
+
+typedef struct Inv *Inv;
+
+int inv_new(Inv);
+int inv_add(Inv, uint32_t, unsigned char *);
+int inv_serialize(unsigned char *, Inv);
+int inv_deserialize(Inv, unsigned char *, size_t);
+size_t inv_get_count(Inv);
+int inv_get(uint32_t *, unsigned char *, Inv, size_t);
+size_t inv_serialized_len(Inv);
+size_t inv_sizeof(void);
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include "ping.h"
+#include "mods/serialize.h"
+#include "mods/random.h"
+#include "mods/error.h"
+
+#define PING_PAYLOAD_LEN 8
+
+// A pong carries the same payload as the ping it answers, so both
+// commands share this struct.
+struct Ping
+{
+	uint64_t nonce;
+};
+
+int ping_new(Ping p)
+{
+	int r;
+	unsigned char raw[PING_PAYLOAD_LEN];
+
+	assert(p);
+
+	r = random_get(raw, PING_PAYLOAD_LEN);
+	if (r < 0)
+	{
+		error_log("Could not get random data for ping nonce.");
+		return -1;
+	}
+
+	deserialize_uint64(&(p->nonce), raw, SERIALIZE_ENDIAN_LIT);
+
+	return 1;
+}
+
+int ping_serialize(unsigned char *output, Ping p)
+{
+	assert(output);
+	assert(p);
+
+	serialize_uint64(output, p->nonce, SERIALIZE_ENDIAN_LIT);
+
+	return PING_PAYLOAD_LEN;
+}
+
+int ping_deserialize(Ping p, unsigned char *input, size_t input_len)
+{
+	assert(p);
+	assert(input);
+
+	if (input_len < PING_PAYLOAD_LEN)
+	{
+		error_log("Length of input is insufficient to deserialize a ping command.");
+		return -1;
+	}
+
+	deserialize_uint64(&(p->nonce), input, SERIALIZE_ENDIAN_LIT);
+
+	return 1;
+}
+
+uint64_t ping_get_nonce(Ping p)
+{
+	assert(p);
+
+	return p->nonce;
+}
+
+size_t ping_sizeof(void)
+{
+	return sizeof(struct Ping);
+}
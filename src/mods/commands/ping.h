@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef PING_H
+#define PING_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PING_COMMAND "ping"
+#define PONG_COMMAND "pong"
+
+typedef struct Ping *Ping;
+
+int ping_new(Ping);
+int ping_serialize(unsigned char *, Ping);
+int ping_deserialize(Ping, unsigned char *, size_t);
+uint64_t ping_get_nonce(Ping);
+size_t ping_sizeof(void);
+
+#endif
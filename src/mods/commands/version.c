@@ -53,7 +53,6 @@ struct Version
 
 // Function Prototypes
 static char *version_service_bit_to_str(int bit);
-static int version_services_to_json(char *ptr, uint64_t value);
 
 int version_new(Version v)
 {
@@ -142,7 +141,7 @@ int version_serialize(unsigned char *output, Version v)
 	output = serialize_uint16(output, v->addr_trans_port, SERIALIZE_ENDIAN_BIG);
 	output = serialize_uint64(output, v->nonce, SERIALIZE_ENDIAN_LIT);
 	output = serialize_compuint(output, v->user_agent_bytes, SERIALIZE_ENDIAN_LIT);	
-	output = serialize_char(output, v->user_agent, strlen(v->user_agent));
+	output = serialize_char(output, v->user_agent, v->user_agent_bytes);
 	output = serialize_uint32(output, v->start_height, SERIALIZE_ENDIAN_LIT);
 	output = serialize_uint8(output, v->relay, SERIALIZE_ENDIAN_LIT);
 	
@@ -212,6 +211,11 @@ int version_deserialize(Version output, unsigned char *input, size_t input_len)
 	input = deserialize_compuint(&(output->user_agent_bytes), input, SERIALIZE_ENDIAN_LIT);
 	if (output->user_agent_bytes)
 	{
+		if (output->user_agent_bytes > USER_AGENT_MAX_LEN)
+		{
+			error_log("User agent length (%llu) exceeds the limit of %i bytes.", (unsigned long long)output->user_agent_bytes, USER_AGENT_MAX_LEN);
+			return -1;
+		}
 		if (input_len < 85 + output->user_agent_bytes)
 		{
 			error_log("Length of input is too short to accommodate the user agent field size.");
@@ -235,11 +239,11 @@ int version_to_json(char *output, Version v)
 	output += sprintf(output, "{\n");
 	output += sprintf(output, "  \"version\": %"PRIu32",\n", v->version);
 	output += sprintf(output, "  \"services\": {\n");
-	output += version_services_to_json(output, v->services);
+	output += version_services_to_json(output, v->services, 4);
 	output += sprintf(output, "  },\n");
 	output += sprintf(output, "  \"timestamp\": %"PRIu64",\n", v->timestamp);
 	output += sprintf(output, "  \"addr_recv_services\": {\n");
-	output += version_services_to_json(output, v->addr_recv_services);
+	output += version_services_to_json(output, v->addr_recv_services, 4);
 	output += sprintf(output, "  },\n");
 	output += sprintf(output, "  \"addr_recv_ip_address\": \"");
 	for(i = 0; i < IP_ADDR_FIELD_LEN; ++i)
@@ -249,7 +253,7 @@ int version_to_json(char *output, Version v)
 	output += sprintf(output, "\",\n");
 	output += sprintf(output, "  \"addr_recv_port\": %"PRIu16",\n", v->addr_recv_port);
 	output += sprintf(output, "  \"addr_trans_services\": {\n");
-	output += version_services_to_json(output, v->addr_trans_services);
+	output += version_services_to_json(output, v->addr_trans_services, 4);
 	output += sprintf(output, "  },\n");
 	output += sprintf(output, "  \"addr_trans_ip_address\": \"");
 	for(i = 0; i < IP_ADDR_FIELD_LEN; ++i)
@@ -272,7 +276,11 @@ int version_to_json(char *output, Version v)
 	return 1;
 }
 
-static int version_services_to_json(char *ptr, uint64_t value)
+/*
+ * Write one JSON member per set service bit, each line prefixed with
+ * indent spaces. Returns the number of characters written.
+ */
+int version_services_to_json(char *ptr, uint64_t value, int indent)
 {
 	int i, c, total;
 	
@@ -284,7 +292,7 @@ static int version_services_to_json(char *ptr, uint64_t value)
 	{
 		if (((value >> i) & 0x0000000000000001) == 1)
 		{
-			c = sprintf(ptr, "    \"bit %d\": ", i + 1);
+			c = sprintf(ptr, "%*s\"bit %d\": ", indent, "", i + 1);
 			total += c;
 			ptr += c;
 			c = sprintf(ptr, "\"%s\",\n", version_service_bit_to_str(i));
@@ -331,6 +339,45 @@ static char *version_service_bit_to_str(int bit)
 	return "UNKNOWN";
 }
 
+uint64_t version_get_services(Version v)
+{
+	assert(v);
+
+	return v->services;
+}
+
+uint32_t version_get_start_height(Version v)
+{
+	assert(v);
+
+	return v->start_height;
+}
+
+int version_get_user_agent(char *output, size_t output_len, Version v)
+{
+	size_t i, l;
+
+	assert(output);
+	assert(output_len);
+	assert(v);
+
+	l = (size_t)v->user_agent_bytes;
+	if (l > USER_AGENT_MAX_LEN)
+	{
+		l = USER_AGENT_MAX_LEN;
+	}
+
+	// Only keep printable characters so the string is safe to embed in
+	// JSON output.
+	for (i = 0; i < l && i + 1 < output_len; ++i)
+	{
+		output[i] = (v->user_agent[i] >= 0x20 && v->user_agent[i] < 0x7f && v->user_agent[i] != '"' && v->user_agent[i] != '\\') ? v->user_agent[i] : '?';
+	}
+	output[i] = '\0';
+
+	return (int)i;
+}
+
 size_t version_sizeof(void)
 {
 	return sizeof(struct Version);
@@ -9,6 +9,7 @@
 #define VERSION_H 1
 
 #include <stddef.h>
+#include <stdint.h>
 
 #define VERSION_COMMAND "version"
 
@@ -19,6 +20,10 @@ int version_serialize(unsigned char *, Version);
 int version_new_serialize(unsigned char *);
 int version_deserialize(Version, unsigned char *, size_t);
 int version_to_json(char *, Version);
+int version_services_to_json(char *, uint64_t, int);
+uint64_t version_get_services(Version);
+uint32_t version_get_start_height(Version);
+int version_get_user_agent(char *, size_t, Version);
 size_t version_sizeof(void);
 
 #endif
@@ -35,7 +35,7 @@ int compactuint_get_value(uint64_t *output, unsigned char *input, size_t input_l
 		{
 			j = 4;
 		}
-		else if (*input == 0xff)
+		else
 		{
 			j = 8;
 		}
@@ -51,10 +51,10 @@ int compactuint_get_value(uint64_t *output, unsigned char *input, size_t input_l
 		*output = 0;
 		++input;
 
+		// Compact size integers are little endian on the wire.
 		for (i = 0; i < j; ++i, ++input)
 		{
-			*output <<= 8;
-			*output += *input;
+			*output += ((uint64_t)*input) << (i * 8);
 		}
 	}
 	
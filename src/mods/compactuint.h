@@ -8,6 +8,9 @@
 #ifndef COMPACTUINT_H
 #define COMPACTUINT_H 1
 
+#include <stddef.h>
+#include <stdint.h>
+
 int compactuint_get_value(uint64_t *, unsigned char *, size_t);
 
 #endif
@@ -0,0 +1,714 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <assert.h>
+#include "crawler.h"
+#include "node.h"
+#include "message.h"
+#include "commands/version.h"
+#include "commands/verack.h"
+#include "commands/addr.h"
+#include "commands/ping.h"
+#include "error.h"
+
+#define STATE_IDLE        0
+#define STATE_CONNECTING  1
+#define STATE_HANDSHAKE   2
+#define STATE_GETADDR     3
+
+#define POLL_INTERVAL     100
+#define TABLE_INITIAL     4096
+#define PEERS_INITIAL     1024
+#define USER_AGENT_LEN    64
+#define EMPTY_SLOT        UINT32_MAX
+
+struct CrawlerPeer
+{
+	unsigned char ip[CRAWLER_IP_LEN];
+	uint16_t port;
+	int reachable;
+	uint64_t services;
+	uint32_t height;
+	uint32_t connect_ms;
+	uint32_t handshake_ms;
+	uint32_t addr_count;
+	char user_agent[USER_AGENT_LEN];
+};
+
+struct CrawlerConn
+{
+	Node node;
+	int state;
+	int got_version;
+	int got_verack;
+	size_t peer;
+	uint64_t start;
+	uint64_t connected;
+};
+
+struct Crawler
+{
+	struct CrawlerPeer *peers;
+	size_t peer_count;
+	size_t peer_cap;
+	uint32_t *table;
+	size_t table_cap;
+	size_t next;
+	size_t budget;
+	size_t reachable;
+	size_t concurrency;
+	uint64_t timeout;
+	struct CrawlerConn *conns;
+	Version version;
+	Addr addr;
+	Capture capture;
+	uint64_t start;
+	uint64_t finish;
+};
+
+static uint32_t crawler_hash(unsigned char *, uint16_t);
+static int crawler_grow(Crawler);
+static int crawler_start(Crawler, struct CrawlerConn *);
+static void crawler_finish(Crawler, struct CrawlerConn *);
+static int crawler_handle(Crawler, struct CrawlerConn *, Message);
+
+/*
+ * Set up a crawl that will attempt at most budget connections, keeping
+ * up to concurrency of them open at once. Each connection gets timeout
+ * seconds to connect, handshake and answer getaddr.
+ */
+int crawler_new(Crawler c, size_t budget, int concurrency, int timeout)
+{
+	size_t i;
+
+	assert(c);
+
+	if (concurrency < 1 || concurrency > CRAWLER_CONCURRENCY_MAX)
+	{
+		error_log("Concurrency must be between 1 and %i.", CRAWLER_CONCURRENCY_MAX);
+		return -1;
+	}
+	if (timeout < 1)
+	{
+		error_log("Timeout must be at least one second.");
+		return -1;
+	}
+
+	memset(c, 0, sizeof(*c));
+
+	c->budget = budget;
+	c->concurrency = (size_t)concurrency;
+	c->timeout = (uint64_t)timeout * 1000;
+	c->peer_cap = PEERS_INITIAL;
+	c->table_cap = TABLE_INITIAL;
+
+	c->peers = malloc(sizeof(*c->peers) * c->peer_cap);
+	c->table = malloc(sizeof(*c->table) * c->table_cap);
+	c->conns = calloc(c->concurrency, sizeof(*c->conns));
+	c->version = malloc(version_sizeof());
+	c->addr = malloc(addr_sizeof());
+	if (c->peers == NULL || c->table == NULL || c->conns == NULL || c->version == NULL || c->addr == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	for (i = 0; i < c->table_cap; ++i)
+	{
+		c->table[i] = EMPTY_SLOT;
+	}
+
+	for (i = 0; i < c->concurrency; ++i)
+	{
+		c->conns[i].node = malloc(node_sizeof());
+		if (c->conns[i].node == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Queue a 16 byte IPv6 (or IPv4-mapped) address for a visit. Returns 1
+ * if the address is new and 0 if it has been seen before.
+ */
+int crawler_add(Crawler c, unsigned char *ip, int port)
+{
+	int r;
+	size_t i, mask;
+	struct CrawlerPeer *p;
+
+	assert(c);
+	assert(ip);
+
+	if (port <= 0 || port > 0xFFFF)
+	{
+		return 0;
+	}
+
+	// The table holds indexes into the peer array, so lookups only touch
+	// the peer they land on and the array doubles as the visit queue.
+	mask = c->table_cap - 1;
+	for (i = crawler_hash(ip, (uint16_t)port) & mask; c->table[i] != EMPTY_SLOT; i = (i + 1) & mask)
+	{
+		p = &c->peers[c->table[i]];
+		if (p->port == port && memcmp(p->ip, ip, CRAWLER_IP_LEN) == 0)
+		{
+			return 0;
+		}
+	}
+
+	if ((c->peer_count + 1) * 2 > c->table_cap || c->peer_count == c->peer_cap)
+	{
+		r = crawler_grow(c);
+		if (r < 0)
+		{
+			error_log("Could not grow address table.");
+			return -1;
+		}
+		return crawler_add(c, ip, port);
+	}
+
+	p = &c->peers[c->peer_count];
+	memset(p, 0, sizeof(*p));
+	memcpy(p->ip, ip, CRAWLER_IP_LEN);
+	p->port = (uint16_t)port;
+
+	c->table[i] = (uint32_t)c->peer_count;
+	c->peer_count++;
+
+	return 1;
+}
+
+/*
+ * Resolve a seed host name and queue every address it returns.
+ */
+int crawler_add_seed(Crawler c, const char *host, int port)
+{
+	int r, count;
+	unsigned char ip[CRAWLER_IP_LEN];
+	struct addrinfo hints, *res, *ai;
+
+	assert(c);
+	assert(host);
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	r = getaddrinfo(host, NULL, &hints, &res);
+	if (r != 0)
+	{
+		error_log("Could not resolve seed host %s: %s", host, gai_strerror(r));
+		return -1;
+	}
+
+	for (count = 0, ai = res; ai != NULL; ai = ai->ai_next)
+	{
+		if (ai->ai_family == AF_INET)
+		{
+			memset(ip, 0, 10);
+			ip[10] = ip[11] = 0xff;
+			memcpy(ip + 12, &((struct sockaddr_in *)ai->ai_addr)->sin_addr, 4);
+		}
+		else if (ai->ai_family == AF_INET6)
+		{
+			memcpy(ip, &((struct sockaddr_in6 *)ai->ai_addr)->sin6_addr, CRAWLER_IP_LEN);
+		}
+		else
+		{
+			continue;
+		}
+
+		r = crawler_add(c, ip, port);
+		if (r < 0)
+		{
+			freeaddrinfo(res);
+			return -1;
+		}
+		count += r;
+	}
+
+	freeaddrinfo(res);
+
+	return count;
+}
+
+/*
+ * Record the traffic of every crawled connection to capture.
+ */
+void crawler_set_capture(Crawler c, Capture capture)
+{
+	assert(c);
+
+	c->capture = capture;
+}
+
+int crawler_run(Crawler c)
+{
+	int r;
+	size_t i, open;
+	uint64_t now;
+	Node *nodes;
+	int *readable;
+	Message message;
+
+	assert(c);
+
+	nodes = malloc(sizeof(*nodes) * c->concurrency);
+	readable = malloc(sizeof(*readable) * c->concurrency);
+	message = malloc(message_sizeof());
+	if (nodes == NULL || readable == NULL || message == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	c->start = node_now();
+
+	while (1)
+	{
+		now = node_now();
+
+		for (open = 0, i = 0; i < c->concurrency; ++i)
+		{
+			if (c->conns[i].state != STATE_IDLE && now - c->conns[i].start > c->timeout)
+			{
+				crawler_finish(c, &c->conns[i]);
+			}
+
+			// Refill free slots from the front of the queue. New
+			// addresses are appended, so this visits breadth first.
+			while (c->conns[i].state == STATE_IDLE && c->next < c->peer_count && c->next < c->budget)
+			{
+				c->conns[i].peer = c->next++;
+				r = crawler_start(c, &c->conns[i]);
+				if (r < 0)
+				{
+					free(nodes);
+					free(readable);
+					free(message);
+					return -1;
+				}
+			}
+
+			nodes[i] = (c->conns[i].state != STATE_IDLE) ? c->conns[i].node : NULL;
+			open += (nodes[i] != NULL);
+		}
+
+		if (open == 0)
+		{
+			break;
+		}
+
+		r = node_poll(nodes, readable, c->concurrency, POLL_INTERVAL);
+		if (r < 0)
+		{
+			error_log("Could not wait for peer data.");
+			free(nodes);
+			free(readable);
+			free(message);
+			return -1;
+		}
+
+		for (i = 0; i < c->concurrency; ++i)
+		{
+			if (nodes[i] == NULL || !readable[i])
+			{
+				continue;
+			}
+
+			if (c->conns[i].state == STATE_CONNECTING)
+			{
+				if (node_connect_finish(nodes[i]) < 0 || node_send_version(nodes[i]) < 0)
+				{
+					error_clear();
+					crawler_finish(c, &c->conns[i]);
+					continue;
+				}
+				c->conns[i].connected = node_now();
+				c->conns[i].state = STATE_HANDSHAKE;
+				continue;
+			}
+
+			while (c->conns[i].state != STATE_IDLE && (r = node_read_message(nodes[i], message)) > 0)
+			{
+				r = crawler_handle(c, &c->conns[i], message);
+				message_clear(message);
+				if (r < 0)
+				{
+					free(nodes);
+					free(readable);
+					free(message);
+					return -1;
+				}
+			}
+			if (c->conns[i].state != STATE_IDLE && r < 0)
+			{
+				error_clear();
+				crawler_finish(c, &c->conns[i]);
+			}
+		}
+	}
+
+	c->finish = node_now();
+
+	free(nodes);
+	free(readable);
+	free(message);
+
+	return 1;
+}
+
+/*
+ * Number of peers the crawl attempted to visit. Peers are numbered in
+ * the order they were visited.
+ */
+size_t crawler_get_peer_count(Crawler c)
+{
+	assert(c);
+
+	return c->next;
+}
+
+/*
+ * Write the crawl summary as JSON members. The caller wraps these in an
+ * object along with the peer list.
+ */
+int crawler_to_json(char *output, Crawler c)
+{
+	uint64_t elapsed;
+
+	assert(output);
+	assert(c);
+
+	elapsed = c->finish - c->start;
+
+	output += sprintf(output, "  \"attempted\": %zu,\n", c->next);
+	output += sprintf(output, "  \"reachable\": %zu,\n", c->reachable);
+	output += sprintf(output, "  \"discovered\": %zu,\n", c->peer_count);
+	output += sprintf(output, "  \"milliseconds\": %"PRIu64",\n", elapsed);
+	sprintf(output, "  \"peers_per_second\": %.2f,\n", elapsed ? (double)c->next / ((double)elapsed / 1000.0) : 0.0);
+
+	return 1;
+}
+
+int crawler_peer_to_json(char *output, Crawler c, size_t i)
+{
+	char host[INET6_ADDRSTRLEN];
+	struct CrawlerPeer *p;
+
+	assert(output);
+	assert(c);
+	assert(i < c->next);
+
+	p = &c->peers[i];
+
+	if (memcmp(p->ip, "\0\0\0\0\0\0\0\0\0\0\xff\xff", 12) == 0)
+	{
+		inet_ntop(AF_INET, p->ip + 12, host, sizeof(host));
+	}
+	else
+	{
+		inet_ntop(AF_INET6, p->ip, host, sizeof(host));
+	}
+
+	output += sprintf(output, "    {\n");
+	output += sprintf(output, "      \"host\": \"%s\",\n", host);
+	output += sprintf(output, "      \"port\": %"PRIu16",\n", p->port);
+	if (!p->reachable)
+	{
+		output += sprintf(output, "      \"reachable\": false\n");
+		sprintf(output, "    }");
+		return 1;
+	}
+	output += sprintf(output, "      \"reachable\": true,\n");
+	output += sprintf(output, "      \"services\": {\n");
+	output += version_services_to_json(output, p->services, 8);
+	output += sprintf(output, "      },\n");
+	output += sprintf(output, "      \"user_agent\": \"%s\",\n", p->user_agent);
+	output += sprintf(output, "      \"start_height\": %"PRIu32",\n", p->height);
+	output += sprintf(output, "      \"connect_ms\": %"PRIu32",\n", p->connect_ms);
+	output += sprintf(output, "      \"handshake_ms\": %"PRIu32",\n", p->handshake_ms);
+	output += sprintf(output, "      \"addresses\": %"PRIu32"\n", p->addr_count);
+	sprintf(output, "    }");
+
+	return 1;
+}
+
+void crawler_clear(Crawler c)
+{
+	size_t i;
+
+	assert(c);
+
+	if (c->conns != NULL)
+	{
+		for (i = 0; i < c->concurrency; ++i)
+		{
+			if (c->conns[i].state != STATE_IDLE)
+			{
+				node_disconnect(c->conns[i].node);
+			}
+			free(c->conns[i].node);
+		}
+	}
+
+	free(c->peers);
+	free(c->table);
+	free(c->conns);
+	free(c->version);
+	free(c->addr);
+	c->peers = NULL;
+	c->table = NULL;
+	c->conns = NULL;
+	c->version = NULL;
+	c->addr = NULL;
+}
+
+size_t crawler_sizeof(void)
+{
+	return sizeof(struct Crawler);
+}
+
+/*
+ * FNV-1a over the address and port.
+ */
+static uint32_t crawler_hash(unsigned char *ip, uint16_t port)
+{
+	int i;
+	uint32_t h = 2166136261u;
+
+	for (i = 0; i < CRAWLER_IP_LEN; ++i)
+	{
+		h = (h ^ ip[i]) * 16777619u;
+	}
+	h = (h ^ (port & 0xFF)) * 16777619u;
+	h = (h ^ (port >> 8)) * 16777619u;
+
+	return h;
+}
+
+static int crawler_grow(Crawler c)
+{
+	size_t i, j, mask;
+	uint32_t *table;
+	struct CrawlerPeer *peers;
+
+	if (c->peer_count == c->peer_cap)
+	{
+		peers = realloc(c->peers, sizeof(*peers) * c->peer_cap * 2);
+		if (peers == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		c->peers = peers;
+		c->peer_cap *= 2;
+	}
+
+	if ((c->peer_count + 1) * 2 > c->table_cap)
+	{
+		table = malloc(sizeof(*table) * c->table_cap * 2);
+		if (table == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		free(c->table);
+		c->table = table;
+		c->table_cap *= 2;
+
+		mask = c->table_cap - 1;
+		for (i = 0; i < c->table_cap; ++i)
+		{
+			c->table[i] = EMPTY_SLOT;
+		}
+		for (i = 0; i < c->peer_count; ++i)
+		{
+			for (j = crawler_hash(c->peers[i].ip, c->peers[i].port) & mask; c->table[j] != EMPTY_SLOT; j = (j + 1) & mask)
+				;
+			c->table[j] = (uint32_t)i;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Open a connection to the connection's peer. Failing to start a
+ * connection only fails that peer, not the crawl.
+ */
+static int crawler_start(Crawler c, struct CrawlerConn *conn)
+{
+	struct CrawlerPeer *p;
+
+	p = &c->peers[conn->peer];
+
+	conn->start = node_now();
+	conn->got_version = 0;
+	conn->got_verack = 0;
+
+	if (node_connect_start(conn->node, p->ip, p->port) < 0)
+	{
+		error_clear();
+		conn->state = STATE_IDLE;
+		return 1;
+	}
+
+	conn->state = STATE_CONNECTING;
+
+	node_set_capture(conn->node, c->capture);
+
+	if (!node_is_connecting(conn->node))
+	{
+		// Connected immediately, which happens on loopback
+		conn->connected = conn->start;
+		if (node_send_version(conn->node) < 0)
+		{
+			error_clear();
+			crawler_finish(c, conn);
+			return 1;
+		}
+		conn->state = STATE_HANDSHAKE;
+	}
+
+	return 1;
+}
+
+static void crawler_finish(Crawler c, struct CrawlerConn *conn)
+{
+	(void)c;
+
+	node_disconnect(conn->node);
+	conn->state = STATE_IDLE;
+}
+
+static int crawler_handle(Crawler c, struct CrawlerConn *conn, Message message)
+{
+	int r;
+	size_t i, payload_len;
+	unsigned char *payload;
+	unsigned char ip[CRAWLER_IP_LEN];
+	struct AddrEntry entry;
+	struct CrawlerPeer *p;
+
+	p = &c->peers[conn->peer];
+	payload = message_get_payload_ptr(message);
+	payload_len = message_get_payload_len(message);
+
+	if (message_is_valid(message) <= 0)
+	{
+		error_clear();
+		crawler_finish(c, conn);
+		return 1;
+	}
+
+	if (message_cmp_command(message, VERSION_COMMAND) == 0)
+	{
+		if (version_deserialize(c->version, payload, payload_len) < 0)
+		{
+			error_clear();
+			crawler_finish(c, conn);
+			return 1;
+		}
+
+		p->services = version_get_services(c->version);
+		p->height = version_get_start_height(c->version);
+		version_get_user_agent(p->user_agent, USER_AGENT_LEN, c->version);
+
+		r = node_send_message(conn->node, SENDADDRV2_COMMAND, NULL, 0);
+		if (r >= 0)
+		{
+			r = node_send_message(conn->node, VERACK_COMMAND, NULL, 0);
+		}
+		if (r < 0)
+		{
+			error_clear();
+			crawler_finish(c, conn);
+			return 1;
+		}
+		conn->got_version = 1;
+	}
+	else if (message_cmp_command(message, VERACK_COMMAND) == 0)
+	{
+		conn->got_verack = 1;
+	}
+	else if (message_cmp_command(message, PING_COMMAND) == 0)
+	{
+		if (node_send_message(conn->node, PONG_COMMAND, payload, payload_len) < 0)
+		{
+			error_clear();
+			crawler_finish(c, conn);
+			return 1;
+		}
+	}
+	else if (conn->state == STATE_GETADDR && (message_cmp_command(message, ADDR_COMMAND) == 0 || message_cmp_command(message, ADDRV2_COMMAND) == 0))
+	{
+		if (addr_deserialize(c->addr, payload, payload_len, message_cmp_command(message, ADDRV2_COMMAND) == 0) < 0)
+		{
+			error_clear();
+			crawler_finish(c, conn);
+			return 1;
+		}
+
+		for (i = 0; i < addr_get_count(c->addr); ++i)
+		{
+			addr_get(&entry, c->addr, i);
+			if (addr_entry_get_ip(ip, &entry) == 0)
+			{
+				continue;
+			}
+			r = crawler_add(c, ip, entry.port);
+			if (r < 0)
+			{
+				error_log("Could not record peer address.");
+				return -1;
+			}
+			p = &c->peers[conn->peer];
+		}
+		p->addr_count += (uint32_t)addr_get_count(c->addr);
+
+		// Peers announce their own address unprompted with a single
+		// entry. Anything bigger is the getaddr response.
+		if (addr_get_count(c->addr) > 1)
+		{
+			crawler_finish(c, conn);
+		}
+		return 1;
+	}
+
+	if (conn->state == STATE_HANDSHAKE && conn->got_version && conn->got_verack)
+	{
+		p->reachable = 1;
+		p->connect_ms = (uint32_t)(conn->connected - conn->start);
+		p->handshake_ms = (uint32_t)(node_now() - conn->connected);
+		c->reachable++;
+
+		if (node_send_message(conn->node, GETADDR_COMMAND, NULL, 0) < 0)
+		{
+			error_clear();
+			crawler_finish(c, conn);
+			return 1;
+		}
+		conn->state = STATE_GETADDR;
+	}
+
+	return 1;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef CRAWLER_H
+#define CRAWLER_H 1
+
+#include <stddef.h>
+#include "capture.h"
+
+#define CRAWLER_BUDGET_DEFAULT       1000
+#define CRAWLER_CONCURRENCY_DEFAULT  128
+#define CRAWLER_CONCURRENCY_MAX      1024
+#define CRAWLER_TIMEOUT_DEFAULT      10
+#define CRAWLER_IP_LEN               16
+
+typedef struct Crawler *Crawler;
+
+int crawler_new(Crawler, size_t, int, int);
+int crawler_add(Crawler, unsigned char *, int);
+int crawler_add_seed(Crawler, const char *, int);
+void crawler_set_capture(Crawler, Capture);
+int crawler_run(Crawler);
+size_t crawler_get_peer_count(Crawler);
+int crawler_to_json(char *, Crawler);
+int crawler_peer_to_json(char *, Crawler, size_t);
+void crawler_clear(Crawler);
+size_t crawler_sizeof(void);
+
+#endif
@@ -7,28 +7,50 @@
 
 #include <string.h>
 #include <stdint.h>
+#include <pthread.h>
 #include <gcrypt.h>
 #include <assert.h>
 #include "crypto.h"
 #include "error.h"
 
-static int crypto_init(void)
+struct CryptoHash
 {
-	static int isInit = 0;
+	gcry_md_hd_t gc;
+	int algo;
+};
+
+static int crypto_hash_open_flags(CryptoHash, int, unsigned int);
 
-	if (!isInit)
+static int crypto_init_result = 0;
+static pthread_once_t crypto_init_once = PTHREAD_ONCE_INIT;
+
+static void crypto_init_library(void)
+{
+	if (!gcry_check_version(GCRYPT_VERSION))
 	{
-		if (!gcry_check_version(GCRYPT_VERSION))
-		{
-			error_log("Libgcrypt version mismatch.");
-			return -1;
-		}
-		gcry_control(GCRYCTL_SUSPEND_SECMEM_WARN);
-		gcry_control(GCRYCTL_INIT_SECMEM, 16384, 0);
-		gcry_control(GCRYCTL_RESUME_SECMEM_WARN);
-		gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+		crypto_init_result = -1;
+		return;
+	}
+	gcry_control(GCRYCTL_SUSPEND_SECMEM_WARN);
+	gcry_control(GCRYCTL_INIT_SECMEM, 16384, 0);
+	gcry_control(GCRYCTL_RESUME_SECMEM_WARN);
+	gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
 
-		isInit = 1;
+	crypto_init_result = 1;
+}
+
+/*
+ * Hashing may start on several threads at once, so the library is set
+ * up exactly once, by whichever gets here first.
+ */
+static int crypto_init(void)
+{
+	pthread_once(&crypto_init_once, crypto_init_library);
+
+	if (crypto_init_result < 0)
+	{
+		error_log("Libgcrypt version mismatch.");
+		return -1;
 	}
 
 	return 1;
@@ -84,6 +106,36 @@ int crypto_get_rmd160(unsigned char *output, unsigned char *input, size_t input_
 	return 1;
 }
 
+int crypto_get_sha256d(unsigned char *output, unsigned char *input, size_t input_len)
+{
+	gcry_md_hd_t gc;
+	unsigned char first[32];
+
+	assert(output);
+	assert(input);
+	assert(input_len);
+
+	if (crypto_init() < 0)
+	{
+		error_log("Could not initialize encryption library.");
+		return -1;
+	}
+
+	gcry_md_open(&gc, GCRY_MD_SHA256, 0);
+
+	gcry_md_write(gc, input, input_len);
+	memcpy(first, gcry_md_read(gc, 0), 32);
+
+	gcry_md_reset(gc);
+	gcry_md_write(gc, first, 32);
+
+	memcpy(output, gcry_md_read(gc, 0), 32);
+
+	gcry_md_close(gc);
+
+	return 1;
+}
+
 int crypto_get_checksum(uint32_t *output, unsigned char *data, size_t len)
 {
 	int r;
@@ -133,3 +185,197 @@ int crypto_get_checksum(uint32_t *output, unsigned char *data, size_t len)
 	
 	return 1;
 }
+
+/*
+ * Streaming hashes, for data that isn't in one contiguous piece. A hash
+ * is reset by crypto_hash_final() so the same handle can be reused
+ * without reopening it.
+ */
+int crypto_hash_open(CryptoHash h, int algo)
+{
+	return crypto_hash_open_flags(h, algo, 0);
+}
+
+/*
+ * A streaming HMAC. The key is set with crypto_hash_set_key() and kept
+ * across crypto_hash_final(), so one handle serves many messages.
+ */
+int crypto_hmac_open(CryptoHash h, int algo)
+{
+	return crypto_hash_open_flags(h, algo, GCRY_MD_FLAG_HMAC);
+}
+
+/*
+ * BIP340 tagged hashes, SHA256(SHA256(tag) || SHA256(tag) || data). The
+ * prefix fills one block, so a handle opened here makes a midstate that
+ * crypto_hash_restore() can start each hash from.
+ */
+int crypto_tag_open(CryptoHash h, const char *tag)
+{
+	unsigned char digest[CRYPTO_SHA256_LEN];
+
+	assert(h);
+	assert(tag);
+
+	if (crypto_hash_open(h, CRYPTO_SHA256) < 0)
+	{
+		return -1;
+	}
+
+	crypto_hash_write(h, (const unsigned char *)tag, strlen(tag));
+	crypto_hash_final(digest, h);
+	crypto_hash_write(h, digest, CRYPTO_SHA256_LEN);
+	crypto_hash_write(h, digest, CRYPTO_SHA256_LEN);
+
+	return 1;
+}
+
+int crypto_hash_set_key(CryptoHash h, const unsigned char *key, size_t key_len)
+{
+	assert(h);
+	assert(key);
+
+	if (gcry_md_setkey(h->gc, key, key_len) != 0)
+	{
+		error_log("Could not set HMAC key.");
+		return -1;
+	}
+
+	return 1;
+}
+
+void crypto_hash_write(CryptoHash h, const unsigned char *input, size_t input_len)
+{
+	assert(h);
+
+	if (input_len > 0)
+	{
+		gcry_md_write(h->gc, input, input_len);
+	}
+}
+
+/*
+ * Open dest as a copy of source, including everything written so far.
+ */
+int crypto_hash_copy(CryptoHash dest, CryptoHash source)
+{
+	gcry_error_t r;
+
+	assert(dest);
+	assert(source);
+
+	r = gcry_md_copy(&dest->gc, source->gc);
+	if (r != 0)
+	{
+		error_log("Could not copy hash context.");
+		return -1;
+	}
+	dest->algo = source->algo;
+
+	return 1;
+}
+
+/*
+ * Rewind an open hash to a copy of source, as when many hashes share a
+ * prefix and its midstate is kept to start each one from.
+ */
+int crypto_hash_restore(CryptoHash dest, CryptoHash source)
+{
+	assert(dest);
+	assert(source);
+
+	gcry_md_close(dest->gc);
+
+	return crypto_hash_copy(dest, source);
+}
+
+int crypto_hash_final(unsigned char *output, CryptoHash h)
+{
+	assert(output);
+	assert(h);
+
+	memcpy(output, gcry_md_read(h->gc, h->algo), gcry_md_get_algo_dlen(h->algo));
+
+	gcry_md_reset(h->gc);
+
+	return 1;
+}
+
+/*
+ * Finish the hash and hash the digest again, as in bitcoin's double
+ * SHA256.
+ */
+int crypto_hash_final_double(unsigned char *output, CryptoHash h)
+{
+	unsigned int len;
+	unsigned char first[CRYPTO_SHA512_LEN];
+
+	assert(output);
+	assert(h);
+
+	len = gcry_md_get_algo_dlen(h->algo);
+
+	memcpy(first, gcry_md_read(h->gc, h->algo), len);
+
+	gcry_md_reset(h->gc);
+	gcry_md_write(h->gc, first, len);
+
+	memcpy(output, gcry_md_read(h->gc, h->algo), len);
+
+	gcry_md_reset(h->gc);
+
+	return 1;
+}
+
+void crypto_hash_close(CryptoHash h)
+{
+	assert(h);
+
+	gcry_md_close(h->gc);
+}
+
+size_t crypto_hash_sizeof(void)
+{
+	return sizeof(struct CryptoHash);
+}
+
+static int crypto_hash_open_flags(CryptoHash h, int algo, unsigned int flags)
+{
+	gcry_error_t r;
+
+	assert(h);
+
+	if (crypto_init() < 0)
+	{
+		error_log("Could not initialize encryption library.");
+		return -1;
+	}
+
+	switch (algo)
+	{
+		case CRYPTO_SHA256:
+			h->algo = GCRY_MD_SHA256;
+			break;
+		case CRYPTO_SHA1:
+			h->algo = GCRY_MD_SHA1;
+			break;
+		case CRYPTO_RMD160:
+			h->algo = GCRY_MD_RMD160;
+			break;
+		case CRYPTO_SHA512:
+			h->algo = GCRY_MD_SHA512;
+			break;
+		default:
+			error_log("Unknown hash algorithm (%i).", algo);
+			return -1;
+	}
+
+	r = gcry_md_open(&h->gc, h->algo, flags);
+	if (r != 0)
+	{
+		error_log("Could not open hash context.");
+		return -1;
+	}
+
+	return 1;
+}
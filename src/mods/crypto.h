@@ -8,10 +8,35 @@
 #ifndef CRYPTO_H
 #define CRYPTO_H 1
 
+#include <stddef.h>
 #include <stdint.h>
 
 int crypto_get_sha256(unsigned char *, unsigned char *, size_t);
 int crypto_get_rmd160(unsigned char *, unsigned char *, size_t);
+int crypto_get_sha256d(unsigned char *, unsigned char *, size_t);
 int crypto_get_checksum(uint32_t *, unsigned char *, size_t);
 
+#define CRYPTO_SHA256      1
+#define CRYPTO_SHA1        2
+#define CRYPTO_RMD160      3
+#define CRYPTO_SHA512      4
+#define CRYPTO_SHA256_LEN  32
+#define CRYPTO_SHA1_LEN    20
+#define CRYPTO_RMD160_LEN  20
+#define CRYPTO_SHA512_LEN  64
+
+typedef struct CryptoHash *CryptoHash;
+
+int crypto_hash_open(CryptoHash, int);
+int crypto_hmac_open(CryptoHash, int);
+int crypto_tag_open(CryptoHash, const char *);
+int crypto_hash_set_key(CryptoHash, const unsigned char *, size_t);
+void crypto_hash_write(CryptoHash, const unsigned char *, size_t);
+int crypto_hash_copy(CryptoHash, CryptoHash);
+int crypto_hash_restore(CryptoHash, CryptoHash);
+int crypto_hash_final(unsigned char *, CryptoHash);
+int crypto_hash_final_double(unsigned char *, CryptoHash);
+void crypto_hash_close(CryptoHash);
+size_t crypto_hash_sizeof(void);
+
 #endif
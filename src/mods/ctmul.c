@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+#include "ctmul.h"
+#include "field.h"
+#include "error.h"
+
+// 3b for y^2 = x^3 + 7.
+#define CTMUL_B3  21
+
+static const unsigned char ctmul_gx[FIELD_LEN] = {
+	0x79, 0xBE, 0x66, 0x7E, 0xF9, 0xDC, 0xBB, 0xAC, 0x55, 0xA0, 0x62, 0x95, 0xCE, 0x87, 0x0B, 0x07,
+	0x02, 0x9B, 0xFC, 0xDB, 0x2D, 0xCE, 0x28, 0xD9, 0x59, 0xF2, 0x81, 0x5B, 0x16, 0xF8, 0x17, 0x98
+};
+
+static const unsigned char ctmul_gy[FIELD_LEN] = {
+	0x48, 0x3A, 0xDA, 0x77, 0x26, 0xA3, 0xC4, 0x65, 0x5D, 0xA4, 0xFB, 0xFC, 0x0E, 0x11, 0x08, 0xA8,
+	0xFD, 0x17, 0xB4, 0x48, 0xA6, 0x85, 0x54, 0x19, 0x9C, 0x47, 0xD0, 0x8F, 0xFB, 0x10, 0xD4, 0xB8
+};
+
+/*
+ * (X / Z, Y / Z), with the point at infinity as (0, 1, 0).
+ */
+struct CtmulPoint
+{
+	struct FieldElem x;
+	struct FieldElem y;
+	struct FieldElem z;
+};
+
+struct CtmulAffine
+{
+	struct FieldElem x;
+	struct FieldElem y;
+};
+
+/*
+ * Window w holds j * 16^w * G for j from 1 to 15 at j - 1. It is public,
+ * so it is built once for the whole process the first time it is needed
+ * and shared by every thread.
+ */
+static struct CtmulAffine ctmul_table[CTMUL_WINDOWS][CTMUL_WINDOW_POINTS];
+static pthread_once_t ctmul_table_once = PTHREAD_ONCE_INIT;
+
+static void ctmul_add(struct CtmulPoint *, const struct CtmulPoint *, const struct CtmulPoint *);
+static void ctmul_add_affine(struct CtmulPoint *, const struct CtmulPoint *, const struct CtmulAffine *);
+static void ctmul_build_table(void);
+static void ctmul_set_infinity(struct CtmulPoint *);
+static void ctmul_lookup(struct CtmulAffine *, int, uint32_t);
+
+/*
+ * k * G for a 32 byte big endian secret k, as 32 byte big endian affine
+ * x and y. Every 4 bits of k take one lookup and one addition whatever
+ * their value: the lookup reads all 15 entries of its window and keeps
+ * the right one by masking, and a zero digit's sum is made and then
+ * masked away. So neither the time taken nor the memory read depends on
+ * k. Returns 1, or -1 if k is a multiple of the order, which callers
+ * checking their key's range never see.
+ */
+int ctmul_generator(unsigned char *x, unsigned char *y, const unsigned char *k)
+{
+	int w, is_infinity;
+	uint32_t digit;
+	struct CtmulPoint acc, sum;
+	struct CtmulAffine entry;
+	struct FieldElem zi;
+
+	assert(x);
+	assert(y);
+	assert(k);
+
+	pthread_once(&ctmul_table_once, ctmul_build_table);
+
+	ctmul_set_infinity(&acc);
+	for (w = 0; w < CTMUL_WINDOWS; ++w)
+	{
+		digit = k[CTMUL_SCALAR_LEN - 1 - w / 2];
+		digit = (w & 1) ? (digit >> 4) : (digit & 0x0F);
+		ctmul_lookup(&entry, w, digit);
+		ctmul_add_affine(&sum, &acc, &entry);
+
+		// Keep the sum unless the digit was zero.
+		digit = ((digit - 1) >> 31) ^ 1;
+		field_cmov(&acc.x, &sum.x, digit);
+		field_cmov(&acc.y, &sum.y, digit);
+		field_cmov(&acc.z, &sum.z, digit);
+	}
+
+	is_infinity = field_is_zero(&acc.z);
+
+	field_inv(&zi, &acc.z);
+	field_mul(&acc.x, &acc.x, &zi);
+	field_mul(&acc.y, &acc.y, &zi);
+	field_get_bytes(x, &acc.x);
+	field_get_bytes(y, &acc.y);
+
+	memset(&acc, 0, sizeof(acc));
+	memset(&sum, 0, sizeof(sum));
+	memset(&entry, 0, sizeof(entry));
+	memset(&zi, 0, sizeof(zi));
+
+	if (is_infinity)
+	{
+		error_log("Scalar is a multiple of the curve order.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * The complete addition of Renes, Costello and Batina (2015, algorithm
+ * 7) for a = 0: the same 12 multiplications and 2 by 3b for any pair of
+ * points, with doubling and infinity needing no special case. r may be
+ * a or b.
+ */
+static void ctmul_add(struct CtmulPoint *r, const struct CtmulPoint *a, const struct CtmulPoint *b)
+{
+	struct FieldElem t0, t1, t2, t3, t4, x3, y3, z3;
+
+	field_mul(&t0, &a->x, &b->x);
+	field_mul(&t1, &a->y, &b->y);
+	field_mul(&t2, &a->z, &b->z);
+	field_add(&t3, &a->x, &a->y);
+	field_add(&t4, &b->x, &b->y);
+	field_mul(&t3, &t3, &t4);
+	field_add(&t4, &t0, &t1);
+	field_sub(&t3, &t3, &t4);
+	field_add(&t4, &a->y, &a->z);
+	field_add(&x3, &b->y, &b->z);
+	field_mul(&t4, &t4, &x3);
+	field_add(&x3, &t1, &t2);
+	field_sub(&t4, &t4, &x3);
+	field_add(&x3, &a->x, &a->z);
+	field_add(&y3, &b->x, &b->z);
+	field_mul(&x3, &x3, &y3);
+	field_add(&y3, &t0, &t2);
+	field_sub(&y3, &x3, &y3);
+	field_add(&x3, &t0, &t0);
+	field_add(&t0, &x3, &t0);
+	field_mul_int(&t2, &t2, CTMUL_B3);
+	field_add(&z3, &t1, &t2);
+	field_sub(&t1, &t1, &t2);
+	field_mul_int(&y3, &y3, CTMUL_B3);
+	field_mul(&x3, &t4, &y3);
+	field_mul(&t2, &t3, &t1);
+	field_sub(&x3, &t2, &x3);
+	field_mul(&y3, &y3, &t0);
+	field_mul(&t1, &t1, &z3);
+	field_add(&y3, &t1, &y3);
+	field_mul(&t0, &t0, &t3);
+	field_mul(&z3, &z3, &t4);
+	field_add(&z3, &z3, &t0);
+
+	r->x = x3;
+	r->y = y3;
+	r->z = z3;
+}
+
+/*
+ * Algorithm 8 of the same paper, one multiplication fewer for an affine
+ * b. Complete as long as b isn't infinity, which a table entry never
+ * is.
+ */
+static void ctmul_add_affine(struct CtmulPoint *r, const struct CtmulPoint *a, const struct CtmulAffine *b)
+{
+	struct FieldElem t0, t1, t2, t3, t4, x3, y3, z3;
+
+	field_mul(&t0, &a->x, &b->x);
+	field_mul(&t1, &a->y, &b->y);
+	field_add(&t3, &b->x, &b->y);
+	field_add(&t4, &a->x, &a->y);
+	field_mul(&t3, &t3, &t4);
+	field_add(&t4, &t0, &t1);
+	field_sub(&t3, &t3, &t4);
+	field_mul(&t4, &b->y, &a->z);
+	field_add(&t4, &t4, &a->y);
+	field_mul(&y3, &b->x, &a->z);
+	field_add(&y3, &y3, &a->x);
+	field_add(&x3, &t0, &t0);
+	field_add(&t0, &x3, &t0);
+	field_mul_int(&t2, &a->z, CTMUL_B3);
+	field_add(&z3, &t1, &t2);
+	field_sub(&t1, &t1, &t2);
+	field_mul_int(&y3, &y3, CTMUL_B3);
+	field_mul(&x3, &t4, &y3);
+	field_mul(&t2, &t3, &t1);
+	field_sub(&x3, &t2, &x3);
+	field_mul(&y3, &y3, &t0);
+	field_mul(&t1, &t1, &z3);
+	field_add(&y3, &t1, &y3);
+	field_mul(&t0, &t0, &t3);
+	field_mul(&z3, &z3, &t4);
+	field_add(&z3, &z3, &t0);
+
+	r->x = x3;
+	r->y = y3;
+	r->z = z3;
+}
+
+/*
+ * Each window's multiples are made projective and then made affine
+ * together with one inversion, by Montgomery's trick: with running
+ * products of the Zs, the inverse of the last product gives each Z's
+ * inverse on the way back.
+ */
+static void ctmul_build_table(void)
+{
+	int w, j;
+	struct CtmulPoint base;
+	struct CtmulPoint points[CTMUL_WINDOW_POINTS];
+	struct FieldElem products[CTMUL_WINDOW_POINTS];
+	struct FieldElem inv, zi;
+
+	field_set_bytes(&base.x, ctmul_gx);
+	field_set_bytes(&base.y, ctmul_gy);
+	field_set_int(&base.z, 1);
+
+	for (w = 0; w < CTMUL_WINDOWS; ++w)
+	{
+		points[0] = base;
+		for (j = 1; j < CTMUL_WINDOW_POINTS; ++j)
+		{
+			ctmul_add(&points[j], &points[j - 1], &base);
+		}
+		ctmul_add(&base, &points[CTMUL_WINDOW_POINTS - 1], &base);
+
+		products[0] = points[0].z;
+		for (j = 1; j < CTMUL_WINDOW_POINTS; ++j)
+		{
+			field_mul(&products[j], &products[j - 1], &points[j].z);
+		}
+		field_inv(&inv, &products[CTMUL_WINDOW_POINTS - 1]);
+		for (j = CTMUL_WINDOW_POINTS - 1; j > 0; --j)
+		{
+			field_mul(&zi, &inv, &products[j - 1]);
+			field_mul(&inv, &inv, &points[j].z);
+			field_mul(&ctmul_table[w][j].x, &points[j].x, &zi);
+			field_mul(&ctmul_table[w][j].y, &points[j].y, &zi);
+		}
+		field_mul(&ctmul_table[w][0].x, &points[0].x, &inv);
+		field_mul(&ctmul_table[w][0].y, &points[0].y, &inv);
+	}
+}
+
+static void ctmul_set_infinity(struct CtmulPoint *r)
+{
+	field_set_int(&r->x, 0);
+	field_set_int(&r->y, 1);
+	field_set_int(&r->z, 0);
+}
+
+/*
+ * Entry digit of window w, reading every entry of the window. A zero
+ * digit gets G's multiple of the window, to be added and thrown away.
+ */
+static void ctmul_lookup(struct CtmulAffine *r, int w, uint32_t digit)
+{
+	int j;
+	uint32_t hit;
+
+	*r = ctmul_table[w][0];
+	for (j = 1; j < CTMUL_WINDOW_POINTS; ++j)
+	{
+		// 1 when j + 1 == digit: only then is (j + 1 ^ digit) - 1 negative.
+		hit = ((((uint32_t)j + 1) ^ digit) - 1) >> 31;
+		field_cmov(&r->x, &ctmul_table[w][j].x, hit);
+		field_cmov(&r->y, &ctmul_table[w][j].y, hit);
+	}
+}
@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef CTMUL_H
+#define CTMUL_H 1
+
+#define CTMUL_SCALAR_LEN     32
+#define CTMUL_WINDOW_BITS    4
+#define CTMUL_WINDOWS        (CTMUL_SCALAR_LEN * 8 / CTMUL_WINDOW_BITS)
+#define CTMUL_WINDOW_POINTS  ((1 << CTMUL_WINDOW_BITS) - 1)
+
+int ctmul_generator(unsigned char *, unsigned char *, const unsigned char *);
+
+#endif
@@ -0,0 +1,952 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <gmp.h>
+#include <assert.h>
+#include "curve.h"
+#include "error.h"
+
+#define CURVE_PRIME        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F"
+#define CURVE_ORDER        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141"
+#define CURVE_GENERATOR_X  "79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+#define CURVE_GENERATOR_Y  "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8"
+#define CURVE_PRIME_FOLD   "1000003D1"
+#define CURVE_BETA         "7AE96A2B657C07106E64479EAC3434E99CF0497512F58995C1396C28719501EE"
+#define CURVE_GLV_A1       "3086D221A7D46BCDE86C90E49284EB15"
+#define CURVE_GLV_B1       "E4437ED6010E88286F547FA90ABFE4C3"
+#define CURVE_GLV_A2       "114CA50F7A8E2F3F657C1108D9D44CFD8"
+#define CURVE_NAF_LEN      160
+#define CURVE_COMB_BITS    8
+#define CURVE_COMB_WINDOWS (256 / CURVE_COMB_BITS)
+#define CURVE_COMB_POINTS  ((1 << CURVE_COMB_BITS) - 1)
+#define CURVE_MSM_BITS_MAX 16
+
+static int curve_build_comb(Curve);
+static void curve_split(Curve, const mpz_t);
+static int curve_wnaf(signed char *, mpz_t);
+static int curve_msm_bits(size_t);
+static int curve_get_bits(const unsigned char *, int, int);
+
+int curve_new(Curve c)
+{
+	int i;
+
+	assert(c);
+
+	mpz_init_set_str(c->p, CURVE_PRIME, 16);
+	mpz_init_set_str(c->n, CURVE_ORDER, 16);
+	mpz_init(c->half_n);
+	mpz_fdiv_q_2exp(c->half_n, c->n, 1);
+	mpz_init_set_str(c->fold, CURVE_PRIME_FOLD, 16);
+
+	// p = 3 mod 4, so a square root is a single power.
+	mpz_init(c->sqrt_exp);
+	mpz_add_ui(c->sqrt_exp, c->p, 1);
+	mpz_fdiv_q_2exp(c->sqrt_exp, c->sqrt_exp, 2);
+
+	// beta is the cube root of unity mod p for which lambda*(x, y) is
+	// (beta*x, y), lambda being 5363AD4C...1B23BD72, a cube root of unity
+	// mod n. a1, -b1 and a2 (b2 is a1) are the short basis GLV splits
+	// scalars with.
+	mpz_init_set_str(c->beta, CURVE_BETA, 16);
+	mpz_init_set_str(c->glv_a1, CURVE_GLV_A1, 16);
+	mpz_init_set_str(c->glv_b1, CURVE_GLV_B1, 16);
+	mpz_init_set_str(c->glv_a2, CURVE_GLV_A2, 16);
+	mpz_init(c->k1);
+	mpz_init(c->k2);
+
+	mpz_init_set_str(c->g.x, CURVE_GENERATOR_X, 16);
+	mpz_init_set_str(c->g.y, CURVE_GENERATOR_Y, 16);
+	c->g.infinity = 0;
+
+	for (i = 0; i < CURVE_WNAF_POINTS; ++i)
+	{
+		curve_jacobian_init(&c->wnaf_build[i]);
+		curve_affine_init(&c->wnaf[0][i]);
+		curve_affine_init(&c->wnaf[1][i]);
+	}
+	curve_affine_init(&c->wnaf_neg);
+	curve_jacobian_init(&c->part);
+	curve_jacobian_init(&c->running);
+	curve_jacobian_init(&c->sum);
+
+	for (i = 0; i < CURVE_TEMPS; ++i)
+	{
+		mpz_init2(c->t[i], 768);
+	}
+
+	c->comb = NULL;
+	c->buckets = NULL;
+	c->bucket_cap = 0;
+
+	return 1;
+}
+
+void curve_affine_init(struct CurveAffine *a)
+{
+	mpz_init2(a->x, 256);
+	mpz_init2(a->y, 256);
+	a->infinity = 1;
+}
+
+void curve_affine_clear(struct CurveAffine *a)
+{
+	mpz_clear(a->x);
+	mpz_clear(a->y);
+}
+
+void curve_jacobian_init(struct CurveJacobian *a)
+{
+	mpz_init2(a->x, 256);
+	mpz_init2(a->y, 256);
+	mpz_init2(a->z, 256);
+	a->infinity = 1;
+}
+
+void curve_jacobian_clear(struct CurveJacobian *a)
+{
+	mpz_clear(a->x);
+	mpz_clear(a->y);
+	mpz_clear(a->z);
+}
+
+/*
+ * p = 2^256 - 0x1000003D1, so the high half of a product folds back in
+ * as hi * 0x1000003D1. Two folds and a subtraction or two bring any
+ * product of reduced values below p without a division.
+ */
+void curve_reduce(Curve c, mpz_t a)
+{
+	mpz_t *hi = &c->t[CURVE_TEMPS - 1];
+
+	if (mpz_sgn(a) < 0)
+	{
+		mpz_mod(a, a, c->p);
+		return;
+	}
+
+	while (mpz_sizeinbase(a, 2) > 256)
+	{
+		mpz_fdiv_q_2exp(*hi, a, 256);
+		mpz_fdiv_r_2exp(a, a, 256);
+		mpz_addmul(a, *hi, c->fold);
+	}
+	while (mpz_cmp(a, c->p) >= 0)
+	{
+		mpz_sub(a, a, c->p);
+	}
+}
+
+void curve_mul(Curve c, mpz_t r, const mpz_t a, const mpz_t b)
+{
+	mpz_mul(r, a, b);
+	curve_reduce(c, r);
+}
+
+void curve_sqr(Curve c, mpz_t r, const mpz_t a)
+{
+	mpz_mul(r, a, a);
+	curve_reduce(c, r);
+}
+
+void curve_sub(Curve c, mpz_t r, const mpz_t a, const mpz_t b)
+{
+	mpz_sub(r, a, b);
+	if (mpz_sgn(r) < 0)
+	{
+		mpz_add(r, r, c->p);
+	}
+}
+
+/*
+ * The point with a given x and y of the given parity, from
+ * y^2 = x^3 + 7. Returns 0 if x is out of range or not on the curve.
+ */
+int curve_lift_x(Curve c, struct CurveAffine *r, const mpz_t x, int odd)
+{
+	mpz_t *t = c->t;
+
+	if (mpz_cmp(x, c->p) >= 0)
+	{
+		return 0;
+	}
+
+	curve_sqr(c, t[0], x);
+	curve_mul(c, t[0], t[0], x);
+	mpz_add_ui(t[0], t[0], 7);
+	curve_reduce(c, t[0]);
+	mpz_powm(r->y, t[0], c->sqrt_exp, c->p);
+	curve_sqr(c, t[1], r->y);
+	if (mpz_cmp(t[1], t[0]) != 0)
+	{
+		return 0;
+	}
+	if (mpz_odd_p(r->y) != (odd != 0))
+	{
+		mpz_sub(r->y, c->p, r->y);
+	}
+	mpz_set(r->x, x);
+	r->infinity = 0;
+
+	return 1;
+}
+
+/*
+ * For points given with both coordinates.
+ */
+int curve_is_on_curve(Curve c, const struct CurveAffine *a)
+{
+	mpz_t *t = c->t;
+
+	if (mpz_cmp(a->x, c->p) >= 0 || mpz_cmp(a->y, c->p) >= 0)
+	{
+		return 0;
+	}
+
+	curve_sqr(c, t[0], a->x);
+	curve_mul(c, t[0], t[0], a->x);
+	mpz_add_ui(t[0], t[0], 7);
+	curve_reduce(c, t[0]);
+	curve_sqr(c, t[1], a->y);
+
+	return mpz_cmp(t[0], t[1]) == 0;
+}
+
+/*
+ * dbl-2009-l: 2M + 5S.
+ */
+void curve_double(Curve c, struct CurveJacobian *a)
+{
+	mpz_t *t = c->t;
+
+	if (a->infinity)
+	{
+		return;
+	}
+	if (mpz_sgn(a->y) == 0)
+	{
+		a->infinity = 1;
+		return;
+	}
+
+	// Z3 = 2*Y1*Z1
+	curve_mul(c, a->z, a->y, a->z);
+	mpz_mul_2exp(a->z, a->z, 1);
+	curve_reduce(c, a->z);
+
+	curve_sqr(c, t[0], a->x);            // A = X1^2
+	curve_sqr(c, t[1], a->y);            // B = Y1^2
+	curve_sqr(c, t[2], t[1]);            // C = B^2
+	mpz_add(t[3], a->x, t[1]);
+	curve_sqr(c, t[3], t[3]);
+	mpz_sub(t[3], t[3], t[0]);
+	mpz_sub(t[3], t[3], t[2]);
+	mpz_mul_2exp(t[3], t[3], 1);
+	curve_reduce(c, t[3]);               // D = 2*((X1+B)^2-A-C)
+	mpz_mul_ui(t[4], t[0], 3);
+	curve_reduce(c, t[4]);               // E = 3*A
+	curve_sqr(c, t[5], t[4]);            // F = E^2
+
+	// X3 = F-2*D
+	mpz_mul_2exp(a->x, t[3], 1);
+	mpz_sub(a->x, t[5], a->x);
+	curve_reduce(c, a->x);
+
+	// Y3 = E*(D-X3)-8*C
+	curve_sub(c, t[3], t[3], a->x);
+	curve_mul(c, a->y, t[4], t[3]);
+	mpz_mul_2exp(t[2], t[2], 3);
+	mpz_sub(a->y, a->y, t[2]);
+	curve_reduce(c, a->y);
+}
+
+/*
+ * add-2007-bl: 11M + 5S, for two points with any Z. b must not be a.
+ */
+void curve_add(Curve c, struct CurveJacobian *a, const struct CurveJacobian *b)
+{
+	mpz_t *t = c->t;
+
+	assert(a != b);
+
+	if (b->infinity)
+	{
+		return;
+	}
+	if (a->infinity)
+	{
+		mpz_set(a->x, b->x);
+		mpz_set(a->y, b->y);
+		mpz_set(a->z, b->z);
+		a->infinity = 0;
+		return;
+	}
+
+	curve_sqr(c, t[0], a->z);            // Z1Z1 = Z1^2
+	curve_sqr(c, t[1], b->z);            // Z2Z2 = Z2^2
+	curve_mul(c, t[2], a->x, t[1]);      // U1 = X1*Z2Z2
+	curve_mul(c, t[3], b->x, t[0]);      // U2 = X2*Z1Z1
+	curve_mul(c, t[4], a->y, b->z);
+	curve_mul(c, t[4], t[4], t[1]);      // S1 = Y1*Z2*Z2Z2
+	curve_mul(c, t[5], b->y, a->z);
+	curve_mul(c, t[5], t[5], t[0]);      // S2 = Y2*Z1*Z1Z1
+	curve_sub(c, t[3], t[3], t[2]);      // H = U2-U1
+	curve_sub(c, t[5], t[5], t[4]);
+	mpz_mul_2exp(t[5], t[5], 1);
+	curve_reduce(c, t[5]);               // r = 2*(S2-S1)
+
+	if (mpz_sgn(t[3]) == 0)
+	{
+		if (mpz_sgn(t[5]) == 0)
+		{
+			curve_double(c, a);
+		}
+		else
+		{
+			a->infinity = 1;
+		}
+		return;
+	}
+
+	// Z3 = ((Z1+Z2)^2-Z1Z1-Z2Z2)*H
+	mpz_add(a->z, a->z, b->z);
+	curve_sqr(c, a->z, a->z);
+	mpz_sub(a->z, a->z, t[0]);
+	mpz_sub(a->z, a->z, t[1]);
+	curve_reduce(c, a->z);
+	curve_mul(c, a->z, a->z, t[3]);
+
+	mpz_mul_2exp(t[6], t[3], 1);
+	curve_sqr(c, t[6], t[6]);            // I = (2*H)^2
+	curve_mul(c, t[0], t[3], t[6]);      // J = H*I
+	curve_mul(c, t[1], t[2], t[6]);      // V = U1*I
+
+	// X3 = r^2-J-2*V
+	curve_sqr(c, a->x, t[5]);
+	mpz_sub(a->x, a->x, t[0]);
+	mpz_submul_ui(a->x, t[1], 2);
+	curve_reduce(c, a->x);
+
+	// Y3 = r*(V-X3)-2*S1*J
+	curve_mul(c, t[4], t[4], t[0]);
+	mpz_mul_2exp(t[4], t[4], 1);
+	curve_sub(c, t[1], t[1], a->x);
+	curve_mul(c, a->y, t[5], t[1]);
+	mpz_sub(a->y, a->y, t[4]);
+	curve_reduce(c, a->y);
+}
+
+/*
+ * madd-2007-bl: 7M + 4S, adding a point with Z = 1.
+ */
+void curve_add_affine(Curve c, struct CurveJacobian *a, const struct CurveAffine *b)
+{
+	mpz_t *t = c->t;
+
+	if (b->infinity)
+	{
+		return;
+	}
+	if (a->infinity)
+	{
+		mpz_set(a->x, b->x);
+		mpz_set(a->y, b->y);
+		mpz_set_ui(a->z, 1);
+		a->infinity = 0;
+		return;
+	}
+
+	curve_sqr(c, t[0], a->z);            // Z1Z1 = Z1^2
+	curve_mul(c, t[1], b->x, t[0]);      // U2 = X2*Z1Z1
+	curve_mul(c, t[2], b->y, a->z);
+	curve_mul(c, t[2], t[2], t[0]);      // S2 = Y2*Z1*Z1Z1
+	curve_sub(c, t[1], t[1], a->x);      // H = U2-X1
+	curve_sub(c, t[2], t[2], a->y);
+	mpz_mul_2exp(t[2], t[2], 1);
+	curve_reduce(c, t[2]);               // r = 2*(S2-Y1)
+
+	if (mpz_sgn(t[1]) == 0)
+	{
+		if (mpz_sgn(t[2]) == 0)
+		{
+			curve_double(c, a);
+		}
+		else
+		{
+			a->infinity = 1;
+		}
+		return;
+	}
+
+	curve_sqr(c, t[3], t[1]);            // HH = H^2
+	mpz_mul_2exp(t[4], t[3], 2);
+	curve_reduce(c, t[4]);               // I = 4*HH
+	curve_mul(c, t[5], t[1], t[4]);      // J = H*I
+	curve_mul(c, t[6], a->x, t[4]);      // V = X1*I
+
+	// Z3 = (Z1+H)^2-Z1Z1-HH
+	mpz_add(a->z, a->z, t[1]);
+	curve_sqr(c, a->z, a->z);
+	mpz_sub(a->z, a->z, t[0]);
+	mpz_sub(a->z, a->z, t[3]);
+	curve_reduce(c, a->z);
+
+	// X3 = r^2-J-2*V
+	curve_sqr(c, a->x, t[2]);
+	mpz_sub(a->x, a->x, t[5]);
+	mpz_submul_ui(a->x, t[6], 2);
+	curve_reduce(c, a->x);
+
+	// Y3 = r*(V-X3)-2*Y1*J
+	curve_mul(c, t[5], a->y, t[5]);
+	mpz_mul_2exp(t[5], t[5], 1);
+	curve_sub(c, t[6], t[6], a->x);
+	curve_mul(c, a->y, t[2], t[6]);
+	mpz_sub(a->y, a->y, t[5]);
+	curve_reduce(c, a->y);
+}
+
+/*
+ * An affine sum, with the one inversion it takes. r may be a or b.
+ */
+void curve_sum_affine(Curve c, struct CurveAffine *r, const struct CurveAffine *a, const struct CurveAffine *b)
+{
+	mpz_t *t = c->t;
+
+	if (mpz_cmp(a->x, b->x) == 0)
+	{
+		if (mpz_cmp(a->y, b->y) != 0)
+		{
+			r->infinity = 1;
+			return;
+		}
+		// slope = 3*x^2 / 2*y
+		curve_sqr(c, t[0], a->x);
+		mpz_mul_ui(t[0], t[0], 3);
+		mpz_mul_2exp(t[1], a->y, 1);
+	}
+	else
+	{
+		// slope = (y2-y1) / (x2-x1)
+		curve_sub(c, t[0], b->y, a->y);
+		curve_sub(c, t[1], b->x, a->x);
+	}
+	mpz_invert(t[1], t[1], c->p);
+	curve_mul(c, t[0], t[0], t[1]);
+
+	// x = slope^2 - x1 - x2, y = slope*(x1-x) - y1
+	curve_sqr(c, t[2], t[0]);
+	mpz_sub(t[2], t[2], a->x);
+	mpz_sub(t[2], t[2], b->x);
+	curve_reduce(c, t[2]);
+	curve_sub(c, t[3], a->x, t[2]);
+	curve_mul(c, t[3], t[0], t[3]);
+	curve_sub(c, r->y, t[3], a->y);
+	mpz_set(r->x, t[2]);
+	r->infinity = 0;
+}
+
+void curve_to_affine(Curve c, struct CurveAffine *r, const struct CurveJacobian *a)
+{
+	mpz_t *t = c->t;
+
+	if (a->infinity)
+	{
+		r->infinity = 1;
+		return;
+	}
+
+	mpz_invert(t[0], a->z, c->p);
+	curve_sqr(c, t[1], t[0]);
+	curve_mul(c, r->x, a->x, t[1]);
+	curve_mul(c, t[1], t[1], t[0]);
+	curve_mul(c, r->y, a->y, t[1]);
+	r->infinity = 0;
+}
+
+/*
+ * curve_to_affine() for count points with one inversion, by Montgomery's
+ * trick: invert the product of all the Z and peel each 1/Z off it going
+ * back. r[i].x holds the running products on the way, so r must not
+ * overlap a.
+ */
+void curve_to_affine_batch(Curve c, struct CurveAffine *r, const struct CurveJacobian *a, size_t count)
+{
+	size_t i, last;
+	mpz_t *t = c->t;
+
+	// r[i].x = product of the Z up to i, infinities skipped.
+	for (last = count, i = 0; i < count; ++i)
+	{
+		r[i].infinity = a[i].infinity;
+		if (a[i].infinity)
+		{
+			continue;
+		}
+		if (last == count)
+		{
+			mpz_set(r[i].x, a[i].z);
+		}
+		else
+		{
+			curve_mul(c, r[i].x, r[last].x, a[i].z);
+		}
+		last = i;
+	}
+	if (last == count)
+	{
+		return;
+	}
+
+	mpz_invert(t[4], r[last].x, c->p);
+	for (i = count; i-- > 0; )
+	{
+		if (a[i].infinity)
+		{
+			continue;
+		}
+
+		// 1/Z[i] is the inverse so far times the product before i.
+		for (last = i; last-- > 0 && a[last].infinity; )
+			;
+		if (last < i)
+		{
+			curve_mul(c, t[0], t[4], r[last].x);
+			curve_mul(c, t[4], t[4], a[i].z);
+		}
+		else
+		{
+			mpz_set(t[0], t[4]);
+		}
+
+		curve_sqr(c, t[1], t[0]);
+		curve_mul(c, r[i].x, a[i].x, t[1]);
+		curve_mul(c, t[1], t[1], t[0]);
+		curve_mul(c, r[i].y, a[i].y, t[1]);
+	}
+}
+
+/*
+ * k * G for a 32 byte big endian k from a table of multiples of G,
+ * comb[w][j - 1] = j * 256^w * G, so it's one addition per nonzero byte
+ * of k and no doublings. The table is built on first use. Returns -1 if
+ * it can't be.
+ */
+int curve_mul_generator(Curve c, struct CurveJacobian *acc, const unsigned char *k)
+{
+	int w, digit;
+
+	if (c->comb == NULL && curve_build_comb(c) < 0)
+	{
+		return -1;
+	}
+
+	acc->infinity = 1;
+	for (w = 0; w < CURVE_COMB_WINDOWS; ++w)
+	{
+		digit = curve_get_bits(k, w * CURVE_COMB_BITS, CURVE_COMB_BITS);
+		if (digit != 0)
+		{
+			curve_add_affine(c, acc, &c->comb[w * CURVE_COMB_POINTS + digit - 1]);
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * k*Q for any point Q other than infinity and 0 <= k < n, with GLV and
+ * wNAF. k is split into k1 + k2*lambda with k1 and k2 about 128 bits,
+ * and lambda*Q costs one multiplication, so both halves share a chain
+ * of 128 doublings instead of 256. Each half is written in width 5 NAF,
+ * which has a nonzero digit in about one place in six, every digit an
+ * odd multiple of Q from a table of eight made up front.
+ */
+void curve_mul_point(Curve c, struct CurveJacobian *acc, const struct CurveAffine *q, const mpz_t k)
+{
+	int i, j, d, len, sign[2], count[2];
+	signed char naf[2][CURVE_NAF_LEN];
+	const struct CurveAffine *point;
+
+	assert(!q->infinity);
+
+	curve_split(c, k);
+	sign[0] = mpz_sgn(c->k1);
+	sign[1] = mpz_sgn(c->k2);
+	mpz_abs(c->k1, c->k1);
+	mpz_abs(c->k2, c->k2);
+	count[0] = curve_wnaf(naf[0], c->k1);
+	count[1] = curve_wnaf(naf[1], c->k2);
+
+	// Q, 3Q, ..., 15Q, and the same times lambda.
+	mpz_set(c->wnaf_build[0].x, q->x);
+	mpz_set(c->wnaf_build[0].y, q->y);
+	mpz_set_ui(c->wnaf_build[0].z, 1);
+	c->wnaf_build[0].infinity = 0;
+	mpz_set(c->part.x, q->x);
+	mpz_set(c->part.y, q->y);
+	mpz_set_ui(c->part.z, 1);
+	c->part.infinity = 0;
+	curve_double(c, &c->part);
+	for (i = 1; i < CURVE_WNAF_POINTS; ++i)
+	{
+		mpz_set(c->wnaf_build[i].x, c->wnaf_build[i - 1].x);
+		mpz_set(c->wnaf_build[i].y, c->wnaf_build[i - 1].y);
+		mpz_set(c->wnaf_build[i].z, c->wnaf_build[i - 1].z);
+		c->wnaf_build[i].infinity = c->wnaf_build[i - 1].infinity;
+		curve_add(c, &c->wnaf_build[i], &c->part);
+	}
+	curve_to_affine_batch(c, c->wnaf[0], c->wnaf_build, CURVE_WNAF_POINTS);
+	for (i = 0; i < CURVE_WNAF_POINTS; ++i)
+	{
+		curve_mul(c, c->wnaf[1][i].x, c->wnaf[0][i].x, c->beta);
+		mpz_set(c->wnaf[1][i].y, c->wnaf[0][i].y);
+		c->wnaf[1][i].infinity = c->wnaf[0][i].infinity;
+	}
+
+	len = (count[0] > count[1]) ? count[0] : count[1];
+	acc->infinity = 1;
+	for (i = len; i-- > 0; )
+	{
+		curve_double(c, acc);
+		for (j = 0; j < 2; ++j)
+		{
+			d = (i < count[j]) ? naf[j][i] * sign[j] : 0;
+			if (d > 0)
+			{
+				curve_add_affine(c, acc, &c->wnaf[j][d / 2]);
+			}
+			else if (d < 0)
+			{
+				point = &c->wnaf[j][-d / 2];
+				mpz_set(c->wnaf_neg.x, point->x);
+				mpz_sub(c->wnaf_neg.y, c->p, point->y);
+				c->wnaf_neg.infinity = 0;
+				curve_add_affine(c, acc, &c->wnaf_neg);
+			}
+		}
+	}
+}
+
+/*
+ * u1*G + u2*Q, for checking signatures: the comb for u1*G and GLV for
+ * u2*Q. Q must not be infinity. Returns -1 if the comb can't be built.
+ */
+int curve_mul_double(Curve c, struct CurveJacobian *acc, const mpz_t u1, const struct CurveAffine *q, const mpz_t u2)
+{
+	unsigned char k[CURVE_SCALAR_LEN];
+
+	curve_mul_point(c, &c->part, q, u2);
+	curve_export_scalar(k, u1);
+	if (curve_mul_generator(c, acc, k) < 0)
+	{
+		return -1;
+	}
+	curve_add(c, acc, &c->part);
+
+	return 1;
+}
+
+/*
+ * The sum of scalars[i] * points[i], by Pippenger's bucket method: for
+ * each window of bits, from the top, every point is added once into the
+ * bucket for its digit and the buckets are summed with a running total
+ * so bucket j counts j times. The window size is picked for the number
+ * of points. Returns -1 if the buckets can't be allocated.
+ */
+int curve_msm(Curve c, struct CurveJacobian *acc, const struct CurveAffine *points, const unsigned char (*scalars)[CURVE_SCALAR_LEN], size_t count)
+{
+	int bits, w, windows, digit;
+	size_t i, j, buckets;
+	struct CurveJacobian *tmp;
+
+	bits = curve_msm_bits(count);
+	buckets = ((size_t)1 << bits) - 1;
+
+	if (c->bucket_cap < buckets)
+	{
+		tmp = realloc(c->buckets, sizeof(*c->buckets) * buckets);
+		if (tmp == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		c->buckets = tmp;
+		for (j = c->bucket_cap; j < buckets; ++j)
+		{
+			curve_jacobian_init(&c->buckets[j]);
+		}
+		c->bucket_cap = buckets;
+	}
+
+	acc->infinity = 1;
+	windows = (256 + bits - 1) / bits;
+	for (w = windows - 1; w >= 0; --w)
+	{
+		for (j = 0; j < (size_t)bits; ++j)
+		{
+			curve_double(c, acc);
+		}
+
+		for (j = 0; j < buckets; ++j)
+		{
+			c->buckets[j].infinity = 1;
+		}
+		for (i = 0; i < count; ++i)
+		{
+			digit = curve_get_bits(scalars[i], w * bits, bits);
+			if (digit != 0)
+			{
+				curve_add_affine(c, &c->buckets[digit - 1], &points[i]);
+			}
+		}
+
+		c->running.infinity = 1;
+		c->sum.infinity = 1;
+		for (j = buckets; j-- > 0; )
+		{
+			curve_add(c, &c->running, &c->buckets[j]);
+			curve_add(c, &c->sum, &c->running);
+		}
+		curve_add(c, acc, &c->sum);
+	}
+
+	return 1;
+}
+
+void curve_export_scalar(unsigned char *output, const mpz_t a)
+{
+	size_t count;
+
+	memset(output, 0, CURVE_SCALAR_LEN);
+	if (mpz_sgn(a) != 0)
+	{
+		count = (mpz_sizeinbase(a, 2) + 7) / 8;
+		mpz_export(output + CURVE_SCALAR_LEN - count, NULL, 1, 1, 1, 0, a);
+	}
+}
+
+void curve_clear(Curve c)
+{
+	size_t i;
+
+	assert(c);
+
+	mpz_clear(c->p);
+	mpz_clear(c->n);
+	mpz_clear(c->half_n);
+	mpz_clear(c->fold);
+	mpz_clear(c->sqrt_exp);
+	mpz_clear(c->beta);
+	mpz_clear(c->glv_a1);
+	mpz_clear(c->glv_b1);
+	mpz_clear(c->glv_a2);
+	mpz_clear(c->k1);
+	mpz_clear(c->k2);
+	curve_affine_clear(&c->g);
+	for (i = 0; i < CURVE_WNAF_POINTS; ++i)
+	{
+		curve_jacobian_clear(&c->wnaf_build[i]);
+		curve_affine_clear(&c->wnaf[0][i]);
+		curve_affine_clear(&c->wnaf[1][i]);
+	}
+	curve_affine_clear(&c->wnaf_neg);
+	curve_jacobian_clear(&c->part);
+	curve_jacobian_clear(&c->running);
+	curve_jacobian_clear(&c->sum);
+	for (i = 0; i < CURVE_TEMPS; ++i)
+	{
+		mpz_clear(c->t[i]);
+	}
+	if (c->comb != NULL)
+	{
+		for (i = 0; i < CURVE_COMB_WINDOWS * CURVE_COMB_POINTS; ++i)
+		{
+			curve_affine_clear(&c->comb[i]);
+		}
+		free(c->comb);
+	}
+	for (i = 0; i < c->bucket_cap; ++i)
+	{
+		curve_jacobian_clear(&c->buckets[i]);
+	}
+	free(c->buckets);
+}
+
+size_t curve_sizeof(void)
+{
+	return sizeof(struct Curve);
+}
+
+/*
+ * Fill the comb one window at a time. Each window's points are the
+ * previous point plus the window's base, and one more is the next
+ * window's base, 256 times this one. They are added in Jacobian form and
+ * made affine together, so each window costs one inversion.
+ */
+static int curve_build_comb(Curve c)
+{
+	int w, j, count;
+	struct CurveAffine *window;
+	struct CurveJacobian *points;
+
+	c->comb = malloc(sizeof(*c->comb) * CURVE_COMB_WINDOWS * CURVE_COMB_POINTS);
+	points = malloc(sizeof(*points) * (CURVE_COMB_POINTS + 1));
+	if (c->comb == NULL || points == NULL)
+	{
+		error_log("Memory allocation error.");
+		free(c->comb);
+		free(points);
+		c->comb = NULL;
+		return -1;
+	}
+	for (j = 0; j < CURVE_COMB_WINDOWS * CURVE_COMB_POINTS; ++j)
+	{
+		curve_affine_init(&c->comb[j]);
+	}
+	for (j = 0; j < CURVE_COMB_POINTS + 1; ++j)
+	{
+		curve_jacobian_init(&points[j]);
+	}
+
+	mpz_set(c->comb[0].x, c->g.x);
+	mpz_set(c->comb[0].y, c->g.y);
+	c->comb[0].infinity = 0;
+
+	for (w = 0; w < CURVE_COMB_WINDOWS; ++w)
+	{
+		// The next window's base lands just past this window.
+		window = &c->comb[w * CURVE_COMB_POINTS];
+		count = (w + 1 < CURVE_COMB_WINDOWS) ? CURVE_COMB_POINTS + 1 : CURVE_COMB_POINTS;
+
+		mpz_set(points[0].x, window[0].x);
+		mpz_set(points[0].y, window[0].y);
+		mpz_set_ui(points[0].z, 1);
+		points[0].infinity = 0;
+		for (j = 1; j < count; ++j)
+		{
+			mpz_set(points[j].x, points[j - 1].x);
+			mpz_set(points[j].y, points[j - 1].y);
+			mpz_set(points[j].z, points[j - 1].z);
+			points[j].infinity = points[j - 1].infinity;
+			curve_add_affine(c, &points[j], &window[0]);
+		}
+		curve_to_affine_batch(c, window, points, count);
+	}
+
+	for (j = 0; j < CURVE_COMB_POINTS + 1; ++j)
+	{
+		curve_jacobian_clear(&points[j]);
+	}
+	free(points);
+
+	return 1;
+}
+
+/*
+ * k = k1 + k2*lambda mod n into c->k1 and c->k2, signed and about 128
+ * bits each: with c1 = round(b2*k / n) and c2 = round(-b1*k / n),
+ * k1 = k - c1*a1 - c2*a2 and k2 = -c1*b1 - c2*b2.
+ */
+static void curve_split(Curve c, const mpz_t k)
+{
+	mpz_t *t = c->t;
+
+	mpz_mul(t[0], c->glv_a1, k);
+	mpz_add(t[0], t[0], c->half_n);
+	mpz_fdiv_q(t[0], t[0], c->n);
+	mpz_mul(t[1], c->glv_b1, k);
+	mpz_add(t[1], t[1], c->half_n);
+	mpz_fdiv_q(t[1], t[1], c->n);
+
+	mpz_set(c->k1, k);
+	mpz_submul(c->k1, t[0], c->glv_a1);
+	mpz_submul(c->k1, t[1], c->glv_a2);
+	mpz_mul(c->k2, t[0], c->glv_b1);
+	mpz_submul(c->k2, t[1], c->glv_a1);
+}
+
+/*
+ * Width 5 NAF of k >= 0, least significant digit first: each digit is
+ * zero or odd in -15..15, and any nonzero digit is followed by at least
+ * four zeros. Consumes k. Returns the number of digits.
+ */
+static int curve_wnaf(signed char *naf, mpz_t k)
+{
+	int len, d;
+
+	for (len = 0; mpz_sgn(k) != 0; ++len)
+	{
+		assert(len < CURVE_NAF_LEN);
+
+		d = 0;
+		if (mpz_odd_p(k))
+		{
+			d = (int)mpz_fdiv_ui(k, 1 << CURVE_WNAF_BITS);
+			if (d >= 1 << (CURVE_WNAF_BITS - 1))
+			{
+				d -= 1 << CURVE_WNAF_BITS;
+				mpz_add_ui(k, k, (unsigned long)-d);
+			}
+			else
+			{
+				mpz_sub_ui(k, k, (unsigned long)d);
+			}
+		}
+		naf[len] = (signed char)d;
+		mpz_fdiv_q_2exp(k, k, 1);
+	}
+
+	return len;
+}
+
+/*
+ * Pippenger costs about (256 / bits) * (count + 2^(bits + 1)) additions,
+ * so take the window that minimizes that.
+ */
+static int curve_msm_bits(size_t count)
+{
+	int bits, best;
+	double cost, best_cost;
+
+	best = 1;
+	best_cost = 0;
+	for (bits = 1; bits <= CURVE_MSM_BITS_MAX; ++bits)
+	{
+		cost = ((256.0 + bits - 1) / bits) * ((double)count + (double)((size_t)2 << bits));
+		if (bits == 1 || cost < best_cost)
+		{
+			best = bits;
+			best_cost = cost;
+		}
+	}
+
+	return best;
+}
+
+/*
+ * count bits of a 32 byte big endian scalar starting at bit pos from the
+ * least significant end. Bits past the top read as zero.
+ */
+static int curve_get_bits(const unsigned char *k, int pos, int count)
+{
+	int i, bit, r;
+
+	for (r = 0, i = count; i-- > 0; )
+	{
+		bit = pos + i;
+		r <<= 1;
+		if (bit < 256)
+		{
+			r |= (k[CURVE_SCALAR_LEN - 1 - bit / 8] >> (bit % 8)) & 1;
+		}
+	}
+
+	return r;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef CURVE_H
+#define CURVE_H 1
+
+#include <stddef.h>
+#include <gmp.h>
+
+#define CURVE_SCALAR_LEN    32
+#define CURVE_TEMPS         8
+#define CURVE_WNAF_BITS     5
+#define CURVE_WNAF_POINTS   (1 << (CURVE_WNAF_BITS - 2))
+
+struct CurveAffine
+{
+	mpz_t x;
+	mpz_t y;
+	int infinity;
+};
+
+/*
+ * (X / Z^2, Y / Z^3), so adding and doubling need no inversions.
+ */
+struct CurveJacobian
+{
+	mpz_t x;
+	mpz_t y;
+	mpz_t z;
+	int infinity;
+};
+
+/*
+ * secp256k1 arithmetic shared by the signature schemes. Everything is
+ * allocated up front or on first use and reused, so one context per
+ * thread works without touching the heap.
+ *
+ * Temporaries t[0] to t[CURVE_TEMPS - 2] are free for callers between
+ * calls but every point operation clobbers them. The last one belongs
+ * to curve_reduce().
+ */
+typedef struct Curve *Curve;
+struct Curve
+{
+	mpz_t p;
+	mpz_t n;
+	mpz_t half_n;
+	mpz_t fold;
+	mpz_t sqrt_exp;
+	mpz_t beta;
+	mpz_t glv_a1;
+	mpz_t glv_b1;
+	mpz_t glv_a2;
+	mpz_t k1;
+	mpz_t k2;
+	struct CurveAffine g;
+	struct CurveJacobian wnaf_build[CURVE_WNAF_POINTS];
+	struct CurveAffine wnaf[2][CURVE_WNAF_POINTS];
+	struct CurveAffine wnaf_neg;
+	struct CurveJacobian part;
+	struct CurveAffine *comb;
+	struct CurveJacobian *buckets;
+	size_t bucket_cap;
+	struct CurveJacobian running;
+	struct CurveJacobian sum;
+	mpz_t t[CURVE_TEMPS];
+};
+
+int curve_new(Curve);
+void curve_affine_init(struct CurveAffine *);
+void curve_affine_clear(struct CurveAffine *);
+void curve_jacobian_init(struct CurveJacobian *);
+void curve_jacobian_clear(struct CurveJacobian *);
+void curve_reduce(Curve, mpz_t);
+void curve_mul(Curve, mpz_t, const mpz_t, const mpz_t);
+void curve_sqr(Curve, mpz_t, const mpz_t);
+void curve_sub(Curve, mpz_t, const mpz_t, const mpz_t);
+int curve_lift_x(Curve, struct CurveAffine *, const mpz_t, int);
+int curve_is_on_curve(Curve, const struct CurveAffine *);
+void curve_double(Curve, struct CurveJacobian *);
+void curve_add(Curve, struct CurveJacobian *, const struct CurveJacobian *);
+void curve_add_affine(Curve, struct CurveJacobian *, const struct CurveAffine *);
+void curve_sum_affine(Curve, struct CurveAffine *, const struct CurveAffine *, const struct CurveAffine *);
+void curve_to_affine(Curve, struct CurveAffine *, const struct CurveJacobian *);
+void curve_to_affine_batch(Curve, struct CurveAffine *, const struct CurveJacobian *, size_t);
+int curve_mul_generator(Curve, struct CurveJacobian *, const unsigned char *);
+void curve_mul_point(Curve, struct CurveJacobian *, const struct CurveAffine *, const mpz_t);
+int curve_mul_double(Curve, struct CurveJacobian *, const mpz_t, const struct CurveAffine *, const mpz_t);
+int curve_msm(Curve, struct CurveJacobian *, const struct CurveAffine *, const unsigned char (*)[CURVE_SCALAR_LEN], size_t);
+void curve_export_scalar(unsigned char *, const mpz_t);
+void curve_clear(Curve);
+size_t curve_sizeof(void);
+
+#endif
@@ -0,0 +1,588 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "download.h"
+#include "node.h"
+#include "message.h"
+#include "block.h"
+#include "blkfile.h"
+#include "txview.h"
+#include "commands/inv.h"
+#include "commands/ping.h"
+#include "error.h"
+
+#define STATUS_QUEUED    0
+#define STATUS_INFLIGHT  1
+#define STATUS_DONE      2
+
+#define POLL_INTERVAL    100
+#define MAX_ATTEMPTS     8
+
+struct DownloadPeer
+{
+	Node node;
+	int active;
+	size_t inflight[DOWNLOAD_WINDOW_MAX];
+	size_t inflight_count;
+	uint64_t last_progress;
+	uint64_t blocks;
+	uint64_t bytes;
+	uint64_t stalls;
+};
+
+struct Download
+{
+	unsigned char *hashes;
+	size_t hash_count;
+	size_t *sorted;
+	unsigned char *status;
+	unsigned char *attempts;
+	size_t *retry;
+	size_t retry_count;
+	size_t next;
+	size_t done;
+	BlkFile out;
+	Inv inv;
+	TxView tx;
+	int window;
+	uint64_t stall_timeout;
+	struct DownloadPeer peers[DOWNLOAD_PEERS_MAX];
+	size_t peer_count;
+	uint64_t bytes;
+	uint64_t start;
+	uint64_t finish;
+};
+
+static unsigned char *sort_hashes;
+
+static int download_cmp(const void *, const void *);
+static long download_find(Download, unsigned char *);
+static int download_fill(Download, struct DownloadPeer *);
+static int download_handle(Download, struct DownloadPeer *, Message);
+static void download_drop(Download, struct DownloadPeer *);
+static void download_requeue(Download, size_t);
+static void download_forget(struct DownloadPeer *, size_t);
+
+/*
+ * Set up a download of the given block hashes (internal byte order, 32
+ * bytes each). Blocks are written to out as they arrive. Each peer keeps
+ * up to window requests in flight, and a peer that goes stall_timeout
+ * seconds without delivering is dropped and its requests handed to others.
+ */
+int download_new(Download d, unsigned char *hashes, size_t hash_count, BlkFile out, int window, int stall_timeout)
+{
+	size_t i;
+
+	assert(d);
+	assert(hashes);
+	assert(hash_count);
+	assert(out);
+
+	if (window < 1 || window > DOWNLOAD_WINDOW_MAX)
+	{
+		error_log("Request window must be between 1 and %i.", DOWNLOAD_WINDOW_MAX);
+		return -1;
+	}
+
+	memset(d, 0, sizeof(*d));
+
+	d->hashes = hashes;
+	d->hash_count = hash_count;
+	d->out = out;
+	d->window = window;
+	d->stall_timeout = (uint64_t)stall_timeout * 1000;
+
+	d->sorted = malloc(sizeof(*d->sorted) * hash_count);
+	d->retry = malloc(sizeof(*d->retry) * hash_count);
+	d->status = calloc(hash_count, 1);
+	d->attempts = calloc(hash_count, 1);
+	d->inv = malloc(inv_sizeof());
+	d->tx = malloc(txview_sizeof());
+	if (d->sorted == NULL || d->retry == NULL || d->status == NULL || d->attempts == NULL || d->inv == NULL || d->tx == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	txview_new(d->tx);
+
+	// Index the hashes so incoming blocks can be matched with a binary
+	// search instead of a scan.
+	for (i = 0; i < hash_count; ++i)
+	{
+		d->sorted[i] = i;
+	}
+	sort_hashes = hashes;
+	qsort(d->sorted, hash_count, sizeof(*d->sorted), download_cmp);
+
+	return 1;
+}
+
+int download_add_peer(Download d, Node node)
+{
+	assert(d);
+	assert(node);
+
+	if (d->peer_count >= DOWNLOAD_PEERS_MAX)
+	{
+		error_log("Can not download from more than %i peers.", DOWNLOAD_PEERS_MAX);
+		return -1;
+	}
+
+	memset(&d->peers[d->peer_count], 0, sizeof(struct DownloadPeer));
+	d->peers[d->peer_count].node = node;
+	d->peers[d->peer_count].active = 1;
+	d->peer_count++;
+
+	return 1;
+}
+
+int download_run(Download d)
+{
+	int r;
+	size_t i, active;
+	uint64_t now;
+	Node nodes[DOWNLOAD_PEERS_MAX];
+	int readable[DOWNLOAD_PEERS_MAX];
+	Message message;
+
+	assert(d);
+
+	if (d->peer_count == 0)
+	{
+		error_log("No peers to download from.");
+		return -1;
+	}
+
+	message = malloc(message_sizeof());
+	if (message == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	d->start = node_now_us();
+
+	while (d->done < d->hash_count)
+	{
+		now = node_now();
+
+		for (active = 0, i = 0; i < d->peer_count; ++i)
+		{
+			if (!d->peers[i].active)
+			{
+				nodes[i] = NULL;
+				continue;
+			}
+
+			// Stalled peers give their outstanding requests back to
+			// the queue so the remaining peers can pick them up.
+			if (d->peers[i].inflight_count > 0 && now - d->peers[i].last_progress > d->stall_timeout)
+			{
+				d->peers[i].stalls++;
+				download_drop(d, &d->peers[i]);
+				nodes[i] = NULL;
+				continue;
+			}
+
+			r = download_fill(d, &d->peers[i]);
+			if (r < 0)
+			{
+				download_drop(d, &d->peers[i]);
+				nodes[i] = NULL;
+				continue;
+			}
+
+			nodes[i] = d->peers[i].node;
+			active++;
+		}
+
+		if (active == 0)
+		{
+			error_log("All peers disconnected or stalled with %zu blocks remaining.", d->hash_count - d->done);
+			free(message);
+			return -1;
+		}
+
+		r = node_poll(nodes, readable, d->peer_count, POLL_INTERVAL);
+		if (r < 0)
+		{
+			error_log("Could not wait for peer data.");
+			free(message);
+			return -1;
+		}
+
+		for (i = 0; i < d->peer_count; ++i)
+		{
+			if (nodes[i] == NULL || !readable[i])
+			{
+				continue;
+			}
+
+			while ((r = node_read_message(nodes[i], message)) > 0)
+			{
+				r = download_handle(d, &d->peers[i], message);
+				message_clear(message);
+				if (r < 0)
+				{
+					error_log("Could not process message from %s.", node_get_host(nodes[i]));
+					free(message);
+					return -1;
+				}
+				if (!d->peers[i].active)
+				{
+					// Dropped while handling the message, so its
+					// socket is already closed.
+					break;
+				}
+			}
+			if (r < 0)
+			{
+				error_clear();
+				download_drop(d, &d->peers[i]);
+			}
+		}
+	}
+
+	d->finish = node_now_us();
+
+	free(message);
+
+	return 1;
+}
+
+int download_to_json(char *output, Download d)
+{
+	size_t i;
+	double elapsed;
+
+	assert(output);
+	assert(d);
+
+	elapsed = (double)(d->finish - d->start) / 1000000.0;
+
+	output += sprintf(output, "{\n");
+	output += sprintf(output, "  \"blocks\": %zu,\n", d->done);
+	output += sprintf(output, "  \"bytes\": %"PRIu64",\n", d->bytes);
+	output += sprintf(output, "  \"milliseconds\": %.3f,\n", elapsed * 1000.0);
+	output += sprintf(output, "  \"mb_per_second\": %.2f,\n", elapsed > 0 ? ((double)d->bytes / 1048576.0) / elapsed : 0.0);
+	output += sprintf(output, "  \"peers\": [\n");
+	for (i = 0; i < d->peer_count; ++i)
+	{
+		output += sprintf(output, "    {\n");
+		output += sprintf(output, "      \"host\": \"%s\",\n", node_get_host(d->peers[i].node));
+		output += sprintf(output, "      \"blocks\": %"PRIu64",\n", d->peers[i].blocks);
+		output += sprintf(output, "      \"bytes\": %"PRIu64",\n", d->peers[i].bytes);
+		output += sprintf(output, "      \"stalls\": %"PRIu64"\n", d->peers[i].stalls);
+		output += sprintf(output, "    }%s\n", (i + 1 < d->peer_count) ? "," : "");
+	}
+	output += sprintf(output, "  ]\n");
+	sprintf(output, "}");
+
+	return 1;
+}
+
+void download_clear(Download d)
+{
+	assert(d);
+
+	free(d->sorted);
+	free(d->retry);
+	free(d->status);
+	free(d->attempts);
+	free(d->inv);
+	d->inv = NULL;
+	if (d->tx != NULL)
+	{
+		txview_clear(d->tx);
+		free(d->tx);
+		d->tx = NULL;
+	}
+	d->sorted = d->retry = NULL;
+	d->status = d->attempts = NULL;
+}
+
+size_t download_sizeof(void)
+{
+	return sizeof(struct Download);
+}
+
+static int download_cmp(const void *a, const void *b)
+{
+	return memcmp(sort_hashes + (*(size_t *)a * BLOCK_HASH_LEN), sort_hashes + (*(size_t *)b * BLOCK_HASH_LEN), BLOCK_HASH_LEN);
+}
+
+static long download_find(Download d, unsigned char *hash)
+{
+	int c;
+	size_t lo, hi, mid;
+
+	lo = 0;
+	hi = d->hash_count;
+
+	while (lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		c = memcmp(hash, d->hashes + (d->sorted[mid] * BLOCK_HASH_LEN), BLOCK_HASH_LEN);
+		if (c == 0)
+		{
+			return (long)d->sorted[mid];
+		}
+		if (c < 0)
+		{
+			hi = mid;
+		}
+		else
+		{
+			lo = mid + 1;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Top the peer's request window back up. All new requests go out in a
+ * single getdata message.
+ */
+static int download_fill(Download d, struct DownloadPeer *peer)
+{
+	int r;
+	size_t index;
+	unsigned char *payload;
+
+	if (peer->inflight_count >= (size_t)d->window)
+	{
+		return 1;
+	}
+	if (d->retry_count == 0 && d->next >= d->hash_count)
+	{
+		return 1;
+	}
+
+	inv_new(d->inv);
+
+	if (peer->inflight_count == 0)
+	{
+		peer->last_progress = node_now();
+	}
+
+	while (peer->inflight_count < (size_t)d->window)
+	{
+		if (d->retry_count > 0)
+		{
+			index = d->retry[--d->retry_count];
+		}
+		else if (d->next < d->hash_count)
+		{
+			index = d->next++;
+		}
+		else
+		{
+			break;
+		}
+
+		if (d->status[index] != STATUS_QUEUED)
+		{
+			continue;
+		}
+
+		d->status[index] = STATUS_INFLIGHT;
+		d->attempts[index]++;
+		peer->inflight[peer->inflight_count++] = index;
+
+		inv_add(d->inv, INV_TYPE_WITNESS_BLOCK, d->hashes + (index * BLOCK_HASH_LEN));
+	}
+
+	if (inv_get_count(d->inv) == 0)
+	{
+		return 1;
+	}
+
+	payload = malloc(inv_serialized_len(d->inv));
+	if (payload == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = inv_serialize(payload, d->inv);
+
+	r = node_send_message(peer->node, GETDATA_COMMAND, payload, r);
+
+	free(payload);
+
+	if (r < 0)
+	{
+		error_log("Could not send getdata message to %s.", node_get_host(peer->node));
+		return -1;
+	}
+
+	return 1;
+}
+
+static int download_handle(Download d, struct DownloadPeer *peer, Message message)
+{
+	int r;
+	long index;
+	size_t i, payload_len;
+	uint32_t type;
+	unsigned char *payload;
+	unsigned char hash[BLOCK_HASH_LEN];
+
+	payload = message_get_payload_ptr(message);
+	payload_len = message_get_payload_len(message);
+
+	if (message_cmp_command(message, BLOCK_COMMAND) == 0)
+	{
+		if (message_is_valid(message) <= 0)
+		{
+			// Treat a corrupt block like a stall. Someone else can
+			// send it to us.
+			error_clear();
+			download_drop(d, peer);
+			return 1;
+		}
+
+		r = block_get_hash(hash, payload, payload_len);
+		if (r < 0)
+		{
+			error_clear();
+			download_drop(d, peer);
+			return 1;
+		}
+
+		index = download_find(d, hash);
+		if (index < 0 || d->status[index] == STATUS_DONE)
+		{
+			// Unsolicited or duplicate block
+			return 1;
+		}
+
+		// The hash only covers the header. A peer could pair a real
+		// header with any transactions it likes, so hold them to the
+		// header's merkle root before they go to disk. Dropping the
+		// peer hands the hash to someone else.
+		r = block_check_merkle_root(d->tx, payload, payload_len);
+		if (r <= 0)
+		{
+			error_clear();
+			download_drop(d, peer);
+			return 1;
+		}
+
+		r = blkfile_write(d->out, payload, payload_len);
+		if (r < 0)
+		{
+			error_log("Could not write block to disk.");
+			return -1;
+		}
+
+		d->status[index] = STATUS_DONE;
+		d->done++;
+		d->bytes += payload_len;
+
+		download_forget(peer, (size_t)index);
+		peer->blocks++;
+		peer->bytes += payload_len;
+		peer->last_progress = node_now();
+
+		// If a stalled peer delivered after all, the request may also be
+		// sitting with someone else. Let them off the hook.
+		for (i = 0; i < d->peer_count; ++i)
+		{
+			if (&d->peers[i] != peer)
+			{
+				download_forget(&d->peers[i], (size_t)index);
+			}
+		}
+	}
+	else if (message_cmp_command(message, NOTFOUND_COMMAND) == 0)
+	{
+		r = inv_deserialize(d->inv, payload, payload_len);
+		if (r < 0)
+		{
+			error_clear();
+			return 1;
+		}
+
+		for (i = 0; i < inv_get_count(d->inv); ++i)
+		{
+			inv_get(&type, hash, d->inv, i);
+			index = download_find(d, hash);
+			if (index < 0 || d->status[index] != STATUS_INFLIGHT)
+			{
+				continue;
+			}
+			if (d->attempts[index] >= MAX_ATTEMPTS)
+			{
+				error_log("No peer could provide block after %i attempts.", MAX_ATTEMPTS);
+				return -1;
+			}
+			download_forget(peer, (size_t)index);
+			download_requeue(d, (size_t)index);
+		}
+	}
+	else if (message_cmp_command(message, PING_COMMAND) == 0)
+	{
+		r = node_send_message(peer->node, PONG_COMMAND, payload, payload_len);
+		if (r < 0)
+		{
+			error_clear();
+			download_drop(d, peer);
+		}
+	}
+
+	return 1;
+}
+
+static void download_drop(Download d, struct DownloadPeer *peer)
+{
+	size_t i;
+
+	if (!peer->active)
+	{
+		return;
+	}
+
+	for (i = 0; i < peer->inflight_count; ++i)
+	{
+		if (d->status[peer->inflight[i]] == STATUS_INFLIGHT)
+		{
+			download_requeue(d, peer->inflight[i]);
+		}
+	}
+	peer->inflight_count = 0;
+	peer->active = 0;
+
+	node_disconnect(peer->node);
+}
+
+static void download_requeue(Download d, size_t index)
+{
+	d->status[index] = STATUS_QUEUED;
+	d->retry[d->retry_count++] = index;
+}
+
+static void download_forget(struct DownloadPeer *peer, size_t index)
+{
+	size_t i;
+
+	for (i = 0; i < peer->inflight_count; ++i)
+	{
+		if (peer->inflight[i] == index)
+		{
+			peer->inflight[i] = peer->inflight[--peer->inflight_count];
+			return;
+		}
+	}
+}
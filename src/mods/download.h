@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef DOWNLOAD_H
+#define DOWNLOAD_H 1
+
+#include <stddef.h>
+#include "node.h"
+#include "blkfile.h"
+
+#define DOWNLOAD_WINDOW_DEFAULT  16
+#define DOWNLOAD_WINDOW_MAX      128
+#define DOWNLOAD_STALL_DEFAULT   10
+#define DOWNLOAD_PEERS_MAX       64
+
+typedef struct Download *Download;
+
+int download_new(Download, unsigned char *, size_t, BlkFile, int, int);
+int download_add_peer(Download, Node);
+int download_run(Download);
+int download_to_json(char *, Download);
+void download_clear(Download);
+size_t download_sizeof(void);
+
+#endif
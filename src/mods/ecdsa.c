@@ -0,0 +1,535 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <gmp.h>
+#include <assert.h>
+#include "ecdsa.h"
+#include "curve.h"
+#include "ctmul.h"
+#include "scalar.h"
+#include "crypto.h"
+#include "error.h"
+
+/*
+ * Everything a verification needs is allocated here once, so verifying
+ * doesn't touch the heap after the first call. One context per thread.
+ * The curve's table of multiples of G is only made on the first
+ * verification and the HMAC for RFC6979 nonces on the first signature.
+ */
+struct Ecdsa
+{
+	struct Curve curve;
+	struct CurveAffine q;
+	struct CurveJacobian acc;
+	mpz_t r;
+	mpz_t s;
+	mpz_t u1;
+	mpz_t u2;
+	CryptoHash hmac;
+	unsigned char nonce_k[CRYPTO_SHA256_LEN];
+	unsigned char nonce_v[CRYPTO_SHA256_LEN];
+	int nonce_used;
+};
+
+static int ecdsa_parse_pubkey(Ecdsa, const unsigned char *, size_t);
+static int ecdsa_nonce_init(Ecdsa, const unsigned char *, const unsigned char *);
+static void ecdsa_nonce_next(Ecdsa, unsigned char *);
+static void ecdsa_hmac(Ecdsa, unsigned char *, const unsigned char *, size_t, ...);
+static size_t ecdsa_write_der_int(unsigned char *, const unsigned char *);
+static int ecdsa_parse_der_int(size_t *, size_t *, size_t *, const unsigned char *, size_t);
+static void ecdsa_copy_int(unsigned char *, const unsigned char *, size_t);
+
+int ecdsa_new(Ecdsa e)
+{
+	assert(e);
+
+	if (curve_new(&e->curve) < 0)
+	{
+		return -1;
+	}
+	curve_affine_init(&e->q);
+	curve_jacobian_init(&e->acc);
+
+	mpz_init(e->r);
+	mpz_init(e->s);
+	mpz_init(e->u1);
+	mpz_init(e->u2);
+
+	e->hmac = NULL;
+
+	return 1;
+}
+
+/*
+ * Parse a DER signature, without its hash type byte, into 32 byte big
+ * endian r and s. This is as lax as consensus has to be: length bytes
+ * may be long form or overstate the data, integers may carry extra
+ * zero padding and trailing garbage is ignored. An integer too large for
+ * 32 bytes parses as zero, which never verifies. Returns 1, or -1 if
+ * the framing can't be followed at all.
+ */
+int ecdsa_parse_der(unsigned char *r, unsigned char *s, const unsigned char *sig, size_t len)
+{
+	size_t pos, r_pos, r_len, s_pos, s_len, skip;
+
+	assert(r);
+	assert(s);
+	assert(sig || len == 0);
+
+	pos = 0;
+
+	// Sequence tag and a length we don't trust.
+	if (pos == len || sig[pos++] != 0x30)
+	{
+		return -1;
+	}
+	if (pos == len)
+	{
+		return -1;
+	}
+	skip = sig[pos++];
+	if (skip & 0x80)
+	{
+		skip -= 0x80;
+		if (skip > len - pos)
+		{
+			return -1;
+		}
+		pos += skip;
+	}
+
+	if (ecdsa_parse_der_int(&pos, &r_pos, &r_len, sig, len) < 0)
+	{
+		return -1;
+	}
+	if (ecdsa_parse_der_int(&pos, &s_pos, &s_len, sig, len) < 0)
+	{
+		return -1;
+	}
+
+	ecdsa_copy_int(r, sig + r_pos, r_len);
+	ecdsa_copy_int(s, sig + s_pos, s_len);
+
+	return 1;
+}
+
+/*
+ * Check a signature (r, s) on a 32 byte hash against a serialized public
+ * key, computing u1*G + u2*Q with the generator comb and GLV. High S
+ * values are accepted, as they are by consensus. Returns 1 if the
+ * signature is valid and 0 if it isn't, or -1 on a failure to allocate.
+ */
+int ecdsa_verify(Ecdsa e, const unsigned char *hash, const unsigned char *r, const unsigned char *s, const unsigned char *pubkey, size_t pubkey_len)
+{
+	Curve c;
+	mpz_t *t;
+
+	assert(e);
+	assert(hash);
+	assert(r);
+	assert(s);
+	assert(pubkey || pubkey_len == 0);
+
+	c = &e->curve;
+	t = c->t;
+
+	mpz_import(e->r, ECDSA_SCALAR_LEN, 1, 1, 1, 0, r);
+	mpz_import(e->s, ECDSA_SCALAR_LEN, 1, 1, 1, 0, s);
+	if (mpz_sgn(e->r) == 0 || mpz_cmp(e->r, c->n) >= 0 || mpz_sgn(e->s) == 0 || mpz_cmp(e->s, c->n) >= 0)
+	{
+		return 0;
+	}
+
+	if (!ecdsa_parse_pubkey(e, pubkey, pubkey_len))
+	{
+		return 0;
+	}
+
+	// w = 1/s, u1 = z*w, u2 = r*w, all mod n.
+	mpz_import(t[0], ECDSA_HASH_LEN, 1, 1, 1, 0, hash);
+	mpz_invert(t[1], e->s, c->n);
+	mpz_mul(e->u1, t[0], t[1]);
+	mpz_mod(e->u1, e->u1, c->n);
+	mpz_mul(e->u2, e->r, t[1]);
+	mpz_mod(e->u2, e->u2, c->n);
+
+	if (curve_mul_double(c, &e->acc, e->u1, &e->q, e->u2) < 0)
+	{
+		return -1;
+	}
+	if (e->acc.infinity)
+	{
+		return 0;
+	}
+
+	// Compare x = X / Z^2 with r without inverting Z. x is reduced mod
+	// n, so r + n is a match too when it's still below p.
+	curve_sqr(c, t[0], e->acc.z);
+	curve_mul(c, t[1], e->r, t[0]);
+	if (mpz_cmp(t[1], e->acc.x) == 0)
+	{
+		return 1;
+	}
+	mpz_add(t[2], e->r, c->n);
+	if (mpz_cmp(t[2], c->p) < 0)
+	{
+		curve_mul(c, t[1], t[2], t[0]);
+		if (mpz_cmp(t[1], e->acc.x) == 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Sign a 32 byte hash with a 32 byte private key into 32 byte big endian
+ * r and s. The nonce is RFC6979's, derived from the key and the hash, so
+ * the same key and hash always give the same signature and no random
+ * source is involved. s is normalized to the lower half of the order as
+ * BIP62 and standardness want. Returns 1, or -1 if the key is zero or
+ * not below the order.
+ *
+ * Nothing secret goes through GMP: the nonce's point is found in
+ * constant time by ctmul_generator() and the arithmetic mod n is
+ * scalar.c's.
+ */
+int ecdsa_sign(Ecdsa e, unsigned char *r, unsigned char *s, const unsigned char *hash, const unsigned char *privkey)
+{
+	int invalid;
+	unsigned char z[ECDSA_SCALAR_LEN];
+	unsigned char k[ECDSA_SCALAR_LEN];
+	unsigned char x[ECDSA_SCALAR_LEN];
+	unsigned char y[ECDSA_SCALAR_LEN];
+	struct Scalar sd, sz, sk, sr, ss, t;
+
+	assert(e);
+	assert(r);
+	assert(s);
+	assert(hash);
+	assert(privkey);
+
+	invalid = scalar_set_bytes(&sd, privkey) | scalar_is_zero(&sd);
+	if (invalid)
+	{
+		memset(&sd, 0, sizeof(sd));
+		error_log("Private key is out of range.");
+		return -1;
+	}
+
+	// z = hash mod n, which is also RFC6979's bits2octets.
+	scalar_set_bytes(&sz, hash);
+	scalar_get_bytes(z, &sz);
+
+	if (ecdsa_nonce_init(e, privkey, z) < 0)
+	{
+		memset(&sd, 0, sizeof(sd));
+		return -1;
+	}
+
+	for (;;)
+	{
+		ecdsa_nonce_next(e, k);
+		invalid = scalar_set_bytes(&sk, k) | scalar_is_zero(&sk);
+		if (invalid)
+		{
+			continue;
+		}
+
+		// r = x(k*G) mod n
+		if (ctmul_generator(x, y, k) < 0)
+		{
+			memset(k, 0, ECDSA_SCALAR_LEN);
+			memset(&sk, 0, sizeof(sk));
+			memset(&sd, 0, sizeof(sd));
+			return -1;
+		}
+		scalar_set_bytes(&sr, x);
+		if (scalar_is_zero(&sr))
+		{
+			continue;
+		}
+
+		// s = (z + r*d) / k mod n
+		scalar_mul(&ss, &sr, &sd);
+		scalar_add(&ss, &ss, &sz);
+		scalar_inv(&sk, &sk);
+		scalar_mul(&ss, &ss, &sk);
+		if (scalar_is_zero(&ss))
+		{
+			continue;
+		}
+		break;
+	}
+
+	scalar_neg(&t, &ss);
+	scalar_cmov(&ss, &t, (uint32_t)scalar_is_high(&ss));
+
+	scalar_get_bytes(r, &sr);
+	scalar_get_bytes(s, &ss);
+
+	memset(k, 0, ECDSA_SCALAR_LEN);
+	memset(&sk, 0, sizeof(sk));
+	memset(&sd, 0, sizeof(sd));
+
+	return 1;
+}
+
+/*
+ * DER encode 32 byte r and s, as they go in a script signature before
+ * the hash type byte. Returns the length, at most ECDSA_DER_LEN_MAX.
+ */
+size_t ecdsa_to_der(unsigned char *output, const unsigned char *r, const unsigned char *s)
+{
+	size_t len;
+
+	assert(output);
+	assert(r);
+	assert(s);
+
+	len = 2;
+	len += ecdsa_write_der_int(output + len, r);
+	len += ecdsa_write_der_int(output + len, s);
+
+	output[0] = 0x30;
+	output[1] = (unsigned char)(len - 2);
+
+	return len;
+}
+
+void ecdsa_clear(Ecdsa e)
+{
+	assert(e);
+
+	curve_clear(&e->curve);
+	curve_affine_clear(&e->q);
+	curve_jacobian_clear(&e->acc);
+	mpz_clear(e->r);
+	mpz_clear(e->s);
+	mpz_clear(e->u1);
+	mpz_clear(e->u2);
+	if (e->hmac != NULL)
+	{
+		crypto_hash_close(e->hmac);
+		free(e->hmac);
+	}
+	memset(e->nonce_k, 0, sizeof(e->nonce_k));
+	memset(e->nonce_v, 0, sizeof(e->nonce_v));
+}
+
+size_t ecdsa_sizeof(void)
+{
+	return sizeof(struct Ecdsa);
+}
+
+/*
+ * Compressed (02, 03), uncompressed (04) and hybrid (06, 07) keys are
+ * all valid in scripts. The point must be on the curve.
+ */
+static int ecdsa_parse_pubkey(Ecdsa e, const unsigned char *pubkey, size_t len)
+{
+	if (len == 33 && (pubkey[0] == 0x02 || pubkey[0] == 0x03))
+	{
+		mpz_import(e->u1, 32, 1, 1, 1, 0, pubkey + 1);
+
+		return curve_lift_x(&e->curve, &e->q, e->u1, pubkey[0] & 1);
+	}
+
+	if (len == 65 && (pubkey[0] == 0x04 || pubkey[0] == 0x06 || pubkey[0] == 0x07))
+	{
+		mpz_import(e->q.x, 32, 1, 1, 1, 0, pubkey + 1);
+		mpz_import(e->q.y, 32, 1, 1, 1, 0, pubkey + 33);
+		e->q.infinity = 0;
+		if (pubkey[0] != 0x04 && (int)mpz_odd_p(e->q.y) != (pubkey[0] & 1))
+		{
+			return 0;
+		}
+
+		return curve_is_on_curve(&e->curve, &e->q);
+	}
+
+	return 0;
+}
+
+/*
+ * RFC6979 3.2 steps b to g, for a 256 bit order and HMAC-SHA256, with
+ * the key and the reduced hash as 32 bytes each.
+ */
+static int ecdsa_nonce_init(Ecdsa e, const unsigned char *key, const unsigned char *hash)
+{
+	unsigned char zero = 0x00, one = 0x01;
+
+	if (e->hmac == NULL)
+	{
+		e->hmac = malloc(crypto_hash_sizeof());
+		if (e->hmac == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		if (crypto_hmac_open(e->hmac, CRYPTO_SHA256) < 0)
+		{
+			free(e->hmac);
+			e->hmac = NULL;
+			return -1;
+		}
+	}
+
+	memset(e->nonce_v, 0x01, sizeof(e->nonce_v));
+	memset(e->nonce_k, 0x00, sizeof(e->nonce_k));
+
+	ecdsa_hmac(e, e->nonce_k, e->nonce_v, sizeof(e->nonce_v), &zero, (size_t)1, key, (size_t)ECDSA_SCALAR_LEN, hash, (size_t)ECDSA_SCALAR_LEN, NULL);
+	ecdsa_hmac(e, e->nonce_v, e->nonce_v, sizeof(e->nonce_v), NULL);
+	ecdsa_hmac(e, e->nonce_k, e->nonce_v, sizeof(e->nonce_v), &one, (size_t)1, key, (size_t)ECDSA_SCALAR_LEN, hash, (size_t)ECDSA_SCALAR_LEN, NULL);
+	ecdsa_hmac(e, e->nonce_v, e->nonce_v, sizeof(e->nonce_v), NULL);
+
+	e->nonce_used = 0;
+
+	return 1;
+}
+
+/*
+ * Step h: the next candidate nonce, moving K and V on first if the last
+ * one was rejected.
+ */
+static void ecdsa_nonce_next(Ecdsa e, unsigned char *k)
+{
+	unsigned char zero = 0x00;
+
+	if (e->nonce_used)
+	{
+		ecdsa_hmac(e, e->nonce_k, e->nonce_v, sizeof(e->nonce_v), &zero, (size_t)1, NULL);
+		ecdsa_hmac(e, e->nonce_v, e->nonce_v, sizeof(e->nonce_v), NULL);
+	}
+	ecdsa_hmac(e, e->nonce_v, e->nonce_v, sizeof(e->nonce_v), NULL);
+	memcpy(k, e->nonce_v, ECDSA_SCALAR_LEN);
+
+	e->nonce_used = 1;
+}
+
+/*
+ * HMAC keyed with the current K over a NULL terminated list of pointer
+ * and length pairs. The output may be one of the inputs.
+ */
+static void ecdsa_hmac(Ecdsa e, unsigned char *output, const unsigned char *data, size_t len, ...)
+{
+	va_list ap;
+
+	crypto_hash_set_key(e->hmac, e->nonce_k, sizeof(e->nonce_k));
+
+	va_start(ap, len);
+	while (data != NULL)
+	{
+		crypto_hash_write(e->hmac, data, len);
+		data = va_arg(ap, const unsigned char *);
+		if (data != NULL)
+		{
+			len = va_arg(ap, size_t);
+		}
+	}
+	va_end(ap);
+
+	crypto_hash_final(output, e->hmac);
+}
+
+/*
+ * A minimal DER INTEGER: no leading zeros but one to keep the value from
+ * reading as negative.
+ */
+static size_t ecdsa_write_der_int(unsigned char *output, const unsigned char *value)
+{
+	size_t skip, len;
+
+	for (skip = 0; skip < ECDSA_SCALAR_LEN - 1 && value[skip] == 0; ++skip)
+		;
+
+	len = ECDSA_SCALAR_LEN - skip;
+	output[0] = 0x02;
+	if (value[skip] & 0x80)
+	{
+		output[1] = (unsigned char)(len + 1);
+		output[2] = 0x00;
+		memcpy(output + 3, value + skip, len);
+		return len + 3;
+	}
+	output[1] = (unsigned char)len;
+	memcpy(output + 2, value + skip, len);
+
+	return len + 2;
+}
+
+/*
+ * An INTEGER tag and length, long form allowed. Leaves pos past the
+ * integer and data/data_len on its content.
+ */
+static int ecdsa_parse_der_int(size_t *pos, size_t *data, size_t *data_len, const unsigned char *sig, size_t len)
+{
+	size_t n, value;
+
+	if (*pos == len || sig[(*pos)++] != 0x02)
+	{
+		return -1;
+	}
+	if (*pos == len)
+	{
+		return -1;
+	}
+
+	n = sig[(*pos)++];
+	if (n & 0x80)
+	{
+		n -= 0x80;
+		if (n > len - *pos)
+		{
+			return -1;
+		}
+		while (n > 0 && sig[*pos] == 0)
+		{
+			(*pos)++;
+			n--;
+		}
+		if (n >= sizeof(size_t))
+		{
+			return -1;
+		}
+		for (value = 0; n > 0; --n)
+		{
+			value = (value << 8) | sig[(*pos)++];
+		}
+		n = value;
+	}
+
+	if (n > len - *pos)
+	{
+		return -1;
+	}
+
+	*data = *pos;
+	*data_len = n;
+	*pos += n;
+
+	return 1;
+}
+
+static void ecdsa_copy_int(unsigned char *output, const unsigned char *input, size_t len)
+{
+	while (len > 0 && *input == 0)
+	{
+		input++;
+		len--;
+	}
+
+	memset(output, 0, ECDSA_SCALAR_LEN);
+	if (len <= ECDSA_SCALAR_LEN)
+	{
+		memcpy(output + ECDSA_SCALAR_LEN - len, input, len);
+	}
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef ECDSA_H
+#define ECDSA_H 1
+
+#include <stddef.h>
+
+#define ECDSA_HASH_LEN    32
+#define ECDSA_SCALAR_LEN  32
+#define ECDSA_DER_LEN_MAX 72
+
+typedef struct Ecdsa *Ecdsa;
+
+int ecdsa_new(Ecdsa);
+int ecdsa_parse_der(unsigned char *, unsigned char *, const unsigned char *, size_t);
+int ecdsa_verify(Ecdsa, const unsigned char *, const unsigned char *, const unsigned char *, const unsigned char *, size_t);
+int ecdsa_sign(Ecdsa, unsigned char *, unsigned char *, const unsigned char *, const unsigned char *);
+size_t ecdsa_to_der(unsigned char *, const unsigned char *, const unsigned char *);
+void ecdsa_clear(Ecdsa);
+size_t ecdsa_sizeof(void);
+
+#endif
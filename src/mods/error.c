@@ -12,8 +12,10 @@
 #define ERROR_LIST_MAX		20
 #define ERROR_LENGTH_MAX	100
 
-static char error_stack[ERROR_LIST_MAX][ERROR_LENGTH_MAX];
-static int N = 0;
+// Each thread keeps its own stack so workers can log and clear errors
+// without stepping on each other.
+static _Thread_local char error_stack[ERROR_LIST_MAX][ERROR_LENGTH_MAX];
+static _Thread_local int N = 0;
 
 void error_log(char *error, ...)
 {
@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <assert.h>
+#include "extsort.h"
+#include "error.h"
+
+#define EXTSORT_PATH_MAXLEN  4096
+#define EXTSORT_IO_BUFFER    0x10000
+
+struct ExtSortMerge
+{
+	FILE **runs;
+	size_t run_count;
+	unsigned char *heads;
+	size_t *heap;
+	size_t heap_count;
+};
+
+struct ExtSort
+{
+	size_t record_size;
+	int (*cmp)(const void *, const void *);
+	unsigned char *buffer;
+	size_t buffer_cap;
+	size_t buffer_count;
+	size_t buffer_next;
+	char prefix[EXTSORT_PATH_MAXLEN];
+	unsigned int run_number;
+	FILE **runs;
+	unsigned int *levels;
+	size_t run_count;
+	size_t run_cap;
+	struct ExtSortMerge merge;
+	int merging;
+	uint64_t count;
+};
+
+static int extsort_spill(ExtSort);
+static FILE *extsort_run_open(ExtSort);
+static int extsort_collapse(ExtSort);
+static int extsort_merge_start(ExtSort, FILE **, size_t);
+static int extsort_merge_next(void *, ExtSort);
+static void extsort_merge_end(ExtSort, int);
+static void extsort_sift(ExtSort, size_t);
+
+/*
+ * Sort fixed size records that may not fit in memory. Records are
+ * buffered up to the memory budget, then sorted and written out as runs
+ * named after prefix, which are merged back when they're read. Run files
+ * are unlinked as soon as they're created so nothing is left behind.
+ */
+int extsort_new(ExtSort sort, size_t record_size, int (*cmp)(const void *, const void *), size_t memory, const char *prefix)
+{
+	assert(sort);
+	assert(record_size);
+	assert(cmp);
+	assert(prefix);
+
+	memset(sort, 0, sizeof(*sort));
+
+	if (strlen(prefix) + 16 >= EXTSORT_PATH_MAXLEN)
+	{
+		error_log("Sort file prefix is too long.");
+		return -1;
+	}
+	strcpy(sort->prefix, prefix);
+
+	sort->record_size = record_size;
+	sort->cmp = cmp;
+	sort->buffer_cap = memory / record_size;
+	if (sort->buffer_cap < 2)
+	{
+		sort->buffer_cap = 2;
+	}
+
+	sort->buffer = malloc(sort->buffer_cap * record_size);
+	if (sort->buffer == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	return 1;
+}
+
+int extsort_add(ExtSort sort, const void *record)
+{
+	assert(sort);
+	assert(record);
+	assert(!sort->merging);
+
+	if (sort->buffer_count == sort->buffer_cap)
+	{
+		if (extsort_spill(sort) < 0)
+		{
+			return -1;
+		}
+	}
+
+	memcpy(sort->buffer + sort->buffer_count * sort->record_size, record, sort->record_size);
+	sort->buffer_count++;
+	sort->count++;
+
+	return 1;
+}
+
+/*
+ * Stop adding and get ready to read records back in order. If everything
+ * fit in memory no files are touched. Otherwise the remaining runs are
+ * merged in groups of EXTSORT_FANIN until few enough are left to merge in
+ * one pass.
+ */
+int extsort_finish(ExtSort sort)
+{
+	assert(sort);
+	assert(!sort->merging);
+
+	sort->merging = 1;
+
+	if (sort->run_count == 0)
+	{
+		qsort(sort->buffer, sort->buffer_count, sort->record_size, sort->cmp);
+		sort->buffer_next = 0;
+		return 1;
+	}
+
+	if (sort->buffer_count > 0 && extsort_spill(sort) < 0)
+	{
+		return -1;
+	}
+
+	while (sort->run_count > EXTSORT_FANIN)
+	{
+		if (extsort_collapse(sort) < 0)
+		{
+			return -1;
+		}
+	}
+
+	return extsort_merge_start(sort, sort->runs, sort->run_count);
+}
+
+/*
+ * Copy the next record in order into output. Returns 0 once they've all
+ * been read.
+ */
+int extsort_next(void *output, ExtSort sort)
+{
+	assert(output);
+	assert(sort);
+	assert(sort->merging);
+
+	if (sort->run_count == 0)
+	{
+		if (sort->buffer_next == sort->buffer_count)
+		{
+			return 0;
+		}
+		memcpy(output, sort->buffer + sort->buffer_next * sort->record_size, sort->record_size);
+		sort->buffer_next++;
+		return 1;
+	}
+
+	return extsort_merge_next(output, sort);
+}
+
+uint64_t extsort_get_count(ExtSort sort)
+{
+	assert(sort);
+
+	return sort->count;
+}
+
+void extsort_clear(ExtSort sort)
+{
+	size_t i;
+
+	assert(sort);
+
+	extsort_merge_end(sort, 0);
+	for (i = 0; i < sort->run_count; ++i)
+	{
+		fclose(sort->runs[i]);
+	}
+	free(sort->runs);
+	free(sort->levels);
+	free(sort->buffer);
+
+	memset(sort, 0, sizeof(*sort));
+}
+
+size_t extsort_sizeof(void)
+{
+	return sizeof(struct ExtSort);
+}
+
+static int extsort_spill(ExtSort sort)
+{
+	FILE *fp;
+	void *tmp;
+
+	qsort(sort->buffer, sort->buffer_count, sort->record_size, sort->cmp);
+
+	if (sort->run_count == sort->run_cap)
+	{
+		sort->run_cap = (sort->run_cap > 0) ? sort->run_cap * 2 : 16;
+		tmp = realloc(sort->runs, sizeof(FILE *) * sort->run_cap);
+		if (tmp == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		sort->runs = tmp;
+		tmp = realloc(sort->levels, sizeof(unsigned int) * sort->run_cap);
+		if (tmp == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		sort->levels = tmp;
+	}
+
+	fp = extsort_run_open(sort);
+	if (fp == NULL)
+	{
+		return -1;
+	}
+
+	if (fwrite(sort->buffer, sort->record_size, sort->buffer_count, fp) != sort->buffer_count)
+	{
+		error_log("Could not write sort run. Errno %i.", errno);
+		fclose(fp);
+		return -1;
+	}
+
+	sort->runs[sort->run_count] = fp;
+	sort->levels[sort->run_count++] = 0;
+	sort->buffer_count = 0;
+
+	// Once EXTSORT_FANIN runs of a level pile up, merge them into one run
+	// of the next level. This keeps the number of open runs logarithmic
+	// and each record is rewritten once per level.
+	while (sort->run_count >= EXTSORT_FANIN && sort->levels[sort->run_count - EXTSORT_FANIN] == sort->levels[sort->run_count - 1])
+	{
+		if (extsort_collapse(sort) < 0)
+		{
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+static FILE *extsort_run_open(ExtSort sort)
+{
+	FILE *fp;
+	char path[EXTSORT_PATH_MAXLEN + 16];
+
+	snprintf(path, sizeof(path), "%s.run%u", sort->prefix, sort->run_number++);
+
+	fp = fopen(path, "w+b");
+	if (fp == NULL)
+	{
+		error_log("Unable to create sort file %s. Errno %i.", path, errno);
+		return NULL;
+	}
+	unlink(path);
+
+	return fp;
+}
+
+/*
+ * Merge the last EXTSORT_FANIN runs into a single run.
+ */
+static int extsort_collapse(ExtSort sort)
+{
+	int r;
+	size_t first;
+	unsigned int level;
+	FILE *fp;
+	unsigned char *record;
+
+	// The sort buffer has just been spilled, so one record of it serves as
+	// scratch.
+	record = sort->buffer;
+
+	first = sort->run_count - EXTSORT_FANIN;
+	level = sort->levels[first] + 1;
+
+	fp = extsort_run_open(sort);
+	if (fp == NULL)
+	{
+		return -1;
+	}
+	if (extsort_merge_start(sort, sort->runs + first, EXTSORT_FANIN) < 0)
+	{
+		fclose(fp);
+		return -1;
+	}
+	while ((r = extsort_merge_next(record, sort)) == 1)
+	{
+		if (fwrite(record, sort->record_size, 1, fp) != 1)
+		{
+			error_log("Could not write sort run. Errno %i.", errno);
+			r = -1;
+			break;
+		}
+	}
+	extsort_merge_end(sort, 1);
+	if (r < 0)
+	{
+		fclose(fp);
+		return -1;
+	}
+
+	sort->runs[first] = fp;
+	sort->levels[first] = level;
+	sort->run_count = first + 1;
+
+	return 1;
+}
+
+/*
+ * Rewind the runs and load the first record of each into a min-heap.
+ */
+static int extsort_merge_start(ExtSort sort, FILE **runs, size_t run_count)
+{
+	size_t i;
+	struct ExtSortMerge *m = &sort->merge;
+
+	m->runs = runs;
+	m->run_count = run_count;
+	m->heap_count = 0;
+	m->heads = malloc(sort->record_size * run_count);
+	m->heap = malloc(sizeof(size_t) * run_count);
+	if (m->heads == NULL || m->heap == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	for (i = 0; i < run_count; ++i)
+	{
+		rewind(runs[i]);
+		if (fread(m->heads + i * sort->record_size, sort->record_size, 1, runs[i]) == 1)
+		{
+			m->heap[m->heap_count++] = i;
+		}
+	}
+	for (i = m->heap_count; i > 0; --i)
+	{
+		extsort_sift(sort, i - 1);
+	}
+
+	return 1;
+}
+
+static int extsort_merge_next(void *output, ExtSort sort)
+{
+	size_t run;
+	struct ExtSortMerge *m = &sort->merge;
+
+	if (m->heap_count == 0)
+	{
+		return 0;
+	}
+
+	run = m->heap[0];
+	memcpy(output, m->heads + run * sort->record_size, sort->record_size);
+
+	if (fread(m->heads + run * sort->record_size, sort->record_size, 1, m->runs[run]) != 1)
+	{
+		if (ferror(m->runs[run]))
+		{
+			error_log("Could not read sort run. Errno %i.", errno);
+			return -1;
+		}
+		m->heap[0] = m->heap[--m->heap_count];
+	}
+	extsort_sift(sort, 0);
+
+	return 1;
+}
+
+/*
+ * Free the heap, and close the merged runs if they're done with.
+ */
+static void extsort_merge_end(ExtSort sort, int close_runs)
+{
+	size_t i;
+	struct ExtSortMerge *m = &sort->merge;
+
+	if (close_runs && m->runs != NULL)
+	{
+		for (i = 0; i < m->run_count; ++i)
+		{
+			fclose(m->runs[i]);
+		}
+	}
+
+	free(m->heads);
+	free(m->heap);
+	memset(m, 0, sizeof(*m));
+}
+
+static void extsort_sift(ExtSort sort, size_t i)
+{
+	size_t child, tmp;
+	struct ExtSortMerge *m = &sort->merge;
+
+	for (;;)
+	{
+		child = i * 2 + 1;
+		if (child >= m->heap_count)
+		{
+			break;
+		}
+		if (child + 1 < m->heap_count && sort->cmp(m->heads + m->heap[child + 1] * sort->record_size, m->heads + m->heap[child] * sort->record_size) < 0)
+		{
+			child++;
+		}
+		if (sort->cmp(m->heads + m->heap[i] * sort->record_size, m->heads + m->heap[child] * sort->record_size) <= 0)
+		{
+			break;
+		}
+		tmp = m->heap[i];
+		m->heap[i] = m->heap[child];
+		m->heap[child] = tmp;
+		i = child;
+	}
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef EXTSORT_H
+#define EXTSORT_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EXTSORT_MEMORY_DEFAULT  0x10000000
+#define EXTSORT_FANIN           128
+
+typedef struct ExtSort *ExtSort;
+
+int extsort_new(ExtSort, size_t, int (*)(const void *, const void *), size_t, const char *);
+int extsort_add(ExtSort, const void *);
+int extsort_finish(ExtSort);
+int extsort_next(void *, ExtSort);
+uint64_t extsort_get_count(ExtSort);
+void extsort_clear(ExtSort);
+size_t extsort_sizeof(void);
+
+#endif
@@ -0,0 +1,485 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "field.h"
+
+// 2^256 mod p, as 2^32 + 977.
+#define FIELD_FOLD_LOW  977
+
+static const uint32_t field_p[FIELD_LIMBS] = {
+	0xFFFFFC2F, 0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFF,
+	0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+};
+
+static void field_fold(uint32_t *, uint64_t);
+static void field_sub_p(uint32_t *, uint32_t);
+static void field_reduce(struct FieldElem *, const uint32_t *);
+static void field_pow_chain(struct FieldElem *, struct FieldElem *, struct FieldElem *, const struct FieldElem *);
+static void field_sqr_times(struct FieldElem *, const struct FieldElem *, int);
+
+/*
+ * 32 big endian bytes. A value of p or more is reduced.
+ */
+void field_set_bytes(struct FieldElem *r, const unsigned char *input)
+{
+	int i;
+
+	assert(r);
+	assert(input);
+
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		r->v[i] = ((uint32_t)input[FIELD_LEN - 4 * i - 4] << 24) |
+		          ((uint32_t)input[FIELD_LEN - 4 * i - 3] << 16) |
+		          ((uint32_t)input[FIELD_LEN - 4 * i - 2] << 8) |
+		          (uint32_t)input[FIELD_LEN - 4 * i - 1];
+	}
+	field_fold(r->v, 0);
+}
+
+void field_get_bytes(unsigned char *output, const struct FieldElem *a)
+{
+	int i;
+
+	assert(output);
+	assert(a);
+
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		output[FIELD_LEN - 4 * i - 4] = (unsigned char)(a->v[i] >> 24);
+		output[FIELD_LEN - 4 * i - 3] = (unsigned char)(a->v[i] >> 16);
+		output[FIELD_LEN - 4 * i - 2] = (unsigned char)(a->v[i] >> 8);
+		output[FIELD_LEN - 4 * i - 1] = (unsigned char)a->v[i];
+	}
+}
+
+void field_set_int(struct FieldElem *r, uint32_t a)
+{
+	assert(r);
+
+	memset(r, 0, sizeof(*r));
+	r->v[0] = a;
+}
+
+void field_add(struct FieldElem *r, const struct FieldElem *a, const struct FieldElem *b)
+{
+	int i;
+	uint64_t acc;
+
+	assert(r);
+	assert(a);
+	assert(b);
+
+	acc = 0;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		acc += (uint64_t)a->v[i] + b->v[i];
+		r->v[i] = (uint32_t)acc;
+		acc >>= 32;
+	}
+	field_sub_p(r->v, (uint32_t)acc);
+}
+
+void field_sub(struct FieldElem *r, const struct FieldElem *a, const struct FieldElem *b)
+{
+	int i;
+	uint64_t d, borrow, acc;
+	uint32_t mask;
+
+	assert(r);
+	assert(a);
+	assert(b);
+
+	borrow = 0;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		d = (uint64_t)a->v[i] - b->v[i] - borrow;
+		r->v[i] = (uint32_t)d;
+		borrow = (d >> 63) & 1;
+	}
+
+	// Add p back if it went negative.
+	mask = (uint32_t)0 - (uint32_t)borrow;
+	acc = 0;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		acc += (uint64_t)r->v[i] + (field_p[i] & mask);
+		r->v[i] = (uint32_t)acc;
+		acc >>= 32;
+	}
+}
+
+/*
+ * p - a, which for zero is p and reduces back to zero.
+ */
+void field_neg(struct FieldElem *r, const struct FieldElem *a)
+{
+	int i;
+	uint64_t d, borrow;
+
+	assert(r);
+	assert(a);
+
+	borrow = 0;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		d = (uint64_t)field_p[i] - a->v[i] - borrow;
+		r->v[i] = (uint32_t)d;
+		borrow = (d >> 63) & 1;
+	}
+	field_sub_p(r->v, 0);
+}
+
+void field_mul(struct FieldElem *r, const struct FieldElem *a, const struct FieldElem *b)
+{
+	int i, j;
+	uint64_t acc;
+	uint32_t t[FIELD_LIMBS * 2];
+
+	assert(r);
+	assert(a);
+	assert(b);
+
+	memset(t, 0, sizeof(t));
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		acc = 0;
+		for (j = 0; j < FIELD_LIMBS; ++j)
+		{
+			acc += (uint64_t)a->v[i] * b->v[j] + t[i + j];
+			t[i + j] = (uint32_t)acc;
+			acc >>= 32;
+		}
+		t[i + FIELD_LIMBS] = (uint32_t)acc;
+	}
+	field_reduce(r, t);
+}
+
+/*
+ * Multiply by a small constant, like the curve's 3b = 21.
+ */
+void field_mul_int(struct FieldElem *r, const struct FieldElem *a, uint32_t b)
+{
+	int i;
+	uint64_t acc;
+
+	assert(r);
+	assert(a);
+
+	acc = 0;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		acc += (uint64_t)a->v[i] * b;
+		r->v[i] = (uint32_t)acc;
+		acc >>= 32;
+	}
+	field_fold(r->v, acc);
+}
+
+/*
+ * Each cross product is made once and doubled, 36 multiplications
+ * instead of 64.
+ */
+void field_sqr(struct FieldElem *r, const struct FieldElem *a)
+{
+	int i, j;
+	uint64_t acc;
+	uint32_t t[FIELD_LIMBS * 2];
+
+	assert(r);
+	assert(a);
+
+	memset(t, 0, sizeof(t));
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		acc = 0;
+		for (j = i + 1; j < FIELD_LIMBS; ++j)
+		{
+			acc += (uint64_t)a->v[i] * a->v[j] + t[i + j];
+			t[i + j] = (uint32_t)acc;
+			acc >>= 32;
+		}
+		t[i + FIELD_LIMBS] = (uint32_t)acc;
+	}
+
+	// Double the cross products, then add the squares.
+	for (i = FIELD_LIMBS * 2 - 1; i > 0; --i)
+	{
+		t[i] = (t[i] << 1) | (t[i - 1] >> 31);
+	}
+	t[0] <<= 1;
+	acc = 0;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		acc += (uint64_t)a->v[i] * a->v[i] + t[2 * i];
+		t[2 * i] = (uint32_t)acc;
+		acc >>= 32;
+		acc += t[2 * i + 1];
+		t[2 * i + 1] = (uint32_t)acc;
+		acc >>= 32;
+	}
+	field_reduce(r, t);
+}
+
+/*
+ * a^(p - 2) by a fixed chain of 255 squarings and 15 multiplications,
+ * the same whatever a is. Zero has no inverse and gives zero.
+ */
+void field_inv(struct FieldElem *r, const struct FieldElem *a)
+{
+	struct FieldElem x2, x22, t;
+
+	assert(r);
+	assert(a);
+
+	field_pow_chain(&x2, &x22, &t, a);
+
+	// The low 33 bits of p - 2 are 0xFFFFFC2D with a 0 above them.
+	field_sqr_times(&t, &t, 23);
+	field_mul(&t, &t, &x22);
+	field_sqr_times(&t, &t, 5);
+	field_mul(&t, &t, a);
+	field_sqr_times(&t, &t, 3);
+	field_mul(&t, &t, &x2);
+	field_sqr_times(&t, &t, 2);
+	field_mul(r, &t, a);
+}
+
+/*
+ * The square root a^((p + 1) / 4), which p = 3 mod 4 allows, by the
+ * same kind of chain: 253 squarings and 13 multiplications. Returns 1
+ * if a is a square, or 0 if it isn't and r is meaningless. Of the two
+ * roots, r is whichever the chain lands on; the other is -r.
+ */
+int field_sqrt(struct FieldElem *r, const struct FieldElem *a)
+{
+	int is_square;
+	struct FieldElem x2, x22, t;
+
+	assert(r);
+	assert(a);
+
+	field_pow_chain(&x2, &x22, &t, a);
+
+	// The low 32 bits of (p + 1) / 4 are 0xBFFFFF0C.
+	field_sqr_times(&t, &t, 23);
+	field_mul(&t, &t, &x22);
+	field_sqr_times(&t, &t, 6);
+	field_mul(&t, &t, &x2);
+	field_sqr_times(&t, &t, 2);
+
+	field_sqr(&x2, &t);
+	field_sub(&x2, &x2, a);
+	is_square = field_is_zero(&x2);
+	*r = t;
+
+	return is_square;
+}
+
+/*
+ * The y of the curve point whose x is the 32 big endian bytes in input,
+ * odd or even as odd says. The square root of x^3 + 7 is the on curve
+ * check as well: returns 1, or 0 if x is p or more or no point has it.
+ */
+int field_lift_x(struct FieldElem *y, const unsigned char *input, int odd)
+{
+	unsigned char check[FIELD_LEN];
+	struct FieldElem x, t;
+
+	assert(y);
+	assert(input);
+
+	field_set_bytes(&x, input);
+	field_get_bytes(check, &x);
+	if (memcmp(check, input, FIELD_LEN) != 0)
+	{
+		return 0;
+	}
+
+	field_sqr(&t, &x);
+	field_mul(&t, &t, &x);
+	field_set_int(&x, FIELD_CURVE_B);
+	field_add(&t, &t, &x);
+	if (!field_sqrt(y, &t))
+	{
+		return 0;
+	}
+
+	field_neg(&t, y);
+	field_cmov(y, &t, (uint32_t)(field_is_odd(y) != (odd != 0)));
+
+	return 1;
+}
+
+/*
+ * r = a if flag is 1, unchanged if it is 0, by masking rather than
+ * branching.
+ */
+void field_cmov(struct FieldElem *r, const struct FieldElem *a, uint32_t flag)
+{
+	int i;
+	uint32_t mask;
+
+	assert(r);
+	assert(a);
+	assert(flag <= 1);
+
+	mask = (uint32_t)0 - flag;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		r->v[i] = (r->v[i] & ~mask) | (a->v[i] & mask);
+	}
+}
+
+int field_is_zero(const struct FieldElem *a)
+{
+	int i;
+	uint32_t z;
+
+	assert(a);
+
+	z = 0;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		z |= a->v[i];
+	}
+
+	return (int)(((z | ((uint32_t)0 - z)) >> 31) ^ 1);
+}
+
+int field_is_odd(const struct FieldElem *a)
+{
+	assert(a);
+
+	return (int)(a->v[0] & 1);
+}
+
+/*
+ * Reduce v + top * 2^256 below p, for top up to about 2^34. Folding
+ * twice covers the carry the first fold can make, and one conditional
+ * subtraction is left since what remains is under 2^256 < 2p.
+ */
+static void field_fold(uint32_t *v, uint64_t top)
+{
+	int i, pass;
+	uint64_t acc;
+
+	for (pass = 0; pass < 2; ++pass)
+	{
+		acc = (uint64_t)v[0] + top * FIELD_FOLD_LOW;
+		v[0] = (uint32_t)acc;
+		acc >>= 32;
+		acc += (uint64_t)v[1] + top;
+		v[1] = (uint32_t)acc;
+		acc >>= 32;
+		for (i = 2; i < FIELD_LIMBS; ++i)
+		{
+			acc += v[i];
+			v[i] = (uint32_t)acc;
+			acc >>= 32;
+		}
+		top = acc;
+	}
+
+	field_sub_p(v, 0);
+}
+
+/*
+ * Subtract p from carry * 2^256 + v unless that goes negative, which
+ * brings anything under 2p below p.
+ */
+static void field_sub_p(uint32_t *v, uint32_t carry)
+{
+	int i;
+	uint64_t d, borrow;
+	uint32_t s[FIELD_LIMBS];
+	uint32_t mask;
+
+	borrow = 0;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		d = (uint64_t)v[i] - field_p[i] - borrow;
+		s[i] = (uint32_t)d;
+		borrow = (d >> 63) & 1;
+	}
+
+	mask = (uint32_t)0 - (carry | ((uint32_t)borrow ^ 1));
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		v[i] = (s[i] & mask) | (v[i] & ~mask);
+	}
+}
+
+/*
+ * A 512 bit product lo + hi * 2^256 becomes lo + hi * (2^32 + 977),
+ * under 2^290, and then gets folded the rest of the way.
+ */
+static void field_reduce(struct FieldElem *r, const uint32_t *t)
+{
+	int i;
+	uint64_t acc;
+
+	acc = 0;
+	for (i = 0; i < FIELD_LIMBS; ++i)
+	{
+		acc += (uint64_t)t[i] + (uint64_t)t[FIELD_LIMBS + i] * FIELD_FOLD_LOW;
+		if (i > 0)
+		{
+			acc += t[FIELD_LIMBS + i - 1];
+		}
+		r->v[i] = (uint32_t)acc;
+		acc >>= 32;
+	}
+	field_fold(r->v, acc + t[FIELD_LIMBS * 2 - 1]);
+}
+
+/*
+ * The part of the inversion and square root chains they share: a^3,
+ * a^(2^22 - 1) and a^(2^223 - 1), the exponents being runs of ones.
+ */
+static void field_pow_chain(struct FieldElem *x2, struct FieldElem *x22, struct FieldElem *x223, const struct FieldElem *a)
+{
+	struct FieldElem x3, x6, x9, x11, x44, x88, x176, x220;
+
+	// xN = a^(2^N - 1)
+	field_sqr(x2, a);
+	field_mul(x2, x2, a);
+	field_sqr(&x3, x2);
+	field_mul(&x3, &x3, a);
+	field_sqr_times(&x6, &x3, 3);
+	field_mul(&x6, &x6, &x3);
+	field_sqr_times(&x9, &x6, 3);
+	field_mul(&x9, &x9, &x3);
+	field_sqr_times(&x11, &x9, 2);
+	field_mul(&x11, &x11, x2);
+	field_sqr_times(x22, &x11, 11);
+	field_mul(x22, x22, &x11);
+	field_sqr_times(&x44, x22, 22);
+	field_mul(&x44, &x44, x22);
+	field_sqr_times(&x88, &x44, 44);
+	field_mul(&x88, &x88, &x44);
+	field_sqr_times(&x176, &x88, 88);
+	field_mul(&x176, &x176, &x88);
+	field_sqr_times(&x220, &x176, 44);
+	field_mul(&x220, &x220, &x44);
+	field_sqr_times(x223, &x220, 3);
+	field_mul(x223, x223, &x3);
+}
+
+static void field_sqr_times(struct FieldElem *r, const struct FieldElem *a, int n)
+{
+	int i;
+
+	*r = *a;
+	for (i = 0; i < n; ++i)
+	{
+		field_sqr(r, r);
+	}
+}
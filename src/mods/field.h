@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef FIELD_H
+#define FIELD_H 1
+
+#include <stdint.h>
+
+#define FIELD_LEN      32
+#define FIELD_LIMBS    8
+#define FIELD_CURVE_B  7
+
+/*
+ * An element of secp256k1's base field in fixed 32 bit limbs, least
+ * significant first, always fully reduced. Unlike the GMP field code in
+ * curve.c, every operation takes the same time and touches the same
+ * memory whatever the values, so these are the ones for secrets. A
+ * result may be written over an operand.
+ */
+struct FieldElem
+{
+	uint32_t v[FIELD_LIMBS];
+};
+
+void field_set_bytes(struct FieldElem *, const unsigned char *);
+void field_get_bytes(unsigned char *, const struct FieldElem *);
+void field_set_int(struct FieldElem *, uint32_t);
+void field_add(struct FieldElem *, const struct FieldElem *, const struct FieldElem *);
+void field_sub(struct FieldElem *, const struct FieldElem *, const struct FieldElem *);
+void field_neg(struct FieldElem *, const struct FieldElem *);
+void field_mul(struct FieldElem *, const struct FieldElem *, const struct FieldElem *);
+void field_mul_int(struct FieldElem *, const struct FieldElem *, uint32_t);
+void field_sqr(struct FieldElem *, const struct FieldElem *);
+void field_inv(struct FieldElem *, const struct FieldElem *);
+int field_sqrt(struct FieldElem *, const struct FieldElem *);
+int field_lift_x(struct FieldElem *, const unsigned char *, int);
+void field_cmov(struct FieldElem *, const struct FieldElem *, uint32_t);
+int field_is_zero(const struct FieldElem *);
+int field_is_odd(const struct FieldElem *);
+
+#endif
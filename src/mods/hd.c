@@ -0,0 +1,771 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <gmp.h>
+#include <assert.h>
+#include "hd.h"
+#include "curve.h"
+#include "ctmul.h"
+#include "scalar.h"
+#include "crypto.h"
+#include "pubkey.h"
+#include "base58check.h"
+#include "network.h"
+#include "error.h"
+
+#define HD_VERSION_MAIN_PRIVATE  0x0488ADE4
+#define HD_VERSION_MAIN_PUBLIC   0x0488B21E
+#define HD_VERSION_TEST_PRIVATE  0x04358394
+#define HD_VERSION_TEST_PUBLIC   0x043587CF
+#define HD_SEED_KEY              "Bitcoin seed"
+#define HD_INDEX_LEN             4
+
+static const unsigned char hd_order[HD_KEY_LEN] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
+	0xBA, 0xAE, 0xDC, 0xE6, 0xAF, 0x48, 0xA0, 0x3B, 0xBF, 0xD2, 0x5E, 0x8C, 0xD0, 0x36, 0x41, 0x41
+};
+
+/*
+ * Derives nodes, one context per thread. Two things are kept from call
+ * to call. The last parent's fingerprint, and its point once a public
+ * child has needed it, so every sibling after the first costs one HMAC,
+ * one multiplication of G and one addition. And the nodes along the
+ * last path hd_derive() took, so the next path only derives from where
+ * it parts from that one: m/84'/0'/0'/0/i for i in turn reuses the
+ * account and chain nodes.
+ *
+ * hd_public_children() keeps a batch of points besides, so that a run
+ * of siblings is made affine with one inversion.
+ */
+struct Hd
+{
+	struct Curve curve;
+	CryptoHash hmac;
+	CryptoHash sha256;
+	CryptoHash rmd160;
+	mpz_t tweak;
+	struct CurveJacobian sum;
+	struct CurveAffine point;
+	struct CurveAffine parent_point;
+	struct CurveJacobian batch_sum[HD_BATCH_MAX];
+	struct CurveAffine batch_point[HD_BATCH_MAX];
+	unsigned char parent_pubkey[HD_PUBKEY_LEN];
+	unsigned char parent_fingerprint[HD_FINGERPRINT_LEN];
+	int parent_lifted;
+	struct HdNode root;
+	int has_root;
+	struct HdNode nodes[HD_PATH_MAX];
+	uint32_t path[HD_PATH_MAX];
+	size_t path_len;
+};
+
+static int hd_set_parent(Hd, const struct HdNode *, int);
+static void hd_hmac(Hd, unsigned char *, const unsigned char *, size_t, const unsigned char *, size_t);
+static int hd_secret_pubkey(unsigned char *, const unsigned char *);
+static int hd_is_scalar(const unsigned char *);
+static int hd_same_node(const struct HdNode *, const struct HdNode *);
+static void hd_put_uint32(unsigned char *, uint32_t);
+static uint32_t hd_get_uint32(const unsigned char *);
+
+int hd_new(Hd h)
+{
+	size_t i;
+
+	assert(h);
+
+	memset(h, 0, sizeof(*h));
+
+	if (curve_new(&h->curve) < 0)
+	{
+		return -1;
+	}
+	mpz_init(h->tweak);
+	curve_jacobian_init(&h->sum);
+	curve_affine_init(&h->point);
+	curve_affine_init(&h->parent_point);
+	for (i = 0; i < HD_BATCH_MAX; ++i)
+	{
+		curve_jacobian_init(&h->batch_sum[i]);
+		curve_affine_init(&h->batch_point[i]);
+	}
+
+	h->hmac = malloc(crypto_hash_sizeof());
+	h->sha256 = malloc(crypto_hash_sizeof());
+	h->rmd160 = malloc(crypto_hash_sizeof());
+	if (h->hmac == NULL || h->sha256 == NULL || h->rmd160 == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	if (crypto_hmac_open(h->hmac, CRYPTO_SHA512) < 0)
+	{
+		free(h->hmac);
+		h->hmac = NULL;
+		return -1;
+	}
+	if (crypto_hash_open(h->sha256, CRYPTO_SHA256) < 0)
+	{
+		free(h->sha256);
+		h->sha256 = NULL;
+		return -1;
+	}
+	if (crypto_hash_open(h->rmd160, CRYPTO_RMD160) < 0)
+	{
+		free(h->rmd160);
+		h->rmd160 = NULL;
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * The master node of a seed of 16 to 64 bytes.
+ */
+int hd_from_seed(Hd h, struct HdNode *node, const unsigned char *seed, size_t len)
+{
+	unsigned char digest[CRYPTO_SHA512_LEN];
+
+	assert(h);
+	assert(node);
+	assert(seed);
+
+	if (len < HD_SEED_LEN_MIN || len > HD_SEED_LEN_MAX)
+	{
+		error_log("Seed must be between %i and %i bytes, not %zu.", HD_SEED_LEN_MIN, HD_SEED_LEN_MAX, len);
+		return -1;
+	}
+
+	hd_hmac(h, digest, (const unsigned char *)HD_SEED_KEY, strlen(HD_SEED_KEY), seed, len);
+
+	memset(node, 0, sizeof(*node));
+	memcpy(node->secret, digest, HD_KEY_LEN);
+	memcpy(node->chain, digest + HD_KEY_LEN, HD_CHAIN_LEN);
+	node->is_private = 1;
+	memset(digest, 0, sizeof(digest));
+
+	if (!hd_is_scalar(node->secret) || hd_secret_pubkey(node->pubkey, node->secret) < 0)
+	{
+		memset(node, 0, sizeof(*node));
+		error_log("Seed makes an invalid master key.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * An xprv, xpub, tprv or tpub. As with a WIF key, the version sets the
+ * network.
+ */
+int hd_from_string(struct HdNode *node, const char *str)
+{
+	int len;
+	uint32_t version;
+	unsigned char data[HD_STRING_LEN * 2];
+	char copy[HD_STRING_LEN];
+	PubKey key;
+
+	assert(node);
+	assert(str);
+
+	if (strlen(str) >= HD_STRING_LEN)
+	{
+		error_log("Extended key is too long.");
+		return -1;
+	}
+	strcpy(copy, str);
+
+	len = base58check_decode(data, copy);
+	if (len < 0)
+	{
+		error_log("Could not decode extended key.");
+		return -1;
+	}
+	if (len != HD_SERIALIZED_LEN)
+	{
+		error_log("Extended key decodes to %i bytes, not %i.", len, HD_SERIALIZED_LEN);
+		return -1;
+	}
+
+	memset(node, 0, sizeof(*node));
+
+	version = hd_get_uint32(data);
+	switch (version)
+	{
+		case HD_VERSION_MAIN_PRIVATE:
+		case HD_VERSION_MAIN_PUBLIC:
+			network_set_main();
+			break;
+		case HD_VERSION_TEST_PRIVATE:
+		case HD_VERSION_TEST_PUBLIC:
+			network_set_test();
+			break;
+		default:
+			error_log("Extended key has an unknown version (%08x).", version);
+			return -1;
+	}
+	node->is_private = (version == HD_VERSION_MAIN_PRIVATE || version == HD_VERSION_TEST_PRIVATE);
+
+	node->depth = data[4];
+	memcpy(node->parent, data + 5, HD_FINGERPRINT_LEN);
+	node->child = hd_get_uint32(data + 9);
+	memcpy(node->chain, data + 13, HD_CHAIN_LEN);
+
+	if (node->depth == 0 && (hd_get_uint32(node->parent) != 0 || node->child != 0))
+	{
+		error_log("Extended key at depth zero has a parent.");
+		return -1;
+	}
+
+	if (node->is_private)
+	{
+		if (data[45] != 0x00)
+		{
+			error_log("Extended private key does not start with a zero byte.");
+			return -1;
+		}
+		memcpy(node->secret, data + 46, HD_KEY_LEN);
+		memset(data, 0, sizeof(data));
+		if (!hd_is_scalar(node->secret) || hd_secret_pubkey(node->pubkey, node->secret) < 0)
+		{
+			memset(node, 0, sizeof(*node));
+			error_log("Extended private key is out of range.");
+			return -1;
+		}
+		return 1;
+	}
+
+	if (data[45] != 0x02 && data[45] != 0x03)
+	{
+		error_log("Extended public key is not a compressed public key.");
+		return -1;
+	}
+
+	key = malloc(pubkey_sizeof());
+	if (key == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	if (pubkey_from_raw(key, data + 45, HD_PUBKEY_LEN) < 0)
+	{
+		free(key);
+		error_log("Extended public key is not on the curve.");
+		return -1;
+	}
+	free(key);
+
+	memcpy(node->pubkey, data + 45, HD_PUBKEY_LEN);
+
+	return 1;
+}
+
+/*
+ * Serialize as an xprv if the node is private, or an xpub, or tprv and
+ * tpub on testnet. str needs HD_STRING_LEN bytes.
+ */
+int hd_to_string(char *str, const struct HdNode *node)
+{
+	int r;
+	unsigned char data[HD_SERIALIZED_LEN];
+
+	assert(str);
+	assert(node);
+
+	if (network_is_test())
+	{
+		hd_put_uint32(data, node->is_private ? HD_VERSION_TEST_PRIVATE : HD_VERSION_TEST_PUBLIC);
+	}
+	else
+	{
+		hd_put_uint32(data, node->is_private ? HD_VERSION_MAIN_PRIVATE : HD_VERSION_MAIN_PUBLIC);
+	}
+	data[4] = (unsigned char)node->depth;
+	memcpy(data + 5, node->parent, HD_FINGERPRINT_LEN);
+	hd_put_uint32(data + 9, node->child);
+	memcpy(data + 13, node->chain, HD_CHAIN_LEN);
+	if (node->is_private)
+	{
+		data[45] = 0x00;
+		memcpy(data + 46, node->secret, HD_KEY_LEN);
+	}
+	else
+	{
+		memcpy(data + 45, node->pubkey, HD_PUBKEY_LEN);
+	}
+
+	r = base58check_encode(str, data, HD_SERIALIZED_LEN);
+	memset(data, 0, sizeof(data));
+	if (r < 0)
+	{
+		error_log("Could not encode extended key.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Drop the secret, leaving the node as its xpub would parse.
+ */
+void hd_neuter(struct HdNode *node)
+{
+	assert(node);
+
+	memset(node->secret, 0, HD_KEY_LEN);
+	node->is_private = 0;
+}
+
+/*
+ * A path such as m/84'/0'/0'/0, with ' or h marking hardened indexes.
+ * The leading m is optional and "m" alone is the empty path. path needs
+ * room for HD_PATH_MAX indexes.
+ */
+int hd_parse_path(uint32_t *path, size_t *len, const char *str)
+{
+	uint64_t index;
+	const char *p;
+
+	assert(path);
+	assert(len);
+	assert(str);
+
+	*len = 0;
+	p = str;
+
+	if (*p == 'm' || *p == 'M')
+	{
+		p++;
+		if (*p == '\0')
+		{
+			return 1;
+		}
+		if (*p++ != '/')
+		{
+			error_log("Invalid derivation path '%s'.", str);
+			return -1;
+		}
+	}
+
+	while (1)
+	{
+		if (!isdigit((unsigned char)*p))
+		{
+			error_log("Invalid derivation path '%s'.", str);
+			return -1;
+		}
+		index = 0;
+		while (isdigit((unsigned char)*p))
+		{
+			index = index * 10 + (uint64_t)(*p++ - '0');
+			if (index >= HD_HARDENED)
+			{
+				error_log("Derivation path index is too large in '%s'.", str);
+				return -1;
+			}
+		}
+		if (*p == '\'' || *p == 'h' || *p == 'H')
+		{
+			index |= HD_HARDENED;
+			p++;
+		}
+
+		if (*len == HD_PATH_MAX)
+		{
+			error_log("Derivation path is deeper than %i.", HD_PATH_MAX);
+			return -1;
+		}
+		path[(*len)++] = (uint32_t)index;
+
+		if (*p == '\0')
+		{
+			return 1;
+		}
+		if (*p++ != '/')
+		{
+			error_log("Invalid derivation path '%s'.", str);
+			return -1;
+		}
+	}
+}
+
+/*
+ * CKDpriv for a private parent and CKDpub for a public one, the child
+ * being private or public as the parent is. A hardened index needs a
+ * private parent. The rare index whose key is invalid returns -1, and
+ * BIP32 has callers move on to the next one. child must not be parent.
+ */
+int hd_ckd(Hd h, struct HdNode *child, const struct HdNode *parent, uint32_t index)
+{
+	int r, invalid;
+	unsigned char data[HD_PUBKEY_LEN + HD_INDEX_LEN];
+	unsigned char digest[CRYPTO_SHA512_LEN];
+	struct Scalar tweak, key;
+
+	assert(h);
+	assert(child);
+	assert(parent);
+	assert(child != parent);
+
+	if (parent->depth >= HD_DEPTH_MAX)
+	{
+		error_log("Extended key is already at the greatest depth.");
+		return -1;
+	}
+
+	if (index & HD_HARDENED)
+	{
+		if (!parent->is_private)
+		{
+			error_log("Cannot derive hardened child %u' from a public key.", index & ~HD_HARDENED);
+			return -1;
+		}
+		data[0] = 0x00;
+		memcpy(data + 1, parent->secret, HD_KEY_LEN);
+	}
+	else
+	{
+		memcpy(data, parent->pubkey, HD_PUBKEY_LEN);
+	}
+	hd_put_uint32(data + HD_PUBKEY_LEN, index);
+
+	if (hd_set_parent(h, parent, !parent->is_private) < 0)
+	{
+		return -1;
+	}
+
+	hd_hmac(h, digest, parent->chain, HD_CHAIN_LEN, data, sizeof(data));
+	memset(data, 0, sizeof(data));
+
+	r = 1;
+	if (parent->is_private)
+	{
+		// k = IL + k_parent mod n, IL < n checked on the way in, all by
+		// scalar.c, and its point the constant time way.
+		invalid = scalar_set_bytes(&tweak, digest);
+		scalar_set_bytes(&key, parent->secret);
+		scalar_add(&key, &key, &tweak);
+		invalid |= scalar_is_zero(&key);
+		scalar_get_bytes(child->secret, &key);
+		memset(&tweak, 0, sizeof(tweak));
+		memset(&key, 0, sizeof(key));
+		if (invalid || hd_secret_pubkey(child->pubkey, child->secret) < 0)
+		{
+			r = -1;
+		}
+	}
+	else if (memcmp(digest, hd_order, HD_KEY_LEN) >= 0)
+	{
+		r = -1;
+	}
+	else
+	{
+		// K = IL * G + K_parent, all public.
+		curve_mul_generator(&h->curve, &h->sum, digest);
+		curve_add_affine(&h->curve, &h->sum, &h->parent_point);
+		if (h->sum.infinity)
+		{
+			r = -1;
+		}
+		else
+		{
+			curve_to_affine(&h->curve, &h->point, &h->sum);
+			memset(child->secret, 0, HD_KEY_LEN);
+			child->pubkey[0] = mpz_odd_p(h->point.y) ? 0x03 : 0x02;
+			curve_export_scalar(child->pubkey + 1, h->point.x);
+		}
+	}
+
+	if (r < 0)
+	{
+		memset(digest, 0, sizeof(digest));
+		memset(child, 0, sizeof(*child));
+		error_log("Child %u makes an invalid key. Use the next index.", index & ~HD_HARDENED);
+		return -1;
+	}
+
+	memcpy(child->chain, digest + HD_KEY_LEN, HD_CHAIN_LEN);
+	memcpy(child->parent, h->parent_fingerprint, HD_FINGERPRINT_LEN);
+	child->child = index;
+	child->depth = parent->depth + 1;
+	child->is_private = parent->is_private;
+	memset(digest, 0, sizeof(digest));
+
+	return 1;
+}
+
+/*
+ * The node at path below root, starting from the deepest node already
+ * derived along the same path from the same root.
+ */
+int hd_derive(Hd h, struct HdNode *node, const struct HdNode *root, const uint32_t *path, size_t len)
+{
+	size_t i;
+
+	assert(h);
+	assert(node);
+	assert(root);
+	assert(path || len == 0);
+
+	if (len > HD_PATH_MAX)
+	{
+		error_log("Derivation path is deeper than %i.", HD_PATH_MAX);
+		return -1;
+	}
+
+	if (!h->has_root || !hd_same_node(&h->root, root))
+	{
+		h->root = *root;
+		h->has_root = 1;
+		h->path_len = 0;
+	}
+
+	for (i = 0; i < len && i < h->path_len && path[i] == h->path[i]; ++i)
+		;
+
+	for (; i < len; ++i)
+	{
+		if (hd_ckd(h, &h->nodes[i], (i == 0) ? &h->root : &h->nodes[i - 1], path[i]) < 0)
+		{
+			h->path_len = i;
+			return -1;
+		}
+		h->path[i] = path[i];
+	}
+	h->path_len = len;
+
+	*node = (len == 0) ? h->root : h->nodes[len - 1];
+
+	return 1;
+}
+
+/*
+ * Just the compressed public keys of count non-hardened children of
+ * parent, from first on, which is all an address needs. The parent's
+ * chain code is keyed into the HMAC once for the run, each child's
+ * point is made projective from the parent's lifted point, and the
+ * batch is made affine together. count is at most HD_BATCH_MAX.
+ */
+int hd_public_children(Hd h, unsigned char (*pubkeys)[HD_PUBKEY_LEN], const struct HdNode *parent, uint32_t first, size_t count)
+{
+	size_t i;
+	unsigned char data[HD_PUBKEY_LEN + HD_INDEX_LEN];
+	unsigned char digest[CRYPTO_SHA512_LEN];
+
+	assert(h);
+	assert(pubkeys);
+	assert(parent);
+	assert(count <= HD_BATCH_MAX);
+
+	if ((uint64_t)first + count > HD_HARDENED)
+	{
+		error_log("Cannot derive hardened children by their public keys.");
+		return -1;
+	}
+	if (parent->depth >= HD_DEPTH_MAX)
+	{
+		error_log("Extended key is already at the greatest depth.");
+		return -1;
+	}
+	if (hd_set_parent(h, parent, 1) < 0)
+	{
+		return -1;
+	}
+
+	memcpy(data, parent->pubkey, HD_PUBKEY_LEN);
+	if (crypto_hash_set_key(h->hmac, parent->chain, HD_CHAIN_LEN) < 0)
+	{
+		return -1;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		hd_put_uint32(data + HD_PUBKEY_LEN, first + (uint32_t)i);
+		crypto_hash_write(h->hmac, data, sizeof(data));
+		crypto_hash_final(digest, h->hmac);
+
+		if (memcmp(digest, hd_order, HD_KEY_LEN) >= 0)
+		{
+			error_log("Child %u makes an invalid key. Use the next index.", first + (uint32_t)i);
+			return -1;
+		}
+
+		curve_mul_generator(&h->curve, &h->batch_sum[i], digest);
+		curve_add_affine(&h->curve, &h->batch_sum[i], &h->parent_point);
+		if (h->batch_sum[i].infinity)
+		{
+			error_log("Child %u makes an invalid key. Use the next index.", first + (uint32_t)i);
+			return -1;
+		}
+	}
+
+	curve_to_affine_batch(&h->curve, h->batch_point, h->batch_sum, count);
+
+	for (i = 0; i < count; ++i)
+	{
+		pubkeys[i][0] = mpz_odd_p(h->batch_point[i].y) ? 0x03 : 0x02;
+		curve_export_scalar(pubkeys[i] + 1, h->batch_point[i].x);
+	}
+
+	return 1;
+}
+
+/*
+ * RMD160(SHA256(pubkey)) of a compressed key, on hash handles kept open
+ * in the context rather than opened for every key.
+ */
+void hd_hash160(Hd h, unsigned char *output, const unsigned char *pubkey)
+{
+	unsigned char digest[CRYPTO_SHA256_LEN];
+
+	assert(h);
+	assert(output);
+	assert(pubkey);
+
+	crypto_hash_write(h->sha256, pubkey, HD_PUBKEY_LEN);
+	crypto_hash_final(digest, h->sha256);
+	crypto_hash_write(h->rmd160, digest, CRYPTO_SHA256_LEN);
+	crypto_hash_final(output, h->rmd160);
+}
+
+void hd_clear(Hd h)
+{
+	size_t i;
+
+	assert(h);
+
+	curve_clear(&h->curve);
+	mpz_clear(h->tweak);
+	curve_jacobian_clear(&h->sum);
+	curve_affine_clear(&h->point);
+	curve_affine_clear(&h->parent_point);
+	for (i = 0; i < HD_BATCH_MAX; ++i)
+	{
+		curve_jacobian_clear(&h->batch_sum[i]);
+		curve_affine_clear(&h->batch_point[i]);
+	}
+	if (h->hmac != NULL)
+	{
+		crypto_hash_close(h->hmac);
+		free(h->hmac);
+	}
+	if (h->sha256 != NULL)
+	{
+		crypto_hash_close(h->sha256);
+		free(h->sha256);
+	}
+	if (h->rmd160 != NULL)
+	{
+		crypto_hash_close(h->rmd160);
+		free(h->rmd160);
+	}
+
+	memset(h, 0, sizeof(*h));
+}
+
+size_t hd_sizeof(void)
+{
+	return sizeof(struct Hd);
+}
+
+/*
+ * Make parent the one whose fingerprint children get, and lift its
+ * point if a public child needs it. Both are kept until the parent
+ * changes.
+ */
+static int hd_set_parent(Hd h, const struct HdNode *parent, int need_point)
+{
+	unsigned char digest[HD_HASH160_LEN];
+
+	if (memcmp(h->parent_pubkey, parent->pubkey, HD_PUBKEY_LEN) != 0)
+	{
+		hd_hash160(h, digest, parent->pubkey);
+		memcpy(h->parent_fingerprint, digest, HD_FINGERPRINT_LEN);
+		memcpy(h->parent_pubkey, parent->pubkey, HD_PUBKEY_LEN);
+		h->parent_lifted = 0;
+	}
+
+	if (need_point && !h->parent_lifted)
+	{
+		mpz_import(h->tweak, HD_KEY_LEN, 1, 1, 1, 0, parent->pubkey + 1);
+		if (!curve_lift_x(&h->curve, &h->parent_point, h->tweak, parent->pubkey[0] & 1))
+		{
+			error_log("Extended public key is not on the curve.");
+			return -1;
+		}
+		h->parent_lifted = 1;
+	}
+
+	return 1;
+}
+
+static void hd_hmac(Hd h, unsigned char *output, const unsigned char *key, size_t key_len, const unsigned char *data, size_t data_len)
+{
+	crypto_hash_set_key(h->hmac, key, key_len);
+	crypto_hash_write(h->hmac, data, data_len);
+	crypto_hash_final(output, h->hmac);
+}
+
+/*
+ * The compressed public key of a secret in range.
+ */
+static int hd_secret_pubkey(unsigned char *pubkey, const unsigned char *secret)
+{
+	unsigned char y[HD_KEY_LEN];
+
+	if (ctmul_generator(pubkey + 1, y, secret) < 0)
+	{
+		return -1;
+	}
+	pubkey[0] = (y[HD_KEY_LEN - 1] & 1) ? 0x03 : 0x02;
+
+	return 1;
+}
+
+/*
+ * Whether 32 big endian bytes are between 1 and n - 1.
+ */
+static int hd_is_scalar(const unsigned char *k)
+{
+	int invalid;
+	struct Scalar s;
+
+	invalid = scalar_set_bytes(&s, k) | scalar_is_zero(&s);
+	memset(&s, 0, sizeof(s));
+
+	return !invalid;
+}
+
+/*
+ * Whether two nodes are the same key with the same chain code, wherever
+ * they sit.
+ */
+static int hd_same_node(const struct HdNode *a, const struct HdNode *b)
+{
+	return a->is_private == b->is_private && a->depth == b->depth &&
+	       memcmp(a->pubkey, b->pubkey, HD_PUBKEY_LEN) == 0 &&
+	       memcmp(a->chain, b->chain, HD_CHAIN_LEN) == 0 &&
+	       memcmp(a->secret, b->secret, HD_KEY_LEN) == 0;
+}
+
+static void hd_put_uint32(unsigned char *output, uint32_t n)
+{
+	output[0] = (unsigned char)(n >> 24);
+	output[1] = (unsigned char)(n >> 16);
+	output[2] = (unsigned char)(n >> 8);
+	output[3] = (unsigned char)n;
+}
+
+static uint32_t hd_get_uint32(const unsigned char *input)
+{
+	return ((uint32_t)input[0] << 24) | ((uint32_t)input[1] << 16) | ((uint32_t)input[2] << 8) | (uint32_t)input[3];
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef HD_H
+#define HD_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HD_KEY_LEN          32
+#define HD_PUBKEY_LEN       33
+#define HD_CHAIN_LEN        32
+#define HD_FINGERPRINT_LEN  4
+#define HD_HASH160_LEN      20
+#define HD_SERIALIZED_LEN   78
+#define HD_STRING_LEN       112
+#define HD_HARDENED         0x80000000
+#define HD_DEPTH_MAX        255
+#define HD_PATH_MAX         32
+#define HD_SEED_LEN_MIN     16
+#define HD_SEED_LEN_MAX     64
+#define HD_BATCH_MAX        256
+
+/*
+ * A BIP32 node: a key, its chain code and where it sits in the tree. The
+ * public key is always there, compressed. A public node's secret is all
+ * zero.
+ */
+struct HdNode
+{
+	unsigned char secret[HD_KEY_LEN];
+	unsigned char pubkey[HD_PUBKEY_LEN];
+	unsigned char chain[HD_CHAIN_LEN];
+	unsigned char parent[HD_FINGERPRINT_LEN];
+	uint32_t child;
+	int depth;
+	int is_private;
+};
+
+typedef struct Hd *Hd;
+
+int hd_new(Hd);
+int hd_from_seed(Hd, struct HdNode *, const unsigned char *, size_t);
+int hd_from_string(struct HdNode *, const char *);
+int hd_to_string(char *, const struct HdNode *);
+void hd_neuter(struct HdNode *);
+int hd_parse_path(uint32_t *, size_t *, const char *);
+int hd_ckd(Hd, struct HdNode *, const struct HdNode *, uint32_t);
+int hd_derive(Hd, struct HdNode *, const struct HdNode *, const uint32_t *, size_t);
+int hd_public_children(Hd, unsigned char (*)[HD_PUBKEY_LEN], const struct HdNode *, uint32_t, size_t);
+void hd_hash160(Hd, unsigned char *, const unsigned char *);
+void hd_clear(Hd);
+size_t hd_sizeof(void);
+
+#endif
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "hdderive.h"
+#include "hd.h"
+#include "schnorr.h"
+#include "base58check.h"
+#include "bech32.h"
+#include "network.h"
+#include "threadpool.h"
+#include "hex.h"
+#include "error.h"
+
+#define HDDERIVE_VERSION_MAINNET  0x00
+#define HDDERIVE_VERSION_TESTNET  0x6F
+
+/*
+ * A run of consecutive children, derived by one worker, either as nodes
+ * or as lines of output.
+ */
+struct HdDeriveJob
+{
+	HdDerive derive;
+	struct HdNode *children;
+	char (*lines)[HDDERIVE_LINE_LEN];
+	int format;
+	const struct HdNode *parent;
+	uint32_t first;
+	size_t count;
+	int failed;
+	uint32_t failed_index;
+};
+
+/*
+ * Derives runs of sibling nodes on a pool of threads, each with its own
+ * HD context. A context keeps the parent it last saw, so each worker
+ * fingerprints the parent and lifts its point once and every child after
+ * that is one HMAC and one multiplication of G. Taproot tweaking takes a
+ * Schnorr context per thread too, made the first time it's needed.
+ */
+struct HdDerive
+{
+	ThreadPool pool;
+	int threads;
+	Hd hd[THREADPOOL_THREADS_MAX];
+	Schnorr schnorr[THREADPOOL_THREADS_MAX];
+	struct HdDeriveJob *jobs;
+	size_t job_cap;
+};
+
+static int hdderive_run(HdDerive, struct HdNode *, char (*)[HDDERIVE_LINE_LEN], int, const struct HdNode *, uint32_t, size_t);
+static void hdderive_worker(void *, int);
+static void hdderive_public_worker(void *, int);
+static int hdderive_format(HdDerive, int, char *, const unsigned char *, int);
+
+int hdderive_new(HdDerive d, int threads)
+{
+	int i;
+
+	assert(d);
+
+	memset(d, 0, sizeof(*d));
+
+	if (threads < 1 || threads > THREADPOOL_THREADS_MAX)
+	{
+		error_log("Thread count must be between 1 and %i.", THREADPOOL_THREADS_MAX);
+		return -1;
+	}
+
+	d->threads = threads;
+
+	for (i = 0; i < threads; ++i)
+	{
+		d->hd[i] = malloc(hd_sizeof());
+		if (d->hd[i] == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		if (hd_new(d->hd[i]) < 0)
+		{
+			error_log("Could not create HD context.");
+			return -1;
+		}
+	}
+
+	d->pool = malloc(threadpool_sizeof());
+	if (d->pool == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	if (threadpool_new(d->pool, threads, (size_t)threads * 16) < 0)
+	{
+		error_log("Could not start derivation threads.");
+		free(d->pool);
+		d->pool = NULL;
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Children first to first + count - 1 of parent into children, in
+ * order. Fails if any of them can't be derived, naming the first that
+ * couldn't.
+ */
+int hdderive_children(HdDerive d, struct HdNode *children, const struct HdNode *parent, uint32_t first, size_t count)
+{
+	assert(d);
+	assert(children);
+	assert(parent);
+
+	return hdderive_run(d, children, NULL, 0, parent, first, count);
+}
+
+/*
+ * The same children as lines of output, each an address or public key
+ * in the given format ending in a newline, without making whole nodes:
+ * each worker takes its run of children through hd_public_children()
+ * and hashes them on its own context's open hash handles. None of the
+ * children can be hardened.
+ */
+int hdderive_public(HdDerive d, char (*lines)[HDDERIVE_LINE_LEN], const struct HdNode *parent, uint32_t first, size_t count, int format)
+{
+	assert(d);
+	assert(lines);
+	assert(parent);
+	assert(format >= HDDERIVE_ADDRESS && format <= HDDERIVE_HEX);
+
+	if ((uint64_t)first + count > HD_HARDENED)
+	{
+		error_log("Cannot derive hardened children by their public keys.");
+		return -1;
+	}
+
+	return hdderive_run(d, NULL, lines, format, parent, first, count);
+}
+
+void hdderive_clear(HdDerive d)
+{
+	int i;
+
+	assert(d);
+
+	if (d->pool != NULL)
+	{
+		threadpool_clear(d->pool);
+		free(d->pool);
+	}
+	for (i = 0; i < d->threads; ++i)
+	{
+		if (d->hd[i] != NULL)
+		{
+			hd_clear(d->hd[i]);
+			free(d->hd[i]);
+		}
+		if (d->schnorr[i] != NULL)
+		{
+			schnorr_clear(d->schnorr[i]);
+			free(d->schnorr[i]);
+		}
+	}
+	free(d->jobs);
+
+	memset(d, 0, sizeof(*d));
+}
+
+size_t hdderive_sizeof(void)
+{
+	return sizeof(struct HdDerive);
+}
+
+/*
+ * Split the children into jobs, run them and wait for them all.
+ */
+static int hdderive_run(HdDerive d, struct HdNode *children, char (*lines)[HDDERIVE_LINE_LEN], int format, const struct HdNode *parent, uint32_t first, size_t count)
+{
+	size_t i, job_count;
+	struct HdDeriveJob *job, *grown;
+
+	if (count == 0)
+	{
+		return 1;
+	}
+	if ((uint64_t)first + count - 1 > UINT32_MAX)
+	{
+		error_log("Child indexes run past %u.", UINT32_MAX);
+		return -1;
+	}
+
+	job_count = (count + HDDERIVE_JOB_CHILDREN - 1) / HDDERIVE_JOB_CHILDREN;
+	if (job_count > d->job_cap)
+	{
+		grown = realloc(d->jobs, job_count * sizeof(*d->jobs));
+		if (grown == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		d->jobs = grown;
+		d->job_cap = job_count;
+	}
+
+	for (i = 0; i < job_count; ++i)
+	{
+		job = &d->jobs[i];
+		job->derive = d;
+		job->children = (children != NULL) ? children + i * HDDERIVE_JOB_CHILDREN : NULL;
+		job->lines = (lines != NULL) ? lines + i * HDDERIVE_JOB_CHILDREN : NULL;
+		job->format = format;
+		job->parent = parent;
+		job->first = first + (uint32_t)(i * HDDERIVE_JOB_CHILDREN);
+		job->count = (count - i * HDDERIVE_JOB_CHILDREN < HDDERIVE_JOB_CHILDREN) ? count - i * HDDERIVE_JOB_CHILDREN : HDDERIVE_JOB_CHILDREN;
+		job->failed = 0;
+
+		if (threadpool_add(d->pool, (lines != NULL) ? hdderive_public_worker : hdderive_worker, job) < 0)
+		{
+			threadpool_wait(d->pool);
+			return -1;
+		}
+	}
+
+	threadpool_wait(d->pool);
+
+	for (i = 0; i < job_count; ++i)
+	{
+		if (d->jobs[i].failed)
+		{
+			error_log("Could not derive child %u.", d->jobs[i].failed_index & ~HD_HARDENED);
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Runs on a worker thread, so it only touches its job's children and
+ * this thread's context. Errors are logged on the thread that asked.
+ */
+static void hdderive_worker(void *arg, int thread)
+{
+	size_t i;
+	struct HdDeriveJob *job = arg;
+	Hd hd = job->derive->hd[thread];
+
+	for (i = 0; i < job->count; ++i)
+	{
+		if (hd_ckd(hd, &job->children[i], job->parent, job->first + (uint32_t)i) < 0)
+		{
+			error_clear();
+			job->failed = 1;
+			job->failed_index = job->first + (uint32_t)i;
+			break;
+		}
+	}
+}
+
+static void hdderive_public_worker(void *arg, int thread)
+{
+	size_t i;
+	unsigned char pubkeys[HDDERIVE_JOB_CHILDREN][HD_PUBKEY_LEN];
+	struct HdDeriveJob *job = arg;
+
+	if (hd_public_children(job->derive->hd[thread], pubkeys, job->parent, job->first, job->count) < 0)
+	{
+		error_clear();
+		job->failed = 1;
+		job->failed_index = job->first;
+		return;
+	}
+
+	for (i = 0; i < job->count; ++i)
+	{
+		if (hdderive_format(job->derive, thread, job->lines[i], pubkeys[i], job->format) < 0)
+		{
+			error_clear();
+			job->failed = 1;
+			job->failed_index = job->first + (uint32_t)i;
+			return;
+		}
+	}
+}
+
+/*
+ * One line of output for a compressed public key.
+ */
+static int hdderive_format(HdDerive d, int thread, char *line, const unsigned char *pubkey, int format)
+{
+	size_t len;
+	unsigned char program[HD_HASH160_LEN + 1];
+	unsigned char output_key[SCHNORR_PUBKEY_LEN];
+
+	switch (format)
+	{
+		case HDDERIVE_ADDRESS:
+			program[0] = network_is_test() ? HDDERIVE_VERSION_TESTNET : HDDERIVE_VERSION_MAINNET;
+			hd_hash160(d->hd[thread], program + 1, pubkey);
+			if (base58check_encode(line, program, HD_HASH160_LEN + 1) < 0)
+			{
+				return -1;
+			}
+			break;
+		case HDDERIVE_BECH32:
+			hd_hash160(d->hd[thread], program, pubkey);
+			if (bech32_get_address(line, 0, program, HD_HASH160_LEN) < 0)
+			{
+				return -1;
+			}
+			break;
+		case HDDERIVE_TAPROOT:
+			if (d->schnorr[thread] == NULL)
+			{
+				d->schnorr[thread] = malloc(schnorr_sizeof());
+				if (d->schnorr[thread] == NULL || schnorr_new(d->schnorr[thread]) < 0)
+				{
+					free(d->schnorr[thread]);
+					d->schnorr[thread] = NULL;
+					return -1;
+				}
+			}
+			if (schnorr_taproot_output(d->schnorr[thread], output_key, NULL, pubkey + 1, NULL) <= 0)
+			{
+				return -1;
+			}
+			if (bech32_get_address(line, 1, output_key, SCHNORR_PUBKEY_LEN) < 0)
+			{
+				return -1;
+			}
+			break;
+		default:
+			hex_raw_to_str(line, pubkey, HD_PUBKEY_LEN);
+			break;
+	}
+
+	len = strlen(line);
+	line[len] = '\n';
+	line[len + 1] = '\0';
+
+	return 1;
+}
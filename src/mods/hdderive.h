@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef HDDERIVE_H
+#define HDDERIVE_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hd.h"
+
+#define HDDERIVE_JOB_CHILDREN  HD_BATCH_MAX
+#define HDDERIVE_LINE_LEN      100
+#define HDDERIVE_ADDRESS       1
+#define HDDERIVE_BECH32        2
+#define HDDERIVE_TAPROOT       3
+#define HDDERIVE_HEX           4
+
+typedef struct HdDerive *HdDerive;
+
+int hdderive_new(HdDerive, int);
+int hdderive_children(HdDerive, struct HdNode *, const struct HdNode *, uint32_t, size_t);
+int hdderive_public(HdDerive, char (*)[HDDERIVE_LINE_LEN], const struct HdNode *, uint32_t, size_t, int);
+void hdderive_clear(HdDerive);
+size_t hdderive_sizeof(void);
+
+#endif
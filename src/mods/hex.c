@@ -13,6 +13,8 @@
 #include "hex.h"
 #include "error.h"
 
+static void hex_encode(char *, const unsigned char *, size_t, int);
+
 int hex_to_dec(char l, char r)
 {
 	int decimal;
@@ -74,3 +76,41 @@ int hex_ischar(char c)
 	return (c >= 'A' && c <= 'F') || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
 }
 
+/*
+ * Write input_len bytes as lower case hex. Output needs room for
+ * input_len * 2 characters and a terminator.
+ */
+void hex_raw_to_str(char *output, const unsigned char *input, size_t input_len)
+{
+	assert(output);
+	assert(input || input_len == 0);
+
+	hex_encode(output, input, input_len, 0);
+}
+
+/*
+ * The same for a hash, which is kept in internal byte order and displayed
+ * reversed.
+ */
+void hex_hash_to_str(char *output, const unsigned char *input, size_t input_len)
+{
+	assert(output);
+	assert(input || input_len == 0);
+
+	hex_encode(output, input, input_len, 1);
+}
+
+static void hex_encode(char *output, const unsigned char *input, size_t input_len, int reverse)
+{
+	size_t i;
+	unsigned char c;
+	static const char digits[] = "0123456789abcdef";
+
+	for (i = 0; i < input_len; ++i)
+	{
+		c = input[reverse ? input_len - 1 - i : i];
+		output[i * 2] = digits[c >> 4];
+		output[i * 2 + 1] = digits[c & 0x0f];
+	}
+	output[input_len * 2] = '\0';
+}
@@ -14,5 +14,7 @@
 int hex_to_dec(char, char);
 int hex_str_to_raw(unsigned char *, char *);
 int hex_ischar(char);
+void hex_raw_to_str(char *, const unsigned char *, size_t);
+void hex_hash_to_str(char *, const unsigned char *, size_t);
 
 #endif
@@ -0,0 +1,2089 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "interp.h"
+#include "script.h"
+#include "arena.h"
+#include "crypto.h"
+#include "schnorr.h"
+#include "error.h"
+
+#define INTERP_ARENA_CHUNK     0x10000
+#define INTERP_NUM_MAX         4
+#define INTERP_LOCKTIME_MAX    5
+#define INTERP_NO_FALSE        SIZE_MAX
+#define INTERP_SEQUENCE_DISABLE_FLAG  (1LL << 31)
+#define INTERP_TAPROOT_ANNEX   0x50
+#define INTERP_TAPROOT_LEAF    0xc0
+#define INTERP_CONTROL_BASE    33
+#define INTERP_CONTROL_NODE    32
+#define INTERP_CONTROL_MAX     (INTERP_CONTROL_BASE + INTERP_CONTROL_NODE * 128)
+#define INTERP_BUDGET_BASE     50
+#define INTERP_BUDGET_SIG      50
+#define INTERP_TAG_LEAF        "TapLeaf"
+#define INTERP_TAG_BRANCH      "TapBranch"
+#define INTERP_TAG_TWEAK       "TapTweak"
+
+/*
+ * Stack elements point at their bytes rather than holding them. Pushes
+ * point into the script or witness, copies share their source, and only
+ * values an opcode computes are written to the evaluation's arena.
+ */
+struct InterpItem
+{
+	const unsigned char *data;
+	size_t len;
+};
+
+struct Interp
+{
+	struct InterpItem stack[INTERP_STACK_MAX + 4];
+	size_t stack_count;
+	struct InterpItem altstack[INTERP_STACK_MAX + 4];
+	size_t altstack_count;
+	Arena arena;
+	CryptoHash sha256;
+	CryptoHash sha1;
+	CryptoHash rmd160;
+	CryptoHash tap_leaf;
+	CryptoHash tap_branch;
+	CryptoHash tap_tweak;
+	CryptoHash tap_work;
+	Schnorr schnorr;
+	const struct InterpChecker *checker;
+	const unsigned char *script;
+	size_t script_len;
+	size_t pc;
+	size_t codesep;
+	int flags;
+	int sigversion;
+	int op_count;
+	uint32_t op_pos;
+	int64_t budget;
+	size_t cond_count;
+	size_t cond_first_false;
+	struct InterpTapData tap;
+	unsigned char leaf_hash[CRYPTO_SHA256_LEN];
+};
+
+typedef int (*InterpOp)(Interp, int);
+
+static int interp_eval(Interp, const unsigned char *, size_t, int);
+static int interp_verify_witness(Interp, int, const unsigned char *, size_t, const struct TxViewItem *, size_t, int);
+static int interp_verify_taproot(Interp, const unsigned char **, size_t *, const unsigned char *, const struct TxViewItem *, size_t *);
+static int interp_is_success(int);
+static size_t interp_compact_len(uint64_t);
+static void interp_write_compact(CryptoHash, uint64_t);
+static int interp_is_witness_program(int *, const unsigned char **, size_t *, const unsigned char *, size_t);
+static int interp_is_push_only(const unsigned char *, size_t);
+static int interp_is_single_push(const unsigned char *, size_t, const unsigned char *, size_t);
+static int interp_is_der(const unsigned char *, size_t);
+static int interp_get_bool(const struct InterpItem *);
+static int interp_get_num(int64_t *, const struct InterpItem *, size_t);
+static int interp_push(Interp, const unsigned char *, size_t);
+static int interp_push_num(Interp, int64_t);
+static int interp_push_bool(Interp, int);
+static int interp_get_script_code(const unsigned char **, size_t *, Interp, const struct InterpItem *, size_t);
+static int interp_hash_open(CryptoHash *, int);
+static int interp_tag_open(CryptoHash *, const char *);
+static void interp_hash_close(CryptoHash);
+static int interp_check_schnorr(Interp, const struct InterpItem *, const unsigned char *);
+static int interp_check_tap_sig(int *, Interp, const struct InterpItem *, const struct InterpItem *);
+static int interp_op_bad(Interp, int);
+static int interp_op_nop(Interp, int);
+static int interp_op_number(Interp, int);
+static int interp_op_if(Interp, int);
+static int interp_op_else(Interp, int);
+static int interp_op_endif(Interp, int);
+static int interp_op_verify(Interp, int);
+static int interp_op_return(Interp, int);
+static int interp_op_altstack(Interp, int);
+static int interp_op_stack(Interp, int);
+static int interp_op_pick(Interp, int);
+static int interp_op_size(Interp, int);
+static int interp_op_equal(Interp, int);
+static int interp_op_unary(Interp, int);
+static int interp_op_binary(Interp, int);
+static int interp_op_within(Interp, int);
+static int interp_op_hash(Interp, int);
+static int interp_op_codeseparator(Interp, int);
+static int interp_op_checksig(Interp, int);
+static int interp_op_checkmultisig(Interp, int);
+static int interp_op_checksigadd(Interp, int);
+static int interp_op_checklocktime(Interp, int);
+static int interp_op_checksequence(Interp, int);
+
+/*
+ * Dispatch table indexed by opcode. Pushes are handled before dispatch,
+ * and anything left NULL fails when it's executed.
+ */
+static const InterpOp interp_ops[256] = {
+	[SCRIPT_OP_1NEGATE] = interp_op_number,
+	[0x51] = interp_op_number, [0x52] = interp_op_number, [0x53] = interp_op_number, [0x54] = interp_op_number,
+	[0x55] = interp_op_number, [0x56] = interp_op_number, [0x57] = interp_op_number, [0x58] = interp_op_number,
+	[0x59] = interp_op_number, [0x5a] = interp_op_number, [0x5b] = interp_op_number, [0x5c] = interp_op_number,
+	[0x5d] = interp_op_number, [0x5e] = interp_op_number, [0x5f] = interp_op_number, [0x60] = interp_op_number,
+	[SCRIPT_OP_NOP] = interp_op_nop,
+	[SCRIPT_OP_IF] = interp_op_if,
+	[SCRIPT_OP_NOTIF] = interp_op_if,
+	[SCRIPT_OP_VERIF] = interp_op_bad,
+	[SCRIPT_OP_VERNOTIF] = interp_op_bad,
+	[SCRIPT_OP_ELSE] = interp_op_else,
+	[SCRIPT_OP_ENDIF] = interp_op_endif,
+	[SCRIPT_OP_VERIFY] = interp_op_verify,
+	[SCRIPT_OP_RETURN] = interp_op_return,
+	[SCRIPT_OP_TOALTSTACK] = interp_op_altstack,
+	[SCRIPT_OP_FROMALTSTACK] = interp_op_altstack,
+	[SCRIPT_OP_2DROP] = interp_op_stack,
+	[SCRIPT_OP_2DUP] = interp_op_stack,
+	[SCRIPT_OP_3DUP] = interp_op_stack,
+	[SCRIPT_OP_2OVER] = interp_op_stack,
+	[SCRIPT_OP_2ROT] = interp_op_stack,
+	[SCRIPT_OP_2SWAP] = interp_op_stack,
+	[SCRIPT_OP_IFDUP] = interp_op_stack,
+	[SCRIPT_OP_DEPTH] = interp_op_stack,
+	[SCRIPT_OP_DROP] = interp_op_stack,
+	[SCRIPT_OP_DUP] = interp_op_stack,
+	[SCRIPT_OP_NIP] = interp_op_stack,
+	[SCRIPT_OP_OVER] = interp_op_stack,
+	[SCRIPT_OP_PICK] = interp_op_pick,
+	[SCRIPT_OP_ROLL] = interp_op_pick,
+	[SCRIPT_OP_ROT] = interp_op_stack,
+	[SCRIPT_OP_SWAP] = interp_op_stack,
+	[SCRIPT_OP_TUCK] = interp_op_stack,
+	[SCRIPT_OP_SIZE] = interp_op_size,
+	[SCRIPT_OP_EQUAL] = interp_op_equal,
+	[SCRIPT_OP_EQUALVERIFY] = interp_op_equal,
+	[SCRIPT_OP_1ADD] = interp_op_unary,
+	[SCRIPT_OP_1SUB] = interp_op_unary,
+	[SCRIPT_OP_NEGATE] = interp_op_unary,
+	[SCRIPT_OP_ABS] = interp_op_unary,
+	[SCRIPT_OP_NOT] = interp_op_unary,
+	[SCRIPT_OP_0NOTEQUAL] = interp_op_unary,
+	[SCRIPT_OP_ADD] = interp_op_binary,
+	[SCRIPT_OP_SUB] = interp_op_binary,
+	[SCRIPT_OP_BOOLAND] = interp_op_binary,
+	[SCRIPT_OP_BOOLOR] = interp_op_binary,
+	[SCRIPT_OP_NUMEQUAL] = interp_op_binary,
+	[SCRIPT_OP_NUMEQUALVERIFY] = interp_op_binary,
+	[SCRIPT_OP_NUMNOTEQUAL] = interp_op_binary,
+	[SCRIPT_OP_LESSTHAN] = interp_op_binary,
+	[SCRIPT_OP_GREATERTHAN] = interp_op_binary,
+	[SCRIPT_OP_LESSTHANOREQUAL] = interp_op_binary,
+	[SCRIPT_OP_GREATERTHANOREQUAL] = interp_op_binary,
+	[SCRIPT_OP_MIN] = interp_op_binary,
+	[SCRIPT_OP_MAX] = interp_op_binary,
+	[SCRIPT_OP_WITHIN] = interp_op_within,
+	[SCRIPT_OP_RIPEMD160] = interp_op_hash,
+	[SCRIPT_OP_SHA1] = interp_op_hash,
+	[SCRIPT_OP_SHA256] = interp_op_hash,
+	[SCRIPT_OP_HASH160] = interp_op_hash,
+	[SCRIPT_OP_HASH256] = interp_op_hash,
+	[SCRIPT_OP_CODESEPARATOR] = interp_op_codeseparator,
+	[SCRIPT_OP_CHECKSIG] = interp_op_checksig,
+	[SCRIPT_OP_CHECKSIGVERIFY] = interp_op_checksig,
+	[SCRIPT_OP_CHECKMULTISIG] = interp_op_checkmultisig,
+	[SCRIPT_OP_CHECKMULTISIGVERIFY] = interp_op_checkmultisig,
+	[SCRIPT_OP_NOP1] = interp_op_nop,
+	[SCRIPT_OP_CHECKLOCKTIMEVERIFY] = interp_op_checklocktime,
+	[SCRIPT_OP_CHECKSEQUENCEVERIFY] = interp_op_checksequence,
+	[0xb3] = interp_op_nop, [0xb4] = interp_op_nop, [0xb5] = interp_op_nop, [0xb6] = interp_op_nop,
+	[0xb7] = interp_op_nop, [0xb8] = interp_op_nop, [0xb9] = interp_op_nop,
+	[SCRIPT_OP_CHECKSIGADD] = interp_op_checksigadd,
+};
+
+/*
+ * Opcodes that fail a script just by being in it, even where they aren't
+ * executed.
+ */
+static const unsigned char interp_disabled[256] = {
+	[SCRIPT_OP_CAT] = 1, [SCRIPT_OP_SUBSTR] = 1, [SCRIPT_OP_LEFT] = 1, [SCRIPT_OP_RIGHT] = 1,
+	[SCRIPT_OP_INVERT] = 1, [SCRIPT_OP_AND] = 1, [SCRIPT_OP_OR] = 1, [SCRIPT_OP_XOR] = 1,
+	[SCRIPT_OP_2MUL] = 1, [SCRIPT_OP_2DIV] = 1, [SCRIPT_OP_MUL] = 1, [SCRIPT_OP_DIV] = 1,
+	[SCRIPT_OP_MOD] = 1, [SCRIPT_OP_LSHIFT] = 1, [SCRIPT_OP_RSHIFT] = 1,
+};
+
+// OP_1NEGATE, then OP_1 through OP_16, as pushed.
+static const unsigned char interp_numbers[17] = {
+	0x81, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+};
+
+static const unsigned char interp_true = 1;
+
+int interp_new(Interp vm)
+{
+	int r;
+
+	assert(vm);
+
+	memset(vm, 0, sizeof(*vm));
+
+	vm->arena = malloc(arena_sizeof());
+	if (vm->arena == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	r = arena_new(vm->arena, INTERP_ARENA_CHUNK);
+	if (r < 0)
+	{
+		error_log("Could not create interpreter arena.");
+		return -1;
+	}
+
+	if (interp_hash_open(&vm->sha256, CRYPTO_SHA256) < 0 ||
+	    interp_hash_open(&vm->sha1, CRYPTO_SHA1) < 0 ||
+	    interp_hash_open(&vm->rmd160, CRYPTO_RMD160) < 0 ||
+	    interp_hash_open(&vm->tap_work, CRYPTO_SHA256) < 0 ||
+	    interp_tag_open(&vm->tap_leaf, INTERP_TAG_LEAF) < 0 ||
+	    interp_tag_open(&vm->tap_branch, INTERP_TAG_BRANCH) < 0 ||
+	    interp_tag_open(&vm->tap_tweak, INTERP_TAG_TWEAK) < 0)
+	{
+		error_log("Could not open interpreter hashes.");
+		return -1;
+	}
+
+	// Only for the taproot commitment; signatures are the checker's.
+	vm->schnorr = malloc(schnorr_sizeof());
+	if (vm->schnorr == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	if (schnorr_new(vm->schnorr) < 0)
+	{
+		free(vm->schnorr);
+		vm->schnorr = NULL;
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Check that a scriptSig and witness satisfy the output script they
+ * spend, under the given consensus flags. Returns 1 if they do, or -1
+ * with the reason logged. One interpreter evaluates one input at a time;
+ * verify in parallel with one per thread.
+ */
+int interp_verify(Interp vm, const unsigned char *script_sig, size_t script_sig_len, const unsigned char *script_pubkey, size_t script_pubkey_len, const struct TxViewItem *witness, size_t witness_count, int flags, const struct InterpChecker *checker)
+{
+	int version, had_witness;
+	size_t stack_copy_count;
+	const unsigned char *program, *redeem;
+	size_t program_len, redeem_len;
+	struct InterpItem *stack_copy;
+
+	assert(vm);
+	assert(script_sig || script_sig_len == 0);
+	assert(script_pubkey || script_pubkey_len == 0);
+	assert(witness || witness_count == 0);
+	assert(checker);
+
+	// Segwit is only defined on top of P2SH.
+	assert(!(flags & INTERP_VERIFY_WITNESS) || (flags & INTERP_VERIFY_P2SH));
+
+	arena_reset(vm->arena);
+	vm->stack_count = 0;
+	vm->altstack_count = 0;
+	vm->flags = flags;
+	vm->checker = checker;
+	had_witness = 0;
+
+	if (interp_eval(vm, script_sig, script_sig_len, INTERP_SIGVERSION_BASE) < 0)
+	{
+		return -1;
+	}
+
+	// P2SH evaluates the redeem script against the stack the scriptSig
+	// left, before the output script touched it.
+	stack_copy = NULL;
+	stack_copy_count = vm->stack_count;
+	if (flags & INTERP_VERIFY_P2SH)
+	{
+		stack_copy = arena_alloc(vm->arena, sizeof(struct InterpItem) * (stack_copy_count + 1));
+		if (stack_copy == NULL)
+		{
+			return -1;
+		}
+		memcpy(stack_copy, vm->stack, sizeof(struct InterpItem) * stack_copy_count);
+	}
+
+	if (interp_eval(vm, script_pubkey, script_pubkey_len, INTERP_SIGVERSION_BASE) < 0)
+	{
+		return -1;
+	}
+	if (vm->stack_count == 0 || !interp_get_bool(&vm->stack[vm->stack_count - 1]))
+	{
+		error_log("Script evaluated to false.");
+		return -1;
+	}
+
+	if ((flags & INTERP_VERIFY_WITNESS) && interp_is_witness_program(&version, &program, &program_len, script_pubkey, script_pubkey_len))
+	{
+		had_witness = 1;
+		if (script_sig_len != 0)
+		{
+			error_log("Witness program spent with a non-empty scriptSig.");
+			return -1;
+		}
+		if (interp_verify_witness(vm, version, program, program_len, witness, witness_count, 0) < 0)
+		{
+			return -1;
+		}
+		// The witness stack was checked for cleanliness on its own.
+		vm->stack_count = 1;
+	}
+
+	// OP_HASH160 <20> OP_EQUAL
+	if ((flags & INTERP_VERIFY_P2SH) && script_pubkey_len == 23 && script_pubkey[0] == SCRIPT_OP_HASH160 && script_pubkey[1] == 20 && script_pubkey[22] == SCRIPT_OP_EQUAL)
+	{
+		if (!interp_is_push_only(script_sig, script_sig_len))
+		{
+			error_log("P2SH scriptSig is not push only.");
+			return -1;
+		}
+
+		memcpy(vm->stack, stack_copy, sizeof(struct InterpItem) * stack_copy_count);
+		vm->stack_count = stack_copy_count;
+		vm->altstack_count = 0;
+
+		// The output script would have failed on an empty stack.
+		assert(vm->stack_count > 0);
+
+		redeem = vm->stack[vm->stack_count - 1].data;
+		redeem_len = vm->stack[vm->stack_count - 1].len;
+		vm->stack_count--;
+
+		if (interp_eval(vm, redeem, redeem_len, INTERP_SIGVERSION_BASE) < 0)
+		{
+			return -1;
+		}
+		if (vm->stack_count == 0 || !interp_get_bool(&vm->stack[vm->stack_count - 1]))
+		{
+			error_log("P2SH redeem script evaluated to false.");
+			return -1;
+		}
+
+		if ((flags & INTERP_VERIFY_WITNESS) && interp_is_witness_program(&version, &program, &program_len, redeem, redeem_len))
+		{
+			had_witness = 1;
+			if (!interp_is_single_push(script_sig, script_sig_len, redeem, redeem_len))
+			{
+				error_log("P2SH witness scriptSig is not a single push of the redeem script.");
+				return -1;
+			}
+			if (interp_verify_witness(vm, version, program, program_len, witness, witness_count, 1) < 0)
+			{
+				return -1;
+			}
+			vm->stack_count = 1;
+		}
+	}
+
+	if ((flags & INTERP_VERIFY_WITNESS) && !had_witness && witness_count > 0)
+	{
+		error_log("Input has a witness but spends no witness program.");
+		return -1;
+	}
+
+	return 1;
+}
+
+void interp_clear(Interp vm)
+{
+	assert(vm);
+
+	if (vm->arena != NULL)
+	{
+		arena_clear(vm->arena);
+		free(vm->arena);
+	}
+	interp_hash_close(vm->sha256);
+	interp_hash_close(vm->sha1);
+	interp_hash_close(vm->rmd160);
+	interp_hash_close(vm->tap_leaf);
+	interp_hash_close(vm->tap_branch);
+	interp_hash_close(vm->tap_tweak);
+	interp_hash_close(vm->tap_work);
+	if (vm->schnorr != NULL)
+	{
+		schnorr_clear(vm->schnorr);
+		free(vm->schnorr);
+	}
+
+	memset(vm, 0, sizeof(*vm));
+}
+
+size_t interp_sizeof(void)
+{
+	return sizeof(struct Interp);
+}
+
+/*
+ * Run one script on the current stack. Each operation is decoded in
+ * place and dispatched through interp_ops; conditionals are tracked as a
+ * count plus the depth of the first false branch, so skipping code costs
+ * nothing extra.
+ */
+static int interp_eval(Interp vm, const unsigned char *script, size_t script_len, int sigversion)
+{
+	int op, executing, limited;
+	size_t data, data_len;
+
+	// Tapscript drops the size and operation limits for its budget.
+	limited = (sigversion == INTERP_SIGVERSION_BASE || sigversion == INTERP_SIGVERSION_WITNESS_V0);
+
+	if (limited && script_len > INTERP_SCRIPT_MAX)
+	{
+		error_log("Script is larger than %i bytes.", INTERP_SCRIPT_MAX);
+		return -1;
+	}
+
+	vm->script = script;
+	vm->script_len = script_len;
+	vm->sigversion = sigversion;
+	vm->codesep = 0;
+	vm->op_count = 0;
+	vm->op_pos = 0;
+	vm->cond_count = 0;
+	vm->cond_first_false = INTERP_NO_FALSE;
+
+	for (vm->pc = 0; vm->pc < script_len; vm->op_pos++)
+	{
+		op = script_next_op(&vm->pc, &data, &data_len, script, script_len);
+		if (op < 0)
+		{
+			error_log("Script push runs past the end of the script.");
+			return -1;
+		}
+		if (data_len > INTERP_ELEMENT_MAX)
+		{
+			error_log("Script pushes more than %i bytes.", INTERP_ELEMENT_MAX);
+			return -1;
+		}
+		if (limited && op > SCRIPT_OP_16 && ++vm->op_count > INTERP_OPS_MAX)
+		{
+			error_log("Script has more than %i operations.", INTERP_OPS_MAX);
+			return -1;
+		}
+		if (interp_disabled[op])
+		{
+			error_log("Script contains disabled opcode 0x%02x.", op);
+			return -1;
+		}
+
+		executing = (vm->cond_first_false == INTERP_NO_FALSE);
+
+		if (op <= SCRIPT_OP_PUSHDATA4)
+		{
+			if (executing && interp_push(vm, script + data, data_len) < 0)
+			{
+				return -1;
+			}
+		}
+		else if (executing || (op >= SCRIPT_OP_IF && op <= SCRIPT_OP_ENDIF))
+		{
+			if (interp_ops[op] == NULL)
+			{
+				return interp_op_bad(vm, op);
+			}
+			if (interp_ops[op](vm, op) < 0)
+			{
+				return -1;
+			}
+		}
+
+		if (vm->stack_count + vm->altstack_count > INTERP_STACK_MAX)
+		{
+			error_log("Script stack is larger than %i elements.", INTERP_STACK_MAX);
+			return -1;
+		}
+	}
+
+	if (vm->cond_count > 0)
+	{
+		error_log("Script has an unbalanced conditional.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Version 0 programs are a key hash, run as the equivalent P2PKH script,
+ * or the hash of a script carried as the last witness item. Version 1
+ * programs of 32 bytes, unless wrapped in P2SH, are taproot outputs.
+ * Other versions aren't defined yet and always pass.
+ */
+static int interp_verify_witness(Interp vm, int version, const unsigned char *program, size_t program_len, const struct TxViewItem *witness, size_t witness_count, int is_p2sh)
+{
+	int r, sigversion;
+	size_t i, script_len;
+	unsigned char *p2pkh;
+	unsigned char hash[CRYPTO_SHA256_LEN];
+	const unsigned char *script;
+
+	sigversion = INTERP_SIGVERSION_WITNESS_V0;
+
+	if (version == 1 && program_len == SCHNORR_PUBKEY_LEN && !is_p2sh && (vm->flags & INTERP_VERIFY_TAPROOT))
+	{
+		r = interp_verify_taproot(vm, &script, &script_len, program, witness, &witness_count);
+		if (r <= 0)
+		{
+			return (r < 0) ? -1 : 1;
+		}
+		sigversion = INTERP_SIGVERSION_TAPSCRIPT;
+	}
+	else if (version != 0)
+	{
+		return 1;
+	}
+	else if (program_len == CRYPTO_SHA256_LEN)
+	{
+		if (witness_count == 0)
+		{
+			error_log("P2WSH witness is empty.");
+			return -1;
+		}
+		script = witness[witness_count - 1].data;
+		script_len = witness[witness_count - 1].len;
+		witness_count--;
+
+		crypto_hash_write(vm->sha256, script, script_len);
+		crypto_hash_final(hash, vm->sha256);
+		if (memcmp(hash, program, CRYPTO_SHA256_LEN) != 0)
+		{
+			error_log("P2WSH witness script doesn't match its program.");
+			return -1;
+		}
+	}
+	else if (program_len == CRYPTO_RMD160_LEN)
+	{
+		if (witness_count != 2)
+		{
+			error_log("P2WPKH witness doesn't have two items.");
+			return -1;
+		}
+		p2pkh = arena_alloc(vm->arena, 25);
+		if (p2pkh == NULL)
+		{
+			return -1;
+		}
+		p2pkh[0] = SCRIPT_OP_DUP;
+		p2pkh[1] = SCRIPT_OP_HASH160;
+		p2pkh[2] = CRYPTO_RMD160_LEN;
+		memcpy(p2pkh + 3, program, CRYPTO_RMD160_LEN);
+		p2pkh[23] = SCRIPT_OP_EQUALVERIFY;
+		p2pkh[24] = SCRIPT_OP_CHECKSIG;
+		script = p2pkh;
+		script_len = 25;
+	}
+	else
+	{
+		error_log("Version 0 witness program has the wrong length (%zu).", program_len);
+		return -1;
+	}
+
+	// No opcode has run yet, so check the stack limit up front.
+	if (witness_count > INTERP_STACK_MAX)
+	{
+		error_log("Witness stack is larger than %i elements.", INTERP_STACK_MAX);
+		return -1;
+	}
+
+	vm->stack_count = 0;
+	vm->altstack_count = 0;
+	for (i = 0; i < witness_count; ++i)
+	{
+		if (witness[i].len > INTERP_ELEMENT_MAX)
+		{
+			error_log("Witness item is larger than %i bytes.", INTERP_ELEMENT_MAX);
+			return -1;
+		}
+		vm->stack[vm->stack_count].data = witness[i].data;
+		vm->stack[vm->stack_count++].len = witness[i].len;
+	}
+
+	if (interp_eval(vm, script, script_len, sigversion) < 0)
+	{
+		return -1;
+	}
+
+	if (vm->stack_count != 1 || !interp_get_bool(&vm->stack[0]))
+	{
+		error_log("Witness script must leave exactly one true element.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * BIP341. An annex, a last item starting 0x50 when there are at least
+ * two, is set aside for the signature hash. One item left is a key path
+ * spend, a signature by the output key. Otherwise the last two are a
+ * script and a control block: the leaf version and the parity of the
+ * output key, the internal key and the Merkle path from the script's
+ * leaf to the root, which tweaks the internal key into the output key.
+ *
+ * Returns 1 with the script and the witness items it runs on for a
+ * tapscript to run, 0 when the spend is valid without running anything,
+ * as key path spends, unknown leaf versions and scripts containing an
+ * OP_SUCCESS are, and -1 with the reason logged if it's invalid.
+ */
+static int interp_verify_taproot(Interp vm, const unsigned char **script, size_t *script_len, const unsigned char *program, const struct TxViewItem *witness, size_t *witness_count)
+{
+	int op, r;
+	size_t i, count, control_len, pc, data, data_len;
+	const unsigned char *control;
+	unsigned char leaf_version;
+	unsigned char hash[CRYPTO_SHA256_LEN];
+	struct InterpItem sig;
+
+	count = *witness_count;
+	if (count == 0)
+	{
+		error_log("Taproot witness is empty.");
+		return -1;
+	}
+
+	// The budget counts the whole serialized witness, annex included.
+	vm->budget = INTERP_BUDGET_BASE + (int64_t)interp_compact_len(count);
+	for (i = 0; i < count; ++i)
+	{
+		vm->budget += (int64_t)(interp_compact_len(witness[i].len) + witness[i].len);
+	}
+
+	vm->tap.annex = NULL;
+	vm->tap.annex_len = 0;
+	vm->tap.leaf_hash = NULL;
+	vm->tap.codesep_pos = INTERP_CODESEP_NONE;
+	if (count >= 2 && witness[count - 1].len > 0 && witness[count - 1].data[0] == INTERP_TAPROOT_ANNEX)
+	{
+		vm->tap.annex = witness[count - 1].data;
+		vm->tap.annex_len = witness[count - 1].len;
+		count--;
+	}
+
+	if (count == 1)
+	{
+		sig.data = witness[0].data;
+		sig.len = witness[0].len;
+		vm->sigversion = INTERP_SIGVERSION_TAPROOT;
+		if (interp_check_schnorr(vm, &sig, program) < 0)
+		{
+			return -1;
+		}
+		return 0;
+	}
+
+	control = witness[count - 1].data;
+	control_len = witness[count - 1].len;
+	*script = witness[count - 2].data;
+	*script_len = witness[count - 2].len;
+	count -= 2;
+
+	if (control_len < INTERP_CONTROL_BASE || control_len > INTERP_CONTROL_MAX || (control_len - INTERP_CONTROL_BASE) % INTERP_CONTROL_NODE != 0)
+	{
+		error_log("Taproot control block has the wrong size (%zu).", control_len);
+		return -1;
+	}
+	leaf_version = control[0] & 0xfe;
+
+	// TapLeaf(version || script), then up the path, each branch hashing
+	// its two children in lexicographic order.
+	crypto_hash_restore(vm->tap_work, vm->tap_leaf);
+	crypto_hash_write(vm->tap_work, &leaf_version, 1);
+	interp_write_compact(vm->tap_work, *script_len);
+	crypto_hash_write(vm->tap_work, *script, *script_len);
+	crypto_hash_final(vm->leaf_hash, vm->tap_work);
+
+	memcpy(hash, vm->leaf_hash, CRYPTO_SHA256_LEN);
+	for (i = INTERP_CONTROL_BASE; i < control_len; i += INTERP_CONTROL_NODE)
+	{
+		crypto_hash_restore(vm->tap_work, vm->tap_branch);
+		if (memcmp(hash, control + i, INTERP_CONTROL_NODE) < 0)
+		{
+			crypto_hash_write(vm->tap_work, hash, CRYPTO_SHA256_LEN);
+			crypto_hash_write(vm->tap_work, control + i, INTERP_CONTROL_NODE);
+		}
+		else
+		{
+			crypto_hash_write(vm->tap_work, control + i, INTERP_CONTROL_NODE);
+			crypto_hash_write(vm->tap_work, hash, CRYPTO_SHA256_LEN);
+		}
+		crypto_hash_final(hash, vm->tap_work);
+	}
+
+	crypto_hash_restore(vm->tap_work, vm->tap_tweak);
+	crypto_hash_write(vm->tap_work, control + 1, SCHNORR_PUBKEY_LEN);
+	crypto_hash_write(vm->tap_work, hash, CRYPTO_SHA256_LEN);
+	crypto_hash_final(hash, vm->tap_work);
+
+	r = schnorr_check_tweak(vm->schnorr, program, control[0] & 1, control + 1, hash);
+	if (r < 0)
+	{
+		return -1;
+	}
+	if (r == 0)
+	{
+		error_log("Taproot control block doesn't commit to the output key.");
+		return -1;
+	}
+
+	if (leaf_version != INTERP_TAPROOT_LEAF)
+	{
+		return 0;
+	}
+
+	// BIP342: any OP_SUCCESS makes the script valid before it runs, but
+	// only if everything before it decodes.
+	for (pc = 0; pc < *script_len; )
+	{
+		op = script_next_op(&pc, &data, &data_len, *script, *script_len);
+		if (op < 0)
+		{
+			error_log("Script push runs past the end of the script.");
+			return -1;
+		}
+		if (interp_is_success(op))
+		{
+			return 0;
+		}
+	}
+
+	vm->tap.leaf_hash = vm->leaf_hash;
+	*witness_count = count;
+
+	return 1;
+}
+
+/*
+ * BIP342's OP_SUCCESSx, the opcodes kept for soft forks to redefine.
+ */
+static int interp_is_success(int op)
+{
+	return op == 80 || op == 98 || (op >= 126 && op <= 129) || (op >= 131 && op <= 134) ||
+	       (op >= 137 && op <= 138) || (op >= 141 && op <= 142) || (op >= 149 && op <= 153) ||
+	       (op >= 187 && op <= 254);
+}
+
+static size_t interp_compact_len(uint64_t value)
+{
+	if (value < 0xfd)
+	{
+		return 1;
+	}
+	if (value <= 0xffff)
+	{
+		return 3;
+	}
+	if (value <= 0xffffffff)
+	{
+		return 5;
+	}
+
+	return 9;
+}
+
+static void interp_write_compact(CryptoHash h, uint64_t value)
+{
+	size_t i, len;
+	unsigned char buffer[9];
+
+	len = interp_compact_len(value);
+	if (len == 1)
+	{
+		buffer[0] = (unsigned char)value;
+	}
+	else
+	{
+		buffer[0] = (len == 3) ? 0xfd : (len == 5) ? 0xfe : 0xff;
+		for (i = 1; i < len; ++i)
+		{
+			buffer[i] = (unsigned char)(value >> (8 * (i - 1)));
+		}
+	}
+
+	crypto_hash_write(h, buffer, len);
+}
+
+/*
+ * A witness program is a version opcode followed by a single push of
+ * two to forty bytes.
+ */
+static int interp_is_witness_program(int *version, const unsigned char **program, size_t *program_len, const unsigned char *script, size_t script_len)
+{
+	if (script_len < 4 || script_len > SCRIPT_PROGRAM_MAX + 2)
+	{
+		return 0;
+	}
+	if (script[0] != SCRIPT_OP_0 && (script[0] < SCRIPT_OP_1 || script[0] > SCRIPT_OP_16))
+	{
+		return 0;
+	}
+	if ((size_t)script[1] + 2 != script_len)
+	{
+		return 0;
+	}
+
+	*version = (script[0] == SCRIPT_OP_0) ? 0 : script[0] - SCRIPT_OP_1 + 1;
+	*program = script + 2;
+	*program_len = script[1];
+
+	return 1;
+}
+
+static int interp_is_push_only(const unsigned char *script, size_t script_len)
+{
+	int op;
+	size_t pc, data, data_len;
+
+	for (pc = 0; pc < script_len; )
+	{
+		op = script_next_op(&pc, &data, &data_len, script, script_len);
+		if (op < 0 || op > SCRIPT_OP_16)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Whether script is exactly the push of data a serializer would write.
+ */
+static int interp_is_single_push(const unsigned char *script, size_t script_len, const unsigned char *data, size_t data_len)
+{
+	size_t prefix;
+
+	if (data_len < SCRIPT_OP_PUSHDATA1)
+	{
+		prefix = (script_len > 0 && script[0] == data_len) ? 1 : 0;
+	}
+	else if (data_len <= 0xff)
+	{
+		prefix = (script_len > 1 && script[0] == SCRIPT_OP_PUSHDATA1 && script[1] == data_len) ? 2 : 0;
+	}
+	else
+	{
+		prefix = (script_len > 2 && script[0] == SCRIPT_OP_PUSHDATA2 && script[1] == (data_len & 0xff) && script[2] == (data_len >> 8)) ? 3 : 0;
+	}
+
+	return prefix > 0 && script_len == prefix + data_len && memcmp(script + prefix, data, data_len) == 0;
+}
+
+/*
+ * BIP66 strict DER: 0x30 len 0x02 rlen r 0x02 slen s, then the hash
+ * type byte, with minimal, positive integers.
+ */
+static int interp_is_der(const unsigned char *sig, size_t len)
+{
+	size_t rlen, slen;
+
+	if (len < 9 || len > 73)
+	{
+		return 0;
+	}
+	if (sig[0] != 0x30 || sig[1] != len - 3)
+	{
+		return 0;
+	}
+
+	rlen = sig[3];
+	if (5 + rlen >= len)
+	{
+		return 0;
+	}
+	slen = sig[5 + rlen];
+	if (rlen + slen + 7 != len)
+	{
+		return 0;
+	}
+
+	if (sig[2] != 0x02 || rlen == 0 || (sig[4] & 0x80))
+	{
+		return 0;
+	}
+	if (rlen > 1 && sig[4] == 0x00 && !(sig[5] & 0x80))
+	{
+		return 0;
+	}
+
+	if (sig[4 + rlen] != 0x02 || slen == 0 || (sig[6 + rlen] & 0x80))
+	{
+		return 0;
+	}
+	if (slen > 1 && sig[6 + rlen] == 0x00 && !(sig[7 + rlen] & 0x80))
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Any non-zero byte is true, except a lone sign bit at the end, which is
+ * negative zero.
+ */
+static int interp_get_bool(const struct InterpItem *item)
+{
+	size_t i;
+
+	for (i = 0; i < item->len; ++i)
+	{
+		if (item->data[i] != 0)
+		{
+			return !(i == item->len - 1 && item->data[i] == 0x80);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Numbers are little endian sign and magnitude, at most max_len bytes.
+ */
+static int interp_get_num(int64_t *output, const struct InterpItem *item, size_t max_len)
+{
+	size_t i;
+	uint64_t value;
+
+	if (item->len > max_len)
+	{
+		error_log("Script number is longer than %zu bytes.", max_len);
+		return -1;
+	}
+
+	if (item->len == 0)
+	{
+		*output = 0;
+		return 1;
+	}
+
+	for (value = 0, i = 0; i < item->len; ++i)
+	{
+		value |= (uint64_t)item->data[i] << (8 * i);
+	}
+
+	if (item->data[item->len - 1] & 0x80)
+	{
+		*output = -(int64_t)(value & ~((uint64_t)0x80 << (8 * (item->len - 1))));
+	}
+	else
+	{
+		*output = (int64_t)value;
+	}
+
+	return 1;
+}
+
+static int interp_push(Interp vm, const unsigned char *data, size_t len)
+{
+	vm->stack[vm->stack_count].data = data;
+	vm->stack[vm->stack_count].len = len;
+	vm->stack_count++;
+
+	return 1;
+}
+
+static int interp_push_num(Interp vm, int64_t value)
+{
+	int negative;
+	size_t len;
+	uint64_t abs_value;
+	unsigned char *data;
+
+	if (value == 0)
+	{
+		return interp_push(vm, NULL, 0);
+	}
+
+	data = arena_alloc(vm->arena, 9);
+	if (data == NULL)
+	{
+		return -1;
+	}
+
+	negative = (value < 0);
+	abs_value = negative ? (uint64_t)(-value) : (uint64_t)value;
+	for (len = 0; abs_value > 0; abs_value >>= 8)
+	{
+		data[len++] = (unsigned char)(abs_value & 0xff);
+	}
+
+	// The top bit is the sign, so add a byte if the magnitude uses it.
+	if (data[len - 1] & 0x80)
+	{
+		data[len++] = negative ? 0x80 : 0x00;
+	}
+	else if (negative)
+	{
+		data[len - 1] |= 0x80;
+	}
+
+	return interp_push(vm, data, len);
+}
+
+static int interp_push_bool(Interp vm, int value)
+{
+	return value ? interp_push(vm, &interp_true, 1) : interp_push(vm, NULL, 0);
+}
+
+/*
+ * The script a signature commits to: everything after the last
+ * OP_CODESEPARATOR. Legacy signatures can't commit to themselves, so
+ * their pushes are also cut out of it, matching only on opcode
+ * boundaries.
+ */
+static int interp_get_script_code(const unsigned char **output, size_t *output_len, Interp vm, const struct InterpItem *sigs, size_t sig_count)
+{
+	int op;
+	size_t i, j, pc, start, len, data, data_len, pattern_len, code_len;
+	unsigned char pattern[INTERP_ELEMENT_MAX + 3];
+	unsigned char *code;
+	const unsigned char *script;
+
+	script = vm->script + vm->codesep;
+	len = vm->script_len - vm->codesep;
+
+	*output = script;
+	*output_len = len;
+
+	if (vm->sigversion != INTERP_SIGVERSION_BASE)
+	{
+		return 1;
+	}
+
+	for (i = 0; i < sig_count; ++i)
+	{
+		if (sigs[i].len == 0)
+		{
+			continue;
+		}
+
+		if (sigs[i].len < SCRIPT_OP_PUSHDATA1)
+		{
+			pattern[0] = (unsigned char)sigs[i].len;
+			pattern_len = 1;
+		}
+		else if (sigs[i].len <= 0xff)
+		{
+			pattern[0] = SCRIPT_OP_PUSHDATA1;
+			pattern[1] = (unsigned char)sigs[i].len;
+			pattern_len = 2;
+		}
+		else
+		{
+			pattern[0] = SCRIPT_OP_PUSHDATA2;
+			pattern[1] = (unsigned char)(sigs[i].len & 0xff);
+			pattern[2] = (unsigned char)(sigs[i].len >> 8);
+			pattern_len = 3;
+		}
+		memcpy(pattern + pattern_len, sigs[i].data, sigs[i].len);
+		pattern_len += sigs[i].len;
+
+		code = NULL;
+		code_len = 0;
+		for (pc = 0, start = 0; ; )
+		{
+			// Copy what's between matches, once there's been one.
+			if (code != NULL)
+			{
+				memcpy(code + code_len, script + start, pc - start);
+				code_len += pc - start;
+			}
+			for (j = pc; len - j >= pattern_len && memcmp(script + j, pattern, pattern_len) == 0; j += pattern_len)
+			{
+				if (code == NULL)
+				{
+					code = arena_alloc(vm->arena, len);
+					if (code == NULL)
+					{
+						return -1;
+					}
+					memcpy(code, script, pc);
+					code_len = pc;
+				}
+			}
+			pc = start = j;
+			if (pc >= len)
+			{
+				break;
+			}
+			op = script_next_op(&pc, &data, &data_len, script, len);
+			if (op < 0)
+			{
+				pc = len;
+			}
+		}
+
+		if (code != NULL)
+		{
+			script = code;
+			len = code_len;
+		}
+	}
+
+	*output = script;
+	*output_len = len;
+
+	return 1;
+}
+
+static int interp_hash_open(CryptoHash *h, int algo)
+{
+	*h = malloc(crypto_hash_sizeof());
+	if (*h == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	if (crypto_hash_open(*h, algo) < 0)
+	{
+		free(*h);
+		*h = NULL;
+		return -1;
+	}
+
+	return 1;
+}
+
+static int interp_tag_open(CryptoHash *h, const char *tag)
+{
+	*h = malloc(crypto_hash_sizeof());
+	if (*h == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	if (crypto_tag_open(*h, tag) < 0)
+	{
+		free(*h);
+		*h = NULL;
+		return -1;
+	}
+
+	return 1;
+}
+
+static void interp_hash_close(CryptoHash h)
+{
+	if (h != NULL)
+	{
+		crypto_hash_close(h);
+		free(h);
+	}
+}
+
+static int interp_op_bad(Interp vm, int op)
+{
+	(void)vm;
+
+	error_log("Script executes invalid opcode 0x%02x.", op);
+	return -1;
+}
+
+static int interp_op_nop(Interp vm, int op)
+{
+	(void)vm;
+	(void)op;
+
+	return 1;
+}
+
+static int interp_op_number(Interp vm, int op)
+{
+	const unsigned char *n;
+
+	n = interp_numbers + ((op == SCRIPT_OP_1NEGATE) ? 0 : op - SCRIPT_OP_1 + 1);
+
+	return interp_push(vm, n, 1);
+}
+
+static int interp_op_if(Interp vm, int op)
+{
+	int value = 0;
+	const struct InterpItem *item;
+
+	if (vm->cond_first_false == INTERP_NO_FALSE)
+	{
+		if (vm->stack_count < 1)
+		{
+			error_log("OP_IF needs a stack element.");
+			return -1;
+		}
+		// Tapscript wants exactly empty or 1, so there's one way to
+		// write each branch.
+		item = &vm->stack[vm->stack_count - 1];
+		if (vm->sigversion == INTERP_SIGVERSION_TAPSCRIPT && (item->len > 1 || (item->len == 1 && item->data[0] != 1)))
+		{
+			error_log("%s argument is not minimal.", script_get_word((uint8_t)op));
+			return -1;
+		}
+		value = interp_get_bool(&vm->stack[--vm->stack_count]);
+		if (op == SCRIPT_OP_NOTIF)
+		{
+			value = !value;
+		}
+	}
+
+	if (!value && vm->cond_first_false == INTERP_NO_FALSE)
+	{
+		vm->cond_first_false = vm->cond_count;
+	}
+	vm->cond_count++;
+
+	return 1;
+}
+
+static int interp_op_else(Interp vm, int op)
+{
+	(void)op;
+
+	if (vm->cond_count == 0)
+	{
+		error_log("OP_ELSE without OP_IF.");
+		return -1;
+	}
+
+	// Only the innermost branch flips, and only if nothing outside it is
+	// false.
+	if (vm->cond_first_false == INTERP_NO_FALSE)
+	{
+		vm->cond_first_false = vm->cond_count - 1;
+	}
+	else if (vm->cond_first_false == vm->cond_count - 1)
+	{
+		vm->cond_first_false = INTERP_NO_FALSE;
+	}
+
+	return 1;
+}
+
+static int interp_op_endif(Interp vm, int op)
+{
+	(void)op;
+
+	if (vm->cond_count == 0)
+	{
+		error_log("OP_ENDIF without OP_IF.");
+		return -1;
+	}
+
+	vm->cond_count--;
+	if (vm->cond_first_false == vm->cond_count)
+	{
+		vm->cond_first_false = INTERP_NO_FALSE;
+	}
+
+	return 1;
+}
+
+static int interp_op_verify(Interp vm, int op)
+{
+	(void)op;
+
+	if (vm->stack_count < 1)
+	{
+		error_log("OP_VERIFY needs a stack element.");
+		return -1;
+	}
+	if (!interp_get_bool(&vm->stack[--vm->stack_count]))
+	{
+		error_log("OP_VERIFY failed.");
+		return -1;
+	}
+
+	return 1;
+}
+
+static int interp_op_return(Interp vm, int op)
+{
+	(void)vm;
+	(void)op;
+
+	error_log("Script executes OP_RETURN.");
+	return -1;
+}
+
+static int interp_op_altstack(Interp vm, int op)
+{
+	if (op == SCRIPT_OP_TOALTSTACK)
+	{
+		if (vm->stack_count < 1)
+		{
+			error_log("OP_TOALTSTACK needs a stack element.");
+			return -1;
+		}
+		vm->altstack[vm->altstack_count++] = vm->stack[--vm->stack_count];
+	}
+	else
+	{
+		if (vm->altstack_count < 1)
+		{
+			error_log("OP_FROMALTSTACK needs an alt stack element.");
+			return -1;
+		}
+		vm->stack[vm->stack_count++] = vm->altstack[--vm->altstack_count];
+	}
+
+	return 1;
+}
+
+/*
+ * The stack shuffling opcodes. Elements are only pointers, so these
+ * never copy data.
+ */
+static int interp_op_stack(Interp vm, int op)
+{
+	size_t need;
+	struct InterpItem a, b, *s;
+
+	switch (op)
+	{
+		case SCRIPT_OP_DEPTH:
+			return interp_push_num(vm, (int64_t)vm->stack_count);
+		case SCRIPT_OP_2ROT:
+			need = 6;
+			break;
+		case SCRIPT_OP_2OVER:
+		case SCRIPT_OP_2SWAP:
+			need = 4;
+			break;
+		case SCRIPT_OP_3DUP:
+		case SCRIPT_OP_ROT:
+			need = 3;
+			break;
+		case SCRIPT_OP_2DROP:
+		case SCRIPT_OP_2DUP:
+		case SCRIPT_OP_NIP:
+		case SCRIPT_OP_OVER:
+		case SCRIPT_OP_SWAP:
+		case SCRIPT_OP_TUCK:
+			need = 2;
+			break;
+		default:
+			need = 1;
+			break;
+	}
+
+	if (vm->stack_count < need)
+	{
+		error_log("%s needs %zu stack elements.", script_get_word((uint8_t)op), need);
+		return -1;
+	}
+
+	// s[-1] is the top of the stack.
+	s = vm->stack + vm->stack_count;
+
+	switch (op)
+	{
+		case SCRIPT_OP_2DROP:
+			vm->stack_count -= 2;
+			break;
+		case SCRIPT_OP_2DUP:
+			s[0] = s[-2];
+			s[1] = s[-1];
+			vm->stack_count += 2;
+			break;
+		case SCRIPT_OP_3DUP:
+			s[0] = s[-3];
+			s[1] = s[-2];
+			s[2] = s[-1];
+			vm->stack_count += 3;
+			break;
+		case SCRIPT_OP_2OVER:
+			s[0] = s[-4];
+			s[1] = s[-3];
+			vm->stack_count += 2;
+			break;
+		case SCRIPT_OP_2ROT:
+			a = s[-6];
+			b = s[-5];
+			memmove(s - 6, s - 4, sizeof(struct InterpItem) * 4);
+			s[-2] = a;
+			s[-1] = b;
+			break;
+		case SCRIPT_OP_2SWAP:
+			a = s[-4];
+			b = s[-3];
+			s[-4] = s[-2];
+			s[-3] = s[-1];
+			s[-2] = a;
+			s[-1] = b;
+			break;
+		case SCRIPT_OP_IFDUP:
+			if (interp_get_bool(&s[-1]))
+			{
+				s[0] = s[-1];
+				vm->stack_count++;
+			}
+			break;
+		case SCRIPT_OP_DROP:
+			vm->stack_count--;
+			break;
+		case SCRIPT_OP_DUP:
+			s[0] = s[-1];
+			vm->stack_count++;
+			break;
+		case SCRIPT_OP_NIP:
+			s[-2] = s[-1];
+			vm->stack_count--;
+			break;
+		case SCRIPT_OP_OVER:
+			s[0] = s[-2];
+			vm->stack_count++;
+			break;
+		case SCRIPT_OP_ROT:
+			a = s[-3];
+			s[-3] = s[-2];
+			s[-2] = s[-1];
+			s[-1] = a;
+			break;
+		case SCRIPT_OP_SWAP:
+			a = s[-2];
+			s[-2] = s[-1];
+			s[-1] = a;
+			break;
+		case SCRIPT_OP_TUCK:
+			s[0] = s[-1];
+			s[-1] = s[-2];
+			s[-2] = s[0];
+			vm->stack_count++;
+			break;
+	}
+
+	return 1;
+}
+
+static int interp_op_pick(Interp vm, int op)
+{
+	int64_t n;
+	struct InterpItem item;
+
+	if (vm->stack_count < 2)
+	{
+		error_log("%s needs two stack elements.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	if (interp_get_num(&n, &vm->stack[vm->stack_count - 1], INTERP_NUM_MAX) < 0)
+	{
+		return -1;
+	}
+	vm->stack_count--;
+	if (n < 0 || (uint64_t)n >= vm->stack_count)
+	{
+		error_log("%s index is out of range.", script_get_word((uint8_t)op));
+		return -1;
+	}
+
+	item = vm->stack[vm->stack_count - 1 - n];
+	if (op == SCRIPT_OP_ROLL)
+	{
+		memmove(&vm->stack[vm->stack_count - 1 - n], &vm->stack[vm->stack_count - n], sizeof(struct InterpItem) * n);
+		vm->stack_count--;
+	}
+
+	return interp_push(vm, item.data, item.len);
+}
+
+static int interp_op_size(Interp vm, int op)
+{
+	(void)op;
+
+	if (vm->stack_count < 1)
+	{
+		error_log("OP_SIZE needs a stack element.");
+		return -1;
+	}
+
+	return interp_push_num(vm, (int64_t)vm->stack[vm->stack_count - 1].len);
+}
+
+static int interp_op_equal(Interp vm, int op)
+{
+	int equal;
+	struct InterpItem *a, *b;
+
+	if (vm->stack_count < 2)
+	{
+		error_log("%s needs two stack elements.", script_get_word((uint8_t)op));
+		return -1;
+	}
+
+	a = &vm->stack[vm->stack_count - 2];
+	b = &vm->stack[vm->stack_count - 1];
+	equal = (a->len == b->len && (a->len == 0 || memcmp(a->data, b->data, a->len) == 0));
+	vm->stack_count -= 2;
+
+	if (op == SCRIPT_OP_EQUALVERIFY)
+	{
+		if (!equal)
+		{
+			error_log("OP_EQUALVERIFY failed.");
+			return -1;
+		}
+		return 1;
+	}
+
+	return interp_push_bool(vm, equal);
+}
+
+static int interp_op_unary(Interp vm, int op)
+{
+	int64_t n;
+
+	if (vm->stack_count < 1)
+	{
+		error_log("%s needs a stack element.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	if (interp_get_num(&n, &vm->stack[vm->stack_count - 1], INTERP_NUM_MAX) < 0)
+	{
+		return -1;
+	}
+	vm->stack_count--;
+
+	switch (op)
+	{
+		case SCRIPT_OP_1ADD:
+			n += 1;
+			break;
+		case SCRIPT_OP_1SUB:
+			n -= 1;
+			break;
+		case SCRIPT_OP_NEGATE:
+			n = -n;
+			break;
+		case SCRIPT_OP_ABS:
+			n = (n < 0) ? -n : n;
+			break;
+		case SCRIPT_OP_NOT:
+			n = (n == 0);
+			break;
+		case SCRIPT_OP_0NOTEQUAL:
+			n = (n != 0);
+			break;
+	}
+
+	return interp_push_num(vm, n);
+}
+
+static int interp_op_binary(Interp vm, int op)
+{
+	int64_t a, b, n;
+
+	if (vm->stack_count < 2)
+	{
+		error_log("%s needs two stack elements.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	if (interp_get_num(&a, &vm->stack[vm->stack_count - 2], INTERP_NUM_MAX) < 0 ||
+	    interp_get_num(&b, &vm->stack[vm->stack_count - 1], INTERP_NUM_MAX) < 0)
+	{
+		return -1;
+	}
+	vm->stack_count -= 2;
+
+	switch (op)
+	{
+		case SCRIPT_OP_ADD:
+			n = a + b;
+			break;
+		case SCRIPT_OP_SUB:
+			n = a - b;
+			break;
+		case SCRIPT_OP_BOOLAND:
+			n = (a != 0 && b != 0);
+			break;
+		case SCRIPT_OP_BOOLOR:
+			n = (a != 0 || b != 0);
+			break;
+		case SCRIPT_OP_NUMEQUAL:
+		case SCRIPT_OP_NUMEQUALVERIFY:
+			n = (a == b);
+			break;
+		case SCRIPT_OP_NUMNOTEQUAL:
+			n = (a != b);
+			break;
+		case SCRIPT_OP_LESSTHAN:
+			n = (a < b);
+			break;
+		case SCRIPT_OP_GREATERTHAN:
+			n = (a > b);
+			break;
+		case SCRIPT_OP_LESSTHANOREQUAL:
+			n = (a <= b);
+			break;
+		case SCRIPT_OP_GREATERTHANOREQUAL:
+			n = (a >= b);
+			break;
+		case SCRIPT_OP_MIN:
+			n = (a < b) ? a : b;
+			break;
+		default:
+			n = (a > b) ? a : b;
+			break;
+	}
+
+	if (op == SCRIPT_OP_NUMEQUALVERIFY)
+	{
+		if (!n)
+		{
+			error_log("OP_NUMEQUALVERIFY failed.");
+			return -1;
+		}
+		return 1;
+	}
+
+	return interp_push_num(vm, n);
+}
+
+static int interp_op_within(Interp vm, int op)
+{
+	int64_t x, min, max;
+
+	(void)op;
+
+	if (vm->stack_count < 3)
+	{
+		error_log("OP_WITHIN needs three stack elements.");
+		return -1;
+	}
+	if (interp_get_num(&x, &vm->stack[vm->stack_count - 3], INTERP_NUM_MAX) < 0 ||
+	    interp_get_num(&min, &vm->stack[vm->stack_count - 2], INTERP_NUM_MAX) < 0 ||
+	    interp_get_num(&max, &vm->stack[vm->stack_count - 1], INTERP_NUM_MAX) < 0)
+	{
+		return -1;
+	}
+	vm->stack_count -= 3;
+
+	return interp_push_bool(vm, min <= x && x < max);
+}
+
+static int interp_op_hash(Interp vm, int op)
+{
+	size_t len;
+	unsigned char *digest;
+	unsigned char inner[CRYPTO_SHA256_LEN];
+	struct InterpItem *item;
+
+	if (vm->stack_count < 1)
+	{
+		error_log("%s needs a stack element.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	item = &vm->stack[vm->stack_count - 1];
+
+	digest = arena_alloc(vm->arena, CRYPTO_SHA256_LEN);
+	if (digest == NULL)
+	{
+		return -1;
+	}
+
+	switch (op)
+	{
+		case SCRIPT_OP_RIPEMD160:
+			crypto_hash_write(vm->rmd160, item->data, item->len);
+			crypto_hash_final(digest, vm->rmd160);
+			len = CRYPTO_RMD160_LEN;
+			break;
+		case SCRIPT_OP_SHA1:
+			crypto_hash_write(vm->sha1, item->data, item->len);
+			crypto_hash_final(digest, vm->sha1);
+			len = CRYPTO_SHA1_LEN;
+			break;
+		case SCRIPT_OP_SHA256:
+			crypto_hash_write(vm->sha256, item->data, item->len);
+			crypto_hash_final(digest, vm->sha256);
+			len = CRYPTO_SHA256_LEN;
+			break;
+		case SCRIPT_OP_HASH160:
+			crypto_hash_write(vm->sha256, item->data, item->len);
+			crypto_hash_final(inner, vm->sha256);
+			crypto_hash_write(vm->rmd160, inner, CRYPTO_SHA256_LEN);
+			crypto_hash_final(digest, vm->rmd160);
+			len = CRYPTO_RMD160_LEN;
+			break;
+		default:
+			crypto_hash_write(vm->sha256, item->data, item->len);
+			crypto_hash_final_double(digest, vm->sha256);
+			len = CRYPTO_SHA256_LEN;
+			break;
+	}
+
+	item->data = digest;
+	item->len = len;
+
+	return 1;
+}
+
+static int interp_op_codeseparator(Interp vm, int op)
+{
+	(void)op;
+
+	// Signatures commit to the script from just past here, or in
+	// tapscript to this opcode's position.
+	vm->codesep = vm->pc;
+	vm->tap.codesep_pos = vm->op_pos;
+
+	return 1;
+}
+
+/*
+ * With DERSIG, a signature that isn't strict DER fails the script, but
+ * an empty one is just false.
+ */
+static int interp_check_sig(int *valid, Interp vm, const struct InterpItem *sig, const struct InterpItem *pubkey, const unsigned char *script_code, size_t script_code_len)
+{
+	if ((vm->flags & INTERP_VERIFY_DERSIG) && sig->len > 0 && !interp_is_der(sig->data, sig->len))
+	{
+		error_log("Signature is not strict DER.");
+		return -1;
+	}
+
+	*valid = 0;
+	if (sig->len > 0 && vm->checker->check_sig != NULL)
+	{
+		*valid = vm->checker->check_sig(vm->checker->ctx, sig->data, sig->len, pubkey->data, pubkey->len, script_code, script_code_len, vm->sigversion) == 1;
+	}
+
+	return 1;
+}
+
+/*
+ * A BIP340 signature must be 64 bytes, or 65 with a hash type that isn't
+ * the default one the 64 byte form implies, and must verify. Unlike in
+ * legacy scripts, one that doesn't fails the script.
+ */
+static int interp_check_schnorr(Interp vm, const struct InterpItem *sig, const unsigned char *pubkey)
+{
+	if (sig->len != SCHNORR_SIG_LEN && (sig->len != SCHNORR_SIG_LEN + 1 || sig->data[SCHNORR_SIG_LEN] == 0x00))
+	{
+		error_log("Schnorr signature has the wrong size or hash type.");
+		return -1;
+	}
+	if (vm->checker->check_schnorr == NULL || vm->checker->check_schnorr(vm->checker->ctx, sig->data, sig->len, pubkey, &vm->tap) != 1)
+	{
+		error_log("Schnorr signature is invalid.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * BIP342 signature checks. An empty signature is just false. Any other
+ * uses up budget, and keys of unknown sizes, reserved for upgrades, take
+ * any signature.
+ */
+static int interp_check_tap_sig(int *valid, Interp vm, const struct InterpItem *sig, const struct InterpItem *pubkey)
+{
+	*valid = (sig->len > 0);
+
+	if (*valid)
+	{
+		vm->budget -= INTERP_BUDGET_SIG;
+		if (vm->budget < 0)
+		{
+			error_log("Tapscript exceeds its signature validation budget.");
+			return -1;
+		}
+	}
+	if (pubkey->len == 0)
+	{
+		error_log("Tapscript public key is empty.");
+		return -1;
+	}
+	if (*valid && pubkey->len == SCHNORR_PUBKEY_LEN && interp_check_schnorr(vm, sig, pubkey->data) < 0)
+	{
+		return -1;
+	}
+
+	return 1;
+}
+
+static int interp_op_checksig(Interp vm, int op)
+{
+	int valid;
+	size_t code_len;
+	const unsigned char *code;
+	struct InterpItem sig, pubkey;
+
+	if (vm->stack_count < 2)
+	{
+		error_log("%s needs two stack elements.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	sig = vm->stack[vm->stack_count - 2];
+	pubkey = vm->stack[vm->stack_count - 1];
+
+	if (vm->sigversion == INTERP_SIGVERSION_TAPSCRIPT)
+	{
+		if (interp_check_tap_sig(&valid, vm, &sig, &pubkey) < 0)
+		{
+			return -1;
+		}
+	}
+	else
+	{
+		if (interp_get_script_code(&code, &code_len, vm, &sig, 1) < 0)
+		{
+			return -1;
+		}
+		if (interp_check_sig(&valid, vm, &sig, &pubkey, code, code_len) < 0)
+		{
+			return -1;
+		}
+	}
+	vm->stack_count -= 2;
+
+	if (op == SCRIPT_OP_CHECKSIGVERIFY)
+	{
+		if (!valid)
+		{
+			error_log("OP_CHECKSIGVERIFY failed.");
+			return -1;
+		}
+		return 1;
+	}
+
+	return interp_push_bool(vm, valid);
+}
+
+/*
+ * Signatures are matched to keys in order, each key tried at most once,
+ * so the loop gives up as soon as there are more signatures left than
+ * keys. A historical off-by-one also pops one extra element, which has
+ * to be empty under NULLDUMMY.
+ */
+static int interp_op_checkmultisig(Interp vm, int op)
+{
+	int valid, success;
+	int64_t keys, sigs;
+	size_t i, key, sig, code_len;
+	const unsigned char *code;
+
+	if (vm->sigversion == INTERP_SIGVERSION_TAPSCRIPT)
+	{
+		error_log("%s is disabled in tapscript.", script_get_word((uint8_t)op));
+		return -1;
+	}
+
+	i = 1;
+	if (vm->stack_count < i)
+	{
+		error_log("%s needs a key count.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	if (interp_get_num(&keys, &vm->stack[vm->stack_count - i], INTERP_NUM_MAX) < 0)
+	{
+		return -1;
+	}
+	if (keys < 0 || keys > INTERP_PUBKEYS_MAX)
+	{
+		error_log("%s key count is out of range.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	vm->op_count += (int)keys;
+	if (vm->op_count > INTERP_OPS_MAX)
+	{
+		error_log("Script has more than %i operations.", INTERP_OPS_MAX);
+		return -1;
+	}
+
+	key = ++i;
+	i += (size_t)keys;
+	if (vm->stack_count < i)
+	{
+		error_log("%s needs a signature count.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	if (interp_get_num(&sigs, &vm->stack[vm->stack_count - i], INTERP_NUM_MAX) < 0)
+	{
+		return -1;
+	}
+	if (sigs < 0 || sigs > keys)
+	{
+		error_log("%s signature count is out of range.", script_get_word((uint8_t)op));
+		return -1;
+	}
+
+	sig = ++i;
+	i += (size_t)sigs;
+	if (vm->stack_count < i)
+	{
+		error_log("%s is missing signatures.", script_get_word((uint8_t)op));
+		return -1;
+	}
+
+	// The signatures sit contiguously below the top, last one first.
+	if (interp_get_script_code(&code, &code_len, vm, &vm->stack[vm->stack_count - sig - (size_t)sigs + 1], (size_t)sigs) < 0)
+	{
+		return -1;
+	}
+
+	for (success = 1; success && sigs > 0; )
+	{
+		if (interp_check_sig(&valid, vm, &vm->stack[vm->stack_count - sig], &vm->stack[vm->stack_count - key], code, code_len) < 0)
+		{
+			return -1;
+		}
+		if (valid)
+		{
+			sig++;
+			sigs--;
+		}
+		key++;
+		keys--;
+
+		if (sigs > keys)
+		{
+			success = 0;
+		}
+	}
+
+	// Everything below the dummy element.
+	vm->stack_count -= i - 1;
+
+	if (vm->stack_count < 1)
+	{
+		error_log("%s needs a dummy element.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	if ((vm->flags & INTERP_VERIFY_NULLDUMMY) && vm->stack[vm->stack_count - 1].len != 0)
+	{
+		error_log("%s dummy element is not empty.", script_get_word((uint8_t)op));
+		return -1;
+	}
+	vm->stack_count--;
+
+	if (op == SCRIPT_OP_CHECKMULTISIGVERIFY)
+	{
+		if (!success)
+		{
+			error_log("OP_CHECKMULTISIGVERIFY failed.");
+			return -1;
+		}
+		return 1;
+	}
+
+	return interp_push_bool(vm, success);
+}
+
+/*
+ * Tapscript's replacement for OP_CHECKMULTISIG: sig n pubkey leaves n,
+ * plus one if the signature is there and valid.
+ */
+static int interp_op_checksigadd(Interp vm, int op)
+{
+	int valid;
+	int64_t n;
+	struct InterpItem sig, pubkey;
+
+	if (vm->sigversion != INTERP_SIGVERSION_TAPSCRIPT)
+	{
+		return interp_op_bad(vm, op);
+	}
+
+	if (vm->stack_count < 3)
+	{
+		error_log("OP_CHECKSIGADD needs three stack elements.");
+		return -1;
+	}
+	sig = vm->stack[vm->stack_count - 3];
+	pubkey = vm->stack[vm->stack_count - 1];
+	if (interp_get_num(&n, &vm->stack[vm->stack_count - 2], INTERP_NUM_MAX) < 0)
+	{
+		return -1;
+	}
+
+	if (interp_check_tap_sig(&valid, vm, &sig, &pubkey) < 0)
+	{
+		return -1;
+	}
+	vm->stack_count -= 3;
+
+	return interp_push_num(vm, n + valid);
+}
+
+static int interp_op_checklocktime(Interp vm, int op)
+{
+	int64_t n;
+
+	if (!(vm->flags & INTERP_VERIFY_CLTV))
+	{
+		return interp_op_nop(vm, op);
+	}
+
+	if (vm->stack_count < 1)
+	{
+		error_log("OP_CHECKLOCKTIMEVERIFY needs a stack element.");
+		return -1;
+	}
+	if (interp_get_num(&n, &vm->stack[vm->stack_count - 1], INTERP_LOCKTIME_MAX) < 0)
+	{
+		return -1;
+	}
+	if (n < 0)
+	{
+		error_log("OP_CHECKLOCKTIMEVERIFY lock time is negative.");
+		return -1;
+	}
+	if (vm->checker->check_locktime == NULL || vm->checker->check_locktime(vm->checker->ctx, n) != 1)
+	{
+		error_log("OP_CHECKLOCKTIMEVERIFY failed.");
+		return -1;
+	}
+
+	return 1;
+}
+
+static int interp_op_checksequence(Interp vm, int op)
+{
+	int64_t n;
+
+	if (!(vm->flags & INTERP_VERIFY_CSV))
+	{
+		return interp_op_nop(vm, op);
+	}
+
+	if (vm->stack_count < 1)
+	{
+		error_log("OP_CHECKSEQUENCEVERIFY needs a stack element.");
+		return -1;
+	}
+	if (interp_get_num(&n, &vm->stack[vm->stack_count - 1], INTERP_LOCKTIME_MAX) < 0)
+	{
+		return -1;
+	}
+	if (n < 0)
+	{
+		error_log("OP_CHECKSEQUENCEVERIFY sequence is negative.");
+		return -1;
+	}
+
+	// With the disable flag set the operand means nothing.
+	if (n & INTERP_SEQUENCE_DISABLE_FLAG)
+	{
+		return 1;
+	}
+	if (vm->checker->check_sequence == NULL || vm->checker->check_sequence(vm->checker->ctx, n) != 1)
+	{
+		error_log("OP_CHECKSEQUENCEVERIFY failed.");
+		return -1;
+	}
+
+	return 1;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef INTERP_H
+#define INTERP_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include "txview.h"
+
+#define INTERP_VERIFY_NONE       0
+#define INTERP_VERIFY_P2SH       (1 << 0)
+#define INTERP_VERIFY_DERSIG     (1 << 1)
+#define INTERP_VERIFY_NULLDUMMY  (1 << 2)
+#define INTERP_VERIFY_CLTV       (1 << 3)
+#define INTERP_VERIFY_CSV        (1 << 4)
+#define INTERP_VERIFY_WITNESS    (1 << 5)
+#define INTERP_VERIFY_TAPROOT    (1 << 6)
+#define INTERP_VERIFY_ALL        (INTERP_VERIFY_P2SH | INTERP_VERIFY_DERSIG | INTERP_VERIFY_NULLDUMMY | INTERP_VERIFY_CLTV | INTERP_VERIFY_CSV | INTERP_VERIFY_WITNESS | INTERP_VERIFY_TAPROOT)
+
+#define INTERP_SIGVERSION_BASE        0
+#define INTERP_SIGVERSION_WITNESS_V0  1
+#define INTERP_SIGVERSION_TAPROOT     2
+#define INTERP_SIGVERSION_TAPSCRIPT   3
+
+#define INTERP_SCRIPT_MAX    10000
+#define INTERP_ELEMENT_MAX   520
+#define INTERP_OPS_MAX       201
+#define INTERP_STACK_MAX     1000
+#define INTERP_PUBKEYS_MAX   20
+#define INTERP_CODESEP_NONE  0xffffffff
+
+/*
+ * What a taproot signature commits to besides the transaction: the
+ * annex, if the witness has one, and for script path spends the hash of
+ * the leaf and the opcode position of its last executed
+ * OP_CODESEPARATOR. leaf_hash is NULL for key path spends.
+ */
+struct InterpTapData
+{
+	const unsigned char *annex;
+	size_t annex_len;
+	const unsigned char *leaf_hash;
+	uint32_t codesep_pos;
+};
+
+/*
+ * The interpreter knows nothing about transactions. Whatever needs one,
+ * checking signatures and lock times, is handed to these callbacks along
+ * with ctx. Each returns 1 if the check passes and 0 if it doesn't.
+ * check_sig gets the signature with its hash type byte, the public key,
+ * the script code the signature commits to and the signature version.
+ * check_schnorr gets a 64 or 65 byte BIP340 signature, the latter
+ * ending in a nonzero hash type, and a 32 byte x-only public key.
+ */
+struct InterpChecker
+{
+	int (*check_sig)(void *, const unsigned char *, size_t, const unsigned char *, size_t, const unsigned char *, size_t, int);
+	int (*check_schnorr)(void *, const unsigned char *, size_t, const unsigned char *, const struct InterpTapData *);
+	int (*check_locktime)(void *, int64_t);
+	int (*check_sequence)(void *, int64_t);
+	void *ctx;
+};
+
+typedef struct Interp *Interp;
+
+int interp_new(Interp);
+int interp_verify(Interp, const unsigned char *, size_t, const unsigned char *, size_t, const struct TxViewItem *, size_t, int, const struct InterpChecker *);
+void interp_clear(Interp);
+size_t interp_sizeof(void);
+
+#endif
@@ -5,6 +5,7 @@
  * under the terms of the GPL License. See LICENSE for more details.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -15,10 +16,7 @@
 #include "serialize.h"
 #include "error.h"
 
-#define MESSAGE_MAINNET        0xD9B4BEF9
-#define MESSAGE_TESTNET        0x0709110B
-#define MESSAGE_COMMAND_MAXLEN 12
-#define MESSAGE_PAYLOAD_MAXLEN 1024
+#define MESSAGE_EMPTY_CHECKSUM 0x5DF6E0E2
 
 struct Message
 {
@@ -26,7 +24,7 @@ struct Message
 	char           command[MESSAGE_COMMAND_MAXLEN];
 	uint32_t       length;
 	uint32_t       checksum;
-	unsigned char  payload[MESSAGE_PAYLOAD_MAXLEN];
+	unsigned char *payload;
 };
 
 int message_new(Message m, const char *command, unsigned char *payload, size_t payload_len)
@@ -51,19 +49,21 @@ int message_new(Message m, const char *command, unsigned char *payload, size_t p
 		return -1;
 	}
 
-	if (network_is_main())
-	{
-		m->magic = MESSAGE_MAINNET;
-	}
-	else
-	{
-		m->magic = MESSAGE_TESTNET;
-	}
+	m->magic = network_get_magic();
 
+	memset(m->command, 0, MESSAGE_COMMAND_MAXLEN);
 	strncpy(m->command, command, MESSAGE_COMMAND_MAXLEN);
 	m->length = payload_len;
+	m->checksum = MESSAGE_EMPTY_CHECKSUM;
+	m->payload = NULL;
 	if (payload_len)
 	{
+		m->payload = malloc(payload_len);
+		if (m->payload == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
 		memcpy(m->payload, payload, payload_len);
 		r = crypto_get_checksum(&m->checksum, m->payload, (size_t)m->length);
 		if (r < 0)
@@ -91,7 +91,7 @@ int message_serialize(unsigned char *output, size_t *output_len, Message m)
 		output = serialize_uchar(output, m->payload, m->length);
 	}
 
-	*output_len = 12 + MESSAGE_COMMAND_MAXLEN + m->length;
+	*output_len = MESSAGE_HEADER_LEN + m->length;
 	
 	return 1;
 }
@@ -102,9 +102,11 @@ int message_deserialize(Message output, unsigned char *input, size_t input_len)
 	assert(input);
 	assert(input_len);
 
-	if (input_len < 12 + MESSAGE_COMMAND_MAXLEN)
+	output->payload = NULL;
+
+	if (input_len < MESSAGE_HEADER_LEN)
 	{
-		error_log("Input length (%i) insifficient to create a new message. At least %i bytes required.", input_len, 12 + MESSAGE_COMMAND_MAXLEN);
+		error_log("Input length (%i) insifficient to create a new message. At least %i bytes required.", input_len, MESSAGE_HEADER_LEN);
 		return -1;
 	}
 
@@ -114,15 +116,52 @@ int message_deserialize(Message output, unsigned char *input, size_t input_len)
 	input = deserialize_uint32(&(output->checksum), input, SERIALIZE_ENDIAN_BIG);
 	if (output->length)
 	{
-		if (input_len < 12 + MESSAGE_COMMAND_MAXLEN + output->length)
+		if (output->length > MESSAGE_PAYLOAD_MAXLEN)
 		{
-			error_log("Input length (%i) insifficient to create a new message. %i bytes required.", input_len, 12 + MESSAGE_COMMAND_MAXLEN + output->length);
+			error_log("Message length (%u) can not exceed %i bytes in length.", output->length, MESSAGE_PAYLOAD_MAXLEN);
+			return -1;
+		}
+		if (input_len < MESSAGE_HEADER_LEN + output->length)
+		{
+			error_log("Input length (%i) insifficient to create a new message. %i bytes required.", input_len, MESSAGE_HEADER_LEN + output->length);
+			return -1;
+		}
+		output->payload = malloc(output->length);
+		if (output->payload == NULL)
+		{
+			error_log("Memory allocation error.");
 			return -1;
 		}
 		input = deserialize_uchar(output->payload, input, output->length);
 	}
 	
-	return 12 + MESSAGE_COMMAND_MAXLEN + output->length;
+	return MESSAGE_HEADER_LEN + output->length;
+}
+
+int message_frame_len(size_t *output, unsigned char *input, size_t input_len)
+{
+	uint32_t length;
+
+	assert(output);
+	assert(input);
+
+	// The header isn't complete yet so we can't tell how long the
+	// message is.
+	if (input_len < MESSAGE_HEADER_LEN)
+	{
+		return 0;
+	}
+
+	deserialize_uint32(&length, input + 4 + MESSAGE_COMMAND_MAXLEN, SERIALIZE_ENDIAN_LIT);
+	if (length > MESSAGE_PAYLOAD_MAXLEN)
+	{
+		error_log("Message length (%u) can not exceed %i bytes in length.", length, MESSAGE_PAYLOAD_MAXLEN);
+		return -1;
+	}
+
+	*output = MESSAGE_HEADER_LEN + (size_t)length;
+
+	return 1;
 }
 
 int message_cmp_command(Message m, char *command)
@@ -141,6 +180,11 @@ int message_is_valid(Message m)
 
 	assert(m);
 
+	if (m->magic != network_get_magic())
+	{
+		return 0;
+	}
+
 	// If we don't have a payload then there is nothing to validate
 	if (m->length == 0)
 	{
@@ -162,11 +206,36 @@ int message_get_payload(unsigned char *output, Message m)
 	assert(output);
 	assert(m);
 
-	memcpy(output, m->payload, m->length);
+	if (m->length)
+	{
+		memcpy(output, m->payload, m->length);
+	}
 	
 	return (int)m->length;
 }
 
+unsigned char *message_get_payload_ptr(Message m)
+{
+	assert(m);
+
+	return m->payload;
+}
+
+/*
+ * Copy the command name to output as a terminated string. Output must
+ * hold MESSAGE_COMMAND_MAXLEN + 1 bytes.
+ */
+int message_get_command(char *output, Message m)
+{
+	assert(output);
+	assert(m);
+
+	memcpy(output, m->command, MESSAGE_COMMAND_MAXLEN);
+	output[MESSAGE_COMMAND_MAXLEN] = '\0';
+
+	return 1;
+}
+
 uint32_t message_get_payload_len(Message m)
 {
 	assert(m);
@@ -174,6 +243,22 @@ uint32_t message_get_payload_len(Message m)
 	return m->length;
 }
 
+size_t message_get_serialized_len(Message m)
+{
+	assert(m);
+
+	return MESSAGE_HEADER_LEN + m->length;
+}
+
+void message_clear(Message m)
+{
+	assert(m);
+
+	free(m->payload);
+	m->payload = NULL;
+	m->length = 0;
+}
+
 size_t message_sizeof(void)
 {
 	return sizeof(struct Message);
@@ -8,17 +8,27 @@
 #ifndef MESSAGE_H
 #define MESSAGE_H 1
 
+#include <stddef.h>
 #include <stdint.h>
 
+#define MESSAGE_HEADER_LEN     24
+#define MESSAGE_COMMAND_MAXLEN 12
+#define MESSAGE_PAYLOAD_MAXLEN 0x02000000
+
 typedef struct Message *Message;
 
 int message_new(Message, const char *, unsigned char *, size_t);
 int message_serialize(unsigned char *, size_t *, Message);
 int message_deserialize(Message, unsigned char *, size_t);
+int message_frame_len(size_t *, unsigned char *, size_t);
 int message_cmp_command(Message, char *);
 int message_is_valid(Message);
+int message_get_command(char *, Message);
 int message_get_payload(unsigned char *output, Message m);
+unsigned char *message_get_payload_ptr(Message m);
 uint32_t message_get_payload_len(Message m);
+size_t message_get_serialized_len(Message m);
+void message_clear(Message);
 size_t message_sizeof(void);
 
 #endif
@@ -5,11 +5,15 @@
  * under the terms of the GPL License. See LICENSE for more details.
  */
 
+#include <stdint.h>
 #include "network.h"
 
 #define MAINNET 1;
 #define TESTNET 2;
 
+#define MAGIC_MAINNET 0xD9B4BEF9
+#define MAGIC_TESTNET 0x0709110B
+
 static int network_type = MAINNET;
 
 void network_set_main(void)
@@ -30,4 +34,14 @@ int network_is_main(void)
 int network_is_test(void)
 {
 	return network_type == TESTNET;
+}
+
+uint32_t network_get_magic(void)
+{
+	if (network_is_test())
+	{
+		return MAGIC_TESTNET;
+	}
+
+	return MAGIC_MAINNET;
 }
\ No newline at end of file
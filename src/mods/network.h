@@ -8,9 +8,12 @@
 #ifndef NETWORK_H
 #define NETWORK_H 1
 
+#include <stdint.h>
+
 void network_set_main(void);
 void network_set_test(void);
 int network_is_main(void);
 int network_is_test(void);
+uint32_t network_get_magic(void);
 
 #endif
@@ -7,87 +7,479 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <errno.h>
 #include <assert.h>
 #include "node.h"
+#include "message.h"
+#include "capture.h"
+#include "commands/version.h"
+#include "commands/verack.h"
+#include "commands/addr.h"
 #include "error.h"
 
-#define MAX_MESSAGE_QUEUE 100
+#define NODE_HOST_MAXLEN  256
+#define NODE_READ_CHUNK   65536
+#define NODE_IP_LEN       16
+#define NODE_WRITE_WAIT   10000
+#define NODE_BACKLOG      16
+#define NODE_ATTEMPTS_MAX 16
+
+// Happy eyeballs timing, in milliseconds
+#define NODE_CONNECT_DELAY   250
+#define NODE_CONNECT_TIMEOUT 5000
 
 struct Node
 {
 	int sockfd;
+	int connecting;
+	char host[NODE_HOST_MAXLEN];
+	unsigned char *buffer;
+	size_t buffer_start;
+	size_t buffer_len;
+	size_t buffer_cap;
+	Capture capture;
 };
 
+static int node_buffer_reserve(Node, size_t);
+static void node_init(Node, int, const char *);
+static int node_socket_open(struct sockaddr *, socklen_t, int *);
+
+static const unsigned char ipv4_prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+/*
+ * Connect to host, which may be a name or a literal IPv4 or IPv6 address.
+ * Every address the name resolves to is tried, alternating between
+ * address families, with a new attempt started every NODE_CONNECT_DELAY
+ * milliseconds while earlier ones are still pending (RFC 8305). The first
+ * to connect wins. An attempt that hasn't connected within
+ * NODE_CONNECT_TIMEOUT milliseconds is abandoned.
+ */
 int node_connect(Node node, const char *host, int port)
 {
-	int r, sockfd;
-	struct hostent *server;
-	struct sockaddr_in serv_addr;
+	int r, err, last_err, flags, sockfd, wait;
+	size_t i, j, count, next, pending;
+	char port_str[8];
+	int fds[NODE_ATTEMPTS_MAX];
+	uint64_t started[NODE_ATTEMPTS_MAX], last, now;
+	struct pollfd pfds[NODE_ATTEMPTS_MAX];
+	size_t pfd_index[NODE_ATTEMPTS_MAX];
+	struct addrinfo hints, *res, *ai;
+	struct addrinfo *order[NODE_ATTEMPTS_MAX];
+	struct addrinfo *first[NODE_ATTEMPTS_MAX], *second[NODE_ATTEMPTS_MAX];
+	size_t first_count, second_count;
+	socklen_t err_len;
 	
 	assert(node);
 	assert(host);
 	assert(port);
+
+	snprintf(port_str, sizeof(port_str), "%d", port);
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_ADDRCONFIG;
+
+	r = getaddrinfo(host, port_str, &hints, &res);
+	if (r != 0)
+	{
+		error_log("Unable to lookup host %s: %s", host, gai_strerror(r));
+		return -1;
+	}
+
+	// Interleave the families, keeping the resolver's preference for
+	// which goes first, so one broken family can't eat every attempt.
+	first_count = second_count = 0;
+	for (ai = res; ai != NULL; ai = ai->ai_next)
+	{
+		if (ai->ai_family == res->ai_family && first_count < NODE_ATTEMPTS_MAX)
+		{
+			first[first_count++] = ai;
+		}
+		else if ((ai->ai_family == AF_INET || ai->ai_family == AF_INET6) && ai->ai_family != res->ai_family && second_count < NODE_ATTEMPTS_MAX)
+		{
+			second[second_count++] = ai;
+		}
+	}
+	for (count = 0, i = 0; count < NODE_ATTEMPTS_MAX && (i < first_count || i < second_count); ++i)
+	{
+		if (i < first_count)
+		{
+			order[count++] = first[i];
+		}
+		if (i < second_count && count < NODE_ATTEMPTS_MAX)
+		{
+			order[count++] = second[i];
+		}
+	}
+
+	sockfd = -1;
+	next = pending = 0;
+	last = 0;
+	last_err = 0;
+
+	while (sockfd < 0)
+	{
+		now = node_now();
+
+		// Start the next attempt when none are pending or the last one
+		// has had its head start.
+		while (next < count && (pending == 0 || now - last >= NODE_CONNECT_DELAY))
+		{
+			fds[next] = node_socket_open(order[next]->ai_addr, order[next]->ai_addrlen, &r);
+			if (fds[next] < 0)
+			{
+				last_err = errno;
+			}
+			started[next] = last = now;
+			if (fds[next] >= 0 && r == 0)
+			{
+				sockfd = fds[next];
+				fds[next++] = -1;
+				break;
+			}
+			pending += (fds[next] >= 0);
+			next++;
+		}
+		if (sockfd >= 0)
+		{
+			break;
+		}
+
+		// Abandon attempts that have run out of time
+		for (i = 0; i < next; ++i)
+		{
+			if (fds[i] >= 0 && now - started[i] >= NODE_CONNECT_TIMEOUT)
+			{
+				last_err = ETIMEDOUT;
+				close(fds[i]);
+				fds[i] = -1;
+				pending--;
+			}
+		}
+
+		if (pending == 0 && next == count)
+		{
+			break;
+		}
+
+		wait = NODE_CONNECT_TIMEOUT;
+		for (j = 0, i = 0; i < next; ++i)
+		{
+			if (fds[i] < 0)
+			{
+				continue;
+			}
+			if ((int)(started[i] + NODE_CONNECT_TIMEOUT - now) < wait)
+			{
+				wait = (int)(started[i] + NODE_CONNECT_TIMEOUT - now);
+			}
+			pfds[j].fd = fds[i];
+			pfds[j].events = POLLOUT;
+			pfds[j].revents = 0;
+			pfd_index[j++] = i;
+		}
+		if (next < count && pending > 0 && (int)(last + NODE_CONNECT_DELAY - now) < wait)
+		{
+			wait = (int)(last + NODE_CONNECT_DELAY - now);
+		}
+
+		r = poll(pfds, j, (wait > 0) ? wait : 0);
+		if (r < 0 && errno != EINTR)
+		{
+			last_err = errno;
+			break;
+		}
+
+		for (i = 0; r > 0 && i < j; ++i)
+		{
+			if (pfds[i].revents == 0)
+			{
+				continue;
+			}
+
+			err = 0;
+			err_len = sizeof(err);
+			getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+
+			if (err == 0 && sockfd < 0)
+			{
+				sockfd = pfds[i].fd;
+			}
+			else
+			{
+				last_err = err;
+				close(pfds[i].fd);
+			}
+			fds[pfd_index[i]] = -1;
+			pending--;
+		}
+	}
+
+	// Losing attempts that are still in flight
+	for (i = 0; i < next; ++i)
+	{
+		if (fds[i] >= 0)
+		{
+			close(fds[i]);
+		}
+	}
+
+	freeaddrinfo(res);
+
+	if (sockfd < 0)
+	{
+		error_log("Unable to connect to host %s. Errno %i.", host, last_err);
+		return -1;
+	}
+
+	// Callers of node_connect() expect a blocking socket
+	flags = fcntl(sockfd, F_GETFL, 0);
+	fcntl(sockfd, F_SETFL, flags & ~O_NONBLOCK);
+
+	// If we get here, connection succeeded. Set up node struct.
+	node_init(node, sockfd, host);
 	
-	// Set up a socket in the AF_INET domain (Internet Protocol v4 addresses)
+	return 1;
+}
+
+/*
+ * Begin a non-blocking connection to a 16 byte IPv6 or IPv4-mapped
+ * address. The node reports as ready in node_poll() once the connection
+ * attempt resolves, at which point node_connect_finish() gives the result.
+ */
+int node_connect_start(Node node, unsigned char *ip, int port)
+{
+	int sockfd, connecting;
+	char host[INET6_ADDRSTRLEN];
+	struct sockaddr_in addr4;
+	struct sockaddr_in6 addr6;
+	struct sockaddr *addr;
+	socklen_t addr_len;
+
+	assert(node);
+	assert(ip);
+	assert(port);
+
+	if (memcmp(ip, ipv4_prefix, sizeof(ipv4_prefix)) == 0)
+	{
+		memset(&addr4, 0, sizeof(addr4));
+		addr4.sin_family = AF_INET;
+		memcpy(&addr4.sin_addr.s_addr, ip + sizeof(ipv4_prefix), 4);
+		addr4.sin_port = htons(port);
+		addr = (struct sockaddr *)&addr4;
+		addr_len = sizeof(addr4);
+		inet_ntop(AF_INET, &addr4.sin_addr, host, sizeof(host));
+	}
+	else
+	{
+		memset(&addr6, 0, sizeof(addr6));
+		addr6.sin6_family = AF_INET6;
+		memcpy(&addr6.sin6_addr, ip, NODE_IP_LEN);
+		addr6.sin6_port = htons(port);
+		addr = (struct sockaddr *)&addr6;
+		addr_len = sizeof(addr6);
+		inet_ntop(AF_INET6, &addr6.sin6_addr, host, sizeof(host));
+	}
+
+	sockfd = node_socket_open(addr, addr_len, &connecting);
+	if (sockfd < 0)
+	{
+		error_log("Unable to connect to host %s. Errno %i.", host, errno);
+		return -1;
+	}
+
+	node_init(node, sockfd, host);
+
+	node->connecting = connecting;
+
+	return 1;
+}
+
+int node_connect_finish(Node node)
+{
+	int r, err;
+	socklen_t err_len;
+
+	assert(node);
+
+	if (!node->connecting)
+	{
+		return 1;
+	}
+
+	err = 0;
+	err_len = sizeof(err);
+
+	r = getsockopt(node->sockfd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+	if (r < 0 || err != 0)
+	{
+		error_log("Unable to connect to host %s. Errno %i.", node->host, (r < 0) ? errno : err);
+		return -1;
+	}
+
+	node->connecting = 0;
+
+	return 1;
+}
+
+int node_is_connecting(Node node)
+{
+	assert(node);
+
+	return node->connecting;
+}
+
+/*
+ * Listen for incoming connections on the loopback interface. The node
+ * polls as readable when a connection is waiting for node_accept().
+ */
+int node_listen(Node node, int port)
+{
+	int r, sockfd, flag;
+	struct sockaddr_in addr;
+
+	assert(node);
+	assert(port);
+
 	sockfd = socket(AF_INET, SOCK_STREAM, 0);
 	if (sockfd < 0)
 	{
 		error_log("Unable to create new socket. Errno %i.", errno);
 		return -1;
 	}
-	
-	// Get a pointer to 'hostent' containing info about host.
-	server = gethostbyname(host);
-	if (!server)
+
+	flag = 1;
+	setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+
+	r = bind(sockfd, (struct sockaddr *)&addr, sizeof(addr));
+	if (r < 0)
 	{
-		error_log("Unable to lookup host %s. Errno %i.", host, h_errno);
+		error_log("Unable to bind to port %i. Errno %i.", port, errno);
+		close(sockfd);
 		return -1;
 	}
-	
-	// Initializing serv_addr memory footprint to all integer zeros ('\0')
-	memset(&serv_addr, 0, sizeof(serv_addr));
-	
-	// Setting up our serv_addr structure
-	serv_addr.sin_family = AF_INET;       // Internet Protocol v4 addresses
-	memcpy(&serv_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-	serv_addr.sin_port = htons(port);     // Convert port byte order to 'network byte order'
-	
-	// Connect to server.
-	r = connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr));
+
+	r = listen(sockfd, NODE_BACKLOG);
 	if (r < 0)
 	{
-		error_log("Unable to connect to host %s. Errno %i.", host, errno);
+		error_log("Unable to listen on port %i. Errno %i.", port, errno);
+		close(sockfd);
 		return -1;
 	}
 
-	// If we get here, connection succeeded. Set up node struct.
-	node->sockfd = sockfd;
-	
+	node_init(node, sockfd, "127.0.0.1");
+
+	return 1;
+}
+
+int node_accept(Node node, Node listener)
+{
+	int sockfd, flag;
+	char host[INET_ADDRSTRLEN];
+	struct sockaddr_in addr;
+	socklen_t addr_len;
+
+	assert(node);
+	assert(listener);
+
+	addr_len = sizeof(addr);
+
+	sockfd = accept(listener->sockfd, (struct sockaddr *)&addr, &addr_len);
+	if (sockfd < 0)
+	{
+		error_log("Unable to accept connection. Errno %i.", errno);
+		return -1;
+	}
+
+	flag = 1;
+	setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+	inet_ntop(AF_INET, &addr.sin_addr, host, sizeof(host));
+
+	node_init(node, sockfd, host);
+
 	return 1;
 }
 
+/*
+ * Record every message sent and received by this node to a capture.
+ * Must be set after the node is connected. Pass NULL to stop recording.
+ */
+void node_set_capture(Node node, Capture capture)
+{
+	assert(node);
+
+	node->capture = capture;
+}
+
+/*
+ * Callers always hand node_write() a whole framed message, which is what
+ * makes it the right place to record outgoing traffic.
+ */
 int node_write(Node node, unsigned char *input, size_t input_len)
 {
 	ssize_t r;
+	struct pollfd pfd;
 
 	assert(node);
 	assert(node->sockfd);
 	assert(input);
 	assert(input_len);
-	
-	r = write(node->sockfd, input, input_len);
 
-	if (r < 0)
+	if (node->capture != NULL && capture_write(node->capture, CAPTURE_OUT, node->host, input, input_len) < 0)
 	{
-		error_log("Unable to write message to node. Errno %i.", errno);
+		error_log("Could not record message to %s.", node->host);
 		return -1;
 	}
+	
+	// A single write isn't guaranteed to take everything for large
+	// messages, so keep going until the whole buffer is sent.
+	while (input_len > 0)
+	{
+		// A peer hanging up mid-write should be an error, not a SIGPIPE
+		r = send(node->sockfd, input, input_len, MSG_NOSIGNAL);
+		if (r < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				// Non-blocking socket with a full send buffer
+				pfd.fd = node->sockfd;
+				pfd.events = POLLOUT;
+				if (poll(&pfd, 1, NODE_WRITE_WAIT) <= 0)
+				{
+					error_log("Timed out writing message to node %s.", node->host);
+					return -1;
+				}
+				continue;
+			}
+			error_log("Unable to write message to node. Errno %i.", errno);
+			return -1;
+		}
+		input += r;
+		input_len -= r;
+	}
 
 	return 1;
 }
@@ -131,15 +523,476 @@ int node_read(Node node, unsigned char** buffer)
 	return input_len;
 }
 
+int node_send_message(Node node, const char *command, unsigned char *payload, size_t payload_len)
+{
+	int r;
+	Message message;
+	unsigned char *message_raw;
+	size_t message_raw_len;
+
+	assert(node);
+	assert(command);
+
+	message = malloc(message_sizeof());
+	if (message == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = message_new(message, command, payload, payload_len);
+	if (r < 0)
+	{
+		error_log("Could not create a new message.");
+		return -1;
+	}
+
+	message_raw = malloc(message_get_serialized_len(message));
+	if (message_raw == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = message_serialize(message_raw, &message_raw_len, message);
+	if (r < 0)
+	{
+		error_log("Could not serialize message data.");
+		return -1;
+	}
+
+	r = node_write(node, message_raw, message_raw_len);
+	if (r < 0)
+	{
+		error_log("Could not send message to host.");
+		return -1;
+	}
+
+	message_clear(message);
+	free(message);
+	free(message_raw);
+
+	return 1;
+}
+
+/*
+ * Pull the next complete message off the connection. Data is read from the
+ * socket without blocking and buffered until a whole frame is available.
+ * Returns 1 when a message was deserialized, 0 when more data is needed,
+ * and -1 on error or when the peer closed the connection.
+ */
+int node_read_message(Node node, Message message)
+{
+	int r, did_read;
+	size_t frame_len, want;
+	ssize_t n;
+
+	assert(node);
+	assert(message);
+
+	did_read = 0;
+
+	while (1)
+	{
+		frame_len = 0;
+		r = 0;
+		if (node->buffer != NULL)
+		{
+			r = message_frame_len(&frame_len, node->buffer + node->buffer_start, node->buffer_len - node->buffer_start);
+		}
+		if (r < 0)
+		{
+			error_log("Received malformed message header from host %s.", node->host);
+			return -1;
+		}
+
+		if (r > 0 && node->buffer_len - node->buffer_start >= frame_len)
+		{
+			if (node->capture != NULL && capture_write(node->capture, CAPTURE_IN, node->host, node->buffer + node->buffer_start, frame_len) < 0)
+			{
+				error_log("Could not record message from %s.", node->host);
+				return -1;
+			}
+
+			r = message_deserialize(message, node->buffer + node->buffer_start, frame_len);
+			if (r < 0)
+			{
+				error_log("Could not deserialize message from host %s.", node->host);
+				return -1;
+			}
+			node->buffer_start += frame_len;
+			if (node->buffer_start == node->buffer_len)
+			{
+				node->buffer_start = node->buffer_len = 0;
+			}
+			return 1;
+		}
+
+		// Only touch the socket once per call so a busy peer can't
+		// starve the others sharing the same poll loop.
+		if (did_read)
+		{
+			return 0;
+		}
+
+		want = (r > 0) ? frame_len : MESSAGE_HEADER_LEN;
+		if (want < NODE_READ_CHUNK)
+		{
+			want = NODE_READ_CHUNK;
+		}
+		if (node_buffer_reserve(node, want) < 0)
+		{
+			error_log("Could not grow read buffer for host %s.", node->host);
+			return -1;
+		}
+
+		n = recv(node->sockfd, node->buffer + node->buffer_len, node->buffer_cap - node->buffer_len, MSG_DONTWAIT);
+		if (n < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				return 0;
+			}
+			error_log("Unable to read from host %s. Errno %i.", node->host, errno);
+			return -1;
+		}
+		if (n == 0)
+		{
+			error_log("Connection closed by host %s.", node->host);
+			return -1;
+		}
+
+		node->buffer_len += n;
+		did_read = 1;
+	}
+}
+
+int node_poll(Node *nodes, int *readable, size_t node_count, int timeout)
+{
+	int r;
+	size_t i;
+	struct pollfd *fds;
+
+	assert(nodes);
+	assert(readable);
+
+	fds = malloc(sizeof(*fds) * (node_count ? node_count : 1));
+	if (fds == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	for (i = 0; i < node_count; ++i)
+	{
+		fds[i].fd = (nodes[i] != NULL) ? nodes[i]->sockfd : -1;
+		fds[i].events = (nodes[i] != NULL && nodes[i]->connecting) ? POLLOUT : POLLIN;
+		fds[i].revents = 0;
+	}
+
+	r = poll(fds, node_count, timeout);
+	if (r < 0 && errno != EINTR)
+	{
+		error_log("Error while waiting for host data. Errno %i.", errno);
+		free(fds);
+		return -1;
+	}
+
+	for (i = 0; i < node_count; ++i)
+	{
+		readable[i] = (fds[i].revents & (POLLIN | POLLOUT | POLLHUP | POLLERR)) ? 1 : 0;
+
+		// Data may already be sitting in our own buffer from an
+		// earlier read that pulled in more than one message.
+		if (nodes[i] != NULL && nodes[i]->buffer_len > nodes[i]->buffer_start)
+		{
+			readable[i] = 1;
+		}
+	}
+
+	free(fds);
+
+	return (r < 0) ? 0 : r;
+}
+
+int node_send_version(Node node)
+{
+	int r;
+	unsigned char *version_string;
+
+	assert(node);
+
+	version_string = malloc(version_sizeof());
+	if (version_string == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = version_new_serialize(version_string);
+	if (r < 0)
+	{
+		error_log("Could not serialize version data.");
+		free(version_string);
+		return -1;
+	}
+
+	r = node_send_message(node, VERSION_COMMAND, version_string, r);
+
+	free(version_string);
+
+	return r;
+}
+
+/*
+ * Exchange version and verack messages with a freshly connected host. The
+ * host's version message is deserialized into remote if it is not NULL.
+ * Gives up after timeout seconds.
+ */
+int node_handshake(Node node, Version remote, int timeout)
+{
+	int r, readable, got_version, got_verack;
+	time_t start;
+	Message message;
+
+	assert(node);
+
+	r = node_send_version(node);
+	if (r < 0)
+	{
+		error_log("Could not send version message to host %s.", node->host);
+		return -1;
+	}
+
+	message = malloc(message_sizeof());
+	if (message == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	got_version = got_verack = 0;
+	start = time(NULL);
+
+	while (!got_version || !got_verack)
+	{
+		if (time(NULL) - start > timeout)
+		{
+			error_log("Host %s did not complete handshake before timeout.", node->host);
+			free(message);
+			return -1;
+		}
+
+		r = node_poll(&node, &readable, 1, 1000);
+		if (r < 0)
+		{
+			error_log("Could not wait for data from host %s.", node->host);
+			free(message);
+			return -1;
+		}
+		if (!readable)
+		{
+			continue;
+		}
+
+		while ((r = node_read_message(node, message)) > 0)
+		{
+			if (message_is_valid(message) <= 0)
+			{
+				error_log("Host %s sent a message with an invalid checksum.", node->host);
+				message_clear(message);
+				free(message);
+				return -1;
+			}
+
+			if (message_cmp_command(message, VERSION_COMMAND) == 0)
+			{
+				if (remote != NULL)
+				{
+					r = version_deserialize(remote, message_get_payload_ptr(message), message_get_payload_len(message));
+					if (r < 0)
+					{
+						error_log("Could not deserialize version message from host %s.", node->host);
+						message_clear(message);
+						free(message);
+						return -1;
+					}
+				}
+
+				// Ask for BIP155 address messages. This has to go
+				// out before our verack.
+				r = node_send_message(node, SENDADDRV2_COMMAND, NULL, 0);
+				if (r >= 0)
+				{
+					r = node_send_message(node, VERACK_COMMAND, NULL, 0);
+				}
+				if (r < 0)
+				{
+					error_log("Could not send verack message to host %s.", node->host);
+					message_clear(message);
+					free(message);
+					return -1;
+				}
+
+				got_version = 1;
+			}
+			else if (message_cmp_command(message, VERACK_COMMAND) == 0)
+			{
+				got_verack = 1;
+			}
+
+			message_clear(message);
+		}
+		if (r < 0)
+		{
+			error_log("Could not read handshake from host %s.", node->host);
+			free(message);
+			return -1;
+		}
+	}
+
+	free(message);
+
+	return 1;
+}
+
+const char *node_get_host(Node node)
+{
+	assert(node);
+
+	return node->host;
+}
+
+/*
+ * Close the connection. The descriptor is forgotten so the number can't
+ * be read from again once the system hands it out to something else,
+ * and disconnecting twice is harmless.
+ */
 void node_disconnect(Node node)
 {
 	assert(node);
-	assert(node->sockfd);
-	
-	close(node->sockfd);
+
+	if (node->sockfd >= 0)
+	{
+		close(node->sockfd);
+		node->sockfd = -1;
+	}
+
+	free(node->buffer);
+	node->buffer = NULL;
+	node->buffer_start = node->buffer_len = node->buffer_cap = 0;
+}
+
+/*
+ * Milliseconds on the monotonic clock, for timeouts and elapsed times
+ * that mustn't jump when the wall clock is set.
+ */
+uint64_t node_now(void)
+{
+	return node_now_us() / 1000;
+}
+
+/*
+ * The same clock in microseconds, for spacing messages at high rates.
+ */
+uint64_t node_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000) + ((uint64_t)ts.tv_nsec / 1000);
 }
 
 size_t node_sizeof(void)
 {
 	return sizeof(struct Node);
 }
+
+/*
+ * Create a non-blocking socket and start connecting it. Sets connecting
+ * if the connection is still in progress. Returns the socket, or -1 with
+ * errno set. Nothing is logged, since node_connect() expects some
+ * attempts to fail.
+ */
+static int node_socket_open(struct sockaddr *addr, socklen_t addr_len, int *connecting)
+{
+	int r, err, sockfd, flag;
+
+	sockfd = socket(addr->sa_family, SOCK_STREAM, 0);
+	if (sockfd < 0)
+	{
+		return -1;
+	}
+
+	fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+
+	// Requests are small and latency sensitive, so don't let them sit
+	// in the kernel waiting to be coalesced.
+	flag = 1;
+	setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+	r = connect(sockfd, addr, addr_len);
+	if (r < 0 && errno != EINPROGRESS)
+	{
+		err = errno;
+		close(sockfd);
+		errno = err;
+		return -1;
+	}
+
+	*connecting = (r < 0);
+
+	return sockfd;
+}
+
+static void node_init(Node node, int sockfd, const char *host)
+{
+	node->sockfd = sockfd;
+	node->connecting = 0;
+	snprintf(node->host, NODE_HOST_MAXLEN, "%s", host);
+	node->buffer = NULL;
+	node->buffer_start = 0;
+	node->buffer_len = 0;
+	node->buffer_cap = 0;
+	node->capture = NULL;
+}
+
+static int node_buffer_reserve(Node node, size_t want)
+{
+	size_t pending, cap;
+	unsigned char *buffer;
+
+	// Slide any unconsumed bytes back to the front before deciding if
+	// the buffer actually needs to grow.
+	if (node->buffer_start > 0)
+	{
+		pending = node->buffer_len - node->buffer_start;
+		memmove(node->buffer, node->buffer + node->buffer_start, pending);
+		node->buffer_start = 0;
+		node->buffer_len = pending;
+	}
+
+	if (node->buffer_cap - node->buffer_len >= want)
+	{
+		return 1;
+	}
+
+	cap = node->buffer_cap ? node->buffer_cap : NODE_READ_CHUNK;
+	while (cap < node->buffer_len + want)
+	{
+		cap *= 2;
+	}
+
+	buffer = realloc(node->buffer, cap);
+	if (buffer == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	node->buffer = buffer;
+	node->buffer_cap = cap;
+
+	return 1;
+}
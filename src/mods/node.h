@@ -8,12 +8,32 @@
 #ifndef NODE_H
 #define NODE_H 1
 
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+#include "capture.h"
+#include "commands/version.h"
+
 typedef struct Node *Node;
 
 int node_connect(Node, const char *, int);
+int node_connect_start(Node, unsigned char *, int);
+int node_connect_finish(Node);
+int node_is_connecting(Node);
+int node_listen(Node, int);
+int node_accept(Node, Node);
+void node_set_capture(Node, Capture);
 int node_write(Node, unsigned char *, size_t);
 int node_read(Node, unsigned char**);
+int node_send_message(Node, const char *, unsigned char *, size_t);
+int node_read_message(Node, Message);
+int node_poll(Node *, int *, size_t, int);
+int node_send_version(Node);
+int node_handshake(Node, Version, int);
+const char *node_get_host(Node);
 void node_disconnect(Node);
+uint64_t node_now(void);
+uint64_t node_now_us(void);
 size_t node_sizeof(void);
 
 #endif
@@ -12,7 +12,8 @@
 #include <assert.h>
 #include "pubkey.h"
 #include "privkey.h"
-#include "point.h"
+#include "ctmul.h"
+#include "field.h"
 #include "crypto.h"
 #include "base58check.h"
 #include "bech32.h"
@@ -25,22 +26,24 @@
 #define PUBKEY_COMPRESSED_FLAG_EVEN   0x02
 #define PUBKEY_COMPRESSED_FLAG_ODD    0x03
 #define PUBKEY_UNCOMPRESSED_FLAG      0x04
-#define PUBKEY_POINTS                 (PRIVKEY_LENGTH * 8)
 
 struct PubKey
 {
 	unsigned char data[PUBKEY_UNCOMPRESSED_LENGTH + 1];
 };
 
+static int pubkey_check_point(const unsigned char *, const unsigned char *);
+
+/*
+ * The public key of a private key, compressed or not as the private key
+ * says. The multiplication is constant time, see ctmul_generator().
+ */
 int pubkey_get(PubKey pubkey, PrivKey privkey)
 {
 	int r;
-	size_t i, l;
-	char privkey_hex[((PRIVKEY_LENGTH + 1) * 2) + 1];
-	mpz_t bignum;
-	Point point;
-	Point points[PUBKEY_POINTS];
-	
+	unsigned char k[PRIVKEY_LENGTH];
+	unsigned char y[PUBKEY_COMPRESSED_LENGTH];
+
 	assert(privkey);
 	assert(pubkey);
 
@@ -50,121 +53,25 @@ int pubkey_get(PubKey pubkey, PrivKey privkey)
 		return -1;
 	}
 
-	mpz_init(bignum);
+	privkey_to_raw(k, privkey, 0);
 
-	// Load private key from hex string.
-	r = privkey_to_hex(privkey_hex, privkey, 0);
+	r = ctmul_generator(pubkey->data + 1, y, k);
+	memset(k, 0, sizeof(k));
 	if (r < 0)
 	{
-		error_log("Could not convert private key to hex string.");
+		error_log("Could not calculate public key.");
 		return -1;
 	}
-	privkey_hex[PRIVKEY_LENGTH * 2] = '\0';
-	mpz_set_str(bignum, privkey_hex, 16);
-	
-	// Initalize the points
-	point = malloc(sizeof(*point));
-	if (point == NULL)
-	{
-		error_log("Memory allocation error.");
-		return -1;
-	}
-	point_init(point);
-	for (i = 0; i < PUBKEY_POINTS; ++i)
-	{
-		points[i] = malloc(sizeof(*point));
-		if (points[i] == NULL)
-		{
-			error_log("Memory allocation error.");
-			return -1;
-		}
-		point_init(points[i]);
-	}
-
-	// Calculating public key
-	point_set_generator(points[0]);
-	for (i = 1; i < PUBKEY_POINTS; ++i)
-	{
-		point_double(points[i], points[i-1]);
-		if (!point_verify(points[i]))
-		{
-			error_log("Unexpected point value while calculating public key.");
-			return -1;
-		}
-	}
 
-	// Add all points corresponding to 1 bits
-	for (i = 0; i < PUBKEY_POINTS; ++i)
-	{
-		if (mpz_tstbit(bignum, i) == 1)
-		{
-			if (mpz_cmp_ui(point->x, 0) == 0 && mpz_cmp_ui(point->y, 0) == 0)
-			{
-				point_set(point, points[i]);
-			}
-			else
-			{
-				point_add(point, point, points[i]);
-			}
-			if (!point_verify(points[i]))
-			{
-				error_log("Unexpected point value while calculating public key.");
-				return -1;
-			}
-		}
-	}
-	
-	// Setting compression flag
 	if (privkey_is_compressed(privkey))
 	{
-		if (mpz_even_p(point->y))
-		{
-			pubkey->data[0] = PUBKEY_COMPRESSED_FLAG_EVEN;
-		}
-		else
-		{
-			pubkey->data[0] = PUBKEY_COMPRESSED_FLAG_ODD;
-		}
+		pubkey->data[0] = (y[PUBKEY_COMPRESSED_LENGTH - 1] & 1) ? PUBKEY_COMPRESSED_FLAG_ODD : PUBKEY_COMPRESSED_FLAG_EVEN;
 	}
 	else
 	{
 		pubkey->data[0] = PUBKEY_UNCOMPRESSED_FLAG;
 	}
-	
-	// Exporting x,y coordinates as byte string, making sure to leave leading
-	// zeros if either exports as less than 32 bytes.
-	l = (mpz_sizeinbase(point->x, 2) + 7) / 8;
-	mpz_export(pubkey->data + 1 + (32 - l), &i, 1, 1, 1, 0, point->x);
-	if (l != i)
-	{
-		error_log("Length of public key x-value export (%zu) does not match expected length (%zu).", i, l);
-		return -1;
-	}
-	if (!privkey_is_compressed(privkey))
-	{
-		l = (mpz_sizeinbase(point->y, 2) + 7) / 8;
-		mpz_export(pubkey->data + 33 + (32 - l), &i, 1, 1, 1, 0, point->y);
-		if (l != i)
-		{
-			error_log("Length of public key y-value export (%zu) does not match expected length (%zu).", i, l);
-			return -1;
-		}
-	}
-
-	// Clear all mpz data
-	mpz_clear(bignum);
-	point_clear(point);
-	for (i = 0; i < PUBKEY_POINTS; ++i)
-	{
-		point_clear(points[i]);
-	}
-
-	// Free all points
-	free(point);
-	for (i = 0; i < PUBKEY_POINTS; ++i)
-	{
-		free(points[i]);
-	}
+	memcpy(pubkey->data + 1 + PUBKEY_COMPRESSED_LENGTH, y, PUBKEY_COMPRESSED_LENGTH);
 
 	return 1;
 }
@@ -199,6 +106,138 @@ int pubkey_compress(PubKey key)
 	return 1;
 }
 
+/*
+ * Every key keeps its y, found when a compressed key is parsed, so this
+ * only changes the flag.
+ */
+int pubkey_uncompress(PubKey key)
+{
+	assert(key);
+
+	key->data[0] = PUBKEY_UNCOMPRESSED_FLAG;
+
+	return 1;
+}
+
+/*
+ * A 33 byte compressed or 65 byte uncompressed SEC encoding, or a 32 byte
+ * BIP340 x-only key, which stands for the point with an even y. It has to
+ * be a point on the curve. A compressed or x-only key gets its y here,
+ * see pubkey_from_raw_batch(), and an x-only key is kept compressed.
+ */
+int pubkey_from_raw(PubKey key, const unsigned char *input, size_t len)
+{
+	unsigned char even[PUBKEY_COMPRESSED_LENGTH + 1];
+
+	assert(key);
+	assert(input);
+
+	if (len == PUBKEY_COMPRESSED_LENGTH)
+	{
+		even[0] = PUBKEY_COMPRESSED_FLAG_EVEN;
+		memcpy(even + 1, input, PUBKEY_COMPRESSED_LENGTH);
+		return pubkey_from_raw_batch(&key, even, 1);
+	}
+
+	if (len == PUBKEY_COMPRESSED_LENGTH + 1 && input[0] != PUBKEY_UNCOMPRESSED_FLAG)
+	{
+		return pubkey_from_raw_batch(&key, input, 1);
+	}
+
+	if (len != PUBKEY_UNCOMPRESSED_LENGTH + 1)
+	{
+		error_log("Public key must be %i bytes x-only, %i bytes compressed or %i bytes uncompressed, not %zu.", PUBKEY_COMPRESSED_LENGTH, PUBKEY_COMPRESSED_LENGTH + 1, PUBKEY_UNCOMPRESSED_LENGTH + 1, len);
+		return -1;
+	}
+	if (input[0] != PUBKEY_UNCOMPRESSED_FLAG)
+	{
+		error_log("Public key contains invalid compression flag.");
+		return -1;
+	}
+	if (pubkey_check_point(input + 1, input + 1 + PUBKEY_COMPRESSED_LENGTH) < 0)
+	{
+		return -1;
+	}
+
+	memcpy(key->data, input, PUBKEY_UNCOMPRESSED_LENGTH + 1);
+
+	return 1;
+}
+
+/*
+ * count compressed keys of 33 bytes each, back to back, as in a list of
+ * exported keys. Each y comes from field_lift_x(), whose square root is
+ * also the on curve check, and is stored with the key. Unlike inverses,
+ * square roots can't share one exponentiation, so every key still costs
+ * a full one. A lone key is not numbered in errors.
+ */
+int pubkey_from_raw_batch(PubKey *keys, const unsigned char *input, size_t count)
+{
+	size_t i;
+	const unsigned char *raw;
+	struct FieldElem y;
+
+	assert(keys);
+	assert(input);
+
+	for (i = 0; i < count; ++i)
+	{
+		raw = input + i * (PUBKEY_COMPRESSED_LENGTH + 1);
+		if (raw[0] != PUBKEY_COMPRESSED_FLAG_EVEN && raw[0] != PUBKEY_COMPRESSED_FLAG_ODD)
+		{
+			if (count == 1)
+			{
+				error_log("Public key contains invalid compression flag.");
+			}
+			else
+			{
+				error_log("Public key %zu contains invalid compression flag.", i);
+			}
+			return -1;
+		}
+		if (!field_lift_x(&y, raw + 1, raw[0] == PUBKEY_COMPRESSED_FLAG_ODD))
+		{
+			if (count == 1)
+			{
+				error_log("Public key is not on the curve.");
+			}
+			else
+			{
+				error_log("Public key %zu is not on the curve.", i);
+			}
+			return -1;
+		}
+
+		memcpy(keys[i]->data, raw, PUBKEY_COMPRESSED_LENGTH + 1);
+		field_get_bytes(keys[i]->data + 1 + PUBKEY_COMPRESSED_LENGTH, &y);
+	}
+
+	return 1;
+}
+
+int pubkey_from_hex(PubKey key, char *input)
+{
+	size_t len;
+	unsigned char raw[PUBKEY_UNCOMPRESSED_LENGTH + 1];
+
+	assert(key);
+	assert(input);
+
+	len = strlen(input);
+	if (len != PUBKEY_COMPRESSED_LENGTH * 2 && len != (PUBKEY_COMPRESSED_LENGTH + 1) * 2 && len != (PUBKEY_UNCOMPRESSED_LENGTH + 1) * 2)
+	{
+		error_log("Hexadecimal public key must be %i, %i or %i characters long.", PUBKEY_COMPRESSED_LENGTH * 2, (PUBKEY_COMPRESSED_LENGTH + 1) * 2, (PUBKEY_UNCOMPRESSED_LENGTH + 1) * 2);
+		return -1;
+	}
+	if (hex_str_to_raw(raw, input) < 0)
+	{
+		error_log("Could not convert hexadecimal public key to bytes.");
+		return -1;
+	}
+
+	return pubkey_from_raw(key, raw, len / 2);
+}
+
 int pubkey_is_compressed(PubKey key)
 {
 	assert(key);
@@ -316,19 +355,44 @@ int pubkey_to_address(char *address, PubKey key)
 int pubkey_to_bech32address(char *address, PubKey key)
 {
 	int r;
-	unsigned char sha[32];
 	unsigned char rmd[20];
 
 	assert(address);
 	assert(key);
 
+	r = pubkey_to_hash160(rmd, key);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	r = bech32_get_address(address, 0, rmd, 20);
+	if (r < 0)
+	{
+		error_log("Could not generate bech32 address from public key data.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * The 20 byte P2WPKH witness program of a compressed key, RMD(SHA(key)).
+ */
+int pubkey_to_hash160(unsigned char *rmd, PubKey key)
+{
+	int r;
+	unsigned char sha[32];
+
+	assert(rmd);
+	assert(key);
+
 	if (!pubkey_is_compressed(key))
 	{
 		error_log("Public key is uncompressed. Bech32 addresses require a compressed public key.");
 		return -1;
 	}
 
-	// RMD(SHA(data))
 	r = crypto_get_sha256(sha, key->data, PUBKEY_COMPRESSED_LENGTH + 1);
 	if (r < 0)
 	{
@@ -342,10 +406,58 @@ int pubkey_to_bech32address(char *address, PubKey key)
 		return -1;
 	}
 
-	r = bech32_get_address(address, rmd, 20);
+	return 1;
+}
+
+/*
+ * The BIP86 pay to taproot address of a key: its x coordinate is the
+ * internal key, tweaked with no scripts into the output key that goes
+ * in a version 1 witness program. The key's compression doesn't matter,
+ * since only x is used. sc holds the tweak hash midstate and the
+ * generator table, so keeping one across calls keeps this about as cheap
+ * as the hash160 of the other address types.
+ */
+int pubkey_to_taproot_address(char *address, PubKey key, Schnorr sc)
+{
+	int r;
+	unsigned char output_key[SCHNORR_PUBKEY_LEN];
+
+	assert(address);
+	assert(key);
+	assert(sc);
+
+	r = pubkey_to_taproot_key(output_key, key, sc);
 	if (r < 0)
 	{
-		error_log("Could not generate bech32 address from public key data.");
+		return -1;
+	}
+
+	r = bech32_get_address(address, 1, output_key, SCHNORR_PUBKEY_LEN);
+	if (r < 0)
+	{
+		error_log("Could not generate bech32m address from public key data.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * The 32 byte x-only output key that pubkey_to_taproot_address()
+ * encodes.
+ */
+int pubkey_to_taproot_key(unsigned char *output_key, PubKey key, Schnorr sc)
+{
+	int r;
+
+	assert(output_key);
+	assert(key);
+	assert(sc);
+
+	r = schnorr_taproot_output(sc, output_key, NULL, key->data + 1, NULL);
+	if (r <= 0)
+	{
+		error_log("Could not tweak public key into a taproot output key.");
 		return -1;
 	}
 
@@ -357,3 +469,26 @@ size_t pubkey_sizeof(void)
 	return sizeof(struct PubKey);
 }
 
+/*
+ * y^2 = x^3 + 7 with both below p: the y that field_lift_x() finds for
+ * x with the parity of the given y has to be that y.
+ */
+static int pubkey_check_point(const unsigned char *x, const unsigned char *y)
+{
+	unsigned char check[PUBKEY_COMPRESSED_LENGTH];
+	struct FieldElem t;
+
+	if (!field_lift_x(&t, x, y[PUBKEY_COMPRESSED_LENGTH - 1] & 1))
+	{
+		error_log("Public key is not on the curve.");
+		return -1;
+	}
+	field_get_bytes(check, &t);
+	if (memcmp(check, y, PUBKEY_COMPRESSED_LENGTH) != 0)
+	{
+		error_log("Public key is not on the curve.");
+		return -1;
+	}
+
+	return 1;
+}
@@ -9,6 +9,7 @@
 #define PUBKEY_H 1
 
 #include "privkey.h"
+#include "schnorr.h"
 
 #define PUBKEY_UNCOMPRESSED_LENGTH    64
 #define PUBKEY_COMPRESSED_LENGTH      32
@@ -17,11 +18,18 @@ typedef struct PubKey *PubKey;
 
 int pubkey_get(PubKey, PrivKey);
 int pubkey_compress(PubKey);
+int pubkey_uncompress(PubKey);
+int pubkey_from_raw(PubKey, const unsigned char *, size_t);
+int pubkey_from_raw_batch(PubKey *, const unsigned char *, size_t);
+int pubkey_from_hex(PubKey, char *);
 int pubkey_is_compressed(PubKey);
 int pubkey_to_hex(char *, PubKey);
 int pubkey_to_raw(unsigned char *, PubKey);
 int pubkey_to_address(char *, PubKey);
 int pubkey_to_bech32address(char *, PubKey);
+int pubkey_to_hash160(unsigned char *, PubKey);
+int pubkey_to_taproot_address(char *, PubKey, Schnorr);
+int pubkey_to_taproot_key(unsigned char *, PubKey, Schnorr);
 size_t pubkey_sizeof(void);
 
 #endif
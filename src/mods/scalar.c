@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "scalar.h"
+
+// 2^256 - n is 129 bits, five limbs.
+#define SCALAR_C_LIMBS  5
+
+static const uint32_t scalar_n[SCALAR_LIMBS] = {
+	0xD0364141, 0xBFD25E8C, 0xAF48A03B, 0xBAAEDCE6,
+	0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+};
+
+// The exponent of an inversion, n - 2.
+static const uint32_t scalar_n_2[SCALAR_LIMBS] = {
+	0xD036413F, 0xBFD25E8C, 0xAF48A03B, 0xBAAEDCE6,
+	0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+};
+
+static const uint32_t scalar_half_n[SCALAR_LIMBS] = {
+	0x681B20A0, 0xDFE92F46, 0x57A4501D, 0x5D576E73,
+	0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x7FFFFFFF
+};
+
+static const uint32_t scalar_c[SCALAR_C_LIMBS] = {
+	0x2FC9BEBF, 0x402DA173, 0x50B75FC4, 0x45512319, 0x00000001
+};
+
+static uint32_t scalar_sub_n(uint32_t *, uint32_t);
+static int scalar_fold(uint32_t *, const uint32_t *, int);
+static void scalar_reduce(struct Scalar *, const uint32_t *);
+
+/*
+ * 32 big endian bytes, reduced mod n. Returns 1 if they were n or more,
+ * which for a private key or a nonce means out of range, or 0.
+ */
+int scalar_set_bytes(struct Scalar *r, const unsigned char *input)
+{
+	int i;
+
+	assert(r);
+	assert(input);
+
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		r->v[i] = ((uint32_t)input[SCALAR_LEN - 4 * i - 4] << 24) |
+		          ((uint32_t)input[SCALAR_LEN - 4 * i - 3] << 16) |
+		          ((uint32_t)input[SCALAR_LEN - 4 * i - 2] << 8) |
+		          (uint32_t)input[SCALAR_LEN - 4 * i - 1];
+	}
+
+	return (int)scalar_sub_n(r->v, 0);
+}
+
+void scalar_get_bytes(unsigned char *output, const struct Scalar *a)
+{
+	int i;
+
+	assert(output);
+	assert(a);
+
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		output[SCALAR_LEN - 4 * i - 4] = (unsigned char)(a->v[i] >> 24);
+		output[SCALAR_LEN - 4 * i - 3] = (unsigned char)(a->v[i] >> 16);
+		output[SCALAR_LEN - 4 * i - 2] = (unsigned char)(a->v[i] >> 8);
+		output[SCALAR_LEN - 4 * i - 1] = (unsigned char)a->v[i];
+	}
+}
+
+void scalar_add(struct Scalar *r, const struct Scalar *a, const struct Scalar *b)
+{
+	int i;
+	uint64_t acc;
+
+	assert(r);
+	assert(a);
+	assert(b);
+
+	acc = 0;
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		acc += (uint64_t)a->v[i] + b->v[i];
+		r->v[i] = (uint32_t)acc;
+		acc >>= 32;
+	}
+	scalar_sub_n(r->v, (uint32_t)acc);
+}
+
+/*
+ * n - a, which for zero is n and reduces back to zero.
+ */
+void scalar_neg(struct Scalar *r, const struct Scalar *a)
+{
+	int i;
+	uint64_t d, borrow;
+
+	assert(r);
+	assert(a);
+
+	borrow = 0;
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		d = (uint64_t)scalar_n[i] - a->v[i] - borrow;
+		r->v[i] = (uint32_t)d;
+		borrow = (d >> 63) & 1;
+	}
+	scalar_sub_n(r->v, 0);
+}
+
+void scalar_mul(struct Scalar *r, const struct Scalar *a, const struct Scalar *b)
+{
+	int i, j;
+	uint64_t acc;
+	uint32_t t[SCALAR_LIMBS * 2];
+
+	assert(r);
+	assert(a);
+	assert(b);
+
+	memset(t, 0, sizeof(t));
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		acc = 0;
+		for (j = 0; j < SCALAR_LIMBS; ++j)
+		{
+			acc += (uint64_t)a->v[i] * b->v[j] + t[i + j];
+			t[i + j] = (uint32_t)acc;
+			acc >>= 32;
+		}
+		t[i + SCALAR_LIMBS] = (uint32_t)acc;
+	}
+	scalar_reduce(r, t);
+}
+
+/*
+ * a^(n - 2) by square and multiply. The exponent is a constant, so the
+ * branch on its bits says nothing about a. Zero gives zero.
+ */
+void scalar_inv(struct Scalar *r, const struct Scalar *a)
+{
+	int i;
+	struct Scalar x, t;
+
+	assert(r);
+	assert(a);
+
+	x = *a;
+	memset(&t, 0, sizeof(t));
+	t.v[0] = 1;
+	for (i = SCALAR_LIMBS * 32 - 1; i >= 0; --i)
+	{
+		scalar_mul(&t, &t, &t);
+		if ((scalar_n_2[i / 32] >> (i % 32)) & 1)
+		{
+			scalar_mul(&t, &t, &x);
+		}
+	}
+
+	*r = t;
+	memset(&x, 0, sizeof(x));
+	memset(&t, 0, sizeof(t));
+}
+
+/*
+ * r = a if flag is 1, unchanged if it is 0, by masking rather than
+ * branching.
+ */
+void scalar_cmov(struct Scalar *r, const struct Scalar *a, uint32_t flag)
+{
+	int i;
+	uint32_t mask;
+
+	assert(r);
+	assert(a);
+	assert(flag <= 1);
+
+	mask = (uint32_t)0 - flag;
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		r->v[i] = (r->v[i] & ~mask) | (a->v[i] & mask);
+	}
+}
+
+int scalar_is_zero(const struct Scalar *a)
+{
+	int i;
+	uint32_t z;
+
+	assert(a);
+
+	z = 0;
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		z |= a->v[i];
+	}
+
+	return (int)(((z | ((uint32_t)0 - z)) >> 31) ^ 1);
+}
+
+/*
+ * Whether a is above n / 2, as a high S value of a signature is.
+ */
+int scalar_is_high(const struct Scalar *a)
+{
+	int i;
+	uint64_t d, borrow;
+
+	assert(a);
+
+	borrow = 0;
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		d = (uint64_t)scalar_half_n[i] - a->v[i] - borrow;
+		borrow = (d >> 63) & 1;
+	}
+
+	return (int)borrow;
+}
+
+/*
+ * Subtract n from carry * 2^256 + v unless that goes negative, which
+ * brings anything under 2n below n. Returns 1 if it subtracted.
+ */
+static uint32_t scalar_sub_n(uint32_t *v, uint32_t carry)
+{
+	int i;
+	uint64_t d, borrow;
+	uint32_t s[SCALAR_LIMBS];
+	uint32_t flag, mask;
+
+	borrow = 0;
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		d = (uint64_t)v[i] - scalar_n[i] - borrow;
+		s[i] = (uint32_t)d;
+		borrow = (d >> 63) & 1;
+	}
+
+	flag = carry | ((uint32_t)borrow ^ 1);
+	mask = (uint32_t)0 - flag;
+	for (i = 0; i < SCALAR_LIMBS; ++i)
+	{
+		v[i] = (s[i] & mask) | (v[i] & ~mask);
+	}
+
+	return flag;
+}
+
+/*
+ * r = lo + hi * (2^256 - n), where t of len limbs is lo + hi * 2^256.
+ * Returns the number of limbs in r, fewer for each fold down to nine.
+ */
+static int scalar_fold(uint32_t *r, const uint32_t *t, int len)
+{
+	int i, j, r_len;
+	uint64_t acc;
+
+	r_len = len - SCALAR_LIMBS + SCALAR_C_LIMBS + 1;
+	if (r_len < SCALAR_LIMBS + 1)
+	{
+		r_len = SCALAR_LIMBS + 1;
+	}
+
+	memset(r, 0, sizeof(*r) * r_len);
+	memcpy(r, t, sizeof(*r) * SCALAR_LIMBS);
+	for (i = 0; i < len - SCALAR_LIMBS; ++i)
+	{
+		acc = 0;
+		for (j = 0; j < SCALAR_C_LIMBS; ++j)
+		{
+			acc += (uint64_t)t[SCALAR_LIMBS + i] * scalar_c[j] + r[i + j];
+			r[i + j] = (uint32_t)acc;
+			acc >>= 32;
+		}
+		for (j = i + SCALAR_C_LIMBS; j < r_len; ++j)
+		{
+			acc += r[j];
+			r[j] = (uint32_t)acc;
+			acc >>= 32;
+		}
+	}
+
+	return r_len;
+}
+
+/*
+ * A 512 bit product folds to under 2^386, 2^260, 2^257 and then 2^256 +
+ * 2^129. A last fold leaves it under 2^256 < 2n for one subtraction.
+ * The lengths are the same for every product.
+ */
+static void scalar_reduce(struct Scalar *r, const uint32_t *t)
+{
+	int len;
+	uint32_t a[SCALAR_LIMBS * 2];
+	uint32_t b[SCALAR_LIMBS * 2];
+
+	len = SCALAR_LIMBS * 2;
+	memcpy(a, t, sizeof(a));
+	while (len > SCALAR_LIMBS + 1)
+	{
+		len = scalar_fold(b, a, len);
+		memcpy(a, b, sizeof(*a) * len);
+	}
+	scalar_fold(b, a, len);
+
+	memcpy(r->v, b, sizeof(r->v));
+	scalar_sub_n(r->v, b[SCALAR_LIMBS]);
+}
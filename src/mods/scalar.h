@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef SCALAR_H
+#define SCALAR_H 1
+
+#include <stdint.h>
+
+#define SCALAR_LEN    32
+#define SCALAR_LIMBS  8
+
+/*
+ * An integer mod n, the order of secp256k1, in fixed 32 bit limbs, least
+ * significant first, always fully reduced. What field.c is to p this is
+ * to n: constant time, for private keys, nonces and the signatures made
+ * from them. A result may be written over an operand.
+ */
+struct Scalar
+{
+	uint32_t v[SCALAR_LIMBS];
+};
+
+int scalar_set_bytes(struct Scalar *, const unsigned char *);
+void scalar_get_bytes(unsigned char *, const struct Scalar *);
+void scalar_add(struct Scalar *, const struct Scalar *, const struct Scalar *);
+void scalar_neg(struct Scalar *, const struct Scalar *);
+void scalar_mul(struct Scalar *, const struct Scalar *, const struct Scalar *);
+void scalar_inv(struct Scalar *, const struct Scalar *);
+void scalar_cmov(struct Scalar *, const struct Scalar *, uint32_t);
+int scalar_is_zero(const struct Scalar *);
+int scalar_is_high(const struct Scalar *);
+
+#endif
@@ -0,0 +1,656 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <gmp.h>
+#include <assert.h>
+#include "schnorr.h"
+#include "curve.h"
+#include "ctmul.h"
+#include "scalar.h"
+#include "crypto.h"
+#include "error.h"
+
+#define SCHNORR_TAG_CHALLENGE  "BIP0340/challenge"
+#define SCHNORR_TAG_AUX        "BIP0340/aux"
+#define SCHNORR_TAG_NONCE      "BIP0340/nonce"
+#define SCHNORR_TAG_TWEAK      "TapTweak"
+
+/*
+ * A signature waiting in a batch.
+ */
+struct SchnorrEntry
+{
+	unsigned char sig[SCHNORR_SIG_LEN];
+	unsigned char msg[SCHNORR_MSG_LEN];
+	unsigned char pubkey[SCHNORR_PUBKEY_LEN];
+};
+
+/*
+ * BIP340 signatures over the shared curve code. The tagged hashes start
+ * from midstates made once here. Batches keep their signatures and the
+ * points and scalars of the combined check, grown as needed and kept,
+ * so like the rest of the context one batch per thread stops allocating
+ * once it has seen its largest size.
+ */
+struct Schnorr
+{
+	struct Curve curve;
+	CryptoHash work;
+	CryptoHash challenge;
+	CryptoHash aux;
+	CryptoHash nonce;
+	CryptoHash tweak;
+	struct CurveAffine p;
+	struct CurveAffine r;
+	struct CurveJacobian acc;
+	mpz_t k;
+	mpz_t e;
+	mpz_t s;
+	mpz_t a;
+	mpz_t sum;
+	struct SchnorrEntry *entries;
+	size_t count;
+	size_t entry_cap;
+	struct CurveAffine *points;
+	unsigned char (*scalars)[CURVE_SCALAR_LEN];
+	size_t point_cap;
+};
+
+static void schnorr_hash(Schnorr, unsigned char *, CryptoHash, const unsigned char *, const unsigned char *, const unsigned char *);
+static int schnorr_lift_pubkey(Schnorr, struct CurveAffine *, const unsigned char *);
+static int schnorr_reserve(Schnorr, size_t);
+static int schnorr_secret_point(unsigned char *, unsigned char *, const unsigned char *);
+
+int schnorr_new(Schnorr sc)
+{
+	size_t i;
+	CryptoHash *hashes[] = {&sc->work, &sc->challenge, &sc->aux, &sc->nonce, &sc->tweak};
+	const char *tags[] = {NULL, SCHNORR_TAG_CHALLENGE, SCHNORR_TAG_AUX, SCHNORR_TAG_NONCE, SCHNORR_TAG_TWEAK};
+
+	assert(sc);
+
+	memset(sc, 0, sizeof(*sc));
+
+	if (curve_new(&sc->curve) < 0)
+	{
+		return -1;
+	}
+	curve_affine_init(&sc->p);
+	curve_affine_init(&sc->r);
+	curve_jacobian_init(&sc->acc);
+	mpz_init(sc->k);
+	mpz_init(sc->e);
+	mpz_init(sc->s);
+	mpz_init(sc->a);
+	mpz_init(sc->sum);
+
+	for (i = 0; i < sizeof(hashes) / sizeof(*hashes); ++i)
+	{
+		*hashes[i] = malloc(crypto_hash_sizeof());
+		if (*hashes[i] == NULL)
+		{
+			error_log("Memory allocation error.");
+			schnorr_clear(sc);
+			return -1;
+		}
+		if ((tags[i] == NULL ? crypto_hash_open(*hashes[i], CRYPTO_SHA256) : crypto_tag_open(*hashes[i], tags[i])) < 0)
+		{
+			error_log("Could not open signature hash.");
+			free(*hashes[i]);
+			*hashes[i] = NULL;
+			schnorr_clear(sc);
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * The x-only public key of a 32 byte secret key. Returns 1, or -1 if
+ * the key is zero or not below the order.
+ */
+int schnorr_pubkey(Schnorr sc, unsigned char *pubkey, const unsigned char *seckey)
+{
+	unsigned char y[SCHNORR_SCALAR_LEN];
+
+	assert(sc);
+	assert(pubkey);
+	assert(seckey);
+
+	return schnorr_secret_point(pubkey, y, seckey);
+}
+
+/*
+ * BIP340 signing of a 32 byte message. The key is negated if its point
+ * has an odd y so that the x-only key stands for it, and likewise the
+ * nonce. aux is 32 bytes of auxiliary randomness mixed into the nonce,
+ * or NULL for none, which still gives a safe deterministic nonce.
+ * Returns 1, or -1 if the key is out of range.
+ *
+ * As with ECDSA, the key's and nonce's points are found in constant time
+ * and the arithmetic mod n is scalar.c's, so no secret goes through GMP.
+ */
+int schnorr_sign(Schnorr sc, unsigned char *sig, const unsigned char *msg, const unsigned char *seckey, const unsigned char *aux)
+{
+	size_t i;
+	unsigned char t[SCHNORR_SCALAR_LEN];
+	unsigned char px[SCHNORR_PUBKEY_LEN];
+	unsigned char y[SCHNORR_SCALAR_LEN];
+	unsigned char k[SCHNORR_SCALAR_LEN];
+	unsigned char e[SCHNORR_SCALAR_LEN];
+	static const unsigned char zero[SCHNORR_SCALAR_LEN];
+	struct Scalar sd, sk, se, neg;
+
+	assert(sc);
+	assert(sig);
+	assert(msg);
+	assert(seckey);
+
+	if (schnorr_secret_point(px, y, seckey) < 0)
+	{
+		return -1;
+	}
+
+	scalar_set_bytes(&sd, seckey);
+	scalar_neg(&neg, &sd);
+	scalar_cmov(&sd, &neg, y[SCHNORR_SCALAR_LEN - 1] & 1);
+
+	// t = d xor hash_aux(aux), rand = hash_nonce(t || P || m)
+	schnorr_hash(sc, t, sc->aux, (aux != NULL) ? aux : zero, NULL, NULL);
+	scalar_get_bytes(k, &sd);
+	for (i = 0; i < SCHNORR_SCALAR_LEN; ++i)
+	{
+		t[i] ^= k[i];
+	}
+	schnorr_hash(sc, k, sc->nonce, t, px, msg);
+
+	scalar_set_bytes(&sk, k);
+	if (scalar_is_zero(&sk))
+	{
+		// Probability 2^-256; BIP340 fails rather than retry.
+		memset(&sd, 0, sizeof(sd));
+		error_log("Signing nonce is zero.");
+		return -1;
+	}
+	scalar_get_bytes(k, &sk);
+
+	if (ctmul_generator(sig, y, k) < 0)
+	{
+		memset(k, 0, sizeof(k));
+		memset(&sk, 0, sizeof(sk));
+		memset(&sd, 0, sizeof(sd));
+		return -1;
+	}
+	scalar_neg(&neg, &sk);
+	scalar_cmov(&sk, &neg, y[SCHNORR_SCALAR_LEN - 1] & 1);
+
+	// s = k + e*d mod n
+	schnorr_hash(sc, e, sc->challenge, sig, px, msg);
+	scalar_set_bytes(&se, e);
+	scalar_mul(&se, &se, &sd);
+	scalar_add(&se, &se, &sk);
+	scalar_get_bytes(sig + SCHNORR_SCALAR_LEN, &se);
+
+	memset(t, 0, sizeof(t));
+	memset(k, 0, sizeof(k));
+	memset(&sd, 0, sizeof(sd));
+	memset(&sk, 0, sizeof(sk));
+	memset(&neg, 0, sizeof(neg));
+
+	return 1;
+}
+
+/*
+ * BIP340 verification of a 64 byte signature on a 32 byte message by a
+ * 32 byte x-only key: R = s*G - e*P must not be infinity, must have an
+ * even y and must have r for its x. Returns 1 if the signature is valid
+ * and 0 if it isn't, or -1 on a failure to allocate.
+ */
+int schnorr_verify(Schnorr sc, const unsigned char *sig, const unsigned char *msg, const unsigned char *pubkey)
+{
+	unsigned char e[SCHNORR_SCALAR_LEN];
+	Curve c;
+
+	assert(sc);
+	assert(sig);
+	assert(msg);
+	assert(pubkey);
+
+	c = &sc->curve;
+
+	if (!schnorr_lift_pubkey(sc, &sc->p, pubkey))
+	{
+		return 0;
+	}
+
+	mpz_import(sc->a, SCHNORR_SCALAR_LEN, 1, 1, 1, 0, sig);
+	mpz_import(sc->s, SCHNORR_SCALAR_LEN, 1, 1, 1, 0, sig + SCHNORR_SCALAR_LEN);
+	if (mpz_cmp(sc->a, c->p) >= 0 || mpz_cmp(sc->s, c->n) >= 0)
+	{
+		return 0;
+	}
+
+	schnorr_hash(sc, e, sc->challenge, sig, pubkey, msg);
+	mpz_import(sc->e, SCHNORR_SCALAR_LEN, 1, 1, 1, 0, e);
+	mpz_mod(sc->e, sc->e, c->n);
+	if (mpz_sgn(sc->e) != 0)
+	{
+		mpz_sub(sc->e, c->n, sc->e);
+	}
+
+	if (curve_mul_double(c, &sc->acc, sc->s, &sc->p, sc->e) < 0)
+	{
+		return -1;
+	}
+	if (sc->acc.infinity)
+	{
+		return 0;
+	}
+	curve_to_affine(c, &sc->r, &sc->acc);
+
+	return !mpz_odd_p(sc->r.y) && mpz_cmp(sc->r.x, sc->a) == 0;
+}
+
+/*
+ * BIP341's commitment check: that the output key, an x-only key with
+ * the given y parity, is internal_key + tweak*G. Returns 1 if it is and
+ * 0 if it isn't, or -1 on a failure to allocate.
+ */
+int schnorr_check_tweak(Schnorr sc, const unsigned char *output_key, int parity, const unsigned char *internal_key, const unsigned char *tweak)
+{
+	Curve c;
+
+	assert(sc);
+	assert(output_key);
+	assert(internal_key);
+	assert(tweak);
+
+	c = &sc->curve;
+
+	mpz_import(sc->a, SCHNORR_SCALAR_LEN, 1, 1, 1, 0, tweak);
+	if (mpz_cmp(sc->a, c->n) >= 0)
+	{
+		return 0;
+	}
+	if (!schnorr_lift_pubkey(sc, &sc->p, internal_key))
+	{
+		return 0;
+	}
+
+	if (curve_mul_generator(c, &sc->acc, tweak) < 0)
+	{
+		return -1;
+	}
+	curve_add_affine(c, &sc->acc, &sc->p);
+	if (sc->acc.infinity)
+	{
+		return 0;
+	}
+	curve_to_affine(c, &sc->r, &sc->acc);
+
+	mpz_import(sc->a, SCHNORR_PUBKEY_LEN, 1, 1, 1, 0, output_key);
+
+	return mpz_cmp(sc->r.x, sc->a) == 0 && (int)mpz_odd_p(sc->r.y) == (parity != 0);
+}
+
+/*
+ * BIP341's output key for an x-only internal key and the merkle root of
+ * its scripts, or NULL for an output with no scripts as in BIP86:
+ * internal_key + hash_TapTweak(internal_key || merkle_root)*G. Writes
+ * the x-only output key and, if parity isn't NULL, the parity of its y.
+ * Returns 1, 0 if the internal key isn't on the curve or the tweak is
+ * out of range, or -1 on a failure to allocate.
+ */
+int schnorr_taproot_output(Schnorr sc, unsigned char *output_key, int *parity, const unsigned char *internal_key, const unsigned char *merkle_root)
+{
+	unsigned char tweak[SCHNORR_SCALAR_LEN];
+	Curve c;
+
+	assert(sc);
+	assert(output_key);
+	assert(internal_key);
+
+	c = &sc->curve;
+
+	schnorr_hash(sc, tweak, sc->tweak, internal_key, merkle_root, NULL);
+	mpz_import(sc->a, SCHNORR_SCALAR_LEN, 1, 1, 1, 0, tweak);
+	if (mpz_cmp(sc->a, c->n) >= 0)
+	{
+		return 0;
+	}
+	if (!schnorr_lift_pubkey(sc, &sc->p, internal_key))
+	{
+		return 0;
+	}
+
+	if (curve_mul_generator(c, &sc->acc, tweak) < 0)
+	{
+		return -1;
+	}
+	curve_add_affine(c, &sc->acc, &sc->p);
+	if (sc->acc.infinity)
+	{
+		return 0;
+	}
+	curve_to_affine(c, &sc->r, &sc->acc);
+
+	curve_export_scalar(output_key, sc->r.x);
+	if (parity != NULL)
+	{
+		*parity = mpz_odd_p(sc->r.y);
+	}
+
+	return 1;
+}
+
+/*
+ * Queue a signature for schnorr_batch_verify(). The arguments are
+ * copied. Returns 1, or -1 on a failure to allocate.
+ */
+int schnorr_batch_add(Schnorr sc, const unsigned char *sig, const unsigned char *msg, const unsigned char *pubkey)
+{
+	size_t cap;
+	struct SchnorrEntry *tmp;
+
+	assert(sc);
+	assert(sig);
+	assert(msg);
+	assert(pubkey);
+
+	if (sc->count == sc->entry_cap)
+	{
+		cap = (sc->entry_cap > 0) ? sc->entry_cap * 2 : 64;
+		tmp = realloc(sc->entries, sizeof(*sc->entries) * cap);
+		if (tmp == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		sc->entries = tmp;
+		sc->entry_cap = cap;
+	}
+
+	memcpy(sc->entries[sc->count].sig, sig, SCHNORR_SIG_LEN);
+	memcpy(sc->entries[sc->count].msg, msg, SCHNORR_MSG_LEN);
+	memcpy(sc->entries[sc->count].pubkey, pubkey, SCHNORR_PUBKEY_LEN);
+	sc->count++;
+
+	return 1;
+}
+
+/*
+ * Check every queued signature at once, then empty the batch. Each one
+ * holds when s_i*G = R_i + e_i*P_i, so with random a_i all of them hold,
+ * but for a negligible chance, when
+ *
+ *   sum(a_i*R_i) + sum(a_i*e_i*P_i) - sum(a_i*s_i)*G = infinity,
+ *
+ * one multi-scalar multiplication over 2N + 1 points in place of N
+ * separate ones. a_1 is 1 and the rest come from a hash of the whole
+ * batch, so nobody choosing signatures can know them in advance.
+ * Returns 1 if all are valid and 0 if any isn't, without saying which;
+ * check them one at a time for that. Returns -1 on a failure to
+ * allocate.
+ */
+int schnorr_batch_verify(Schnorr sc)
+{
+	int r;
+	size_t i, count;
+	uint32_t index;
+	unsigned char seed[CRYPTO_SHA256_LEN];
+	unsigned char buffer[CRYPTO_SHA256_LEN + sizeof(index)];
+	unsigned char e[SCHNORR_SCALAR_LEN];
+	struct SchnorrEntry *entry;
+	Curve c;
+
+	assert(sc);
+
+	c = &sc->curve;
+	count = sc->count;
+	sc->count = 0;
+
+	if (count == 0)
+	{
+		return 1;
+	}
+	if (schnorr_reserve(sc, count * 2 + 1) < 0)
+	{
+		return -1;
+	}
+
+	crypto_hash_write(sc->work, (const unsigned char *)sc->entries, sizeof(*sc->entries) * count);
+	crypto_hash_final(seed, sc->work);
+	memcpy(buffer, seed, sizeof(seed));
+
+	mpz_set_ui(sc->sum, 0);
+	for (i = 0; i < count; ++i)
+	{
+		entry = &sc->entries[i];
+
+		if (!schnorr_lift_pubkey(sc, &sc->points[i * 2 + 2], entry->pubkey))
+		{
+			return 0;
+		}
+		mpz_import(sc->a, SCHNORR_SCALAR_LEN, 1, 1, 1, 0, entry->sig);
+		if (!curve_lift_x(c, &sc->points[i * 2 + 1], sc->a, 0))
+		{
+			return 0;
+		}
+		mpz_import(sc->s, SCHNORR_SCALAR_LEN, 1, 1, 1, 0, entry->sig + SCHNORR_SCALAR_LEN);
+		if (mpz_cmp(sc->s, c->n) >= 0)
+		{
+			return 0;
+		}
+
+		if (i == 0)
+		{
+			mpz_set_ui(sc->a, 1);
+		}
+		else
+		{
+			index = (uint32_t)i;
+			buffer[CRYPTO_SHA256_LEN + 0] = (unsigned char)(index & 0xff);
+			buffer[CRYPTO_SHA256_LEN + 1] = (unsigned char)((index >> 8) & 0xff);
+			buffer[CRYPTO_SHA256_LEN + 2] = (unsigned char)((index >> 16) & 0xff);
+			buffer[CRYPTO_SHA256_LEN + 3] = (unsigned char)((index >> 24) & 0xff);
+			crypto_hash_write(sc->work, buffer, sizeof(buffer));
+			crypto_hash_final(e, sc->work);
+			mpz_import(sc->a, SCHNORR_SCALAR_LEN, 1, 1, 1, 0, e);
+			mpz_mod(sc->a, sc->a, c->n);
+		}
+
+		schnorr_hash(sc, e, sc->challenge, entry->sig, entry->pubkey, entry->msg);
+		mpz_import(sc->e, SCHNORR_SCALAR_LEN, 1, 1, 1, 0, e);
+		mpz_mul(sc->e, sc->e, sc->a);
+		mpz_mod(sc->e, sc->e, c->n);
+
+		curve_export_scalar(sc->scalars[i * 2 + 1], sc->a);
+		curve_export_scalar(sc->scalars[i * 2 + 2], sc->e);
+
+		mpz_addmul(sc->sum, sc->a, sc->s);
+	}
+
+	mpz_mod(sc->sum, sc->sum, c->n);
+	if (mpz_sgn(sc->sum) != 0)
+	{
+		mpz_sub(sc->sum, c->n, sc->sum);
+	}
+	curve_export_scalar(sc->scalars[0], sc->sum);
+
+	r = curve_msm(c, &sc->acc, sc->points, (const unsigned char (*)[CURVE_SCALAR_LEN])sc->scalars, count * 2 + 1);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	return sc->acc.infinity;
+}
+
+size_t schnorr_batch_get_count(Schnorr sc)
+{
+	assert(sc);
+
+	return sc->count;
+}
+
+void schnorr_batch_reset(Schnorr sc)
+{
+	assert(sc);
+
+	sc->count = 0;
+}
+
+void schnorr_clear(Schnorr sc)
+{
+	size_t i;
+	CryptoHash hashes[5];
+
+	assert(sc);
+
+	curve_clear(&sc->curve);
+	curve_affine_clear(&sc->p);
+	curve_affine_clear(&sc->r);
+	curve_jacobian_clear(&sc->acc);
+	mpz_clear(sc->k);
+	mpz_clear(sc->e);
+	mpz_clear(sc->s);
+	mpz_clear(sc->a);
+	mpz_clear(sc->sum);
+
+	hashes[0] = sc->work;
+	hashes[1] = sc->challenge;
+	hashes[2] = sc->aux;
+	hashes[3] = sc->nonce;
+	hashes[4] = sc->tweak;
+	for (i = 0; i < sizeof(hashes) / sizeof(*hashes); ++i)
+	{
+		if (hashes[i] != NULL)
+		{
+			crypto_hash_close(hashes[i]);
+			free(hashes[i]);
+		}
+	}
+
+	for (i = 0; i < sc->point_cap; ++i)
+	{
+		curve_affine_clear(&sc->points[i]);
+	}
+	free(sc->points);
+	free(sc->scalars);
+	free(sc->entries);
+
+	memset(sc, 0, sizeof(*sc));
+}
+
+size_t schnorr_sizeof(void)
+{
+	return sizeof(struct Schnorr);
+}
+
+/*
+ * A tagged hash of up to three 32 byte parts, started from the tag's
+ * midstate. Unused parts are NULL.
+ */
+static void schnorr_hash(Schnorr sc, unsigned char *output, CryptoHash tag, const unsigned char *a, const unsigned char *b, const unsigned char *c)
+{
+	crypto_hash_restore(sc->work, tag);
+	crypto_hash_write(sc->work, a, SCHNORR_SCALAR_LEN);
+	if (b != NULL)
+	{
+		crypto_hash_write(sc->work, b, SCHNORR_SCALAR_LEN);
+	}
+	if (c != NULL)
+	{
+		crypto_hash_write(sc->work, c, SCHNORR_SCALAR_LEN);
+	}
+	crypto_hash_final(output, sc->work);
+}
+
+/*
+ * An x-only key is the point with that x and an even y.
+ */
+static int schnorr_lift_pubkey(Schnorr sc, struct CurveAffine *point, const unsigned char *pubkey)
+{
+	mpz_import(sc->k, SCHNORR_PUBKEY_LEN, 1, 1, 1, 0, pubkey);
+
+	return curve_lift_x(&sc->curve, point, sc->k, 0);
+}
+
+/*
+ * Room for count points and scalars in the batch's check, the first
+ * point being G.
+ */
+static int schnorr_reserve(Schnorr sc, size_t count)
+{
+	size_t i, cap;
+	struct CurveAffine *points;
+	unsigned char (*scalars)[CURVE_SCALAR_LEN];
+
+	if (count <= sc->point_cap)
+	{
+		return 1;
+	}
+
+	cap = (sc->point_cap > 0) ? sc->point_cap : 1;
+	while (cap < count)
+	{
+		cap *= 2;
+	}
+
+	scalars = realloc(sc->scalars, sizeof(*sc->scalars) * cap);
+	if (scalars == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	sc->scalars = scalars;
+
+	points = realloc(sc->points, sizeof(*sc->points) * cap);
+	if (points == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	sc->points = points;
+	for (i = sc->point_cap; i < cap; ++i)
+	{
+		curve_affine_init(&sc->points[i]);
+	}
+	if (sc->point_cap == 0)
+	{
+		mpz_set(sc->points[0].x, sc->curve.g.x);
+		mpz_set(sc->points[0].y, sc->curve.g.y);
+		sc->points[0].infinity = 0;
+	}
+	sc->point_cap = cap;
+
+	return 1;
+}
+
+/*
+ * x and y of d*G for a secret d, in constant time. Returns 1, or -1 if
+ * d is zero or not below the order.
+ */
+static int schnorr_secret_point(unsigned char *x, unsigned char *y, const unsigned char *seckey)
+{
+	int invalid;
+	struct Scalar d;
+
+	invalid = scalar_set_bytes(&d, seckey) | scalar_is_zero(&d);
+	memset(&d, 0, sizeof(d));
+	if (invalid)
+	{
+		error_log("Private key is out of range.");
+		return -1;
+	}
+
+	return ctmul_generator(x, y, seckey);
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef SCHNORR_H
+#define SCHNORR_H 1
+
+#include <stddef.h>
+
+#define SCHNORR_SIG_LEN     64
+#define SCHNORR_PUBKEY_LEN  32
+#define SCHNORR_MSG_LEN     32
+#define SCHNORR_SCALAR_LEN  32
+
+typedef struct Schnorr *Schnorr;
+
+int schnorr_new(Schnorr);
+int schnorr_pubkey(Schnorr, unsigned char *, const unsigned char *);
+int schnorr_sign(Schnorr, unsigned char *, const unsigned char *, const unsigned char *, const unsigned char *);
+int schnorr_verify(Schnorr, const unsigned char *, const unsigned char *, const unsigned char *);
+int schnorr_check_tweak(Schnorr, const unsigned char *, int, const unsigned char *, const unsigned char *);
+int schnorr_taproot_output(Schnorr, unsigned char *, int *, const unsigned char *, const unsigned char *);
+int schnorr_batch_add(Schnorr, const unsigned char *, const unsigned char *, const unsigned char *);
+int schnorr_batch_verify(Schnorr);
+size_t schnorr_batch_get_count(Schnorr);
+void schnorr_batch_reset(Schnorr);
+void schnorr_clear(Schnorr);
+size_t schnorr_sizeof(void);
+
+#endif
@@ -9,289 +9,649 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <assert.h>
 #include "script.h"
+#include "hex.h"
 #include "error.h"
 
-#define MAX_OPS_PER_SCRIPT 201
+#define SCRIPT_WORD(w)              { w, sizeof(w) - 1 }
+
 
 typedef struct
 {
 	const char *word;
-	// placeholder for function pointer
+	size_t len;
 } Words;
 
 Words words[256] = {
-	[0x00].word = "OP_FALSE",
-	[0x01].word = "NA",
-	[0x02].word = "NA",
-	[0x03].word = "NA",
-	[0x04].word = "NA",
-	[0x05].word = "NA",
-	[0x06].word = "NA",
-	[0x07].word = "NA",
-	[0x08].word = "NA",
-	[0x09].word = "NA",
-	[0x0a].word = "NA",
-	[0x0b].word = "NA",
-	[0x0c].word = "NA",
-	[0x0d].word = "NA",
-	[0x0e].word = "NA",
-	[0x0f].word = "NA",
-	[0x10].word = "NA",
-	[0x11].word = "NA",
-	[0x12].word = "NA",
-	[0x13].word = "NA",
-	[0x14].word = "NA",
-	[0x15].word = "NA",
-	[0x16].word = "NA",
-	[0x17].word = "NA",
-	[0x18].word = "NA",
-	[0x19].word = "NA",
-	[0x1a].word = "NA",
-	[0x1b].word = "NA",
-	[0x1c].word = "NA",
-	[0x1d].word = "NA",
-	[0x1e].word = "NA",
-	[0x1f].word = "NA",
-	[0x20].word = "NA",
-	[0x21].word = "NA",
-	[0x22].word = "NA",
-	[0x23].word = "NA",
-	[0x24].word = "NA",
-	[0x25].word = "NA",
-	[0x26].word = "NA",
-	[0x27].word = "NA",
-	[0x28].word = "NA",
-	[0x29].word = "NA",
-	[0x2a].word = "NA",
-	[0x2b].word = "NA",
-	[0x2c].word = "NA",
-	[0x2d].word = "NA",
-	[0x2e].word = "NA",
-	[0x2f].word = "NA",
-	[0x30].word = "NA",
-	[0x31].word = "NA",
-	[0x32].word = "NA",
-	[0x33].word = "NA",
-	[0x34].word = "NA",
-	[0x35].word = "NA",
-	[0x36].word = "NA",
-	[0x37].word = "NA",
-	[0x38].word = "NA",
-	[0x39].word = "NA",
-	[0x3a].word = "NA",
-	[0x3b].word = "NA",
-	[0x3c].word = "NA",
-	[0x3d].word = "NA",
-	[0x3e].word = "NA",
-	[0x3f].word = "NA",
-	[0x40].word = "NA",
-	[0x41].word = "NA",
-	[0x42].word = "NA",
-	[0x43].word = "NA",
-	[0x44].word = "NA",
-	[0x45].word = "NA",
-	[0x46].word = "NA",
-	[0x47].word = "NA",
-	[0x48].word = "NA",
-	[0x49].word = "NA",
-	[0x4a].word = "NA",
-	[0x4b].word = "NA",
-	[0x4c].word = "OP_PUSHDATA1",
-	[0x4d].word = "OP_PUSHDATA2",
-	[0x4e].word = "OP_PUSHDATA4",
-	[0x4f].word = "OP_1NEGATE",
-	[0x50].word = "OP_RESERVED",
-	[0x51].word = "OP_TRUE",
-	[0x52].word = "OP_2",
-	[0x53].word = "OP_3",
-	[0x54].word = "OP_4",
-	[0x55].word = "OP_5",
-	[0x56].word = "OP_6",
-	[0x57].word = "OP_7",
-	[0x58].word = "OP_8",
-	[0x59].word = "OP_9",
-	[0x5a].word = "OP_10",
-	[0x5b].word = "OP_11",
-	[0x5c].word = "OP_12",
-	[0x5d].word = "OP_13",
-	[0x5e].word = "OP_14",
-	[0x5f].word = "OP_15",
-	[0x60].word = "OP_16",
-	[0x61].word = "OP_NOP",
-	[0x62].word = "OP_VER",
-	[0x63].word = "OP_IF",
-	[0x64].word = "OP_NOTIF",
-	[0x65].word = "OP_VERIF",
-	[0x66].word = "OP_VERNOTIF",
-	[0x67].word = "OP_ELSE",
-	[0x68].word = "OP_ENDIF",
-	[0x69].word = "OP_VERIFY",
-	[0x6a].word = "OP_RETURN",
-	[0x6b].word = "OP_TOALTSTACK",
-	[0x6c].word = "OP_FROMALTSTACK",
-	[0x6d].word = "OP_2DROP",
-	[0x6e].word = "OP_2DUP",
-	[0x6f].word = "OP_3DUP",
-	[0x70].word = "OP_2OVER",
-	[0x71].word = "OP_2ROT",
-	[0x72].word = "OP_2SWAP",
-	[0x73].word = "OP_IFDUP",
-	[0x74].word = "OP_DEPTH",
-	[0x75].word = "OP_DROP",
-	[0x76].word = "OP_DUP",
-	[0x77].word = "OP_NIP",
-	[0x78].word = "OP_OVER",
-	[0x79].word = "OP_PICK",
-	[0x7a].word = "OP_ROLL",
-	[0x7b].word = "OP_ROT",
-	[0x7c].word = "OP_SWAP",
-	[0x7d].word = "OP_TUCK",
-	[0x7e].word = "OP_CAT",
-	[0x7f].word = "OP_SUBSTR",
-	[0x80].word = "OP_LEFT",
-	[0x81].word = "OP_RIGHT",
-	[0x82].word = "OP_SIZE",
-	[0x83].word = "OP_INVERT",
-	[0x84].word = "OP_AND",
-	[0x85].word = "OP_OR",
-	[0x86].word = "OP_XOR",
-	[0x87].word = "OP_EQUAL",
-	[0x88].word = "OP_EQUALVERIFY",
-	[0x89].word = "OP_RESERVED1",
-	[0x8a].word = "OP_RESERVED2",
-	[0x8b].word = "OP_1ADD",
-	[0x8c].word = "OP_1SUB",
-	[0x8d].word = "OP_2MUL",
-	[0x8e].word = "OP_2DIV",
-	[0x8f].word = "OP_NEGATE",
-	[0x90].word = "OP_ABS",
-	[0x91].word = "OP_NOT",
-	[0x92].word = "OP_0NOTEQUAL",
-	[0x93].word = "OP_ADD",
-	[0x94].word = "OP_SUB",
-	[0x95].word = "OP_MUL",
-	[0x96].word = "OP_DIV",
-	[0x97].word = "OP_MOD",
-	[0x98].word = "OP_LSHIFT",
-	[0x99].word = "OP_RSHIFT",
-	[0x9a].word = "OP_BOOLAND",
-	[0x9b].word = "OP_BOOLOR",
-	[0x9c].word = "OP_NUMEQUAL",
-	[0x9d].word = "OP_NUMEQUALVERIFY",
-	[0x9e].word = "OP_NUMNOTEQUAL",
-	[0x9f].word = "OP_LESSTHAN",
-	[0xa0].word = "OP_GREATERTHAN",
-	[0xa1].word = "OP_LESSTHANOREQUAL",
-	[0xa2].word = "OP_GREATERTHANOREQUAL",
-	[0xa3].word = "OP_MIN",
-	[0xa4].word = "OP_MAX",
-	[0xa5].word = "OP_WITHIN",
-	[0xa6].word = "OP_RIPEMD160",
-	[0xa7].word = "OP_SHA1",
-	[0xa8].word = "OP_SHA256",
-	[0xa9].word = "OP_HASH160",
-	[0xaa].word = "OP_HASH256",
-	[0xab].word = "OP_CODESEPARATOR",
-	[0xac].word = "OP_CHECKSIG",
-	[0xad].word = "OP_CHECKSIGVERIFY",
-	[0xae].word = "OP_CHECKMULTISIG",
-	[0xaf].word = "OP_CHECKMULTISIGVERIFY",
-	[0xb0].word = "OP_NOP1",
-	[0xb1].word = "OP_CHECKLOCKTIMEVERIFY ",
-	[0xb2].word = "OP_CHECKSEQUENCEVERIFY ",
-	[0xb3].word = "OP_NOP4",
-	[0xb4].word = "OP_NOP5",
-	[0xb5].word = "OP_NOP6",
-	[0xb6].word = "OP_NOP7",
-	[0xb7].word = "OP_NOP8",
-	[0xb8].word = "OP_NOP9",
-	[0xb9].word = "OP_NOP10",
+	[0x00] = SCRIPT_WORD("OP_FALSE"),
+	[0x01] = SCRIPT_WORD("NA"),
+	[0x02] = SCRIPT_WORD("NA"),
+	[0x03] = SCRIPT_WORD("NA"),
+	[0x04] = SCRIPT_WORD("NA"),
+	[0x05] = SCRIPT_WORD("NA"),
+	[0x06] = SCRIPT_WORD("NA"),
+	[0x07] = SCRIPT_WORD("NA"),
+	[0x08] = SCRIPT_WORD("NA"),
+	[0x09] = SCRIPT_WORD("NA"),
+	[0x0a] = SCRIPT_WORD("NA"),
+	[0x0b] = SCRIPT_WORD("NA"),
+	[0x0c] = SCRIPT_WORD("NA"),
+	[0x0d] = SCRIPT_WORD("NA"),
+	[0x0e] = SCRIPT_WORD("NA"),
+	[0x0f] = SCRIPT_WORD("NA"),
+	[0x10] = SCRIPT_WORD("NA"),
+	[0x11] = SCRIPT_WORD("NA"),
+	[0x12] = SCRIPT_WORD("NA"),
+	[0x13] = SCRIPT_WORD("NA"),
+	[0x14] = SCRIPT_WORD("NA"),
+	[0x15] = SCRIPT_WORD("NA"),
+	[0x16] = SCRIPT_WORD("NA"),
+	[0x17] = SCRIPT_WORD("NA"),
+	[0x18] = SCRIPT_WORD("NA"),
+	[0x19] = SCRIPT_WORD("NA"),
+	[0x1a] = SCRIPT_WORD("NA"),
+	[0x1b] = SCRIPT_WORD("NA"),
+	[0x1c] = SCRIPT_WORD("NA"),
+	[0x1d] = SCRIPT_WORD("NA"),
+	[0x1e] = SCRIPT_WORD("NA"),
+	[0x1f] = SCRIPT_WORD("NA"),
+	[0x20] = SCRIPT_WORD("NA"),
+	[0x21] = SCRIPT_WORD("NA"),
+	[0x22] = SCRIPT_WORD("NA"),
+	[0x23] = SCRIPT_WORD("NA"),
+	[0x24] = SCRIPT_WORD("NA"),
+	[0x25] = SCRIPT_WORD("NA"),
+	[0x26] = SCRIPT_WORD("NA"),
+	[0x27] = SCRIPT_WORD("NA"),
+	[0x28] = SCRIPT_WORD("NA"),
+	[0x29] = SCRIPT_WORD("NA"),
+	[0x2a] = SCRIPT_WORD("NA"),
+	[0x2b] = SCRIPT_WORD("NA"),
+	[0x2c] = SCRIPT_WORD("NA"),
+	[0x2d] = SCRIPT_WORD("NA"),
+	[0x2e] = SCRIPT_WORD("NA"),
+	[0x2f] = SCRIPT_WORD("NA"),
+	[0x30] = SCRIPT_WORD("NA"),
+	[0x31] = SCRIPT_WORD("NA"),
+	[0x32] = SCRIPT_WORD("NA"),
+	[0x33] = SCRIPT_WORD("NA"),
+	[0x34] = SCRIPT_WORD("NA"),
+	[0x35] = SCRIPT_WORD("NA"),
+	[0x36] = SCRIPT_WORD("NA"),
+	[0x37] = SCRIPT_WORD("NA"),
+	[0x38] = SCRIPT_WORD("NA"),
+	[0x39] = SCRIPT_WORD("NA"),
+	[0x3a] = SCRIPT_WORD("NA"),
+	[0x3b] = SCRIPT_WORD("NA"),
+	[0x3c] = SCRIPT_WORD("NA"),
+	[0x3d] = SCRIPT_WORD("NA"),
+	[0x3e] = SCRIPT_WORD("NA"),
+	[0x3f] = SCRIPT_WORD("NA"),
+	[0x40] = SCRIPT_WORD("NA"),
+	[0x41] = SCRIPT_WORD("NA"),
+	[0x42] = SCRIPT_WORD("NA"),
+	[0x43] = SCRIPT_WORD("NA"),
+	[0x44] = SCRIPT_WORD("NA"),
+	[0x45] = SCRIPT_WORD("NA"),
+	[0x46] = SCRIPT_WORD("NA"),
+	[0x47] = SCRIPT_WORD("NA"),
+	[0x48] = SCRIPT_WORD("NA"),
+	[0x49] = SCRIPT_WORD("NA"),
+	[0x4a] = SCRIPT_WORD("NA"),
+	[0x4b] = SCRIPT_WORD("NA"),
+	[0x4c] = SCRIPT_WORD("OP_PUSHDATA1"),
+	[0x4d] = SCRIPT_WORD("OP_PUSHDATA2"),
+	[0x4e] = SCRIPT_WORD("OP_PUSHDATA4"),
+	[0x4f] = SCRIPT_WORD("OP_1NEGATE"),
+	[0x50] = SCRIPT_WORD("OP_RESERVED"),
+	[0x51] = SCRIPT_WORD("OP_TRUE"),
+	[0x52] = SCRIPT_WORD("OP_2"),
+	[0x53] = SCRIPT_WORD("OP_3"),
+	[0x54] = SCRIPT_WORD("OP_4"),
+	[0x55] = SCRIPT_WORD("OP_5"),
+	[0x56] = SCRIPT_WORD("OP_6"),
+	[0x57] = SCRIPT_WORD("OP_7"),
+	[0x58] = SCRIPT_WORD("OP_8"),
+	[0x59] = SCRIPT_WORD("OP_9"),
+	[0x5a] = SCRIPT_WORD("OP_10"),
+	[0x5b] = SCRIPT_WORD("OP_11"),
+	[0x5c] = SCRIPT_WORD("OP_12"),
+	[0x5d] = SCRIPT_WORD("OP_13"),
+	[0x5e] = SCRIPT_WORD("OP_14"),
+	[0x5f] = SCRIPT_WORD("OP_15"),
+	[0x60] = SCRIPT_WORD("OP_16"),
+	[0x61] = SCRIPT_WORD("OP_NOP"),
+	[0x62] = SCRIPT_WORD("OP_VER"),
+	[0x63] = SCRIPT_WORD("OP_IF"),
+	[0x64] = SCRIPT_WORD("OP_NOTIF"),
+	[0x65] = SCRIPT_WORD("OP_VERIF"),
+	[0x66] = SCRIPT_WORD("OP_VERNOTIF"),
+	[0x67] = SCRIPT_WORD("OP_ELSE"),
+	[0x68] = SCRIPT_WORD("OP_ENDIF"),
+	[0x69] = SCRIPT_WORD("OP_VERIFY"),
+	[0x6a] = SCRIPT_WORD("OP_RETURN"),
+	[0x6b] = SCRIPT_WORD("OP_TOALTSTACK"),
+	[0x6c] = SCRIPT_WORD("OP_FROMALTSTACK"),
+	[0x6d] = SCRIPT_WORD("OP_2DROP"),
+	[0x6e] = SCRIPT_WORD("OP_2DUP"),
+	[0x6f] = SCRIPT_WORD("OP_3DUP"),
+	[0x70] = SCRIPT_WORD("OP_2OVER"),
+	[0x71] = SCRIPT_WORD("OP_2ROT"),
+	[0x72] = SCRIPT_WORD("OP_2SWAP"),
+	[0x73] = SCRIPT_WORD("OP_IFDUP"),
+	[0x74] = SCRIPT_WORD("OP_DEPTH"),
+	[0x75] = SCRIPT_WORD("OP_DROP"),
+	[0x76] = SCRIPT_WORD("OP_DUP"),
+	[0x77] = SCRIPT_WORD("OP_NIP"),
+	[0x78] = SCRIPT_WORD("OP_OVER"),
+	[0x79] = SCRIPT_WORD("OP_PICK"),
+	[0x7a] = SCRIPT_WORD("OP_ROLL"),
+	[0x7b] = SCRIPT_WORD("OP_ROT"),
+	[0x7c] = SCRIPT_WORD("OP_SWAP"),
+	[0x7d] = SCRIPT_WORD("OP_TUCK"),
+	[0x7e] = SCRIPT_WORD("OP_CAT"),
+	[0x7f] = SCRIPT_WORD("OP_SUBSTR"),
+	[0x80] = SCRIPT_WORD("OP_LEFT"),
+	[0x81] = SCRIPT_WORD("OP_RIGHT"),
+	[0x82] = SCRIPT_WORD("OP_SIZE"),
+	[0x83] = SCRIPT_WORD("OP_INVERT"),
+	[0x84] = SCRIPT_WORD("OP_AND"),
+	[0x85] = SCRIPT_WORD("OP_OR"),
+	[0x86] = SCRIPT_WORD("OP_XOR"),
+	[0x87] = SCRIPT_WORD("OP_EQUAL"),
+	[0x88] = SCRIPT_WORD("OP_EQUALVERIFY"),
+	[0x89] = SCRIPT_WORD("OP_RESERVED1"),
+	[0x8a] = SCRIPT_WORD("OP_RESERVED2"),
+	[0x8b] = SCRIPT_WORD("OP_1ADD"),
+	[0x8c] = SCRIPT_WORD("OP_1SUB"),
+	[0x8d] = SCRIPT_WORD("OP_2MUL"),
+	[0x8e] = SCRIPT_WORD("OP_2DIV"),
+	[0x8f] = SCRIPT_WORD("OP_NEGATE"),
+	[0x90] = SCRIPT_WORD("OP_ABS"),
+	[0x91] = SCRIPT_WORD("OP_NOT"),
+	[0x92] = SCRIPT_WORD("OP_0NOTEQUAL"),
+	[0x93] = SCRIPT_WORD("OP_ADD"),
+	[0x94] = SCRIPT_WORD("OP_SUB"),
+	[0x95] = SCRIPT_WORD("OP_MUL"),
+	[0x96] = SCRIPT_WORD("OP_DIV"),
+	[0x97] = SCRIPT_WORD("OP_MOD"),
+	[0x98] = SCRIPT_WORD("OP_LSHIFT"),
+	[0x99] = SCRIPT_WORD("OP_RSHIFT"),
+	[0x9a] = SCRIPT_WORD("OP_BOOLAND"),
+	[0x9b] = SCRIPT_WORD("OP_BOOLOR"),
+	[0x9c] = SCRIPT_WORD("OP_NUMEQUAL"),
+	[0x9d] = SCRIPT_WORD("OP_NUMEQUALVERIFY"),
+	[0x9e] = SCRIPT_WORD("OP_NUMNOTEQUAL"),
+	[0x9f] = SCRIPT_WORD("OP_LESSTHAN"),
+	[0xa0] = SCRIPT_WORD("OP_GREATERTHAN"),
+	[0xa1] = SCRIPT_WORD("OP_LESSTHANOREQUAL"),
+	[0xa2] = SCRIPT_WORD("OP_GREATERTHANOREQUAL"),
+	[0xa3] = SCRIPT_WORD("OP_MIN"),
+	[0xa4] = SCRIPT_WORD("OP_MAX"),
+	[0xa5] = SCRIPT_WORD("OP_WITHIN"),
+	[0xa6] = SCRIPT_WORD("OP_RIPEMD160"),
+	[0xa7] = SCRIPT_WORD("OP_SHA1"),
+	[0xa8] = SCRIPT_WORD("OP_SHA256"),
+	[0xa9] = SCRIPT_WORD("OP_HASH160"),
+	[0xaa] = SCRIPT_WORD("OP_HASH256"),
+	[0xab] = SCRIPT_WORD("OP_CODESEPARATOR"),
+	[0xac] = SCRIPT_WORD("OP_CHECKSIG"),
+	[0xad] = SCRIPT_WORD("OP_CHECKSIGVERIFY"),
+	[0xae] = SCRIPT_WORD("OP_CHECKMULTISIG"),
+	[0xaf] = SCRIPT_WORD("OP_CHECKMULTISIGVERIFY"),
+	[0xb0] = SCRIPT_WORD("OP_NOP1"),
+	[0xb1] = SCRIPT_WORD("OP_CHECKLOCKTIMEVERIFY"),
+	[0xb2] = SCRIPT_WORD("OP_CHECKSEQUENCEVERIFY"),
+	[0xb3] = SCRIPT_WORD("OP_NOP4"),
+	[0xb4] = SCRIPT_WORD("OP_NOP5"),
+	[0xb5] = SCRIPT_WORD("OP_NOP6"),
+	[0xb6] = SCRIPT_WORD("OP_NOP7"),
+	[0xb7] = SCRIPT_WORD("OP_NOP8"),
+	[0xb8] = SCRIPT_WORD("OP_NOP9"),
+	[0xb9] = SCRIPT_WORD("OP_NOP10"),
+	[0xba] = SCRIPT_WORD("OP_CHECKSIGADD"),
+	[0xbb] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xbc] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xbd] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xbe] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xbf] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc0] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc1] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc2] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc3] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc4] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc5] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc6] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc7] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc8] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xc9] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xca] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xcb] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xcc] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xcd] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xce] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xcf] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd0] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd1] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd2] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd3] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd4] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd5] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd6] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd7] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd8] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xd9] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xda] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xdb] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xdc] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xdd] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xde] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xdf] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe0] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe1] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe2] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe3] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe4] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe5] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe6] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe7] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe8] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xe9] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xea] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xeb] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xec] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xed] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xee] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xef] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf0] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf1] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf2] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf3] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf4] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf5] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf6] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf7] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf8] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xf9] = SCRIPT_WORD("OP_UNKNOWN"),
 	
-	[0xfa].word = "OP_SMALLINTEGER",
-	[0xfb].word = "OP_PUBKEYS",
+	[0xfa] = SCRIPT_WORD("OP_SMALLINTEGER"),
+	[0xfb] = SCRIPT_WORD("OP_PUBKEYS"),
 
-	[0xfd].word = "OP_PUBKEYHASH",
-	[0xfc].word = "OP_PUBKEY",
-	[0xff].word = "OP_INVALIDOPCODE",
+	[0xfc] = SCRIPT_WORD("OP_PUBKEY"),
+	[0xfd] = SCRIPT_WORD("OP_PUBKEYHASH"),
+	[0xfe] = SCRIPT_WORD("OP_UNKNOWN"),
+	[0xff] = SCRIPT_WORD("OP_INVALIDOPCODE"),
 };
 
+static void script_set(struct ScriptTemplate *, int, const unsigned char *, size_t);
+static int script_is_key(const unsigned char *, size_t);
+
 const char *script_get_word(uint8_t w)
 {
-	// TODO - change this function to use a pointer as a parameter
-	// for output and return an int for success or failure
 	return words[w].word;
 }
 
-char *script_from_raw(unsigned char *raw, size_t l)
+/*
+ * Length of the assembly script_disassemble writes for a script, not
+ * counting the terminator. Only the name lengths in the opcode table are
+ * looked at, so sizing a buffer costs one quick pass.
+ */
+int script_get_asm_len(const unsigned char *script, size_t script_len)
 {
-	// TODO - change this function to use a pointer as a parameter
-	// for output and return an int for success or failure
-	size_t c, i, j;
-	unsigned char op;
-	char *ops[MAX_OPS_PER_SCRIPT];
-	char *r;
-	
-	for (c = 0, i = 0; i < l; ++i, ++c)
+	int op;
+	size_t i, len, data, data_len;
+
+	assert(script || script_len == 0);
+
+	for (len = 0, i = 0; i < script_len; )
+	{
+		op = script_next_op(&i, &data, &data_len, script, script_len);
+		if (op < 0)
+		{
+			error_log("Script length is too short for the push at byte %zu.", data);
+			return -1;
+		}
+		len += (len > 0) + ((data_len > 0) ? data_len * 2 : words[op].len);
+	}
+
+	return (int)len;
+}
+
+/*
+ * Write a script out as space separated opcode names, with pushed data
+ * in hex, in a single pass. Output holds output_len bytes; size it with
+ * script_get_asm_len. Returns the length of the assembly.
+ */
+int script_disassemble(char *output, size_t output_len, const unsigned char *script, size_t script_len)
+{
+	int op;
+	size_t i, len, need, data, data_len;
+	char *p;
+
+	assert(output);
+	assert(output_len);
+	assert(script || script_len == 0);
+
+	for (len = 0, i = 0; i < script_len; len += need)
 	{
-		if (c >= MAX_OPS_PER_SCRIPT)
+		op = script_next_op(&i, &data, &data_len, script, script_len);
+		if (op < 0)
 		{
-			error_log("Script has more operations than the allowed limit of %i.", MAX_OPS_PER_SCRIPT);
-			return NULL;
+			error_log("Script length is too short for the push at byte %zu.", data);
+			return -1;
 		}
-		
-		op = *raw;
-		++raw;
 
-		if (op >= 0x01 && op <= 0x4b)
+		need = (len > 0) + ((data_len > 0) ? data_len * 2 : words[op].len);
+		if (output_len - len <= need)
 		{
-			if (i + op >= l)
+			error_log("Output buffer is too small for the script's assembly.");
+			return -1;
+		}
+
+		p = output + len;
+		if (len > 0)
+		{
+			*p++ = ' ';
+		}
+		if (data_len > 0)
+		{
+			hex_raw_to_str(p, script + data, data_len);
+		}
+		else
+		{
+			memcpy(p, words[op].word, words[op].len);
+		}
+	}
+	output[len] = '\0';
+
+	return (int)len;
+}
+
+/*
+ * Disassemble a script into a single string allocated from arena, or
+ * with malloc if arena is NULL.
+ */
+char *script_from_raw(Arena arena, const unsigned char *raw, size_t l)
+{
+	int len;
+	char *r;
+
+	assert(raw || l == 0);
+
+	len = script_get_asm_len(raw, l);
+	if (len < 0)
+	{
+		return NULL;
+	}
+
+	r = (arena != NULL) ? arena_alloc(arena, (size_t)len + 1) : malloc((size_t)len + 1);
+	if (r == NULL)
+	{
+		error_log("Memory allocation error.");
+		return NULL;
+	}
+
+	if (script_disassemble(r, (size_t)len + 1, raw, l) < 0)
+	{
+		if (arena == NULL)
+		{
+			free(r);
+		}
+		return NULL;
+	}
+
+	return r;
+}
+
+/*
+ * Match an output script against the standard templates. Each template
+ * is fixed but for its pushes, so the first byte picks the candidates and
+ * the script is read at most once. Nothing is copied; the template's data
+ * points into script. Returns the type, SCRIPT_TYPE_NONSTANDARD if no
+ * template fits.
+ */
+int script_classify(struct ScriptTemplate *t, const unsigned char *script, size_t script_len)
+{
+	size_t i, data, data_len;
+	int n, op;
+
+	assert(t);
+	assert(script || script_len == 0);
+
+	memset(t, 0, sizeof(*t));
+	t->type = SCRIPT_TYPE_NONSTANDARD;
+	t->version = -1;
+
+	if (script_len == 0)
+	{
+		return t->type;
+	}
+
+	switch (script[0])
+	{
+		// OP_DUP OP_HASH160 <20> OP_EQUALVERIFY OP_CHECKSIG
+		case SCRIPT_OP_DUP:
+			if (script_len == 25 && script[1] == SCRIPT_OP_HASH160 && script[2] == 20 && script[23] == SCRIPT_OP_EQUALVERIFY && script[24] == SCRIPT_OP_CHECKSIG)
 			{
-				error_log("Script length is too short for operation 0x%02x.", op);
-				return NULL;
+				script_set(t, SCRIPT_TYPE_P2PKH, script + 3, 20);
 			}
-			ops[c] = malloc(op * 2 + 1);
-			if (ops[c] == NULL)
+			break;
+
+		// OP_HASH160 <20> OP_EQUAL
+		case SCRIPT_OP_HASH160:
+			if (script_len == 23 && script[1] == 20 && script[22] == SCRIPT_OP_EQUAL)
 			{
-				// TODO - handle memory allocation error
+				script_set(t, SCRIPT_TYPE_P2SH, script + 2, 20);
 			}
-			for (j = 0; j < op; ++j, ++raw)
+			break;
+
+		// <33 or 65 byte key> OP_CHECKSIG
+		case 33:
+		case 65:
+			if (script_len == (size_t)script[0] + 2 && script_is_key(script + 1, script[0]) && script[script_len - 1] == SCRIPT_OP_CHECKSIG)
 			{
-				sprintf(ops[c] + (j * 2), "%02x", *raw);
+				script_set(t, SCRIPT_TYPE_P2PK, script + 1, script[0]);
 			}
-			ops[c][j * 2] = '\0';
-			i += op;
-		//} else if (op == 0x4c) {
-		//} else if (op == 0x4d) {
-		//} else if (op == 0x4e) {
-		}
-		else
-		{
-			ops[c] = malloc(strlen(words[op].word) + 1);
-			if (ops[c] == NULL)
+			break;
+
+		// OP_RETURN followed by nothing but pushes
+		case SCRIPT_OP_RETURN:
+			for (i = 1; i < script_len; )
 			{
-				// TODO - handle memory allocation error
+				op = script_next_op(&i, &data, &data_len, script, script_len);
+				if (op < 0 || op > SCRIPT_OP_16)
+				{
+					return t->type;
+				}
 			}
-			strcpy(ops[c], words[op].word);
-		}
+			script_set(t, SCRIPT_TYPE_NULLDATA, script + 1, script_len - 1);
+			break;
+
+		default:
+			// OP_0 through OP_16 <2 to 40 bytes>
+			if ((script[0] == SCRIPT_OP_0 || (script[0] >= SCRIPT_OP_1 && script[0] <= SCRIPT_OP_16)) && script_len >= 4 && script_len <= SCRIPT_PROGRAM_MAX + 2 && script[1] == script_len - 2)
+			{
+				t->version = (script[0] == SCRIPT_OP_0) ? 0 : script[0] - SCRIPT_OP_1 + 1;
+				if (t->version == 0 && script[1] == 20)
+				{
+					script_set(t, SCRIPT_TYPE_P2WPKH, script + 2, 20);
+				}
+				else if (t->version == 0 && script[1] == 32)
+				{
+					script_set(t, SCRIPT_TYPE_P2WSH, script + 2, 32);
+				}
+				else if (t->version == 1 && script[1] == 32)
+				{
+					script_set(t, SCRIPT_TYPE_P2TR, script + 2, 32);
+				}
+				else if (t->version > 0)
+				{
+					script_set(t, SCRIPT_TYPE_WITNESS_UNKNOWN, script + 2, script[1]);
+				}
+				else
+				{
+					t->version = -1;
+				}
+				break;
+			}
+
+			// OP_m <key>... OP_n OP_CHECKMULTISIG
+			if (script[0] >= SCRIPT_OP_1 && script[0] <= SCRIPT_OP_16 && script_len >= 37)
+			{
+				for (n = 0, i = 1; i < script_len && (script[i] == 33 || script[i] == 65); ++n)
+				{
+					if (script_len - i - 1 < script[i] || !script_is_key(script + i + 1, script[i]))
+					{
+						return t->type;
+					}
+					i += script[i] + 1;
+				}
+				if (n > 0 && n <= 16 && script_len - i == 2 && script[i] == SCRIPT_OP_1 + n - 1 && script[i + 1] == SCRIPT_OP_CHECKMULTISIG && script[0] - SCRIPT_OP_1 + 1 <= n)
+				{
+					script_set(t, SCRIPT_TYPE_MULTISIG, script + 1, i - 1);
+					t->required = script[0] - SCRIPT_OP_1 + 1;
+					t->keys = n;
+				}
+			}
+			break;
+	}
+
+	return t->type;
+}
+
+/*
+ * Key i of a multisig template.
+ */
+int script_get_key(const unsigned char **key, size_t *key_len, const struct ScriptTemplate *t, int i)
+{
+	const unsigned char *p;
+
+	assert(key);
+	assert(key_len);
+	assert(t);
+
+	if (t->type == SCRIPT_TYPE_P2PK && i == 0)
+	{
+		*key = t->data;
+		*key_len = t->data_len;
+		return 1;
 	}
 
-	for (j = 0, i = 0; i < c; ++i)
+	if (t->type != SCRIPT_TYPE_MULTISIG || i < 0 || i >= t->keys)
 	{
-		j += strlen(ops[i]) + 1;
+		error_log("Script template has no key %i.", i);
+		return -1;
 	}
-	r = malloc(j + 1);
-	if (r == NULL)
+
+	for (p = t->data; i > 0; --i)
 	{
-		// TODO - handle memory allocation error
+		p += *p + 1;
 	}
-	memset(r, 0, j + 1);
-	for (i = 0; i < c; ++i)
+
+	*key = p + 1;
+	*key_len = *p;
+
+	return 1;
+}
+
+const char *script_get_type_name(int type)
+{
+	switch (type)
 	{
-		strcat(r, ops[i]);
-		strcat(r, " ");
-		free(ops[i]);
+		case SCRIPT_TYPE_P2PKH:
+			return "p2pkh";
+		case SCRIPT_TYPE_P2SH:
+			return "p2sh";
+		case SCRIPT_TYPE_P2WPKH:
+			return "p2wpkh";
+		case SCRIPT_TYPE_P2WSH:
+			return "p2wsh";
+		case SCRIPT_TYPE_P2TR:
+			return "p2tr";
+		case SCRIPT_TYPE_P2PK:
+			return "p2pk";
+		case SCRIPT_TYPE_MULTISIG:
+			return "multisig";
+		case SCRIPT_TYPE_NULLDATA:
+			return "nulldata";
+		case SCRIPT_TYPE_WITNESS_UNKNOWN:
+			return "witness_unknown";
 	}
-	
-	return r;
+
+	return "nonstandard";
+}
+
+static void script_set(struct ScriptTemplate *t, int type, const unsigned char *data, size_t data_len)
+{
+	t->type = type;
+	t->data = data;
+	t->data_len = data_len;
+}
+
+/*
+ * A public key's length has to agree with its prefix byte.
+ */
+static int script_is_key(const unsigned char *key, size_t len)
+{
+	if (len == 33)
+	{
+		return key[0] == 0x02 || key[0] == 0x03;
+	}
+	if (len == 65)
+	{
+		return key[0] == 0x04;
+	}
+
+	return 0;
+}
+
+/*
+ * Step over the operation at *i. Pushes report where their data is;
+ * anything else has no data. Returns the opcode, or -1 if a push runs
+ * past the end of the script, with *data at the push.
+ */
+int script_next_op(size_t *i, size_t *data, size_t *data_len, const unsigned char *script, size_t script_len)
+{
+	size_t n, len;
+	uint8_t op;
+
+	*data = *i;
+	*data_len = 0;
+
+	op = script[(*i)++];
+
+	if (op == SCRIPT_OP_0 || op > SCRIPT_OP_PUSHDATA4)
+	{
+		return op;
+	}
+
+	if (op < SCRIPT_OP_PUSHDATA1)
+	{
+		len = op;
+	}
+	else
+	{
+		n = (op == SCRIPT_OP_PUSHDATA1) ? 1 : ((op == SCRIPT_OP_PUSHDATA2) ? 2 : 4);
+		if (script_len - *i < n)
+		{
+			return -1;
+		}
+		for (len = 0; n > 0; --n)
+		{
+			len = (len << 8) | script[*i + n - 1];
+		}
+		*i += (op == SCRIPT_OP_PUSHDATA1) ? 1 : ((op == SCRIPT_OP_PUSHDATA2) ? 2 : 4);
+	}
+
+	if (script_len - *i < len)
+	{
+		return -1;
+	}
+
+	*data = *i;
+	*data_len = len;
+	*i += len;
+
+	return op;
 }
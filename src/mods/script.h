@@ -8,9 +8,138 @@
 #ifndef SCRIPT_H
 #define SCRIPT_H 1
 
+#include <stddef.h>
 #include <stdint.h>
+#include "arena.h"
+
+#define SCRIPT_TYPE_NONSTANDARD      0
+#define SCRIPT_TYPE_P2PKH            1
+#define SCRIPT_TYPE_P2SH             2
+#define SCRIPT_TYPE_P2WPKH           3
+#define SCRIPT_TYPE_P2WSH            4
+#define SCRIPT_TYPE_P2TR             5
+#define SCRIPT_TYPE_P2PK             6
+#define SCRIPT_TYPE_MULTISIG         7
+#define SCRIPT_TYPE_NULLDATA         8
+#define SCRIPT_TYPE_WITNESS_UNKNOWN  9
+#define SCRIPT_PROGRAM_MAX           40
+
+#define SCRIPT_OP_0                   0x00
+#define SCRIPT_OP_PUSHDATA1           0x4c
+#define SCRIPT_OP_PUSHDATA2           0x4d
+#define SCRIPT_OP_PUSHDATA4           0x4e
+#define SCRIPT_OP_1NEGATE             0x4f
+#define SCRIPT_OP_RESERVED            0x50
+#define SCRIPT_OP_1                   0x51
+#define SCRIPT_OP_16                  0x60
+#define SCRIPT_OP_NOP                 0x61
+#define SCRIPT_OP_VER                 0x62
+#define SCRIPT_OP_IF                  0x63
+#define SCRIPT_OP_NOTIF               0x64
+#define SCRIPT_OP_VERIF               0x65
+#define SCRIPT_OP_VERNOTIF            0x66
+#define SCRIPT_OP_ELSE                0x67
+#define SCRIPT_OP_ENDIF               0x68
+#define SCRIPT_OP_VERIFY              0x69
+#define SCRIPT_OP_RETURN              0x6a
+#define SCRIPT_OP_TOALTSTACK          0x6b
+#define SCRIPT_OP_FROMALTSTACK        0x6c
+#define SCRIPT_OP_2DROP               0x6d
+#define SCRIPT_OP_2DUP                0x6e
+#define SCRIPT_OP_3DUP                0x6f
+#define SCRIPT_OP_2OVER               0x70
+#define SCRIPT_OP_2ROT                0x71
+#define SCRIPT_OP_2SWAP               0x72
+#define SCRIPT_OP_IFDUP               0x73
+#define SCRIPT_OP_DEPTH               0x74
+#define SCRIPT_OP_DROP                0x75
+#define SCRIPT_OP_DUP                 0x76
+#define SCRIPT_OP_NIP                 0x77
+#define SCRIPT_OP_OVER                0x78
+#define SCRIPT_OP_PICK                0x79
+#define SCRIPT_OP_ROLL                0x7a
+#define SCRIPT_OP_ROT                 0x7b
+#define SCRIPT_OP_SWAP                0x7c
+#define SCRIPT_OP_TUCK                0x7d
+#define SCRIPT_OP_CAT                 0x7e
+#define SCRIPT_OP_SUBSTR              0x7f
+#define SCRIPT_OP_LEFT                0x80
+#define SCRIPT_OP_RIGHT               0x81
+#define SCRIPT_OP_SIZE                0x82
+#define SCRIPT_OP_INVERT              0x83
+#define SCRIPT_OP_AND                 0x84
+#define SCRIPT_OP_OR                  0x85
+#define SCRIPT_OP_XOR                 0x86
+#define SCRIPT_OP_EQUAL               0x87
+#define SCRIPT_OP_EQUALVERIFY         0x88
+#define SCRIPT_OP_RESERVED1           0x89
+#define SCRIPT_OP_RESERVED2           0x8a
+#define SCRIPT_OP_1ADD                0x8b
+#define SCRIPT_OP_1SUB                0x8c
+#define SCRIPT_OP_2MUL                0x8d
+#define SCRIPT_OP_2DIV                0x8e
+#define SCRIPT_OP_NEGATE              0x8f
+#define SCRIPT_OP_ABS                 0x90
+#define SCRIPT_OP_NOT                 0x91
+#define SCRIPT_OP_0NOTEQUAL           0x92
+#define SCRIPT_OP_ADD                 0x93
+#define SCRIPT_OP_SUB                 0x94
+#define SCRIPT_OP_MUL                 0x95
+#define SCRIPT_OP_DIV                 0x96
+#define SCRIPT_OP_MOD                 0x97
+#define SCRIPT_OP_LSHIFT              0x98
+#define SCRIPT_OP_RSHIFT              0x99
+#define SCRIPT_OP_BOOLAND             0x9a
+#define SCRIPT_OP_BOOLOR              0x9b
+#define SCRIPT_OP_NUMEQUAL            0x9c
+#define SCRIPT_OP_NUMEQUALVERIFY      0x9d
+#define SCRIPT_OP_NUMNOTEQUAL         0x9e
+#define SCRIPT_OP_LESSTHAN            0x9f
+#define SCRIPT_OP_GREATERTHAN         0xa0
+#define SCRIPT_OP_LESSTHANOREQUAL     0xa1
+#define SCRIPT_OP_GREATERTHANOREQUAL  0xa2
+#define SCRIPT_OP_MIN                 0xa3
+#define SCRIPT_OP_MAX                 0xa4
+#define SCRIPT_OP_WITHIN              0xa5
+#define SCRIPT_OP_RIPEMD160           0xa6
+#define SCRIPT_OP_SHA1                0xa7
+#define SCRIPT_OP_SHA256              0xa8
+#define SCRIPT_OP_HASH160             0xa9
+#define SCRIPT_OP_HASH256             0xaa
+#define SCRIPT_OP_CODESEPARATOR       0xab
+#define SCRIPT_OP_CHECKSIG            0xac
+#define SCRIPT_OP_CHECKSIGVERIFY      0xad
+#define SCRIPT_OP_CHECKMULTISIG       0xae
+#define SCRIPT_OP_CHECKMULTISIGVERIFY 0xaf
+#define SCRIPT_OP_NOP1                0xb0
+#define SCRIPT_OP_CHECKLOCKTIMEVERIFY 0xb1
+#define SCRIPT_OP_CHECKSEQUENCEVERIFY 0xb2
+#define SCRIPT_OP_NOP4                0xb3
+#define SCRIPT_OP_NOP10               0xb9
+#define SCRIPT_OP_CHECKSIGADD         0xba
+
+/*
+ * What script_classify found. data points into the classified script: at
+ * the hash, key or witness program, at the payload after OP_RETURN, or
+ * for multisig at the key pushes, which script_get_key walks.
+ */
+struct ScriptTemplate
+{
+	int type;
+	int version;
+	const unsigned char *data;
+	size_t data_len;
+	int required;
+	int keys;
+};
 
 const char *script_get_word(uint8_t);
-char *script_from_raw(unsigned char *, size_t);
+int script_next_op(size_t *, size_t *, size_t *, const unsigned char *, size_t);
+int script_get_asm_len(const unsigned char *, size_t);
+int script_disassemble(char *, size_t, const unsigned char *, size_t);
+char *script_from_raw(Arena, const unsigned char *, size_t);
+int script_classify(struct ScriptTemplate *, const unsigned char *, size_t);
+int script_get_key(const unsigned char **, size_t *, const struct ScriptTemplate *, int);
+const char *script_get_type_name(int);
 
 #endif
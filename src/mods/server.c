@@ -0,0 +1,824 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "server.h"
+#include "node.h"
+#include "message.h"
+#include "network.h"
+#include "block.h"
+#include "serialize.h"
+#include "capture.h"
+#include "commands/version.h"
+#include "commands/verack.h"
+#include "commands/inv.h"
+#include "commands/ping.h"
+#include "error.h"
+
+#define POLL_INTERVAL   1000
+#define BURST           64
+#define FRAMES_INITIAL  (1024 * 1024)
+#define INDEX_INITIAL   1024
+
+struct ServerBlock
+{
+	unsigned char hash[BLOCK_HASH_LEN];
+	size_t frame;
+};
+
+struct ServerClient
+{
+	Node node;
+	int active;
+	int ready;
+	size_t next;
+	uint64_t due;
+};
+
+struct Server
+{
+	Node listener;
+	int rate;
+	unsigned char *frames;
+	size_t frames_len;
+	size_t frames_cap;
+	size_t *offsets;
+	size_t frame_count;
+	size_t frame_cap;
+	size_t *replay;
+	size_t replay_count;
+	size_t replay_cap;
+	struct ServerBlock *blocks;
+	size_t block_count;
+	size_t block_cap;
+	Inv inv;
+	Inv notfound;
+	Capture capture;
+	struct ServerClient clients[SERVER_CLIENTS_MAX];
+	uint64_t connections;
+	uint64_t messages_in;
+	uint64_t messages_out;
+	uint64_t bytes_out;
+	uint64_t blocks_served;
+	uint64_t blocks_missing;
+	uint64_t start;
+	uint64_t finish;
+};
+
+static int server_block_cmp(const void *, const void *);
+static int server_is_command(unsigned char *);
+static int server_append(Server, unsigned char *, size_t, int);
+static int server_load_capture(Server, const char *);
+static int server_send_frame(Server, struct ServerClient *, size_t);
+static int server_replay(Server, struct ServerClient *, uint64_t);
+static int server_handle(Server, struct ServerClient *, Message);
+static void server_drop(Server, struct ServerClient *);
+
+/*
+ * Set up a server listening on the loopback interface. Replayed traffic
+ * goes out to each peer at rate messages per second, or as fast as the
+ * peer will take it if rate is 0.
+ */
+int server_new(Server s, int port, int rate)
+{
+	int r;
+
+	assert(s);
+
+	if (rate < 0)
+	{
+		error_log("Replay rate can not be negative.");
+		return -1;
+	}
+
+	memset(s, 0, sizeof(*s));
+
+	s->rate = rate;
+	s->frames_cap = FRAMES_INITIAL;
+	s->frame_cap = INDEX_INITIAL;
+	s->replay_cap = INDEX_INITIAL;
+	s->block_cap = INDEX_INITIAL;
+
+	s->listener = malloc(node_sizeof());
+	s->frames = malloc(s->frames_cap);
+	s->offsets = malloc(sizeof(*s->offsets) * s->frame_cap);
+	s->replay = malloc(sizeof(*s->replay) * s->replay_cap);
+	s->blocks = malloc(sizeof(*s->blocks) * s->block_cap);
+	s->inv = malloc(inv_sizeof());
+	s->notfound = malloc(inv_sizeof());
+	if (s->listener == NULL || s->frames == NULL || s->offsets == NULL || s->replay == NULL || s->blocks == NULL || s->inv == NULL || s->notfound == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = node_listen(s->listener, port);
+	if (r < 0)
+	{
+		error_log("Could not listen for connections.");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Load recorded traffic from a file. The file may hold framed P2P
+ * messages back to back, as they appear on the wire, be a capture file,
+ * or be a blk*.dat file. Framed messages, and the messages a captured
+ * peer sent us, are replayed to every peer in order. Blocks from any kind
+ * of file are also served in response to getdata.
+ */
+int server_load(Server s, const char *path)
+{
+	int r, framed;
+	size_t len, pos, frame_len;
+	uint32_t magic, block_len;
+	unsigned char *data;
+	FILE *f;
+
+	assert(s);
+	assert(path);
+
+	f = fopen(path, "rb");
+	if (f == NULL)
+	{
+		error_log("Could not open replay file %s.", path);
+		return -1;
+	}
+
+	fseek(f, 0, SEEK_END);
+	len = (size_t)ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	data = malloc(len ? len : 1);
+	if (data == NULL)
+	{
+		error_log("Memory allocation error.");
+		fclose(f);
+		return -1;
+	}
+
+	if (fread(data, 1, len, f) != len)
+	{
+		error_log("Could not read replay file %s.", path);
+		free(data);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	if (capture_is_capture(data, len))
+	{
+		free(data);
+		return server_load_capture(s, path);
+	}
+
+	// Decide from the first record whether this is a message capture or
+	// a block file. Any one binary block length could happen to look
+	// like the start of a command, so later records aren't sniffed.
+	framed = (len >= MESSAGE_HEADER_LEN && server_is_command(data + 4));
+
+	pos = 0;
+	while (pos + 8 <= len)
+	{
+		deserialize_uint32(&magic, data + pos, SERIALIZE_ENDIAN_LIT);
+		if (magic == 0)
+		{
+			// Bitcoin core preallocates block files with zeros
+			break;
+		}
+		if (magic != network_get_magic())
+		{
+			error_log("Replay file %s has bad network magic at offset %zu.", path, pos);
+			free(data);
+			return -1;
+		}
+
+		if (framed)
+		{
+			r = message_frame_len(&frame_len, data + pos, len - pos);
+			if (r <= 0 || pos + frame_len > len)
+			{
+				error_log("Replay file %s has a truncated message at offset %zu.", path, pos);
+				free(data);
+				return -1;
+			}
+			r = server_append(s, data + pos, frame_len, 1);
+			pos += frame_len;
+		}
+		else
+		{
+			deserialize_uint32(&block_len, data + pos + 4, SERIALIZE_ENDIAN_LIT);
+			if (block_len > MESSAGE_PAYLOAD_MAXLEN || pos + 8 + block_len > len)
+			{
+				error_log("Replay file %s has a truncated block at offset %zu.", path, pos);
+				free(data);
+				return -1;
+			}
+			r = server_append(s, data + pos + 8, block_len, 0);
+			pos += 8 + block_len;
+		}
+		if (r < 0)
+		{
+			error_log("Could not load replay file %s.", path);
+			free(data);
+			return -1;
+		}
+	}
+
+	free(data);
+
+	qsort(s->blocks, s->block_count, sizeof(*s->blocks), server_block_cmp);
+
+	return 1;
+}
+
+/*
+ * Record the traffic of every served connection to capture.
+ */
+void server_set_capture(Server s, Capture capture)
+{
+	assert(s);
+
+	s->capture = capture;
+}
+
+/*
+ * Serve peers until max_connections have come and gone, or forever if
+ * max_connections is 0.
+ */
+int server_run(Server s, int max_connections)
+{
+	int r;
+	size_t i, open;
+	uint64_t now, wait;
+	Node nodes[SERVER_CLIENTS_MAX + 1];
+	int readable[SERVER_CLIENTS_MAX + 1];
+	struct ServerClient *client;
+	Message message;
+
+	assert(s);
+
+	message = malloc(message_sizeof());
+	if (message == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	while (1)
+	{
+		now = node_now_us();
+		wait = POLL_INTERVAL;
+
+		for (open = 0, i = 0; i < SERVER_CLIENTS_MAX; ++i)
+		{
+			client = &s->clients[i];
+			nodes[i + 1] = client->active ? client->node : NULL;
+			if (!client->active)
+			{
+				continue;
+			}
+			open++;
+
+			r = server_replay(s, client, now);
+			if (r < 0)
+			{
+				error_clear();
+				server_drop(s, client);
+				nodes[i + 1] = NULL;
+				continue;
+			}
+
+			// Come back when the next replayed message is due
+			if (client->ready && client->next < s->replay_count)
+			{
+				wait = (client->due <= now) ? 0 : ((client->due - now) / 1000 < wait ? (client->due - now) / 1000 : wait);
+			}
+		}
+
+		if (max_connections > 0 && s->connections >= (uint64_t)max_connections)
+		{
+			if (open == 0)
+			{
+				break;
+			}
+			nodes[0] = NULL;
+		}
+		else
+		{
+			nodes[0] = (open < SERVER_CLIENTS_MAX) ? s->listener : NULL;
+		}
+
+		r = node_poll(nodes, readable, SERVER_CLIENTS_MAX + 1, (int)wait);
+		if (r < 0)
+		{
+			error_log("Could not wait for peer data.");
+			free(message);
+			return -1;
+		}
+
+		if (nodes[0] != NULL && readable[0])
+		{
+			for (i = 0; i < SERVER_CLIENTS_MAX && s->clients[i].active; ++i)
+				;
+			client = &s->clients[i];
+			if (client->node == NULL)
+			{
+				client->node = malloc(node_sizeof());
+				if (client->node == NULL)
+				{
+					error_log("Memory allocation error.");
+					free(message);
+					return -1;
+				}
+			}
+			if (node_accept(client->node, s->listener) < 0)
+			{
+				error_clear();
+			}
+			else
+			{
+				if (s->connections == 0)
+				{
+					s->start = node_now_us();
+				}
+				node_set_capture(client->node, s->capture);
+				client->active = 1;
+				client->ready = 0;
+				client->next = 0;
+				s->connections++;
+			}
+		}
+
+		for (i = 0; i < SERVER_CLIENTS_MAX; ++i)
+		{
+			client = &s->clients[i];
+			if (nodes[i + 1] == NULL || !readable[i + 1] || !client->active)
+			{
+				continue;
+			}
+
+			while (client->active && (r = node_read_message(client->node, message)) > 0)
+			{
+				s->messages_in++;
+				r = server_handle(s, client, message);
+				message_clear(message);
+				if (r < 0)
+				{
+					error_clear();
+					server_drop(s, client);
+				}
+			}
+			if (client->active && r < 0)
+			{
+				error_clear();
+				server_drop(s, client);
+			}
+		}
+	}
+
+	free(message);
+
+	return 1;
+}
+
+int server_to_json(char *output, Server s)
+{
+	double elapsed;
+
+	assert(output);
+	assert(s);
+
+	elapsed = (double)(s->finish - s->start) / 1000000.0;
+
+	output += sprintf(output, "{\n");
+	output += sprintf(output, "  \"connections\": %"PRIu64",\n", s->connections);
+	output += sprintf(output, "  \"replay_messages\": %zu,\n", s->replay_count);
+	output += sprintf(output, "  \"blocks_loaded\": %zu,\n", s->block_count);
+	output += sprintf(output, "  \"messages_in\": %"PRIu64",\n", s->messages_in);
+	output += sprintf(output, "  \"messages_out\": %"PRIu64",\n", s->messages_out);
+	output += sprintf(output, "  \"bytes_out\": %"PRIu64",\n", s->bytes_out);
+	output += sprintf(output, "  \"blocks_served\": %"PRIu64",\n", s->blocks_served);
+	output += sprintf(output, "  \"blocks_missing\": %"PRIu64",\n", s->blocks_missing);
+	output += sprintf(output, "  \"milliseconds\": %.3f,\n", elapsed * 1000.0);
+	output += sprintf(output, "  \"messages_per_second\": %.2f,\n", elapsed > 0 ? (double)s->messages_out / elapsed : 0.0);
+	output += sprintf(output, "  \"mb_per_second\": %.2f\n", elapsed > 0 ? ((double)s->bytes_out / 1048576.0) / elapsed : 0.0);
+	sprintf(output, "}");
+
+	return 1;
+}
+
+void server_clear(Server s)
+{
+	size_t i;
+
+	assert(s);
+
+	for (i = 0; i < SERVER_CLIENTS_MAX; ++i)
+	{
+		if (s->clients[i].active)
+		{
+			node_disconnect(s->clients[i].node);
+		}
+		free(s->clients[i].node);
+		s->clients[i].node = NULL;
+		s->clients[i].active = 0;
+	}
+
+	if (s->listener != NULL)
+	{
+		node_disconnect(s->listener);
+	}
+
+	free(s->listener);
+	free(s->frames);
+	free(s->offsets);
+	free(s->replay);
+	free(s->blocks);
+	free(s->inv);
+	free(s->notfound);
+	s->listener = NULL;
+	s->frames = NULL;
+	s->offsets = NULL;
+	s->replay = NULL;
+	s->blocks = NULL;
+	s->inv = NULL;
+	s->notfound = NULL;
+}
+
+size_t server_sizeof(void)
+{
+	return sizeof(struct Server);
+}
+
+static int server_block_cmp(const void *a, const void *b)
+{
+	return memcmp(((struct ServerBlock *)a)->hash, ((struct ServerBlock *)b)->hash, BLOCK_HASH_LEN);
+}
+
+/*
+ * A command field is lowercase letters and digits padded out with zeros.
+ */
+static int server_is_command(unsigned char *input)
+{
+	int i;
+
+	for (i = 0; i < 12 && ((input[i] >= 'a' && input[i] <= 'z') || (input[i] >= '0' && input[i] <= '9')); ++i)
+		;
+	if (i == 0)
+	{
+		return 0;
+	}
+	for (; i < 12; ++i)
+	{
+		if (input[i] != 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Add a frame to the store. A framed message is copied as is. A bare
+ * block is framed here once, so serving it later is a single write.
+ */
+static int server_append(Server s, unsigned char *data, size_t len, int framed)
+{
+	int r;
+	size_t need, cap;
+	void *tmp;
+	Message message;
+	struct ServerBlock *block;
+	unsigned char *frame, *payload;
+	size_t payload_len;
+
+	need = framed ? len : MESSAGE_HEADER_LEN + len;
+
+	if (s->frames_len + need > s->frames_cap)
+	{
+		for (cap = s->frames_cap; s->frames_len + need > cap; cap *= 2)
+			;
+		tmp = realloc(s->frames, cap);
+		if (tmp == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		s->frames = tmp;
+		s->frames_cap = cap;
+	}
+	if (s->frame_count == s->frame_cap)
+	{
+		tmp = realloc(s->offsets, sizeof(*s->offsets) * s->frame_cap * 2);
+		if (tmp == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		s->offsets = tmp;
+		s->frame_cap *= 2;
+	}
+
+	frame = s->frames + s->frames_len;
+
+	if (framed)
+	{
+		memcpy(frame, data, len);
+	}
+	else
+	{
+		message = malloc(message_sizeof());
+		if (message == NULL)
+		{
+			error_log("Memory allocation error.");
+			return -1;
+		}
+		r = message_new(message, BLOCK_COMMAND, data, len);
+		if (r < 0)
+		{
+			error_log("Could not create block message.");
+			free(message);
+			return -1;
+		}
+		message_serialize(frame, &need, message);
+		message_clear(message);
+		free(message);
+	}
+
+	s->offsets[s->frame_count] = s->frames_len;
+	s->frames_len += need;
+
+	if (framed)
+	{
+		if (s->replay_count == s->replay_cap)
+		{
+			tmp = realloc(s->replay, sizeof(*s->replay) * s->replay_cap * 2);
+			if (tmp == NULL)
+			{
+				error_log("Memory allocation error.");
+				return -1;
+			}
+			s->replay = tmp;
+			s->replay_cap *= 2;
+		}
+		s->replay[s->replay_count++] = s->frame_count;
+	}
+
+	// Index blocks by hash so getdata can find them
+	payload = frame + MESSAGE_HEADER_LEN;
+	payload_len = need - MESSAGE_HEADER_LEN;
+	if (strncmp((char *)frame + 4, BLOCK_COMMAND, 12) == 0 && payload_len >= BLOCK_HEADER_LEN)
+	{
+		if (s->block_count == s->block_cap)
+		{
+			tmp = realloc(s->blocks, sizeof(*s->blocks) * s->block_cap * 2);
+			if (tmp == NULL)
+			{
+				error_log("Memory allocation error.");
+				return -1;
+			}
+			s->blocks = tmp;
+			s->block_cap *= 2;
+		}
+		block = &s->blocks[s->block_count++];
+		block_get_hash(block->hash, payload, payload_len);
+		block->frame = s->frame_count;
+	}
+
+	s->frame_count++;
+
+	return 1;
+}
+
+static int server_load_capture(Server s, const char *path)
+{
+	int r;
+	Capture capture;
+	struct CaptureRecord record;
+
+	capture = malloc(capture_sizeof());
+	if (capture == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	r = capture_load(capture, path);
+	if (r < 0)
+	{
+		error_log("Could not load capture file.");
+		capture_close(capture);
+		free(capture);
+		return -1;
+	}
+
+	// Play the remote side of the conversation
+	while ((r = capture_next(&record, capture)) > 0)
+	{
+		if (record.direction != CAPTURE_IN || record.frame_len < MESSAGE_HEADER_LEN)
+		{
+			continue;
+		}
+		r = server_append(s, record.frame, record.frame_len, 1);
+		if (r < 0)
+		{
+			break;
+		}
+	}
+
+	capture_close(capture);
+	free(capture);
+
+	if (r < 0)
+	{
+		error_log("Could not load capture file %s.", path);
+		return -1;
+	}
+
+	qsort(s->blocks, s->block_count, sizeof(*s->blocks), server_block_cmp);
+
+	return 1;
+}
+
+static int server_send_frame(Server s, struct ServerClient *client, size_t frame)
+{
+	int r;
+	size_t frame_len;
+	unsigned char *data;
+
+	data = s->frames + s->offsets[frame];
+	message_frame_len(&frame_len, data, MESSAGE_HEADER_LEN);
+
+	r = node_write(client->node, data, frame_len);
+	if (r < 0)
+	{
+		error_log("Could not send message to %s.", node_get_host(client->node));
+		return -1;
+	}
+
+	s->messages_out++;
+	s->bytes_out += frame_len;
+
+	return 1;
+}
+
+/*
+ * Send whatever replayed traffic is due. At full speed messages go out in
+ * bursts so incoming requests still get a look in between them.
+ */
+static int server_replay(Server s, struct ServerClient *client, uint64_t now)
+{
+	int r, sent;
+
+	if (!client->ready)
+	{
+		return 1;
+	}
+
+	for (sent = 0; client->next < s->replay_count && sent < BURST; ++sent)
+	{
+		if (s->rate > 0)
+		{
+			if (client->due > now)
+			{
+				break;
+			}
+			client->due += 1000000 / (uint64_t)s->rate;
+		}
+
+		r = server_send_frame(s, client, s->replay[client->next++]);
+		if (r < 0)
+		{
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+static int server_handle(Server s, struct ServerClient *client, Message message)
+{
+	int r;
+	size_t i, payload_len;
+	uint32_t type;
+	unsigned char *payload, *buffer;
+	unsigned char hash[INV_HASH_LEN];
+	struct ServerBlock key, *block;
+
+	payload = message_get_payload_ptr(message);
+	payload_len = message_get_payload_len(message);
+
+	if (message_is_valid(message) <= 0)
+	{
+		error_log("Peer sent an invalid message.");
+		return -1;
+	}
+
+	if (message_cmp_command(message, VERSION_COMMAND) == 0)
+	{
+		r = node_send_version(client->node);
+		if (r >= 0)
+		{
+			r = node_send_message(client->node, VERACK_COMMAND, NULL, 0);
+		}
+		if (r < 0)
+		{
+			error_log("Could not answer version message.");
+			return -1;
+		}
+		s->messages_out += 2;
+	}
+	else if (message_cmp_command(message, VERACK_COMMAND) == 0)
+	{
+		client->ready = 1;
+		client->due = node_now_us();
+	}
+	else if (message_cmp_command(message, PING_COMMAND) == 0)
+	{
+		r = node_send_message(client->node, PONG_COMMAND, payload, payload_len);
+		if (r < 0)
+		{
+			error_log("Could not answer ping message.");
+			return -1;
+		}
+		s->messages_out++;
+	}
+	else if (message_cmp_command(message, GETDATA_COMMAND) == 0)
+	{
+		r = inv_deserialize(s->inv, payload, payload_len);
+		if (r < 0)
+		{
+			error_log("Could not parse getdata message.");
+			return -1;
+		}
+
+		inv_new(s->notfound);
+
+		for (i = 0; i < inv_get_count(s->inv); ++i)
+		{
+			inv_get(&type, hash, s->inv, i);
+
+			block = NULL;
+			if ((type & ~INV_TYPE_WITNESS_FLAG) == INV_TYPE_BLOCK)
+			{
+				memcpy(key.hash, hash, BLOCK_HASH_LEN);
+				block = bsearch(&key, s->blocks, s->block_count, sizeof(*s->blocks), server_block_cmp);
+			}
+
+			if (block == NULL)
+			{
+				inv_add(s->notfound, type, hash);
+				s->blocks_missing++;
+				continue;
+			}
+
+			r = server_send_frame(s, client, block->frame);
+			if (r < 0)
+			{
+				return -1;
+			}
+			s->blocks_served++;
+		}
+
+		if (inv_get_count(s->notfound) > 0)
+		{
+			buffer = malloc(inv_serialized_len(s->notfound));
+			if (buffer == NULL)
+			{
+				error_log("Memory allocation error.");
+				return -1;
+			}
+			r = inv_serialize(buffer, s->notfound);
+			r = node_send_message(client->node, NOTFOUND_COMMAND, buffer, r);
+			free(buffer);
+			if (r < 0)
+			{
+				error_log("Could not send notfound message.");
+				return -1;
+			}
+			s->messages_out++;
+		}
+	}
+
+	return 1;
+}
+
+static void server_drop(Server s, struct ServerClient *client)
+{
+	node_disconnect(client->node);
+	client->active = 0;
+	s->finish = node_now_us();
+}
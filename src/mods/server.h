@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H 1
+
+#include <stddef.h>
+#include "capture.h"
+
+#define SERVER_CLIENTS_MAX  64
+
+typedef struct Server *Server;
+
+int server_new(Server, int, int);
+int server_load(Server, const char *);
+void server_set_capture(Server, Capture);
+int server_run(Server, int);
+int server_to_json(char *, Server);
+void server_clear(Server);
+size_t server_sizeof(void);
+
+#endif
@@ -0,0 +1,668 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "sighash.h"
+#include "script.h"
+#include "crypto.h"
+#include "error.h"
+
+#define SIGHASH_TYPE_MASK    0x1f
+#define SIGHASH_OUTPUT_MASK  0x03
+#define SIGHASH_TAG          "TapSighash"
+#define SIGHASH_EPOCH        0x00
+#define SIGHASH_EXT_SCRIPT   0x02
+#define SIGHASH_ANNEX        0x01
+
+/*
+ * Signature hashes are streamed into the hash as they're serialized, so
+ * nothing is built in memory.
+ *
+ * The digests of the prevouts, sequences and outputs depend only on the
+ * transaction and are computed once per transaction, on first use. The
+ * BIP143 ones are the BIP341 ones hashed again, so both come from one
+ * pass. Everything a segwit preimage has before the input specific part
+ * is kept as a midstate per hash type and copied to start each input,
+ * which leaves a constant amount of hashing per input.
+ */
+struct Sighash
+{
+	TxView tx;
+	CryptoHash hash;
+	CryptoHash work;
+	CryptoHash tag;
+	CryptoHash v0_prefix;
+	CryptoHash tap_prefix;
+	int v0_prefix_type;
+	int tap_prefix_type;
+	int cached;
+	int tap_cached;
+	const struct SighashPrevout *spent;
+	size_t spent_count;
+	unsigned char prevouts[SIGHASH_LEN];
+	unsigned char sequences[SIGHASH_LEN];
+	unsigned char outputs[SIGHASH_LEN];
+	unsigned char sha_prevouts[SIGHASH_LEN];
+	unsigned char sha_sequences[SIGHASH_LEN];
+	unsigned char sha_outputs[SIGHASH_LEN];
+	unsigned char sha_amounts[SIGHASH_LEN];
+	unsigned char sha_scripts[SIGHASH_LEN];
+};
+
+static void sighash_write_uint32(CryptoHash, uint32_t);
+static void sighash_write_uint64(CryptoHash, uint64_t);
+static void sighash_write_compact(CryptoHash, uint64_t);
+static void sighash_write_output(CryptoHash, const struct TxViewOutput *);
+static void sighash_write_script_code(CryptoHash, const unsigned char *, size_t);
+static void sighash_cache(Sighash);
+static void sighash_cache_taproot(Sighash);
+static void sighash_set_v0_prefix(Sighash, int);
+static void sighash_set_tap_prefix(Sighash, int);
+
+int sighash_new(Sighash sh)
+{
+	size_t i;
+	unsigned char tag[SIGHASH_LEN];
+	CryptoHash *hashes[] = {&sh->hash, &sh->work, &sh->tag, &sh->v0_prefix, &sh->tap_prefix};
+
+	assert(sh);
+
+	memset(sh, 0, sizeof(*sh));
+
+	for (i = 0; i < sizeof(hashes) / sizeof(*hashes); ++i)
+	{
+		*hashes[i] = malloc(crypto_hash_sizeof());
+		if (*hashes[i] == NULL)
+		{
+			error_log("Memory allocation error.");
+			sighash_clear(sh);
+			return -1;
+		}
+		if (crypto_hash_open(*hashes[i], CRYPTO_SHA256) < 0)
+		{
+			error_log("Could not open signature hash.");
+			free(*hashes[i]);
+			*hashes[i] = NULL;
+			sighash_clear(sh);
+			return -1;
+		}
+	}
+
+	// The tag fills one block, so this is a midstate like any other.
+	crypto_hash_write(sh->hash, (const unsigned char *)SIGHASH_TAG, strlen(SIGHASH_TAG));
+	crypto_hash_final(tag, sh->hash);
+	crypto_hash_write(sh->tag, tag, SIGHASH_LEN);
+	crypto_hash_write(sh->tag, tag, SIGHASH_LEN);
+
+	sh->v0_prefix_type = -1;
+	sh->tap_prefix_type = -1;
+
+	return 1;
+}
+
+/*
+ * Point at the transaction to hash inputs of. Must be called again
+ * whenever the view is reparsed.
+ */
+void sighash_set_tx(Sighash sh, TxView tx)
+{
+	assert(sh);
+	assert(tx);
+
+	sh->tx = tx;
+	sh->cached = 0;
+	sh->tap_cached = 0;
+	sh->v0_prefix_type = -1;
+	sh->tap_prefix_type = -1;
+	sh->spent = NULL;
+	sh->spent_count = 0;
+}
+
+/*
+ * Give the outputs spent by every input of the transaction, in input
+ * order, which taproot hashes need. They aren't copied, so they must
+ * outlive the transaction.
+ */
+void sighash_set_prevouts(Sighash sh, const struct SighashPrevout *spent, size_t count)
+{
+	assert(sh);
+	assert(sh->tx);
+	assert(spent || count == 0);
+	assert(count == txview_get_input_count(sh->tx));
+
+	sh->spent = spent;
+	sh->spent_count = count;
+	sh->tap_cached = 0;
+	sh->tap_prefix_type = -1;
+}
+
+/*
+ * The original signature hash: a copy of the transaction with every
+ * input script emptied but the one being signed, which is replaced by
+ * the script code less its OP_CODESEPARATORs, then edited per the hash
+ * type. SIGHASH_SINGLE without a matching output famously signs the
+ * number one instead.
+ */
+int sighash_legacy(unsigned char *output, Sighash sh, size_t input, const unsigned char *script_code, size_t script_code_len, int hash_type)
+{
+	size_t i, count, base;
+	const struct TxViewInput *in;
+	const struct TxViewOutput *out;
+	TxView tx;
+
+	assert(output);
+	assert(sh);
+	assert(sh->tx);
+	assert(input < txview_get_input_count(sh->tx));
+	assert(script_code || script_code_len == 0);
+
+	tx = sh->tx;
+	base = (size_t)(hash_type & SIGHASH_TYPE_MASK);
+
+	if (base == SIGHASH_SINGLE && input >= txview_get_output_count(tx))
+	{
+		memset(output, 0, SIGHASH_LEN);
+		output[0] = 1;
+		return 1;
+	}
+
+	sighash_write_uint32(sh->hash, txview_get_version(tx));
+
+	count = (hash_type & SIGHASH_ANYONECANPAY) ? 1 : txview_get_input_count(tx);
+	sighash_write_compact(sh->hash, count);
+	for (i = 0; i < txview_get_input_count(tx); ++i)
+	{
+		if ((hash_type & SIGHASH_ANYONECANPAY) && i != input)
+		{
+			continue;
+		}
+		in = txview_get_input(tx, i);
+		crypto_hash_write(sh->hash, in->prev_hash, TXVIEW_HASH_LEN);
+		sighash_write_uint32(sh->hash, in->prev_index);
+		if (i == input)
+		{
+			sighash_write_script_code(sh->hash, script_code, script_code_len);
+		}
+		else
+		{
+			sighash_write_compact(sh->hash, 0);
+		}
+		if (i != input && (base == SIGHASH_NONE || base == SIGHASH_SINGLE))
+		{
+			sighash_write_uint32(sh->hash, 0);
+		}
+		else
+		{
+			sighash_write_uint32(sh->hash, in->sequence);
+		}
+	}
+
+	if (base == SIGHASH_NONE)
+	{
+		count = 0;
+	}
+	else if (base == SIGHASH_SINGLE)
+	{
+		count = input + 1;
+	}
+	else
+	{
+		count = txview_get_output_count(tx);
+	}
+	sighash_write_compact(sh->hash, count);
+	for (i = 0; i < count; ++i)
+	{
+		if (base == SIGHASH_SINGLE && i != input)
+		{
+			// A blank output: an amount of -1 and no script.
+			sighash_write_uint64(sh->hash, UINT64_MAX);
+			sighash_write_compact(sh->hash, 0);
+			continue;
+		}
+		out = txview_get_output(tx, i);
+		sighash_write_output(sh->hash, out);
+	}
+
+	sighash_write_uint32(sh->hash, txview_get_lock_time(tx));
+	sighash_write_uint32(sh->hash, (uint32_t)hash_type);
+
+	return crypto_hash_final_double(output, sh->hash);
+}
+
+/*
+ * BIP143: a fixed size preimage that commits to the amount being spent
+ * and reuses the digests of the prevouts, sequences and outputs, so the
+ * cost of hashing an input no longer grows with the transaction.
+ */
+int sighash_witness_v0(unsigned char *output, Sighash sh, size_t input, const unsigned char *script_code, size_t script_code_len, uint64_t amount, int hash_type)
+{
+	size_t base;
+	unsigned char zero[SIGHASH_LEN];
+	unsigned char single[SIGHASH_LEN];
+	const struct TxViewInput *in;
+	TxView tx;
+
+	assert(output);
+	assert(sh);
+	assert(sh->tx);
+	assert(input < txview_get_input_count(sh->tx));
+	assert(script_code || script_code_len == 0);
+
+	tx = sh->tx;
+	base = (size_t)(hash_type & SIGHASH_TYPE_MASK);
+	in = txview_get_input(tx, input);
+
+	if (!sh->cached)
+	{
+		sighash_cache(sh);
+	}
+	if (sh->v0_prefix_type != hash_type)
+	{
+		sighash_set_v0_prefix(sh, hash_type);
+	}
+
+	memset(zero, 0, SIGHASH_LEN);
+
+	if (base == SIGHASH_SINGLE && input < txview_get_output_count(tx))
+	{
+		sighash_write_output(sh->hash, txview_get_output(tx, input));
+		crypto_hash_final_double(single, sh->hash);
+	}
+
+	if (crypto_hash_restore(sh->work, sh->v0_prefix) < 0)
+	{
+		error_log("Could not start signature hash.");
+		return -1;
+	}
+	crypto_hash_write(sh->work, in->prev_hash, TXVIEW_HASH_LEN);
+	sighash_write_uint32(sh->work, in->prev_index);
+	sighash_write_compact(sh->work, script_code_len);
+	crypto_hash_write(sh->work, script_code, script_code_len);
+	sighash_write_uint64(sh->work, amount);
+	sighash_write_uint32(sh->work, in->sequence);
+	if (base != SIGHASH_SINGLE && base != SIGHASH_NONE)
+	{
+		crypto_hash_write(sh->work, sh->outputs, SIGHASH_LEN);
+	}
+	else if (base == SIGHASH_SINGLE && input < txview_get_output_count(tx))
+	{
+		crypto_hash_write(sh->work, single, SIGHASH_LEN);
+	}
+	else
+	{
+		crypto_hash_write(sh->work, zero, SIGHASH_LEN);
+	}
+	sighash_write_uint32(sh->work, txview_get_lock_time(tx));
+	sighash_write_uint32(sh->work, (uint32_t)hash_type);
+
+	return crypto_hash_final_double(output, sh->work);
+}
+
+/*
+ * BIP341: a tagged hash of the transaction data and the spent outputs,
+ * with the annex if there is one and, for script path spends, the leaf
+ * being executed and the position of its last OP_CODESEPARATOR. Pass a
+ * NULL leaf hash for a key path spend. Returns -1 for hash types that
+ * don't exist and for SIGHASH_SINGLE without a matching output, both of
+ * which make the signature invalid.
+ */
+int sighash_taproot(unsigned char *output, Sighash sh, size_t input, int hash_type, const unsigned char *annex, size_t annex_len, const unsigned char *leaf_hash, uint32_t codesep_pos)
+{
+	int out_type;
+	unsigned char spend_type, key_version;
+	unsigned char annex_hash[SIGHASH_LEN];
+	unsigned char single[SIGHASH_LEN];
+	const struct TxViewInput *in;
+	const struct SighashPrevout *spent;
+	TxView tx;
+
+	assert(output);
+	assert(sh);
+	assert(sh->tx);
+	assert(sh->spent);
+	assert(input < txview_get_input_count(sh->tx));
+	assert(annex || annex_len == 0);
+
+	tx = sh->tx;
+	out_type = hash_type & SIGHASH_OUTPUT_MASK;
+
+	if (hash_type & ~(SIGHASH_ANYONECANPAY | SIGHASH_OUTPUT_MASK) || hash_type == SIGHASH_ANYONECANPAY)
+	{
+		error_log("Unknown signature hash type (%i).", hash_type);
+		return -1;
+	}
+	if (out_type == SIGHASH_SINGLE && input >= txview_get_output_count(tx))
+	{
+		error_log("SIGHASH_SINGLE input %lu has no matching output.", (unsigned long)input);
+		return -1;
+	}
+
+	if (!sh->tap_cached)
+	{
+		sighash_cache_taproot(sh);
+	}
+	if (sh->tap_prefix_type != hash_type)
+	{
+		sighash_set_tap_prefix(sh, hash_type);
+	}
+
+	in = txview_get_input(tx, input);
+	spent = &sh->spent[input];
+
+	if (annex_len > 0)
+	{
+		sighash_write_compact(sh->hash, annex_len);
+		crypto_hash_write(sh->hash, annex, annex_len);
+		crypto_hash_final(annex_hash, sh->hash);
+	}
+	if (out_type == SIGHASH_SINGLE)
+	{
+		sighash_write_output(sh->hash, txview_get_output(tx, input));
+		crypto_hash_final(single, sh->hash);
+	}
+
+	if (crypto_hash_restore(sh->work, sh->tap_prefix) < 0)
+	{
+		error_log("Could not start signature hash.");
+		return -1;
+	}
+
+	spend_type = (unsigned char)((leaf_hash ? SIGHASH_EXT_SCRIPT : 0) | (annex_len > 0 ? SIGHASH_ANNEX : 0));
+	crypto_hash_write(sh->work, &spend_type, 1);
+
+	if (hash_type & SIGHASH_ANYONECANPAY)
+	{
+		crypto_hash_write(sh->work, in->prev_hash, TXVIEW_HASH_LEN);
+		sighash_write_uint32(sh->work, in->prev_index);
+		sighash_write_uint64(sh->work, spent->amount);
+		sighash_write_compact(sh->work, spent->script_len);
+		crypto_hash_write(sh->work, spent->script, spent->script_len);
+		sighash_write_uint32(sh->work, in->sequence);
+	}
+	else
+	{
+		sighash_write_uint32(sh->work, (uint32_t)input);
+	}
+
+	if (annex_len > 0)
+	{
+		crypto_hash_write(sh->work, annex_hash, SIGHASH_LEN);
+	}
+	if (out_type == SIGHASH_SINGLE)
+	{
+		crypto_hash_write(sh->work, single, SIGHASH_LEN);
+	}
+
+	if (leaf_hash)
+	{
+		key_version = 0;
+		crypto_hash_write(sh->work, leaf_hash, SIGHASH_LEN);
+		crypto_hash_write(sh->work, &key_version, 1);
+		sighash_write_uint32(sh->work, codesep_pos);
+	}
+
+	return crypto_hash_final(output, sh->work);
+}
+
+void sighash_clear(Sighash sh)
+{
+	size_t i;
+	CryptoHash hashes[5];
+
+	assert(sh);
+
+	hashes[0] = sh->hash;
+	hashes[1] = sh->work;
+	hashes[2] = sh->tag;
+	hashes[3] = sh->v0_prefix;
+	hashes[4] = sh->tap_prefix;
+
+	for (i = 0; i < sizeof(hashes) / sizeof(*hashes); ++i)
+	{
+		if (hashes[i] != NULL)
+		{
+			crypto_hash_close(hashes[i]);
+			free(hashes[i]);
+		}
+	}
+
+	memset(sh, 0, sizeof(*sh));
+}
+
+size_t sighash_sizeof(void)
+{
+	return sizeof(struct Sighash);
+}
+
+static void sighash_write_uint32(CryptoHash h, uint32_t value)
+{
+	unsigned char b[4];
+
+	b[0] = (unsigned char)(value & 0xff);
+	b[1] = (unsigned char)((value >> 8) & 0xff);
+	b[2] = (unsigned char)((value >> 16) & 0xff);
+	b[3] = (unsigned char)((value >> 24) & 0xff);
+
+	crypto_hash_write(h, b, 4);
+}
+
+static void sighash_write_uint64(CryptoHash h, uint64_t value)
+{
+	sighash_write_uint32(h, (uint32_t)(value & 0xffffffff));
+	sighash_write_uint32(h, (uint32_t)(value >> 32));
+}
+
+static void sighash_write_compact(CryptoHash h, uint64_t value)
+{
+	unsigned char b;
+
+	if (value < 0xfd)
+	{
+		b = (unsigned char)value;
+		crypto_hash_write(h, &b, 1);
+	}
+	else if (value <= 0xffff)
+	{
+		unsigned char w[3] = {0xfd, (unsigned char)(value & 0xff), (unsigned char)(value >> 8)};
+		crypto_hash_write(h, w, 3);
+	}
+	else if (value <= 0xffffffff)
+	{
+		b = 0xfe;
+		crypto_hash_write(h, &b, 1);
+		sighash_write_uint32(h, (uint32_t)value);
+	}
+	else
+	{
+		b = 0xff;
+		crypto_hash_write(h, &b, 1);
+		sighash_write_uint64(h, value);
+	}
+}
+
+static void sighash_write_output(CryptoHash h, const struct TxViewOutput *out)
+{
+	sighash_write_uint64(h, out->amount);
+	sighash_write_compact(h, out->script_len);
+	crypto_hash_write(h, out->script, out->script_len);
+}
+
+/*
+ * The script code with every OP_CODESEPARATOR dropped, written in runs
+ * between them.
+ */
+static void sighash_write_script_code(CryptoHash h, const unsigned char *script, size_t len)
+{
+	int op;
+	size_t pc, prev, start, data, data_len, stripped;
+
+	for (stripped = len, pc = 0; pc < len; )
+	{
+		op = script_next_op(&pc, &data, &data_len, script, len);
+		if (op < 0)
+		{
+			break;
+		}
+		if (op == SCRIPT_OP_CODESEPARATOR)
+		{
+			stripped--;
+		}
+	}
+	sighash_write_compact(h, stripped);
+
+	if (stripped == len)
+	{
+		crypto_hash_write(h, script, len);
+		return;
+	}
+
+	for (start = 0, pc = 0; pc < len; )
+	{
+		prev = pc;
+		op = script_next_op(&pc, &data, &data_len, script, len);
+		if (op < 0)
+		{
+			pc = len;
+			break;
+		}
+		if (op == SCRIPT_OP_CODESEPARATOR)
+		{
+			crypto_hash_write(h, script + start, prev - start);
+			start = pc;
+		}
+	}
+	crypto_hash_write(h, script + start, len - start);
+}
+
+/*
+ * The BIP341 digests are single SHA256 and the BIP143 ones double, so
+ * the latter are just the former hashed once more.
+ */
+static void sighash_cache(Sighash sh)
+{
+	size_t i;
+	const struct TxViewInput *in;
+	TxView tx = sh->tx;
+
+	for (i = 0; i < txview_get_input_count(tx); ++i)
+	{
+		in = txview_get_input(tx, i);
+		crypto_hash_write(sh->hash, in->prev_hash, TXVIEW_HASH_LEN);
+		sighash_write_uint32(sh->hash, in->prev_index);
+	}
+	crypto_hash_final(sh->sha_prevouts, sh->hash);
+
+	for (i = 0; i < txview_get_input_count(tx); ++i)
+	{
+		sighash_write_uint32(sh->hash, txview_get_input(tx, i)->sequence);
+	}
+	crypto_hash_final(sh->sha_sequences, sh->hash);
+
+	for (i = 0; i < txview_get_output_count(tx); ++i)
+	{
+		sighash_write_output(sh->hash, txview_get_output(tx, i));
+	}
+	crypto_hash_final(sh->sha_outputs, sh->hash);
+
+	crypto_hash_write(sh->hash, sh->sha_prevouts, SIGHASH_LEN);
+	crypto_hash_final(sh->prevouts, sh->hash);
+	crypto_hash_write(sh->hash, sh->sha_sequences, SIGHASH_LEN);
+	crypto_hash_final(sh->sequences, sh->hash);
+	crypto_hash_write(sh->hash, sh->sha_outputs, SIGHASH_LEN);
+	crypto_hash_final(sh->outputs, sh->hash);
+
+	sh->cached = 1;
+}
+
+static void sighash_cache_taproot(Sighash sh)
+{
+	size_t i;
+
+	if (!sh->cached)
+	{
+		sighash_cache(sh);
+	}
+
+	for (i = 0; i < sh->spent_count; ++i)
+	{
+		sighash_write_uint64(sh->hash, sh->spent[i].amount);
+	}
+	crypto_hash_final(sh->sha_amounts, sh->hash);
+
+	for (i = 0; i < sh->spent_count; ++i)
+	{
+		sighash_write_compact(sh->hash, sh->spent[i].script_len);
+		crypto_hash_write(sh->hash, sh->spent[i].script, sh->spent[i].script_len);
+	}
+	crypto_hash_final(sh->sha_scripts, sh->hash);
+
+	sh->tap_cached = 1;
+}
+
+/*
+ * The BIP143 preimage up to the outpoint: the version and the prevouts
+ * and sequences digests, or zeros where the hash type leaves them out.
+ * sh->hash is idle between hashes and so always empty here.
+ */
+static void sighash_set_v0_prefix(Sighash sh, int hash_type)
+{
+	size_t base;
+	unsigned char zero[SIGHASH_LEN];
+
+	base = (size_t)(hash_type & SIGHASH_TYPE_MASK);
+
+	memset(zero, 0, SIGHASH_LEN);
+
+	crypto_hash_restore(sh->v0_prefix, sh->hash);
+	sighash_write_uint32(sh->v0_prefix, txview_get_version(sh->tx));
+	crypto_hash_write(sh->v0_prefix, (hash_type & SIGHASH_ANYONECANPAY) ? zero : sh->prevouts, SIGHASH_LEN);
+	if ((hash_type & SIGHASH_ANYONECANPAY) || base == SIGHASH_SINGLE || base == SIGHASH_NONE)
+	{
+		crypto_hash_write(sh->v0_prefix, zero, SIGHASH_LEN);
+	}
+	else
+	{
+		crypto_hash_write(sh->v0_prefix, sh->sequences, SIGHASH_LEN);
+	}
+
+	sh->v0_prefix_type = hash_type;
+}
+
+/*
+ * The BIP341 message up to the spend type, which is everything that
+ * doesn't depend on the input, after the tag.
+ */
+static void sighash_set_tap_prefix(Sighash sh, int hash_type)
+{
+	unsigned char b;
+	int out_type = hash_type & SIGHASH_OUTPUT_MASK;
+
+	crypto_hash_restore(sh->tap_prefix, sh->tag);
+
+	b = SIGHASH_EPOCH;
+	crypto_hash_write(sh->tap_prefix, &b, 1);
+	b = (unsigned char)hash_type;
+	crypto_hash_write(sh->tap_prefix, &b, 1);
+	sighash_write_uint32(sh->tap_prefix, txview_get_version(sh->tx));
+	sighash_write_uint32(sh->tap_prefix, txview_get_lock_time(sh->tx));
+	if (!(hash_type & SIGHASH_ANYONECANPAY))
+	{
+		crypto_hash_write(sh->tap_prefix, sh->sha_prevouts, SIGHASH_LEN);
+		crypto_hash_write(sh->tap_prefix, sh->sha_amounts, SIGHASH_LEN);
+		crypto_hash_write(sh->tap_prefix, sh->sha_scripts, SIGHASH_LEN);
+		crypto_hash_write(sh->tap_prefix, sh->sha_sequences, SIGHASH_LEN);
+	}
+	if (out_type != SIGHASH_NONE && out_type != SIGHASH_SINGLE)
+	{
+		crypto_hash_write(sh->tap_prefix, sh->sha_outputs, SIGHASH_LEN);
+	}
+
+	sh->tap_prefix_type = hash_type;
+}
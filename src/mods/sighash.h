@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef SIGHASH_H
+#define SIGHASH_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include "txview.h"
+
+#define SIGHASH_LEN           32
+#define SIGHASH_ALL           0x01
+#define SIGHASH_NONE          0x02
+#define SIGHASH_SINGLE        0x03
+#define SIGHASH_ANYONECANPAY  0x80
+#define SIGHASH_DEFAULT       0x00
+#define SIGHASH_CODESEP_NONE  0xffffffff
+
+typedef struct Sighash *Sighash;
+
+/*
+ * The output an input spends. Taproot signatures commit to all of them,
+ * not just the one being signed.
+ */
+struct SighashPrevout
+{
+	uint64_t amount;
+	const unsigned char *script;
+	size_t script_len;
+};
+
+int sighash_new(Sighash);
+void sighash_set_tx(Sighash, TxView);
+int sighash_legacy(unsigned char *, Sighash, size_t, const unsigned char *, size_t, int);
+void sighash_set_prevouts(Sighash, const struct SighashPrevout *, size_t);
+int sighash_witness_v0(unsigned char *, Sighash, size_t, const unsigned char *, size_t, uint64_t, int);
+int sighash_taproot(unsigned char *, Sighash, size_t, int, const unsigned char *, size_t, const unsigned char *, uint32_t);
+void sighash_clear(Sighash);
+size_t sighash_sizeof(void);
+
+#endif
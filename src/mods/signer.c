@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <assert.h>
+#include "signer.h"
+#include "ecdsa.h"
+#include "schnorr.h"
+#include "threadpool.h"
+#include "hex.h"
+#include "error.h"
+
+#define SIGNER_LINE_LEN  (ECDSA_DER_LEN_MAX * 2 + 2)
+
+struct SignerBatch;
+
+/*
+ * A run of consecutive hashes in a batch, signed by one worker.
+ */
+struct SignerJob
+{
+	Signer signer;
+	struct SignerBatch *batch;
+	size_t first;
+	size_t count;
+	int failed;
+};
+
+struct SignerBatch
+{
+	unsigned char hashes[SIGNER_BATCH_HASHES][ECDSA_HASH_LEN];
+	unsigned char aux[SIGNER_BATCH_HASHES][ECDSA_HASH_LEN];
+	char lines[SIGNER_BATCH_HASHES][SIGNER_LINE_LEN];
+	size_t count;
+	struct SignerJob jobs[SIGNER_BATCH_HASHES / SIGNER_JOB_HASHES];
+	size_t job_count;
+	size_t pending;
+	int submitted;
+};
+
+/*
+ * Signs hashes with one key on a pool of threads, each with its own
+ * ECDSA or Schnorr context and so its own generator table. Hashes are
+ * collected into one batch while the workers sign the other, and
+ * signatures are written one per line in the order the hashes came in.
+ */
+struct Signer
+{
+	ThreadPool pool;
+	int threads;
+	int format;
+	FILE *output;
+	unsigned char key[ECDSA_SCALAR_LEN];
+	Ecdsa ecdsa[THREADPOOL_THREADS_MAX];
+	Schnorr schnorr[THREADPOOL_THREADS_MAX];
+	struct SignerBatch *batches[2];
+	int current;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+	uint64_t count;
+};
+
+static int signer_dispatch(Signer);
+static int signer_wait(Signer, struct SignerBatch *);
+static void signer_worker(void *, int);
+
+int signer_new(Signer s, int threads, const unsigned char *privkey, int format, FILE *output)
+{
+	int i, r;
+	unsigned char hash[ECDSA_HASH_LEN];
+	unsigned char sig_r[ECDSA_SCALAR_LEN], sig_s[ECDSA_SCALAR_LEN];
+	unsigned char pubkey[SCHNORR_PUBKEY_LEN];
+
+	assert(s);
+	assert(privkey);
+	assert(format == SIGNER_FORMAT_DER || format == SIGNER_FORMAT_COMPACT || format == SIGNER_FORMAT_SCHNORR);
+	assert(output);
+
+	memset(s, 0, sizeof(*s));
+
+	if (threads < 1 || threads > THREADPOOL_THREADS_MAX)
+	{
+		error_log("Thread count must be between 1 and %i.", THREADPOOL_THREADS_MAX);
+		return -1;
+	}
+
+	s->threads = threads;
+	s->format = format;
+	s->output = output;
+	memcpy(s->key, privkey, ECDSA_SCALAR_LEN);
+
+	s->batches[0] = malloc(sizeof(struct SignerBatch));
+	s->batches[1] = malloc(sizeof(struct SignerBatch));
+	if (s->batches[0] == NULL || s->batches[1] == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	memset(s->batches[0], 0, sizeof(struct SignerBatch));
+	memset(s->batches[1], 0, sizeof(struct SignerBatch));
+
+	for (i = 0; i < threads; ++i)
+	{
+		if (format == SIGNER_FORMAT_SCHNORR)
+		{
+			s->schnorr[i] = malloc(schnorr_sizeof());
+			if (s->schnorr[i] == NULL)
+			{
+				error_log("Memory allocation error.");
+				return -1;
+			}
+			if (schnorr_new(s->schnorr[i]) < 0)
+			{
+				free(s->schnorr[i]);
+				s->schnorr[i] = NULL;
+				return -1;
+			}
+		}
+		else
+		{
+			s->ecdsa[i] = malloc(ecdsa_sizeof());
+			if (s->ecdsa[i] == NULL)
+			{
+				error_log("Memory allocation error.");
+				return -1;
+			}
+			ecdsa_new(s->ecdsa[i]);
+		}
+	}
+
+	// One signature, or for Schnorr the public key, up front turns away a
+	// key that's out of range before any hashes are read.
+	memset(hash, 0, ECDSA_HASH_LEN);
+	if (format == SIGNER_FORMAT_SCHNORR)
+	{
+		r = schnorr_pubkey(s->schnorr[0], pubkey, s->key);
+	}
+	else
+	{
+		r = ecdsa_sign(s->ecdsa[0], sig_r, sig_s, hash, s->key);
+	}
+	if (r < 0)
+	{
+		error_log("Could not sign with this private key.");
+		return -1;
+	}
+
+	s->pool = malloc(threadpool_sizeof());
+	if (s->pool == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	pthread_mutex_init(&s->lock, NULL);
+	pthread_cond_init(&s->done, NULL);
+
+	r = threadpool_new(s->pool, threads, (size_t)threads * 16);
+	if (r < 0)
+	{
+		error_log("Could not start signing threads.");
+		free(s->pool);
+		s->pool = NULL;
+		pthread_mutex_destroy(&s->lock);
+		pthread_cond_destroy(&s->done);
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Queue a 32 byte hash to be signed. aux is 32 bytes of auxiliary
+ * randomness for a Schnorr nonce, or NULL for zeros, and is ignored for
+ * ECDSA. Signatures are written as batches fill, so output lags input by
+ * up to two batches until signer_finish().
+ */
+int signer_add(Signer s, const unsigned char *hash, const unsigned char *aux)
+{
+	struct SignerBatch *batch;
+
+	assert(s);
+	assert(hash);
+
+	batch = s->batches[s->current];
+	if (aux != NULL)
+	{
+		memcpy(batch->aux[batch->count], aux, ECDSA_HASH_LEN);
+	}
+	else
+	{
+		memset(batch->aux[batch->count], 0, ECDSA_HASH_LEN);
+	}
+	memcpy(batch->hashes[batch->count++], hash, ECDSA_HASH_LEN);
+
+	if (batch->count == SIGNER_BATCH_HASHES)
+	{
+		return signer_dispatch(s);
+	}
+
+	return 1;
+}
+
+/*
+ * Sign whatever is queued and write out every signature.
+ */
+int signer_finish(Signer s)
+{
+	assert(s);
+
+	if (signer_dispatch(s) < 0)
+	{
+		return -1;
+	}
+
+	// The batch just dispatched, if there was one, is now the other.
+	return signer_wait(s, s->batches[!s->current]);
+}
+
+uint64_t signer_get_count(Signer s)
+{
+	assert(s);
+
+	return s->count;
+}
+
+void signer_clear(Signer s)
+{
+	int i;
+
+	assert(s);
+
+	if (s->pool != NULL)
+	{
+		threadpool_clear(s->pool);
+		free(s->pool);
+		pthread_mutex_destroy(&s->lock);
+		pthread_cond_destroy(&s->done);
+	}
+	for (i = 0; i < s->threads; ++i)
+	{
+		if (s->ecdsa[i] != NULL)
+		{
+			ecdsa_clear(s->ecdsa[i]);
+			free(s->ecdsa[i]);
+		}
+		if (s->schnorr[i] != NULL)
+		{
+			schnorr_clear(s->schnorr[i]);
+			free(s->schnorr[i]);
+		}
+	}
+	free(s->batches[0]);
+	free(s->batches[1]);
+
+	memset(s, 0, sizeof(*s));
+}
+
+size_t signer_sizeof(void)
+{
+	return sizeof(struct Signer);
+}
+
+/*
+ * Split the filling batch into jobs and hand it to the workers, then
+ * wait out the batch before it and start filling that one.
+ */
+static int signer_dispatch(Signer s)
+{
+	size_t i;
+	struct SignerBatch *batch;
+	struct SignerJob *job;
+
+	batch = s->batches[s->current];
+	if (batch->count == 0)
+	{
+		return 1;
+	}
+
+	batch->job_count = 0;
+	for (i = 0; i < batch->count; i += SIGNER_JOB_HASHES)
+	{
+		job = &batch->jobs[batch->job_count++];
+		job->signer = s;
+		job->batch = batch;
+		job->first = i;
+		job->count = (batch->count - i < SIGNER_JOB_HASHES) ? batch->count - i : SIGNER_JOB_HASHES;
+		job->failed = 0;
+	}
+
+	batch->pending = batch->job_count;
+	batch->submitted = 1;
+	for (i = 0; i < batch->job_count; ++i)
+	{
+		if (threadpool_add(s->pool, signer_worker, &batch->jobs[i]) < 0)
+		{
+			return -1;
+		}
+	}
+
+	s->current = !s->current;
+
+	return signer_wait(s, s->batches[s->current]);
+}
+
+/*
+ * Wait for a submitted batch, write out its signatures and empty it.
+ */
+static int signer_wait(Signer s, struct SignerBatch *batch)
+{
+	size_t i;
+
+	if (!batch->submitted)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&s->lock);
+	while (batch->pending > 0)
+	{
+		pthread_cond_wait(&s->done, &s->lock);
+	}
+	pthread_mutex_unlock(&s->lock);
+
+	for (i = 0; i < batch->job_count; ++i)
+	{
+		if (batch->jobs[i].failed)
+		{
+			error_log("Could not sign hash %"PRIu64".", s->count + batch->jobs[i].first + 1);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < batch->count; ++i)
+	{
+		if (fputs(batch->lines[i], s->output) == EOF)
+		{
+			error_log("Could not write signature. Errno %i.", errno);
+			return -1;
+		}
+	}
+
+	s->count += batch->count;
+	batch->count = 0;
+	batch->job_count = 0;
+	batch->submitted = 0;
+
+	return 1;
+}
+
+/*
+ * Runs on a worker thread, so it only touches its job's slice of the
+ * batch and this thread's signing context.
+ */
+static void signer_worker(void *arg, int thread)
+{
+	size_t i, len;
+	unsigned char sig[ECDSA_DER_LEN_MAX];
+	unsigned char sig_r[ECDSA_SCALAR_LEN], sig_s[ECDSA_SCALAR_LEN];
+	struct SignerJob *job = arg;
+	struct SignerBatch *batch = job->batch;
+	Signer s = job->signer;
+	Ecdsa e = s->ecdsa[thread];
+	Schnorr sc = s->schnorr[thread];
+
+	for (i = job->first; i < job->first + job->count; ++i)
+	{
+		if (s->format == SIGNER_FORMAT_SCHNORR)
+		{
+			if (schnorr_sign(sc, sig, batch->hashes[i], s->key, batch->aux[i]) < 0)
+			{
+				job->failed = 1;
+				break;
+			}
+			len = SCHNORR_SIG_LEN;
+		}
+		else if (ecdsa_sign(e, sig_r, sig_s, batch->hashes[i], s->key) < 0)
+		{
+			job->failed = 1;
+			break;
+		}
+		else if (s->format == SIGNER_FORMAT_COMPACT)
+		{
+			memcpy(sig, sig_r, ECDSA_SCALAR_LEN);
+			memcpy(sig + ECDSA_SCALAR_LEN, sig_s, ECDSA_SCALAR_LEN);
+			len = ECDSA_SCALAR_LEN * 2;
+		}
+		else
+		{
+			len = ecdsa_to_der(sig, sig_r, sig_s);
+		}
+		hex_raw_to_str(batch->lines[i], sig, len);
+		batch->lines[i][len * 2] = '\n';
+		batch->lines[i][len * 2 + 1] = '\0';
+	}
+
+	pthread_mutex_lock(&s->lock);
+	if (--batch->pending == 0)
+	{
+		pthread_cond_broadcast(&s->done);
+	}
+	pthread_mutex_unlock(&s->lock);
+}
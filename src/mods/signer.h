@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef SIGNER_H
+#define SIGNER_H 1
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIGNER_FORMAT_DER      1
+#define SIGNER_FORMAT_COMPACT  2
+#define SIGNER_FORMAT_SCHNORR  3
+#define SIGNER_BATCH_HASHES    0x1000
+#define SIGNER_JOB_HASHES      64
+
+typedef struct Signer *Signer;
+
+int signer_new(Signer, int, const unsigned char *, int, FILE *);
+int signer_add(Signer, const unsigned char *, const unsigned char *);
+int signer_finish(Signer);
+uint64_t signer_get_count(Signer);
+void signer_clear(Signer);
+size_t signer_sizeof(void);
+
+#endif
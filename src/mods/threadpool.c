@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assert.h>
+#include "threadpool.h"
+#include "error.h"
+
+struct ThreadPoolJob
+{
+	void (*fn)(void *, int);
+	void *arg;
+};
+
+struct ThreadPoolWorker
+{
+	ThreadPool pool;
+	int number;
+};
+
+struct ThreadPool
+{
+	pthread_mutex_t lock;
+	pthread_cond_t has_job;
+	pthread_cond_t has_room;
+	pthread_cond_t idle;
+	pthread_t threads[THREADPOOL_THREADS_MAX];
+	struct ThreadPoolWorker workers[THREADPOOL_THREADS_MAX];
+	int thread_count;
+	struct ThreadPoolJob *queue;
+	size_t queue_len;
+	size_t head;
+	size_t count;
+	int active;
+	int stop;
+};
+
+static void *threadpool_worker(void *);
+
+/*
+ * Start a fixed number of worker threads fed from a bounded queue. Jobs
+ * are called with their argument and the number of the worker running
+ * them, so callers can keep per-thread state in a plain array.
+ */
+int threadpool_new(ThreadPool pool, int threads, size_t queue_len)
+{
+	int i, r;
+
+	assert(pool);
+	assert(queue_len);
+
+	if (threads < 1 || threads > THREADPOOL_THREADS_MAX)
+	{
+		error_log("Thread count must be between 1 and %i.", THREADPOOL_THREADS_MAX);
+		return -1;
+	}
+
+	pool->queue = malloc(sizeof(struct ThreadPoolJob) * queue_len);
+	if (pool->queue == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	pool->queue_len = queue_len;
+	pool->head = 0;
+	pool->count = 0;
+	pool->active = 0;
+	pool->stop = 0;
+	pool->thread_count = 0;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->has_job, NULL);
+	pthread_cond_init(&pool->has_room, NULL);
+	pthread_cond_init(&pool->idle, NULL);
+
+	for (i = 0; i < threads; ++i)
+	{
+		pool->workers[i].pool = pool;
+		pool->workers[i].number = i;
+		r = pthread_create(&pool->threads[i], NULL, threadpool_worker, &pool->workers[i]);
+		if (r != 0)
+		{
+			error_log("Could not start worker thread. Error %i.", r);
+			threadpool_clear(pool);
+			return -1;
+		}
+		pool->thread_count++;
+	}
+
+	return 1;
+}
+
+/*
+ * Queue a job, waiting for room if the queue is full. The wait is what
+ * keeps a fast producer from running arbitrarily far ahead of the workers.
+ */
+int threadpool_add(ThreadPool pool, void (*fn)(void *, int), void *arg)
+{
+	assert(pool);
+	assert(fn);
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (pool->count == pool->queue_len && !pool->stop)
+	{
+		pthread_cond_wait(&pool->has_room, &pool->lock);
+	}
+
+	if (pool->stop)
+	{
+		pthread_mutex_unlock(&pool->lock);
+		error_log("Thread pool is shutting down.");
+		return -1;
+	}
+
+	pool->queue[(pool->head + pool->count) % pool->queue_len].fn = fn;
+	pool->queue[(pool->head + pool->count) % pool->queue_len].arg = arg;
+	pool->count++;
+
+	pthread_cond_signal(&pool->has_job);
+	pthread_mutex_unlock(&pool->lock);
+
+	return 1;
+}
+
+/*
+ * Block until the queue is empty and every worker is idle.
+ */
+void threadpool_wait(ThreadPool pool)
+{
+	assert(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->count > 0 || pool->active > 0)
+	{
+		pthread_cond_wait(&pool->idle, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Finish the queued jobs, then stop and join the workers.
+ */
+void threadpool_clear(ThreadPool pool)
+{
+	int i;
+
+	assert(pool);
+
+	threadpool_wait(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->has_job);
+	pthread_cond_broadcast(&pool->has_room);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->thread_count; ++i)
+	{
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->has_job);
+	pthread_cond_destroy(&pool->has_room);
+	pthread_cond_destroy(&pool->idle);
+
+	free(pool->queue);
+	pool->queue = NULL;
+	pool->thread_count = 0;
+}
+
+/*
+ * A sensible default thread count: the number of online processors.
+ */
+int threadpool_get_threads(void)
+{
+	long n;
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1)
+	{
+		return 1;
+	}
+	if (n > THREADPOOL_THREADS_MAX)
+	{
+		return THREADPOOL_THREADS_MAX;
+	}
+
+	return (int)n;
+}
+
+size_t threadpool_sizeof(void)
+{
+	return sizeof(struct ThreadPool);
+}
+
+static void *threadpool_worker(void *arg)
+{
+	struct ThreadPoolWorker *worker = arg;
+	ThreadPool pool = worker->pool;
+	struct ThreadPoolJob job;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;)
+	{
+		while (pool->count == 0 && !pool->stop)
+		{
+			pthread_cond_wait(&pool->has_job, &pool->lock);
+		}
+		if (pool->count == 0 && pool->stop)
+		{
+			break;
+		}
+
+		job = pool->queue[pool->head];
+		pool->head = (pool->head + 1) % pool->queue_len;
+		pool->count--;
+		pool->active++;
+		pthread_cond_signal(&pool->has_room);
+		pthread_mutex_unlock(&pool->lock);
+
+		job.fn(job.arg, worker->number);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->active--;
+		if (pool->count == 0 && pool->active == 0)
+		{
+			pthread_cond_broadcast(&pool->idle);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H 1
+
+#include <stddef.h>
+
+#define THREADPOOL_THREADS_MAX  256
+
+typedef struct ThreadPool *ThreadPool;
+
+int threadpool_new(ThreadPool, int, size_t);
+int threadpool_add(ThreadPool, void (*)(void *, int), void *);
+void threadpool_wait(ThreadPool);
+void threadpool_clear(ThreadPool);
+int threadpool_get_threads(void);
+size_t threadpool_sizeof(void);
+
+#endif
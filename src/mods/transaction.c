@@ -12,122 +12,191 @@
 #include "transaction.h"
 #include "txinput.h"
 #include "txoutput.h"
-#include "hex.h"
-#include "compactuint.h"
+#include "txview.h"
 #include "error.h"
 
+static int transaction_copy(unsigned char **, const unsigned char *, size_t);
+
+/*
+ * Parse a legacy or BIP144 segwit transaction into a Trans that owns
+ * copies of its scripts and witnesses, for callers that need the
+ * transaction to outlive the input buffer. The parsing and hashing are
+ * TxView's; this only copies out what the view points at. Returns the
+ * number of bytes consumed.
+ */
 int transaction_from_raw(Trans trans, unsigned char *input, size_t input_len)
 {
-	int r;
-	size_t i, c;
+	int r, len;
+	size_t i, j;
+	TxView tx;
+	TXInput in;
+	TXOutput out;
+	const struct TxViewInput *view_in;
+	const struct TxViewOutput *view_out;
+	const struct TxViewItem *item;
+	unsigned char hash[TRANSACTION_HASH_LEN];
 
 	assert(trans);
 	assert(input);
 	assert(input_len);
 
-	// Get Version
-	for (trans->version = 0, i = 0; i < sizeof(trans->version); ++i, ++input, --input_len)
+	memset(trans, 0, sizeof(*trans));
+
+	tx = malloc(txview_sizeof());
+	if (tx == NULL)
 	{
-		if (input_len == 0)
-		{
-			error_log("Transaction data is incomplete.");
-			return -1;
-		}
-		trans->version += (((size_t)*input) << (i * 8)); // Reverse byte order
+		error_log("Memory allocation error.");
+		return -1;
 	}
-	
-	// Number of Inputs
-	r = compactuint_get_value(&trans->input_count, input, input_len);
-	if (r < 0)
+	txview_new(tx);
+
+	len = txview_parse(tx, input, input_len);
+	if (len < 0)
 	{
-		error_log("Could not parse compact size integer from transaction data.");
+		error_log("Could not parse transaction.");
+		txview_clear(tx);
+		free(tx);
 		return -1;
 	}
-	c = r; // quick fix - make prettier later
-	input += c;
-	input_len = (c > input_len) ? 0 : input_len - c;
-	if (input_len == 0)
+
+	trans->version = txview_get_version(tx);
+	trans->segwit = txview_is_segwit(tx);
+	trans->lock_time = txview_get_lock_time(tx);
+	trans->input_count = txview_get_input_count(tx);
+	trans->output_count = txview_get_output_count(tx);
+
+	// Hashes are kept in display order, as the byte order they're
+	// printed and looked up in.
+	r = txview_get_txid(hash, tx);
+	for (i = 0; r > 0 && i < TRANSACTION_HASH_LEN; ++i)
 	{
-		error_log("Transaction data is incomplete.");
-		return -1;
+		trans->txid[i] = hash[TRANSACTION_HASH_LEN - 1 - i];
+	}
+	if (r > 0)
+	{
+		r = txview_get_wtxid(hash, tx);
 	}
-	
-	// Input Transactions
-	trans->inputs = malloc(sizeof(TXInput) * trans->input_count);
-	if (trans->inputs == NULL)
+	for (i = 0; r > 0 && i < TRANSACTION_HASH_LEN; ++i)
+	{
+		trans->wtxid[i] = hash[TRANSACTION_HASH_LEN - 1 - i];
+	}
+
+	trans->inputs = calloc(trans->input_count ? trans->input_count : 1, sizeof(TXInput));
+	trans->outputs = calloc(trans->output_count ? trans->output_count : 1, sizeof(TXOutput));
+	if (trans->inputs == NULL || trans->outputs == NULL)
 	{
 		error_log("Memory allocation error.");
-		return -1;
+		r = -1;
 	}
-	for (i = 0; i < trans->input_count; ++i)
+
+	for (i = 0; r > 0 && i < trans->input_count; ++i)
 	{
-		r = txinput_from_raw(trans->inputs[i], input, input_len);
-		if (r < 0)
+		in = trans->inputs[i] = calloc(1, sizeof(struct TXInput));
+		if (in == NULL)
 		{
-			error_log("Could not parse transaction inputs.");
-			return -1;
+			error_log("Memory allocation error.");
+			r = -1;
+			break;
 		}
-		c = r; // quick fix - make prettier later
-		input += c;
-		input_len = (c > input_len) ? 0 : input_len - c;
-		if (input_len == 0)
+
+		view_in = txview_get_input(tx, i);
+		for (j = 0; j < TRANSACTION_HASH_LEN; ++j)
 		{
-			error_log("Transaction data is incomplete.");
-			return -1;
+			in->tx_hash[j] = view_in->prev_hash[TRANSACTION_HASH_LEN - 1 - j];
+		}
+		in->index = view_in->prev_index;
+		in->sequence = view_in->sequence;
+		in->script_size = view_in->script_len;
+		r = transaction_copy(&in->script_raw, view_in->script, view_in->script_len);
+		if (r < 0 || view_in->witness_count == 0)
+		{
+			continue;
+		}
+
+		in->witness_size = malloc(sizeof(uint64_t) * view_in->witness_count);
+		in->witness = calloc(view_in->witness_count, sizeof(unsigned char *));
+		if (in->witness_size == NULL || in->witness == NULL)
+		{
+			error_log("Memory allocation error.");
+			r = -1;
+			break;
+		}
+		for (j = 0; r > 0 && j < view_in->witness_count; ++j)
+		{
+			item = txview_get_witness(tx, i, j);
+			in->witness_size[j] = item->len;
+			r = transaction_copy(&in->witness[j], item->data, item->len);
+			in->witness_count++;
 		}
 	}
-	
-	// Number of Outputs
-	r = compactuint_get_value(&trans->output_count, input, input_len);
-	if (r < 0)
-	{
-		error_log("Could not parse compact size integer from transaction data.");
-		return -1;
-	}
-	c = r; // quick fix - make prettier later
-	input += c;
-	input_len = (c > input_len) ? 0 : input_len - c;
-	if (input_len == 0)
+
+	for (i = 0; r > 0 && i < trans->output_count; ++i)
 	{
-		error_log("Transaction data is incomplete.");
-		return -1;
+		out = trans->outputs[i] = calloc(1, sizeof(struct TXOutput));
+		if (out == NULL)
+		{
+			error_log("Memory allocation error.");
+			r = -1;
+			break;
+		}
+
+		view_out = txview_get_output(tx, i);
+		out->amount = view_out->amount;
+		out->script_size = view_out->script_len;
+		r = transaction_copy(&out->script_raw, view_out->script, view_out->script_len);
 	}
-	
-	// Output Transactions
-	trans->outputs = malloc(sizeof(TXOutput) * trans->output_count);
-	if (trans->outputs == NULL)
+
+	txview_clear(tx);
+	free(tx);
+
+	if (r < 0)
 	{
-		error_log("Memory allocation error.");
+		transaction_free(trans);
 		return -1;
 	}
-	for (i = 0; i < trans->output_count; ++i)
+
+	return len;
+}
+
+void transaction_free(Trans trans)
+{
+	size_t i;
+
+	assert(trans);
+
+	for (i = 0; trans->inputs != NULL && i < trans->input_count; ++i)
 	{
-		r = txoutput_from_raw(trans->outputs[i], input, input_len);
-		if (r < 0)
+		if (trans->inputs[i] != NULL)
 		{
-			error_log("Could not parse transaction outputs.");
-			return -1;
-		}
-		c = r;
-		input += c;
-		input_len = (c > input_len) ? 0 : input_len - c;
-		if (input_len == 0)
-		{
-			error_log("Transaction data is incomplete.");
-			return -1;
+			txinput_free(trans->inputs[i]);
+			free(trans->inputs[i]);
 		}
 	}
-	
-	// Lock Time
-	for (trans->lock_time = 0, i = 0; i < sizeof(trans->lock_time); ++i, ++input, --input_len)
+	for (i = 0; trans->outputs != NULL && i < trans->output_count; ++i)
 	{
-		if (input_len == 0)
+		if (trans->outputs[i] != NULL)
 		{
-			error_log("Transaction data is incomplete.");
-			return -1;
+			txoutput_free(trans->outputs[i]);
+			free(trans->outputs[i]);
 		}
-		trans->lock_time += (((size_t)*input) << (i * 8)); // Reverse byte order
 	}
-	
+	free(trans->inputs);
+	free(trans->outputs);
+	trans->inputs = NULL;
+	trans->outputs = NULL;
+	trans->input_count = 0;
+	trans->output_count = 0;
+}
+
+static int transaction_copy(unsigned char **output, const unsigned char *input, size_t input_len)
+{
+	*output = malloc(input_len ? input_len : 1);
+	if (*output == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	memcpy(*output, input, input_len);
+
 	return 1;
 }
@@ -12,16 +12,22 @@
 #include "txinput.h"
 #include "txoutput.h"
 
+#define TRANSACTION_HASH_LEN 32
+
 typedef struct Trans *Trans;
 struct Trans {
-	uint32_t  version;
-	uint64_t  input_count;
-	TXInput  *inputs;
-	uint64_t  output_count;
-	TXOutput *outputs;
-	uint32_t  lock_time;
+	uint32_t       version;
+	int            segwit;
+	uint64_t       input_count;
+	TXInput       *inputs;
+	uint64_t       output_count;
+	TXOutput      *outputs;
+	uint32_t       lock_time;
+	unsigned char  txid[TRANSACTION_HASH_LEN];
+	unsigned char  wtxid[TRANSACTION_HASH_LEN];
 };
 
 int transaction_from_raw(Trans, unsigned char *, size_t);
+void transaction_free(Trans);
 
 #endif
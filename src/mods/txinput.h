@@ -8,17 +8,21 @@
 #ifndef TXINPUT_H
 #define TXINPUT_H 1
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct TXInput *TXInput;
 struct TXInput {
-	unsigned char  tx_hash[32];
-	uint32_t       index;
-	uint64_t       script_size;
-	unsigned char* script_raw;
-	uint32_t       sequence;
+	unsigned char   tx_hash[32];
+	uint32_t        index;
+	uint64_t        script_size;
+	unsigned char*  script_raw;
+	uint32_t        sequence;
+	uint64_t        witness_count;
+	uint64_t*       witness_size;
+	unsigned char** witness;
 };
 
-int txinput_from_raw(TXInput, unsigned char *, size_t);
+void txinput_free(TXInput);
 
 #endif
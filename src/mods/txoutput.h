@@ -8,6 +8,7 @@
 #ifndef TXOUTPUT_H
 #define TXOUTPUT_H 1
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct TXOutput *TXOutput;
@@ -17,6 +18,6 @@ struct TXOutput {
 	unsigned char* script_raw;
 };
 
-int txoutput_from_raw(TXOutput, unsigned char *, size_t);
+void txoutput_free(TXOutput);
 
 #endif
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "txverify.h"
+#include "interp.h"
+#include "sighash.h"
+#include "ecdsa.h"
+#include "schnorr.h"
+#include "error.h"
+
+#define TXVERIFY_LOCKTIME_THRESHOLD  500000000
+#define TXVERIFY_SEQUENCE_FINAL      0xffffffff
+#define TXVERIFY_SEQUENCE_DISABLE    (1U << 31)
+#define TXVERIFY_SEQUENCE_TYPE       (1U << 22)
+#define TXVERIFY_SEQUENCE_MASK       0x0000ffff
+
+/*
+ * Verifies the inputs of one transaction at a time against the outputs
+ * they spend. Owns everything that takes allocating, so a thread can
+ * keep one and verify without touching the heap.
+ *
+ * With batching on, Schnorr signatures are taken as valid and queued to
+ * be checked together by txverify_batch_verify(). Every signature is
+ * counted only once that batch has passed, since if it fails the inputs
+ * are verified over again and count their ECDSA signatures a second time.
+ */
+struct TxVerify
+{
+	Interp interp;
+	Sighash sighash;
+	Ecdsa ecdsa;
+	Schnorr schnorr;
+	TxView tx;
+	int has_prevouts;
+	int batch;
+	size_t input;
+	uint64_t amount;
+	uint64_t sig_count;
+	uint64_t batch_sig_count;
+	struct InterpChecker checker;
+};
+
+static int txverify_check_sig(void *, const unsigned char *, size_t, const unsigned char *, size_t, const unsigned char *, size_t, int);
+static int txverify_check_schnorr(void *, const unsigned char *, size_t, const unsigned char *, const struct InterpTapData *);
+static int txverify_check_locktime(void *, int64_t);
+static int txverify_check_sequence(void *, int64_t);
+
+int txverify_new(TxVerify v)
+{
+	assert(v);
+
+	memset(v, 0, sizeof(*v));
+
+	v->interp = malloc(interp_sizeof());
+	v->sighash = malloc(sighash_sizeof());
+	v->ecdsa = malloc(ecdsa_sizeof());
+	v->schnorr = malloc(schnorr_sizeof());
+	if (v->interp == NULL || v->sighash == NULL || v->ecdsa == NULL || v->schnorr == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	if (interp_new(v->interp) < 0 || sighash_new(v->sighash) < 0 || ecdsa_new(v->ecdsa) < 0 || schnorr_new(v->schnorr) < 0)
+	{
+		error_log("Could not create transaction verifier.");
+		return -1;
+	}
+
+	v->checker.check_sig = txverify_check_sig;
+	v->checker.check_schnorr = txverify_check_schnorr;
+	v->checker.check_locktime = txverify_check_locktime;
+	v->checker.check_sequence = txverify_check_sequence;
+	v->checker.ctx = v;
+
+	return 1;
+}
+
+/*
+ * Start on a transaction. Must be called again whenever the view is
+ * reparsed.
+ */
+void txverify_set_tx(TxVerify v, TxView tx)
+{
+	assert(v);
+	assert(tx);
+
+	v->tx = tx;
+	v->has_prevouts = 0;
+	sighash_set_tx(v->sighash, tx);
+}
+
+/*
+ * Give the outputs spent by every input of the transaction, in input
+ * order, after txverify_set_tx(). Taproot signatures commit to all of
+ * them, so without this they never verify.
+ */
+void txverify_set_prevouts(TxVerify v, const struct SighashPrevout *prevouts, size_t count)
+{
+	assert(v);
+	assert(v->tx);
+
+	sighash_set_prevouts(v->sighash, prevouts, count);
+	v->has_prevouts = 1;
+}
+
+/*
+ * Turn batching of Schnorr signatures on or off. Turning it off drops
+ * whatever is queued.
+ */
+void txverify_set_batch(TxVerify v, int batch)
+{
+	assert(v);
+
+	v->batch = batch;
+	if (!batch)
+	{
+		schnorr_batch_reset(v->schnorr);
+		v->batch_sig_count = 0;
+	}
+}
+
+/*
+ * Check that an input satisfies the output it spends, given that
+ * output's script and amount. Returns 1 if it does, or -1 with the
+ * reason logged.
+ */
+int txverify_input(TxVerify v, size_t input, const unsigned char *script, size_t script_len, uint64_t amount, int flags)
+{
+	const struct TxViewInput *in;
+	const struct TxViewItem *witness;
+
+	assert(v);
+	assert(v->tx);
+	assert(input < txview_get_input_count(v->tx));
+
+	v->input = input;
+	v->amount = amount;
+
+	in = txview_get_input(v->tx, input);
+	witness = (in->witness_count > 0) ? txview_get_witness(v->tx, input, 0) : NULL;
+
+	return interp_verify(v->interp, in->script, in->script_len, script, script_len, witness, in->witness_count, flags, &v->checker);
+}
+
+/*
+ * Check the Schnorr signatures queued since the last call. Returns 1 if
+ * they are all valid, and 0 if any isn't, in which case the inputs since
+ * then have to be verified again without batching to find out which.
+ */
+int txverify_batch_verify(TxVerify v)
+{
+	int r;
+
+	assert(v);
+
+	r = schnorr_batch_verify(v->schnorr);
+	if (r == 1)
+	{
+		v->sig_count += v->batch_sig_count;
+	}
+	v->batch_sig_count = 0;
+
+	return r == 1;
+}
+
+/*
+ * The number of signatures checked so far.
+ */
+uint64_t txverify_get_sig_count(TxVerify v)
+{
+	assert(v);
+
+	return v->sig_count;
+}
+
+void txverify_clear(TxVerify v)
+{
+	assert(v);
+
+	if (v->interp != NULL)
+	{
+		interp_clear(v->interp);
+		free(v->interp);
+	}
+	if (v->sighash != NULL)
+	{
+		sighash_clear(v->sighash);
+		free(v->sighash);
+	}
+	if (v->ecdsa != NULL)
+	{
+		ecdsa_clear(v->ecdsa);
+		free(v->ecdsa);
+	}
+	if (v->schnorr != NULL)
+	{
+		schnorr_clear(v->schnorr);
+		free(v->schnorr);
+	}
+
+	memset(v, 0, sizeof(*v));
+}
+
+size_t txverify_sizeof(void)
+{
+	return sizeof(struct TxVerify);
+}
+
+/*
+ * The signature ends in its hash type byte. Anything that doesn't parse
+ * or verify is just a false result; the interpreter has already applied
+ * whatever encoding rules the flags call for.
+ */
+static int txverify_check_sig(void *ctx, const unsigned char *sig, size_t sig_len, const unsigned char *pubkey, size_t pubkey_len, const unsigned char *script_code, size_t script_code_len, int sigversion)
+{
+	int r, hash_type;
+	unsigned char hash[SIGHASH_LEN];
+	unsigned char sig_r[ECDSA_SCALAR_LEN], sig_s[ECDSA_SCALAR_LEN];
+	TxVerify v = ctx;
+
+	if (sig_len == 0)
+	{
+		return 0;
+	}
+	hash_type = sig[sig_len - 1];
+
+	if (ecdsa_parse_der(sig_r, sig_s, sig, sig_len - 1) < 0)
+	{
+		return 0;
+	}
+
+	if (sigversion == INTERP_SIGVERSION_WITNESS_V0)
+	{
+		r = sighash_witness_v0(hash, v->sighash, v->input, script_code, script_code_len, v->amount, hash_type);
+	}
+	else
+	{
+		r = sighash_legacy(hash, v->sighash, v->input, script_code, script_code_len, hash_type);
+	}
+	if (r < 0)
+	{
+		return 0;
+	}
+
+	if (v->batch)
+	{
+		v->batch_sig_count++;
+	}
+	else
+	{
+		v->sig_count++;
+	}
+
+	return ecdsa_verify(v->ecdsa, hash, sig_r, sig_s, pubkey, pubkey_len) == 1;
+}
+
+/*
+ * BIP341: a 65 byte signature ends in its hash type, and a 64 byte one
+ * implies SIGHASH_DEFAULT.
+ */
+static int txverify_check_schnorr(void *ctx, const unsigned char *sig, size_t sig_len, const unsigned char *pubkey, const struct InterpTapData *tap)
+{
+	int hash_type;
+	unsigned char hash[SIGHASH_LEN];
+	TxVerify v = ctx;
+
+	if (!v->has_prevouts)
+	{
+		error_log("Taproot signature needs the outputs the transaction spends.");
+		return 0;
+	}
+
+	hash_type = (sig_len == SCHNORR_SIG_LEN + 1) ? sig[SCHNORR_SIG_LEN] : SIGHASH_DEFAULT;
+	if (sighash_taproot(hash, v->sighash, v->input, hash_type, tap->annex, tap->annex_len, tap->leaf_hash, tap->codesep_pos) < 0)
+	{
+		return 0;
+	}
+
+	if (v->batch)
+	{
+		v->batch_sig_count++;
+		return schnorr_batch_add(v->schnorr, sig, hash, pubkey) == 1;
+	}
+
+	v->sig_count++;
+
+	return schnorr_verify(v->schnorr, sig, hash, pubkey) == 1;
+}
+
+/*
+ * BIP65: the lock time must be of the same kind as the transaction's,
+ * block height or time, and no later than it, and the input must not
+ * be final or the transaction's lock time wouldn't apply.
+ */
+static int txverify_check_locktime(void *ctx, int64_t locktime)
+{
+	int64_t tx_locktime;
+	TxVerify v = ctx;
+
+	tx_locktime = (int64_t)txview_get_lock_time(v->tx);
+
+	if ((tx_locktime < TXVERIFY_LOCKTIME_THRESHOLD) != (locktime < TXVERIFY_LOCKTIME_THRESHOLD))
+	{
+		return 0;
+	}
+	if (locktime > tx_locktime)
+	{
+		return 0;
+	}
+	if (txview_get_input(v->tx, v->input)->sequence == TXVERIFY_SEQUENCE_FINAL)
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * BIP112: the same comparison against the input's relative lock time,
+ * which only exists from version 2 and while not disabled.
+ */
+static int txverify_check_sequence(void *ctx, int64_t sequence)
+{
+	uint32_t tx_sequence, tx_masked, masked;
+	TxVerify v = ctx;
+
+	tx_sequence = txview_get_input(v->tx, v->input)->sequence;
+
+	if (txview_get_version(v->tx) < 2)
+	{
+		return 0;
+	}
+	if (tx_sequence & TXVERIFY_SEQUENCE_DISABLE)
+	{
+		return 0;
+	}
+
+	tx_masked = tx_sequence & (TXVERIFY_SEQUENCE_TYPE | TXVERIFY_SEQUENCE_MASK);
+	masked = (uint32_t)sequence & (TXVERIFY_SEQUENCE_TYPE | TXVERIFY_SEQUENCE_MASK);
+
+	if ((tx_masked < TXVERIFY_SEQUENCE_TYPE) != (masked < TXVERIFY_SEQUENCE_TYPE))
+	{
+		return 0;
+	}
+	if (masked > tx_masked)
+	{
+		return 0;
+	}
+
+	return 1;
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef TXVERIFY_H
+#define TXVERIFY_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include "txview.h"
+#include "sighash.h"
+
+typedef struct TxVerify *TxVerify;
+
+int txverify_new(TxVerify);
+void txverify_set_tx(TxVerify, TxView);
+void txverify_set_prevouts(TxVerify, const struct SighashPrevout *, size_t);
+void txverify_set_batch(TxVerify, int);
+int txverify_input(TxVerify, size_t, const unsigned char *, size_t, uint64_t, int);
+int txverify_batch_verify(TxVerify);
+uint64_t txverify_get_sig_count(TxVerify);
+void txverify_clear(TxVerify);
+size_t txverify_sizeof(void);
+
+#endif
@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "txview.h"
+#include "crypto.h"
+#include "error.h"
+
+#define TXVIEW_INPUT_MIN_LEN   41
+#define TXVIEW_OUTPUT_MIN_LEN  9
+#define TXVIEW_INITIAL         16
+
+struct TxView
+{
+	unsigned char *raw;
+	size_t len;
+	uint32_t version;
+	uint32_t lock_time;
+	int segwit;
+	size_t io_start;
+	size_t io_end;
+	CryptoHash hash;
+	struct TxViewInput *inputs;
+	size_t input_count;
+	size_t input_cap;
+	struct TxViewOutput *outputs;
+	size_t output_count;
+	size_t output_cap;
+	struct TxViewItem *items;
+	size_t item_count;
+	size_t item_cap;
+};
+
+struct TxViewCursor
+{
+	unsigned char *p;
+	unsigned char *end;
+};
+
+static int txview_read_uint32(uint32_t *, struct TxViewCursor *);
+static int txview_read_uint64(uint64_t *, struct TxViewCursor *);
+static int txview_read_compact(uint64_t *, struct TxViewCursor *);
+static int txview_read_bytes(const unsigned char **, size_t, struct TxViewCursor *);
+static int txview_reserve(void **, size_t *, size_t, size_t);
+static int txview_hash_open(TxView);
+
+int txview_new(TxView tx)
+{
+	assert(tx);
+
+	memset(tx, 0, sizeof(*tx));
+
+	return 1;
+}
+
+/*
+ * Parse the serialized transaction at the start of input in a single pass,
+ * recording where each field lives rather than copying it. The arrays
+ * behind the view are kept and reused by the next parse, so scanning many
+ * transactions with one view allocates only while it warms up. Returns
+ * the number of bytes the transaction occupies.
+ */
+int txview_parse(TxView tx, unsigned char *input, size_t input_len)
+{
+	size_t i, j;
+	uint64_t count, len;
+	struct TxViewCursor c;
+	struct TxViewInput *in;
+	struct TxViewOutput *out;
+	int has_witness;
+
+	assert(tx);
+	assert(input);
+
+	c.p = input;
+	c.end = input + input_len;
+
+	tx->raw = input;
+	tx->segwit = 0;
+	tx->input_count = tx->output_count = tx->item_count = 0;
+
+	if (!txview_read_uint32(&tx->version, &c))
+	{
+		goto incomplete;
+	}
+
+	// BIP144 marker and flag. A legacy transaction can't have zero
+	// inputs, so a zero here can only be the marker.
+	if (c.end - c.p >= 2 && c.p[0] == 0x00)
+	{
+		if (c.p[1] != 0x01)
+		{
+			error_log("Transaction has an unknown segwit flag (%i).", c.p[1]);
+			return -1;
+		}
+		tx->segwit = 1;
+		c.p += 2;
+	}
+
+	tx->io_start = (size_t)(c.p - input);
+
+	if (!txview_read_compact(&count, &c))
+	{
+		goto incomplete;
+	}
+	if (count > (size_t)(c.end - c.p) / TXVIEW_INPUT_MIN_LEN)
+	{
+		goto incomplete;
+	}
+	if (txview_reserve((void **)&tx->inputs, &tx->input_cap, count, sizeof(*tx->inputs)) < 0)
+	{
+		return -1;
+	}
+	for (i = 0; i < count; ++i)
+	{
+		in = &tx->inputs[i];
+		if (!txview_read_bytes(&in->prev_hash, TXVIEW_HASH_LEN, &c) ||
+		    !txview_read_uint32(&in->prev_index, &c) ||
+		    !txview_read_compact(&len, &c) ||
+		    !txview_read_bytes(&in->script, len, &c) ||
+		    !txview_read_uint32(&in->sequence, &c))
+		{
+			goto incomplete;
+		}
+		in->script_len = (size_t)len;
+		in->witness_start = 0;
+		in->witness_count = 0;
+	}
+	tx->input_count = (size_t)count;
+
+	if (!txview_read_compact(&count, &c))
+	{
+		goto incomplete;
+	}
+	if (count > (size_t)(c.end - c.p) / TXVIEW_OUTPUT_MIN_LEN)
+	{
+		goto incomplete;
+	}
+	if (txview_reserve((void **)&tx->outputs, &tx->output_cap, count, sizeof(*tx->outputs)) < 0)
+	{
+		return -1;
+	}
+	for (i = 0; i < count; ++i)
+	{
+		out = &tx->outputs[i];
+		if (!txview_read_uint64(&out->amount, &c) ||
+		    !txview_read_compact(&len, &c) ||
+		    !txview_read_bytes(&out->script, len, &c))
+		{
+			goto incomplete;
+		}
+		out->script_len = (size_t)len;
+	}
+	tx->output_count = (size_t)count;
+
+	tx->io_end = (size_t)(c.p - input);
+
+	if (tx->segwit)
+	{
+		has_witness = 0;
+		for (i = 0; i < tx->input_count; ++i)
+		{
+			in = &tx->inputs[i];
+			if (!txview_read_compact(&count, &c) || count > (size_t)(c.end - c.p))
+			{
+				goto incomplete;
+			}
+			if (txview_reserve((void **)&tx->items, &tx->item_cap, tx->item_count + count, sizeof(*tx->items)) < 0)
+			{
+				return -1;
+			}
+			in->witness_start = tx->item_count;
+			in->witness_count = (size_t)count;
+			for (j = 0; j < count; ++j)
+			{
+				if (!txview_read_compact(&len, &c) || !txview_read_bytes(&tx->items[tx->item_count].data, len, &c))
+				{
+					goto incomplete;
+				}
+				tx->items[tx->item_count++].len = (size_t)len;
+			}
+			has_witness |= (count > 0);
+		}
+		if (!has_witness)
+		{
+			error_log("Transaction has a segwit marker but no witness data.");
+			return -1;
+		}
+	}
+
+	if (!txview_read_uint32(&tx->lock_time, &c))
+	{
+		goto incomplete;
+	}
+
+	tx->len = (size_t)(c.p - input);
+
+	return (int)tx->len;
+
+incomplete:
+	error_log("Transaction data is incomplete.");
+	return -1;
+}
+
+/*
+ * The txid commits to the transaction without its marker, flag and
+ * witnesses. Those sit in two spots, so rather than reserializing the
+ * transaction, hash the three byte ranges around them directly.
+ * Output is in internal byte order.
+ */
+int txview_get_txid(unsigned char *output, TxView tx)
+{
+	int r;
+
+	assert(output);
+	assert(tx);
+	assert(tx->raw);
+
+	r = txview_hash_open(tx);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	crypto_hash_write(tx->hash, tx->raw, 4);
+	crypto_hash_write(tx->hash, tx->raw + tx->io_start, tx->io_end - tx->io_start);
+	crypto_hash_write(tx->hash, tx->raw + tx->len - 4, 4);
+
+	return crypto_hash_final_double(output, tx->hash);
+}
+
+/*
+ * The wtxid covers the whole serialized transaction. For a transaction
+ * without witnesses it's the same as the txid.
+ */
+int txview_get_wtxid(unsigned char *output, TxView tx)
+{
+	int r;
+
+	assert(output);
+	assert(tx);
+	assert(tx->raw);
+
+	r = txview_hash_open(tx);
+	if (r < 0)
+	{
+		return -1;
+	}
+
+	crypto_hash_write(tx->hash, tx->raw, tx->len);
+
+	return crypto_hash_final_double(output, tx->hash);
+}
+
+uint32_t txview_get_version(TxView tx)
+{
+	assert(tx);
+
+	return tx->version;
+}
+
+uint32_t txview_get_lock_time(TxView tx)
+{
+	assert(tx);
+
+	return tx->lock_time;
+}
+
+int txview_is_segwit(TxView tx)
+{
+	assert(tx);
+
+	return tx->segwit;
+}
+
+size_t txview_get_len(TxView tx)
+{
+	assert(tx);
+
+	return tx->len;
+}
+
+size_t txview_get_input_count(TxView tx)
+{
+	assert(tx);
+
+	return tx->input_count;
+}
+
+size_t txview_get_output_count(TxView tx)
+{
+	assert(tx);
+
+	return tx->output_count;
+}
+
+const struct TxViewInput *txview_get_input(TxView tx, size_t i)
+{
+	assert(tx);
+	assert(i < tx->input_count);
+
+	return &tx->inputs[i];
+}
+
+const struct TxViewOutput *txview_get_output(TxView tx, size_t i)
+{
+	assert(tx);
+	assert(i < tx->output_count);
+
+	return &tx->outputs[i];
+}
+
+/*
+ * Item j of input i's witness stack.
+ */
+const struct TxViewItem *txview_get_witness(TxView tx, size_t i, size_t j)
+{
+	assert(tx);
+	assert(i < tx->input_count);
+	assert(j < tx->inputs[i].witness_count);
+
+	return &tx->items[tx->inputs[i].witness_start + j];
+}
+
+void txview_clear(TxView tx)
+{
+	assert(tx);
+
+	if (tx->hash != NULL)
+	{
+		crypto_hash_close(tx->hash);
+		free(tx->hash);
+	}
+	free(tx->inputs);
+	free(tx->outputs);
+	free(tx->items);
+	memset(tx, 0, sizeof(*tx));
+}
+
+size_t txview_sizeof(void)
+{
+	return sizeof(struct TxView);
+}
+
+static int txview_read_uint32(uint32_t *output, struct TxViewCursor *c)
+{
+	if (c->end - c->p < 4)
+	{
+		return 0;
+	}
+
+	*output = (uint32_t)c->p[0] | ((uint32_t)c->p[1] << 8) | ((uint32_t)c->p[2] << 16) | ((uint32_t)c->p[3] << 24);
+	c->p += 4;
+
+	return 1;
+}
+
+static int txview_read_uint64(uint64_t *output, struct TxViewCursor *c)
+{
+	uint32_t lo, hi;
+
+	if (!txview_read_uint32(&lo, c) || !txview_read_uint32(&hi, c))
+	{
+		return 0;
+	}
+
+	*output = (uint64_t)lo | ((uint64_t)hi << 32);
+
+	return 1;
+}
+
+static int txview_read_compact(uint64_t *output, struct TxViewCursor *c)
+{
+	int i, n;
+
+	if (c->p >= c->end)
+	{
+		return 0;
+	}
+
+	if (*c->p < 0xfd)
+	{
+		*output = *c->p++;
+		return 1;
+	}
+
+	n = (*c->p == 0xfd) ? 2 : ((*c->p == 0xfe) ? 4 : 8);
+	if (c->end - c->p < n + 1)
+	{
+		return 0;
+	}
+
+	c->p++;
+	for (*output = 0, i = 0; i < n; ++i)
+	{
+		*output |= (uint64_t)*c->p++ << (i * 8);
+	}
+
+	return 1;
+}
+
+static int txview_read_bytes(const unsigned char **output, size_t len, struct TxViewCursor *c)
+{
+	if ((size_t)(c->end - c->p) < len)
+	{
+		return 0;
+	}
+
+	*output = c->p;
+	c->p += len;
+
+	return 1;
+}
+
+static int txview_reserve(void **array, size_t *cap, size_t want, size_t size)
+{
+	size_t new_cap;
+	void *tmp;
+
+	if (want <= *cap)
+	{
+		return 1;
+	}
+
+	for (new_cap = (*cap > 0) ? *cap : TXVIEW_INITIAL; new_cap < want; new_cap *= 2)
+		;
+
+	tmp = realloc(*array, new_cap * size);
+	if (tmp == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	*array = tmp;
+	*cap = new_cap;
+
+	return 1;
+}
+
+/*
+ * The hash context is opened on first use and kept with the view.
+ */
+static int txview_hash_open(TxView tx)
+{
+	if (tx->hash != NULL)
+	{
+		return 1;
+	}
+
+	tx->hash = malloc(crypto_hash_sizeof());
+	if (tx->hash == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	if (crypto_hash_open(tx->hash, CRYPTO_SHA256) < 0)
+	{
+		error_log("Could not open transaction hash.");
+		free(tx->hash);
+		tx->hash = NULL;
+		return -1;
+	}
+
+	return 1;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef TXVIEW_H
+#define TXVIEW_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TXVIEW_COMMAND  "tx"
+#define TXVIEW_HASH_LEN 32
+
+/*
+ * Every pointer in these structs points into the buffer handed to
+ * txview_parse(), which must outlive the view.
+ */
+struct TxViewInput
+{
+	const unsigned char *prev_hash;
+	uint32_t prev_index;
+	const unsigned char *script;
+	size_t script_len;
+	uint32_t sequence;
+	size_t witness_start;
+	size_t witness_count;
+};
+
+struct TxViewOutput
+{
+	uint64_t amount;
+	const unsigned char *script;
+	size_t script_len;
+};
+
+struct TxViewItem
+{
+	const unsigned char *data;
+	size_t len;
+};
+
+typedef struct TxView *TxView;
+
+int txview_new(TxView);
+int txview_parse(TxView, unsigned char *, size_t);
+int txview_get_txid(unsigned char *, TxView);
+int txview_get_wtxid(unsigned char *, TxView);
+uint32_t txview_get_version(TxView);
+uint32_t txview_get_lock_time(TxView);
+int txview_is_segwit(TxView);
+size_t txview_get_len(TxView);
+size_t txview_get_input_count(TxView);
+size_t txview_get_output_count(TxView);
+const struct TxViewInput *txview_get_input(TxView, size_t);
+const struct TxViewOutput *txview_get_output(TxView, size_t);
+const struct TxViewItem *txview_get_witness(TxView, size_t, size_t);
+void txview_clear(TxView);
+size_t txview_sizeof(void);
+
+#endif
@@ -0,0 +1,858 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include "utxo.h"
+#include "arena.h"
+#include "txview.h"
+#include "script.h"
+#include "block.h"
+#include "hex.h"
+#include "error.h"
+
+#define UTXO_MAGIC         "BTKUTXO1"
+#define UTXO_MAGIC_LEN     8
+#define UTXO_INITIAL       0x10000
+#define UTXO_PATH_MAXLEN   4096
+#define UTXO_WRITE_BATCH   4096
+#define UTXO_OP_RETURN     0x6a
+
+/*
+ * Snapshot layout: this header, then every slot of the hash table as a
+ * UtxoRecord, then the scripts that didn't compress. A reader can map the
+ * file and probe the table in place.
+ */
+struct UtxoHeader
+{
+	char magic[UTXO_MAGIC_LEN];
+	uint32_t blocks;
+	uint32_t reserved;
+	unsigned char tip[BLOCK_HASH_LEN];
+	uint64_t count;
+	uint64_t slots;
+	uint64_t heap_len;
+	uint64_t amount;
+};
+
+struct Utxo
+{
+	struct UtxoRecord *records;
+	size_t cap;
+	uint64_t count;
+	uint64_t amount;
+	uint32_t blocks;
+	unsigned char tip[BLOCK_HASH_LEN];
+	Arena arena;
+	TxView tx;
+	unsigned char *map;
+	size_t map_size;
+	const unsigned char *heap;
+	uint64_t heap_len;
+	UtxoSpendHook spend_hook;
+	void *spend_ctx;
+};
+
+static int utxo_alloc(Utxo, size_t);
+static size_t utxo_slot(Utxo, const unsigned char *, uint32_t);
+static int utxo_insert(Utxo, const unsigned char *, uint32_t, uint64_t, int, const unsigned char *, size_t);
+static int utxo_spend(Utxo, const unsigned char *, uint32_t);
+static void utxo_remove(Utxo, size_t);
+static int utxo_grow(Utxo);
+static int utxo_map(Utxo, const char *);
+static size_t utxo_hash(const unsigned char *, uint32_t);
+
+int utxo_new(Utxo utxo)
+{
+	assert(utxo);
+
+	memset(utxo, 0, sizeof(*utxo));
+
+	utxo->arena = malloc(arena_sizeof());
+	utxo->tx = malloc(txview_sizeof());
+	if (utxo->arena == NULL || utxo->tx == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	arena_new(utxo->arena, ARENA_CHUNK_DEFAULT);
+	txview_new(utxo->tx);
+
+	return utxo_alloc(utxo, UTXO_INITIAL);
+}
+
+/*
+ * Have every output a block spends passed to hook, in input order, just
+ * before it leaves the set. The coinbase spends nothing. If the hook
+ * fails, so does the block.
+ */
+void utxo_set_spend_hook(Utxo utxo, UtxoSpendHook hook, void *ctx)
+{
+	assert(utxo);
+
+	utxo->spend_hook = hook;
+	utxo->spend_ctx = ctx;
+}
+
+/*
+ * Apply the next block in height order: spend the outputs its inputs
+ * point at, then add its own outputs. Provably unspendable outputs are
+ * never added, and neither is the genesis coinbase, which bitcoin core
+ * never put in its coin database and so can't be spent.
+ */
+int utxo_add_block(Utxo utxo, unsigned char *block, size_t block_len)
+{
+	int r;
+	uint64_t i, tx_count;
+	size_t j, len;
+	unsigned char *input;
+	unsigned char txid[UTXO_TXID_LEN];
+	const struct TxViewInput *in;
+	const struct TxViewOutput *out;
+
+	assert(utxo);
+	assert(utxo->map == NULL);
+	assert(block);
+
+	r = block_get_tx_start(&tx_count, block, block_len);
+	if (r < 0)
+	{
+		error_log("Could not parse block at height %"PRIu32".", utxo->blocks);
+		return -1;
+	}
+	input = block + r;
+	len = block_len - r;
+
+	for (i = 0; i < tx_count; ++i)
+	{
+		r = txview_parse(utxo->tx, input, len);
+		if (r < 0)
+		{
+			error_log("Could not parse transaction %"PRIu64" of block at height %"PRIu32".", i, utxo->blocks);
+			return -1;
+		}
+		input += r;
+		len -= r;
+
+		if (txview_get_txid(txid, utxo->tx) < 0)
+		{
+			return -1;
+		}
+
+		// The coinbase's only input doesn't spend anything.
+		for (j = 0; i > 0 && j < txview_get_input_count(utxo->tx); ++j)
+		{
+			in = txview_get_input(utxo->tx, j);
+			if (utxo_spend(utxo, in->prev_hash, in->prev_index) < 0)
+			{
+				return -1;
+			}
+		}
+
+		for (j = 0; utxo->blocks > 0 && j < txview_get_output_count(utxo->tx); ++j)
+		{
+			out = txview_get_output(utxo->tx, j);
+			if (out->script_len > UTXO_SCRIPT_MAX || (out->script_len > 0 && out->script[0] == UTXO_OP_RETURN))
+			{
+				continue;
+			}
+			if (utxo_insert(utxo, txid, (uint32_t)j, out->amount, i == 0, out->script, out->script_len) < 0)
+			{
+				return -1;
+			}
+		}
+	}
+
+	r = block_get_hash(utxo->tip, block, block_len);
+	if (r < 0)
+	{
+		return -1;
+	}
+	utxo->blocks++;
+
+	return 1;
+}
+
+/*
+ * Write the set to a snapshot. It goes to a temporary file first and is
+ * renamed over the old one, so an interrupted save leaves the last good
+ * snapshot in place.
+ */
+int utxo_save(Utxo utxo, const char *path)
+{
+	size_t i, j, n;
+	uint64_t offset;
+	unsigned char *script;
+	char tmp_path[UTXO_PATH_MAXLEN];
+	struct UtxoHeader header;
+	struct UtxoRecord *batch;
+	FILE *fp;
+
+	assert(utxo);
+	assert(utxo->map == NULL);
+	assert(path);
+
+	if (strlen(path) + 5 > UTXO_PATH_MAXLEN)
+	{
+		error_log("Snapshot path is too long.");
+		return -1;
+	}
+	snprintf(tmp_path, UTXO_PATH_MAXLEN, "%s.tmp", path);
+
+	batch = malloc(sizeof(*batch) * UTXO_WRITE_BATCH);
+	if (batch == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+
+	fp = fopen(tmp_path, "wb");
+	if (fp == NULL)
+	{
+		error_log("Unable to open snapshot file %s. Errno %i.", tmp_path, errno);
+		free(batch);
+		return -1;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, UTXO_MAGIC, UTXO_MAGIC_LEN);
+	header.blocks = utxo->blocks;
+	memcpy(header.tip, utxo->tip, BLOCK_HASH_LEN);
+	header.count = utxo->count;
+	header.slots = utxo->cap;
+	header.amount = utxo->amount;
+	header.heap_len = utxo->heap_len;
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1)
+	{
+		goto write_error;
+	}
+
+	// Records go out in batches with script pointers swapped for heap
+	// offsets. The scripts follow in the same order.
+	offset = 0;
+	for (i = 0; i < utxo->cap; i += n)
+	{
+		n = (utxo->cap - i < UTXO_WRITE_BATCH) ? utxo->cap - i : UTXO_WRITE_BATCH;
+		memcpy(batch, utxo->records + i, sizeof(*batch) * n);
+		for (j = 0; j < n; ++j)
+		{
+			if (batch[j].type == UTXO_TYPE_RAW)
+			{
+				memcpy(batch[j].script, &offset, sizeof(offset));
+				offset += batch[j].script_len;
+			}
+		}
+		if (fwrite(batch, sizeof(*batch), n, fp) != n)
+		{
+			goto write_error;
+		}
+	}
+	for (i = 0; i < utxo->cap; ++i)
+	{
+		if (utxo->records[i].type == UTXO_TYPE_RAW && utxo->records[i].script_len > 0)
+		{
+			memcpy(&script, utxo->records[i].script, sizeof(script));
+			if (fwrite(script, 1, utxo->records[i].script_len, fp) != utxo->records[i].script_len)
+			{
+				goto write_error;
+			}
+		}
+	}
+
+	if (fflush(fp) != 0 || fsync(fileno(fp)) != 0)
+	{
+		goto write_error;
+	}
+	fclose(fp);
+	free(batch);
+
+	if (rename(tmp_path, path) != 0)
+	{
+		error_log("Unable to replace snapshot file %s. Errno %i.", path, errno);
+		return -1;
+	}
+
+	return 1;
+
+write_error:
+	error_log("Could not write snapshot file %s. Errno %i.", tmp_path, errno);
+	fclose(fp);
+	free(batch);
+	return -1;
+}
+
+/*
+ * Load a snapshot into memory so more blocks can be applied to it.
+ */
+int utxo_load(Utxo utxo, const char *path)
+{
+	int r;
+	size_t i;
+	uint64_t offset;
+	unsigned char *script;
+	const struct UtxoHeader *header;
+	struct UtxoRecord *record;
+
+	assert(utxo);
+	assert(utxo->map == NULL);
+	assert(path);
+
+	r = utxo_map(utxo, path);
+	if (r < 0)
+	{
+		return -1;
+	}
+	header = (const struct UtxoHeader *)utxo->map;
+
+	arena_reset(utxo->arena);
+	free(utxo->records);
+	utxo->records = malloc(sizeof(*utxo->records) * header->slots);
+	if (utxo->records == NULL)
+	{
+		error_log("Memory allocation error.");
+		goto fail;
+	}
+	memcpy(utxo->records, utxo->map + sizeof(*header), sizeof(*utxo->records) * header->slots);
+	utxo->cap = header->slots;
+	utxo->count = header->count;
+	utxo->amount = header->amount;
+	utxo->blocks = header->blocks;
+	memcpy(utxo->tip, header->tip, BLOCK_HASH_LEN);
+
+	for (i = 0; i < utxo->cap; ++i)
+	{
+		record = &utxo->records[i];
+		if (record->type != UTXO_TYPE_RAW)
+		{
+			continue;
+		}
+
+		memcpy(&offset, record->script, sizeof(offset));
+		if (offset > utxo->heap_len || record->script_len > utxo->heap_len - offset)
+		{
+			error_log("Snapshot file is corrupt.");
+			goto fail;
+		}
+
+		script = NULL;
+		if (record->script_len > 0)
+		{
+			script = arena_alloc(utxo->arena, record->script_len);
+			if (script == NULL)
+			{
+				goto fail;
+			}
+			memcpy(script, utxo->heap + offset, record->script_len);
+		}
+		memcpy(record->script, &script, sizeof(script));
+	}
+
+	munmap(utxo->map, utxo->map_size);
+	utxo->map = NULL;
+	utxo->heap = NULL;
+
+	return 1;
+
+fail:
+	munmap(utxo->map, utxo->map_size);
+	utxo->map = NULL;
+	utxo->heap = NULL;
+	free(utxo->records);
+	utxo->records = NULL;
+	utxo->cap = 0;
+	return -1;
+}
+
+/*
+ * Map a snapshot read only for lookups. Nothing is copied, so opening
+ * even a very large set is immediate.
+ */
+int utxo_open(Utxo utxo, const char *path)
+{
+	int r;
+	const struct UtxoHeader *header;
+
+	assert(utxo);
+	assert(path);
+
+	r = utxo_map(utxo, path);
+	if (r < 0)
+	{
+		return -1;
+	}
+	header = (const struct UtxoHeader *)utxo->map;
+
+	free(utxo->records);
+	utxo->records = (struct UtxoRecord *)(utxo->map + sizeof(*header));
+	utxo->cap = header->slots;
+	utxo->count = header->count;
+	utxo->amount = header->amount;
+	utxo->blocks = header->blocks;
+	memcpy(utxo->tip, header->tip, BLOCK_HASH_LEN);
+
+	// Lookups land anywhere in the table.
+	madvise(utxo->map, utxo->map_size, MADV_RANDOM);
+
+	return 1;
+}
+
+/*
+ * Look up an outpoint. The txid is in internal byte order. Returns NULL
+ * if the output isn't in the set.
+ */
+const struct UtxoRecord *utxo_find(Utxo utxo, const unsigned char *txid, uint32_t index)
+{
+	size_t i;
+
+	assert(utxo);
+	assert(txid);
+
+	i = utxo_slot(utxo, txid, index);
+	if (utxo->records[i].type == UTXO_TYPE_EMPTY)
+	{
+		return NULL;
+	}
+
+	return &utxo->records[i];
+}
+
+/*
+ * Expand a record's script back to its full form. Returns its length.
+ */
+int utxo_get_script(unsigned char *output, Utxo utxo, const struct UtxoRecord *record)
+{
+	uint64_t offset;
+	unsigned char *script;
+
+	assert(output);
+	assert(utxo);
+	assert(record);
+
+	switch (record->type)
+	{
+		case UTXO_TYPE_P2PKH:
+			output[0] = 0x76;
+			output[1] = 0xa9;
+			output[2] = UTXO_HASH_LEN;
+			memcpy(output + 3, record->script, UTXO_HASH_LEN);
+			output[23] = 0x88;
+			output[24] = 0xac;
+			return 25;
+		case UTXO_TYPE_P2SH:
+			output[0] = 0xa9;
+			output[1] = UTXO_HASH_LEN;
+			memcpy(output + 2, record->script, UTXO_HASH_LEN);
+			output[22] = 0x87;
+			return 23;
+		case UTXO_TYPE_P2WPKH:
+			output[0] = 0x00;
+			output[1] = UTXO_HASH_LEN;
+			memcpy(output + 2, record->script, UTXO_HASH_LEN);
+			return 22;
+		case UTXO_TYPE_RAW:
+			if (record->script_len == 0)
+			{
+				return 0;
+			}
+			if (utxo->map != NULL)
+			{
+				memcpy(&offset, record->script, sizeof(offset));
+				if (offset > utxo->heap_len || record->script_len > utxo->heap_len - offset)
+				{
+					error_log("Snapshot file is corrupt.");
+					return -1;
+				}
+				memcpy(output, utxo->heap + offset, record->script_len);
+			}
+			else
+			{
+				memcpy(&script, record->script, sizeof(script));
+				memcpy(output, script, record->script_len);
+			}
+			return record->script_len;
+	}
+
+	error_log("Unknown script type %i.", record->type);
+	return -1;
+}
+
+uint32_t utxo_get_blocks(Utxo utxo)
+{
+	assert(utxo);
+
+	return utxo->blocks;
+}
+
+void utxo_get_tip(unsigned char *output, Utxo utxo)
+{
+	assert(output);
+	assert(utxo);
+
+	memcpy(output, utxo->tip, BLOCK_HASH_LEN);
+}
+
+uint64_t utxo_get_count(Utxo utxo)
+{
+	assert(utxo);
+
+	return utxo->count;
+}
+
+int utxo_to_json(char *output, Utxo utxo)
+{
+	char tip[BLOCK_HASH_LEN * 2 + 1];
+
+	assert(output);
+	assert(utxo);
+
+	output += sprintf(output, "{\n");
+	output += sprintf(output, "  \"height\": %"PRId64",\n", (int64_t)utxo->blocks - 1);
+	hex_hash_to_str(tip, utxo->tip, BLOCK_HASH_LEN);
+	output += sprintf(output, "  \"tip\": \"%s\",\n", tip);
+	output += sprintf(output, "  \"outputs\": %"PRIu64",\n", utxo->count);
+	output += sprintf(output, "  \"amount\": %"PRIu64",\n", utxo->amount);
+	output += sprintf(output, "  \"slots\": %zu,\n", utxo->cap);
+	// Scripts kept whole, the same count in memory as in a snapshot.
+	if (utxo->map != NULL)
+	{
+		output += sprintf(output, "  \"script_bytes\": %"PRIu64"\n", utxo->heap_len);
+	}
+	else
+	{
+		output += sprintf(output, "  \"script_bytes\": %"PRIu64",\n", utxo->heap_len);
+		output += sprintf(output, "  \"memory_bytes\": %zu\n", sizeof(*utxo->records) * utxo->cap + arena_get_reserved(utxo->arena));
+	}
+	sprintf(output, "}");
+
+	return 1;
+}
+
+void utxo_clear(Utxo utxo)
+{
+	assert(utxo);
+
+	if (utxo->map != NULL)
+	{
+		munmap(utxo->map, utxo->map_size);
+	}
+	else
+	{
+		free(utxo->records);
+	}
+	if (utxo->arena != NULL)
+	{
+		arena_clear(utxo->arena);
+		free(utxo->arena);
+	}
+	if (utxo->tx != NULL)
+	{
+		txview_clear(utxo->tx);
+		free(utxo->tx);
+	}
+
+	memset(utxo, 0, sizeof(*utxo));
+}
+
+size_t utxo_sizeof(void)
+{
+	return sizeof(struct Utxo);
+}
+
+static int utxo_alloc(Utxo utxo, size_t cap)
+{
+	utxo->records = calloc(cap, sizeof(*utxo->records));
+	if (utxo->records == NULL)
+	{
+		error_log("Memory allocation error.");
+		return -1;
+	}
+	utxo->cap = cap;
+
+	return 1;
+}
+
+/*
+ * Linear probe for an outpoint. Returns the slot holding it, or the empty
+ * slot where it would go.
+ */
+static size_t utxo_slot(Utxo utxo, const unsigned char *txid, uint32_t index)
+{
+	size_t i, mask;
+	struct UtxoRecord *record;
+
+	mask = utxo->cap - 1;
+	for (i = utxo_hash(txid, index) & mask; ; i = (i + 1) & mask)
+	{
+		record = &utxo->records[i];
+		if (record->type == UTXO_TYPE_EMPTY)
+		{
+			return i;
+		}
+		if (record->index == index && memcmp(record->txid, txid, UTXO_TXID_LEN) == 0)
+		{
+			return i;
+		}
+	}
+}
+
+/*
+ * Add an output. An outpoint that's already in the set is replaced; that
+ * only happens with the two duplicate coinbases from before BIP30.
+ */
+static int utxo_insert(Utxo utxo, const unsigned char *txid, uint32_t index, uint64_t amount, int coinbase, const unsigned char *script, size_t script_len)
+{
+	size_t i;
+	unsigned char *copy;
+	struct UtxoRecord *record;
+	struct ScriptTemplate template;
+
+	if ((utxo->count + 1) * 4 > (uint64_t)utxo->cap * 3)
+	{
+		if (utxo_grow(utxo) < 0)
+		{
+			return -1;
+		}
+	}
+
+	i = utxo_slot(utxo, txid, index);
+	record = &utxo->records[i];
+	if (record->type != UTXO_TYPE_EMPTY)
+	{
+		utxo_remove(utxo, i);
+		i = utxo_slot(utxo, txid, index);
+		record = &utxo->records[i];
+	}
+
+	memcpy(record->txid, txid, UTXO_TXID_LEN);
+	record->index = index;
+	record->height = utxo->blocks;
+	record->amount = amount;
+	record->coinbase = (uint8_t)(coinbase != 0);
+	record->script_len = (uint16_t)script_len;
+
+	// The common templates are rebuilt from their hash on the way out.
+	switch (script_classify(&template, script, script_len))
+	{
+		case SCRIPT_TYPE_P2PKH:
+			record->type = UTXO_TYPE_P2PKH;
+			break;
+		case SCRIPT_TYPE_P2SH:
+			record->type = UTXO_TYPE_P2SH;
+			break;
+		case SCRIPT_TYPE_P2WPKH:
+			record->type = UTXO_TYPE_P2WPKH;
+			break;
+		default:
+			record->type = UTXO_TYPE_RAW;
+			break;
+	}
+
+	if (record->type != UTXO_TYPE_RAW)
+	{
+		memcpy(record->script, template.data, UTXO_HASH_LEN);
+	}
+	else
+	{
+		copy = NULL;
+		if (script_len > 0)
+		{
+			copy = arena_alloc(utxo->arena, script_len);
+			if (copy == NULL)
+			{
+				return -1;
+			}
+			memcpy(copy, script, script_len);
+		}
+		memset(record->script, 0, UTXO_HASH_LEN);
+		memcpy(record->script, &copy, sizeof(copy));
+		utxo->heap_len += script_len;
+	}
+
+	utxo->count++;
+	utxo->amount += amount;
+
+	return 1;
+}
+
+static int utxo_spend(Utxo utxo, const unsigned char *txid, uint32_t index)
+{
+	size_t i;
+
+	i = utxo_slot(utxo, txid, index);
+	if (utxo->records[i].type == UTXO_TYPE_EMPTY)
+	{
+		error_log("Block at height %"PRIu32" spends an output that isn't in the set.", utxo->blocks);
+		return -1;
+	}
+
+	if (utxo->spend_hook != NULL && utxo->spend_hook(utxo->spend_ctx, utxo, &utxo->records[i]) < 0)
+	{
+		return -1;
+	}
+
+	utxo_remove(utxo, i);
+
+	return 1;
+}
+
+/*
+ * Empty a slot, then shift later entries of the same probe run back into
+ * the gap so lookups never need tombstones.
+ */
+static void utxo_remove(Utxo utxo, size_t i)
+{
+	size_t j, k, mask;
+	unsigned char *script;
+	struct UtxoRecord *record;
+
+	record = &utxo->records[i];
+	if (record->type == UTXO_TYPE_RAW)
+	{
+		memcpy(&script, record->script, sizeof(script));
+		arena_free(utxo->arena, script, record->script_len);
+		utxo->heap_len -= record->script_len;
+	}
+	utxo->count--;
+	utxo->amount -= record->amount;
+
+	mask = utxo->cap - 1;
+	for (j = i; ; )
+	{
+		j = (j + 1) & mask;
+		if (utxo->records[j].type == UTXO_TYPE_EMPTY)
+		{
+			break;
+		}
+		k = utxo_hash(utxo->records[j].txid, utxo->records[j].index) & mask;
+		// Leave it if its home slot lies cyclically in (i, j].
+		if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+		{
+			continue;
+		}
+		utxo->records[i] = utxo->records[j];
+		i = j;
+	}
+
+	memset(&utxo->records[i], 0, sizeof(utxo->records[i]));
+}
+
+static int utxo_grow(Utxo utxo)
+{
+	size_t i, j, old_cap;
+	struct UtxoRecord *old;
+
+	old = utxo->records;
+	old_cap = utxo->cap;
+
+	if (utxo_alloc(utxo, old_cap * 2) < 0)
+	{
+		utxo->records = old;
+		utxo->cap = old_cap;
+		return -1;
+	}
+
+	for (i = 0; i < old_cap; ++i)
+	{
+		if (old[i].type == UTXO_TYPE_EMPTY)
+		{
+			continue;
+		}
+		j = utxo_slot(utxo, old[i].txid, old[i].index);
+		utxo->records[j] = old[i];
+	}
+
+	free(old);
+
+	return 1;
+}
+
+/*
+ * Map a snapshot and check that its header matches its size.
+ */
+static int utxo_map(Utxo utxo, const char *path)
+{
+	int fd;
+	struct stat st;
+	const struct UtxoHeader *header;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		error_log("Unable to open snapshot file %s. Errno %i.", path, errno);
+		return -1;
+	}
+	if (fstat(fd, &st) < 0)
+	{
+		error_log("Unable to read snapshot file size. Errno %i.", errno);
+		close(fd);
+		return -1;
+	}
+	if ((size_t)st.st_size < sizeof(struct UtxoHeader))
+	{
+		error_log("File %s is not a utxo snapshot.", path);
+		close(fd);
+		return -1;
+	}
+
+	utxo->map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (utxo->map == MAP_FAILED)
+	{
+		utxo->map = NULL;
+		error_log("Unable to map snapshot file %s. Errno %i.", path, errno);
+		return -1;
+	}
+	utxo->map_size = (size_t)st.st_size;
+
+	header = (const struct UtxoHeader *)utxo->map;
+	if (memcmp(header->magic, UTXO_MAGIC, UTXO_MAGIC_LEN) != 0)
+	{
+		error_log("File %s is not a utxo snapshot.", path);
+		goto fail;
+	}
+	if (header->slots == 0 || (header->slots & (header->slots - 1)) != 0 || header->count >= header->slots ||
+	    header->slots > (utxo->map_size - sizeof(*header)) / sizeof(struct UtxoRecord) ||
+	    header->heap_len != utxo->map_size - sizeof(*header) - header->slots * sizeof(struct UtxoRecord))
+	{
+		error_log("Snapshot file is corrupt.");
+		goto fail;
+	}
+
+	utxo->heap = utxo->map + sizeof(*header) + header->slots * sizeof(struct UtxoRecord);
+	utxo->heap_len = header->heap_len;
+
+	return 1;
+
+fail:
+	munmap(utxo->map, utxo->map_size);
+	utxo->map = NULL;
+	return -1;
+}
+
+/*
+ * Txids are already uniformly distributed, so the first eight bytes mixed
+ * with the output index are enough. Snapshots depend on this staying the
+ * same.
+ */
+static size_t utxo_hash(const unsigned char *txid, uint32_t index)
+{
+	uint64_t h;
+
+	memcpy(&h, txid, sizeof(h));
+
+	return (size_t)(h ^ ((uint64_t)index * 0x9e3779b97f4a7c15ULL));
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2017 Brian Barto
+ * 
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GPL License. See LICENSE for more details.
+ */
+
+#ifndef UTXO_H
+#define UTXO_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define UTXO_TXID_LEN      32
+#define UTXO_HASH_LEN      20
+#define UTXO_SCRIPT_MAX    10000
+
+#define UTXO_TYPE_EMPTY    0
+#define UTXO_TYPE_RAW      1
+#define UTXO_TYPE_P2PKH    2
+#define UTXO_TYPE_P2SH     3
+#define UTXO_TYPE_P2WPKH   4
+
+/*
+ * One unspent output. The common script templates are stored as just
+ * their 20 byte hash; any other script lives outside the record and
+ * script holds where to find it. Records are written to snapshots as
+ * is, so the layout is fixed and in host byte order.
+ */
+struct UtxoRecord
+{
+	unsigned char txid[UTXO_TXID_LEN];
+	uint32_t index;
+	uint32_t height;
+	uint64_t amount;
+	uint8_t type;
+	uint8_t coinbase;
+	uint16_t script_len;
+	unsigned char script[UTXO_HASH_LEN];
+};
+
+typedef struct Utxo *Utxo;
+
+typedef int (*UtxoSpendHook)(void *, Utxo, const struct UtxoRecord *);
+
+int utxo_new(Utxo);
+void utxo_set_spend_hook(Utxo, UtxoSpendHook, void *);
+int utxo_add_block(Utxo, unsigned char *, size_t);
+int utxo_save(Utxo, const char *);
+int utxo_load(Utxo, const char *);
+int utxo_open(Utxo, const char *);
+const struct UtxoRecord *utxo_find(Utxo, const unsigned char *, uint32_t);
+int utxo_get_script(unsigned char *, Utxo, const struct UtxoRecord *);
+uint32_t utxo_get_blocks(Utxo);
+void utxo_get_tip(unsigned char *, Utxo);
+uint64_t utxo_get_count(Utxo);
+int utxo_to_json(char *, Utxo);
+void utxo_clear(Utxo);
+size_t utxo_sizeof(void);
+
+#endif
@@ -0,0 +1,636 @@
+#!/usr/bin/env python3
+#
+# Writes chain/blk00000.dat, a short chain on from the genesis block whose
+# transactions spend every kind of output with every hash type, along with
+# scripts that check no signatures, some valid and some not. Prints what
+# 'btk blocks -x', 'btk utxo' and 'btk index' should report for it. Keys,
+# signatures, signature hashes and taproot commitments are worked out here
+# apart from btk. At these heights only P2SH, segwit and taproot apply, so
+# OP_CHECKLOCKTIMEVERIFY is still a NOP.
+
+import hashlib, hmac, os, struct
+
+P = 2**256 - 2**32 - 977
+N = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141
+G = (0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798,
+     0x483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8)
+
+GENESIS = bytes.fromhex(
+    '0100000000000000000000000000000000000000000000000000000000000000000000003ba3edfd7a7b12b27ac72c3e'
+    '67768f617fc81bc3888a51323a9fb8aa4b1e5e4a29ab5f49ffff001d1dac2b7c010100000001000000000000000000000000'
+    '0000000000000000000000000000000000000000ffffffff4d04ffff001d0104455468652054696d65732030332f4a616e2f'
+    '32303039204368616e63656c6c6f72206f6e206272696e6b206f66207365636f6e64206261696c6f757420666f722062616e'
+    '6b73ffffffff0100f2052a01000000434104678afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb6'
+    '49f6bc3f4cef38c4f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac00000000')
+
+ALL, NONE, SINGLE, ANYONECANPAY, DEFAULT = 0x01, 0x02, 0x03, 0x80, 0x00
+OP_0, OP_1, OP_2, OP_3, OP_5, OP_16 = 0x00, 0x51, 0x52, 0x53, 0x55, 0x60
+OP_IF, OP_ELSE, OP_ENDIF, OP_RETURN, OP_DROP, OP_DUP, OP_SWAP, OP_SIZE = 0x63, 0x67, 0x68, 0x6a, 0x75, 0x76, 0x7c, 0x82
+OP_CAT, OP_EQUAL, OP_EQUALVERIFY, OP_NEGATE, OP_ABS, OP_ADD, OP_SUB = 0x7e, 0x87, 0x88, 0x8f, 0x90, 0x93, 0x94
+OP_NUMEQUAL, OP_SHA256, OP_HASH160, OP_CODESEPARATOR = 0x9c, 0xa8, 0xa9, 0xab
+OP_CHECKSIG, OP_CHECKMULTISIG, OP_CHECKLOCKTIMEVERIFY, OP_CHECKSIGADD, OP_SUCCESS80 = 0xac, 0xae, 0xb1, 0xba, 0x50
+
+def add(a, b):
+    if a is None:
+        return b
+    if b is None:
+        return a
+    if a[0] == b[0] and (a[1] + b[1]) % P == 0:
+        return None
+    if a == b:
+        l = 3 * a[0] * a[0] * pow(2 * a[1], -1, P)
+    else:
+        l = (b[1] - a[1]) * pow(b[0] - a[0], -1, P)
+    x = (l * l - a[0] - b[0]) % P
+    return (x, (l * (a[0] - x) - a[1]) % P)
+
+def mul(k, p=G):
+    r = None
+    while k:
+        if k & 1:
+            r = add(r, p)
+        p = add(p, p)
+        k >>= 1
+    return r
+
+def sha(b):
+    return hashlib.sha256(b).digest()
+
+def dsha(b):
+    return sha(sha(b))
+
+def hash160(b):
+    return hashlib.new('ripemd160', sha(b)).digest()
+
+def tagged(tag, b):
+    t = sha(tag.encode())
+    return sha(t + t + b)
+
+def cs(n):
+    if n < 0xfd:
+        return bytes([n])
+    return b'\xfd' + struct.pack('<H', n)
+
+def push(b):
+    if len(b) == 0:
+        return bytes([OP_0])
+    return (bytes([len(b)]) if len(b) < 0x4c else b'\x4c' + bytes([len(b)])) + b
+
+def script(*items):
+    return b''.join(push(i) if isinstance(i, bytes) else bytes([i]) for i in items)
+
+# Keys
+
+def key(name):
+    return int.from_bytes(sha(name.encode()), 'big') % N
+
+def pub(name, compressed=True):
+    p = mul(key(name))
+    if compressed:
+        return bytes([2 + (p[1] & 1)]) + p[0].to_bytes(32, 'big')
+    return b'\x04' + p[0].to_bytes(32, 'big') + p[1].to_bytes(32, 'big')
+
+def xonly(name):
+    return mul(key(name))[0].to_bytes(32, 'big')
+
+def ecdsa(name, z):
+    d = key(name)
+    x = d.to_bytes(32, 'big')
+    h = (int.from_bytes(z, 'big') % N).to_bytes(32, 'big')
+    v, k = b'\x01' * 32, b'\x00' * 32
+    k = hmac.new(k, v + b'\x00' + x + h, hashlib.sha256).digest()
+    v = hmac.new(k, v, hashlib.sha256).digest()
+    k = hmac.new(k, v + b'\x01' + x + h, hashlib.sha256).digest()
+    v = hmac.new(k, v, hashlib.sha256).digest()
+    while True:
+        v = hmac.new(k, v, hashlib.sha256).digest()
+        n = int.from_bytes(v, 'big')
+        if 1 <= n < N:
+            r = mul(n)[0] % N
+            s = pow(n, -1, N) * (int.from_bytes(z, 'big') + r * d) % N
+            if r and s:
+                break
+        k = hmac.new(k, v + b'\x00', hashlib.sha256).digest()
+        v = hmac.new(k, v, hashlib.sha256).digest()
+    def integer(i):
+        b = i.to_bytes(32, 'big').lstrip(b'\x00')
+        return b'\x02' + bytes([len(b) + (b[0] >> 7)]) + b'\x00' * (b[0] >> 7) + b
+    b = integer(r) + integer(min(s, N - s))
+    return b'\x30' + bytes([len(b)]) + b
+
+def schnorr(d, m):
+    p = mul(d)
+    d = d if p[1] % 2 == 0 else N - d
+    px = p[0].to_bytes(32, 'big')
+    t = (d ^ int.from_bytes(tagged('BIP0340/aux', bytes(32)), 'big')).to_bytes(32, 'big')
+    k = int.from_bytes(tagged('BIP0340/nonce', t + px + m), 'big') % N
+    r = mul(k)
+    k = k if r[1] % 2 == 0 else N - k
+    rx = r[0].to_bytes(32, 'big')
+    e = int.from_bytes(tagged('BIP0340/challenge', rx + px + m), 'big') % N
+    return rx + ((k + e * d) % N).to_bytes(32, 'big')
+
+# Taproot trees are a leaf script, a list of a leaf version and a script or
+# a pair of trees.
+
+def leaf_hash(s, version=0xc0):
+    return tagged('TapLeaf', bytes([version]) + cs(len(s)) + s)
+
+def tree_hash(tree):
+    if isinstance(tree, tuple):
+        a, b = sorted([tree_hash(tree[0]), tree_hash(tree[1])])
+        return tagged('TapBranch', a + b)
+    if isinstance(tree, list):
+        return leaf_hash(tree[1], tree[0])
+    return leaf_hash(tree)
+
+def tree_path(tree, s):
+    if not isinstance(tree, tuple):
+        return b'' if tree == s or tree == [0xc2, s] else None
+    for i in (0, 1):
+        p = tree_path(tree[i], s)
+        if p is not None:
+            return p + tree_hash(tree[1 - i])
+    return None
+
+class Taproot:
+    def __init__(self, name, tree=None):
+        p = mul(key(name))
+        self.d = key(name) if p[1] % 2 == 0 else N - key(name)
+        self.px = p[0].to_bytes(32, 'big')
+        self.tree = tree
+        self.tweak = int.from_bytes(tagged('TapTweak', self.px + (tree_hash(tree) if tree else b'')), 'big')
+        self.q = add(p if p[1] % 2 == 0 else (p[0], P - p[1]), mul(self.tweak))
+        self.spk = bytes([OP_1]) + push(self.q[0].to_bytes(32, 'big'))
+
+    def sign(self, m):
+        return schnorr((self.d + self.tweak) % N, m)
+
+    def control(self, s, version=0xc0):
+        return bytes([version | (self.q[1] & 1)]) + self.px + tree_path(self.tree, s)
+
+# Transactions
+
+class Tx:
+    def __init__(self, version=2, lock=0):
+        self.version, self.lock, self.ins, self.outs = version, lock, [], []
+
+    def ser(self, witness=True):
+        segwit = witness and any(i['wit'] for i in self.ins)
+        r = struct.pack('<i', self.version) + (b'\x00\x01' if segwit else b'') + cs(len(self.ins))
+        for i in self.ins:
+            r += i['txid'] + struct.pack('<I', i['n']) + cs(len(i['ss'])) + i['ss'] + struct.pack('<I', i['seq'])
+        r += cs(len(self.outs)) + b''.join(output(v, s) for v, s in self.outs)
+        if segwit:
+            for i in self.ins:
+                r += cs(len(i['wit'])) + b''.join(cs(len(w)) + w for w in i['wit'])
+        return r + struct.pack('<I', self.lock)
+
+    def txid(self):
+        return dsha(self.ser(False))
+
+def output(value, s):
+    return struct.pack('<q', value) + cs(len(s)) + s
+
+def sighash_legacy(tx, n, code, ht):
+    base = ht & 0x1f
+    if base == SINGLE and n >= len(tx.outs):
+        return b'\x01' + bytes(31)
+    ins = [tx.ins[n]] if ht & ANYONECANPAY else tx.ins
+    r = struct.pack('<i', tx.version) + cs(len(ins))
+    for i in ins:
+        mine = i is tx.ins[n]
+        seq = i['seq'] if mine or base not in (NONE, SINGLE) else 0
+        r += i['txid'] + struct.pack('<I', i['n']) + (cs(len(code)) + code if mine else b'\x00') + struct.pack('<I', seq)
+    if base == NONE:
+        outs = []
+    elif base == SINGLE:
+        outs = [(-1, b'')] * n + [tx.outs[n]]
+    else:
+        outs = tx.outs
+    r += cs(len(outs)) + b''.join(output(v, s) for v, s in outs)
+    return dsha(r + struct.pack('<II', tx.lock, ht))
+
+def sighash_v0(tx, n, code, amount, ht):
+    base, i = ht & 0x1f, tx.ins[n]
+    prevouts = dsha(b''.join(j['txid'] + struct.pack('<I', j['n']) for j in tx.ins))
+    sequences = dsha(b''.join(struct.pack('<I', j['seq']) for j in tx.ins))
+    if ht & ANYONECANPAY:
+        prevouts = sequences = bytes(32)
+    elif base in (NONE, SINGLE):
+        sequences = bytes(32)
+    if base not in (NONE, SINGLE):
+        outputs = dsha(b''.join(output(v, s) for v, s in tx.outs))
+    elif base == SINGLE and n < len(tx.outs):
+        outputs = dsha(output(*tx.outs[n]))
+    else:
+        outputs = bytes(32)
+    r = (struct.pack('<i', tx.version) + prevouts + sequences + i['txid'] + struct.pack('<I', i['n']) +
+         cs(len(code)) + code + struct.pack('<q', amount) + struct.pack('<I', i['seq']) + outputs)
+    return dsha(r + struct.pack('<II', tx.lock, ht))
+
+def sighash_taproot(tx, n, spent, ht, annex=None, leaf=None, codesep=0xffffffff):
+    base, i = ht & 0x03, tx.ins[n]
+    r = b'\x00' + bytes([ht]) + struct.pack('<iI', tx.version, tx.lock)
+    if not ht & ANYONECANPAY:
+        r += sha(b''.join(j['txid'] + struct.pack('<I', j['n']) for j in tx.ins))
+        r += sha(b''.join(struct.pack('<q', v) for v, s in spent))
+        r += sha(b''.join(cs(len(s)) + s for v, s in spent))
+        r += sha(b''.join(struct.pack('<I', j['seq']) for j in tx.ins))
+    if base not in (NONE, SINGLE):
+        r += sha(b''.join(output(v, s) for v, s in tx.outs))
+    r += bytes([(2 if leaf else 0) | (1 if annex else 0)])
+    if ht & ANYONECANPAY:
+        r += i['txid'] + struct.pack('<I', i['n']) + output(*spent[n]) + struct.pack('<I', i['seq'])
+    else:
+        r += struct.pack('<I', n)
+    if annex:
+        r += sha(cs(len(annex)) + annex)
+    if base == SINGLE:
+        r += sha(output(*tx.outs[n]))
+    if leaf:
+        r += leaf + b'\x00' + struct.pack('<I', codesep)
+    return tagged('TapSighash', r)
+
+# Every spend says how to make the output it spends and how to fill in its
+# input once the transaction is otherwise complete. The signatures btk
+# should count and, for an invalid spend, its error go with it.
+
+class Spend:
+    def __init__(self, spk, sign, sigs=0, error=None):
+        self.spk, self.sign, self.sigs, self.error = spk, sign, sigs, error
+
+def p2pkh(name, ht=ALL, sign_as=None):
+    spk = script(OP_DUP, OP_HASH160, hash160(pub(name)), OP_EQUALVERIFY, OP_CHECKSIG)
+    def sign(tx, n, spent):
+        sig = ecdsa(name, sighash_legacy(tx, n, spk, sign_as or ht)) + bytes([ht])
+        tx.ins[n]['ss'] = script(sig, pub(name))
+    return spk, sign
+
+def p2pk_uncompressed(name, ht=ALL):
+    spk = script(pub(name, False), OP_CHECKSIG)
+    def sign(tx, n, spent):
+        tx.ins[n]['ss'] = script(ecdsa(name, sighash_legacy(tx, n, spk, ht)) + bytes([ht]))
+    return spk, sign
+
+def p2wpkh(name, ht=ALL, amount=None, flip=False):
+    spk = script(OP_0, hash160(pub(name)))
+    code = script(OP_DUP, OP_HASH160, hash160(pub(name)), OP_EQUALVERIFY, OP_CHECKSIG)
+    def sign(tx, n, spent):
+        sig = ecdsa(name, sighash_v0(tx, n, code, amount or spent[n][0], ht)) + bytes([ht])
+        if flip:
+            sig = sig[:10] + bytes([sig[10] ^ 1]) + sig[11:]
+        tx.ins[n]['wit'] = [sig, pub(name)]
+    return spk, sign
+
+def malleate(spk_sign, ss=None, wit=None):
+    spk, sign = spk_sign
+    def malleated(tx, n, spent):
+        sign(tx, n, spent)
+        if ss is not None:
+            tx.ins[n]['ss'] = ss
+        if wit is not None:
+            tx.ins[n]['wit'] = wit
+    return spk, malleated
+
+def p2sh_p2wpkh(name, ht=ALL, extra=None):
+    redeem = script(OP_0, hash160(pub(name)))
+    spk = script(OP_HASH160, hash160(redeem), OP_EQUAL)
+    code = script(OP_DUP, OP_HASH160, hash160(pub(name)), OP_EQUALVERIFY, OP_CHECKSIG)
+    def sign(tx, n, spent):
+        tx.ins[n]['ss'] = (script(extra) if extra else b'') + script(redeem)
+        tx.ins[n]['wit'] = [ecdsa(name, sighash_v0(tx, n, code, spent[n][0], ht)) + bytes([ht]), pub(name)]
+    return spk, sign
+
+def multisig(names):
+    return script(OP_2, *[pub(k) for k in names], OP_3, OP_CHECKMULTISIG)
+
+def p2wsh_multisig(names, signers):
+    ws = multisig(names)
+    def sign(tx, n, spent):
+        sigs = [ecdsa(k, sighash_v0(tx, n, ws, spent[n][0], ht)) + bytes([ht]) for k, ht in signers]
+        tx.ins[n]['wit'] = [b''] + sigs + [ws]
+    return script(OP_0, sha(ws)), sign
+
+def p2sh_multisig(names, signers):
+    redeem = multisig(names)
+    def sign(tx, n, spent):
+        sigs = [ecdsa(k, sighash_legacy(tx, n, redeem, ht)) + bytes([ht]) for k, ht in signers]
+        tx.ins[n]['ss'] = script(b'', *sigs, redeem)
+    return script(OP_HASH160, hash160(redeem), OP_EQUAL), sign
+
+def p2sh_codesep(name):
+    redeem = script(OP_CODESEPARATOR, pub(name), OP_CHECKSIG)
+    def sign(tx, n, spent):
+        sig = ecdsa(name, sighash_legacy(tx, n, redeem[1:], ALL)) + bytes([ALL])
+        tx.ins[n]['ss'] = script(sig, redeem)
+    return script(OP_HASH160, hash160(redeem), OP_EQUAL), sign
+
+def p2wsh_codesep(name):
+    ws = script(OP_CODESEPARATOR, pub(name), OP_CHECKSIG)
+    def sign(tx, n, spent):
+        sig = ecdsa(name, sighash_v0(tx, n, ws[1:], spent[n][0], ALL)) + bytes([ALL])
+        tx.ins[n]['wit'] = [sig, ws]
+    return script(OP_0, sha(ws)), sign
+
+def p2sh(redeem, *args, spk_redeem=None, ss_prefix=b''):
+    def sign(tx, n, spent):
+        tx.ins[n]['ss'] = ss_prefix + script(*args, redeem)
+    return script(OP_HASH160, hash160(spk_redeem or redeem), OP_EQUAL), sign
+
+def p2wsh(ws, *args, spk_ws=None):
+    def sign(tx, n, spent):
+        tx.ins[n]['wit'] = list(args) + [ws]
+    return script(OP_0, sha(spk_ws or ws)), sign
+
+def bare(spk):
+    def sign(tx, n, spent):
+        pass
+    return spk, sign
+
+def p2tr_key(name, ht=DEFAULT, annex=None, flip=False, amounts=None, sighash_as=None):
+    tr = Taproot(name)
+    def sign(tx, n, spent):
+        if amounts:
+            spent = [(a, s) for a, (v, s) in zip(amounts, spent)]
+        sig = tr.sign(sighash_taproot(tx, n, spent, ht if sighash_as is None else sighash_as, annex))
+        if flip:
+            sig = sig[:40] + bytes([sig[40] ^ 1]) + sig[41:]
+        tx.ins[n]['wit'] = [sig + (bytes([ht]) if ht != DEFAULT or sighash_as is not None else b'')] + ([annex] if annex else [])
+    return tr.spk, sign
+
+def p2tr_script(name, tree, s, signers=(), args=(), version=0xc0, codesep=0xffffffff, control=None):
+    tr = Taproot(name, tree)
+    def sign(tx, n, spent):
+        m = lambda ht: sighash_taproot(tx, n, spent, ht, leaf=leaf_hash(s, version), codesep=codesep)
+        sigs = [schnorr(key(k), m(ht)) + (bytes([ht]) if ht else b'') if k else b'' for k, ht in signers]
+        tx.ins[n]['wit'] = list(args) + sigs + [s, control or tr.control(s, version)]
+    return tr.spk, sign
+
+LEAF_A = script(xonly('tap-a'), OP_CHECKSIG)
+LEAF_B = script(xonly('tap-b1'), OP_CHECKSIG, xonly('tap-b2'), OP_CHECKSIGADD, OP_2, OP_NUMEQUAL)
+LEAF_CODESEP = script(OP_CODESEPARATOR, xonly('tap-c'), OP_CHECKSIG)
+LEAF_SUCCESS = script(OP_SUCCESS80)
+LEAF_RETURN = script(OP_RETURN)
+LEAF_IF = script(OP_IF, OP_1, OP_ELSE, OP_0, OP_ENDIF)
+LEAF_MULTISIG = script(OP_1, xonly('tap-a'), OP_1, OP_CHECKMULTISIG)
+
+# Legacy and BIP143 hash types, each input with its own sequence so the
+# hash types that blank other inputs' sequences make a difference.
+LEGACY = [
+    Spend(*p2pkh('legacy-0'), sigs=1),
+    Spend(*p2wpkh('legacy-1', SINGLE | ANYONECANPAY), sigs=1),
+    Spend(*p2pkh('legacy-2', SINGLE), sigs=1),
+    Spend(*p2pkh('legacy-3', ALL | ANYONECANPAY), sigs=1),
+    Spend(*p2pkh('legacy-4', NONE), sigs=1),
+    Spend(*p2wpkh('legacy-5'), sigs=1),
+    Spend(*p2wpkh('legacy-6', NONE | ANYONECANPAY), sigs=1),
+    Spend(*p2wpkh('legacy-7', SINGLE), sigs=1),
+    Spend(*p2pkh('legacy-8', SINGLE), sigs=1),
+    Spend(*p2pk_uncompressed('legacy-9'), sigs=1),
+    Spend(*p2sh_p2wpkh('legacy-10'), sigs=1),
+    # OP_CHECKMULTISIG tries the last signature against the last key first
+    # and moves down a key each time one doesn't match.
+    Spend(*p2wsh_multisig(['ms-0', 'ms-1', 'ms-2'], [('ms-0', ALL), ('ms-2', NONE)]), sigs=3),
+    Spend(*p2sh_multisig(['ms-3', 'ms-4', 'ms-5'], [('ms-3', ALL | ANYONECANPAY), ('ms-4', ALL)]), sigs=3),
+    Spend(*p2sh_codesep('legacy-13'), sigs=1),
+    Spend(*p2wsh_codesep('legacy-14'), sigs=1),
+]
+
+# BIP341 hash types, key and script paths, with a version 0 input among
+# them that the taproot ones commit to all the same.
+TAPROOT = [
+    Spend(*p2tr_key('taproot-0'), sigs=1),
+    Spend(*p2tr_key('taproot-1', ALL), sigs=1),
+    Spend(*p2tr_key('taproot-2', SINGLE | ANYONECANPAY), sigs=1),
+    Spend(*p2tr_key('taproot-3', NONE), sigs=1),
+    Spend(*p2tr_key('taproot-4', ALL | ANYONECANPAY, annex=b'\x50\x01\x02'), sigs=1),
+    Spend(*p2wpkh('taproot-5'), sigs=1),
+    Spend(*p2tr_script('taproot-6', (LEAF_A, LEAF_B), LEAF_B, [('tap-b2', DEFAULT), ('tap-b1', DEFAULT)]), sigs=2),
+    Spend(*p2tr_script('taproot-6', (LEAF_A, LEAF_B), LEAF_A, [('tap-a', NONE | ANYONECANPAY)]), sigs=1),
+    Spend(*p2tr_script('taproot-8', LEAF_CODESEP, LEAF_CODESEP, [('tap-c', DEFAULT)], codesep=0), sigs=1),
+    Spend(*p2tr_script('taproot-9', (LEAF_SUCCESS, LEAF_A), LEAF_SUCCESS)),
+    Spend(*p2tr_script('taproot-10', [0xc2, LEAF_RETURN], LEAF_RETURN, version=0xc2)),
+    Spend(*p2tr_script('taproot-11', (LEAF_IF, LEAF_A), LEAF_IF, args=[b'\x01'])),
+]
+
+# Scripts in the manner of Bitcoin Core's script_tests, which check no
+# signatures.
+SCRIPTS = [
+    Spend(*p2sh(script(OP_2, OP_3, OP_ADD, OP_5, OP_EQUAL))),
+    Spend(*p2sh(script(OP_SHA256, sha(b'btk'), OP_EQUAL), b'btk')),
+    Spend(*p2wsh(script(OP_IF, OP_1, OP_ELSE, OP_0, OP_ENDIF), b'\x01')),
+    Spend(*p2wsh(script(OP_1, OP_CHECKLOCKTIMEVERIFY))),
+    Spend(*p2sh(script(OP_1, OP_2, OP_SWAP, OP_SUB, OP_1, OP_EQUAL))),
+    Spend(*p2wsh(script(OP_16, OP_NEGATE, OP_ABS, OP_16, OP_NUMEQUAL))),
+    Spend(*p2wsh(script(OP_SIZE, b'\x50', OP_EQUALVERIFY, OP_DROP, OP_1), b'\xaa' * 80)),
+    Spend(*bare(script(OP_1))),
+    Spend(*p2sh(script(OP_0, OP_IF, OP_RETURN, OP_ENDIF, OP_1))),
+]
+
+# Every input fails, for the reason given.
+INVALID = [
+    Spend(*p2sh(script(OP_1, OP_2, OP_EQUAL)), error='P2SH redeem script evaluated to false.'),
+    Spend(*p2sh(script(OP_2), spk_redeem=script(OP_1)), error='Script evaluated to false.'),
+    Spend(*p2wsh(script(OP_2), spk_ws=script(OP_1)), error="P2WSH witness script doesn't match its program."),
+    Spend(*p2wsh(script(OP_0, OP_IF, OP_CAT, OP_ENDIF, OP_1)), error='Script contains disabled opcode 0x7e.'),
+    Spend(*p2wsh(script(OP_RETURN)), error='Script executes OP_RETURN.'),
+    Spend(*p2wsh(script(OP_1, OP_1)), error='Witness script must leave exactly one true element.'),
+    Spend(*p2sh(script(OP_1), ss_prefix=script(OP_1, OP_DROP)), error='P2SH scriptSig is not push only.'),
+    Spend(*p2pkh('invalid-7', SINGLE, sign_as=ALL), sigs=1, error='Script evaluated to false.'),
+    Spend(*p2wpkh('invalid-8', amount=1), sigs=1, error='Witness script must leave exactly one true element.'),
+    Spend(*p2tr_key('invalid-9', amounts=[1] * 30), sigs=1, error='Schnorr signature is invalid.'),
+    Spend(*p2tr_key('invalid-10', DEFAULT, sighash_as=DEFAULT), error='Schnorr signature has the wrong size or hash type.'),
+    Spend(*p2tr_key('invalid-11', SINGLE, sighash_as=ALL), error='Schnorr signature is invalid.'),
+    Spend(*p2tr_script('invalid-12', (LEAF_A, LEAF_B), LEAF_A, [('tap-a', DEFAULT)],
+                       control=Taproot('invalid-12', (LEAF_A, LEAF_B)).control(LEAF_A)[:33] + bytes(32)),
+          error="Taproot control block doesn't commit to the output key."),
+    Spend(*p2tr_script('invalid-13', LEAF_MULTISIG, LEAF_MULTISIG, args=[b'']), error='OP_CHECKMULTISIG is disabled in tapscript.'),
+    Spend(*p2tr_script('invalid-14', LEAF_IF, LEAF_IF, args=[b'\x02']), error='OP_IF argument is not minimal.'),
+    Spend(*p2tr_script('invalid-15', LEAF_B, LEAF_B, [(None, DEFAULT), ('tap-b1', DEFAULT)]), sigs=1,
+          error='Witness script must leave exactly one true element.'),
+    Spend(*p2wsh_multisig(['ms-6', 'ms-7', 'ms-8'], [('ms-8', ALL), ('ms-6', ALL)]), sigs=2,
+          error='Witness script must leave exactly one true element.'),
+    Spend(*p2wpkh('invalid-17', flip=True), sigs=1, error='Witness script must leave exactly one true element.'),
+    Spend(*p2tr_key('invalid-18', flip=True), sigs=1, error='Schnorr signature is invalid.'),
+    Spend(*p2sh_p2wpkh('invalid-19', extra=b'\x01'), error='P2SH witness scriptSig is not a single push of the redeem script.'),
+    Spend(*malleate(p2pkh('invalid-20'), wit=[b'\x01']), sigs=1, error='Input has a witness but spends no witness program.'),
+    Spend(*malleate(p2wpkh('invalid-21'), ss=script(OP_1)), error='Witness program spent with a non-empty scriptSig.'),
+]
+
+# Block 1 has a coinbase that funds every spend in block 2, each with its
+# own amount. Block 2 spends them in four transactions and one that spends
+# an output of the first within the block. Block 3 spends one more. Some
+# outputs in block 2 pay again to scripts spent from block 1, so their
+# addresses have both spent and unspent outputs, and one pays to the
+# P2PKH address of a hash160 of zeros, whose base58 starts with many 1s.
+
+def coinbase(height, outs):
+    t = Tx(1)
+    t.ins.append({'txid': bytes(32), 'n': 0xffffffff, 'ss': bytes([1, height]) + b'btk', 'seq': 0xffffffff, 'wit': []})
+    t.outs = outs
+    return t
+
+def spend(spends, funding, outs, version=2, lock=0):
+    t = Tx(version, lock)
+    for i, (txid, n, amount, spk) in enumerate(funding):
+        t.ins.append({'txid': txid, 'n': n, 'ss': b'', 'seq': 0xffffffff - i * 0x1111, 'wit': []})
+    t.outs = outs
+    spent = [(amount, spk) for txid, n, amount, spk in funding]
+    for i, s in enumerate(spends):
+        s.sign(t, i, spent)
+    return t
+
+groups = [LEGACY, TAPROOT, SCRIPTS, INVALID]
+cb1 = coinbase(1, [(10000 + 100 * i, s.spk) for i, s in enumerate(sum(groups, []))])
+cb1_id = cb1.txid()
+
+NEXT = Spend(*p2pkh('next', ALL), sigs=1)
+LAST = Spend(*p2tr_key('last'), sigs=1)
+txs2 = [coinbase(2, [(5000000000, script(OP_1))])]
+first = 0
+for g, outs in zip(groups, [
+        [(1000, NEXT.spk), (2000, LEGACY[5].spk), (3000, LEGACY[13].spk), (4000, LEGACY[11].spk)],
+        [(1000, LAST.spk), (2000, TAPROOT[0].spk), (3000, LEGACY[0].spk)],
+        [(500, script(OP_1)), (700, script(OP_DUP, OP_HASH160, bytes(20), OP_EQUALVERIFY, OP_CHECKSIG))],
+        [(500, script(OP_1)), (600, script(OP_2))]]):
+    funding = [(cb1_id, first + i, cb1.outs[first + i][0], cb1.outs[first + i][1]) for i in range(len(g))]
+    txs2.append(spend(g, funding, outs))
+    first += len(g)
+txs2.insert(2, spend([NEXT], [(txs2[1].txid(), 0, 1000, NEXT.spk)], [(900, script(OP_1))], 1, 1))
+txs3 = [coinbase(3, [(5000000000, script(OP_1))]), spend([LAST], [(txs2[3].txid(), 0, 1000, LAST.spk)], [(900, script(OP_1))])]
+
+def block(prev, txs, time):
+    level = [t.txid() for t in txs]
+    while len(level) > 1:
+        if len(level) % 2:
+            level.append(level[-1])
+        level = [dsha(level[i] + level[i + 1]) for i in range(0, len(level), 2)]
+    header = struct.pack('<i', 0x20000000) + prev + level[0] + struct.pack('<III', time, 0x207fffff, 0)
+    return header + cs(len(txs)) + b''.join(t.ser() for t in txs)
+
+blocks = [GENESIS]
+for txs, time in [([cb1], 1231006600), (txs2, 1231007200), (txs3, 1231007800)]:
+    blocks.append(block(dsha(blocks[-1][:80]), txs, time))
+
+os.makedirs(os.path.join(os.path.dirname(__file__) or '.', 'chain'), exist_ok=True)
+with open(os.path.join(os.path.dirname(__file__) or '.', 'chain', 'blk00000.dat'), 'wb') as f:
+    for b in blocks:
+        f.write(bytes.fromhex('f9beb4d9') + struct.pack('<I', len(b)) + b)
+
+# What 'btk blocks -x' prints. The genesis block has one transaction of
+# 50 BTC, all of it after the header and the transaction count.
+
+offset = 8
+for b, txs in zip(blocks, [None, [cb1], txs2, txs3]):
+    h = b[:80]
+    block_hash = dsha(h)[::-1].hex()
+    if txs:
+        txs = [(t.txid(), len(t.ser()), any(i['wit'] for i in t.ins), len(t.ins), len(t.outs), sum(v for v, s in t.outs)) for t in txs]
+    else:
+        txs = [(dsha(b[81:]), len(b) - 81, False, 1, 1, 5000000000)]
+    version, = struct.unpack('<i', h[:4])
+    time, bits, nonce = struct.unpack('<III', h[68:80])
+    print('{"type": "block", "file": "blk00000.dat", "offset": %d, "hash": "%s", "version": %d, "prev_hash": "%s", "merkle_root": "%s", "time": %d, "bits": %d, "nonce": %d, "size": %d, "tx_count": %d, "value": %d}' % (
+        offset, block_hash, version, h[4:36][::-1].hex(), h[36:68][::-1].hex(), time, bits, nonce, len(b), len(txs), sum(t[5] for t in txs)))
+    for index, t in enumerate(txs):
+        print('{"type": "tx", "block": "%s", "index": %d, "txid": "%s", "size": %d, "segwit": %s, "inputs": %d, "outputs": %d, "value": %d}' % (
+            block_hash, index, t[0][::-1].hex(), t[1], 'true' if t[2] else 'false', t[3], t[4], t[5]))
+    offset += len(b) + 8
+
+# What 'btk utxo build -V' finds: the failures, the totals and the outputs
+# left unspent. The genesis output can't be spent and isn't one of them.
+
+invalid = txs2[-1]
+for n, s in enumerate(INVALID):
+    print('{"type": "failure", "height": 2, "txid": "%s", "input": %d, "error": "%s"}' % (invalid.txid()[::-1].hex(), n, s.error))
+spends = sum(groups, []) + [NEXT, LAST]
+created = [o for t in [cb1] + txs2 + txs3 for o in t.outs]
+print('{"inputs": %d, "signatures": %d, "failures": %d, "outputs": %d, "amount": %d}' % (
+    len(spends), sum(s.sigs for s in spends), len(INVALID),
+    len(created) - len(spends), sum(v for v, s in created) - sum(v for v, s in cb1.outs) - 2000))
+
+# What 'btk utxo query' finds for a spent output, the one made and spent in
+# block 2, a coinbase and an output of the transaction whose every input
+# failed, which -V reports but still applies.
+
+def query(t, n, height, found=True):
+    line = '{"txid": "%s", "vout": %d, "found": %s' % (t.txid()[::-1].hex(), n, 'true' if found else 'false')
+    if found:
+        line += ', "amount": %d, "height": %d, "coinbase": %s, "script": "%s"' % (
+            t.outs[n][0], height, 'true' if t is txs2[0] else 'false', t.outs[n][1].hex())
+    print(line + '}')
+
+query(cb1, 0, 1, False)
+query(txs2[1], 0, 2, False)
+query(txs2[2], 0, 2)
+query(txs2[0], 0, 2)
+query(invalid, 1, 2)
+
+# What 'btk index query' finds for an address of every type, each paid to
+# once from block 1 and again from block 2 but for the ones spent within
+# block 2 and in block 3, and for addresses paid to only once or never.
+# Entries are in order of height, internal txid and vout. With -u only the
+# unspent entries are listed, though the totals still count them all.
+
+B58 = '123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz'
+BECH32 = 'qpzry9x8gf2tvdw0s3jn54khce6mua7l'
+
+def base58check(b):
+    b += dsha(b)[:4]
+    n, r = int.from_bytes(b, 'big'), ''
+    while n:
+        n, m = divmod(n, 58)
+        r = B58[m] + r
+    return '1' * (len(b) - len(b.lstrip(b'\x00'))) + r
+
+def bech32(version, program):
+    def polymod(values):
+        c = 1
+        for v in values:
+            b = c >> 25
+            c = (c & 0x1ffffff) << 5 ^ v
+            for i in range(5):
+                c ^= [0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3][i] if (b >> i) & 1 else 0
+        return c
+    data, acc, bits = [version], 0, 0
+    for x in program:
+        acc, bits = acc << 8 | x, bits + 8
+        while bits >= 5:
+            bits -= 5
+            data.append(acc >> bits & 31)
+    if bits:
+        data.append(acc << (5 - bits) & 31)
+    const = 0x2bc830a3 if version else 1
+    check = polymod([3, 3, 0, 2, 3] + data + [0] * 6) ^ const
+    return 'bc1' + ''.join(BECH32[d] for d in data + [check >> 5 * (5 - i) & 31 for i in range(6)])
+
+def address(spk):
+    if spk[0] == OP_DUP:
+        return 'p2pkh', base58check(b'\x00' + spk[3:23])
+    if spk[0] == OP_HASH160:
+        return 'p2sh', base58check(b'\x05' + spk[2:22])
+    if spk[0] == OP_0:
+        return 'p2wpkh' if len(spk) == 22 else 'p2wsh', bech32(0, spk[2:])
+    return 'p2tr', bech32(1, spk[2:])
+
+heights = [(1, [cb1]), (2, txs2), (3, txs3)]
+spent_at = {(i['txid'], i['n']): h for h, txs in heights for t in txs[1:] for i in t.ins}
+
+def index(spk, upper=False, unspent=False):
+    kind, addr = address(spk)
+    addr = addr.upper() if upper else addr
+    entries = sorted((h, t.txid(), n, v) for h, txs in heights for t in txs for n, (v, o) in enumerate(t.outs) if o == spk)
+    line = '{"address": "%s", "type": "%s", "outputs": %d, "unspent": %d, "received": %d, "balance": %d, "entries": [' % (
+        addr, kind, len(entries), sum(1 for h, txid, n, v in entries if (txid, n) not in spent_at),
+        sum(v for h, txid, n, v in entries), sum(v for h, txid, n, v in entries if (txid, n) not in spent_at))
+    line += ', '.join('{"txid": "%s", "vout": %d, "height": %d, "amount": %d%s}' % (
+        txid[::-1].hex(), n, h, v, ', "spent_height": %d' % spent_at[(txid, n)] if (txid, n) in spent_at else '')
+        for h, txid, n, v in entries if not unspent or (txid, n) not in spent_at)
+    print(line + ']}')
+
+for spk in [LEGACY[0].spk, NEXT.spk, LEGACY[13].spk, LEGACY[5].spk, LEGACY[11].spk, TAPROOT[0].spk, LAST.spk,
+            script(OP_DUP, OP_HASH160, bytes(20), OP_EQUALVERIFY, OP_CHECKSIG), p2wpkh('unused')[0]]:
+    index(spk)
+index(LEGACY[5].spk, True)
+index(LEGACY[0].spk, unspent=True)
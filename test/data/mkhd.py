@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+#
+# Prints the BIP32 test vectors 1 to 4 as 'btk hd' should derive them,
+# and the first children of a public key as extended keys and addresses.
+# Keys, HMACs and encodings are worked out here apart from btk. Vector 3
+# starts from its master key, whose private key has a leading zero byte
+# that hardened derivation must keep.
+
+import hashlib, hmac
+
+P = 2**256 - 2**32 - 977
+N = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141
+G = (0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798,
+     0x483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8)
+B58 = '123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz'
+B32 = 'qpzry9x8gf2tvdw0s3jn54khce6mua7l'
+HARD = 0x80000000
+
+VECTORS = [
+    ('000102030405060708090a0b0c0d0e0f',
+     ["m", "m/0'", "m/0'/1", "m/0'/1/2'", "m/0'/1/2'/2", "m/0'/1/2'/2/1000000000"]),
+    ('fffcf9f6f3f0edeae7e4e1dedbd8d5d2cfccc9c6c3c0bdbab7b4b1aeaba8a5a2'
+     '9f9c999693908d8a8784817e7b7875726f6c696663605d5a5754514e4b484542',
+     ["m", "m/0", "m/0/2147483647'", "m/0/2147483647'/1", "m/0/2147483647'/1/2147483646'",
+      "m/0/2147483647'/1/2147483646'/2"]),
+    ('xprv9s21ZrQH143K25QhxbucbDDuQ4naNntJRi4KUfWT7xo4EKsHt2QJDu7KXp1A3u7Bi1j8ph3E'
+     'GsZ9Xvz9dGuVrtHHs7pXeTzjuxBrCmmhgC6',
+     ["m", "m/0'"]),
+    ('3ddd5602285899a946114506157c7997e5444528f3003f6134712147db19b678',
+     ["m", "m/0'", "m/0'/1'"]),
+]
+
+def add(a, b):
+    if a is None:
+        return b
+    if b is None:
+        return a
+    if a[0] == b[0] and (a[1] + b[1]) % P == 0:
+        return None
+    if a == b:
+        l = 3 * a[0] * a[0] * pow(2 * a[1], -1, P)
+    else:
+        l = (b[1] - a[1]) * pow(b[0] - a[0], -1, P)
+    x = (l * l - a[0] - b[0]) % P
+    return (x, (l * (a[0] - x) - a[1]) % P)
+
+def mul(k, p):
+    r = None
+    while k:
+        if k & 1:
+            r = add(r, p)
+        p = add(p, p)
+        k >>= 1
+    return r
+
+def sec(p):
+    return bytes([2 + (p[1] & 1)]) + p[0].to_bytes(32, 'big')
+
+def hash160(b):
+    return hashlib.new('ripemd160', hashlib.sha256(b).digest()).digest()
+
+def b58check(b):
+    b += hashlib.sha256(hashlib.sha256(b).digest()).digest()[:4]
+    n, s = int.from_bytes(b, 'big'), ''
+    while n:
+        n, c = divmod(n, 58)
+        s = B58[c] + s
+    return '1' * (len(b) - len(b.lstrip(b'\x00'))) + s
+
+def bech32(hrp, prog):
+    data, acc, bits = [0], 0, 0
+    for c in prog:
+        acc, bits = (acc << 8) | c, bits + 8
+        while bits >= 5:
+            bits -= 5
+            data.append((acc >> bits) & 31)
+    if bits:
+        data.append((acc << (5 - bits)) & 31)
+    def polymod(v):
+        chk = 1
+        for x in v:
+            top = chk >> 25
+            chk = (chk & 0x1ffffff) << 5 ^ x
+            for i, g in enumerate([0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3]):
+                chk ^= g if (top >> i) & 1 else 0
+        return chk
+    exp = [ord(c) >> 5 for c in hrp] + [0] + [ord(c) & 31 for c in hrp]
+    mod = polymod(exp + data + [0] * 6) ^ 1
+    return hrp + '1' + ''.join(B32[d] for d in data + [(mod >> 5 * (5 - i)) & 31 for i in range(6)])
+
+class Key:
+    def __init__(self, k, chain, depth=0, parent=b'\x00' * 4, index=0):
+        self.k, self.chain, self.depth, self.parent, self.index = k, chain, depth, parent, index
+
+    def point(self):
+        return self.k if isinstance(self.k, tuple) else mul(self.k, G)
+
+    def child(self, i):
+        if i & HARD:
+            data = b'\x00' + self.k.to_bytes(32, 'big')
+        else:
+            data = sec(self.point())
+        h = hmac.new(self.chain, data + i.to_bytes(4, 'big'), hashlib.sha512).digest()
+        t = int.from_bytes(h[:32], 'big')
+        if isinstance(self.k, tuple):
+            k = add(mul(t, G), self.k)
+        else:
+            k = (t + self.k) % N
+        return Key(k, h[32:], self.depth + 1, hash160(sec(self.point()))[:4], i)
+
+    def neuter(self):
+        return Key(self.point(), self.chain, self.depth, self.parent, self.index)
+
+    def ext(self):
+        if isinstance(self.k, tuple):
+            version, data = '0488b21e', sec(self.k)
+        else:
+            version, data = '0488ade4', b'\x00' + self.k.to_bytes(32, 'big')
+        return b58check(bytes.fromhex(version) + bytes([self.depth]) + self.parent +
+                        self.index.to_bytes(4, 'big') + self.chain + data)
+
+def derive(key, path):
+    for p in path.split('/')[1:]:
+        key = key.child(int(p.rstrip("'")) + (HARD if p.endswith("'") else 0))
+    return key
+
+def unb58(s):
+    n = 0
+    for c in s:
+        n = n * 58 + B58.index(c)
+    return n.to_bytes(82, 'big')
+
+for start, paths in VECTORS:
+    if start.startswith('xprv'):
+        b = unb58(start)
+        master = Key(int.from_bytes(b[46:78], 'big'), b[13:45])
+        print('xprv ' + start)
+    else:
+        h = hmac.new(b'Bitcoin seed', bytes.fromhex(start), hashlib.sha512).digest()
+        master = Key(int.from_bytes(h[:32], 'big'), h[32:])
+        print('seed ' + start)
+    for path in paths:
+        key = derive(master, path)
+        print('path %s %s %s' % (path, key.ext(), key.neuter().ext()))
+
+account = derive(master, "m/0'").neuter()
+print('xpub ' + account.ext())
+for i in range(4):
+    child = account.child(i)
+    pub = sec(child.k)
+    print('child %d %s %s %s' % (i, child.ext(), b58check(b'\x00' + hash160(pub)),
+                                 bech32('bc', hash160(pub))))
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+#
+# Prints the public keys of a few private keys in every form 'btk pubkey'
+# reads and writes: compressed, uncompressed and x-only hex, P2PKH, P2WPKH
+# and BIP86 taproot addresses. Then keys that must be turned away: an x
+# with no point, an x of p or more, and a y off the curve. Last the BIP86
+# vectors, worked out from their internal keys. Points, hashes and
+# encodings are worked out here apart from btk.
+
+import hashlib
+
+P = 2**256 - 2**32 - 977
+N = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141
+G = (0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798,
+     0x483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8)
+B58 = '123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz'
+B32 = 'qpzry9x8gf2tvdw0s3jn54khce6mua7l'
+
+# Decimal private keys: the smallest, the largest, one whose public key
+# has an odd y and the key used by the privkey tests.
+KEYS = [1, 2, 3, N - 1, 0x9931b2d9a562a8cb9d20671d77e126c61759be440376af5a5eac270cefa75a07]
+
+# BIP86 internal keys and addresses for m/86'/0'/0'/0/0, m/86'/0'/0'/0/1
+# and m/86'/0'/0'/1/0 of the 'abandon ... about' mnemonic.
+BIP86 = [
+    ('cc8a4bc64d897bddc5fbc2f670f7a8ba0b386779106cf1223c6fc5d7cd6fc115',
+     'bc1p5cyxnuxmeuwuvkwfem96lqzszd02n6xdcjrs20cac6yqjjwudpxqkedrcr'),
+    ('83dfe85a3151d2517290da461fe2815591ef69f2b18a2ce63f01697a8b313145',
+     'bc1p4qhjn9zdvkux4e44uhx8tc55attvtyu358kutcqkudyccelu0was9fqzwh'),
+    ('399f1b2f4393f29a18c937859c5dd8a77350103157eb880f02e8c08214277cef',
+     'bc1p3qkhfews2uk44qtvauqyr2ttdsw7svhkl9nkm9s9c3x4ax5h60wqwruhk7'),
+]
+
+def add(a, b):
+    if a is None:
+        return b
+    if b is None:
+        return a
+    if a[0] == b[0] and (a[1] + b[1]) % P == 0:
+        return None
+    if a == b:
+        l = 3 * a[0] * a[0] * pow(2 * a[1], -1, P)
+    else:
+        l = (b[1] - a[1]) * pow(b[0] - a[0], -1, P)
+    x = (l * l - a[0] - b[0]) % P
+    return (x, (l * (a[0] - x) - a[1]) % P)
+
+def mul(k, p=G):
+    r = None
+    while k:
+        if k & 1:
+            r = add(r, p)
+        p = add(p, p)
+        k >>= 1
+    return r
+
+def lift(x):
+    y = pow(x ** 3 + 7, (P + 1) // 4, P)
+    if y * y % P != (x ** 3 + 7) % P:
+        return None
+    return (x, y if y % 2 == 0 else P - y)
+
+def sha(b):
+    return hashlib.sha256(b).digest()
+
+def tagged(tag, b):
+    t = sha(tag.encode())
+    return sha(t + t + b)
+
+def hash160(b):
+    return hashlib.new('ripemd160', sha(b)).digest()
+
+def compressed(p):
+    return bytes([2 + (p[1] & 1)]) + p[0].to_bytes(32, 'big')
+
+def uncompressed(p):
+    return b'\x04' + p[0].to_bytes(32, 'big') + p[1].to_bytes(32, 'big')
+
+def b58check(b):
+    b += sha(sha(b))[:4]
+    n, s = int.from_bytes(b, 'big'), ''
+    while n:
+        n, r = divmod(n, 58)
+        s = B58[r] + s
+    return '1' * (len(b) - len(b.lstrip(b'\x00'))) + s
+
+def bech32(version, program):
+    def polymod(values):
+        c = 1
+        for v in values:
+            b = c >> 25
+            c = (c & 0x1ffffff) << 5 ^ v
+            for i, g in enumerate([0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3]):
+                c ^= g if (b >> i) & 1 else 0
+        return c
+    data, acc, bits = [version], 0, 0
+    for x in program:
+        acc, bits = acc << 8 | x, bits + 8
+        while bits >= 5:
+            bits -= 5
+            data.append(acc >> bits & 31)
+    if bits:
+        data.append(acc << (5 - bits) & 31)
+    check = polymod([3, 3, 0, 2, 3] + data + [0] * 6) ^ (0x2bc830a3 if version else 1)
+    return 'bc1' + ''.join(B32[d] for d in data + [check >> 5 * (5 - i) & 31 for i in range(6)])
+
+def taproot(x):
+    p = lift(x)
+    q = add(p, mul(int.from_bytes(tagged('TapTweak', x.to_bytes(32, 'big')), 'big')))
+    return bech32(1, q[0].to_bytes(32, 'big'))
+
+for d in KEYS:
+    p = mul(d)
+    print('key %d %s %s %s %s %s %s %s' % (
+        d, compressed(p).hex(), uncompressed(p).hex(), p[0].to_bytes(32, 'big').hex(),
+        b58check(b'\x00' + hash160(compressed(p))), b58check(b'\x00' + hash160(uncompressed(p))),
+        bech32(0, hash160(compressed(p))), taproot(p[0])))
+
+x = 1
+while lift(x) is not None:
+    x += 1
+print('rejected 02%064x' % x)
+print('rejected 02%064x' % P)
+print('rejected 03%064x' % (2**256 - 1))
+p = mul(KEYS[-1])
+print('rejected 04%064x%064x' % (p[0], (p[1] + 1) % P))
+
+for internal, expected in BIP86:
+    assert taproot(int(internal, 16)) == expected
+    print('bip86 %s %s' % (internal, expected))
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+#
+# Writes scripts/blk00000.dat, one block whose transactions carry scripts
+# for 'btk blocks -a' to disassemble, and prints the transaction lines it
+# should produce. The disassembler here is written apart from btk's.
+
+import hashlib, json, struct, os
+
+WORDS = {0x00: 'OP_FALSE', 0x4c: 'OP_PUSHDATA1', 0x4d: 'OP_PUSHDATA2', 0x4e: 'OP_PUSHDATA4',
+         0x4f: 'OP_1NEGATE', 0x50: 'OP_RESERVED', 0x51: 'OP_TRUE', 0x60: 'OP_16', 0x63: 'OP_IF',
+         0x67: 'OP_ELSE', 0x68: 'OP_ENDIF', 0x6a: 'OP_RETURN', 0x75: 'OP_DROP', 0x76: 'OP_DUP',
+         0x87: 'OP_EQUAL', 0x88: 'OP_EQUALVERIFY', 0xa9: 'OP_HASH160', 0xac: 'OP_CHECKSIG',
+         0xb1: 'OP_CHECKLOCKTIMEVERIFY', 0xb2: 'OP_CHECKSEQUENCEVERIFY', 0xba: 'OP_CHECKSIGADD',
+         0xff: 'OP_INVALIDOPCODE'}
+
+def dsha(b):
+    return hashlib.sha256(hashlib.sha256(b).digest()).digest()
+
+def cs(n):
+    if n < 0xfd:
+        return bytes([n])
+    return b'\xfd' + struct.pack('<H', n)
+
+def push(b):
+    return (bytes([len(b)]) if len(b) < 0x4c else b'\x4c' + bytes([len(b)])) + b
+
+def asm(s):
+    out, i = [], 0
+    while i < len(s):
+        op = s[i]
+        i += 1
+        if 0x01 <= op <= 0x4e:
+            if op < 0x4c:
+                n = op
+            else:
+                w = {0x4c: 1, 0x4d: 2, 0x4e: 4}[op]
+                if len(s) - i < w:
+                    return None
+                n = int.from_bytes(s[i:i + w], 'little')
+                i += w
+            if len(s) - i < n:
+                return None
+            out.append(s[i:i + n].hex() if n else WORDS[op])
+            i += n
+        else:
+            out.append(WORDS[op])
+    return ' '.join(out)
+
+def tx(ins, outs):
+    r = struct.pack('<i', 1) + cs(len(ins))
+    for prev, n, script in ins:
+        r += prev + struct.pack('<I', n) + cs(len(script)) + script + struct.pack('<I', 0xffffffff)
+    r += cs(len(outs))
+    for value, script in outs:
+        r += struct.pack('<q', value) + cs(len(script)) + script
+    return r + struct.pack('<I', 0)
+
+coinbase = tx([(b'\x00' * 32, 0xffffffff, push(struct.pack('<I', 7)) + push(b'btk test'))], [
+    (1000, b'\x76\xa9\x14' + b'\x11' * 20 + b'\x88\xac'),
+    (2000, b'\x00\x20' + b'\x22' * 32),
+    (3000, b'\x51\x20' + b'\x33' * 32),
+    (0, b'\x6a\x4c\x50' + b'\x44' * 80),
+    (4000, b'\x4d\x03\x00\xaa\xbb\xcc\x75'),
+    (5000, b'\x4e\x00\x00\x00\x00\x51'),
+    (6000, b'\x63\x4f\x67\x60\x68\xb1\xb2\xba\x50\xff'),
+    (7000, b'\x05\x01\x02'),
+    (8000, b'\x4c'),
+    (9000, b''),
+])
+spend = tx([(b'\xab' * 32, 0, b'\x4d\x01'),
+            (b'\xcd' * 32, 1, b'\x00' + push(b'\x30' + b'\x55' * 70) + push(b'\x02' + b'\x66' * 32))], [
+    (500, b'\xa9\x14' + b'\x77' * 20 + b'\x87'),
+])
+
+txs = [coinbase, spend]
+ids = [dsha(t) for t in txs]
+root = ids[0]
+level = ids
+while len(level) > 1:
+    if len(level) % 2:
+        level.append(level[-1])
+    level = [dsha(level[i] + level[i + 1]) for i in range(0, len(level), 2)]
+header = struct.pack('<i', 0x20000000) + b'\x00' * 32 + level[0] + struct.pack('<III', 1231006600, 0x207fffff, 0)
+block = header + cs(len(txs)) + b''.join(txs)
+block_hash = dsha(header)[::-1].hex()
+
+os.makedirs(os.path.join(os.path.dirname(__file__) or '.', 'scripts'), exist_ok=True)
+with open(os.path.join(os.path.dirname(__file__) or '.', 'scripts', 'blk00000.dat'), 'wb') as f:
+    f.write(bytes.fromhex('f9beb4d9') + struct.pack('<I', len(block)) + block)
+
+def scripts(t):
+    i = 4
+    def var():
+        nonlocal i
+        n = t[i]
+        i += 1
+        if n == 0xfd:
+            n = int.from_bytes(t[i:i + 2], 'little')
+            i += 2
+        return n
+    ins, outs = [], []
+    for _ in range(var()):
+        i += 36
+        n = var()
+        ins.append(t[i:i + n])
+        i += n + 4
+    values = 0
+    for _ in range(var()):
+        values += int.from_bytes(t[i:i + 8], 'little')
+        i += 8
+        n = var()
+        outs.append(t[i:i + n])
+        i += n
+    return ins, outs, values
+
+for index, t in enumerate(txs):
+    ins, outs, value = scripts(t)
+    line = '{"type": "tx", "block": "%s", "index": %d, "txid": "%s", "size": %d, "segwit": false, "inputs": %d, "outputs": %d, "value": %d, "input_scripts": %s, "output_scripts": %s}' % (
+        block_hash, index, dsha(t)[::-1].hex(), len(t), len(ins), len(outs), value,
+        json.dumps([asm(s) for s in ins]), json.dumps([asm(s) for s in outs]))
+    print(line)
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# Prints what 'btk sign' should write for the keys in sign/ and the hashes
+# below: DER, compact and BIP340 Schnorr signatures, one per hash. The
+# RFC6979 and BIP340 nonces and the signatures are worked out here apart
+# from btk, in plain integers. Schnorr lines give every other hash some
+# auxiliary randomness.
+
+import hashlib, hmac, os
+
+P = 2**256 - 2**32 - 977
+N = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141
+G = (0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798,
+     0x483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8)
+B58 = '123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz'
+
+def add(a, b):
+    if a is None:
+        return b
+    if b is None:
+        return a
+    if a[0] == b[0] and (a[1] + b[1]) % P == 0:
+        return None
+    if a == b:
+        l = 3 * a[0] * a[0] * pow(2 * a[1], -1, P)
+    else:
+        l = (b[1] - a[1]) * pow(b[0] - a[0], -1, P)
+    x = (l * l - a[0] - b[0]) % P
+    return (x, (l * (a[0] - x) - a[1]) % P)
+
+def mul(k, p):
+    r = None
+    while k:
+        if k & 1:
+            r = add(r, p)
+        p = add(p, p)
+        k >>= 1
+    return r
+
+def nonces(d, h):
+    x = d.to_bytes(32, 'big')
+    z = (int.from_bytes(h, 'big') % N).to_bytes(32, 'big')
+    v, k = b'\x01' * 32, b'\x00' * 32
+    k = hmac.new(k, v + b'\x00' + x + z, hashlib.sha256).digest()
+    v = hmac.new(k, v, hashlib.sha256).digest()
+    k = hmac.new(k, v + b'\x01' + x + z, hashlib.sha256).digest()
+    v = hmac.new(k, v, hashlib.sha256).digest()
+    while True:
+        v = hmac.new(k, v, hashlib.sha256).digest()
+        t = int.from_bytes(v, 'big')
+        if 1 <= t < N:
+            yield t
+        k = hmac.new(k, v + b'\x00', hashlib.sha256).digest()
+        v = hmac.new(k, v, hashlib.sha256).digest()
+
+def sign(d, h):
+    z = int.from_bytes(h, 'big') % N
+    for k in nonces(d, h):
+        r = mul(k, G)[0] % N
+        s = pow(k, -1, N) * (z + r * d) % N
+        if r and s:
+            return r, min(s, N - s)
+
+def tagged(tag, b):
+    t = hashlib.sha256(tag.encode()).digest()
+    return hashlib.sha256(t + t + b).digest()
+
+def schnorr(d, m, aux):
+    p = mul(d, G)
+    d = d if p[1] % 2 == 0 else N - d
+    px = p[0].to_bytes(32, 'big')
+    t = (d ^ int.from_bytes(tagged('BIP0340/aux', aux), 'big')).to_bytes(32, 'big')
+    k = int.from_bytes(tagged('BIP0340/nonce', t + px + m), 'big') % N
+    r = mul(k, G)
+    k = k if r[1] % 2 == 0 else N - k
+    rx = r[0].to_bytes(32, 'big')
+    e = int.from_bytes(tagged('BIP0340/challenge', rx + px + m), 'big') % N
+    return (rx + ((k + e * d) % N).to_bytes(32, 'big')).hex()
+
+def der(r, s):
+    def integer(v):
+        b = v.to_bytes(32, 'big').lstrip(b'\x00')
+        if b[0] & 0x80:
+            b = b'\x00' + b
+        return b'\x02' + bytes([len(b)]) + b
+    b = integer(r) + integer(s)
+    return (b'\x30' + bytes([len(b)]) + b).hex()
+
+def key(path):
+    s = open(path).read().strip()
+    if len(s) == 64:
+        return int(s, 16)
+    n = 0
+    for c in s:
+        n = n * 58 + B58.index(c)
+    return int.from_bytes(n.to_bytes(38, 'big')[1:33], 'big')
+
+hashes = [hashlib.sha256(b'Satoshi Nakamoto').digest(),
+          hashlib.sha256(b'All those moments will be lost in time, like tears in rain. Time to die...').digest(),
+          bytes(32),
+          N.to_bytes(32, 'big'),
+          b'\xff' * 32]
+
+aux = [hashlib.sha256(h).digest() if i % 2 else None for i, h in enumerate(hashes)]
+
+print('hashes: ' + ' '.join(h.hex() for h in hashes))
+print('aux: ' + ' '.join(a.hex() if a else '-' for a in aux))
+d = os.path.join(os.path.dirname(__file__) or '.', 'sign')
+for name in sorted(os.listdir(d)):
+    sigs = [sign(key(os.path.join(d, name)), h) for h in hashes]
+    print(name + ' der: ' + ' '.join(der(r, s) for r, s in sigs))
+    print(name + ' compact: ' + ' '.join('%064x%064x' % rs for rs in sigs))
+    print(name + ' schnorr: ' + ' '.join(schnorr(key(os.path.join(d, name)), h, a or bytes(32))
+                                         for h, a in zip(hashes, aux)))
@@ -4,7 +4,7 @@ BEGIN
 {
 	use Exporter();
 	@ISA = qw(Exporter);
-	@EXPORT_OK = qw($privkey $networks $compression $iotypes $ntests);
+	@EXPORT_OK = qw($privkey $networks $compression $iotypes $ntests $blocks_asm $sign $hd $pubkey $chain);
 }
 
 $iotypes = ["wif", "hex", "dec"];
@@ -76,4 +76,351 @@ $privkey = [
 	##},
 ];
 
+# Transaction lines of 'btk blocks -a test/data/scripts', as written by
+# test/data/mkscripts.py.
+$blocks_asm = [
+	'{"type": "tx", "block": "5e5668aceef16735979c3db590e557ecafa249d3781d697fcb252e6a884dd0a3", "index": 0, "txid": "0a062801dc6ea39e2cb313330f4b072b509f0d5ddd5eb039bfb8f7b01f0d6228", "size": 358, "segwit": false, "inputs": 1, "outputs": 10, "value": 45000, "input_scripts": ["07000000 62746b2074657374"], "output_scripts": ["OP_DUP OP_HASH160 1111111111111111111111111111111111111111 OP_EQUALVERIFY OP_CHECKSIG", "OP_FALSE 2222222222222222222222222222222222222222222222222222222222222222", "OP_TRUE 3333333333333333333333333333333333333333333333333333333333333333", "OP_RETURN 4444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444444", "aabbcc OP_DROP", "OP_PUSHDATA4 OP_TRUE", "OP_IF OP_1NEGATE OP_ELSE OP_16 OP_ENDIF OP_CHECKLOCKTIMEVERIFY OP_CHECKSEQUENCEVERIFY OP_CHECKSIGADD OP_RESERVED OP_INVALIDOPCODE", null, null, ""]}',
+	'{"type": "tx", "block": "5e5668aceef16735979c3db590e557ecafa249d3781d697fcb252e6a884dd0a3", "index": 1, "txid": "161c1a55411e7a475de6727fffeaac504d821ec5642144f82254bd837e809f9c", "size": 233, "segwit": false, "inputs": 2, "outputs": 1, "value": 500, "input_scripts": [null, "OP_FALSE 3055555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555555 026666666666666666666666666666666666666666666666666666666666666666"], "output_scripts": ["OP_HASH160 7777777777777777777777777777777777777777 OP_EQUAL"]}',
+];
+
+# Hashes signed by each key file in test/data/sign, with the auxiliary
+# randomness of Schnorr signatures where there is any, and what 'btk sign'
+# should write for them, as worked out by test/data/mksign.py.
+$sign = {
+	"hashes" => [
+		"a0dc65ffca799873cbea0ac274015b9526505daaaed385155425f7337704883e",
+		"7d1833f54854ac51659521afcd0ec6dca2ce2351429614bfa28a756b1b3c637f",
+		"0000000000000000000000000000000000000000000000000000000000000000",
+		"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141",
+		"ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+	],
+	"aux" => [
+		"",
+		"2d05acb0ee80ac5641bf1e08235bd71390cc6873f9dd60dc0c3778b255cbc4a1",
+		"",
+		"3717939056ee94b1054210ce2b27284d9a8ac5e2880e326d53feb8d4cbb89907",
+		"",
+	],
+	"keys" => {
+		"bip340-0.hex" => {
+			"der" => [
+				"3045022100b17d34c014972d273149b331b3cc140f5205737dc2c0fde9a47f44b5ec53326f0220037857059194e4faa9631f4323e50478870c96699a184089098ff6aff18aae38",
+				"304402200fdb5577abbaafb6b52a219aa7eadaf89b2891aa2fa2b4e984867ce231552b3d0220435eb163f5c927e4c4d31ed4121b5fb1025d6553e300e43a4d54f903e1918127",
+				"3045022100e95058f48325b8b37415edd898822fcfc83d8fdc5e257d3c370c0304c42dd5f202206836450f27b3ccd9d0e86629627b28b61fcdaeab49d9099f4170ccd3b3258e81",
+				"3045022100e95058f48325b8b37415edd898822fcfc83d8fdc5e257d3c370c0304c42dd5f202206836450f27b3ccd9d0e86629627b28b61fcdaeab49d9099f4170ccd3b3258e81",
+				"304502210080c3bb67a6c5c84f966787347ed61e0e71e9a572e5085ea784ae43a9c2d3557102204f641a58c1b0b300bc09fe739be2f56aa4b1a6372b24b09f37037f13c01a826e",
+			],
+			"compact" => [
+				"b17d34c014972d273149b331b3cc140f5205737dc2c0fde9a47f44b5ec53326f037857059194e4faa9631f4323e50478870c96699a184089098ff6aff18aae38",
+				"0fdb5577abbaafb6b52a219aa7eadaf89b2891aa2fa2b4e984867ce231552b3d435eb163f5c927e4c4d31ed4121b5fb1025d6553e300e43a4d54f903e1918127",
+				"e95058f48325b8b37415edd898822fcfc83d8fdc5e257d3c370c0304c42dd5f26836450f27b3ccd9d0e86629627b28b61fcdaeab49d9099f4170ccd3b3258e81",
+				"e95058f48325b8b37415edd898822fcfc83d8fdc5e257d3c370c0304c42dd5f26836450f27b3ccd9d0e86629627b28b61fcdaeab49d9099f4170ccd3b3258e81",
+				"80c3bb67a6c5c84f966787347ed61e0e71e9a572e5085ea784ae43a9c2d355714f641a58c1b0b300bc09fe739be2f56aa4b1a6372b24b09f37037f13c01a826e",
+			],
+			"schnorr" => [
+				"70ffbe29ef2da1f7ef506913ea2b1a4f3372f1ca9b7fd578347ba41035266d463f312cfaea7b36d61361ac026f79b39f15d59daaea93344ce8c2cc19f5f8994d",
+				"d6042264b5c68df9a0e629eed7389477de568575d99ee8ca09575bdfa112c14463d45e388779da9798ac26cf82877b0c291b35d68c45682b1a3ccb90d1995206",
+				"e907831f80848d1069a5371b402410364bdf1c5f8307b0084c55f1ce2dca821525f66a4a85ea8b71e482a74f382d2ce5ebeee8fdb2172f477df4900d310536c0",
+				"372719d8908acc770805b6a2b15892243c050676b951b477cd79db11c17f9fc41cf27dda990ee97bcb0696af9099949612e26e188707ef63243280b75f0ca58f",
+				"1d80dbea884b35653f280de536855a072781c7b019edb60edad7c344e73184ec2b91398b384ba49ae365e40c24c4c10896b26d97084c179341c893d229c475a6",
+			],
+		},
+		"bip340-1.hex" => {
+			"der" => [
+				"3045022100cf7361a8d305cdeaa781318d1461d0757906612b049860a5f06bfb9f163441c1022070eeb0c2f6f48d3cf0d09aa65e8da27c636d36387df59c5b12c062943e1ad1fd",
+				"304502210096424d8cc440671d11d0a84cd4731e4e8c10031aedc82ff00fca3109f02876dc022028640e22f74580ab1d2a78b40369a9b7a46e6285525e436e2ebb40bbc4ca0e91",
+				"3044022053b9b76fb77bd2522a114a900d5e4c205c9c513b6d0881725caddb8b3dd16dac022070b403b86150ab07f40be106ead3be94165c183548978ce522bdc9e4f2380c28",
+				"3044022053b9b76fb77bd2522a114a900d5e4c205c9c513b6d0881725caddb8b3dd16dac022070b403b86150ab07f40be106ead3be94165c183548978ce522bdc9e4f2380c28",
+				"3045022100dd8a07006269864ccf7cec389d4207059b08fcd268b9373dbe9a71b84fe231ab02205277d99e71cdedbe3762f1d2c1f0ebda958e28b267b505d4496fe4d66ed49b01",
+			],
+			"compact" => [
+				"cf7361a8d305cdeaa781318d1461d0757906612b049860a5f06bfb9f163441c170eeb0c2f6f48d3cf0d09aa65e8da27c636d36387df59c5b12c062943e1ad1fd",
+				"96424d8cc440671d11d0a84cd4731e4e8c10031aedc82ff00fca3109f02876dc28640e22f74580ab1d2a78b40369a9b7a46e6285525e436e2ebb40bbc4ca0e91",
+				"53b9b76fb77bd2522a114a900d5e4c205c9c513b6d0881725caddb8b3dd16dac70b403b86150ab07f40be106ead3be94165c183548978ce522bdc9e4f2380c28",
+				"53b9b76fb77bd2522a114a900d5e4c205c9c513b6d0881725caddb8b3dd16dac70b403b86150ab07f40be106ead3be94165c183548978ce522bdc9e4f2380c28",
+				"dd8a07006269864ccf7cec389d4207059b08fcd268b9373dbe9a71b84fe231ab5277d99e71cdedbe3762f1d2c1f0ebda958e28b267b505d4496fe4d66ed49b01",
+			],
+			"schnorr" => [
+				"3996828d300e11c7c7dc949cb079dda5dcc1a802ec5120562729785f6c6865b942d7cc9bec23a6a3b0fcd8465044ce61d62a5d31c9ec678e99088b1b3150d82a",
+				"e3cc5a7ffe31d093b732451edd12e83706eb4487e796c49effc45b6236d8f0de7a128dde87dd1de8b34453a8bf021384bf04fa822d60643b141d840cd7df68b2",
+				"ef4f25354028283cfbda75f7eb1682a610739071ef27ca79558c0159d57c767486e49e37a8f6b1187690057a2345b9c42635765a2874effd1fcc950085468a70",
+				"a38d9b28d50ecd035fe0c43232f3f129f0adc948c3ed95582046bf3a5363ed5dfe9c5a324878b85019ed9c251dd23072211af0d139913c7304be9d39e2963039",
+				"bcfde08aab8a6e325c020abbcad0e1ff16bb0389fd2b957410dca61909d644c1b4876bc5d4f12030ac72cef09d700368988aa904b5d0ac7883394960db169ec0",
+			],
+		},
+		"bip340-2.hex" => {
+			"der" => [
+				"3045022100c88a43b8fb3565529c9ac60d692c58ff551822ecae87ea460d6926d8ee070c9e022035134ba97818e9fd4f9b1274f7781d98280460b06a551f19902a735febd82174",
+				"3044022004f1afbe260a0f81725af6eeb9aeebf8a7aa120d837ae199e9eaf6cfd7fb7488022005d0f5207c7cbf90660250d1f959280774f5a3dee6b30903e78cd5285269e4d7",
+				"3045022100b6eefafa04d0b0257fe3986f3b3d2b6e2dcaca84b9c4197ac921d36fa0b01420022024d170bf5eb943108d52d372ac6fcbf134aba77e912818a546cdb2b0bbe6b63e",
+				"3045022100b6eefafa04d0b0257fe3986f3b3d2b6e2dcaca84b9c4197ac921d36fa0b01420022024d170bf5eb943108d52d372ac6fcbf134aba77e912818a546cdb2b0bbe6b63e",
+				"3045022100edf27ffff87dddb1424132b7ad72148579708649062d0dd0314f294787cd6dfa02207ea19f173cd69a940b7b97092bc09dc03422b4e083d7eb77b996acecc20c1921",
+			],
+			"compact" => [
+				"c88a43b8fb3565529c9ac60d692c58ff551822ecae87ea460d6926d8ee070c9e35134ba97818e9fd4f9b1274f7781d98280460b06a551f19902a735febd82174",
+				"04f1afbe260a0f81725af6eeb9aeebf8a7aa120d837ae199e9eaf6cfd7fb748805d0f5207c7cbf90660250d1f959280774f5a3dee6b30903e78cd5285269e4d7",
+				"b6eefafa04d0b0257fe3986f3b3d2b6e2dcaca84b9c4197ac921d36fa0b0142024d170bf5eb943108d52d372ac6fcbf134aba77e912818a546cdb2b0bbe6b63e",
+				"b6eefafa04d0b0257fe3986f3b3d2b6e2dcaca84b9c4197ac921d36fa0b0142024d170bf5eb943108d52d372ac6fcbf134aba77e912818a546cdb2b0bbe6b63e",
+				"edf27ffff87dddb1424132b7ad72148579708649062d0dd0314f294787cd6dfa7ea19f173cd69a940b7b97092bc09dc03422b4e083d7eb77b996acecc20c1921",
+			],
+			"schnorr" => [
+				"d2a6418b48c914006d98c784ac0299233383e84c43e602e213d036386a49834b2f4a644c48f042526f54992a6e40d76a1b64b3fd993a641de1bed3854f4de95d",
+				"0c4db640e5ec08b06f9bd33a3baedd9434d036273c332fe5a204f1fc100651ff3b52f48cf3815e2a929e8fceb92b0c98441ac33a7f0ab4760149116209698d03",
+				"0dbb3ae50ff8b59116970a92261ebe1146a27fb7136ae66ffa8807d970eb66807918af41377611aedee1f8672587d5a576c538c1f1d223d7ecd9760075746c0b",
+				"b20ed5c89feb230e1d34694b1f9b8b005560712bcfb64f14ae6e7dea6258391d620eaba4e96fbf2a5f3d7429b3c40419722a50ce64a0d0a6ca00b8dc81f9c8b7",
+				"04653c6092052fef717d8ee3dc6c0e8bf2de275ac4aa26408ab336763055d330d193bc773e030917f74e5184e3c861cd4d466e55d2edc5995c651d7d64722258",
+			],
+		},
+		"bip340-3.hex" => {
+			"der" => [
+				"304502210090267a086bf6abc91cd55ac12a823888a32e36857050449595e5677d58f120160220367b1d021947eb4147e9c4bdb54226fa349b38bc0f101d518667ee296a5257a8",
+				"304402201e33e9201bcc457a41c5cfb4aa2f0418fe2deb9e25c585276036682288d6446902204b67f2b5af79d3d45c94bbdb48684a1e7f7969ba999f605b109d402bf3266b9b",
+				"3044022025b9250e51b0b0b5ebd7ae6f138b20339ca3b53c3dd125fe71813f71a61ca78502202868607bfd4bac77d53cc46b0fdece813fed2ed0a9a96e1c36ec5abb1977dee8",
+				"3044022025b9250e51b0b0b5ebd7ae6f138b20339ca3b53c3dd125fe71813f71a61ca78502202868607bfd4bac77d53cc46b0fdece813fed2ed0a9a96e1c36ec5abb1977dee8",
+				"3045022100faed9c6c759e21348739c5c8c77615d54eb716dae65949ab2905c5d621bd22c20220685641810f68888352d799a7c4056771dbe0af838471b945d935a9898a361235",
+			],
+			"compact" => [
+				"90267a086bf6abc91cd55ac12a823888a32e36857050449595e5677d58f12016367b1d021947eb4147e9c4bdb54226fa349b38bc0f101d518667ee296a5257a8",
+				"1e33e9201bcc457a41c5cfb4aa2f0418fe2deb9e25c585276036682288d644694b67f2b5af79d3d45c94bbdb48684a1e7f7969ba999f605b109d402bf3266b9b",
+				"25b9250e51b0b0b5ebd7ae6f138b20339ca3b53c3dd125fe71813f71a61ca7852868607bfd4bac77d53cc46b0fdece813fed2ed0a9a96e1c36ec5abb1977dee8",
+				"25b9250e51b0b0b5ebd7ae6f138b20339ca3b53c3dd125fe71813f71a61ca7852868607bfd4bac77d53cc46b0fdece813fed2ed0a9a96e1c36ec5abb1977dee8",
+				"faed9c6c759e21348739c5c8c77615d54eb716dae65949ab2905c5d621bd22c2685641810f68888352d799a7c4056771dbe0af838471b945d935a9898a361235",
+			],
+			"schnorr" => [
+				"181126824ba75060f10f2935dcbe8459feea2cc64d63b9bfd877be59b04e6249c019d4c806c8af30a1e2e0921cea403e576df1a7fff09e66fbd509f208ebde78",
+				"0bb5920c092b27802b884841ea736c4b4d49cad1c22ec2359025ffc3026b9f7dbdeb266112f59dd1dd4bec33f2fb3dab74ad4051c5d6824e1d8ff01dd51660d7",
+				"894e05e6c0ecc971c306e30e07ad496eb18962cd1de41aad3bcb966e200863ab7926a05f0e1a0345bc3e710f0f1ca85f9cb2e3288e3a6f76e892df67caa8e133",
+				"163f26aea98190c62c11641426d4f225bfd79cf44b4401fc25f7dbf2a87a0c6e172e0153a0c6ed43b107280a40d93776b23dcc60faca57a6a0b573917750a767",
+				"a47234050453e703e798bddae95aa44d4666fd44fa88c7f6d7df1b84273e06580c77639891252eace13e60e40a56c51865923e236631eb415ef373456a2ef560",
+			],
+		},
+		"key.wif" => {
+			"der" => [
+				"30450221008281a534367c97e8b38687e69a7f06fcce6511be67000fabac47c2cacddedb9602204639cb7346e0f453fabdec47a1a8a6569970de150cc18c4e1de8527cad450484",
+				"3045022100ac370e85516a72ae2cacaebb77f1540657f458bc99dca50c10336c92f02df0ce02205072f085e803d7c1a11e1876a1fc4d01631434853ae7e697802452cb1a73ceeb",
+				"3045022100c4df3c5715742086e7a16d1b973d279512039fb9e7e6f07462fcdb05f11e5d6f0220715f88924f0faf43e1be14ac8a1897fcb422a086be6eaa99a98e869ef107287b",
+				"3045022100c4df3c5715742086e7a16d1b973d279512039fb9e7e6f07462fcdb05f11e5d6f0220715f88924f0faf43e1be14ac8a1897fcb422a086be6eaa99a98e869ef107287b",
+				"3045022100ddc5b99ff5d28956ca065df13639d458e5489300c347fa29c249aed036fbc30f022020c5f33a474dbdbfe05f9c52a56b6b057f520a37c6dde6e6d10dc8a4eca812f8",
+			],
+			"compact" => [
+				"8281a534367c97e8b38687e69a7f06fcce6511be67000fabac47c2cacddedb964639cb7346e0f453fabdec47a1a8a6569970de150cc18c4e1de8527cad450484",
+				"ac370e85516a72ae2cacaebb77f1540657f458bc99dca50c10336c92f02df0ce5072f085e803d7c1a11e1876a1fc4d01631434853ae7e697802452cb1a73ceeb",
+				"c4df3c5715742086e7a16d1b973d279512039fb9e7e6f07462fcdb05f11e5d6f715f88924f0faf43e1be14ac8a1897fcb422a086be6eaa99a98e869ef107287b",
+				"c4df3c5715742086e7a16d1b973d279512039fb9e7e6f07462fcdb05f11e5d6f715f88924f0faf43e1be14ac8a1897fcb422a086be6eaa99a98e869ef107287b",
+				"ddc5b99ff5d28956ca065df13639d458e5489300c347fa29c249aed036fbc30f20c5f33a474dbdbfe05f9c52a56b6b057f520a37c6dde6e6d10dc8a4eca812f8",
+			],
+			"schnorr" => [
+				"cb105389a2716292ef9c778310f1b555f6cc5c1f00232d7e3f9bb7ae73abc516e9377314d414cd838036e43a7de9b5e94225d2dfb11a03d9b5418966a52bc894",
+				"f509f0c1b2444fb0476f7e4f17b91fa78a30d44550743fadaa6553b5d17dd15b1ca40682ac2cdaca56b7bcb39eecda477068a38b3c4048f33b4ba3f1074d5b21",
+				"70dc721b19fa547f043da9568d25a63820ad69b99396cdb290732e05ed5660fd54c3343195a4e909649f4145383d9d794fd36dca241db99f4aeb2c7ed8f2aa03",
+				"bde367865a73d7234d6ffd01d63437f5764e90384e7576a0fa5fcad4a7ee751838b37a78a4a7bdcf9e372f84cd494c3e41bafaa75c70ae455ca422f13f361ae8",
+				"11d0ed36e05bc1195f488af1b13338c65d6e9dbd40778975a0cd65320324961a980d9cc6ad13f736cc9c85cf3d226c9a4dd0d3cf2a1eb4e655bba957d239a258",
+			],
+		},
+		"max.hex" => {
+			"der" => [
+				"3045022100fd567d121db66e382991534ada77a6bd3106f0a1098c231e47993447cd6af2d002206b39cd0eb1bc8603e159ef5c20a5c8ad685a45b06ce9bebed3f153d10d93bed5",
+				"30440220059385ce615b7ab6a0db2a3b83f0566d3bc750e958121635ba497ccb4e3ce8010220391bf93814fda99c98014ada8567dd7c067a50ac0a7ef7aa613b87e0eec17eb5",
+				"3045022100919026f3e239ea52cf530eb6d345dc2b56ef0928f1e9ad20d8f360284dc65048022014395e7137e2204f15b69239010f3c34fbb3c858a29b0d106b1fa65bc0047263",
+				"3045022100919026f3e239ea52cf530eb6d345dc2b56ef0928f1e9ad20d8f360284dc65048022014395e7137e2204f15b69239010f3c34fbb3c858a29b0d106b1fa65bc0047263",
+				"3045022100a7f83b5963eaf5332c633327cc967be8f4166d3f1e0b77f9761d8f4e42211e9a022058aae31be1eb1e496923bbe8ca5e843cfb89f4d986d61d4edfd7d6fc3c9cf62c",
+			],
+			"compact" => [
+				"fd567d121db66e382991534ada77a6bd3106f0a1098c231e47993447cd6af2d06b39cd0eb1bc8603e159ef5c20a5c8ad685a45b06ce9bebed3f153d10d93bed5",
+				"059385ce615b7ab6a0db2a3b83f0566d3bc750e958121635ba497ccb4e3ce801391bf93814fda99c98014ada8567dd7c067a50ac0a7ef7aa613b87e0eec17eb5",
+				"919026f3e239ea52cf530eb6d345dc2b56ef0928f1e9ad20d8f360284dc6504814395e7137e2204f15b69239010f3c34fbb3c858a29b0d106b1fa65bc0047263",
+				"919026f3e239ea52cf530eb6d345dc2b56ef0928f1e9ad20d8f360284dc6504814395e7137e2204f15b69239010f3c34fbb3c858a29b0d106b1fa65bc0047263",
+				"a7f83b5963eaf5332c633327cc967be8f4166d3f1e0b77f9761d8f4e42211e9a58aae31be1eb1e496923bbe8ca5e843cfb89f4d986d61d4edfd7d6fc3c9cf62c",
+			],
+			"schnorr" => [
+				"1c22a20154670759be55cfa1a4b1c4d8e203b2e3ce433c4c0f9326913b545c9cfeb67e44bacc4dd00a48e986b7ce0717e91ca24f1853c430dc8bebce367862f0",
+				"fc01e5b4b894ad670a3021b20fabe85970844ba8081d64df379049bc730ca11561b654a7bb1cd6097b0ceb2ffa729fd3261a6bed30d7613af183cf3c9c71ec10",
+				"d2bcee6a047e765467f3ed7c3e8f55edcfa4a5fd37a9bcd064c1b5041599b187c3f9f2be0665d539e38eb75989b4bc3f6dd2d9d18c5c123613615d1731e0523e",
+				"0d2c4985f63f5869e5d442058b0a80f019e1b2805754a6b5cf4ce1187e5ba54ec4f8617fde95aa5bf2f6a8e4ab63a3126daed69cc35f1b46359caf3eb6668422",
+				"d059b7dd274941953afb75076e11cc966d952df60fb5ac6240df814c26e8dde3b0b155b23a83ccc8fedf4374575a831f7d7efca39164003cc7273cbf6ccce926",
+			],
+		},
+		"one.hex" => {
+			"der" => [
+				"3045022100934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d802202442ce9d2b916064108014783e923ec36b49743e2ffa1c4496f01a512aafd9e5",
+				"30450221008600dbd41e348fe5c9465ab92d23e3db8b98b873beecd930736488696438cb6b0220547fe64427496db33bf66019dacbf0039c04199abb0122918601db38a72cfc21",
+				"3045022100a0b37f8fba683cc68f6574cd43b39f0343a50008bf6ccea9d13231d9e7e2e1e4022011edc8d307254296264aebfc3dc76cd8b668373a072fd64665b50000e9fcce52",
+				"3045022100a0b37f8fba683cc68f6574cd43b39f0343a50008bf6ccea9d13231d9e7e2e1e4022011edc8d307254296264aebfc3dc76cd8b668373a072fd64665b50000e9fcce52",
+				"304402207cb38cc5712e9e11a767615f6080dbc111c9cdd613eb98999fd92a86bafd454002207923ca1f4d03471d2866f776ef8a6d3cac099b427331aeb245aa9dafeddcf115",
+			],
+			"compact" => [
+				"934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d82442ce9d2b916064108014783e923ec36b49743e2ffa1c4496f01a512aafd9e5",
+				"8600dbd41e348fe5c9465ab92d23e3db8b98b873beecd930736488696438cb6b547fe64427496db33bf66019dacbf0039c04199abb0122918601db38a72cfc21",
+				"a0b37f8fba683cc68f6574cd43b39f0343a50008bf6ccea9d13231d9e7e2e1e411edc8d307254296264aebfc3dc76cd8b668373a072fd64665b50000e9fcce52",
+				"a0b37f8fba683cc68f6574cd43b39f0343a50008bf6ccea9d13231d9e7e2e1e411edc8d307254296264aebfc3dc76cd8b668373a072fd64665b50000e9fcce52",
+				"7cb38cc5712e9e11a767615f6080dbc111c9cdd613eb98999fd92a86bafd45407923ca1f4d03471d2866f776ef8a6d3cac099b427331aeb245aa9dafeddcf115",
+			],
+			"schnorr" => [
+				"1c22a20154670759be55cfa1a4b1c4d8e203b2e3ce433c4c0f9326913b545c9cfeb67e44bacc4dd00a48e986b7ce0717e91ca24f1853c430dc8bebce367862f0",
+				"fc01e5b4b894ad670a3021b20fabe85970844ba8081d64df379049bc730ca11561b654a7bb1cd6097b0ceb2ffa729fd3261a6bed30d7613af183cf3c9c71ec10",
+				"d2bcee6a047e765467f3ed7c3e8f55edcfa4a5fd37a9bcd064c1b5041599b187c3f9f2be0665d539e38eb75989b4bc3f6dd2d9d18c5c123613615d1731e0523e",
+				"0d2c4985f63f5869e5d442058b0a80f019e1b2805754a6b5cf4ce1187e5ba54ec4f8617fde95aa5bf2f6a8e4ab63a3126daed69cc35f1b46359caf3eb6668422",
+				"d059b7dd274941953afb75076e11cc966d952df60fb5ac6240df814c26e8dde3b0b155b23a83ccc8fedf4374575a831f7d7efca39164003cc7273cbf6ccce926",
+			],
+		},
+	},
+	# Signing vectors 0 to 3 of BIP340: key file, message, auxiliary
+	# randomness and signature.
+	"bip340" => [
+		["bip340-0.hex", "0000000000000000000000000000000000000000000000000000000000000000", "0000000000000000000000000000000000000000000000000000000000000000", "e907831f80848d1069a5371b402410364bdf1c5f8307b0084c55f1ce2dca821525f66a4a85ea8b71e482a74f382d2ce5ebeee8fdb2172f477df4900d310536c0"],
+		["bip340-1.hex", "243f6a8885a308d313198a2e03707344a4093822299f31d0082efa98ec4e6c89", "0000000000000000000000000000000000000000000000000000000000000001", "6896bd60eeae296db48a229ff71dfe071bde413e6d43f917dc8dcf8c78de33418906d11ac976abccb20b091292bff4ea897efcb639ea871cfa95f6de339e4b0a"],
+		["bip340-2.hex", "7e2d58d8b3bcdf1abadec7829054f90dda9805aab56c77333024b9d0a508b75c", "c87aa53824b4d7ae2eb035a2b5bbbccc080e76cdc6d1692c4b0b62d798e6d906", "5831aaeed7b44bb74e5eab94ba9d4294c49bcf2a60728d8b4c200f50dd313c1bab745879a5ad954a72c45a91c3a51d3c7adea98d82f8481e0e1e03674a6f3fb7"],
+		["bip340-3.hex", "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "7eb0509757e246f19449885651611cb965ecc1a187dd51b64fda1edc9637d5ec97582b9cb13db3933705b32ba982af5af25fd78881ebb32771fc5922efc66ea3"],
+	],
+};
+
+# BIP32 test vectors 1 to 4, each from its seed or master key, and the
+# first children of a public key, as worked out by test/data/mkhd.py.
+$hd = {
+	"vectors" => [
+		{
+			"seed" => "000102030405060708090a0b0c0d0e0f",
+			"paths" => [
+				["m", "xprv9s21ZrQH143K3QTDL4LXw2F7HEK3wJUD2nW2nRk4stbPy6cq3jPPqjiChkVvvNKmPGJxWUtg6LnF5kejMRNNU3TGtRBeJgk33yuGBxrMPHi", "xpub661MyMwAqRbcFtXgS5sYJABqqG9YLmC4Q1Rdap9gSE8NqtwybGhePY2gZ29ESFjqJoCu1Rupje8YtGqsefD265TMg7usUDFdp6W1EGMcet8"],
+				["m/0'", "xprv9uHRZZhk6KAJC1avXpDAp4MDc3sQKNxDiPvvkX8Br5ngLNv1TxvUxt4cV1rGL5hj6KCesnDYUhd7oWgT11eZG7XnxHrnYeSvkzY7d2bhkJ7", "xpub68Gmy5EdvgibQVfPdqkBBCHxA5htiqg55crXYuXoQRKfDBFA1WEjWgP6LHhwBZeNK1VTsfTFUHCdrfp1bgwQ9xv5ski8PX9rL2dZXvgGDnw"],
+				["m/0'/1", "xprv9wTYmMFdV23N2TdNG573QoEsfRrWKQgWeibmLntzniatZvR9BmLnvSxqu53Kw1UmYPxLgboyZQaXwTCg8MSY3H2EU4pWcQDnRnrVA1xe8fs", "xpub6ASuArnXKPbfEwhqN6e3mwBcDTgzisQN1wXN9BJcM47sSikHjJf3UFHKkNAWbWMiGj7Wf5uMash7SyYq527Hqck2AxYysAA7xmALppuCkwQ"],
+				["m/0'/1/2'", "xprv9z4pot5VBttmtdRTWfWQmoH1taj2axGVzFqSb8C9xaxKymcFzXBDptWmT7FwuEzG3ryjH4ktypQSAewRiNMjANTtpgP4mLTj34bhnZX7UiM", "xpub6D4BDPcP2GT577Vvch3R8wDkScZWzQzMMUm3PWbmWvVJrZwQY4VUNgqFJPMM3No2dFDFGTsxxpG5uJh7n7epu4trkrX7x7DogT5Uv6fcLW5"],
+				["m/0'/1/2'/2", "xprvA2JDeKCSNNZky6uBCviVfJSKyQ1mDYahRjijr5idH2WwLsEd4Hsb2Tyh8RfQMuPh7f7RtyzTtdrbdqqsunu5Mm3wDvUAKRHSC34sJ7in334", "xpub6FHa3pjLCk84BayeJxFW2SP4XRrFd1JYnxeLeU8EqN3vDfZmbqBqaGJAyiLjTAwm6ZLRQUMv1ZACTj37sR62cfN7fe5JnJ7dh8zL4fiyLHV"],
+				["m/0'/1/2'/2/1000000000", "xprvA41z7zogVVwxVSgdKUHDy1SKmdb533PjDz7J6N6mV6uS3ze1ai8FHa8kmHScGpWmj4WggLyQjgPie1rFSruoUihUZREPSL39UNdE3BBDu76", "xpub6H1LXWLaKsWFhvm6RVpEL9P4KfRZSW7abD2ttkWP3SSQvnyA8FSVqNTEcYFgJS2UaFcxupHiYkro49S8yGasTvXEYBVPamhGW6cFJodrTHy"],
+			],
+		},
+		{
+			"seed" => "fffcf9f6f3f0edeae7e4e1dedbd8d5d2cfccc9c6c3c0bdbab7b4b1aeaba8a5a29f9c999693908d8a8784817e7b7875726f6c696663605d5a5754514e4b484542",
+			"paths" => [
+				["m", "xprv9s21ZrQH143K31xYSDQpPDxsXRTUcvj2iNHm5NUtrGiGG5e2DtALGdso3pGz6ssrdK4PFmM8NSpSBHNqPqm55Qn3LqFtT2emdEXVYsCzC2U", "xpub661MyMwAqRbcFW31YEwpkMuc5THy2PSt5bDMsktWQcFF8syAmRUapSCGu8ED9W6oDMSgv6Zz8idoc4a6mr8BDzTJY47LJhkJ8UB7WEGuduB"],
+				["m/0", "xprv9vHkqa6EV4sPZHYqZznhT2NPtPCjKuDKGY38FBWLvgaDx45zo9WQRUT3dKYnjwih2yJD9mkrocEZXo1ex8G81dwSM1fwqWpWkeS3v86pgKt", "xpub69H7F5d8KSRgmmdJg2KhpAK8SR3DjMwAdkxj3ZuxV27CprR9LgpeyGmXUbC6wb7ERfvrnKZjXoUmmDznezpbZb7ap6r1D3tgFxHmwMkQTPH"],
+				["m/0/2147483647'", "xprv9wSp6B7kry3Vj9m1zSnLvN3xH8RdsPP1Mh7fAaR7aRLcQMKTR2vidYEeEg2mUCTAwCd6vnxVrcjfy2kRgVsFawNzmjuHc2YmYRmagcEPdU9", "xpub6ASAVgeehLbnwdqV6UKMHVzgqAG8Gr6riv3Fxxpj8ksbH9ebxaEyBLZ85ySDhKiLDBrQSARLq1uNRts8RuJiHjaDMBU4Zn9h8LZNnBC5y4a"],
+				["m/0/2147483647'/1", "xprv9zFnWC6h2cLgpmSA46vutJzBcfJ8yaJGg8cX1e5StJh45BBciYTRXSd25UEPVuesF9yog62tGAQtHjXajPPdbRCHuWS6T8XA2ECKADdw4Ef", "xpub6DF8uhdarytz3FWdA8TvFSvvAh8dP3283MY7p2V4SeE2wyWmG5mg5EwVvmdMVCQcoNJxGoWaU9DCWh89LojfZ537wTfunKau47EL2dhHKon"],
+				["m/0/2147483647'/1/2147483646'", "xprvA1RpRA33e1JQ7ifknakTFpgNXPmW2YvmhqLQYMmrj4xJXXWYpDPS3xz7iAxn8L39njGVyuoseXzU6rcxFLJ8HFsTjSyQbLYnMpCqE2VbFWc", "xpub6ERApfZwUNrhLCkDtcHTcxd75RbzS1ed54G1LkBUHQVHQKqhMkhgbmJbZRkrgZw4koxb5JaHWkY4ALHY2grBGRjaDMzQLcgJvLJuZZvRcEL"],
+				["m/0/2147483647'/1/2147483646'/2", "xprvA2nrNbFZABcdryreWet9Ea4LvTJcGsqrMzxHx98MMrotbir7yrKCEXw7nadnHM8Dq38EGfSh6dqA9QWTyefMLEcBYJUuekgW4BYPJcr9E7j", "xpub6FnCn6nSzZAw5Tw7cgR9bi15UV96gLZhjDstkXXxvCLsUXBGXPdSnLFbdpq8p9HmGsApME5hQTZ3emM2rnY5agb9rXpVGyy3bdW6EEgAtqt"],
+			],
+		},
+		{
+			"xprv" => "xprv9s21ZrQH143K25QhxbucbDDuQ4naNntJRi4KUfWT7xo4EKsHt2QJDu7KXp1A3u7Bi1j8ph3EGsZ9Xvz9dGuVrtHHs7pXeTzjuxBrCmmhgC6",
+			"paths" => [
+				["m", "xprv9s21ZrQH143K25QhxbucbDDuQ4naNntJRi4KUfWT7xo4EKsHt2QJDu7KXp1A3u7Bi1j8ph3EGsZ9Xvz9dGuVrtHHs7pXeTzjuxBrCmmhgC6", "xpub661MyMwAqRbcEZVB4dScxMAdx6d4nFc9nvyvH3v4gJL378CSRZiYmhRoP7mBy6gSPSCYk6SzXPTf3ND1cZAceL7SfJ1Z3GC8vBgp2epUt13"],
+				["m/0'", "xprv9uPDJpEQgRQfDcW7BkF7eTya6RPxXeJCqCJGHuCJ4GiRVLzkTXBAJMu2qaMWPrS7AANYqdq6vcBcBUdJCVVFceUvJFjaPdGZ2y9WACViL4L", "xpub68NZiKmJWnxxS6aaHmn81bvJeTESw724CRDs6HbuccFQN9Ku14VQrADWgqbhhTHBaohPX4CjNLf9fq9MYo6oDaPPLPxSb7gwQN3ih19Zm4Y"],
+			],
+		},
+		{
+			"seed" => "3ddd5602285899a946114506157c7997e5444528f3003f6134712147db19b678",
+			"paths" => [
+				["m", "xprv9s21ZrQH143K48vGoLGRPxgo2JNkJ3J3fqkirQC2zVdk5Dgd5w14S7fRDyHH4dWNHUgkvsvNDCkvAwcSHNAQwhwgNMgZhLtQC63zxwhQmRv", "xpub661MyMwAqRbcGczjuMoRm6dXaLDEhW1u34gKenbeYqAix21mdUKJyuyu5F1rzYGVxyL6tmgBUAEPrEz92mBXjByMRiJdba9wpnN37RLLAXa"],
+				["m/0'", "xprv9vB7xEWwNp9kh1wQRfCCQMnZUEG21LpbR9NPCNN1dwhiZkjjeGRnaALmPXCX7SgjFTiCTT6bXes17boXtjq3xLpcDjzEuGLQBM5ohqkao9G", "xpub69AUMk3qDBi3uW1sXgjCmVjJ2G6WQoYSnNHyzkmdCHEhSZ4tBok37xfFEqHd2AddP56Tqp4o56AePAgCjYdvpW2PU2jbUPFKsav5ut6Ch1m"],
+				["m/0'/1'", "xprv9xJocDuwtYCMNAo3Zw76WENQeAS6WGXQ55RCy7tDJ8oALr4FWkuVoHJeHVAcAqiZLE7Je3vZJHxspZdFHfnBEjHqU5hG1Jaj32dVoS6XLT1", "xpub6BJA1jSqiukeaesWfxe6sNK9CCGaujFFSJLomWHprUL9DePQ4JDkM5d88n49sMGJxrhpjazuXYWdMf17C9T5XnxkopaeS7jGk1GyyVziaMt"],
+			],
+		},
+	],
+	"xpub" => "xpub69AUMk3qDBi3uW1sXgjCmVjJ2G6WQoYSnNHyzkmdCHEhSZ4tBok37xfFEqHd2AddP56Tqp4o56AePAgCjYdvpW2PU2jbUPFKsav5ut6Ch1m",
+	"children" => [
+		["xpub6BJA1jShPFDgNLUmRfbtEguY6gWiGd1b1RKP5uG5BnyanpWSJwfw3HDVwhtPCaX7i4Licar1PY5q4iGjnTuWRvDWjpctJrc5vZEkbZRSewb", "1M54F4sPNnv9hQ2rLhYyAFvVNeKWSpsHKY", "bc1qmsnw9c297u5edzj8hyqfrl7yu52kjs020j0cw7"],
+		["xpub6BJA1jShPFDgQ9NkDPYMKcpTXD987EmLa5UFcM3iyuqNwMKvULH3uGGBYkHyroDu2uqABJkP94X8qfj8t8GVVcpbP5dB2LV6iAkkNF2J3B9", "1Gto1pPvJCjL9jYMjmAj6rTqXXUYS4WAF1", "bc1q4e2c9mt8ndxukwc22vy2nc8njzfjaxc0n3zwvz"],
+		["xpub6BJA1jShPFDgSZc9rNAYsWmRh6N7XkJ7rAPomQARnbHnc2ZLXssEfC38x3xxLprivo4G6RQ32JsYA1cCkbivoR4eXAspNobpWxHfgVkXwvX", "1EFLZU9oCXRGeHXM1eF8QrQcaMfJQvigbY", "bc1qj98ujn3v0g2w23qflly4qahgc05sm890uqm7z6"],
+		["xpub6BJA1jShPFDgW6L6kexGjaZVzEDpfbgxEwQNzMRued3F6FC5CwvWwTKcjYvR6jLfW5xiR5rWi3YhB8CUMknT2StCdBY8jrphgVK8w43xFPi", "1KeiLkvHkqSAHsFf8tegSU3y3Hq77BuwPt", "bc1qej2z5pqg2mrsre0ad4eumpnht8ak2ajtfejsla"],
+	],
+};
+
+# Public keys of a few private keys in every form btk pubkey reads and
+# writes, keys that are not on the curve and the BIP86 internal keys and
+# taproot addresses, as worked out by test/data/mkpubkey.py. Each key is its decimal private key, the
+# compressed, uncompressed and x-only hex, P2PKH compressed and
+# uncompressed, P2WPKH and taproot addresses.
+$pubkey = {
+	"keys" => [
+		["1", "0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798", "0479be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8", "79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798", "1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH", "1EHNa6Q4Jz2uvNExL497mE43ikXhwF6kZm", "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4", "bc1pmfr3p9j00pfxjh0zmgp99y8zftmd3s5pmedqhyptwy6lm87hf5sspknck9"],
+		["2", "02c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee5", "04c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee51ae168fea63dc339a3c58419466ceaeef7f632653266d0e1236431a950cfe52a", "c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee5", "1cMh228HTCiwS8ZsaakH8A8wze1JR5ZsP", "1LagHJk2FyCV2VzrNHVqg3gYG4TSYwDV4m", "bc1qq6hag67dl53wl99vzg42z8eyzfz2xlkvxechjp", "bc1pet7ep3czdu9k4wvdlz2fp5p8x2yp7t6ttyqg2c6cmh0lgeuu9lasmp9hsg"],
+		["3", "02f9308a019258c31049344f85f89d5229b531c845836f99b08601f113bce036f9", "04f9308a019258c31049344f85f89d5229b531c845836f99b08601f113bce036f9388f7b0f632de8140fe337e62a37f3566500a99934c2231b6cb9fd7584b8e672", "f9308a019258c31049344f85f89d5229b531c845836f99b08601f113bce036f9", "1CUNEBjYrCn2y1SdiUMohaKUi4wpP326Lb", "1NZUP3JAc9JkmbvmoTv7nVgZGtyJjirKV1", "bc1q0ht9tyks4vh7p5p904t340cr9nvahy7u3re7zg", "bc1pgxxyvcmdncdxs06cudd5yvmwwahaesaj6n3eu7st7x4sw9hrchaqjy33gs"],
+		["115792089237316195423570985008687907852837564279074904382605163141518161494336", "0379be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798", "0479be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798b7c52588d95c3b9aa25b0403f1eef75702e84bb7597aabe663b82f6f04ef2777", "79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798", "1GrLCmVQXoyJXaPJQdqssNqwxvha1eUo2E", "1JPbzbsAx1HyaDQoLMapWGoqf9pD5uha5m", "bc1q4h0ycu78h88wzldxc7e79vhw5xsde0n8jk4wl5", "bc1pmfr3p9j00pfxjh0zmgp99y8zftmd3s5pmedqhyptwy6lm87hf5sspknck9"],
+		["69291675717989167975973302432652508210900605924011867510192277652346948246023", "03d1deeb5bf943f572b0c521e1acb0b03cf963e14df66cfb82408829c21b79dffa", "04d1deeb5bf943f572b0c521e1acb0b03cf963e14df66cfb82408829c21b79dffa900bfe24c12a2b53b850c1b1a04279e359db6d5e2da9b5fe6f03a83eb920edef", "d1deeb5bf943f572b0c521e1acb0b03cf963e14df66cfb82408829c21b79dffa", "1NrNdWYGQNTSaT63KwaXduhmVjT5zY1S3J", "1AdEnZDxRyk87gachSGdwJv5utmcbgrYUG", "bc1qa7c3gd44w2g09qnq7mez5w5avlwpnc42rxvw98", "bc1pnyhc5cev690lrdcssp05jm684knxthjnqh7y7yftwraxxmy99ews4m2sa0"],
+	],
+	"rejected" => [
+		"020000000000000000000000000000000000000000000000000000000000000005",
+		"02fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f",
+		"03ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+		"04d1deeb5bf943f572b0c521e1acb0b03cf963e14df66cfb82408829c21b79dffa900bfe24c12a2b53b850c1b1a04279e359db6d5e2da9b5fe6f03a83eb920edf0",
+	],
+	"bip86" => [
+		["cc8a4bc64d897bddc5fbc2f670f7a8ba0b386779106cf1223c6fc5d7cd6fc115", "bc1p5cyxnuxmeuwuvkwfem96lqzszd02n6xdcjrs20cac6yqjjwudpxqkedrcr"],
+		["83dfe85a3151d2517290da461fe2815591ef69f2b18a2ce63f01697a8b313145", "bc1p4qhjn9zdvkux4e44uhx8tc55attvtyu358kutcqkudyccelu0was9fqzwh"],
+		["399f1b2f4393f29a18c937859c5dd8a77350103157eb880f02e8c08214277cef", "bc1p3qkhfews2uk44qtvauqyr2ttdsw7svhkl9nkm9s9c3x4ax5h60wqwruhk7"],
+	],
+};
+
+$chain = {
+	"blocks" => [
+		'{"type": "block", "file": "blk00000.dat", "offset": 8, "hash": "000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f", "version": 1, "prev_hash": "0000000000000000000000000000000000000000000000000000000000000000", "merkle_root": "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b", "time": 1231006505, "bits": 486604799, "nonce": 2083236893, "size": 285, "tx_count": 1, "value": 5000000000}',
+		'{"type": "tx", "block": "000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f", "index": 0, "txid": "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b", "size": 204, "segwit": false, "inputs": 1, "outputs": 1, "value": 5000000000}',
+		'{"type": "block", "file": "blk00000.dat", "offset": 301, "hash": "9edda412253d0587c3e4773d3cf3b52270892d702a5cbf23a8eb40fce0507489", "version": 536870912, "prev_hash": "000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f", "merkle_root": "c16cd9896b934b4f607377764a6120bfe12ecff6fa6327a52747e011dd98dba4", "time": 1231006600, "bits": 545259519, "nonce": 0, "size": 2351, "tx_count": 1, "value": 745300}',
+		'{"type": "tx", "block": "9edda412253d0587c3e4773d3cf3b52270892d702a5cbf23a8eb40fce0507489", "index": 0, "txid": "c16cd9896b934b4f607377764a6120bfe12ecff6fa6327a52747e011dd98dba4", "size": 2270, "segwit": false, "inputs": 1, "outputs": 58, "value": 745300}',
+		'{"type": "block", "file": "blk00000.dat", "offset": 2660, "hash": "12b731b406b8c4725cfc30aa687e27e1668e00ca3f0ae328b6ec629506f1c05b", "version": 536870912, "prev_hash": "9edda412253d0587c3e4773d3cf3b52270892d702a5cbf23a8eb40fce0507489", "merkle_root": "6ce993d595fad3114565013273d17b89fc0886a68a945bb096968c1a64f73ee7", "time": 1231007200, "bits": 545259519, "nonce": 0, "size": 8013, "tx_count": 6, "value": 5000019200}',
+		'{"type": "tx", "block": "12b731b406b8c4725cfc30aa687e27e1668e00ca3f0ae328b6ec629506f1c05b", "index": 0, "txid": "34771e75e4ec7935afb86ddf0ba99b1cb10c83696ec5d4c1eec7808334a1ad55", "size": 66, "segwit": false, "inputs": 1, "outputs": 1, "value": 5000000000}',
+		'{"type": "tx", "block": "12b731b406b8c4725cfc30aa687e27e1668e00ca3f0ae328b6ec629506f1c05b", "index": 1, "txid": "5ba5e3ba9dc94414b901a7c174226ca0a39d58858ae3c08e22004267d22a7d70", "size": 2668, "segwit": true, "inputs": 15, "outputs": 4, "value": 10000}',
+		'{"type": "tx", "block": "12b731b406b8c4725cfc30aa687e27e1668e00ca3f0ae328b6ec629506f1c05b", "index": 2, "txid": "ce0927434f93ee7625dc3d0c00eab26b905571c9382759b649b927a27e30dd0d", "size": 167, "segwit": false, "inputs": 1, "outputs": 1, "value": 900}',
+		'{"type": "tx", "block": "12b731b406b8c4725cfc30aa687e27e1668e00ca3f0ae328b6ec629506f1c05b", "index": 3, "txid": "a2c856962ae45a510b6663425d672789de725c983eb7e25feb0d18edf6fe66aa", "size": 1823, "segwit": true, "inputs": 12, "outputs": 3, "value": 6000}',
+		'{"type": "tx", "block": "12b731b406b8c4725cfc30aa687e27e1668e00ca3f0ae328b6ec629506f1c05b", "index": 4, "txid": "f6910efaba9c66d282f6b57c4db053cb5393ea8cf4f57fed8dc5199c0cd2e6c1", "size": 598, "segwit": true, "inputs": 9, "outputs": 2, "value": 1200}',
+		'{"type": "tx", "block": "12b731b406b8c4725cfc30aa687e27e1668e00ca3f0ae328b6ec629506f1c05b", "index": 5, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "size": 2610, "segwit": true, "inputs": 22, "outputs": 2, "value": 1100}',
+		'{"type": "block", "file": "blk00000.dat", "offset": 10681, "hash": "e102a0c39b31fdf543ba35f91456a6e2531949bd4938639dc96a69075a15cf8a", "version": 536870912, "prev_hash": "12b731b406b8c4725cfc30aa687e27e1668e00ca3f0ae328b6ec629506f1c05b", "merkle_root": "d099f69341c40e28c5a32f09f3ac0edbaf654601f0ae9ecae8b167aa11e0bd45", "time": 1231007800, "bits": 545259519, "nonce": 0, "size": 276, "tx_count": 2, "value": 5000000900}',
+		'{"type": "tx", "block": "e102a0c39b31fdf543ba35f91456a6e2531949bd4938639dc96a69075a15cf8a", "index": 0, "txid": "dc56309cbc90d3a08e1714d834c947ebb080897507576723754642ec368f2439", "size": 66, "segwit": false, "inputs": 1, "outputs": 1, "value": 5000000000}',
+		'{"type": "tx", "block": "e102a0c39b31fdf543ba35f91456a6e2531949bd4938639dc96a69075a15cf8a", "index": 1, "txid": "0a7b3f9ff6560814803893cd75beb64dd8d60bde85773c588d2da461e1334cf5", "size": 129, "segwit": true, "inputs": 1, "outputs": 1, "value": 900}',
+	],
+	"failures" => [
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 0, "error": "P2SH redeem script evaluated to false."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 1, "error": "Script evaluated to false."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 2, "error": "P2WSH witness script doesn\'t match its program."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 3, "error": "Script contains disabled opcode 0x7e."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 4, "error": "Script executes OP_RETURN."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 5, "error": "Witness script must leave exactly one true element."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 6, "error": "P2SH scriptSig is not push only."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 7, "error": "Script evaluated to false."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 8, "error": "Witness script must leave exactly one true element."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 9, "error": "Schnorr signature is invalid."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 10, "error": "Schnorr signature has the wrong size or hash type."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 11, "error": "Schnorr signature is invalid."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 12, "error": "Taproot control block doesn\'t commit to the output key."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 13, "error": "OP_CHECKMULTISIG is disabled in tapscript."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 14, "error": "OP_IF argument is not minimal."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 15, "error": "Witness script must leave exactly one true element."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 16, "error": "Witness script must leave exactly one true element."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 17, "error": "Witness script must leave exactly one true element."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 18, "error": "Schnorr signature is invalid."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 19, "error": "P2SH witness scriptSig is not a single push of the redeem script."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 20, "error": "Input has a witness but spends no witness program."}',
+		'{"type": "failure", "height": 2, "txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "input": 21, "error": "Witness program spent with a non-empty scriptSig."}',
+	],
+	"summary" => {
+		"inputs" => 60,
+		"signatures" => 40,
+		"failures" => 22,
+		"outputs" => 13,
+		"amount" => 10000018100,
+	},
+	"queries" => [
+		'{"txid": "c16cd9896b934b4f607377764a6120bfe12ecff6fa6327a52747e011dd98dba4", "vout": 0, "found": false}',
+		'{"txid": "5ba5e3ba9dc94414b901a7c174226ca0a39d58858ae3c08e22004267d22a7d70", "vout": 0, "found": false}',
+		'{"txid": "ce0927434f93ee7625dc3d0c00eab26b905571c9382759b649b927a27e30dd0d", "vout": 0, "found": true, "amount": 900, "height": 2, "coinbase": false, "script": "51"}',
+		'{"txid": "34771e75e4ec7935afb86ddf0ba99b1cb10c83696ec5d4c1eec7808334a1ad55", "vout": 0, "found": true, "amount": 5000000000, "height": 2, "coinbase": true, "script": "51"}',
+		'{"txid": "153db88f348eefca7ca809d96d614ca00b6f96adb704a693ef0c64dc5784d0e7", "vout": 1, "found": true, "amount": 600, "height": 2, "coinbase": false, "script": "52"}',
+	],
+	"addresses" => [
+		'{"address": "15sp3G6ybVav5xms16VMGQ1DvfTgeWwZkY", "type": "p2pkh", "outputs": 2, "unspent": 1, "received": 13000, "balance": 3000, "entries": [{"txid": "c16cd9896b934b4f607377764a6120bfe12ecff6fa6327a52747e011dd98dba4", "vout": 0, "height": 1, "amount": 10000, "spent_height": 2}, {"txid": "a2c856962ae45a510b6663425d672789de725c983eb7e25feb0d18edf6fe66aa", "vout": 2, "height": 2, "amount": 3000}]}',
+		'{"address": "14AzQG8E5W8kDiDNnLm1WboPVSzFStz6XN", "type": "p2pkh", "outputs": 1, "unspent": 0, "received": 1000, "balance": 0, "entries": [{"txid": "5ba5e3ba9dc94414b901a7c174226ca0a39d58858ae3c08e22004267d22a7d70", "vout": 0, "height": 2, "amount": 1000, "spent_height": 2}]}',
+		'{"address": "3L419f7mip7GJcvjzMrb9YUPivYgWPhpPs", "type": "p2sh", "outputs": 2, "unspent": 1, "received": 14300, "balance": 3000, "entries": [{"txid": "c16cd9896b934b4f607377764a6120bfe12ecff6fa6327a52747e011dd98dba4", "vout": 13, "height": 1, "amount": 11300, "spent_height": 2}, {"txid": "5ba5e3ba9dc94414b901a7c174226ca0a39d58858ae3c08e22004267d22a7d70", "vout": 2, "height": 2, "amount": 3000}]}',
+		'{"address": "bc1q9xxuxxaar5427x0tqkjy5lr3nujvahrqpekmst", "type": "p2wpkh", "outputs": 2, "unspent": 1, "received": 12500, "balance": 2000, "entries": [{"txid": "c16cd9896b934b4f607377764a6120bfe12ecff6fa6327a52747e011dd98dba4", "vout": 5, "height": 1, "amount": 10500, "spent_height": 2}, {"txid": "5ba5e3ba9dc94414b901a7c174226ca0a39d58858ae3c08e22004267d22a7d70", "vout": 1, "height": 2, "amount": 2000}]}',
+		'{"address": "bc1qetpzmhe499dr8phre85n6m2d5xs3rq32d67rfu3h3aljfzqs2ycqw3talq", "type": "p2wsh", "outputs": 2, "unspent": 1, "received": 15100, "balance": 4000, "entries": [{"txid": "c16cd9896b934b4f607377764a6120bfe12ecff6fa6327a52747e011dd98dba4", "vout": 11, "height": 1, "amount": 11100, "spent_height": 2}, {"txid": "5ba5e3ba9dc94414b901a7c174226ca0a39d58858ae3c08e22004267d22a7d70", "vout": 3, "height": 2, "amount": 4000}]}',
+		'{"address": "bc1pk7ueyq693xzzwrepjmgemxjp2rg52xezcdpns5vqvsgz3jpfvp2swpzcf9", "type": "p2tr", "outputs": 2, "unspent": 1, "received": 13500, "balance": 2000, "entries": [{"txid": "c16cd9896b934b4f607377764a6120bfe12ecff6fa6327a52747e011dd98dba4", "vout": 15, "height": 1, "amount": 11500, "spent_height": 2}, {"txid": "a2c856962ae45a510b6663425d672789de725c983eb7e25feb0d18edf6fe66aa", "vout": 1, "height": 2, "amount": 2000}]}',
+		'{"address": "bc1pak7yyfrj0gvm8n4pe8wh33e3y42csnpqdhjmx29flua8ga868fmqvgwq5c", "type": "p2tr", "outputs": 1, "unspent": 0, "received": 1000, "balance": 0, "entries": [{"txid": "a2c856962ae45a510b6663425d672789de725c983eb7e25feb0d18edf6fe66aa", "vout": 0, "height": 2, "amount": 1000, "spent_height": 3}]}',
+		'{"address": "1111111111111111111114oLvT2", "type": "p2pkh", "outputs": 1, "unspent": 1, "received": 700, "balance": 700, "entries": [{"txid": "f6910efaba9c66d282f6b57c4db053cb5393ea8cf4f57fed8dc5199c0cd2e6c1", "vout": 1, "height": 2, "amount": 700}]}',
+		'{"address": "bc1qd766yh2mwesxmndq8dqjmjm0ww36xzhartr7k0", "type": "p2wpkh", "outputs": 0, "unspent": 0, "received": 0, "balance": 0, "entries": []}',
+		'{"address": "BC1Q9XXUXXAAR5427X0TQKJY5LR3NUJVAHRQPEKMST", "type": "p2wpkh", "outputs": 2, "unspent": 1, "received": 12500, "balance": 2000, "entries": [{"txid": "c16cd9896b934b4f607377764a6120bfe12ecff6fa6327a52747e011dd98dba4", "vout": 5, "height": 1, "amount": 10500, "spent_height": 2}, {"txid": "5ba5e3ba9dc94414b901a7c174226ca0a39d58858ae3c08e22004267d22a7d70", "vout": 1, "height": 2, "amount": 2000}]}',
+	],
+	"unspent" => [
+		'{"address": "15sp3G6ybVav5xms16VMGQ1DvfTgeWwZkY", "type": "p2pkh", "outputs": 2, "unspent": 1, "received": 13000, "balance": 3000, "entries": [{"txid": "a2c856962ae45a510b6663425d672789de725c983eb7e25feb0d18edf6fe66aa", "vout": 2, "height": 2, "amount": 3000}]}',
+	],
+};
+
 return 1;
\ No newline at end of file
@@ -1,7 +1,9 @@
 #!/usr/bin/perl
 
 use lib './test/lib';
-use Btk::TestData qw($networks $compression $iotypes $privkey $ntests);
+use IO::Socket::INET;
+use File::Temp qw(tempdir);
+use Btk::TestData qw($networks $compression $iotypes $privkey $ntests $blocks_asm $sign $hd $pubkey $chain);
 
 my $btk_location = "bin/btk";
 
@@ -52,6 +54,277 @@ for (my $i = 0; $i < $ntests; $i++)
 	}
 }
 
+## Script assembly on transaction lines
+my @asm_lines = grep { /"type": "tx"/ } split(/\n/, `$btk_location blocks -a -j 2 test/data/scripts`);
+for (my $i = 0; $i < @{$blocks_asm}; $i++)
+{
+	test_result("blocks -a test/data/scripts tx $i", $asm_lines[$i], $blocks_asm->[$i]);
+}
+
+## RFC6979 signatures
+my $hashes = join("\\n", @{$sign->{"hashes"}});
+foreach my $key (sort keys %{$sign->{"keys"}})
+{
+	my @der = split(/\n/, `printf "$hashes\\n" | $btk_location sign -j 2 -k test/data/sign/$key`);
+	my @compact = split(/\n/, `printf "$hashes\\n" | $btk_location sign -C -j 2 -k test/data/sign/$key`);
+	for (my $i = 0; $i < @{$sign->{"hashes"}}; $i++)
+	{
+		test_result("sign -k $key $sign->{'hashes'}->[$i]", $der[$i], $sign->{"keys"}->{$key}->{"der"}->[$i]);
+		test_result("sign -C -k $key $sign->{'hashes'}->[$i]", $compact[$i], $sign->{"keys"}->{$key}->{"compact"}->[$i]);
+	}
+}
+
+## BIP340 signatures
+my $schnorr_input = join("\\n", map { $sign->{"aux"}->[$_] ? "$sign->{'hashes'}->[$_] $sign->{'aux'}->[$_]" : $sign->{"hashes"}->[$_] } 0 .. $#{$sign->{"hashes"}});
+foreach my $key (sort keys %{$sign->{"keys"}})
+{
+	my @schnorr = split(/\n/, `printf "$schnorr_input\\n" | $btk_location sign -S -j 2 -k test/data/sign/$key`);
+	for (my $i = 0; $i < @{$sign->{"hashes"}}; $i++)
+	{
+		test_result("sign -S -k $key $sign->{'hashes'}->[$i]", $schnorr[$i], $sign->{"keys"}->{$key}->{"schnorr"}->[$i]);
+	}
+}
+foreach my $vector (@{$sign->{"bip340"}})
+{
+	my $output = `echo "$vector->[1] $vector->[2]" | $btk_location sign -S -k test/data/sign/$vector->[0]`;
+	chomp($output);
+	test_result("sign -S -k $vector->[0] $vector->[1] $vector->[2]", $output, $vector->[3]);
+}
+
+## BIP32 test vectors
+foreach my $vector (@{$hd->{"vectors"}})
+{
+	my $master = defined($vector->{"seed"}) ? `echo $vector->{"seed"} | $btk_location hd seed` : "$vector->{'xprv'}\n";
+	foreach my $path (@{$vector->{"paths"}})
+	{
+		my $xprv = `printf "$master" | $btk_location hd derive -p "$path->[0]"`;
+		my $xpub = `printf "$master" | $btk_location hd derive -p "$path->[0]" -x`;
+		chomp($xprv, $xpub);
+		test_result("hd derive -p $path->[0]", $xprv, $path->[1]);
+		test_result("hd derive -p $path->[0] -x", $xpub, $path->[2]);
+	}
+}
+
+my $last = $hd->{"vectors"}->[-1]->{"seed"};
+my $n = @{$hd->{"children"}} - 1;
+my @private = split(/\n/, `echo $last | $btk_location hd seed | $btk_location hd derive -p "m/0'" -r 0-$n -x -j 2`);
+my @public = split(/\n/, `$btk_location hd derive -k $hd->{"xpub"} -r 0-$n -j 2`);
+my @p2pkh = split(/\n/, `$btk_location hd derive -k $hd->{"xpub"} -r 0-$n -A -j 2`);
+my @p2wpkh = split(/\n/, `$btk_location hd derive -k $hd->{"xpub"} -r 0-$n -B -j 2`);
+for (my $i = 0; $i <= $n; $i++)
+{
+	test_result("hd derive -p m/0'/$i -x", $private[$i], $hd->{"children"}->[$i]->[0]);
+	test_result("hd derive -k xpub -r $i", $public[$i], $hd->{"children"}->[$i]->[0]);
+	test_result("hd derive -k xpub -r $i -A", $p2pkh[$i], $hd->{"children"}->[$i]->[1]);
+	test_result("hd derive -k xpub -r $i -B", $p2wpkh[$i], $hd->{"children"}->[$i]->[2]);
+}
+
+## Public key input
+# Output options and the column of each key holding what they print. An
+# x-only key is the point with an even y, so only its taproot address is
+# the same as its private key's whatever the y.
+my %pubkey_outputs = ("-H -C" => 1, "-H -U" => 2, "-A -C" => 4, "-A -U" => 5, "-B -C" => 6, "-X" => 7);
+my %pubkey_inputs = ("compressed" => 1, "uncompressed" => 2, "x-only" => 3);
+my $raw_dir = tempdir(CLEANUP => 1);
+foreach my $flags (sort keys %pubkey_outputs)
+{
+	my $column = $pubkey_outputs{$flags};
+	foreach my $key (@{$pubkey->{"keys"}})
+	{
+		my $output = `echo $key->[0] | $btk_location pubkey -d $flags`;
+		chomp($output);
+		test_result("pubkey -d $flags $key->[0]", $output, $key->[$column]);
+	}
+	foreach my $form (sort keys %pubkey_inputs)
+	{
+		my $keys = $pubkey->{"keys"};
+		my @expected = map { $_->[$column] } @{$keys};
+		if ($form eq "x-only")
+		{
+			next if ($column != 1 && $column != 7);
+			@expected = map { "02$_->[3]" } @{$keys} if ($column == 1);
+		}
+		my @input = map { $_->[$pubkey_inputs{$form}] } @{$keys};
+		my $lines = join("\\n", @input);
+		my @hex = split(/\n/, `printf "$lines\\n" | $btk_location pubkey -p $flags`);
+		my @raw = ();
+		# Compressed keys can be read back to back; the others one per run.
+		my @files = $form eq "compressed" ? (join("", @input)) : @input;
+		for (my $i = 0; $i < @files; $i++)
+		{
+			my $file = "$raw_dir/$form$i.dat";
+			open(my $out, ">:raw", $file) or die "Could not write $file\n";
+			print $out pack("H*", $files[$i]);
+			close($out);
+			push(@raw, split(/\n/, `$btk_location pubkey -q $flags < $file`));
+		}
+		for (my $i = 0; $i < @{$keys}; $i++)
+		{
+			test_result("pubkey -p $flags $form $keys->[$i]->[0]", $hex[$i], $expected[$i]);
+			test_result("pubkey -q $flags $form $keys->[$i]->[0]", $raw[$i], $expected[$i]);
+		}
+	}
+}
+foreach my $key (@{$pubkey->{"rejected"}})
+{
+	my @forms = ($key);
+	push(@forms, substr($key, 2)) if ($key =~ /^02/);
+	foreach my $form (@forms)
+	{
+		my ($error) = `echo $form | $btk_location pubkey -p 2>&1` =~ /(Public key is not on the curve\.)/;
+		test_result("pubkey -p $form", $error, "Public key is not on the curve.");
+	}
+}
+
+## Point decompression
+foreach my $key (@{$pubkey->{"keys"}})
+{
+	my $compressed = `echo $key->[2] | $btk_location pubkey -p -H -C`;
+	chomp($compressed);
+	test_result("pubkey -p -H -C $key->[2]", $compressed, $key->[1]);
+	my $file = "$raw_dir/round_trip.dat";
+	open(my $out, ">:raw", $file) or die "Could not write $file\n";
+	print $out pack("H*", $compressed);
+	close($out);
+	my $uncompressed = `$btk_location pubkey -q -H -U < $file`;
+	chomp($uncompressed);
+	test_result("pubkey -q -H -U $compressed", $uncompressed, $key->[2]);
+}
+# An x with no square root for y, at the end of a batch of good keys.
+my $non_residue = $pubkey->{"rejected"}->[0];
+foreach my $prefix ("02", "03")
+{
+	my $file = "$raw_dir/non_residue$prefix.dat";
+	open(my $out, ">:raw", $file) or die "Could not write $file\n";
+	print $out pack("H*", join("", map { $_->[1] } @{$pubkey->{"keys"}}) . $prefix . substr($non_residue, 2));
+	close($out);
+	my ($error) = `$btk_location pubkey -q -H -U < $file 2>&1` =~ /(Public key \d+ is not on the curve\.)/;
+	test_result("pubkey -q $prefix" . substr($non_residue, 2), $error, "Public key " . @{$pubkey->{"keys"}} . " is not on the curve.");
+}
+
+## BIP86 taproot addresses
+foreach my $vector (@{$pubkey->{"bip86"}})
+{
+	foreach my $key ($vector->[0], "02$vector->[0]")
+	{
+		my $output = `echo $key | $btk_location pubkey -p -X`;
+		chomp($output);
+		test_result("pubkey -p -X $key", $output, $vector->[1]);
+	}
+}
+
+## Signed chain
+my @chain_lines = split(/\n/, `$btk_location blocks -x -j 2 test/data/chain`);
+for (my $i = 0; $i < @{$chain->{"blocks"}}; $i++)
+{
+	test_result("blocks -x test/data/chain line $i", $chain_lines[$i], $chain->{"blocks"}->[$i]);
+}
+
+my $utxo = "/tmp/btk_test_utxo_$$.dat";
+unlink($utxo);
+my @verify = split(/\n/, `$btk_location utxo build -V -j 2 -o $utxo test/data/chain`);
+my @failures = grep { /"type": "failure"/ } @verify;
+for (my $i = 0; $i < @{$chain->{"failures"}}; $i++)
+{
+	test_result("utxo build -V test/data/chain failure $i", $failures[$i], $chain->{"failures"}->[$i]);
+}
+my $summary = join("", grep { !/"type": "failure"/ } @verify);
+foreach my $field (sort keys %{$chain->{"summary"}})
+{
+	my ($value) = $summary =~ /"$field": (\d+)/;
+	test_result("utxo build -V test/data/chain $field", $value, $chain->{"summary"}->{$field});
+}
+
+my @outpoints = map { /"txid": "(\w+)", "vout": (\d+)/ ? "$1:$2" : () } @{$chain->{"queries"}};
+my @found = split(/\n/, `$btk_location utxo query -i $utxo @outpoints`);
+for (my $i = 0; $i < @outpoints; $i++)
+{
+	test_result("utxo query $outpoints[$i]", $found[$i], $chain->{"queries"}->[$i]);
+}
+unlink($utxo);
+
+## Address index
+my $index = "/tmp/btk_test_index_$$.dat";
+unlink($index);
+`$btk_location index build -o $index test/data/chain`;
+my @addresses = map { /"address": "(\w+)"/ ? $1 : () } @{$chain->{"addresses"}};
+my @entries = split(/\n/, `$btk_location index query -i $index @addresses`);
+for (my $i = 0; $i < @addresses; $i++)
+{
+	test_result("index query $addresses[$i]", $entries[$i], $chain->{"addresses"}->[$i]);
+}
+foreach my $expected (@{$chain->{"unspent"}})
+{
+	my ($address) = $expected =~ /"address": "(\w+)"/;
+	my $output = `$btk_location index query -u -i $index $address`;
+	chomp($output);
+	test_result("index query -u $address", $output, $expected);
+}
+unlink($index);
+
+## Loopback node
+my $block_hashes = join("\\n", map { /"type": "block".*"hash": "(\w+)"/ ? $1 : () } @{$chain->{"blocks"}});
+my $port = free_port();
+my $download = tempdir(CLEANUP => 1);
+open(my $serve, "-|", "$btk_location node --serve -r test/data/chain/blk00000.dat -p $port -c 1") or die "Could not start btk node --serve\n";
+wait_listening($port);
+`printf "$block_hashes\\n" | $btk_location node --download -h 127.0.0.1 -p $port -o $download`;
+my $served = join("", <$serve>);
+close($serve);
+my ($blocks_served) = $served =~ /"blocks_served": (\d+)/;
+test_result("node --serve test/data/chain blocks_served", $blocks_served, scalar(grep { /"type": "block"/ } @{$chain->{"blocks"}}));
+test_result("node --download from --serve test/data/chain", file_compare("$download/blk00000.dat", "test/data/chain/blk00000.dat"), "identical");
+
+## Capture and replay
+my $capture_dir = tempdir(CLEANUP => 1);
+my $capture = "$capture_dir/capture.dat";
+$port = free_port();
+open($serve, "-|", "$btk_location node --serve -r test/data/chain/blk00000.dat -p $port -c 1") or die "Could not start btk node --serve\n";
+wait_listening($port);
+`printf "$block_hashes\\n" | $btk_location node --download -h 127.0.0.1 -p $port -o $capture_dir --capture $capture`;
+close($serve);
+
+my $parsed = `$btk_location node --replay $capture`;
+my ($parse_failures) = $parsed =~ /"failures": (\d+)/;
+my ($parsed_blocks) = $parsed =~ /"block": (\d+)/;
+test_result("node --replay capture failures", $parse_failures, 0);
+test_result("node --replay capture blocks", $parsed_blocks, scalar(grep { /"type": "block"/ } @{$chain->{"blocks"}}));
+
+$port = free_port();
+$download = tempdir(CLEANUP => 1);
+open($serve, "-|", "$btk_location node --serve -r $capture -p $port -c 1") or die "Could not start btk node --serve\n";
+wait_listening($port);
+`printf "$block_hashes\\n" | $btk_location node --download -h 127.0.0.1 -p $port -o $download`;
+close($serve);
+test_result("node --download from --serve -r capture", file_compare("$download/blk00000.dat", "test/data/chain/blk00000.dat"), "identical");
+
+# A capture cut short, and one whose first frame claims another payload
+# length than its record holds. The first record's frame follows the file
+# header, 14 fixed bytes and the peer name, and its payload length sits
+# 16 bytes into the frame.
+open(my $in, "<:raw", $capture) or die "Could not read $capture\n";
+my $bytes = do { local $/; <$in> };
+close($in);
+my $length_at = 8 + 14 + ord(substr($bytes, 17, 1)) + 16;
+my %damaged = (
+	"truncated" => substr($bytes, 0, length($bytes) - 10),
+	"corrupt" => substr($bytes, 0, $length_at) . chr(ord(substr($bytes, $length_at, 1)) ^ 1) . substr($bytes, $length_at + 1),
+);
+my %damaged_error = ("truncated" => "is truncated.", "corrupt" => "does not hold one whole message.");
+foreach my $damage (sort keys %damaged)
+{
+	my $file = "$capture_dir/$damage.dat";
+	open(my $out, ">:raw", $file) or die "Could not write $file\n";
+	print $out $damaged{$damage};
+	close($out);
+
+	my ($error) = `$btk_location node --replay $file 2>&1` =~ /Capture record at offset \d+ (.*?)\s*$/;
+	test_result("node --replay $damage capture", $error, $damaged_error{$damage});
+	$port = free_port();
+	($error) = `$btk_location node --serve -r $file -p $port -c 1 2>&1` =~ /Capture record at offset \d+ (.*?)\s*$/;
+	test_result("node --serve -r $damage capture", $error, $damaged_error{$damage});
+}
+
 ##$result =  btk_privkey_get({'from' => 'wif', 'to' => 'wif', 'network' => 'main', 'compression' => 1 }, $privkey->[$i]->{"wif_c"});
 
 
@@ -84,6 +357,65 @@ sub btk_privkey_get
 	return $result;
 }
 
+sub test_result
+{
+	my $input = shift;
+	my $output = shift;
+	my $expected = shift;
+
+	print "$input => $output : ";
+	if (defined($output) && $output eq $expected)
+	{
+		print "PASSED\n";
+	}
+	else
+	{
+		print "FAILED\n";
+	}
+}
+
+sub file_compare
+{
+	my $a = shift;
+	my $b = shift;
+
+	system("cmp", "-s", $a, $b);
+
+	return ($? == 0) ? "identical" : "different";
+}
+
+# A loopback port nothing is listening on
+sub free_port
+{
+	my $socket = IO::Socket::INET->new(LocalAddr => "127.0.0.1", LocalPort => 0, Listen => 1) or die "Could not find a free port\n";
+	my $port = $socket->sockport();
+
+	close($socket);
+
+	return $port;
+}
+
+# Wait for btk node --serve to listen on the port. Watching the socket
+# table rather than connecting doesn't use up one of the connections it
+# serves.
+sub wait_listening
+{
+	my $port = shift;
+	my $listening = sprintf(":%04X 00000000:0000 0A ", $port);
+
+	for (my $i = 0; $i < 100; $i++)
+	{
+		open(my $tcp, "<", "/proc/net/tcp") or return;
+		my $found = grep { index($_, $listening) >= 0 } <$tcp>;
+		close($tcp);
+		if ($found)
+		{
+			return;
+		}
+		select(undef, undef, undef, 0.05);
+	}
+}
+
 sub btk_get
 {
 	my $command = shift;